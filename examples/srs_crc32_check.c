@@ -0,0 +1,111 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2015 SRS(ossrs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+/**
+gcc srs_crc32_check.c ../../objs/lib/srs_librtmp.a -g -O2 -lstdc++ -lpthread -o srs_crc32_check
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../../objs/include/srs_librtmp.h"
+
+/**
+* the bitwise MPEG-2 CRC, the reference of srs_utils_crc32.
+*/
+u_int32_t crc32_bitwise(const u_int8_t* data, int size)
+{
+    u_int32_t crc = 0xffffffff;
+    int i, k;
+    
+    for (i = 0; i < size; i++) {
+        crc ^= (u_int32_t)data[i] << 24;
+        for (k = 0; k < 8; k++) {
+            crc = (crc & 0x80000000)? (crc << 1) ^ 0x04c11db7 : (crc << 1);
+        }
+    }
+    
+    return crc;
+}
+
+int main()
+{
+    // the size of PAT, PMT, a ts packet and a large section.
+    int sizes[] = {12, 23, 184, 4096};
+    static u_int8_t buf[8192];
+    int i, size, offset;
+    int64_t loops, n, starttime, elapsed, bitwise;
+    u_int32_t v;
+    
+    printf("check the crc32 of ts PSI equals to the bitwise crc, and benchmark it.\n");
+    printf("srs(ossrs) client librtmp library.\n");
+    printf("version: %d.%d.%d\n", srs_version_major(), srs_version_minor(), srs_version_revision());
+    
+    srand(0);
+    for (i = 0; i < (int)sizeof(buf); i++) {
+        buf[i] = (u_int8_t)rand();
+    }
+    
+    // the known crc of "123456789" for the MPEG-2 CRC.
+    if ((v = srs_utils_crc32("123456789", 9)) != 0x0376e6e7) {
+        srs_human_trace("crc32 check value failed, actual=%#x", v);
+        return -1;
+    }
+    
+    // each size and unaligned offset, for the 8 bytes slicing and the tail bytes.
+    for (size = 0; size <= 1024; size++) {
+        for (offset = 0; offset < 8; offset++) {
+            if (srs_utils_crc32(buf + offset, size) != crc32_bitwise(buf + offset, size)) {
+                srs_human_trace("crc32 not equal, size=%d, offset=%d", size, offset);
+                return -1;
+            }
+        }
+    }
+    srs_human_trace("crc32 equals to bitwise for size [0, 1024] at 8 offsets");
+    
+    for (i = 0; i < (int)(sizeof(sizes) / sizeof(int)); i++) {
+        size = sizes[i];
+        loops = 100 * 1024 * 1024 / (size + 8);
+        v = 0;
+        
+        starttime = srs_utils_time_ms();
+        for (n = 0; n < loops; n++) {
+            v ^= srs_utils_crc32(buf + (n & 7), size);
+        }
+        elapsed = srs_utils_time_ms() - starttime;
+        elapsed = (elapsed > 0)? elapsed : 1;
+        
+        // the bitwise crc is much slower, use less loops.
+        starttime = srs_utils_time_ms();
+        for (n = 0; n < loops / 8; n++) {
+            v ^= crc32_bitwise(buf + (n & 7), size);
+        }
+        bitwise = srs_utils_time_ms() - starttime;
+        bitwise = (bitwise > 0)? bitwise * 8 : 8;
+        
+        srs_human_trace("size=%d, loops=%d, %.2fns/call, %.2fMB/s, bitwise %.2fns/call, speedup %.1fx, xor=%#x",
+            size, (int)loops, elapsed * 1000000.0 / loops, (double)size * loops / 1024 / 1024 * 1000 / elapsed,
+            bitwise * 1000000.0 / loops, (double)bitwise / elapsed, v);
+    }
+    
+    return 0;
+}
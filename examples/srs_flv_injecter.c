@@ -21,7 +21,7 @@ IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
 CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 /**
-gcc srs_flv_injecter.c ../../objs/lib/srs_librtmp.a -g -O0 -lstdc++ -o srs_flv_injecter
+gcc srs_flv_injecter.c ../../objs/lib/srs_librtmp.a -g -O0 -lstdc++ -lpthread -o srs_flv_injecter
 */
 
 #include <stdio.h>
@@ -86,7 +86,10 @@ int main(int argc, char** argv)
     ret = process(in_flv_file, tmp_file, &ic, &oc);
     
     srs_flv_close(ic);
-    srs_flv_close(oc);
+    // never rename the tmp file when failed to write the buffered tags.
+    if (srs_flv_close(oc) != 0 && ret == 0) {
+        ret = -1;
+    }
     
     if (ret != 0) {
         unlink(tmp_file);
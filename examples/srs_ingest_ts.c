@@ -0,0 +1,236 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2015 SRS(ossrs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+/**
+gcc srs_ingest_ts.c ../../objs/lib/srs_librtmp.a -g -O0 -lstdc++ -lpthread -o srs_ingest_ts
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+
+#include "../../objs/include/srs_librtmp.h"
+
+// the max size of udp datagram, generally 7 ts packets.
+#define UDP_MAX_PACKET_SIZE 65536
+// the size of block to read from ts file, in ts packets of 188 bytes.
+#define TS_FILE_BLOCK_SIZE (188 * 70)
+
+int open_udp(const char* url);
+int connect_oc(srs_rtmp_t ortmp);
+
+int main(int argc, char** argv)
+{
+    int ret = 0;
+
+    // user option parse index.
+    int opt = 0;
+    // user options.
+    char* in_ts = NULL;
+    char* out_rtmp_url = NULL;
+    // the udp socket or ts file.
+    int fd = -1;
+    int is_udp = 0;
+    // rtmp handler
+    srs_rtmp_t ortmp;
+
+    char* buf = NULL;
+    int size = 0;
+
+    printf("ingest udp or file ts and publish to RTMP server like FFMPEG.\n");
+    printf("srs(ossrs) client librtmp library.\n");
+    printf("version: %d.%d.%d\n", srs_version_major(), srs_version_minor(), srs_version_revision());
+
+    if (argc <= 2) {
+        printf("ingest udp or file ts and publish to RTMP server\n"
+            "Usage: %s <-i in_ts> <-y out_rtmp_url>\n"
+            "   in_ts           input ts, udp://host:port to listen, or the ts file.\n"
+            "   out_rtmp_url    output rtmp url, publish to this url.\n"
+            "For example:\n"
+            "   %s -i udp://0.0.0.0:1234 -y rtmp://127.0.0.1/live/livestream\n"
+            "   %s -i udp://239.1.1.1:1234 -y rtmp://127.0.0.1/live/livestream\n"
+            "   %s -i ./livestream.ts -y rtmp://127.0.0.1/live/livestream\n"
+            "@remark the ts file is ingested as fast as possible, use udp for live.\n",
+            argv[0], argv[0], argv[0], argv[0]);
+        exit(-1);
+    }
+
+    // fill the options for mac
+    for (opt = 0; opt < argc - 1; opt++) {
+        // ignore all options except -i and -y.
+        char* p = argv[opt];
+
+        // only accept -x
+        if (p[0] != '-' || p[1] == 0 || p[2] != 0) {
+            continue;
+        }
+
+        // parse according the option name.
+        switch (p[1]) {
+            case 'i': in_ts = argv[opt + 1]; break;
+            case 'y': out_rtmp_url = argv[opt + 1]; break;
+            default: break;
+        }
+    }
+
+    if (!in_ts) {
+        srs_human_trace("input invalid, use -i <input>");
+        return -1;
+    }
+    if (!out_rtmp_url) {
+        srs_human_trace("output invalid, use -y <output>");
+        return -1;
+    }
+
+    srs_human_trace("input:  %s", in_ts);
+    srs_human_trace("output: %s", out_rtmp_url);
+
+    is_udp = !strncmp(in_ts, "udp://", 6);
+    if (is_udp) {
+        fd = open_udp(in_ts + 6);
+    } else {
+        fd = open(in_ts, O_RDONLY);
+    }
+    if (fd < 0) {
+        ret = 2;
+        srs_human_trace("open ts %s failed. ret=%d", in_ts, ret);
+        return ret;
+    }
+
+    ortmp = srs_rtmp_create(out_rtmp_url);
+    if ((ret = connect_oc(ortmp)) != 0) {
+        goto ingest_cleanup;
+    }
+
+    size = is_udp? UDP_MAX_PACKET_SIZE : TS_FILE_BLOCK_SIZE;
+    buf = (char*)malloc(size);
+
+    srs_human_trace("start ingest ts to RTMP stream");
+    for (;;) {
+        // each datagram of udp, or block of file.
+        ssize_t nb_read = is_udp? recv(fd, buf, size, 0) : read(fd, buf, size);
+        if (nb_read <= 0) {
+            srs_human_trace("ts completed, nread=%d", (int)nb_read);
+            break;
+        }
+
+        // the corrupt ts is dropped by library, only the RTMP error is returned.
+        if ((ret = srs_rtmp_write_ts(ortmp, buf, (int)nb_read)) != 0) {
+            srs_human_trace("publish ts to RTMP failed. ret=%d", ret);
+            break;
+        }
+    }
+    srs_human_trace("ingest ts to RTMP completed");
+
+ingest_cleanup:
+    srs_rtmp_destroy(ortmp);
+    close(fd);
+    free(buf);
+
+    return ret;
+}
+
+int open_udp(const char* url)
+{
+    char host[64];
+    const char* p = strchr(url, ':');
+    if (!p || p - url >= (int)sizeof(host)) {
+        srs_human_trace("invalid udp url %s, for example, udp://0.0.0.0:1234", url);
+        return -1;
+    }
+    memcpy(host, url, p - url);
+    host[p - url] = 0;
+    int port = atoi(p + 1);
+
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        srs_human_trace("create udp socket failed.");
+        return -1;
+    }
+
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    // the kernel buffer for the burst of ts.
+    int rcvbuf = 4 * 1024 * 1024;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr(host);
+
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        srs_human_trace("bind udp %s:%d failed.", host, port);
+        close(fd);
+        return -1;
+    }
+
+    // join the multicast group.
+    if (IN_MULTICAST(ntohl(addr.sin_addr.s_addr))) {
+        struct ip_mreq mreq;
+        mreq.imr_multiaddr.s_addr = addr.sin_addr.s_addr;
+        mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+        if (setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+            srs_human_trace("join multicast %s failed.", host);
+            close(fd);
+            return -1;
+        }
+    }
+
+    srs_human_trace("listen udp %s:%d", host, port);
+    return fd;
+}
+
+int connect_oc(srs_rtmp_t ortmp)
+{
+    int ret = 0;
+
+    if ((ret = srs_rtmp_handshake(ortmp)) != 0) {
+        srs_human_trace("ortmp simple handshake failed. ret=%d", ret);
+        return ret;
+    }
+    srs_human_trace("ortmp simple handshake success");
+
+    if ((ret = srs_rtmp_connect_app(ortmp)) != 0) {
+        srs_human_trace("ortmp connect vhost/app failed. ret=%d", ret);
+        return ret;
+    }
+    srs_human_trace("ortmp connect vhost/app success");
+
+    if ((ret = srs_rtmp_publish_stream(ortmp)) != 0) {
+        srs_human_trace("ortmp publish stream failed. ret=%d", ret);
+        return ret;
+    }
+    srs_human_trace("ortmp publish stream success");
+
+    return ret;
+}
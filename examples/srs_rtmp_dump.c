@@ -21,7 +21,7 @@ IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
 CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 /**
-gcc srs_rtmp_dump.c ../../objs/lib/srs_librtmp.a -g -O0 -lstdc++ -o srs_rtmp_dump
+gcc srs_rtmp_dump.c ../../objs/lib/srs_librtmp.a -g -O0 -lstdc++ -lpthread -o srs_rtmp_dump
 */
 
 #include <stdio.h>
@@ -312,7 +312,9 @@ int main(int argc, char** argv)
     
 rtmp_destroy:
     srs_rtmp_destroy(rtmp);
-    srs_flv_close(flv);
+    if (srs_flv_close(flv) != 0) {
+        srs_human_trace("write flv failed.");
+    }
     srs_human_trace("completed");
     
     return 0;
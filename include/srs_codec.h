@@ -83,6 +83,7 @@ enum SrsCodecVideoAVCType
 //     5 = On2 VP6 with alpha channel
 //     6 = Screen video version 2
 //     7 = AVC
+//     12 = HEVC, not in the spec, the de facto extension of the CDNs.
 enum SrsCodecVideo
 {
     // set to the zero to reserved, for array map.
@@ -99,6 +100,7 @@ enum SrsCodecVideo
     SrsCodecVideoOn2VP6WithAlphaChannel = 5,
     SrsCodecVideoScreenVideoVersion2     = 6,
     SrsCodecVideoAVC                     = 7,
+    SrsCodecVideoHEVC                    = 12,
 };
 
 // SoundFormat UB [4] 
@@ -110,6 +110,8 @@ extern srs_rtmp_t srs_rtmp_create2(const char* url);
 /**
 * close and destroy the rtmp stack.
 * @remark, user should never use the rtmp again.
+* @remark, the packed packets of aggregate are flushed in best effort, the
+*       error is ignored, use srs_rtmp_flush_aggregate before to check it.
 */
 extern void srs_rtmp_destroy(srs_rtmp_t rtmp);
 
@@ -205,6 +207,39 @@ extern int srs_rtmp_play_stream(srs_rtmp_t rtmp);
 */
 extern int srs_rtmp_publish_stream(srs_rtmp_t rtmp);
 
+/**
+* pipelined session start, which send the connect, createStream and play
+* in one write without waiting for each response, then validate the
+* responses in order, to save two or three round trips for long RTT links.
+* category: play
+* previous: handshake
+* next: destroy
+* @remark it equals to srs_rtmp_connect_app then srs_rtmp_play_stream,
+*       but the srs debug info of connect response is ignored.
+* @remark the stream id is guessed to 1, when server returns another one,
+*       it fails and srs_rtmp_is_pipeline_stream_error is true, user should
+*       destroy it and reconnect without pipeline.
+* @return 0, success; otherwise, failed.
+*/
+extern int srs_rtmp_pipeline_play_stream(srs_rtmp_t rtmp);
+
+/**
+* pipelined session start, which send the connect and publish commands
+* in one write, @see srs_rtmp_pipeline_play_stream.
+* category: publish
+* previous: handshake
+* next: destroy
+* @remark it equals to srs_rtmp_connect_app then srs_rtmp_publish_stream.
+* @return 0, success; otherwise, failed.
+*/
+extern int srs_rtmp_pipeline_publish_stream(srs_rtmp_t rtmp);
+/**
+* whether the pipelined session failed for the stream id is not the guessed
+* one, the play or publish is sent on the wrong stream, so user should
+* reconnect and use srs_rtmp_connect_app then play or publish.
+*/
+extern srs_bool srs_rtmp_is_pipeline_stream_error(int error_code);
+
 /**
 * do bandwidth check with srs server.
 * 
@@ -265,6 +300,42 @@ extern int srs_rtmp_write_packet(srs_rtmp_t rtmp,
     char type, u_int32_t timestamp, char* data, int size
 );
 
+/**
+* pack the audio/video packets to RTMP aggregate message when publish,
+* to reduce the message header and chunk overhead, the aggregate is sent
+* once the packed packets reach the size or duration, or write other packets,
+* so a packet is delayed at most max_duration ms.
+* @param max_size, the max payload size of aggregate in bytes, 0 to disable,
+*       the packet larger than it is sent directly.
+* @param max_duration, the max duration of aggregate in ms, 0 to send the
+*       aggregate of each packet immediately, without any latency.
+* @remark srs_rtmp_destroy sends the packed packets in best effort, user should
+*       call srs_rtmp_flush_aggregate before destroy to get the error, and for
+*       the latency of live stream, keep the duration small.
+*
+* @return 0, success; otherswise, failed.
+*/
+extern int srs_rtmp_set_aggregate(srs_rtmp_t rtmp, int max_size, int max_duration);
+/**
+* send the packed audio/video packets in aggregate message.
+*
+* @return 0, success; otherswise, failed.
+*/
+extern int srs_rtmp_flush_aggregate(srs_rtmp_t rtmp);
+
+/**
+* read a audio/video/script-data packet from rtmp stream, without copy.
+* the params are the same to srs_rtmp_read_packet, but the data is owned by
+* the library and valid until the next read or destroy, the sub messages of
+* aggregate message are the views of the aggregate payload.
+* @remark: for read, user must never free the data, copy it when need to keep it.
+*
+* @return 0, success; otherswise, failed.
+*/
+extern int srs_rtmp_read_packet2(srs_rtmp_t rtmp, 
+    char* type, u_int32_t* timestamp, char** data, int* size
+);
+
 /**
 * whether type is script data and the data is onMetaData.
 */
@@ -459,6 +530,94 @@ extern srs_bool srs_h264_startswith_annexb(
     int* pnb_start_code
 );
 
+/*************************************************************
+**************************************************************
+* h265 raw codec
+**************************************************************
+*************************************************************/
+/**
+* write h.265 raw frame over RTMP to rtmp server, in enhanced RTMP,
+* that is, the video tag with the FourCC 'hvc1'.
+* @param frames the input h265 raw data, encoded h.265 I/P/B frames data.
+*       frames can be one or more than one frame,
+*       each frame prefixed annexb header, by N[00] 00 00 01, where N>=0, 
+*       for instance, frame = header(00 00 00 01) + payload(40 01 0C 01 FF FF ...)
+* @param frames_size the size of h265 raw data. 
+*       assert frames_size > 0, at least has 1 bytes header.
+* @param dts the dts of h.265 raw data.
+* @param pts the pts of h.265 raw data.
+* 
+* @remark, user should free the frames.
+* @remark, the tbn of dts/pts is 1/1000 for RTMP, that is, in ms.
+* @remark, the vps, sps and pps are muxed to HEVCDecoderConfigurationRecord,
+*       sent before the first frame, or the next frame when any changed.
+* @remark, the IRAP(BLA/IDR/CRA) frame is keyframe.
+* @example /trunk/research/librtmp/srs_h265_raw_publish.c
+* @see https://github.com/veovera/enhanced-rtmp
+* 
+* @return 0, success; otherswise, failed.
+*       for dvbsp error, @see srs_h265_is_dvbsp_error().
+*       for duplictated vps error, @see srs_h265_is_duplicated_vps_error().
+*       for duplictated sps error, @see srs_h265_is_duplicated_sps_error().
+*       for duplictated pps error, @see srs_h265_is_duplicated_pps_error().
+*/
+extern int srs_h265_write_raw_frames(srs_rtmp_t rtmp, 
+    char* frames, int frames_size, u_int32_t dts, u_int32_t pts
+);
+/**
+* whether error_code is dvbsp(drop video before vps/sps/pps/sequence-header) error.
+* @see srs_h264_is_dvbsp_error
+* @example /trunk/research/librtmp/srs_h265_raw_publish.c
+*/
+extern srs_bool srs_h265_is_dvbsp_error(int error_code);
+/**
+* whether error_code is duplicated vps error.
+* @example /trunk/research/librtmp/srs_h265_raw_publish.c
+*/
+extern srs_bool srs_h265_is_duplicated_vps_error(int error_code);
+/**
+* whether error_code is duplicated sps error.
+* @example /trunk/research/librtmp/srs_h265_raw_publish.c
+*/
+extern srs_bool srs_h265_is_duplicated_sps_error(int error_code);
+/**
+* whether error_code is duplicated pps error.
+* @example /trunk/research/librtmp/srs_h265_raw_publish.c
+*/
+extern srs_bool srs_h265_is_duplicated_pps_error(int error_code);
+
+/*************************************************************
+**************************************************************
+* ts ingest
+**************************************************************
+*************************************************************/
+/**
+* write the ts bytes over RTMP to rtmp server, the h.264/h.265 and aac in ts
+* are published, for example, to ingest the udp or file ts to RTMP.
+* the PES is reassembled from ts packets, the annexb NALUs and aac
+* ADTS frames are demuxed from PES in place, the timestamp in 90khz is
+* converted to ms, and the video sequence header and aac sequence header
+* are sent before the first frame, the h.265 is sent in enhanced RTMP.
+* @param data, the ts bytes, for example, a udp datagram of 7 ts packets,
+*       or any block of ts file, the partial ts packet at the end is kept
+*       util the next write completes it.
+* @param size, the size of ts bytes.
+*
+* @remark, user should free the data.
+* @remark, only the first video and the first aac stream is published,
+*       for the ts of multiple programs, the others are ignored.
+* @remark, the video before the first sps/pps(and vps for h.265) is dropped.
+* @remark, the ts must be written in realtime, it is not paced by the library.
+* @remark, the corrupt ts is recoverable, the bytes before the sync byte are
+*       skipped, and the PES of bad packet or codec data is dropped with a
+*       warning, then the ingest continues from the next PES.
+* @example /trunk/research/librtmp/srs_ingest_ts.c
+*
+* @return 0, success; otherswise, the fatal error of system or RTMP, for
+*       example, write to server failed, user should stop the ingest.
+*/
+extern int srs_rtmp_write_ts(srs_rtmp_t rtmp, char* data, int size);
+
 /*************************************************************
 **************************************************************
 * flv codec
@@ -472,7 +631,43 @@ typedef void* srs_flv_t;
 /* open flv file for both read/write. */
 extern srs_flv_t srs_flv_open_read(const char* file);
 extern srs_flv_t srs_flv_open_write(const char* file);
-extern void srs_flv_close(srs_flv_t flv);
+/**
+* open flv file for write with O_DIRECT to bypass the page cache,
+* the tags are written in aligned blocks by the write buffer.
+* @remark use the page cache when O_DIRECT not supported.
+*/
+extern srs_flv_t srs_flv_open_write_direct(const char* file);
+/**
+* open flv file for write in async mode, the tags are copied to buffers
+* and written by the shared write threads, so the disk stall never
+* blocks the caller, for example, the rtmp recorder.
+* @param max_inflight, the max buffers(64KB each) to write, 
+*       the backpressure when exceed.
+* @param nonblocking, when exceed, whether srs_flv_write_tag fails 
+*       with error srs_flv_is_busy(), otherwise blocks util written.
+* @remark the srs_flv_close waits for all buffers written.
+* @remark use sync writer for windows.
+*/
+extern srs_flv_t srs_flv_open_write_async(const char* file, int max_inflight, srs_bool nonblocking);
+/**
+* get the inflight buffers of async writer, to detect the disk stall.
+* @return the count of buffers, 0 for sync writer.
+*/
+extern int srs_flv_write_inflight(srs_flv_t flv);
+/**
+* close the flv file, write the buffered tags for writer.
+* @return the error of writing the buffered tags, 0 for reader.
+* @remark the flv is always free, even if error.
+*/
+extern int srs_flv_close(srs_flv_t flv);
+/**
+* open flv file for read in mmap mode, the whole file is mapped to memory,
+* user can read the tag data without copy by srs_flv_read_tag_view().
+* @remark the file must fit in the address space, for instance, 
+*       a huge file over 2GB is not supported on 32bits system.
+* @remark not supported on windows, always return NULL.
+*/
+extern srs_flv_t srs_flv_open_mmap(const char* file);
 /**
 * read the flv header. 9bytes header. 
 * @param header, @see E.2 The FLV header, flv_v10_1.pdf in SRS doc.
@@ -509,6 +704,15 @@ extern int srs_flv_read_tag_header(srs_flv_t flv,
 */
 extern int srs_flv_read_tag_data(srs_flv_t flv, char* data, int32_t size);
 /**
+* read the tag data without copy, only for flv opened by srs_flv_open_mmap().
+* drop the 4bytes previous tag size.
+* @param pdata, output the data in the mapped file, user never free it.
+* @param size, the size of data to read, get by srs_flv_read_tag_header().
+* @remark the data is valid until srs_flv_close(), read only.
+* @return ERROR_SYSTEM_IO_INVALID when flv not opened in mmap mode.
+*/
+extern int srs_flv_read_tag_view(srs_flv_t flv, char** pdata, int32_t size);
+/**
 * write the flv header. 9bytes header. 
 * @param header, @see E.2 The FLV header, flv_v10_1.pdf in SRS doc.
 *   3bytes, signature, "FLV",
@@ -536,14 +740,113 @@ extern int srs_flv_write_tag(srs_flv_t flv,
 * @return the size of tag.
 */
 extern int srs_flv_size_tag(int data_size);
+/* write buffer */
+/**
+* the writes are grouped in a write behind buffer, flushed by writev 
+* when the buffer is full, the interval elapsed, seek or close.
+* @param size, the bytes of buffer, 0 to write each tag to file.
+*       default to 64KB.
+* @param interval_ms, flush when elapsed, 0 to flush when full.
+* @return 0, success; otherswise, failed.
+* @remark the interval is checked when write the next tag, there is no
+*       timer, so the buffered tags of an idle stream are not written
+*       util the next tag or srs_flv_close, user should srs_flv_flush
+*       when no tag written for a while, for example, the publisher stopped.
+*/
+extern int srs_flv_set_write_buffer(srs_flv_t flv, int size, int interval_ms);
+/* the policy to sync the written data to disk, default to none. */
+#define SRS_FLV_SYNC_NONE 0
+/* fdatasync after each flush of buffer. */
+#define SRS_FLV_SYNC_FLUSH 1
+/* fdatasync when srs_flv_close. */
+#define SRS_FLV_SYNC_CLOSE 2
+extern int srs_flv_set_write_sync(srs_flv_t flv, int policy);
+/**
+* flush the buffered tags to file.
+* @remark for srs_flv_open_write_direct, the tail unaligned block is
+*       written by disable the O_DIRECT, so the tags after flush use the
+*       page cache, use srs_flv_close to write all tags instead.
+*/
+extern int srs_flv_flush(srs_flv_t flv);
 /* file stream */
 /* file stream tellg to get offset */
 extern int64_t srs_flv_tellg(srs_flv_t flv);
 /* seek file stream, offset is form the start of file */
 extern void srs_flv_lseek(srs_flv_t flv, int64_t offset);
+/* keyframe index */
+/**
+* build the keyframe index of flv file, save to the sidecar index_file.
+* the index is the timestamp and offset of each video keyframe,
+* or audio tag per second when no video.
+* @return 0, success; otherswise, failed.
+*/
+extern int srs_flv_build_index(const char* file, const char* index_file);
+/**
+* load the keyframe index for the flv opened for read,
+* from the sidecar index_file when it matches the flv file size and mtime,
+* or build it by scanning the flv and save to index_file.
+* @param index_file, the sidecar file, NULL to build in memory only.
+* @return 0, success; otherswise, failed.
+*/
+extern int srs_flv_load_index(srs_flv_t flv, const char* index_file);
+/**
+* seek to the keyframe at or before the time, in O(log n) by the index.
+* the next read is the tag header of the keyframe.
+* @param time, the timestamp in ms to seek to.
+* @param ptime, output the timestamp of keyframe, NULL to ignore.
+* @remark user must load the index by srs_flv_load_index() first.
+* @return 0, success; otherswise, failed.
+*/
+extern int srs_flv_seek_keyframe(srs_flv_t flv, u_int32_t time, u_int32_t* ptime);
+/* validation */
+/**
+* scan and validate the flv file by threads, the file is mapped and split 
+* to chunks at the tag boundaries, each scanned by a thread.
+* @param nb_threads, the max threads, 0 to use all cpu cores.
+* @param nb_audios, output the count of audio tags, NULL to ignore.
+* @param nb_videos, output the count of video tags, NULL to ignore.
+* @param nb_keyframes, output the count of video keyframes, NULL to ignore.
+* @param nb_errors, output the count of corrupt tags, NULL to ignore.
+* @param nb_jumps, output the count of timestamp jump backward, NULL to ignore.
+* @param duration, output the duration in ms, NULL to ignore.
+* @param video_codec, output the codec id of video, -1 for no video.
+* @param audio_codec, output the sound format of audio, -1 for no audio.
+* @return 0, success; otherswise, failed.
+*/
+extern int srs_flv_scan(const char* file, int nb_threads,
+    int64_t* nb_audios, int64_t* nb_videos, int64_t* nb_keyframes,
+    int64_t* nb_errors, int64_t* nb_jumps, u_int32_t* duration,
+    int* video_codec, int* audio_codec
+);
+/* repair */
+/**
+* repair the flv file in one pass, write to the repaired_file, which
+* resync and drop the corrupt tags, truncate at the last valid tag,
+* drop the tags before the sequence header or keyframe, correct the
+* timestamp to monotonic from 0, and inject the onMetaData with the
+* duration and keyframes for seeking.
+* @param repaired_file, the output file, must not be the input file.
+* @param max_jump_ms, the max forward jump of timestamp in ms to keep,
+*       for example, the pause of publisher, the larger jump is corrupt
+*       and corrected to 10ms. 0 to keep all forward jumps.
+*       the jitter back over 1000ms is always corrected.
+* @param nb_errors, output the count of corrupt regions, NULL to ignore.
+* @param nb_drops, output the count of undecodable tags dropped, NULL to ignore.
+* @param nb_jumps, output the count of timestamps corrected, NULL to ignore.
+* @param duration, output the duration in ms, NULL to ignore.
+* @remark the tags are written to repaired_file.tmp, then the metadata is
+*       prepended when done, the tmp file is removed.
+* @return 0, success; otherswise, failed, the repaired_file and its tmp
+*       file are removed.
+*/
+extern int srs_flv_repair(const char* file, const char* repaired_file, int max_jump_ms,
+    int64_t* nb_errors, int64_t* nb_drops, int64_t* nb_jumps, u_int32_t* duration
+);
 /* error code */
 /* whether the error code indicates EOF */
 extern srs_bool srs_flv_is_eof(int error_code);
+/* whether the error code indicates the async writer is busy, user can drop the tag. */
+extern srs_bool srs_flv_is_busy(int error_code);
 /* media codec */
 /**
 * whether the video body is sequence header 
@@ -558,6 +861,191 @@ extern srs_bool srs_flv_is_sequence_header(char* data, int32_t size);
 */
 extern srs_bool srs_flv_is_keyframe(char* data, int32_t size);
 
+/*************************************************************
+**************************************************************
+* hls muxer
+**************************************************************
+*************************************************************/
+typedef void* srs_hls_t;
+/**
+* open the hls muxer, to segment the flv audio/video to ts files and
+* a rolling m3u8, for example, the m3u8 /data/live.m3u8, the segments
+* are /data/live-0.ts, /data/live-1.ts, ...
+* @param m3u8_file, the path of m3u8, the segments in the same dir.
+* @param fragment_ms, the min duration of segment in ms, the segment is
+*       reaped at the video keyframe, or any audio frame for pure audio.
+* @param window_ms, the max duration of segments in m3u8 in ms.
+* @param cleanup, whether remove the segment files out of window.
+* @remark the ts and m3u8 are written to .tmp then renamed, so the
+*       player never gets a partial file.
+* @return the hls muxer, NULL for error.
+*/
+extern srs_hls_t srs_hls_open(const char* m3u8_file, 
+    int fragment_ms, int window_ms, srs_bool cleanup
+);
+/**
+* enable the low latency hls, each segment is also written in parts,
+* for example, /data/live-0.0.ts, /data/live-0.1.ts, ..., which are
+* listed by EXT-X-PART with the EXT-X-PRELOAD-HINT of next part, and
+* the delta m3u8 with EXT-X-SKIP is written to /data/live_delta.m3u8.
+* @param part_ms, the part target duration in ms, for example, 200-500ms.
+* @remark must be called before any tag written.
+* @return 0, success; otherswise, failed, for example, called after the
+*       tag written.
+*/
+extern int srs_hls_set_part(srs_hls_t hls, int part_ms);
+/**
+* whether fdatasync the ts and m3u8 before rename them, so the renamed
+* file is complete on disk even after the system crash, default to false.
+* @return 0, success; otherswise, failed.
+*/
+extern int srs_hls_set_sync(srs_hls_t hls, srs_bool v);
+/**
+* whether the m3u8 contains the part, for the http server to hold the
+* blocking playlist reload util ready, _HLS_msn=msn&_HLS_part=part.
+* @param part, the index of part in segment, -1 for the whole segment.
+* @remark call in the thread writes the hls.
+*/
+extern srs_bool srs_hls_is_ready(srs_hls_t hls, int msn, int part);
+/**
+* write the flv tag to hls, the script tag is ignored.
+* @param type, the type of tag, SRS_RTMP_TYPE_AUDIO or SRS_RTMP_TYPE_VIDEO.
+* @param time, the dts of tag in ms.
+* @param data, the data of tag, user should free it.
+* @return 0, success; otherswise, failed.
+*/
+extern int srs_hls_write_tag(srs_hls_t hls, 
+    char type, u_int32_t time, char* data, int size
+);
+/**
+* reap the last segment and end the m3u8, then free the muxer.
+* @return 0, success; otherswise, the last segment or m3u8 failed to write,
+*       the muxer is always freed.
+*/
+extern int srs_hls_close(srs_hls_t hls);
+
+/*************************************************************
+**************************************************************
+* fmp4 muxer
+**************************************************************
+*************************************************************/
+typedef void* srs_mp4_t;
+/**
+* open the fragmented mp4 muxer, to mux the flv h.264/h.265 and aac to
+* fmp4 file, for DASH or HLS(CMAF). the init segment is written with
+* the tracks which sequence header got before the first fragment, then
+* each fragment starts at the video keyframe, or any audio for pure audio.
+* @param file, the path of mp4 file.
+* @param fragment_ms, the min duration of fragment in ms.
+* @return the mp4 muxer, NULL for error.
+*/
+extern srs_mp4_t srs_mp4_open(const char* file, int fragment_ms);
+/**
+* write the flv tag to mp4, the script tag is ignored.
+* @param type, the type of tag, SRS_RTMP_TYPE_AUDIO or SRS_RTMP_TYPE_VIDEO.
+* @param time, the dts of tag in ms.
+* @param data, the data of tag, written to mdat without copy.
+* @remark user should never free the data, even if error, the muxer
+*       frees it when the fragment written.
+* @remark the track which sequence header comes after the first fragment
+*       is not in the init segment, the write fails for its tags.
+* @return 0, success; otherswise, failed.
+*/
+extern int srs_mp4_write_tag(srs_mp4_t mp4, 
+    char type, u_int32_t time, char* data, int size
+);
+/**
+* write the last fragment and close the file, then free the muxer.
+* @return 0, success; otherswise, the last fragment or file failed to
+*       write, the muxer is always freed.
+*/
+extern int srs_mp4_close(srs_mp4_t mp4);
+
+/*************************************************************
+**************************************************************
+* udp ts muxer
+**************************************************************
+*************************************************************/
+typedef void* srs_udp_t;
+/**
+* open the udp muxer, to mux the flv audio/video to ts and send to udp
+* unicast or multicast, in datagrams of 7 ts packets, for example, to
+* feed the broadcast playout. the PAT/PMT is repeated every 100ms, and
+* the PCR is written every 40ms, the stream is paced by PCR.
+* @param url, the udp url, for example, udp://239.1.1.1:1234
+* @param ttl, the ttl of multicast, ignored for unicast.
+* @param bitrate, the constant bitrate in bps, the null packets are
+*       stuffed to the bitrate, and the PCR is written inside the long
+*       PES by packets at the bitrate, 0 to send in the bitrate of stream.
+* @remark the stream is delayed 200ms, for the pacing.
+* @remark not supported on windows.
+* @return the udp muxer, NULL for error.
+*/
+extern srs_udp_t srs_udp_open(const char* url, int ttl, int bitrate);
+/**
+* write the flv tag to udp, the script tag is ignored.
+* @param type, the type of tag, SRS_RTMP_TYPE_AUDIO or SRS_RTMP_TYPE_VIDEO.
+* @param time, the dts of tag in ms.
+* @param data, the data of tag, user should free it.
+* @remark block when the stream is faster than realtime.
+* @return 0, success; otherswise, failed.
+*/
+extern int srs_udp_write_tag(srs_udp_t udp, 
+    char type, u_int32_t time, char* data, int size
+);
+/**
+* send the ts queued, then free the muxer.
+* @return the error of sending the queued ts.
+* @remark the udp is always free, even if error.
+*/
+extern int srs_udp_close(srs_udp_t udp);
+
+/*************************************************************
+**************************************************************
+* ts muxer of multiple inputs
+**************************************************************
+*************************************************************/
+typedef void* srs_ts_t;
+/**
+* open the ts muxer of multiple inputs, to mux the flv audio/video of
+* inputs to the tracks of one ts, for example, several rtmp streams in
+* the programs of MPTS, or the audio of languages in one program.
+* the PAT/PMT is repeated every 100ms, and the PCR is written every 40ms.
+* @param url, the path of ts file, or the udp url, for example, 
+*       udp://239.1.1.1:1234, @see srs_udp_open
+* @param bitrate, the constant bitrate in bps, the PCR is written inside
+*       the long PES by packets at the bitrate, and for udp, the null
+*       packets are stuffed to the bitrate, 0 to ignore.
+* @return the ts muxer, NULL for error.
+*/
+extern srs_ts_t srs_ts_open(const char* url, int bitrate);
+/**
+* add a track to ts, the audio or video of an input, which is the
+* elementary stream of pid in the program.
+* @param program, the program number, 1-4094, the pid of PMT is 0x1000+program.
+* @param pid, the pid of elementary stream, 0x10-0xfff.
+* @remark the stream is written to PMT when got the first frame of track.
+* @return the index of track, >= 0; otherwise, failed.
+*/
+extern int srs_ts_add_track(srs_ts_t ts, int program, int pid);
+/**
+* write the flv tag to the track of ts, the script tag is ignored.
+* @param track, the index of track, @see srs_ts_add_track.
+* @param type, the type of tag, SRS_RTMP_TYPE_AUDIO or SRS_RTMP_TYPE_VIDEO.
+* @param time, the dts of tag in ms.
+* @param data, the data of tag, user should free it.
+* @return 0, success; otherswise, failed.
+*/
+extern int srs_ts_write_tag(srs_ts_t ts, int track, 
+    char type, u_int32_t time, char* data, int size
+);
+/**
+* close the ts and free the muxer.
+* @return the error of writing the buffered ts.
+* @remark the ts is always free, even if error.
+*/
+extern int srs_ts_close(srs_ts_t ts);
+
 /*************************************************************
 **************************************************************
 * amf0 codec
@@ -637,6 +1125,33 @@ extern int64_t srs_utils_send_bytes(srs_rtmp_t rtmp);
 */
 extern int64_t srs_utils_recv_bytes(srs_rtmp_t rtmp);
 
+/**
+* get the startup timing of rtmp session, to find which stage dominates
+* the startup latency. all values are the elapsed time in ms from the session
+* start(srs_rtmp_dns_resolve), use the monotonic clock which never jump.
+*
+* @param dns, output the time when dns resolved.
+* @param connect, output the time when tcp connected.
+* @param handshake, output the time when rtmp handshake done.
+* @param connect_app, output the time when connect app done.
+* @param create_stream, output the time when create stream done.
+* @param play_publish, output the time when play or publish done.
+* @param first_audio, output the time when got the first audio packet.
+* @param first_video, output the time when got the first video packet.
+* @param first_keyframe, output the time when got the first video keyframe,
+*       the sequence header is ignored.
+*
+* @return 0, success; otherswise, failed.
+* @remark, -1 when the stage is not done or not measured, for example, the
+*       publish never output create_stream, and the pipelined session never
+*       output connect_app and create_stream.
+*/
+extern int srs_utils_startup_timing(srs_rtmp_t rtmp,
+    int64_t* dns, int64_t* connect, int64_t* handshake,
+    int64_t* connect_app, int64_t* create_stream, int64_t* play_publish,
+    int64_t* first_audio, int64_t* first_video, int64_t* first_keyframe
+);
+
 /**
 * parse the dts and pts by time in header and data in tag,
 * or to parse the RTMP packet by srs_rtmp_read_packet().
@@ -650,7 +1165,7 @@ extern int64_t srs_utils_recv_bytes(srs_rtmp_t rtmp);
 * @return 0, success; otherswise, failed.
 * @remark, the dts always equals to @param time.
 * @remark, the pts=dts for audio or data.
-* @remark, video only support h.264.
+* @remark, video only support h.264 and h.265.
 */
 extern int srs_utils_parse_timestamp(
     u_int32_t time, char type, char* data, int size,
@@ -666,6 +1181,12 @@ extern srs_bool srs_utils_flv_tag_is_audio(char type);
 extern srs_bool srs_utils_flv_tag_is_video(char type);
 extern srs_bool srs_utils_flv_tag_is_av(char type);
 
+/**
+ * calc the crc32 of bytes, the MPEG-2 CRC of ts PSI, polynomial 0x04c11db7,
+ * msb first, initial value 0xffffffff and no final xor.
+ */
+extern u_int32_t srs_utils_crc32(const void* buf, int size);
+
 /**
 * get the CodecID of video tag.
 * Codec Identifier. The following values are defined:
@@ -675,6 +1196,7 @@ extern srs_bool srs_utils_flv_tag_is_av(char type);
 *           5 = On2 VP6 with alpha channel
 *           6 = Screen video version 2
 *           7 = AVC
+*           12 = HEVC, the codec id 12 or the enhanced RTMP 'hvc1'.
 * @return the code id. 0 for error.
 */
 extern char srs_utils_flv_video_codec_id(char* data, int size);
@@ -686,6 +1208,8 @@ extern char srs_utils_flv_video_codec_id(char* data, int size);
 *           1 = AVC NALU
 *           2 = AVC end of sequence (lower level NALU sequence ender is
 *               not required or supported)
+* @remark for the enhanced RTMP hevc, the sequence start is mapped to 0,
+*       the coded frames to 1, and the sequence end to 2.
 * @return the avc packet type. -1(0xff) for error.
 */
 extern char srs_utils_flv_video_avc_packet_type(char* data, int size);
@@ -797,6 +1321,7 @@ extern const char* srs_human_flv_tag_type2string(char type);
 *           VP6Alpha = On2 VP6 with alpha channel
 *           Screen2 = Screen video version 2
 *           H.264 = AVC
+*           H.265 = HEVC
 *           otherwise, "Unknown"
 * @remark user never free the return char*, 
 *   it's static shared const string.
@@ -181,6 +181,60 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
     #undef SRS_PERF_SO_SNDBUF_SIZE
 #endif
 
+/**
+* the read ahead buffer size of file reader, to reduce the read syscalls,
+* for the flv decoder reads the tag header, data and previous tag size one by one.
+* @remark 0 to disable the read ahead buffer.
+*/
+#define SRS_PERF_FILE_READ_BUFFER 131072
+
+/**
+* the write behind buffer size of file writer, to group the small writes
+* of flv/ts/aac/mp3 encoders into one writev syscall.
+* @remark 0 to disable the write behind buffer.
+*/
+#define SRS_PERF_FILE_WRITE_BUFFER 65536
+
+/**
+* the async file writer queues the buffers to the shared write threads,
+* so the disk stall never blocks the caller, for example, the rtmp recorder.
+* the threads of pool to write the files of all async writers.
+* the max inflight buffers of each writer, the backpressure when exceed.
+*/
+#define SRS_PERF_FILE_WRITE_THREADS 2
+#define SRS_PERF_FILE_WRITE_INFLIGHT 16
+
+/**
+* the min bytes of each chunk for the flv scanner threads,
+* the small file is scanned by less threads.
+*/
+#define SRS_PERF_FLV_SCAN_CHUNK 4194304
+
+/**
+* the ts packets of PES to write by one writev, the headers of packets are
+* written to a reused buffer, the payload is sent from message without copy.
+* @remark each packet use 2 iovs, so it must less than IOV_MAX/2.
+*/
+#define SRS_PERF_TS_WRITEV_PACKETS 64
+
+/**
+* the udp ts writer sends 7 ts packets(1316 bytes) in a datagram,
+* the datagrams due are sent by one sendmmsg, at most the batch.
+* the max inflight datagrams of writer, the backpressure when exceed.
+* the delay in ms of the paced stream, to stuff the null packets before
+* the next PCR in time, it should larger than the PCR interval.
+*/
+#define SRS_PERF_TS_UDP_PACKETS 7
+#define SRS_PERF_TS_UDP_BATCH 32
+#define SRS_PERF_TS_UDP_INFLIGHT 1024
+#define SRS_PERF_TS_UDP_DELAY 200
+
+/**
+* the initial window of flv repairer to resync the tags,
+* which grows to the size of the largest tag.
+*/
+#define SRS_PERF_FLV_REPAIR_BUFFER 1048576
+
 /**
  * define the following macro to enable the fast flv encoder.
  * @see https://github.com/ossrs/srs/issues/405
@@ -26,18 +26,158 @@
 #if !defined(SRS_EXPORT_LIBRTMP)
 
 #include <stdlib.h>
+#include <errno.h>
 #include <sstream>
 #include <algorithm>
 using namespace std;
 
+#ifdef __linux__
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/sendfile.h>
+#endif
+
 #include <srs_kernel_error.hpp>
 #include <srs_kernel_log.hpp>
 #include <srs_kernel_utility.hpp>
 #include <srs_kernel_file.hpp>
+#include <srs_kernel_flv.hpp>
+#include <srs_kernel_codec.hpp>
+#include <srs_core_autofree.hpp>
 #include <srs_protocol_json.hpp>
 
 #define SRS_HTTP_DEFAULT_PAGE "index.html"
 
+#ifdef __linux__
+// wait for fd writable, for the nonblocking out fd.
+int srs_sendfile_wait(int fd)
+{
+    int ret = ERROR_SUCCESS;
+    
+    pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLOUT;
+    pfd.revents = 0;
+    
+    int r0 = ::poll(&pfd, 1, (int)(SRS_CONSTS_RTMP_SEND_TIMEOUT_US / 1000));
+    if (r0 == 0) {
+        return ERROR_SOCKET_TIMEOUT;
+    }
+    if (r0 < 0 && errno != EINTR) {
+        return ERROR_SOCKET_WAIT;
+    }
+    
+    return ret;
+}
+
+// splice the file to out fd over pipe, when sendfile not work.
+int srs_sendfile_splice(int out_fd, int in_fd, int64_t offset, int64_t size, int64_t* pnwrite)
+{
+    int ret = ERROR_SUCCESS;
+    
+    int fds[2];
+    if (::pipe(fds) < 0) {
+        return ERROR_HTTP_ZERO_COPY_UNSUPPORTED;
+    }
+    
+    loff_t off = offset;
+    int64_t left = size;
+    // the bytes in pipe, not sent to out fd yet.
+    int64_t inpipe = 0;
+    
+    while (left > 0 || inpipe > 0) {
+        if (left > 0 && inpipe == 0) {
+            ssize_t nb = ::splice(in_fd, &off, fds[1], NULL, (size_t)srs_min(left, (int64_t)1048576), SPLICE_F_MOVE);
+            if (nb < 0 && errno == EINTR) {
+                continue;
+            }
+            if (nb < 0) {
+                ret = (*pnwrite == 0 && errno == EINVAL)? ERROR_HTTP_ZERO_COPY_UNSUPPORTED : ERROR_SYSTEM_FILE_READ;
+                break;
+            }
+            if (nb == 0) {
+                ret = ERROR_SYSTEM_FILE_EOF;
+                break;
+            }
+            left -= nb;
+            inpipe += nb;
+        }
+        
+        ssize_t nb = ::splice(fds[0], NULL, out_fd, NULL, (size_t)inpipe, SPLICE_F_MOVE | SPLICE_F_MORE);
+        if (nb < 0 && errno == EINTR) {
+            continue;
+        }
+        if (nb < 0 && errno == EAGAIN) {
+            if ((ret = srs_sendfile_wait(out_fd)) != ERROR_SUCCESS) {
+                break;
+            }
+            continue;
+        }
+        if (nb < 0) {
+            ret = (*pnwrite == 0 && errno == EINVAL)? ERROR_HTTP_ZERO_COPY_UNSUPPORTED : ERROR_SOCKET_WRITE;
+            break;
+        }
+        inpipe -= nb;
+        *pnwrite += nb;
+    }
+    
+    ::close(fds[0]);
+    ::close(fds[1]);
+    
+    return ret;
+}
+
+int srs_sendfile(int out_fd, int in_fd, int64_t offset, int64_t size, int64_t* pnwrite)
+{
+    int ret = ERROR_SUCCESS;
+    
+    int64_t nwrite = 0;
+    
+    off_t off = (off_t)offset;
+    while (nwrite < size) {
+        ssize_t nb = ::sendfile(out_fd, in_fd, &off, (size_t)srs_min(size - nwrite, (int64_t)0x7ffff000));
+        if (nb < 0 && errno == EINTR) {
+            continue;
+        }
+        if (nb < 0 && errno == EAGAIN) {
+            if ((ret = srs_sendfile_wait(out_fd)) != ERROR_SUCCESS) {
+                break;
+            }
+            continue;
+        }
+        // sendfile not work for the fds, for example, in fd not support mmap.
+        if (nb < 0 && nwrite == 0 && (errno == EINVAL || errno == ENOSYS)) {
+            ret = srs_sendfile_splice(out_fd, in_fd, offset, size, &nwrite);
+            break;
+        }
+        if (nb < 0) {
+            ret = ERROR_SOCKET_WRITE;
+            break;
+        }
+        if (nb == 0) {
+            ret = ERROR_SYSTEM_FILE_EOF;
+            break;
+        }
+        nwrite += nb;
+    }
+    
+    if (pnwrite) {
+        *pnwrite = nwrite;
+    }
+    
+    return ret;
+}
+#else
+int srs_sendfile(int /*out_fd*/, int /*in_fd*/, int64_t /*offset*/, int64_t /*size*/, int64_t* pnwrite)
+{
+    if (pnwrite) {
+        *pnwrite = 0;
+    }
+    return ERROR_HTTP_ZERO_COPY_UNSUPPORTED;
+}
+#endif
+
 // get the status text of code.
 string srs_generate_http_status_text(int status)
 {
@@ -207,6 +347,14 @@ ISrsHttpResponseWriter::~ISrsHttpResponseWriter()
 {
 }
 
+int ISrsHttpResponseWriter::sendfile(int /*fd*/, int64_t /*offset*/, int64_t /*size*/, int64_t* pnwrite)
+{
+    if (pnwrite) {
+        *pnwrite = 0;
+    }
+    return ERROR_HTTP_ZERO_COPY_UNSUPPORTED;
+}
+
 ISrsHttpResponseReader::ISrsHttpResponseReader()
 {
 }
@@ -394,9 +542,9 @@ int SrsHttpFileServer::serve_file(ISrsHttpResponseWriter* w, ISrsHttpMessage* r,
     
     // write body.
     int64_t left = length;
-    if ((ret = copy(w, &fs, r, (int)left)) != ERROR_SUCCESS) {
+    if ((ret = copy(w, &fs, r, left)) != ERROR_SUCCESS) {
         if (!srs_is_client_gracefully_close(ret)) {
-            srs_error("read file=%s size=%d failed, ret=%d", fullpath.c_str(), left, ret);
+            srs_error("read file=%s size=%"PRId64" failed, ret=%d", fullpath.c_str(), left, ret);
         }
         return ret;
     }
@@ -411,7 +559,7 @@ int SrsHttpFileServer::serve_flv_file(ISrsHttpResponseWriter* w, ISrsHttpMessage
         return serve_file(w, r, fullpath);
     }
     
-    int offset = ::atoi(start.c_str());
+    int64_t offset = ::atoll(start.c_str());
     if (offset <= 0) {
         return serve_file(w, r, fullpath);
     }
@@ -429,23 +577,47 @@ int SrsHttpFileServer::serve_mp4_file(ISrsHttpResponseWriter* w, ISrsHttpMessage
     if (range.empty()) {
         range = r->query_get("bytes");
     }
+    // or, use the standard http Range header, for example, Range: bytes=0-1023
+    for (int i = 0; range.empty() && i < r->request_header_count(); i++) {
+        std::string key = r->request_header_key_at(i);
+        std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+        if (key != "range") {
+            continue;
+        }
+        
+        std::string value = r->request_header_value_at(i);
+        if (srs_string_starts_with(value, "bytes=")) {
+            range = value.substr(6);
+        }
+    }
+    
+    // the mp4 always supports range, even serve the whole file.
+    w->header()->set("Accept-Ranges", "bytes");
     
-    // rollback to serve whole file.
+    // rollback to serve whole file, 
+    // and the multiple ranges are not supported, serve whole file.
     size_t pos = string::npos;
-    if (range.empty() || (pos = range.find("-")) == string::npos) {
+    if (range.empty() || (pos = range.find("-")) == string::npos || range.find(",") != string::npos) {
         return serve_file(w, r, fullpath);
     }
     
-    // parse the start in query string
-    int start = 0;
-    if (pos > 0) {
-        start = ::atoi(range.substr(0, pos).c_str());
+    // the suffix range, the last bytes of file, for example, bytes=-500,
+    // @see RFC7233, 2.1 Byte Ranges.
+    if (pos == 0) {
+        int64_t suffix = ::atoll(range.substr(1).c_str());
+        if (suffix < 0) {
+            return serve_file(w, r, fullpath);
+        }
+        return serve_mp4_stream(w, r, fullpath, -1, suffix);
     }
     
+    // parse the start in query string
+    int64_t start = ::atoll(range.substr(0, pos).c_str());
+    
     // parse end in query string.
-    int end = -1;
+    int64_t end = -1;
     if (pos < range.length() - 1) {
-        end = ::atoi(range.substr(pos + 1).c_str());
+        end = ::atoll(range.substr(pos + 1).c_str());
     }
     
     // invalid param, serve as whole mp4 file.
@@ -456,26 +628,212 @@ int SrsHttpFileServer::serve_mp4_file(ISrsHttpResponseWriter* w, ISrsHttpMessage
     return serve_mp4_stream(w, r, fullpath, start, end);
 }
 
-int SrsHttpFileServer::serve_flv_stream(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, string fullpath, int offset)
+int SrsHttpFileServer::serve_flv_stream(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, string fullpath, int64_t offset)
 {
-    return serve_file(w, r, fullpath);
+    int ret = ERROR_SUCCESS;
+    
+    SrsFileReader fs;
+    
+    // open flv file
+    if ((ret = fs.open(fullpath)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    if (offset > fs.filesize()) {
+        ret = ERROR_HTTP_REMUX_OFFSET_OVERFLOW;
+        srs_warn("http flv streaming %s overflow. size=%"PRId64", offset=%"PRId64", ret=%d",
+            fullpath.c_str(), fs.filesize(), offset, ret);
+        return ret;
+    }
+    
+    SrsFlvVodStreamDecoder ffd;
+    
+    // open fast decoder
+    if ((ret = ffd.initialize(&fs)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // save header, send later.
+    char flv_header[13];
+    
+    // send flv header
+    if ((ret = ffd.read_header_ext(flv_header)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // save sequence header, send later
+    int64_t sh_start = 0;
+    int sh_size = 0;
+    if ((ret = ffd.read_sequence_header_summary(&sh_start, &sh_size)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    if (sh_size <= 0) {
+        srs_warn("http flv streaming %s no sequence header, serve whole file.", fullpath.c_str());
+        return serve_file(w, r, fullpath);
+    }
+    
+    char* sh_data = new char[sh_size];
+    SrsAutoFreeA(char, sh_data);
+    if ((ret = fs.read(sh_data, sh_size, NULL)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // the summary is the first audio and video tags, 
+    // serve whole file when none of them is sequence header.
+    bool has_sequence_header = false;
+    for (int pos = 0; pos + SRS_FLV_TAG_HEADER_SIZE <= sh_size;) {
+        char* tag = sh_data + pos;
+        int size = ((u_int8_t)tag[1] << 16) | ((u_int8_t)tag[2] << 8) | (u_int8_t)tag[3];
+        if (pos + SRS_FLV_TAG_HEADER_SIZE + size > sh_size) {
+            break;
+        }
+        
+        char* body = tag + SRS_FLV_TAG_HEADER_SIZE;
+        if ((tag[0] == 0x09 && SrsFlvCodec::video_is_sequence_header(body, size))
+            || (tag[0] == 0x08 && SrsFlvCodec::audio_is_sequence_header(body, size))
+        ) {
+            has_sequence_header = true;
+        }
+        pos += SRS_FLV_TAG_HEADER_SIZE + size + SRS_FLV_PREVIOUS_TAG_SIZE;
+    }
+    if (!has_sequence_header) {
+        srs_warn("http flv streaming %s no sequence header, serve whole file.", fullpath.c_str());
+        return serve_file(w, r, fullpath);
+    }
+    
+    // the offset must not fall into the header or sequence headers,
+    // which are always prepended to the response.
+    if (offset < sh_start + sh_size) {
+        offset = sh_start + sh_size;
+    }
+    
+    // seek to data offset
+    int64_t left = fs.filesize() - offset;
+    
+    // write http header for flv.
+    w->header()->set_content_length(sizeof(flv_header) + sh_size + left);
+    w->header()->set_content_type("video/x-flv");
+    
+    // write flv header and sequence header.
+    if ((ret = w->write(flv_header, sizeof(flv_header))) != ERROR_SUCCESS) {
+        return ret;
+    }
+    if ((ret = w->write(sh_data, sh_size)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // write body.
+    if ((ret = ffd.lseek(offset)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // send data
+    if ((ret = copy(w, &fs, r, left)) != ERROR_SUCCESS) {
+        if (!srs_is_client_gracefully_close(ret)) {
+            srs_error("read flv=%s size=%"PRId64" failed, ret=%d", fullpath.c_str(), left, ret);
+        }
+        return ret;
+    }
+    
+    return w->final_request();
 }
 
-int SrsHttpFileServer::serve_mp4_stream(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, string fullpath, int start, int end)
+int SrsHttpFileServer::serve_mp4_stream(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, string fullpath, int64_t start, int64_t end)
 {
-    return serve_file(w, r, fullpath);
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(start >= -1);
+    srs_assert(end == -1 || end >= 0);
+    
+    SrsFileReader fs;
+    
+    // open mp4 file
+    if ((ret = fs.open(fullpath)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    int64_t filesize = fs.filesize();
+    
+    // the suffix range of the last end bytes, the bytes=-0 is unsatisfiable.
+    if (start == -1) {
+        if (end == 0) {
+            start = filesize;
+        } else {
+            start = srs_max((int64_t)0, filesize - end);
+        }
+        end = -1;
+    }
+    
+    // parse -1 to whole file, the end is inclusive.
+    if (end == -1 || end >= filesize) {
+        end = filesize - 1;
+    }
+    
+    if (start > end) {
+        srs_warn("http mp4 streaming %s overflow. size=%"PRId64", start=%"PRId64", end=%"PRId64,
+            fullpath.c_str(), filesize, start, end);
+        
+        std::stringstream content_range;
+        content_range << "bytes */" << filesize;
+        w->header()->set("Content-Range", content_range.str());
+        
+        return srs_go_http_error(w, SRS_CONSTS_HTTP_RequestedRangeNotSatisfiable);
+    }
+    
+    // seek to data offset, [start, end] for range.
+    int64_t left = end - start + 1;
+    
+    // write http header for mp4.
+    w->header()->set_content_length(left);
+    w->header()->set_content_type("video/mp4");
+    w->header()->set("Accept-Ranges", "bytes");
+    
+    // response the content range header.
+    std::stringstream content_range;
+    content_range << "bytes " << start << "-" << end << "/" << filesize;
+    w->header()->set("Content-Range", content_range.str());
+    
+    w->write_header(SRS_CONSTS_HTTP_PartialContent);
+    
+    // write body.
+    fs.lseek(start);
+    
+    // send data
+    if ((ret = copy(w, &fs, r, left)) != ERROR_SUCCESS) {
+        if (!srs_is_client_gracefully_close(ret)) {
+            srs_error("read mp4=%s size=%"PRId64" failed, ret=%d", fullpath.c_str(), left, ret);
+        }
+        return ret;
+    }
+    
+    return w->final_request();
 }
 
-int SrsHttpFileServer::copy(ISrsHttpResponseWriter* w, SrsFileReader* fs, ISrsHttpMessage* r, int size)
+int SrsHttpFileServer::copy(ISrsHttpResponseWriter* w, SrsFileReader* fs, ISrsHttpMessage* r, int64_t size)
 {
     int ret = ERROR_SUCCESS;
     
-    int left = size;
+    // try zero copy from the fd, then fallback to read and write.
+    if (size > 0) {
+        int64_t pos = fs->tellg();
+        int64_t nwrite = 0;
+        ret = w->sendfile(fs->get_fd(), pos, size, &nwrite);
+        if (ret == ERROR_SUCCESS) {
+            fs->lseek(pos + size);
+            return ret;
+        }
+        if (ret != ERROR_HTTP_ZERO_COPY_UNSUPPORTED || nwrite > 0) {
+            return ret;
+        }
+        ret = ERROR_SUCCESS;
+    }
+    
+    int64_t left = size;
     char* buf = r->http_ts_send_buffer();
     
     while (left > 0) {
         ssize_t nread = -1;
-        int max_read = srs_min(left, SRS_HTTP_TS_SEND_BUFFER_SIZE);
+        int max_read = (int)srs_min(left, (int64_t)SRS_HTTP_TS_SEND_BUFFER_SIZE);
         if ((ret = fs->read(buf, max_read, &nread)) != ERROR_SUCCESS) {
             break;
         }
@@ -83,6 +83,15 @@ class ISrsHttpResponseWriter;
 extern int srs_go_http_error(ISrsHttpResponseWriter* w, int code);
 extern int srs_go_http_error(ISrsHttpResponseWriter* w, int code, std::string error);
 
+/**
+ * send the file bytes [offset, offset + size) of in_fd to out_fd by sendfile,
+ * or by splice when sendfile not work, without copy to user space.
+ * @param pnwrite the output nb_write, NULL to ignore.
+ * @remark wait for out_fd writable when it's nonblocking.
+ * @return ERROR_HTTP_ZERO_COPY_UNSUPPORTED when not supported by system.
+ */
+extern int srs_sendfile(int out_fd, int in_fd, int64_t offset, int64_t size, int64_t* pnwrite);
+
 // get the status text of code.
 extern std::string srs_generate_http_status_text(int status);
 
@@ -210,6 +219,18 @@ public:
     // send error codes.
     // @remark, user must set header then write or write_header.
     virtual void write_header(int code) = 0;
+    
+    /**
+     * write the file bytes [offset, offset + size) from fd to peer without
+     * copy to user space, for example, by sendfile or splice.
+     * the header is sent before the bytes when not sent yet.
+     * @param pnwrite the output nb_write, NULL to ignore.
+     * @return ERROR_HTTP_ZERO_COPY_UNSUPPORTED when the writer not support
+     *       zero copy, user should use write instead.
+     * @remark the default implements is not supported, the writer over
+     *       socket can use srs_sendfile to implement it.
+     */
+    virtual int sendfile(int fd, int64_t offset, int64_t size, int64_t* pnwrite);
 };
 
 /**
@@ -306,20 +327,24 @@ private:
 protected:
     /**
      * when access flv file with x.flv?start=xxx
+     * the flv header and sequence headers are prepended to the data from offset.
+     * @remark serve the whole file when no sequence header in flv.
      */
-    virtual int serve_flv_stream(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath, int offset);
+    virtual int serve_flv_stream(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath, int64_t offset);
     /**
-     * when access mp4 file with x.mp4?range=start-end
-     * @param start the start offset in bytes.
-     * @param end the end offset in bytes. -1 to end of file.
+     * when access mp4 file with x.mp4?range=start-end or the Range header,
+     * response 206 Partial Content with the Content-Range header.
+     * @param start the start offset in bytes, -1 for the suffix range.
+     * @param end the end offset in bytes. -1 to end of file,
+     *       or the length of the last bytes for the suffix range.
      * @remark response data in [start, end].
      */
-    virtual int serve_mp4_stream(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath, int start, int end);
+    virtual int serve_mp4_stream(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath, int64_t start, int64_t end);
 protected:
     /**
      * copy the fs to response writer in size bytes.
      */
-    virtual int copy(ISrsHttpResponseWriter* w, SrsFileReader* fs, ISrsHttpMessage* r, int size);
+    virtual int copy(ISrsHttpResponseWriter* w, SrsFileReader* fs, ISrsHttpMessage* r, int64_t size);
 };
 
 // the mux entry for server mux.
@@ -38,6 +38,8 @@ string srs_codec_video2str(SrsCodecVideo codec)
     switch (codec) {
         case SrsCodecVideoAVC: 
             return "H264";
+        case SrsCodecVideoHEVC:
+            return "H265";
         case SrsCodecVideoOn2VP6:
         case SrsCodecVideoOn2VP6WithAlphaChannel:
             return "VP6";
@@ -197,15 +199,26 @@ bool SrsFlvCodec::video_is_keyframe(char* data, int size)
     }
 
     char frame_type = data[0];
-    frame_type = (frame_type >> 4) & 0x0F;
+    if (frame_type & SRS_FLV_VIDEO_EX_HEADER) {
+        frame_type = (frame_type >> 4) & 0x07;
+    } else {
+        frame_type = (frame_type >> 4) & 0x0F;
+    }
     
     return frame_type == SrsCodecVideoAVCFrameKeyFrame;
 }
 
 bool SrsFlvCodec::video_is_sequence_header(char* data, int size)
 {
-    // sequence header only for h264
-    if (!video_is_h264(data, size)) {
+    // for the enhanced RTMP hevc, the packet type is in the first byte.
+    if (video_is_hevc(data, size) && (data[0] & SRS_FLV_VIDEO_EX_HEADER)) {
+        char packet_type = data[0] & 0x0F;
+        return video_is_keyframe(data, size)
+            && packet_type == SrsCodecVideoExPacketTypeSequenceStart;
+    }
+    
+    // sequence header only for h264 and the hevc in codec id 12.
+    if (!video_is_h264(data, size) && !video_is_hevc(data, size)) {
         return false;
     }
     
@@ -248,11 +261,40 @@ bool SrsFlvCodec::video_is_h264(char* data, int size)
     }
 
     char codec_id = data[0];
+    if (codec_id & SRS_FLV_VIDEO_EX_HEADER) {
+        return false;
+    }
     codec_id = codec_id & 0x0F;
     
     return codec_id == SrsCodecVideoAVC;
 }
 
+bool SrsFlvCodec::video_is_hevc(char* data, int size)
+{
+    // 1bytes required.
+    if (size < 1) {
+        return false;
+    }
+    
+    // the enhanced RTMP, 1bytes header and 4bytes FourCC.
+    if (data[0] & SRS_FLV_VIDEO_EX_HEADER) {
+        if (size < 5) {
+            return false;
+        }
+        
+        SrsStream stream;
+        if (stream.initialize(data + 1, 4) != ERROR_SUCCESS) {
+            return false;
+        }
+        return stream.read_4bytes() == SRS_FLV_VIDEO_FOURCC_HEVC;
+    }
+    
+    char codec_id = data[0];
+    codec_id = codec_id & 0x0F;
+    
+    return codec_id == SrsCodecVideoHEVC;
+}
+
 bool SrsFlvCodec::audio_is_aac(char* data, int size)
 {
     // 1bytes required.
@@ -275,13 +317,22 @@ bool SrsFlvCodec::video_is_acceptable(char* data, int size)
     
     char frame_type = data[0];
     char codec_id = frame_type & 0x0f;
+    
+    // the enhanced RTMP, only hevc is supported.
+    if (frame_type & SRS_FLV_VIDEO_EX_HEADER) {
+        frame_type = (frame_type >> 4) & 0x07;
+        if (frame_type < 1 || frame_type > 5) {
+            return false;
+        }
+        return video_is_hevc(data, size);
+    }
     frame_type = (frame_type >> 4) & 0x0f;
     
     if (frame_type < 1 || frame_type > 5) {
         return false;
     }
     
-    if (codec_id < 2 || codec_id > 7) {
+    if ((codec_id < 2 || codec_id > 7) && codec_id != SrsCodecVideoHEVC) {
         return false;
     }
     
@@ -312,6 +363,165 @@ string srs_codec_avc_nalu2str(SrsAvcNaluType nalu_type)
     }
 }
 
+string srs_codec_hevc_nalu2str(SrsHevcNaluType nalu_type)
+{
+    switch (nalu_type) {
+        case SrsHevcNaluTypeCodedSliceTrailN: return "TrailN";
+        case SrsHevcNaluTypeCodedSliceTrailR: return "TrailR";
+        case SrsHevcNaluTypeCodedSliceBLA: return "BLA";
+        case SrsHevcNaluTypeCodedSliceBLANoLeading: return "BLANoLeading";
+        case SrsHevcNaluTypeCodedSliceIDR: return "IDR";
+        case SrsHevcNaluTypeCodedSliceIDRNoLeading: return "IDRNoLeading";
+        case SrsHevcNaluTypeCodedSliceCRA: return "CRA";
+        case SrsHevcNaluTypeVPS: return "VPS";
+        case SrsHevcNaluTypeSPS: return "SPS";
+        case SrsHevcNaluTypePPS: return "PPS";
+        case SrsHevcNaluTypeAccessUnitDelimiter: return "AccessUnitDelimiter";
+        case SrsHevcNaluTypePrefixSEI: return "PrefixSEI";
+        case SrsHevcNaluTypeSuffixSEI: return "SuffixSEI";
+        default: return "Other";
+    }
+}
+
+int srs_hevc_demux_sps(char* frame, int nb_frame, SrsHevcSps* sps)
+{
+    int ret = ERROR_SUCCESS;
+    
+    // 7.3.1.2 NAL unit header syntax, 2bytes.
+    // H.265-HEVC-ITU-T-REC-H.265-201304.pdf, page 31.
+    if (nb_frame < 2 || ((frame[0] >> 1) & 0x3f) != SrsHevcNaluTypeSPS) {
+        ret = ERROR_HEVC_DECODE_ERROR;
+        srs_error("hevc sps nal_unit_type shall be 33. ret=%d", ret);
+        return ret;
+    }
+    
+    // decode the rbsp from sps.
+    // XX 00 00 03 XX, the 03 byte is emulation_prevention_three_byte, drop it.
+    char* rbsp = new char[nb_frame];
+    SrsAutoFreeA(char, rbsp);
+    
+    int nb_rbsp = 0;
+    int nb_zeros = 0;
+    for (int i = 2; i < nb_frame; i++) {
+        if (nb_zeros == 2 && frame[i] == 0x03) {
+            nb_zeros = 0;
+            continue;
+        }
+        rbsp[nb_rbsp++] = frame[i];
+        nb_zeros = frame[i]? 0 : nb_zeros + 1;
+    }
+    
+    SrsStream stream;
+    if ((ret = stream.initialize(rbsp, nb_rbsp)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // 7.3.2.2 Sequence parameter set RBSP syntax, 1byte
+    // H.265-HEVC-ITU-T-REC-H.265-201304.pdf, page 33.
+    //      sps_video_parameter_set_id u(4)
+    //      sps_max_sub_layers_minus1 u(3)
+    //      sps_temporal_id_nesting_flag u(1)
+    // 7.3.3 Profile, tier and level syntax, 12bytes for general.
+    // H.265-HEVC-ITU-T-REC-H.265-201304.pdf, page 36.
+    if (!stream.require(13)) {
+        ret = ERROR_HEVC_DECODE_ERROR;
+        srs_error("hevc sps profile_tier_level required 13bytes. ret=%d", ret);
+        return ret;
+    }
+    int8_t v = stream.read_1bytes();
+    sps->sps_max_sub_layers_minus1 = (v >> 1) & 0x07;
+    sps->sps_temporal_id_nesting_flag = v & 0x01;
+    
+    v = stream.read_1bytes();
+    sps->general_profile_space = (v >> 6) & 0x03;
+    sps->general_tier_flag = (v >> 5) & 0x01;
+    sps->general_profile_idc = v & 0x1f;
+    sps->general_profile_compatibility_flags = (u_int32_t)stream.read_4bytes();
+    sps->general_constraint_indicator_flags = (int64_t)(u_int32_t)stream.read_4bytes() << 16;
+    sps->general_constraint_indicator_flags |= (u_int16_t)stream.read_2bytes();
+    sps->general_level_idc = stream.read_1bytes();
+    
+    // the sub layers, 2bits present flags for each of the 8 layers,
+    // then the profile of 88bits and the level of 8bits when present.
+    if (sps->sps_max_sub_layers_minus1 > 0) {
+        if (!stream.require(2)) {
+            ret = ERROR_HEVC_DECODE_ERROR;
+            srs_error("hevc sps sub layer flags required 2bytes. ret=%d", ret);
+            return ret;
+        }
+        u_int16_t flags = (u_int16_t)stream.read_2bytes();
+        
+        for (int i = 0; i < sps->sps_max_sub_layers_minus1; i++) {
+            int nb_skip = 0;
+            if ((flags >> (15 - 2 * i)) & 0x01) {
+                nb_skip += 11;
+            }
+            if ((flags >> (14 - 2 * i)) & 0x01) {
+                nb_skip += 1;
+            }
+            
+            if (!stream.require(nb_skip)) {
+                ret = ERROR_HEVC_DECODE_ERROR;
+                srs_error("hevc sps sub layer %d required %dbytes. ret=%d", i, nb_skip, ret);
+                return ret;
+            }
+            stream.skip(nb_skip);
+        }
+    }
+    
+    SrsBitStream bs;
+    if ((ret = bs.initialize(&stream)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    int32_t sps_seq_parameter_set_id = -1;
+    if ((ret = srs_avc_nalu_read_uev(&bs, sps_seq_parameter_set_id)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    if ((ret = srs_avc_nalu_read_uev(&bs, sps->chroma_format_idc)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    if (sps->chroma_format_idc == 3) {
+        int8_t separate_colour_plane_flag = -1;
+        if ((ret = srs_avc_nalu_read_bit(&bs, separate_colour_plane_flag)) != ERROR_SUCCESS) {
+            return ret;
+        }
+    }
+    
+    if ((ret = srs_avc_nalu_read_uev(&bs, sps->pic_width_in_luma_samples)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    if ((ret = srs_avc_nalu_read_uev(&bs, sps->pic_height_in_luma_samples)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    int8_t conformance_window_flag = -1;
+    if ((ret = srs_avc_nalu_read_bit(&bs, conformance_window_flag)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    if (conformance_window_flag) {
+        // conf_win_left/right/top/bottom_offset
+        for (int i = 0; i < 4; i++) {
+            int32_t conf_win_offset = -1;
+            if ((ret = srs_avc_nalu_read_uev(&bs, conf_win_offset)) != ERROR_SUCCESS) {
+                return ret;
+            }
+        }
+    }
+    
+    if ((ret = srs_avc_nalu_read_uev(&bs, sps->bit_depth_luma_minus8)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    if ((ret = srs_avc_nalu_read_uev(&bs, sps->bit_depth_chroma_minus8)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    srs_info("hevc sps parse profile=%d, level=%d, sps_id=%d, %dx%d", sps->general_profile_idc,
+        sps->general_level_idc, sps_seq_parameter_set_id, sps->pic_width_in_luma_samples, sps->pic_height_in_luma_samples);
+    
+    return ret;
+}
+
 SrsCodecSampleUnit::SrsCodecSampleUnit()
 {
     size = 0;
@@ -337,6 +547,7 @@ void SrsCodecSample::clear()
     nb_sample_units = 0;
 
     cts = 0;
+    vcodec = SrsCodecVideoReserved;
     frame_type = SrsCodecVideoAVCFrameReserved;
     avc_packet_type = SrsCodecVideoAVCTypeReserved;
     has_idr = false;
@@ -364,6 +575,17 @@ int SrsCodecSample::add_sample_unit(char* bytes, int size)
     sample_unit->bytes = bytes;
     sample_unit->size = size;
     
+    // for hevc, the IRAP(BLA/IDR/CRA) is the random access point.
+    if (is_video && vcodec == SrsCodecVideoHEVC) {
+        SrsHevcNaluType nal_unit_type = (SrsHevcNaluType)((bytes[0] >> 1) & 0x3f);
+        
+        if (nal_unit_type >= SrsHevcNaluTypeCodedSliceBLA && nal_unit_type <= SrsHevcNaluTypeReservedIRAP23) {
+            has_idr = true;
+        }
+        
+        return ret;
+    }
+    
     // for video, parse the nalu type, set the IDR flag.
     if (is_video) {
         SrsAvcNaluType nal_unit_type = (SrsAvcNaluType)(bytes[0] & 0x1f);
@@ -412,6 +634,8 @@ SrsAvcAacCodec::SrsAvcAacCodec()
     sequenceParameterSetNALUnit = NULL;
     pictureParameterSetLength   = 0;
     pictureParameterSetNALUnit  = NULL;
+    videoParameterSetLength     = 0;
+    videoParameterSetNALUnit    = NULL;
 
     payload_format = SrsAvcPayloadFormatGuess;
     stream = new SrsStream();
@@ -425,6 +649,7 @@ SrsAvcAacCodec::~SrsAvcAacCodec()
     srs_freep(stream);
     srs_freepa(sequenceParameterSetNALUnit);
     srs_freepa(pictureParameterSetNALUnit);
+    srs_freepa(videoParameterSetNALUnit);
 }
 
 bool SrsAvcAacCodec::is_avc_codec_ok()
@@ -656,7 +881,17 @@ int SrsAvcAacCodec::video_avc_demux(char* data, int size, SrsCodecSample* sample
     // @see: E.4.3 Video Tags, video_file_format_spec_v10_1.pdf, page 78
     int8_t frame_type = stream->read_1bytes();
     int8_t codec_id = frame_type & 0x0f;
-    frame_type = (frame_type >> 4) & 0x0f;
+    
+    // for the enhanced RTMP, the low 4bits is the packet type,
+    // and the codec is specified by the FourCC.
+    // @see https://github.com/veovera/enhanced-rtmp
+    bool is_ex_header = (frame_type & SRS_FLV_VIDEO_EX_HEADER) != 0;
+    int8_t ex_packet_type = codec_id;
+    if (is_ex_header) {
+        frame_type = (frame_type >> 4) & 0x07;
+    } else {
+        frame_type = (frame_type >> 4) & 0x0f;
+    }
     
     sample->frame_type = (SrsCodecVideoAVCFrame)frame_type;
     
@@ -667,27 +902,72 @@ int SrsAvcAacCodec::video_avc_demux(char* data, int size, SrsCodecSample* sample
         return ret;
     }
     
-    // only support h.264/avc
-    if (codec_id != SrsCodecVideoAVC) {
-        ret = ERROR_HLS_DECODE_ERROR;
-        srs_error("avc only support video h.264/avc codec. actual=%d, ret=%d", codec_id, ret);
-        return ret;
+    if (is_ex_header) {
+        if (!stream->require(4)) {
+            ret = ERROR_HLS_DECODE_ERROR;
+            srs_error("avc decode fourcc failed. ret=%d", ret);
+            return ret;
+        }
+        int32_t fourcc = stream->read_4bytes();
+        if (fourcc != SRS_FLV_VIDEO_FOURCC_HEVC) {
+            ret = ERROR_HEVC_DECODE_ERROR;
+            srs_error("avc only support enhanced hevc. fourcc=%#x, ret=%d", fourcc, ret);
+            return ret;
+        }
+        codec_id = SrsCodecVideoHEVC;
     }
-    video_codec_id = codec_id;
     
-    if (!stream->require(4)) {
+    // only support h.264/avc and h.265/hevc
+    if (codec_id != SrsCodecVideoAVC && codec_id != SrsCodecVideoHEVC) {
         ret = ERROR_HLS_DECODE_ERROR;
-        srs_error("avc decode avc_packet_type failed. ret=%d", ret);
+        srs_error("avc only support video h.264/avc or h.265/hevc codec. actual=%d, ret=%d", codec_id, ret);
         return ret;
     }
-    int8_t avc_packet_type = stream->read_1bytes();
-    int32_t composition_time = stream->read_3bytes();
+    video_codec_id = codec_id;
+    sample->vcodec = (SrsCodecVideo)codec_id;
+    
+    int8_t avc_packet_type = SrsCodecVideoAVCTypeReserved;
+    int32_t composition_time = 0;
+    if (is_ex_header) {
+        // map the enhanced packet type to avc packet type,
+        // only the coded frames carry the composition time.
+        if (ex_packet_type == SrsCodecVideoExPacketTypeSequenceStart) {
+            avc_packet_type = SrsCodecVideoAVCTypeSequenceHeader;
+        } else if (ex_packet_type == SrsCodecVideoExPacketTypeCodedFrames
+            || ex_packet_type == SrsCodecVideoExPacketTypeCodedFramesX
+        ) {
+            avc_packet_type = SrsCodecVideoAVCTypeNALU;
+        } else if (ex_packet_type == SrsCodecVideoExPacketTypeSequenceEnd) {
+            avc_packet_type = SrsCodecVideoAVCTypeSequenceHeaderEOF;
+        }
+        
+        if (ex_packet_type == SrsCodecVideoExPacketTypeCodedFrames) {
+            if (!stream->require(3)) {
+                ret = ERROR_HLS_DECODE_ERROR;
+                srs_error("avc decode composition_time failed. ret=%d", ret);
+                return ret;
+            }
+            composition_time = stream->read_3bytes();
+        }
+    } else {
+        if (!stream->require(4)) {
+            ret = ERROR_HLS_DECODE_ERROR;
+            srs_error("avc decode avc_packet_type failed. ret=%d", ret);
+            return ret;
+        }
+        avc_packet_type = stream->read_1bytes();
+        composition_time = stream->read_3bytes();
+    }
     
     // pts = dts + cts.
     sample->cts = composition_time;
     sample->avc_packet_type = (SrsCodecVideoAVCType)avc_packet_type;
     
-    if (avc_packet_type == SrsCodecVideoAVCTypeSequenceHeader) {
+    if (avc_packet_type == SrsCodecVideoAVCTypeSequenceHeader && codec_id == SrsCodecVideoHEVC) {
+        if ((ret = hevc_demux_vps_sps_pps(stream)) != ERROR_SUCCESS) {
+            return ret;
+        }
+    } else if (avc_packet_type == SrsCodecVideoAVCTypeSequenceHeader) {
         if ((ret = avc_demux_sps_pps(stream)) != ERROR_SUCCESS) {
             return ret;
         }
@@ -862,6 +1142,110 @@ int SrsAvcAacCodec::avc_demux_sps_pps(SrsStream* stream)
     return avc_demux_sps();
 }
 
+int SrsAvcAacCodec::hevc_demux_vps_sps_pps(SrsStream* stream)
+{
+    int ret = ERROR_SUCCESS;
+    
+    // HEVCDecoderConfigurationRecord
+    // 8.3.3.1.2 Syntax, ISO_IEC_14496-15-2014.pdf, page 55
+    avc_extra_size = stream->size() - stream->pos();
+    if (avc_extra_size > 0) {
+        srs_freepa(avc_extra_data);
+        avc_extra_data = new char[avc_extra_size];
+        memcpy(avc_extra_data, stream->data() + stream->pos(), avc_extra_size);
+    }
+    
+    // 22bytes from configurationVersion to lengthSizeMinusOne,
+    // then 1byte numOfArrays.
+    if (!stream->require(23)) {
+        ret = ERROR_HEVC_DECODE_ERROR;
+        srs_error("hevc decode sequenc header failed. ret=%d", ret);
+        return ret;
+    }
+    stream->skip(21);
+    
+    // parse the NALU size.
+    int8_t lengthSizeMinusOne = stream->read_1bytes();
+    lengthSizeMinusOne &= 0x03;
+    NAL_unit_length = lengthSizeMinusOne;
+    
+    // the same as avc, the value of this field shall be one of 0, 1, or 3.
+    if (NAL_unit_length == 2) {
+        ret = ERROR_HEVC_DECODE_ERROR;
+        srs_error("hevc lengthSizeMinusOne should never be 2. ret=%d", ret);
+        return ret;
+    }
+    
+    // the parameter sets of the previous sequence header.
+    videoParameterSetLength = sequenceParameterSetLength = pictureParameterSetLength = 0;
+    
+    // each array is array_completeness(1bit), reserved(1bit), NAL_unit_type(6bits),
+    // numNalus(2B), then each NALU is nalUnitLength(2B) and nalUnit.
+    u_int8_t numOfArrays = stream->read_1bytes();
+    for (int i = 0; i < numOfArrays; i++) {
+        if (!stream->require(3)) {
+            ret = ERROR_HEVC_DECODE_ERROR;
+            srs_error("hevc decode sequenc header array failed. ret=%d", ret);
+            return ret;
+        }
+        SrsHevcNaluType nal_unit_type = (SrsHevcNaluType)(stream->read_1bytes() & 0x3f);
+        u_int16_t numNalus = stream->read_2bytes();
+        
+        for (int j = 0; j < numNalus; j++) {
+            if (!stream->require(2)) {
+                ret = ERROR_HEVC_DECODE_ERROR;
+                srs_error("hevc decode sequenc header nalu size failed. ret=%d", ret);
+                return ret;
+            }
+            u_int16_t nalUnitLength = stream->read_2bytes();
+            if (!stream->require(nalUnitLength)) {
+                ret = ERROR_HEVC_DECODE_ERROR;
+                srs_error("hevc decode sequenc header nalu data failed. ret=%d", ret);
+                return ret;
+            }
+            
+            // only use the first vps, sps and pps.
+            u_int16_t* pnb = NULL;
+            char** pnalu = NULL;
+            if (nal_unit_type == SrsHevcNaluTypeVPS) {
+                pnb = &videoParameterSetLength;
+                pnalu = &videoParameterSetNALUnit;
+            } else if (nal_unit_type == SrsHevcNaluTypeSPS) {
+                pnb = &sequenceParameterSetLength;
+                pnalu = &sequenceParameterSetNALUnit;
+            } else if (nal_unit_type == SrsHevcNaluTypePPS) {
+                pnb = &pictureParameterSetLength;
+                pnalu = &pictureParameterSetNALUnit;
+            }
+            
+            if (!pnb || *pnb > 0 || nalUnitLength == 0) {
+                stream->skip(nalUnitLength);
+                continue;
+            }
+            
+            srs_freepa(*pnalu);
+            *pnalu = new char[nalUnitLength];
+            *pnb = nalUnitLength;
+            stream->read_bytes(*pnalu, nalUnitLength);
+        }
+    }
+    
+    // we donot parse the detail of sps.
+    // @see https://github.com/ossrs/srs/issues/474
+    if (!avc_parse_sps || !sequenceParameterSetLength) {
+        return ret;
+    }
+    
+    SrsHevcSps sps;
+    if ((ret = srs_hevc_demux_sps(sequenceParameterSetNALUnit, sequenceParameterSetLength, &sps)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    width = sps.pic_width_in_luma_samples;
+    height = sps.pic_height_in_luma_samples;
+    
+    return ret;
+}
+
 int SrsAvcAacCodec::avc_demux_sps()
 {
     int ret = ERROR_SUCCESS;
@@ -93,6 +93,7 @@ enum SrsCodecVideoAVCType
 //     5 = On2 VP6 with alpha channel
 //     6 = Screen video version 2
 //     7 = AVC
+//     12 = HEVC, not in the spec, the de facto extension of the CDNs.
 enum SrsCodecVideo
 {
     // set to the zero to reserved, for array map.
@@ -109,9 +110,35 @@ enum SrsCodecVideo
     SrsCodecVideoOn2VP6WithAlphaChannel = 5,
     SrsCodecVideoScreenVideoVersion2     = 6,
     SrsCodecVideoAVC                     = 7,
+    SrsCodecVideoHEVC                    = 12,
 };
 std::string srs_codec_video2str(SrsCodecVideo codec);
 
+/**
+* the enhanced RTMP video tag header, when the IsExHeader bit is set,
+* the first byte is IsExHeader UB[1], FrameType UB[3], PacketType UB[4],
+* then the FourCC UI32 of the codec, for example, 'hvc1' for HEVC.
+* @see https://github.com/veovera/enhanced-rtmp
+*/
+#define SRS_FLV_VIDEO_EX_HEADER 0x80
+#define SRS_FLV_VIDEO_FOURCC_HEVC 0x68766331
+
+// PacketType UB [4] IF IsExHeader
+// The following values are defined:
+//     0 = sequence start, the HEVCDecoderConfigurationRecord
+//     1 = coded frames, with SI24 CompositionTime
+//     2 = sequence end
+//     3 = coded frames, without CompositionTime, it's zero
+enum SrsCodecVideoExPacketType
+{
+    SrsCodecVideoExPacketTypeSequenceStart          = 0,
+    SrsCodecVideoExPacketTypeCodedFrames            = 1,
+    SrsCodecVideoExPacketTypeSequenceEnd            = 2,
+    SrsCodecVideoExPacketTypeCodedFramesX           = 3,
+    SrsCodecVideoExPacketTypeMetadata               = 4,
+    SrsCodecVideoExPacketTypeMPEG2TSSequenceStart   = 5,
+};
+
 // SoundFormat UB [4] 
 // Format of SoundData. The following values are defined:
 //     0 = Linear PCM, platform endian
@@ -219,6 +246,10 @@ public:
     */
     static bool video_is_h264(char* data, int size);
     /**
+    * check codec hevc, the codec id 12 or the enhanced RTMP 'hvc1'.
+    */
+    static bool video_is_hevc(char* data, int size);
+    /**
     * check codec aac.
     */
     static bool audio_is_aac(char* data, int size);
@@ -324,6 +355,71 @@ enum SrsAvcNaluType
 };
 std::string srs_codec_avc_nalu2str(SrsAvcNaluType nalu_type);
 
+/**
+ * Table 7-1 - NAL unit type codes and NAL unit type classes
+ * H.265-HEVC-ITU-T-REC-H.265-201304.pdf, page 60.
+ * the nal_unit_type is the 6bits after the forbidden_zero_bit,
+ * that is (nalu[0] >> 1) & 0x3f.
+ */
+enum SrsHevcNaluType
+{
+    // Coded slice segment of a non-TSA, non-STSA trailing picture
+    SrsHevcNaluTypeCodedSliceTrailN = 0,
+    SrsHevcNaluTypeCodedSliceTrailR = 1,
+    // Coded slice segment of a BLA picture
+    SrsHevcNaluTypeCodedSliceBLA = 16,
+    SrsHevcNaluTypeCodedSliceBLANoLeading = 18,
+    // Coded slice segment of an IDR picture
+    SrsHevcNaluTypeCodedSliceIDR = 19,
+    SrsHevcNaluTypeCodedSliceIDRNoLeading = 20,
+    // Coded slice segment of a CRA picture
+    SrsHevcNaluTypeCodedSliceCRA = 21,
+    // Reserved IRAP VCL NAL unit types, the last of IRAP.
+    SrsHevcNaluTypeReservedIRAP23 = 23,
+    // Video parameter set video_parameter_set_rbsp( )
+    SrsHevcNaluTypeVPS = 32,
+    // Sequence parameter set seq_parameter_set_rbsp( )
+    SrsHevcNaluTypeSPS = 33,
+    // Picture parameter set pic_parameter_set_rbsp( )
+    SrsHevcNaluTypePPS = 34,
+    // Access unit delimiter access_unit_delimiter_rbsp( )
+    SrsHevcNaluTypeAccessUnitDelimiter = 35,
+    // Supplemental enhancement information sei_rbsp( )
+    SrsHevcNaluTypePrefixSEI = 39,
+    SrsHevcNaluTypeSuffixSEI = 40,
+};
+std::string srs_codec_hevc_nalu2str(SrsHevcNaluType nalu_type);
+
+/**
+* the hevc sps fields required by the HEVCDecoderConfigurationRecord,
+* @see 7.3.2.2 Sequence parameter set RBSP syntax
+*       H.265-HEVC-ITU-T-REC-H.265-201304.pdf, page 33.
+*/
+struct SrsHevcSps
+{
+    // profile_tier_level( 1, sps_max_sub_layers_minus1 )
+    u_int8_t general_profile_space;
+    u_int8_t general_tier_flag;
+    u_int8_t general_profile_idc;
+    u_int32_t general_profile_compatibility_flags;
+    // the 48bits general_progressive_source_flag to general_reserved_zero_43bits.
+    int64_t general_constraint_indicator_flags;
+    u_int8_t general_level_idc;
+    u_int8_t sps_max_sub_layers_minus1;
+    u_int8_t sps_temporal_id_nesting_flag;
+    int32_t chroma_format_idc;
+    int32_t pic_width_in_luma_samples;
+    int32_t pic_height_in_luma_samples;
+    int32_t bit_depth_luma_minus8;
+    int32_t bit_depth_chroma_minus8;
+};
+
+/**
+* demux the hevc sps NALU, which starts with the 2bytes NALU header.
+* @param sps the output sps fields.
+*/
+int srs_hevc_demux_sps(char* frame, int nb_frame, SrsHevcSps* sps);
+
 /**
 * the codec sample unit.
 * for h.264 video packet, a NALU is a sample unit.
@@ -381,9 +477,11 @@ public:
     int32_t cts;
 public:
     // video specified
+    SrsCodecVideo vcodec;
     SrsCodecVideoAVCFrame frame_type;
     SrsCodecVideoAVCType avc_packet_type;
-    // whether sample_units contains IDR frame.
+    // whether sample_units contains IDR frame,
+    // for hevc, whether contains IRAP(BLA/IDR/CRA) frame.
     bool has_idr;
     SrsAvcNaluType first_nalu_type;
 public:
@@ -567,6 +665,10 @@ public:
     char*           sequenceParameterSetNALUnit;
     u_int16_t       pictureParameterSetLength;
     char*           pictureParameterSetNALUnit;
+    // for hevc, the vps, while the sps/pps reuse the fields of avc,
+    // and the avc_extra_data is the HEVCDecoderConfigurationRecord.
+    u_int16_t       videoParameterSetLength;
+    char*           videoParameterSetNALUnit;
 private:
     // the avc payload format.
     SrsAvcPayloadFormat payload_format;
@@ -628,6 +730,8 @@ public:
     * demux the video specified data(frame_type, codec_id, ...) to sample.
     * demux the h.264 sepcified data(avc_profile, ...) to codec from sequence header.
     * demux the h.264 NALUs to sampe units.
+    * @remark the hevc in codec id 12 or enhanced RTMP is also demuxed,
+    *       where the avc_packet_type is mapped to SequenceHeader or NALU.
     */
     virtual int video_avc_demux(char* data, int size, SrsCodecSample* sample);
 public:
@@ -641,6 +745,11 @@ private:
     * decode the sps and pps.
     */
     virtual int avc_demux_sps_pps(SrsStream* stream);
+    /**
+    * when hevc packet is sequence header, decode the vps, sps and pps
+    * from the HEVCDecoderConfigurationRecord.
+    */
+    virtual int hevc_demux_vps_sps_pps(SrsStream* stream);
     /**
      * decode the sps rbsp stream.
      */
@@ -97,6 +97,8 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define ERROR_SYSTEM_DIR_EXISTS             1056
 #define ERROR_SYSTEM_CREATE_DIR             1057
 #define ERROR_SYSTEM_KILL                   1058
+#define ERROR_SYSTEM_FILE_BUSY              1059
+#define ERROR_SYSTEM_CREATE_THREAD          1060
 
 ///////////////////////////////////////////////////////
 // RTMP protocol error.
@@ -151,6 +153,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define ERROR_RTSP_AUDIO_CONFIG             2047
 #define ERROR_RTMP_STREAM_NOT_FOUND         2048
 #define ERROR_RTMP_CLIENT_NOT_FOUND         2049
+#define ERROR_RTMP_PIPELINE_STREAM_ID       2050
 //                                           
 // system control message, 
 // not an error, but special control logic.
@@ -229,6 +232,14 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define ERROR_RESPONSE_CODE                 3064
 #define ERROR_RESPONSE_DATA                 3065
 #define ERROR_REQUEST_DATA                  3066
+#define ERROR_KERNEL_FLV_INDEX              3067
+#define ERROR_KERNEL_TS_PROGRAM             3068
+#define ERROR_HEVC_DECODE_ERROR             3069
+#define ERROR_HLS_PART_AFTER_WRITE          3070
+#define ERROR_HEVC_DROP_BEFORE_VPS_SPS_PPS  3071
+#define ERROR_HEVC_DUPLICATED_VPS           3072
+#define ERROR_HEVC_DUPLICATED_SPS           3073
+#define ERROR_HEVC_DUPLICATED_PPS           3074
 
 ///////////////////////////////////////////////////////
 // HTTP/StreamCaster protocol error.
@@ -263,6 +274,9 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define ERROR_AVC_NALU_UEV                  4027
 #define ERROR_AAC_BYTES_INVALID             4028
 #define ERROR_HTTP_REQUEST_EOF              4029
+#define ERROR_KERNEL_MP4_STREAM_CLOSED      4030
+#define ERROR_HTTP_ZERO_COPY_UNSUPPORTED    4031
+#define ERROR_KERNEL_MP4_TRACK_LATE         4032
 
 ///////////////////////////////////////////////////////
 // HTTP API error.
@@ -28,18 +28,36 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <unistd.h>
 #include <sys/uio.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #endif
 
 #include <fcntl.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sstream>
 using namespace std;
 
 #include <srs_kernel_log.hpp>
 #include <srs_kernel_error.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_core_performance.hpp>
+
+// the aligned size of block for O_DIRECT.
+#define SRS_FILE_DIRECT_ALIGN 4096
+// the max iovs for each writev, the IOV_MAX of linux is 1024.
+#define SRS_FILE_WRITEV_IOVS 64
 
 SrsFileWriter::SrsFileWriter()
 {
     fd = -1;
+    buf = NULL;
+    nb_buf = buf_size = 0;
+    flush_size = SRS_PERF_FILE_WRITE_BUFFER;
+    flush_interval = 0;
+    last_flush = 0;
+    sync = SrsFileSyncNone;
+    direct = directed = false;
 }
 
 SrsFileWriter::~SrsFileWriter()
@@ -49,29 +67,15 @@ SrsFileWriter::~SrsFileWriter()
 
 int SrsFileWriter::open(string p)
 {
-    int ret = ERROR_SUCCESS;
-    
-    if (fd > 0) {
-        ret = ERROR_SYSTEM_FILE_ALREADY_OPENED;
-        srs_error("file %s already opened. ret=%d", path.c_str(), ret);
-        return ret;
-    }
-    
-    int flags = O_CREAT|O_WRONLY|O_TRUNC;
-    mode_t mode = S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP|S_IROTH;
-
-    if ((fd = ::open(p.c_str(), flags, mode)) < 0) {
-        ret = ERROR_SYSTEM_FILE_OPENE;
-        srs_error("open file %s failed. ret=%d", p.c_str(), ret);
-        return ret;
-    }
-    
-    path = p;
-    
-    return ret;
+    return open_fd(p, O_CREAT|O_WRONLY|O_TRUNC);
 }
 
 int SrsFileWriter::open_append(string p)
+{
+    return open_fd(p, O_APPEND|O_WRONLY);
+}
+
+int SrsFileWriter::open_fd(string p, int flags)
 {
     int ret = ERROR_SUCCESS;
     
@@ -81,36 +85,65 @@ int SrsFileWriter::open_append(string p)
         return ret;
     }
     
-    int flags = O_APPEND|O_WRONLY;
     mode_t mode = S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP|S_IROTH;
-
-    if ((fd = ::open(p.c_str(), flags, mode)) < 0) {
+    
+    // the O_DIRECT requires the offset aligned, so never append.
+#ifdef O_DIRECT
+    if (direct && (flags & O_APPEND) == 0) {
+        if ((fd = ::open(p.c_str(), flags|O_DIRECT, mode)) >= 0) {
+            directed = true;
+        } else {
+            srs_warn("open file %s in direct mode failed, use page cache.", p.c_str());
+        }
+    }
+#endif
+    
+    if (fd < 0 && (fd = ::open(p.c_str(), flags, mode)) < 0) {
         ret = ERROR_SYSTEM_FILE_OPENE;
         srs_error("open file %s failed. ret=%d", p.c_str(), ret);
         return ret;
     }
     
     path = p;
+    last_flush = srs_update_system_time_ms();
+    
+    if ((ret = set_buffer(flush_size, flush_interval)) != ERROR_SUCCESS) {
+        return ret;
+    }
     
     return ret;
 }
 
-void SrsFileWriter::close()
+int SrsFileWriter::close()
 {
     int ret = ERROR_SUCCESS;
     
     if (fd < 0) {
-        return;
+        return ret;
     }
     
-    if (::close(fd) < 0) {
+    // always close the fd, return the first error.
+    if ((ret = flush()) != ERROR_SUCCESS) {
+        srs_error("flush file %s failed. ret=%d", path.c_str(), ret);
+    }
+    
+    int r0 = ERROR_SUCCESS;
+    if (ret == ERROR_SUCCESS && sync == SrsFileSyncClose && (r0 = do_sync()) != ERROR_SUCCESS) {
+        ret = r0;
+    }
+    
+    free(buf);
+    buf = NULL;
+    nb_buf = buf_size = 0;
+    directed = false;
+    
+    if (::close(fd) < 0 && ret == ERROR_SUCCESS) {
         ret = ERROR_SYSTEM_FILE_CLOSE;
         srs_error("close file %s failed. ret=%d", path.c_str(), ret);
-        return;
     }
     fd = -1;
     
-    return;
+    return ret;
 }
 
 bool SrsFileWriter::is_open()
@@ -120,45 +153,600 @@ bool SrsFileWriter::is_open()
 
 void SrsFileWriter::lseek(int64_t offset)
 {
+    int ret = ERROR_SUCCESS;
+    
+    if ((ret = flush()) != ERROR_SUCCESS) {
+        srs_error("flush file %s for seek failed. ret=%d", path.c_str(), ret);
+    }
+    
     ::lseek(fd, (off_t)offset, SEEK_SET);
 }
 
 int64_t SrsFileWriter::tellg()
 {
-    return (int64_t)::lseek(fd, 0, SEEK_CUR);
+    return (int64_t)::lseek(fd, 0, SEEK_CUR) + nb_buf;
 }
 
 int SrsFileWriter::write(void* buf, size_t count, ssize_t* pnwrite)
+{
+    iovec iov;
+    iov.iov_base = (char*)buf;
+    iov.iov_len = count;
+    
+    return writev(&iov, 1, pnwrite);
+}
+
+int SrsFileWriter::writev(iovec* iov, int iovcnt, ssize_t* pnwrite)
 {
     int ret = ERROR_SUCCESS;
     
-    ssize_t nwrite;
-    // TODO: FIXME: use st_write.
-    if ((nwrite = ::write(fd, buf, count)) < 0) {
+    ssize_t nwrite = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        nwrite += (ssize_t)iov[i].iov_len;
+    }
+    
+    if (!buf) {
+        // write through by one writev.
+        if ((ret = do_writev(NULL, 0, iov, iovcnt)) != ERROR_SUCCESS) {
+            return ret;
+        }
+    } else if (nb_buf + nwrite <= buf_size) {
+        // group the small writes in buffer.
+        for (int i = 0; i < iovcnt; i++) {
+            memcpy(buf + nb_buf, iov[i].iov_base, iov[i].iov_len);
+            nb_buf += (int)iov[i].iov_len;
+        }
+    } else if (!directed) {
+        // write the buffer and iovs in one writev.
+        if ((ret = do_writev(buf, nb_buf, iov, iovcnt)) != ERROR_SUCCESS) {
+            return ret;
+        }
+        nb_buf = 0;
+        last_flush = srs_update_system_time_ms();
+    } else {
+        // the O_DIRECT always writes the aligned buffer.
+        for (int i = 0; i < iovcnt; i++) {
+            char* p = (char*)iov[i].iov_base;
+            int left = (int)iov[i].iov_len;
+            while (left > 0) {
+                int nb_copy = srs_min(left, buf_size - nb_buf);
+                memcpy(buf + nb_buf, p, nb_copy);
+                nb_buf += nb_copy;
+                p += nb_copy;
+                left -= nb_copy;
+                
+                if (nb_buf == buf_size && (ret = do_flush(false)) != ERROR_SUCCESS) {
+                    return ret;
+                }
+            }
+        }
+    }
+    
+    // flush when interval elapsed.
+    if (buf && nb_buf > 0 && flush_interval > 0 && srs_update_system_time_ms() - last_flush >= flush_interval) {
+        if ((ret = do_flush(false)) != ERROR_SUCCESS) {
+            return ret;
+        }
+    }
+    
+    if (pnwrite) {
+        *pnwrite = nwrite;
+    }
+    
+    return ret;
+}
+
+int SrsFileWriter::flush()
+{
+    return do_flush(true);
+}
+
+int SrsFileWriter::set_buffer(int size, int interval_ms)
+{
+    int ret = ERROR_SUCCESS;
+    
+    flush_size = srs_max(0, size);
+    flush_interval = srs_max(0, interval_ms);
+    
+    if (fd < 0) {
+        return ret;
+    }
+    
+    // the O_DIRECT must write the aligned blocks by buffer.
+    int size_aligned = flush_size;
+    if (directed) {
+        size_aligned = srs_max(flush_size, SRS_FILE_DIRECT_ALIGN);
+        size_aligned = (size_aligned + SRS_FILE_DIRECT_ALIGN - 1) / SRS_FILE_DIRECT_ALIGN * SRS_FILE_DIRECT_ALIGN;
+    }
+    
+    if (buf && size_aligned == buf_size) {
+        return ret;
+    }
+    
+    if ((ret = do_flush(false)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    char* data = NULL;
+    if (size_aligned > 0) {
+#ifndef _WIN32
+        if (posix_memalign((void**)&data, SRS_FILE_DIRECT_ALIGN, size_aligned) != 0) {
+            data = NULL;
+        }
+#else
+        data = (char*)malloc(size_aligned);
+#endif
+        if (!data) {
+            ret = ERROR_SYSTEM_FILE_WRITE;
+            srs_error("alloc write buffer %d of file %s failed. ret=%d", size_aligned, path.c_str(), ret);
+            return ret;
+        }
+        if (nb_buf > 0) {
+            memcpy(data, buf, nb_buf);
+        }
+    }
+    
+    free(buf);
+    buf = data;
+    buf_size = size_aligned;
+    
+    return ret;
+}
+
+void SrsFileWriter::set_sync(SrsFileSync v)
+{
+    sync = v;
+}
+
+void SrsFileWriter::set_direct(bool v)
+{
+    direct = v;
+}
+
+int SrsFileWriter::do_flush(bool all)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (!buf || nb_buf <= 0) {
+        return ret;
+    }
+    
+    int size = nb_buf;
+    
+    // the O_DIRECT only writes the aligned blocks, 
+    // and clear the O_DIRECT to write the tail.
+    if (directed) {
+        size = nb_buf / SRS_FILE_DIRECT_ALIGN * SRS_FILE_DIRECT_ALIGN;
+        
+        if (all && size < nb_buf) {
+            if (size > 0 && (ret = do_writev(buf, size, NULL, 0)) != ERROR_SUCCESS) {
+                return ret;
+            }
+            memmove(buf, buf + size, nb_buf - size);
+            nb_buf -= size;
+            
+#ifdef O_DIRECT
+            int flags = ::fcntl(fd, F_GETFL);
+            if (flags < 0 || ::fcntl(fd, F_SETFL, flags & ~O_DIRECT) < 0) {
+                ret = ERROR_SYSTEM_FILE_WRITE;
+                srs_error("clear direct of file %s failed. ret=%d", path.c_str(), ret);
+                return ret;
+            }
+#endif
+            directed = false;
+            size = nb_buf;
+        }
+    }
+    
+    if (size > 0) {
+        if ((ret = do_writev(buf, size, NULL, 0)) != ERROR_SUCCESS) {
+            return ret;
+        }
+        if (size < nb_buf) {
+            memmove(buf, buf + size, nb_buf - size);
+        }
+        nb_buf -= size;
+    }
+    last_flush = srs_update_system_time_ms();
+    
+    return ret;
+}
+
+int SrsFileWriter::do_writev(char* data, int size, iovec* iov, int iovcnt)
+{
+    int ret = ERROR_SUCCESS;
+    
+    iovec iovs[SRS_FILE_WRITEV_IOVS];
+    int nb_iovs = 0;
+    
+    if (size > 0) {
+        iovs[nb_iovs].iov_base = data;
+        iovs[nb_iovs].iov_len = size;
+        nb_iovs++;
+    }
+    
+    while (nb_iovs > 0 || iovcnt > 0) {
+        // fill the iovs by the left of user iovs.
+        while (nb_iovs < SRS_FILE_WRITEV_IOVS && iovcnt > 0) {
+            if (iov->iov_len > 0) {
+                iovs[nb_iovs++] = *iov;
+            }
+            iov++;
+            iovcnt--;
+        }
+        if (nb_iovs <= 0) {
+            break;
+        }
+        
+        ssize_t nwrite;
+        // TODO: FIXME: use st_write.
+        if ((nwrite = ::writev(fd, iovs, nb_iovs)) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ret = ERROR_SYSTEM_FILE_WRITE;
+            srs_error("write to file %s failed. ret=%d", path.c_str(), ret);
+            return ret;
+        }
+        
+        // consume the written bytes, keep the partial one.
+        int nb_done = 0;
+        while (nb_done < nb_iovs && nwrite >= (ssize_t)iovs[nb_done].iov_len) {
+            nwrite -= (ssize_t)iovs[nb_done].iov_len;
+            nb_done++;
+        }
+        if (nb_done < nb_iovs && nwrite > 0) {
+            iovs[nb_done].iov_base = (char*)iovs[nb_done].iov_base + nwrite;
+            iovs[nb_done].iov_len -= nwrite;
+        }
+        memmove(iovs, iovs + nb_done, (nb_iovs - nb_done) * sizeof(iovec));
+        nb_iovs -= nb_done;
+    }
+    
+    if (sync == SrsFileSyncFlush && (ret = do_sync()) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    return ret;
+}
+
+int SrsFileWriter::do_sync()
+{
+    int ret = ERROR_SUCCESS;
+    
+#ifndef _WIN32
+#ifdef __linux__
+    int r0 = ::fdatasync(fd);
+#else
+    int r0 = ::fsync(fd);
+#endif
+    if (r0 < 0) {
         ret = ERROR_SYSTEM_FILE_WRITE;
-        srs_error("write to file %s failed. ret=%d", path.c_str(), ret);
+        srs_error("sync file %s failed. ret=%d", path.c_str(), ret);
         return ret;
     }
+#endif
     
-    if (pnwrite != NULL) {
-        *pnwrite = nwrite;
+    return ret;
+}
+
+#ifndef _WIN32
+/**
+* the shared write threads of async file writers,
+* the ready writers are written in round-robin, a buffer each time.
+*/
+class SrsFileWritePool
+{
+public:
+    pthread_mutex_t lock;
+private:
+    pthread_cond_t cond;
+    std::deque<SrsAsyncFileWriter*> ready;
+    bool started;
+public:
+    SrsFileWritePool();
+    virtual ~SrsFileWritePool();
+public:
+    /**
+    * start the write threads when not started.
+    */
+    virtual int start();
+    /**
+    * put the writer to ready queue.
+    * @remark user must hold the lock.
+    */
+    virtual void schedule(SrsAsyncFileWriter* writer);
+private:
+    static void* worker(void* arg);
+    virtual void cycle();
+};
+
+SrsFileWritePool::SrsFileWritePool()
+{
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&cond, NULL);
+    started = false;
+}
+
+SrsFileWritePool::~SrsFileWritePool()
+{
+    // the threads never quit, so never destroy the lock.
+}
+
+int SrsFileWritePool::start()
+{
+    int ret = ERROR_SUCCESS;
+    
+    pthread_mutex_lock(&lock);
+    
+    for (int i = 0; !started && i < SRS_PERF_FILE_WRITE_THREADS; i++) {
+        pthread_t tid;
+        if (pthread_create(&tid, NULL, worker, this) != 0) {
+            ret = ERROR_SYSTEM_CREATE_THREAD;
+            srs_error("create file write thread failed. ret=%d", ret);
+            break;
+        }
+        pthread_detach(tid);
     }
     
+    // the started threads are ok to work.
+    started = true;
+    
+    pthread_mutex_unlock(&lock);
+    
     return ret;
 }
 
-int SrsFileWriter::writev(iovec* iov, int iovcnt, ssize_t* pnwrite)
+void SrsFileWritePool::schedule(SrsAsyncFileWriter* writer)
+{
+    if (writer->scheduled) {
+        return;
+    }
+    
+    writer->scheduled = true;
+    ready.push_back(writer);
+    pthread_cond_signal(&cond);
+}
+
+void* SrsFileWritePool::worker(void* arg)
+{
+    SrsFileWritePool* pool = (SrsFileWritePool*)arg;
+    pool->cycle();
+    return NULL;
+}
+
+void SrsFileWritePool::cycle()
+{
+    pthread_mutex_lock(&lock);
+    
+    for (;;) {
+        while (ready.empty()) {
+            pthread_cond_wait(&cond, &lock);
+        }
+        
+        // the writer is owned by this thread util rescheduled,
+        // so its buffers are written in order.
+        SrsAsyncFileWriter* writer = ready.front();
+        ready.pop_front();
+        
+        SrsFileChunk* chunk = writer->chunks.front();
+        bool failed = writer->error != ERROR_SUCCESS;
+        
+        pthread_mutex_unlock(&lock);
+        
+        // drop the left buffers when write failed.
+        int ret = ERROR_SUCCESS;
+        if (!failed) {
+            ret = writer->file->write(chunk->data, chunk->size, NULL);
+        }
+        
+        pthread_mutex_lock(&lock);
+        
+        if (ret != ERROR_SUCCESS) {
+            writer->error = ret;
+        }
+        
+        writer->chunks.pop_front();
+        chunk->size = 0;
+        writer->free_chunks.push_back(chunk);
+        
+        if (!writer->chunks.empty()) {
+            ready.push_back(writer);
+        } else {
+            writer->scheduled = false;
+        }
+        
+        // @remark never use the writer after unlock, for it may be freed.
+        pthread_cond_broadcast(&writer->cond);
+    }
+}
+
+static SrsFileWritePool _srs_file_write_pool;
+
+SrsAsyncFileWriter::SrsAsyncFileWriter()
+{
+    file = new SrsFileWriter();
+    current = NULL;
+    chunk_size = srs_max(SRS_PERF_FILE_WRITE_BUFFER, SRS_FILE_DIRECT_ALIGN);
+    chunk_interval = 0;
+    last_submit = 0;
+    max_inflight = SRS_PERF_FILE_WRITE_INFLIGHT;
+    nonblocking = false;
+    position = 0;
+    scheduled = false;
+    error = ERROR_SUCCESS;
+    pthread_cond_init(&cond, NULL);
+}
+
+SrsAsyncFileWriter::~SrsAsyncFileWriter()
+{
+    close();
+    
+    if (current) {
+        srs_freepa(current->data);
+        srs_freep(current);
+    }
+    
+    std::vector<SrsFileChunk*>::iterator it;
+    for (it = free_chunks.begin(); it != free_chunks.end(); ++it) {
+        SrsFileChunk* chunk = *it;
+        srs_freepa(chunk->data);
+        srs_freep(chunk);
+    }
+    free_chunks.clear();
+    
+    srs_freep(file);
+    pthread_cond_destroy(&cond);
+}
+
+int SrsAsyncFileWriter::open(string p)
 {
     int ret = ERROR_SUCCESS;
     
+    if ((ret = file->open(p)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    return on_opened();
+}
+
+int SrsAsyncFileWriter::open_append(string p)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if ((ret = file->open_append(p)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    return on_opened();
+}
+
+int SrsAsyncFileWriter::close()
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (!file->is_open()) {
+        return ret;
+    }
+    
+    if ((ret = flush()) != ERROR_SUCCESS) {
+        srs_error("async flush file failed. ret=%d", ret);
+    }
+    
+    int r0 = file->close();
+    if (ret == ERROR_SUCCESS) {
+        ret = r0;
+    }
+    error = ERROR_SUCCESS;
+    
+    return ret;
+}
+
+bool SrsAsyncFileWriter::is_open()
+{
+    return file->is_open();
+}
+
+void SrsAsyncFileWriter::lseek(int64_t offset)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if ((ret = flush()) != ERROR_SUCCESS) {
+        srs_error("async flush file for seek failed. ret=%d", ret);
+    }
+    
+    file->lseek(offset);
+    position = offset;
+}
+
+int64_t SrsAsyncFileWriter::tellg()
+{
+    return position;
+}
+
+int SrsAsyncFileWriter::write(void* buf, size_t count, ssize_t* pnwrite)
+{
+    iovec iov;
+    iov.iov_base = (char*)buf;
+    iov.iov_len = count;
+    
+    return writev(&iov, 1, pnwrite);
+}
+
+int SrsAsyncFileWriter::writev(iovec* iov, int iovcnt, ssize_t* pnwrite)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (!file->is_open()) {
+        ret = ERROR_SYSTEM_FILE_WRITE;
+        srs_error("async write to file not open. ret=%d", ret);
+        return ret;
+    }
+    
     ssize_t nwrite = 0;
     for (int i = 0; i < iovcnt; i++) {
-        iovec* piov = iov + i;
-        ssize_t this_nwrite = 0;
-        if ((ret = write(piov->iov_base, piov->iov_len, &this_nwrite)) != ERROR_SUCCESS) {
-            return ret;
+        nwrite += (ssize_t)iov[i].iov_len;
+    }
+    
+    // the count of buffers to queue by this write.
+    int nb_submit = (int)(((current? current->size : 0) + nwrite) / chunk_size);
+    
+    pthread_mutex_lock(&_srs_file_write_pool.lock);
+    
+    // backpressure, but always allow the huge write when queue empty.
+    while (error == ERROR_SUCCESS && nb_submit > 0 && !chunks.empty()
+        && (int)chunks.size() + nb_submit > max_inflight
+    ) {
+        if (nonblocking) {
+            pthread_mutex_unlock(&_srs_file_write_pool.lock);
+            return ERROR_SYSTEM_FILE_BUSY;
+        }
+        pthread_cond_wait(&cond, &_srs_file_write_pool.lock);
+    }
+    ret = error;
+    
+    pthread_mutex_unlock(&_srs_file_write_pool.lock);
+    
+    if (ret != ERROR_SUCCESS) {
+        srs_error("async write to file failed. ret=%d", ret);
+        return ret;
+    }
+    
+    for (int i = 0; i < iovcnt; i++) {
+        char* p = (char*)iov[i].iov_base;
+        int left = (int)iov[i].iov_len;
+        
+        while (left > 0) {
+            if (!current) {
+                pthread_mutex_lock(&_srs_file_write_pool.lock);
+                if (!free_chunks.empty()) {
+                    current = free_chunks.back();
+                    free_chunks.pop_back();
+                }
+                pthread_mutex_unlock(&_srs_file_write_pool.lock);
+            }
+            if (!current) {
+                current = new SrsFileChunk();
+                current->data = new char[chunk_size];
+                current->size = 0;
+            }
+            
+            int nb_copy = srs_min(left, chunk_size - current->size);
+            memcpy(current->data + current->size, p, nb_copy);
+            current->size += nb_copy;
+            p += nb_copy;
+            left -= nb_copy;
+            
+            if (current->size == chunk_size) {
+                submit();
+            }
         }
-        nwrite += this_nwrite;
+    }
+    position += nwrite;
+    
+    // queue the buffer when interval elapsed.
+    if (current && chunk_interval > 0 && srs_update_system_time_ms() - last_submit >= chunk_interval) {
+        submit();
     }
     
     if (pnwrite) {
@@ -168,14 +756,144 @@ int SrsFileWriter::writev(iovec* iov, int iovcnt, ssize_t* pnwrite)
     return ret;
 }
 
+int SrsAsyncFileWriter::flush()
+{
+    if (current && current->size > 0) {
+        submit();
+    }
+    
+    return drain();
+}
+
+int SrsAsyncFileWriter::set_buffer(int size, int interval_ms)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if ((ret = flush()) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // the size of free buffers changed, free them.
+    pthread_mutex_lock(&_srs_file_write_pool.lock);
+    
+    if (current) {
+        free_chunks.push_back(current);
+        current = NULL;
+    }
+    
+    std::vector<SrsFileChunk*>::iterator it;
+    for (it = free_chunks.begin(); it != free_chunks.end(); ++it) {
+        SrsFileChunk* chunk = *it;
+        srs_freepa(chunk->data);
+        srs_freep(chunk);
+    }
+    free_chunks.clear();
+    
+    chunk_size = srs_max(size, SRS_FILE_DIRECT_ALIGN);
+    chunk_interval = srs_max(0, interval_ms);
+    
+    pthread_mutex_unlock(&_srs_file_write_pool.lock);
+    
+    return ret;
+}
+
+void SrsAsyncFileWriter::set_sync(SrsFileSync v)
+{
+    // the sync policy is used by write thread.
+    flush();
+    file->set_sync(v);
+}
+
+void SrsAsyncFileWriter::set_direct(bool v)
+{
+    file->set_direct(v);
+}
+
+void SrsAsyncFileWriter::set_inflight(int max, bool v)
+{
+    pthread_mutex_lock(&_srs_file_write_pool.lock);
+    max_inflight = srs_max(1, max);
+    nonblocking = v;
+    pthread_mutex_unlock(&_srs_file_write_pool.lock);
+}
+
+int SrsAsyncFileWriter::inflight()
+{
+    pthread_mutex_lock(&_srs_file_write_pool.lock);
+    int nb_chunks = (int)chunks.size();
+    pthread_mutex_unlock(&_srs_file_write_pool.lock);
+    
+    return nb_chunks;
+}
+
+int SrsAsyncFileWriter::on_opened()
+{
+    int ret = ERROR_SUCCESS;
+    
+    // the write thread writes each buffer by one syscall.
+    if ((ret = file->set_buffer(0, 0)) != ERROR_SUCCESS) {
+        file->close();
+        return ret;
+    }
+    
+    if ((ret = _srs_file_write_pool.start()) != ERROR_SUCCESS) {
+        file->close();
+        return ret;
+    }
+    
+    position = file->tellg();
+    last_submit = srs_update_system_time_ms();
+    error = ERROR_SUCCESS;
+    
+    return ret;
+}
+
+void SrsAsyncFileWriter::submit()
+{
+    pthread_mutex_lock(&_srs_file_write_pool.lock);
+    
+    chunks.push_back(current);
+    current = NULL;
+    _srs_file_write_pool.schedule(this);
+    
+    pthread_mutex_unlock(&_srs_file_write_pool.lock);
+    
+    last_submit = srs_update_system_time_ms();
+}
+
+int SrsAsyncFileWriter::drain()
+{
+    int ret = ERROR_SUCCESS;
+    
+    pthread_mutex_lock(&_srs_file_write_pool.lock);
+    
+    while (scheduled) {
+        pthread_cond_wait(&cond, &_srs_file_write_pool.lock);
+    }
+    ret = error;
+    
+    pthread_mutex_unlock(&_srs_file_write_pool.lock);
+    
+    return ret;
+}
+#endif
+
 SrsFileReader::SrsFileReader()
 {
     fd = -1;
+    buf = NULL;
+    nb_buf = buf_pos = 0;
+    offset = 0;
+    mapped = false;
+    mmap_data = NULL;
+    mmap_size = 0;
+    advised_start = advised_end = 0;
 }
 
 SrsFileReader::~SrsFileReader()
 {
     close();
+    srs_freepa(buf);
 }
 
 int SrsFileReader::open(string p)
@@ -194,7 +912,66 @@ int SrsFileReader::open(string p)
         return ret;
     }
     
+    // the file is always read sequentially, so hint the kernel to read ahead.
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    
     path = p;
+    nb_buf = buf_pos = 0;
+    offset = 0;
+    
+    return ret;
+}
+
+int SrsFileReader::open_mmap(string p)
+{
+    int ret = ERROR_SUCCESS;
+    
+#ifndef _WIN32
+    if ((ret = open(p)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        ret = ERROR_SYSTEM_FILE_OPENE;
+        srs_error("stat file %s failed. ret=%d", p.c_str(), ret);
+        close();
+        return ret;
+    }
+    
+    // the huge file must fit in the address space.
+    int64_t size = (int64_t)st.st_size;
+    if ((u_int64_t)size > (u_int64_t)((size_t)-1)) {
+        ret = ERROR_SYSTEM_FILE_OPENE;
+        srs_error("mmap file %s too large, size=%"PRId64". ret=%d", p.c_str(), size, ret);
+        close();
+        return ret;
+    }
+    
+    // empty file is never mapped, always EOF.
+    if (size > 0) {
+        void* data = ::mmap(NULL, (size_t)size, PROT_READ, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED) {
+            ret = ERROR_SYSTEM_FILE_OPENE;
+            srs_error("mmap file %s failed, size=%"PRId64". ret=%d", p.c_str(), size, ret);
+            close();
+            return ret;
+        }
+        
+        // the file is generally read sequentially.
+        madvise(data, (size_t)size, MADV_SEQUENTIAL);
+        
+        mmap_data = (char*)data;
+    }
+    
+    mapped = true;
+    mmap_size = size;
+#else
+    ret = ERROR_SYSTEM_FILE_OPENE;
+    srs_error("mmap file %s not supported. ret=%d", p.c_str(), ret);
+#endif
     
     return ret;
 }
@@ -207,12 +984,24 @@ void SrsFileReader::close()
         return;
     }
     
+#ifndef _WIN32
+    if (mmap_data) {
+        ::munmap(mmap_data, (size_t)mmap_size);
+    }
+#endif
+    mapped = false;
+    mmap_data = NULL;
+    mmap_size = 0;
+    advised_start = advised_end = 0;
+    
     if (::close(fd) < 0) {
         ret = ERROR_SYSTEM_FILE_CLOSE;
         srs_error("close file %s failed. ret=%d", path.c_str(), ret);
         return;
     }
     fd = -1;
+    nb_buf = buf_pos = 0;
+    offset = 0;
     
     return;
 }
@@ -224,40 +1013,126 @@ bool SrsFileReader::is_open()
 
 int64_t SrsFileReader::tellg()
 {
-    return (int64_t)::lseek(fd, 0, SEEK_CUR);
+    return offset - (nb_buf - buf_pos);
 }
 
 void SrsFileReader::skip(int64_t size)
 {
-    ::lseek(fd, (off_t)size, SEEK_CUR);
+    lseek(tellg() + size);
 }
 
 int64_t SrsFileReader::lseek(int64_t offset)
 {
-    return (int64_t)::lseek(fd, (off_t)offset, SEEK_SET);
+    // the mmap file only update the read position.
+    if (mapped) {
+        if (offset < 0) {
+            return -1;
+        }
+        this->offset = offset;
+        will_read(SRS_PERF_FILE_READ_BUFFER);
+        return offset;
+    }
+    
+    // seek in buffer, for the decoder always skip the small tags.
+    int64_t buf_start = this->offset - nb_buf;
+    if (offset >= buf_start && offset <= this->offset) {
+        buf_pos = (int)(offset - buf_start);
+        return offset;
+    }
+    
+    int64_t pos = (int64_t)::lseek(fd, (off_t)offset, SEEK_SET);
+    if (pos >= 0) {
+        this->offset = pos;
+        nb_buf = buf_pos = 0;
+    }
+    
+    return pos;
 }
 
 int64_t SrsFileReader::filesize()
 {
-    int64_t cur = tellg();
+    if (mapped) {
+        return mmap_size;
+    }
+    
     int64_t size = (int64_t)::lseek(fd, 0, SEEK_END);
-    ::lseek(fd, (off_t)cur, SEEK_SET);
+    ::lseek(fd, (off_t)offset, SEEK_SET);
     return size;
 }
 
+int64_t SrsFileReader::mtime()
+{
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        return 0;
+    }
+    
+#if defined(__APPLE__)
+    return (int64_t)st.st_mtimespec.tv_sec * 1000 + st.st_mtimespec.tv_nsec / 1000000;
+#elif defined(_WIN32)
+    return (int64_t)st.st_mtime * 1000;
+#else
+    return (int64_t)st.st_mtim.tv_sec * 1000 + st.st_mtim.tv_nsec / 1000000;
+#endif
+}
+
 int SrsFileReader::read(void* buf, size_t count, ssize_t* pnread)
 {
     int ret = ERROR_SUCCESS;
     
-    ssize_t nread;
-    // TODO: FIXME: use st_read.
-    if ((nread = ::read(fd, buf, count)) < 0) {
-        ret = ERROR_SYSTEM_FILE_READ;
-        srs_error("read from file %s failed. ret=%d", path.c_str(), ret);
-        return ret;
+    char* p = (char*)buf;
+    size_t nread = 0;
+    
+    // copy from the mmap file.
+    if (mapped && offset < mmap_size) {
+        nread = (size_t)srs_min((int64_t)count, mmap_size - offset);
+        memcpy(p, mmap_data + offset, nread);
+        offset += nread;
     }
     
-    if (nread == 0) {
+    while (!mapped && nread < count) {
+        // consume the bytes in buffer first.
+        if (buf_pos < nb_buf) {
+            int nb_copy = (int)srs_min((size_t)(nb_buf - buf_pos), count - nread);
+            memcpy(p + nread, this->buf + buf_pos, nb_copy);
+            buf_pos += nb_copy;
+            nread += nb_copy;
+            continue;
+        }
+        
+        // directly read to user buffer when large.
+        char* target = this->buf;
+        size_t size = SRS_PERF_FILE_READ_BUFFER;
+        if (count - nread >= (size_t)SRS_PERF_FILE_READ_BUFFER) {
+            target = p + nread;
+            size = count - nread;
+        } else if (!this->buf) {
+            target = this->buf = new char[SRS_PERF_FILE_READ_BUFFER];
+        }
+        
+        ssize_t nb_read;
+        // TODO: FIXME: use st_read.
+        if ((nb_read = ::read(fd, target, size)) < 0) {
+            ret = ERROR_SYSTEM_FILE_READ;
+            srs_error("read from file %s failed. ret=%d", path.c_str(), ret);
+            return ret;
+        }
+        
+        // EOF, return the bytes read.
+        if (nb_read == 0) {
+            break;
+        }
+        offset += nb_read;
+        
+        if (target == p + nread) {
+            nread += nb_read;
+        } else {
+            nb_buf = (int)nb_read;
+            buf_pos = 0;
+        }
+    }
+    
+    if (nread == 0 && count > 0) {
         ret = ERROR_SYSTEM_FILE_EOF;
         return ret;
     }
@@ -269,3 +1144,58 @@ int SrsFileReader::read(void* buf, size_t count, ssize_t* pnread)
     return ret;
 }
 
+int SrsFileReader::read_view(size_t count, char** pdata)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (!mapped) {
+        ret = ERROR_SYSTEM_IO_INVALID;
+        srs_error("read view of file %s not mmap. ret=%d", path.c_str(), ret);
+        return ret;
+    }
+    
+    // the count maybe a negative size casted by caller, never move back.
+    if (offset < 0 || offset > mmap_size || (u_int64_t)count > (u_int64_t)(mmap_size - offset)) {
+        ret = ERROR_SYSTEM_FILE_EOF;
+        return ret;
+    }
+    
+    *pdata = mmap_data + offset;
+    offset += count;
+    
+    return ret;
+}
+
+void SrsFileReader::will_read(size_t count)
+{
+#ifndef _WIN32
+    if (!mmap_data || offset < 0 || offset >= mmap_size) {
+        return;
+    }
+    
+    // ignore when the position is in the window already advised,
+    // so the sequential seek only advise once for each window.
+    if (offset >= advised_start && offset < advised_end) {
+        return;
+    }
+    
+    // the madvise requires the address aligned to page.
+    static int64_t page_size = (int64_t)sysconf(_SC_PAGESIZE);
+    int64_t start = offset - offset % page_size;
+    int64_t end = srs_min(mmap_size, offset + (int64_t)count);
+    
+    madvise(mmap_data + start, (size_t)(end - start), MADV_WILLNEED);
+    advised_start = start;
+    advised_end = end;
+#endif
+}
+
+bool SrsFileReader::is_mmap()
+{
+    return mapped;
+}
+
+int SrsFileReader::get_fd()
+{
+    return fd;
+}
@@ -30,20 +30,58 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <srs_core.hpp>
 
 #include <string>
+#include <deque>
+#include <vector>
 
 // for srs-librtmp, @see https://github.com/ossrs/srs/issues/213
 #ifndef _WIN32
 #include <sys/uio.h>
+#include <pthread.h>
 #endif
 
+/**
+* the policy to sync the data of file writer to disk.
+*/
+enum SrsFileSync
+{
+    // never sync, the kernel writes back the data.
+    SrsFileSyncNone = 0,
+    // fdatasync when flush the buffer to file.
+    SrsFileSyncFlush = 1,
+    // fdatasync when close the file.
+    SrsFileSyncClose = 2,
+};
+
 /**
 * file writer, to write to file.
+* the writes are buffered and flushed by writev in batch, 
+* when buffer is full, interval elapsed, seek or close.
+* @remark the interval is checked by the next write, there is no timer,
+*       so the buffer of an idle stream stays in memory util the next
+*       write or close, user should flush() when the stream is idle.
 */
 class SrsFileWriter
 {
 private:
     std::string path;
     int fd;
+private:
+    // the write behind buffer, NULL when disabled.
+    char* buf;
+    int nb_buf;
+    // the capacity of buffer, aligned when direct.
+    int buf_size;
+    // the configured size to flush, 0 to disable the buffer.
+    int flush_size;
+    // the interval in ms to flush, 0 to flush only when buffer is full.
+    // checked by write, never flush when no write.
+    int flush_interval;
+    int64_t last_flush;
+    SrsFileSync sync;
+    // whether to use O_DIRECT for the next open.
+    bool direct;
+    // whether the fd is in O_DIRECT mode.
+    bool directed;
 public:
     SrsFileWriter();
     virtual ~SrsFileWriter();
@@ -59,10 +97,11 @@ public:
      */
     virtual int open_append(std::string p);
     /**
-     * close current writer.
+     * close current writer, flush the buffered data and sync by policy.
      * @remark user can reopen again.
+     * @return the error of flush, sync or close, the writer is always closed.
      */
-    virtual void close();
+    virtual int close();
 public:
     virtual bool is_open();
     virtual void lseek(int64_t offset);
@@ -78,8 +117,143 @@ public:
      * @see https://github.com/ossrs/srs/issues/405
      */
     virtual int writev(iovec* iov, int iovcnt, ssize_t* pnwrite);
+    /**
+    * flush the buffered data to file.
+    * @remark for O_DIRECT, the tail unaligned block is written 
+    *       by disable the O_DIRECT of fd, so the writes after flush
+    *       use the page cache, only flush before close for O_DIRECT.
+    */
+    virtual int flush();
+public:
+    /**
+    * set the write behind buffer, apply to current file.
+    * @param size the bytes to flush, 0 to write through without buffer.
+    * @param interval_ms flush when the interval elapsed, 0 to ignore.
+    *       the interval is checked by the next write, not by timer.
+    */
+    virtual int set_buffer(int size, int interval_ms);
+    /**
+    * set the policy to fdatasync the data.
+    */
+    virtual void set_sync(SrsFileSync v);
+    /**
+    * whether open the file with O_DIRECT to bypass the page cache,
+    * the buffer is aligned to write in blocks.
+    * @remark apply at the next open, ignore when not supported.
+    */
+    virtual void set_direct(bool v);
+private:
+    virtual int open_fd(std::string p, int flags);
+    /**
+    * flush the buffer to file.
+    * @param all whether write the tail unaligned bytes for O_DIRECT.
+    */
+    virtual int do_flush(bool all);
+    /**
+    * write all bytes of iovs, the buffer is written before iovs.
+    */
+    virtual int do_writev(char* data, int size, iovec* iov, int iovcnt);
+    virtual int do_sync();
+};
+
+#ifndef _WIN32
+class SrsFileWritePool;
+
+/**
+* the buffer of async file writer, queued to write.
+*/
+struct SrsFileChunk
+{
+    char* data;
+    int size;
 };
 
+/**
+* async file writer, the writes are copied to buffers and written
+* by the shared write threads, so the caller never blocks on disk.
+* the buffers of each writer are written in order, by one thread a time.
+* when the inflight buffers exceed the max, the write blocks util
+* some buffer written, or fails with ERROR_SYSTEM_FILE_BUSY in 
+* nonblocking mode, and the caller can drop the data.
+* @remark the file is opened and closed in the caller thread,
+*       the close waits for all buffers written.
+*/
+class SrsAsyncFileWriter : public SrsFileWriter
+{
+    friend class SrsFileWritePool;
+private:
+    // the underlayer writer, used by write thread.
+    SrsFileWriter* file;
+    // the buffer to copy the writes, queued when full.
+    SrsFileChunk* current;
+    int chunk_size;
+    int chunk_interval;
+    int64_t last_submit;
+    int max_inflight;
+    bool nonblocking;
+    // the logical offset of file, the written and queued bytes.
+    int64_t position;
+private:
+    // the inflight buffers, protected by the lock of pool.
+    std::deque<SrsFileChunk*> chunks;
+    std::vector<SrsFileChunk*> free_chunks;
+    // whether in the ready queue of pool, or writing by thread.
+    bool scheduled;
+    // the error of write thread, return by the next write.
+    int error;
+    // signaled when buffer written.
+    pthread_cond_t cond;
+public:
+    SrsAsyncFileWriter();
+    virtual ~SrsAsyncFileWriter();
+public:
+    virtual int open(std::string p);
+    virtual int open_append(std::string p);
+    virtual int close();
+public:
+    virtual bool is_open();
+    virtual void lseek(int64_t offset);
+    virtual int64_t tellg();
+public:
+    virtual int write(void* buf, size_t count, ssize_t* pnwrite);
+    virtual int writev(iovec* iov, int iovcnt, ssize_t* pnwrite);
+    /**
+    * queue the buffer and wait for all buffers written.
+    */
+    virtual int flush();
+public:
+    /**
+    * set the size of buffer, and flush interval for the current buffer.
+    * @param size the bytes of each buffer, at least 4KB.
+    * @remark the current buffer is queued when the interval elapsed by
+    *       the next write, user should flush() when the stream is idle.
+    */
+    virtual int set_buffer(int size, int interval_ms);
+    virtual void set_sync(SrsFileSync v);
+    virtual void set_direct(bool v);
+    /**
+    * set the max inflight buffers of this writer.
+    * @param v when nonblocking, write fails with ERROR_SYSTEM_FILE_BUSY
+    *       when exceed, otherwise blocks util some buffer written.
+    */
+    virtual void set_inflight(int max, bool v);
+    /**
+    * get the count of inflight buffers, for caller to detect the disk stall.
+    */
+    virtual int inflight();
+private:
+    virtual int on_opened();
+    /**
+    * queue the current buffer to write.
+    */
+    virtual void submit();
+    /**
+    * wait for all buffers written.
+    */
+    virtual int drain();
+};
+#endif
+
 /**
 * file reader, to read from file.
 */
@@ -88,6 +262,22 @@ class SrsFileReader
 private:
     std::string path;
     int fd;
+    // the read ahead buffer, alloc when read.
+    // @see SRS_PERF_FILE_READ_BUFFER
+    char* buf;
+    // the size of bytes in buffer, and the read position of buffer.
+    int nb_buf;
+    int buf_pos;
+    // the file offset of fd, which is the end of bytes in buffer,
+    // or the read position of mmap file.
+    int64_t offset;
+    // whether open in mmap mode, the whole file is mapped to memory.
+    bool mapped;
+    char* mmap_data;
+    int64_t mmap_size;
+    // the window of mmap file advised to read ahead, [start, end).
+    int64_t advised_start;
+    int64_t advised_end;
 public:
     SrsFileReader();
     virtual ~SrsFileReader();
@@ -97,6 +287,14 @@ public:
      * @param p a string indicates the path of file to open.
      */
     virtual int open(std::string p);
+    /**
+     * open file reader in mmap mode, map the whole file to memory,
+     * the read_view() can return the bytes without copy.
+     * @param p a string indicates the path of file to open.
+     * @remark the file must be smaller than the address space,
+     *       for example, 2GB for 32bits system.
+     */
+    virtual int open_mmap(std::string p);
     /**
      * close current reader.
      * @remark user can reopen again.
@@ -109,12 +307,40 @@ public:
     virtual void skip(int64_t size);
     virtual int64_t lseek(int64_t offset);
     virtual int64_t filesize();
+    /**
+    * get the modify time of file in ms, 0 when unknown.
+    */
+    virtual int64_t mtime();
 public:
     /**
-    * read from file. 
+    * read from file, read ahead to buffer when the count is small,
+    * and always read count bytes util EOF.
     * @param pnread the output nb_read, NULL to ignore.
+    * @return ERROR_SYSTEM_FILE_EOF when no bytes to read.
     */
     virtual int read(void* buf, size_t count, ssize_t* pnread);
+    /**
+    * read count bytes from mmap file without copy, 
+    * the bytes is valid util the reader closed.
+    * @param pdata output the bytes in the mapped memory.
+    * @return ERROR_SYSTEM_FILE_EOF when no enough bytes to read,
+    *       ERROR_SYSTEM_IO_INVALID when not open in mmap mode.
+    */
+    virtual int read_view(size_t count, char** pdata);
+    /**
+    * hint the kernel to read ahead the bytes from current position,
+    * for the reader will read them soon, for example, after seek.
+    * @remark ignore when not in mmap mode, or the position already advised.
+    */
+    virtual void will_read(size_t count);
+public:
+    virtual bool is_mmap();
+    /**
+    * get the fd of file, for example, to sendfile from it.
+    * @remark user must use tellg() as the read position, for the fd
+    *       position is ahead of it when read buffer is not empty.
+    */
+    virtual int get_fd();
 };
 
 #endif
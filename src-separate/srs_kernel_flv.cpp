@@ -26,9 +26,11 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 // for srs-librtmp, @see https://github.com/ossrs/srs/issues/213
 #ifndef _WIN32
 #include <unistd.h>
+#include <pthread.h>
 #endif
 
 #include <fcntl.h>
+#include <stdio.h>
 #include <sstream>
 using namespace std;
 
@@ -39,6 +41,7 @@ using namespace std;
 #include <srs_kernel_codec.hpp>
 #include <srs_kernel_utility.hpp>
 #include <srs_core_mem_watch.hpp>
+#include <srs_core_autofree.hpp>
 
 SrsMessageHeader::SrsMessageHeader()
 {
@@ -800,6 +803,28 @@ int SrsFlvDecoder::read_tag_data(char* data, int32_t size)
 
 }
 
+int SrsFlvDecoder::read_tag_data_view(char** pdata, int32_t size)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(pdata);
+    
+    if (size < 0) {
+        ret = ERROR_SYSTEM_IO_INVALID;
+        srs_error("read flv tag data view invalid size=%d. ret=%d", size, ret);
+        return ret;
+    }
+    
+    if ((ret = reader->read_view((size_t)size, pdata)) != ERROR_SUCCESS) {
+        if (ret != ERROR_SYSTEM_FILE_EOF) {
+            srs_error("read flv tag data view failed. ret=%d", ret);
+        }
+        return ret;
+    }
+    
+    return ret;
+}
+
 int SrsFlvDecoder::read_previous_tag_size(char previous_tag_size[4])
 {
     int ret = ERROR_SUCCESS;
@@ -978,4 +1003,844 @@ int SrsFlvVodStreamDecoder::lseek(int64_t offset)
     return ret;
 }
 
+// the size of sidecar header and entry.
+#define SRS_FLV_INDEX_HEADER_SIZE 28
+#define SRS_FLV_INDEX_ENTRY_SIZE 13
+// for audio only flv, index the audio tag in interval of ms.
+#define SRS_FLV_INDEX_AUDIO_INTERVAL 1000
+// the version of sidecar, 2 adds the mtime of flv.
+#define SRS_FLV_INDEX_VERSION 2
+
+SrsFlvIndex::SrsFlvIndex()
+{
+    flv_size = 0;
+    flv_mtime = 0;
+}
+
+SrsFlvIndex::~SrsFlvIndex()
+{
+}
+
+int SrsFlvIndex::build(SrsFileReader* fr)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(fr);
+    
+    entries.clear();
+    flv_size = fr->filesize();
+    flv_mtime = fr->mtime();
+    
+    int64_t pos = fr->tellg();
+    fr->lseek(0);
+    
+    // the 9bytes header and 4bytes previous tag size.
+    char header[13];
+    if ((ret = fr->read(header, 13, NULL)) != ERROR_SUCCESS) {
+        srs_error("flv index read header failed. ret=%d", ret);
+        fr->lseek(pos);
+        return ret;
+    }
+    if (header[0] != 'F' || header[1] != 'L' || header[2] != 'V') {
+        ret = ERROR_KERNEL_FLV_HEADER;
+        srs_error("flv index header invalid. ret=%d", ret);
+        fr->lseek(pos);
+        return ret;
+    }
+    
+    // the audio points, used when there is no video.
+    std::vector<SrsFlvIndexEntry> audios;
+    
+    char tag_header[SRS_FLV_TAG_HEADER_SIZE];
+    SrsStream stream;
+    for (;;) {
+        int64_t offset = fr->tellg();
+        
+        // a partial tag at the end of file is ignored.
+        if ((ret = fr->read(tag_header, SRS_FLV_TAG_HEADER_SIZE, NULL)) != ERROR_SUCCESS) {
+            break;
+        }
+        
+        if ((ret = stream.initialize(tag_header, SRS_FLV_TAG_HEADER_SIZE)) != ERROR_SUCCESS) {
+            break;
+        }
+        int8_t type = stream.read_1bytes();
+        int32_t data_size = stream.read_3bytes();
+        u_int32_t time = (u_int32_t)stream.read_3bytes();
+        time |= (u_int32_t)(u_int8_t)stream.read_1bytes() << 24;
+        
+        if (offset + SRS_FLV_TAG_HEADER_SIZE + data_size > flv_size) {
+            break;
+        }
+        
+        SrsFlvIndexEntry entry;
+        entry.timestamp = time;
+        entry.offset = offset;
+        
+        int64_t body = fr->tellg();
+        if (type == 0x09 && data_size >= 2) {
+            // 5bytes for the enhanced RTMP header with FourCC.
+            char video[5];
+            int nb_video = srs_min((int)data_size, (int)sizeof(video));
+            if ((ret = fr->read(video, nb_video, NULL)) != ERROR_SUCCESS) {
+                break;
+            }
+            // the entries must be sorted for binary search, ignore the keyframe jump back.
+            if (SrsFlvCodec::video_is_keyframe(video, nb_video) && !SrsFlvCodec::video_is_sequence_header(video, nb_video)
+                && (entries.empty() || time >= entries.back().timestamp)
+            ) {
+                entry.flags = SRS_FLV_INDEX_KEYFRAME;
+                entries.push_back(entry);
+            }
+        } else if (type == 0x08 && entries.empty()) {
+            // signed delta, the audio jump back is ignored.
+            if (audios.empty() || (int64_t)time - (int64_t)audios.back().timestamp >= SRS_FLV_INDEX_AUDIO_INTERVAL) {
+                entry.flags = SRS_FLV_INDEX_AUDIO;
+                audios.push_back(entry);
+            }
+        }
+        
+        fr->lseek(body + data_size + SRS_FLV_PREVIOUS_TAG_SIZE);
+    }
+    ret = ERROR_SUCCESS;
+    
+    if (entries.empty()) {
+        entries = audios;
+    }
+    
+    fr->lseek(pos);
+    srs_info("flv index build %d points, size=%"PRId64, (int)entries.size(), flv_size);
+    
+    return ret;
+}
+
+int SrsFlvIndex::load(string path, int64_t size, int64_t mtime)
+{
+    int ret = ERROR_SUCCESS;
+    
+    SrsFileReader fr;
+    if ((ret = fr.open(path)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    int64_t nb_file = fr.filesize();
+    if (nb_file < SRS_FLV_INDEX_HEADER_SIZE || (nb_file - SRS_FLV_INDEX_HEADER_SIZE) % SRS_FLV_INDEX_ENTRY_SIZE) {
+        ret = ERROR_KERNEL_FLV_INDEX;
+        srs_warn("flv index %s size invalid, size=%"PRId64". ret=%d", path.c_str(), nb_file, ret);
+        return ret;
+    }
+    
+    char* data = new char[nb_file];
+    SrsAutoFreeA(char, data);
+    if ((ret = fr.read(data, (size_t)nb_file, NULL)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    SrsStream stream;
+    if ((ret = stream.initialize(data, (int)nb_file)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    bool magic = data[0] == 'F' && data[1] == 'L' && data[2] == 'V' && data[3] == 'I';
+    stream.skip(4);
+    int8_t version = stream.read_1bytes();
+    stream.skip(3);
+    int64_t indexed_size = stream.read_8bytes();
+    int64_t indexed_mtime = stream.read_8bytes();
+    int nb_entries = stream.read_4bytes();
+    
+    if (!magic || version != SRS_FLV_INDEX_VERSION || nb_entries < 0
+        || (int64_t)nb_entries * SRS_FLV_INDEX_ENTRY_SIZE != nb_file - SRS_FLV_INDEX_HEADER_SIZE
+    ) {
+        ret = ERROR_KERNEL_FLV_INDEX;
+        srs_warn("flv index %s invalid, version=%d, entries=%d. ret=%d", path.c_str(), version, nb_entries, ret);
+        return ret;
+    }
+    
+    if (indexed_size != size || indexed_mtime != mtime) {
+        ret = ERROR_KERNEL_FLV_INDEX;
+        srs_warn("flv index %s stale, indexed=%"PRId64"/%"PRId64", size=%"PRId64", mtime=%"PRId64". ret=%d",
+            path.c_str(), indexed_size, indexed_mtime, size, mtime, ret);
+        return ret;
+    }
+    
+    entries.resize(nb_entries);
+    for (int i = 0; i < nb_entries; i++) {
+        SrsFlvIndexEntry& entry = entries[i];
+        entry.timestamp = (u_int32_t)stream.read_4bytes();
+        entry.offset = stream.read_8bytes();
+        entry.flags = stream.read_1bytes();
+    }
+    flv_size = size;
+    flv_mtime = mtime;
+    
+    return ret;
+}
 
+int SrsFlvIndex::save(string path)
+{
+    int ret = ERROR_SUCCESS;
+    
+    int nb_data = SRS_FLV_INDEX_HEADER_SIZE + SRS_FLV_INDEX_ENTRY_SIZE * (int)entries.size();
+    char* data = new char[nb_data];
+    SrsAutoFreeA(char, data);
+    
+    SrsStream stream;
+    if ((ret = stream.initialize(data, nb_data)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    stream.write_bytes((char*)"FLVI", 4);
+    stream.write_1bytes(SRS_FLV_INDEX_VERSION);
+    stream.write_1bytes(0);
+    stream.write_2bytes(0);
+    stream.write_8bytes(flv_size);
+    stream.write_8bytes(flv_mtime);
+    stream.write_4bytes((int32_t)entries.size());
+    
+    std::vector<SrsFlvIndexEntry>::iterator it;
+    for (it = entries.begin(); it != entries.end(); ++it) {
+        SrsFlvIndexEntry& entry = *it;
+        stream.write_4bytes((int32_t)entry.timestamp);
+        stream.write_8bytes(entry.offset);
+        stream.write_1bytes(entry.flags);
+    }
+    
+    std::string tmp = path + ".tmp";
+    
+    if (true) {
+        SrsFileWriter fw;
+        if ((ret = fw.open(tmp)) != ERROR_SUCCESS) {
+            return ret;
+        }
+        if ((ret = fw.write(data, nb_data, NULL)) != ERROR_SUCCESS) {
+            ::remove(tmp.c_str());
+            return ret;
+        }
+        // never replace the index by the partial one.
+        if ((ret = fw.close()) != ERROR_SUCCESS) {
+            ::remove(tmp.c_str());
+            return ret;
+        }
+    }
+    
+    if (::rename(tmp.c_str(), path.c_str()) < 0) {
+        ret = ERROR_SYSTEM_FILE_RENAME;
+        srs_error("rename flv index %s to %s failed. ret=%d", tmp.c_str(), path.c_str(), ret);
+        return ret;
+    }
+    
+    return ret;
+}
+
+int SrsFlvIndex::seek(u_int32_t time, int64_t* poffset, u_int32_t* ptime)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(poffset);
+    
+    if (entries.empty()) {
+        ret = ERROR_KERNEL_FLV_INDEX;
+        srs_warn("flv index empty to seek %u. ret=%d", time, ret);
+        return ret;
+    }
+    
+    // binary search the last point which timestamp <= time.
+    int low = 0;
+    int high = (int)entries.size() - 1;
+    while (low < high) {
+        int mid = low + (high - low + 1) / 2;
+        if (entries[mid].timestamp <= time) {
+            low = mid;
+        } else {
+            high = mid - 1;
+        }
+    }
+    
+    SrsFlvIndexEntry& entry = entries[low];
+    *poffset = entry.offset;
+    if (ptime) {
+        *ptime = entry.timestamp;
+    }
+    
+    return ret;
+}
+
+int SrsFlvIndex::size()
+{
+    return (int)entries.size();
+}
+
+SrsFlvScanStats::SrsFlvScanStats()
+{
+    nb_tags = nb_audios = nb_videos = nb_scripts = nb_keyframes = 0;
+    nb_errors = nb_jumps = 0;
+    error_offset = -1;
+    first_time = last_time = 0;
+    start_time = end_time = 0;
+    video_codec = audio_codec = -1;
+}
+
+/**
+* the chunk to scan by thread.
+*/
+struct SrsFlvScanChunk
+{
+    SrsFlvScanner* scanner;
+    int64_t start;
+    int64_t end;
+    SrsFlvScanStats stats;
+};
+
+SrsFlvScanner::SrsFlvScanner()
+{
+    data = NULL;
+    size = 0;
+}
+
+SrsFlvScanner::~SrsFlvScanner()
+{
+}
+
+int SrsFlvScanner::initialize(SrsFileReader* fr)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(fr);
+    
+    if (!fr->is_mmap()) {
+        ret = ERROR_SYSTEM_IO_INVALID;
+        srs_error("flv scanner requires mmap reader. ret=%d", ret);
+        return ret;
+    }
+    
+    // view the whole file, then restore the position.
+    int64_t pos = fr->tellg();
+    size = fr->filesize();
+    fr->lseek(0);
+    
+    ret = fr->read_view((size_t)size, &data);
+    fr->lseek(pos);
+    
+    if (ret != ERROR_SUCCESS) {
+        srs_error("flv scanner view file failed. ret=%d", ret);
+        return ret;
+    }
+    
+    if (size < 13 || data[0] != 'F' || data[1] != 'L' || data[2] != 'V') {
+        ret = ERROR_KERNEL_FLV_HEADER;
+        srs_error("flv scanner header invalid, size=%"PRId64". ret=%d", size, ret);
+        return ret;
+    }
+    
+    return ret;
+}
+
+int SrsFlvScanner::scan(int nb_threads, SrsFlvScanStats* stats)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(stats);
+    srs_assert(data);
+    
+    if (nb_threads <= 0) {
+#ifndef _WIN32
+        nb_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    }
+    nb_threads = srs_max(1, srs_min(nb_threads, (int)(size / SRS_PERF_FLV_SCAN_CHUNK)));
+    
+    // split at the tag boundaries after the 9bytes header and 4bytes tag size.
+    std::vector<SrsFlvScanChunk> chunks(nb_threads);
+    for (int i = 0; i < nb_threads; i++) {
+        SrsFlvScanChunk& chunk = chunks[i];
+        chunk.scanner = this;
+        chunk.start = 13;
+        chunk.end = size;
+        
+        if (i > 0) {
+            int64_t start = resync(13 + (size - 13) * i / nb_threads, size);
+            chunk.start = srs_max(chunks[i - 1].start, (start < 0)? size : start);
+            chunks[i - 1].end = chunk.start;
+        }
+    }
+    
+    // scan the chunks, the first one in current thread.
+#ifndef _WIN32
+    std::vector<pthread_t> tids(nb_threads);
+    std::vector<bool> started(nb_threads, false);
+    for (int i = 1; i < nb_threads; i++) {
+        started[i] = pthread_create(&tids[i], NULL, worker, &chunks[i]) == 0;
+    }
+#endif
+    
+    for (int i = 0; i < nb_threads; i++) {
+#ifndef _WIN32
+        if (started[i]) {
+            pthread_join(tids[i], NULL);
+            continue;
+        }
+#endif
+        SrsFlvScanChunk& chunk = chunks[i];
+        scan_chunk(chunk.start, chunk.end, &chunk.stats);
+    }
+    
+    // merge the stats of chunks in order.
+    bool got_tag = false;
+    for (int i = 0; i < nb_threads; i++) {
+        SrsFlvScanStats& s = chunks[i].stats;
+        if (s.error_offset >= 0 && stats->error_offset < 0) {
+            stats->error_offset = s.error_offset;
+        }
+        stats->nb_errors += s.nb_errors;
+        
+        if (s.nb_tags <= 0) {
+            continue;
+        }
+        
+        if (!got_tag) {
+            stats->first_time = s.first_time;
+            stats->start_time = s.start_time;
+            stats->end_time = s.end_time;
+        } else if (s.first_time < stats->last_time) {
+            stats->nb_jumps++;
+        }
+        
+        stats->nb_tags += s.nb_tags;
+        stats->nb_audios += s.nb_audios;
+        stats->nb_videos += s.nb_videos;
+        stats->nb_scripts += s.nb_scripts;
+        stats->nb_keyframes += s.nb_keyframes;
+        stats->nb_jumps += s.nb_jumps;
+        stats->last_time = s.last_time;
+        stats->start_time = srs_min(stats->start_time, s.start_time);
+        stats->end_time = srs_max(stats->end_time, s.end_time);
+        
+        if (s.video_codec >= 0) {
+            stats->video_codec = s.video_codec;
+        }
+        if (s.audio_codec >= 0) {
+            stats->audio_codec = s.audio_codec;
+        }
+        got_tag = true;
+    }
+    
+    srs_info("flv scan %"PRId64" tags by %d threads, errors=%"PRId64, stats->nb_tags, nb_threads, stats->nb_errors);
+    
+    return ret;
+}
+
+bool SrsFlvScanner::is_tag(int64_t offset)
+{
+    if (offset < 0 || offset + SRS_FLV_TAG_HEADER_SIZE + SRS_FLV_PREVIOUS_TAG_SIZE > size) {
+        return false;
+    }
+    
+    u_int8_t* p = (u_int8_t*)data + offset;
+    
+    // the filter bit and reserved bits are ignored.
+    int8_t type = p[0] & 0x1f;
+    if (type != 0x08 && type != 0x09 && type != 0x12) {
+        return false;
+    }
+    
+    // StreamID UI24 Always 0.
+    if (p[8] != 0 || p[9] != 0 || p[10] != 0) {
+        return false;
+    }
+    
+    int32_t data_size = (p[1] << 16) | (p[2] << 8) | p[3];
+    if (offset + SRS_FLV_TAG_HEADER_SIZE + data_size + SRS_FLV_PREVIOUS_TAG_SIZE > size) {
+        return false;
+    }
+    
+    // the previous tag size must be the size of this tag.
+    u_int8_t* pts = p + SRS_FLV_TAG_HEADER_SIZE + data_size;
+    u_int32_t tag_size = (pts[0] << 24) | (pts[1] << 16) | (pts[2] << 8) | pts[3];
+    
+    return tag_size == (u_int32_t)(SRS_FLV_TAG_HEADER_SIZE + data_size);
+}
+
+int64_t SrsFlvScanner::resync(int64_t start, int64_t end)
+{
+    for (int64_t offset = start; offset < end; offset++) {
+        if (!is_tag(offset)) {
+            continue;
+        }
+        
+        // the next tag must be valid, or at the end of file.
+        u_int8_t* p = (u_int8_t*)data + offset;
+        int32_t data_size = (p[1] << 16) | (p[2] << 8) | p[3];
+        int64_t next = offset + SRS_FLV_TAG_HEADER_SIZE + data_size + SRS_FLV_PREVIOUS_TAG_SIZE;
+        if (next == size || is_tag(next)) {
+            return offset;
+        }
+    }
+    
+    return -1;
+}
+
+void SrsFlvScanner::scan_chunk(int64_t start, int64_t end, SrsFlvScanStats* stats)
+{
+    int64_t offset = start;
+    
+    while (offset < end) {
+        if (!is_tag(offset)) {
+            if (stats->error_offset < 0) {
+                stats->error_offset = offset;
+            }
+            stats->nb_errors++;
+            
+            if ((offset = resync(offset + 1, end)) < 0) {
+                break;
+            }
+            continue;
+        }
+        
+        u_int8_t* p = (u_int8_t*)data + offset;
+        int8_t type = p[0] & 0x1f;
+        int32_t data_size = (p[1] << 16) | (p[2] << 8) | p[3];
+        u_int32_t time = (u_int32_t)((p[7] << 24) | (p[4] << 16) | (p[5] << 8) | p[6]);
+        char* body = (char*)p + SRS_FLV_TAG_HEADER_SIZE;
+        
+        if (stats->nb_tags == 0) {
+            stats->first_time = stats->start_time = stats->end_time = time;
+        } else if (time < stats->last_time) {
+            stats->nb_jumps++;
+        }
+        stats->nb_tags++;
+        stats->last_time = time;
+        stats->start_time = srs_min(stats->start_time, time);
+        stats->end_time = srs_max(stats->end_time, time);
+        
+        if (type == 0x09) {
+            stats->nb_videos++;
+            if (data_size > 0) {
+                stats->video_codec = SrsFlvCodec::video_is_hevc(body, data_size)? SrsCodecVideoHEVC : body[0] & 0x0f;
+            }
+            if (SrsFlvCodec::video_is_keyframe(body, data_size) && !SrsFlvCodec::video_is_sequence_header(body, data_size)) {
+                stats->nb_keyframes++;
+            }
+        } else if (type == 0x08) {
+            stats->nb_audios++;
+            if (data_size > 0) {
+                stats->audio_codec = (body[0] >> 4) & 0x0f;
+            }
+        } else {
+            stats->nb_scripts++;
+        }
+        
+        offset += SRS_FLV_TAG_HEADER_SIZE + data_size + SRS_FLV_PREVIOUS_TAG_SIZE;
+    }
+}
+
+void* SrsFlvScanner::worker(void* arg)
+{
+    SrsFlvScanChunk* chunk = (SrsFlvScanChunk*)arg;
+    chunk->scanner->scan_chunk(chunk->start, chunk->end, &chunk->stats);
+    return NULL;
+}
+
+SrsFlvRepairStats::SrsFlvRepairStats()
+{
+    nb_tags = nb_errors = nb_drops = nb_jumps = 0;
+    has_audio = has_video = false;
+    duration = 0;
+}
+
+SrsFlvRepairer::SrsFlvRepairer()
+{
+    reader = NULL;
+    buf = NULL;
+    nb_buf = pos = end = 0;
+    eof = corrupt = false;
+    got_tag = false;
+    last_time = last_correct_time = 0;
+    last_audio_time = last_video_time = 0;
+    max_jump = SRS_FLV_REPAIR_MAX_JUMP_MS;
+    got_avc_sh = got_aac_sh = got_keyframe = false;
+}
+
+SrsFlvRepairer::~SrsFlvRepairer()
+{
+    srs_freepa(buf);
+}
+
+int SrsFlvRepairer::initialize(SrsFileReader* fr)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(fr);
+    reader = fr;
+    
+    srs_freepa(buf);
+    nb_buf = SRS_PERF_FLV_REPAIR_BUFFER;
+    buf = new char[nb_buf];
+    pos = end = 0;
+    
+    // 9bytes header and 4bytes first previous-tag-size,
+    // resync from the start when header is corrupt.
+    if (!fill(9) || buf[0] != 'F' || buf[1] != 'L' || buf[2] != 'V') {
+        srs_warn("flv repair header corrupt, resync tags.");
+        _stats.nb_errors++;
+        return ret;
+    }
+    
+    u_int8_t* p = (u_int8_t*)buf;
+    int32_t offset = (p[5] << 24) | (p[6] << 16) | (p[7] << 8) | p[8];
+    if (offset < 9 || offset > SRS_PERF_FLV_REPAIR_BUFFER || !fill(offset + SRS_FLV_PREVIOUS_TAG_SIZE)) {
+        srs_warn("flv repair header offset=%d invalid, resync tags.", offset);
+        _stats.nb_errors++;
+        pos = 9;
+        return ret;
+    }
+    pos = offset + SRS_FLV_PREVIOUS_TAG_SIZE;
+    
+    return ret;
+}
+
+void SrsFlvRepairer::set_max_jump(int v)
+{
+    max_jump = srs_max(0, v);
+}
+
+int SrsFlvRepairer::read_tag(char* ptype, int32_t* psize, u_int32_t* ptime, char** pdata)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(reader);
+    
+    while (true) {
+        // drop the truncated tail.
+        if (!fill(SRS_FLV_TAG_HEADER_SIZE)) {
+            if (end > pos) {
+                srs_warn("flv repair drop truncated tail %d bytes", end - pos);
+                if (!corrupt) {
+                    _stats.nb_errors++;
+                }
+                pos = end;
+            }
+            return ERROR_SYSTEM_FILE_EOF;
+        }
+        
+        // skip the corrupt bytes util the next valid tag.
+        if (!check_tag()) {
+            if (!corrupt) {
+                _stats.nb_errors++;
+                corrupt = true;
+            }
+            pos++;
+            continue;
+        }
+        corrupt = false;
+        
+        u_int8_t* p = (u_int8_t*)buf + pos;
+        char type = (char)(p[0] & 0x1f);
+        int32_t size = (p[1] << 16) | (p[2] << 8) | p[3];
+        u_int32_t time = (u_int32_t)((p[7] << 24) | (p[4] << 16) | (p[5] << 8) | p[6]);
+        char* data = (char*)p + SRS_FLV_TAG_HEADER_SIZE;
+        
+        // the previous tag size of the last tag maybe truncated.
+        pos += srs_min(SRS_FLV_TAG_HEADER_SIZE + size + SRS_FLV_PREVIOUS_TAG_SIZE, end - pos);
+        
+        if (!is_decodable(type, data, size)) {
+            _stats.nb_drops++;
+            continue;
+        }
+        
+        if (type == SrsCodecFlvTagScript) {
+            time = (u_int32_t)last_correct_time;
+        } else {
+            time = correct(type, time);
+        }
+        _stats.nb_tags++;
+        
+        *ptype = type;
+        *psize = size;
+        *ptime = time;
+        *pdata = data;
+        break;
+    }
+    
+    return ret;
+}
+
+SrsFlvRepairStats* SrsFlvRepairer::stats()
+{
+    return &_stats;
+}
+
+bool SrsFlvRepairer::fill(int size)
+{
+    if (end - pos >= size) {
+        return true;
+    }
+    
+    if (eof) {
+        return false;
+    }
+    
+    // move the unparsed bytes to the start of window.
+    if (pos > 0) {
+        if (end > pos) {
+            memmove(buf, buf + pos, end - pos);
+        }
+        end -= pos;
+        pos = 0;
+    }
+    
+    // grow the window for large tag.
+    if (size > nb_buf) {
+        int nb_size = srs_max(size, nb_buf * 2);
+        char* nbuf = new char[nb_size];
+        memcpy(nbuf, buf, end);
+        srs_freepa(buf);
+        buf = nbuf;
+        nb_buf = nb_size;
+    }
+    
+    while (end < size) {
+        ssize_t nread = 0;
+        int ret = reader->read(buf + end, nb_buf - end, &nread);
+        
+        // the read error is also considered as EOF, to output the valid tags.
+        if (ret != ERROR_SUCCESS || nread <= 0) {
+            if (ret != ERROR_SYSTEM_FILE_EOF) {
+                srs_warn("flv repair read failed, as EOF. ret=%d", ret);
+            }
+            eof = true;
+            break;
+        }
+        end += (int)nread;
+    }
+    
+    return end - pos >= size;
+}
+
+bool SrsFlvRepairer::check_tag()
+{
+    if (!is_tag_header((u_int8_t*)buf + pos)) {
+        return false;
+    }
+    
+    u_int8_t* p = (u_int8_t*)buf + pos;
+    int32_t tag_size = SRS_FLV_TAG_HEADER_SIZE + ((p[1] << 16) | (p[2] << 8) | p[3]);
+    
+    // the tag data is truncated.
+    if (!fill(tag_size)) {
+        return false;
+    }
+    
+    // the last tag without previous tag size.
+    if (!fill(tag_size + SRS_FLV_PREVIOUS_TAG_SIZE)) {
+        return true;
+    }
+    
+    // the previous tag size must be the size of this tag.
+    p = (u_int8_t*)buf + pos + tag_size;
+    u_int32_t previous = (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+    if (previous == (u_int32_t)tag_size) {
+        return true;
+    }
+    
+    // some muxer write the wrong previous tag size,
+    // accept it when the next tag is valid, or at the end of file.
+    if (!fill(tag_size + SRS_FLV_PREVIOUS_TAG_SIZE + SRS_FLV_TAG_HEADER_SIZE)) {
+        return end - pos == tag_size + SRS_FLV_PREVIOUS_TAG_SIZE;
+    }
+    return is_tag_header((u_int8_t*)buf + pos + tag_size + SRS_FLV_PREVIOUS_TAG_SIZE);
+}
+
+bool SrsFlvRepairer::is_tag_header(u_int8_t* p)
+{
+    // the filter bit and reserved bits are ignored.
+    int8_t type = p[0] & 0x1f;
+    if (type != SrsCodecFlvTagAudio && type != SrsCodecFlvTagVideo && type != SrsCodecFlvTagScript) {
+        return false;
+    }
+    
+    // StreamID UI24 Always 0.
+    return p[8] == 0 && p[9] == 0 && p[10] == 0;
+}
+
+bool SrsFlvRepairer::is_decodable(char type, char* data, int32_t size)
+{
+    if (size <= 0) {
+        return false;
+    }
+    
+    if (type == SrsCodecFlvTagVideo) {
+        if (!SrsFlvCodec::video_is_acceptable(data, size)) {
+            return false;
+        }
+        
+        // the avc/hevc frames are undecodable before the sequence header.
+        if (SrsFlvCodec::video_is_h264(data, size) || SrsFlvCodec::video_is_hevc(data, size)) {
+            if (SrsFlvCodec::video_is_sequence_header(data, size)) {
+                got_avc_sh = true;
+                return true;
+            }
+            if (!got_avc_sh) {
+                return false;
+            }
+        }
+        
+        // the inter frames are undecodable before the keyframe.
+        if (SrsFlvCodec::video_is_keyframe(data, size)) {
+            got_keyframe = true;
+        }
+        if (!got_keyframe) {
+            return false;
+        }
+        
+        _stats.has_video = true;
+        return true;
+    }
+    
+    if (type == SrsCodecFlvTagAudio) {
+        // the aac frames are undecodable before the sequence header.
+        if (SrsFlvCodec::audio_is_aac(data, size)) {
+            if (SrsFlvCodec::audio_is_sequence_header(data, size)) {
+                got_aac_sh = true;
+            }
+            if (!got_aac_sh) {
+                return false;
+            }
+        }
+        
+        _stats.has_audio = true;
+        return true;
+    }
+    
+    return true;
+}
+
+u_int32_t SrsFlvRepairer::correct(char type, u_int32_t time)
+{
+    // start at 0, and use the delta of input timestamp,
+    // use the default delta when jitter or jump over max_jump.
+    if (!got_tag) {
+        got_tag = true;
+        last_correct_time = 0;
+    } else {
+        int64_t delta = (int64_t)time - last_time;
+        if (delta < -SRS_FLV_REPAIR_MAX_JITTER_MS || (max_jump > 0 && delta > max_jump)) {
+            delta = SRS_FLV_REPAIR_DEFAULT_FRAME_MS;
+            _stats.nb_jumps++;
+        }
+        last_correct_time = srs_max(0, last_correct_time + delta);
+    }
+    last_time = time;
+    
+    // the timestamp of each stream must be monotonic.
+    int64_t ts = last_correct_time;
+    if (type == SrsCodecFlvTagAudio) {
+        ts = last_audio_time = srs_max(ts, last_audio_time);
+    } else {
+        ts = last_video_time = srs_max(ts, last_video_time);
+    }
+    
+    _stats.duration = srs_max(_stats.duration, (u_int32_t)ts);
+    
+    return (u_int32_t)ts;
+}
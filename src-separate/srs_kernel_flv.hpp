@@ -30,6 +30,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <srs_core.hpp>
 
 #include <string>
+#include <vector>
 
 // for srs-librtmp, @see https://github.com/ossrs/srs/issues/213
 #ifndef _WIN32
@@ -542,6 +543,13 @@ public:
     */
     virtual int read_tag_data(char* data, int32_t size);
     /**
+    * read the tag data without copy, only for reader in mmap mode.
+    * @param pdata output the tag data in the mapped file,
+    *       which is valid util the reader closed.
+    * @remark assert pdata not NULL.
+    */
+    virtual int read_tag_data_view(char** pdata, int32_t size);
+    /**
     * read the 4bytes previous tag size.
     * @remark assert previous_tag_size not NULL.
     */
@@ -591,5 +599,256 @@ public:
     virtual int lseek(int64_t offset);
 };
 
+/**
+* the seekable point of flv, the video keyframe,
+* or the audio tag when there is no video.
+*/
+struct SrsFlvIndexEntry
+{
+    // the timestamp of tag in ms.
+    u_int32_t timestamp;
+    // the start offset of tag header in file.
+    int64_t offset;
+    // SRS_FLV_INDEX_KEYFRAME or SRS_FLV_INDEX_AUDIO.
+    int8_t flags;
+};
+
+#define SRS_FLV_INDEX_KEYFRAME 0x01
+#define SRS_FLV_INDEX_AUDIO 0x02
+
+/**
+* the keyframe index of flv, to seek to the keyframe by time
+* in O(log n) without scanning the whole file.
+* the index is saved to a binary sidecar file, in big-endian:
+*       4B magic "FLVI", 1B version, 3B reserved,
+*       8B flv file size, 8B flv mtime in ms, 4B count of entries,
+*       then each entry is 4B timestamp, 8B offset and 1B flags.
+* the sidecar is stale when the flv file size or mtime changed.
+*/
+class SrsFlvIndex
+{
+private:
+    std::vector<SrsFlvIndexEntry> entries;
+    // the size of flv file indexed.
+    int64_t flv_size;
+    // the modify time in ms of flv file indexed.
+    int64_t flv_mtime;
+public:
+    SrsFlvIndex();
+    virtual ~SrsFlvIndex();
+public:
+    /**
+    * build the index by scanning all tags of flv file,
+    * only the tag header and first 2bytes of video are read.
+    * @remark the position of reader is restored after build.
+    */
+    virtual int build(SrsFileReader* fr);
+    /**
+    * load the index from sidecar file.
+    * @param size the size of flv file, the index must match it.
+    * @param mtime the modify time in ms of flv file, the index must match it.
+    * @return ERROR_KERNEL_FLV_INDEX when sidecar is invalid or stale.
+    */
+    virtual int load(std::string path, int64_t size, int64_t mtime);
+    /**
+    * save the index to sidecar file, write to a temp file
+    * then rename to path, so readers never see partial index.
+    */
+    virtual int save(std::string path);
+    /**
+    * find the last seekable point at or before the time,
+    * or the first point when time is before it.
+    * @param poffset output the offset of tag header.
+    * @param ptime output the timestamp of tag.
+    * @return ERROR_KERNEL_FLV_INDEX when index is empty.
+    */
+    virtual int seek(u_int32_t time, int64_t* poffset, u_int32_t* ptime);
+    /**
+    * get the count of seekable points.
+    */
+    virtual int size();
+};
+
+/**
+* the statistics of flv scanner.
+*/
+struct SrsFlvScanStats
+{
+    int64_t nb_tags;
+    int64_t nb_audios;
+    int64_t nb_videos;
+    int64_t nb_scripts;
+    int64_t nb_keyframes;
+    // the corrupt tags, invalid type, size or previous tag size,
+    // including the truncated tag at the end of file.
+    int64_t nb_errors;
+    // the offset of first corrupt tag, -1 for none.
+    int64_t error_offset;
+    // the count of timestamp jump backward.
+    int64_t nb_jumps;
+    // the timestamp of the first and last tag.
+    u_int32_t first_time;
+    u_int32_t last_time;
+    // the min and max timestamp of tags.
+    u_int32_t start_time;
+    u_int32_t end_time;
+    // the SrsCodecVideo and SrsCodecAudio, -1 for none.
+    int video_codec;
+    int audio_codec;
+    
+    SrsFlvScanStats();
+};
+
+/**
+* scan and validate the flv file in parallel, the file is split to chunks
+* at tag boundaries, resynchronized by the previous tag size,
+* then the chunks are scanned by threads and the stats are merged.
+* @remark the reader must be opened in mmap mode.
+*/
+class SrsFlvScanner
+{
+private:
+    // the whole mapped file.
+    char* data;
+    int64_t size;
+public:
+    SrsFlvScanner();
+    virtual ~SrsFlvScanner();
+public:
+    /**
+    * initialize the scanner by the reader in mmap mode.
+    * @remark the reader must be alive when scan.
+    */
+    virtual int initialize(SrsFileReader* fr);
+    /**
+    * scan the file by threads.
+    * @param nb_threads the max threads, 0 to use the cpu cores.
+    */
+    virtual int scan(int nb_threads, SrsFlvScanStats* stats);
+private:
+    /**
+    * whether the offset is the start of tag, and its previous tag size matches.
+    */
+    virtual bool is_tag(int64_t offset);
+    /**
+    * find the first tag in [start, end) which next tag is also valid.
+    * @return the offset of tag, -1 for not found.
+    */
+    virtual int64_t resync(int64_t start, int64_t end);
+    /**
+    * scan the tags which start in [start, end).
+    */
+    virtual void scan_chunk(int64_t start, int64_t end, SrsFlvScanStats* stats);
+    static void* worker(void* arg);
+};
+
+// the max jitter of timestamp, the delta of tags out of
+// [-SRS_FLV_REPAIR_MAX_JITTER_MS, max_jump] is corrected,
+// where the max_jump default to SRS_FLV_REPAIR_MAX_JUMP_MS.
+#define SRS_FLV_REPAIR_MAX_JITTER_MS 1000
+#define SRS_FLV_REPAIR_MAX_JUMP_MS 10000
+// the delta to use when timestamp is corrected.
+#define SRS_FLV_REPAIR_DEFAULT_FRAME_MS 10
+
+/**
+* the statistics of flv repairer.
+*/
+struct SrsFlvRepairStats
+{
+    // the valid tags output.
+    int64_t nb_tags;
+    // the corrupt regions skipped, including the truncated tail.
+    int64_t nb_errors;
+    // the valid tags dropped, for no sequence header or keyframe before it.
+    int64_t nb_drops;
+    // the timestamps corrected.
+    int64_t nb_jumps;
+    // whether got audio or video tags.
+    bool has_audio;
+    bool has_video;
+    // the timestamp of the last tag, that is the duration.
+    u_int32_t duration;
+    
+    SrsFlvRepairStats();
+};
+
+/**
+* repair the flv file in a single pass over the buffered reader,
+* resync the corrupt tags by the previous tag size, drop the truncated tail,
+* the undecodable tags before the sequence header or keyframe,
+* and correct the timestamp to monotonic, start at 0.
+*/
+class SrsFlvRepairer
+{
+private:
+    SrsFileReader* reader;
+    // the window of file to resync, [pos, end) is unparsed.
+    char* buf;
+    int nb_buf;
+    int pos;
+    int end;
+    bool eof;
+    // whether in the corrupt region, to count the region once.
+    bool corrupt;
+    // the last input and output timestamp for jitter correction.
+    bool got_tag;
+    int64_t last_time;
+    int64_t last_correct_time;
+    int64_t last_audio_time;
+    int64_t last_video_time;
+    // the max forward jump in ms to keep, 0 to keep all.
+    int max_jump;
+    // whether got the sequence header and keyframe of stream.
+    bool got_avc_sh;
+    bool got_aac_sh;
+    bool got_keyframe;
+    SrsFlvRepairStats _stats;
+public:
+    SrsFlvRepairer();
+    virtual ~SrsFlvRepairer();
+public:
+    /**
+    * initialize the repairer by the reader, read the flv header.
+    * @remark the header is skipped when corrupt, the tags are resync.
+    */
+    virtual int initialize(SrsFileReader* fr);
+    /**
+    * set the max forward jump of timestamp in ms to keep, for example,
+    * the pause of publisher, the larger jump is corrupt and corrected.
+    * @param v the max jump in ms, 0 to keep all forward jumps.
+    */
+    virtual void set_max_jump(int v);
+    /**
+    * read the next valid tag, the timestamp is corrected.
+    * @param pdata output the data of tag, valid until next read.
+    * @return ERROR_SYSTEM_FILE_EOF when no more valid tag.
+    */
+    virtual int read_tag(char* ptype, int32_t* psize, u_int32_t* ptime, char** pdata);
+    virtual SrsFlvRepairStats* stats();
+private:
+    /**
+    * ensure there are size bytes in window from pos.
+    * @return false when EOF before size bytes.
+    */
+    virtual bool fill(int size);
+    /**
+    * whether the tag at pos of window is valid and completed,
+    * its previous tag size matches, or the next tag is valid.
+    */
+    virtual bool check_tag();
+    /**
+    * whether the bytes is a valid tag header.
+    */
+    virtual bool is_tag_header(u_int8_t* p);
+    /**
+    * whether the tag is decodable, update the state of stream.
+    */
+    virtual bool is_decodable(char type, char* data, int32_t size);
+    /**
+    * correct the timestamp of tag.
+    */
+    virtual u_int32_t correct(char type, u_int32_t time);
+};
+
 #endif
 
@@ -0,0 +1,751 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2015 SRS(ossrs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <srs_kernel_hls.hpp>
+
+#if !defined(SRS_EXPORT_LIBRTMP)
+
+#include <stdio.h>
+#include <unistd.h>
+#include <math.h>
+#include <sstream>
+using namespace std;
+
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_file.hpp>
+#include <srs_kernel_codec.hpp>
+#include <srs_kernel_consts.hpp>
+#include <srs_kernel_ts.hpp>
+#include <srs_kernel_utility.hpp>
+
+SrsHlsSegment::SrsHlsSegment()
+{
+    duration = 0;
+    sequence_no = 0;
+    segment_start_dts = 0;
+}
+
+SrsHlsSegment::~SrsHlsSegment()
+{
+}
+
+void SrsHlsSegment::update_duration(int64_t current_frame_dts)
+{
+    // we use dts to calc the duration,
+    // for the frame of previous segment may be later than the first one.
+    if (current_frame_dts < segment_start_dts) {
+        return;
+    }
+    
+    duration = (current_frame_dts - segment_start_dts) / 90000.0;
+}
+
+SrsHlsSegmentWriter::SrsHlsSegmentWriter()
+{
+    part = new SrsFileWriter();
+}
+
+SrsHlsSegmentWriter::~SrsHlsSegmentWriter()
+{
+    srs_freep(part);
+}
+
+int SrsHlsSegmentWriter::open_part(string p)
+{
+    return part->open(p);
+}
+
+int SrsHlsSegmentWriter::close_part()
+{
+    return part->close();
+}
+
+void SrsHlsSegmentWriter::set_sync(SrsFileSync v)
+{
+    SrsFileWriter::set_sync(v);
+    part->set_sync(v);
+}
+
+int SrsHlsSegmentWriter::writev(iovec* iov, int iovcnt, ssize_t* pnwrite)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if ((ret = SrsFileWriter::writev(iov, iovcnt, pnwrite)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    if (part->is_open() && (ret = part->writev(iov, iovcnt, NULL)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    return ret;
+}
+
+SrsHlsEncoder::SrsHlsEncoder()
+{
+    hls_fragment = 0;
+    hls_window = 0;
+    hls_cleanup = false;
+    hls_part = 0;
+    hls_sync = false;
+    
+    sequence_no = 0;
+    target_duration = 0;
+    has_video = false;
+    current = NULL;
+    part_opened = false;
+    part_independent = false;
+    part_start_dts = 0;
+    part_last_dts = 0;
+    part_interval = 0;
+    
+    writer = new SrsHlsSegmentWriter();
+    codec = new SrsAvcAacCodec();
+    sample = new SrsCodecSample();
+    cache = new SrsTsCache();
+    context = new SrsTsContext();
+    muxer = new SrsTSMuxer(writer, context, SrsCodecAudioAAC, SrsCodecVideoAVC);
+}
+
+SrsHlsEncoder::~SrsHlsEncoder()
+{
+    std::vector<SrsHlsSegment*>::iterator it;
+    for (it = segments.begin(); it != segments.end(); ++it) {
+        SrsHlsSegment* segment = *it;
+        srs_freep(segment);
+    }
+    segments.clear();
+    
+    srs_freep(current);
+    srs_freep(muxer);
+    srs_freep(writer);
+    srs_freep(codec);
+    srs_freep(sample);
+    srs_freep(cache);
+    srs_freep(context);
+}
+
+int SrsHlsEncoder::initialize(string m3u8_file, int fragment_ms, int window_ms, bool cleanup)
+{
+    int ret = ERROR_SUCCESS;
+    
+    m3u8 = m3u8_file;
+    
+    // the segments in the dir of m3u8, named by the m3u8 without ext.
+    size_t pos = string::npos;
+    if ((pos = m3u8.rfind("/")) != string::npos) {
+        ts_dir = m3u8.substr(0, pos + 1);
+    }
+    ts_prefix = m3u8.substr(ts_dir.length());
+    if ((pos = ts_prefix.rfind(".")) != string::npos) {
+        ts_prefix = ts_prefix.substr(0, pos);
+    }
+    
+    hls_fragment = srs_max(0, fragment_ms) / 1000.0;
+    hls_window = srs_max(0, window_ms) / 1000.0;
+    hls_cleanup = cleanup;
+    target_duration = srs_max(1, (int)ceil(hls_fragment * SRS_HLS_TD_RATIO));
+    
+    delta_m3u8 = ts_dir + ts_prefix + "_delta.m3u8";
+    
+    return ret;
+}
+
+int SrsHlsEncoder::set_part(int part_ms)
+{
+    int ret = ERROR_SUCCESS;
+    
+    // the segment written is not in parts.
+    if (current || !segments.empty()) {
+        ret = ERROR_HLS_PART_AFTER_WRITE;
+        srs_error("hls: set part after frame written. ret=%d", ret);
+        return ret;
+    }
+    
+    hls_part = srs_max(0, part_ms) / 1000.0;
+    
+    return ret;
+}
+
+void SrsHlsEncoder::set_sync(bool v)
+{
+    hls_sync = v;
+    writer->set_sync(v? SrsFileSyncClose : SrsFileSyncNone);
+}
+
+bool SrsHlsEncoder::is_ready(int msn, int part)
+{
+    // the reaped segments.
+    int next = current? current->sequence_no : sequence_no;
+    if (msn < next) {
+        return true;
+    }
+    
+    // the parts of current segment.
+    if (current && msn == current->sequence_no && part >= 0) {
+        return part < (int)current->parts.size();
+    }
+    
+    return false;
+}
+
+int SrsHlsEncoder::write_audio(int64_t timestamp, char* data, int size)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(data);
+    
+    sample->clear();
+    if ((ret = codec->audio_aac_demux(data, size, sample)) != ERROR_SUCCESS) {
+        if (ret != ERROR_HLS_TRY_MP3) {
+            srs_error("hls: aac demux audio failed. ret=%d", ret);
+            return ret;
+        }
+        if ((ret = codec->audio_mp3_demux(data, size, sample)) != ERROR_SUCCESS) {
+            srs_error("hls: mp3 demux audio failed. ret=%d", ret);
+            return ret;
+        }
+    }
+    SrsCodecAudio acodec = (SrsCodecAudio)codec->audio_codec_id;
+    
+    // ts support audio codec: aac/mp3
+    if (acodec != SrsCodecAudioAAC && acodec != SrsCodecAudioMP3) {
+        return ret;
+    }
+    
+    // when codec changed, write new header.
+    if ((ret = muxer->update_acodec(acodec)) != ERROR_SUCCESS) {
+        srs_error("hls: audio write header failed. ret=%d", ret);
+        return ret;
+    }
+    
+    // for aac: ignore sequence header
+    if (acodec == SrsCodecAudioAAC && sample->aac_packet_type == SrsCodecAudioTypeSequenceHeader) {
+        return ret;
+    }
+    
+    int64_t dts = timestamp * 90;
+    
+    // for pure audio, reap the segment at any frame,
+    // and always reap when reach the target duration.
+    if (current) {
+        current->update_duration(dts);
+        if ((!has_video && current->duration >= hls_fragment) || current->duration >= target_duration) {
+            if ((ret = segment_close(false)) != ERROR_SUCCESS) {
+                return ret;
+            }
+        }
+    }
+    
+    if (!current && (ret = segment_open(dts)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    current->update_duration(dts);
+    
+    // the audio is always independent for the pure audio.
+    if ((ret = part_update(dts, !has_video)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // write audio to cache.
+    if ((ret = cache->cache_audio(codec, dts, sample)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    return flush_audio();
+}
+
+int SrsHlsEncoder::write_video(int64_t timestamp, char* data, int size)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(data);
+    
+    sample->clear();
+    if ((ret = codec->video_avc_demux(data, size, sample)) != ERROR_SUCCESS) {
+        srs_error("hls: codec demux video failed. ret=%d", ret);
+        return ret;
+    }
+    
+    // ignore info frame,
+    // @see https://github.com/ossrs/srs/issues/288#issuecomment-69863909
+    if (sample->frame_type == SrsCodecVideoAVCFrameVideoInfoFrame) {
+        return ret;
+    }
+    
+    if (codec->video_codec_id != SrsCodecVideoAVC && codec->video_codec_id != SrsCodecVideoHEVC) {
+        return ret;
+    }
+    
+    // when codec changed, write new header.
+    if ((ret = muxer->update_vcodec((SrsCodecVideo)codec->video_codec_id)) != ERROR_SUCCESS) {
+        srs_error("hls: video write header failed. ret=%d", ret);
+        return ret;
+    }
+    
+    // ignore sequence header
+    if (sample->frame_type == SrsCodecVideoAVCFrameKeyFrame
+         && sample->avc_packet_type == SrsCodecVideoAVCTypeSequenceHeader) {
+        return ret;
+    }
+    has_video = true;
+    
+    int64_t dts = timestamp * 90;
+    
+    // reap the segment at keyframe, so each segment starts with keyframe,
+    // while the segment without keyframe is reaped at the target duration.
+    if (current) {
+        bool keyframe = sample->frame_type == SrsCodecVideoAVCFrameKeyFrame;
+        current->update_duration(dts);
+        if ((keyframe && current->duration >= hls_fragment) || current->duration >= target_duration) {
+            if ((ret = segment_close(false)) != ERROR_SUCCESS) {
+                return ret;
+            }
+        }
+    }
+    
+    if (!current && (ret = segment_open(dts)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    current->update_duration(dts);
+    
+    if ((ret = part_update(dts, sample->frame_type == SrsCodecVideoAVCFrameKeyFrame)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // write video to cache.
+    if ((ret = cache->cache_video(codec, dts, sample)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    return flush_video();
+}
+
+int SrsHlsEncoder::close()
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (current) {
+        return segment_close(true);
+    }
+    
+    if (!segments.empty()) {
+        return refresh_m3u8(true);
+    }
+    
+    return ret;
+}
+
+int SrsHlsEncoder::segment_open(int64_t segment_start_dts)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(!current);
+    
+    current = new SrsHlsSegment();
+    current->sequence_no = sequence_no++;
+    current->segment_start_dts = segment_start_dts;
+    
+    std::stringstream ss;
+    ss << ts_prefix << "-" << current->sequence_no << ".ts";
+    current->uri = ss.str();
+    current->full_path = ts_dir + current->uri;
+    
+    // open the tmp file, the PSI is written when the first frame written.
+    std::string tmp_file = current->full_path + ".tmp";
+    if ((ret = muxer->open(tmp_file)) != ERROR_SUCCESS) {
+        srs_error("hls: open segment %s failed. ret=%d", tmp_file.c_str(), ret);
+        return ret;
+    }
+    srs_info("hls: open segment %s, seq=%d", tmp_file.c_str(), current->sequence_no);
+    
+    return ret;
+}
+
+int SrsHlsEncoder::segment_close(bool end)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(current);
+    
+    // the last part is the left of segment.
+    if (part_opened) {
+        double duration = current->duration;
+        std::vector<SrsHlsPart>::iterator it;
+        for (it = current->parts.begin(); it != current->parts.end(); ++it) {
+            duration -= it->duration;
+        }
+        if ((ret = part_close(srs_max(0, duration))) != ERROR_SUCCESS) {
+            return ret;
+        }
+    }
+    
+    SrsHlsSegment* segment = current;
+    current = NULL;
+    
+    // the ts must be flushed to disk before rename, or the player gets a partial ts.
+    std::string tmp_file = segment->full_path + ".tmp";
+    if ((ret = muxer->close()) != ERROR_SUCCESS) {
+        srs_error("hls: close segment %s failed. ret=%d", tmp_file.c_str(), ret);
+        segment_discard(segment);
+        return ret;
+    }
+    if (::rename(tmp_file.c_str(), segment->full_path.c_str()) < 0) {
+        ret = ERROR_SYSTEM_FILE_RENAME;
+        srs_error("hls: rename %s to %s failed. ret=%d", tmp_file.c_str(), segment->full_path.c_str(), ret);
+        segment_discard(segment);
+        return ret;
+    }
+    srs_info("hls: reap segment %s, duration=%.3f", segment->full_path.c_str(), segment->duration);
+    
+    segments.push_back(segment);
+    
+    // shrink the segments out of window, but keep the newest.
+    int remove_index = -1;
+    double duration = 0;
+    for (int i = (int)segments.size() - 1; i >= 0; i--) {
+        duration += segments[i]->duration;
+        if (duration > hls_window) {
+            remove_index = i;
+            break;
+        }
+    }
+    
+    std::vector<SrsHlsSegment*> expired;
+    for (int i = 0; i < remove_index && !segments.empty(); i++) {
+        expired.push_back(segments[0]);
+        segments.erase(segments.begin());
+    }
+    
+    // refresh the m3u8 before remove the ts, for the player may reading it.
+    ret = refresh_m3u8(end);
+    
+    std::vector<SrsHlsSegment*>::iterator it;
+    for (it = expired.begin(); it != expired.end(); ++it) {
+        SrsHlsSegment* segment = *it;
+        if (hls_cleanup && ::unlink(segment->full_path.c_str()) < 0) {
+            srs_warn("hls: cleanup segment %s failed.", segment->full_path.c_str());
+        }
+        for (int i = 0; hls_cleanup && i < (int)segment->parts.size(); i++) {
+            std::string part_file = ts_dir + segment->parts[i].uri;
+            if (::unlink(part_file.c_str()) < 0) {
+                srs_warn("hls: cleanup part %s failed.", part_file.c_str());
+            }
+        }
+        srs_freep(segment);
+    }
+    
+    return ret;
+}
+
+void SrsHlsEncoder::segment_discard(SrsHlsSegment* segment)
+{
+    int ret = ERROR_SUCCESS;
+    
+    std::string tmp_file = segment->full_path + ".tmp";
+    if (::unlink(tmp_file.c_str()) < 0) {
+        srs_warn("hls: remove segment %s failed.", tmp_file.c_str());
+    }
+    
+    // the parts are listed in m3u8, refresh it without them before remove.
+    std::vector<SrsHlsPart> parts = segment->parts;
+    srs_freep(segment);
+    
+    if (!parts.empty() && (ret = refresh_m3u8(false)) != ERROR_SUCCESS) {
+        srs_warn("hls: refresh m3u8 without the discarded parts failed. ret=%d", ret);
+    }
+    
+    std::vector<SrsHlsPart>::iterator it;
+    for (it = parts.begin(); it != parts.end(); ++it) {
+        std::string part_file = ts_dir + it->uri;
+        if (::unlink(part_file.c_str()) < 0) {
+            srs_warn("hls: remove part %s failed.", part_file.c_str());
+        }
+    }
+}
+
+int SrsHlsEncoder::refresh_m3u8(bool end)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (segments.empty() && (!current || current->parts.empty())) {
+        return ret;
+    }
+    
+    if ((ret = write_m3u8(m3u8, generate_m3u8(end, false))) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    if (hls_part > 0 && (ret = write_m3u8(delta_m3u8, generate_m3u8(end, true))) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    return ret;
+}
+
+string SrsHlsEncoder::generate_m3u8(bool end, bool delta)
+{
+    std::stringstream ss;
+    ss.precision(3);
+    ss.setf(std::ios::fixed, std::ios::floatfield);
+    
+    // the EXT-X-SKIP requires version 9.
+    ss << "#EXTM3U" << SRS_CONSTS_LF
+        << "#EXT-X-VERSION:" << (hls_part > 0? 9 : 3) << SRS_CONSTS_LF
+        << "#EXT-X-TARGETDURATION:" << target_duration << SRS_CONSTS_LF;
+    
+    // the skip boundary must be at least six times the target duration,
+    // and the part hold back at least twice the part target, use three.
+    double skip_until = 6.0 * target_duration;
+    if (hls_part > 0) {
+        ss << "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,CAN-SKIP-UNTIL=" << skip_until
+            << ",PART-HOLD-BACK=" << 3 * hls_part << SRS_CONSTS_LF
+            << "#EXT-X-PART-INF:PART-TARGET=" << hls_part << SRS_CONSTS_LF;
+    }
+    
+    int sequence = segments.empty()? current->sequence_no : segments[0]->sequence_no;
+    ss << "#EXT-X-MEDIA-SEQUENCE:" << sequence << SRS_CONSTS_LF;
+    
+    // the segments older than the skip boundary are skipped in delta,
+    // and the parts are removed when older than three target durations.
+    int nb_skips = 0;
+    int parts_index = (int)segments.size();
+    double duration = 0;
+    for (int i = (int)segments.size() - 1; i >= 0; i--) {
+        duration += segments[i]->duration;
+        if (duration <= 3.0 * target_duration) {
+            parts_index = i;
+        }
+        if (delta && duration > skip_until) {
+            nb_skips = i + 1;
+            break;
+        }
+    }
+    if (nb_skips > 0) {
+        ss << "#EXT-X-SKIP:SKIPPED-SEGMENTS=" << nb_skips << SRS_CONSTS_LF;
+    }
+    
+    for (int i = nb_skips; i < (int)segments.size(); i++) {
+        SrsHlsSegment* segment = segments[i];
+        if (i >= parts_index) {
+            generate_parts(ss, segment);
+        }
+        ss << "#EXTINF:" << segment->duration << "," << SRS_CONSTS_LF
+            << segment->uri << SRS_CONSTS_LF;
+    }
+    
+    // the parts of current segment, and hint the next part.
+    if (hls_part > 0 && !end) {
+        if (current) {
+            generate_parts(ss, current);
+        }
+        int index = current? (int)current->parts.size() : 0;
+        ss << "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"" << part_uri(sequence_no - (current? 1 : 0), index) << "\"" << SRS_CONSTS_LF;
+    }
+    
+    if (end) {
+        ss << "#EXT-X-ENDLIST" << SRS_CONSTS_LF;
+    }
+    
+    return ss.str();
+}
+
+void SrsHlsEncoder::generate_parts(std::stringstream& ss, SrsHlsSegment* segment)
+{
+    std::vector<SrsHlsPart>::iterator it;
+    for (it = segment->parts.begin(); it != segment->parts.end(); ++it) {
+        SrsHlsPart& part = *it;
+        ss << "#EXT-X-PART:DURATION=" << part.duration << ",URI=\"" << part.uri << "\"";
+        if (part.independent) {
+            ss << ",INDEPENDENT=YES";
+        }
+        ss << SRS_CONSTS_LF;
+    }
+}
+
+string SrsHlsEncoder::part_uri(int sequence, int index)
+{
+    std::stringstream ss;
+    ss << ts_prefix << "-" << sequence << "." << index << ".ts";
+    return ss.str();
+}
+
+int SrsHlsEncoder::write_m3u8(string path, string body)
+{
+    int ret = ERROR_SUCCESS;
+    
+    std::string tmp_file = path + ".tmp";
+    
+    if (true) {
+        SrsFileWriter fw;
+        if ((ret = fw.open(tmp_file)) != ERROR_SUCCESS) {
+            srs_error("hls: open m3u8 %s failed. ret=%d", tmp_file.c_str(), ret);
+            return ret;
+        }
+        if (hls_sync) {
+            fw.set_sync(SrsFileSyncClose);
+        }
+        if ((ret = fw.write((void*)body.data(), body.length(), NULL)) != ERROR_SUCCESS) {
+            srs_error("hls: write m3u8 %s failed. ret=%d", tmp_file.c_str(), ret);
+            fw.close();
+            ::unlink(tmp_file.c_str());
+            return ret;
+        }
+        if ((ret = fw.close()) != ERROR_SUCCESS) {
+            srs_error("hls: close m3u8 %s failed. ret=%d", tmp_file.c_str(), ret);
+            ::unlink(tmp_file.c_str());
+            return ret;
+        }
+    }
+    
+    if (::rename(tmp_file.c_str(), path.c_str()) < 0) {
+        ret = ERROR_SYSTEM_FILE_RENAME;
+        srs_error("hls: rename %s to %s failed. ret=%d", tmp_file.c_str(), path.c_str(), ret);
+        ::unlink(tmp_file.c_str());
+        return ret;
+    }
+    
+    return ret;
+}
+
+int SrsHlsEncoder::part_update(int64_t dts, bool independent)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (hls_part <= 0) {
+        return ret;
+    }
+    
+    // reap the part before the frame, when the part with the frame,
+    // about the max interval of frames, will exceed the part target.
+    if (part_opened) {
+        if (dts > part_last_dts) {
+            part_interval = srs_max(part_interval, dts - part_last_dts);
+            part_last_dts = dts;
+        }
+        double duration = (dts - part_start_dts) / 90000.0;
+        if (duration + part_interval / 90000.0 <= hls_part) {
+            return ret;
+        }
+        if ((ret = part_close(duration)) != ERROR_SUCCESS) {
+            return ret;
+        }
+    }
+    
+    if ((ret = part_open(dts, independent)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // refresh when part reaped, or the first part of segment,
+    // to update the preload hint.
+    return refresh_m3u8(false);
+}
+
+int SrsHlsEncoder::part_open(int64_t dts, bool independent)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(current && !part_opened);
+    
+    std::string tmp_file = ts_dir + part_uri(current->sequence_no, (int)current->parts.size()) + ".tmp";
+    if ((ret = writer->open_part(tmp_file)) != ERROR_SUCCESS) {
+        srs_error("hls: open part %s failed. ret=%d", tmp_file.c_str(), ret);
+        return ret;
+    }
+    
+    // write the PSI for the player to start at the independent part.
+    if (independent && !current->parts.empty()) {
+        context->reset();
+    }
+    
+    part_opened = true;
+    part_independent = independent;
+    part_start_dts = part_last_dts = dts;
+    part_interval = 0;
+    
+    return ret;
+}
+
+int SrsHlsEncoder::part_close(double duration)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(current && part_opened);
+    
+    part_opened = false;
+    
+    SrsHlsPart part;
+    part.duration = duration;
+    part.uri = part_uri(current->sequence_no, (int)current->parts.size());
+    part.independent = part_independent;
+    
+    // the part must be flushed to disk before rename, or the player gets a partial ts.
+    std::string part_file = ts_dir + part.uri;
+    std::string tmp_file = part_file + ".tmp";
+    if ((ret = writer->close_part()) != ERROR_SUCCESS) {
+        srs_error("hls: close part %s failed. ret=%d", tmp_file.c_str(), ret);
+        ::unlink(tmp_file.c_str());
+        return ret;
+    }
+    if (::rename(tmp_file.c_str(), part_file.c_str()) < 0) {
+        ret = ERROR_SYSTEM_FILE_RENAME;
+        srs_error("hls: rename %s to %s failed. ret=%d", tmp_file.c_str(), part_file.c_str(), ret);
+        ::unlink(tmp_file.c_str());
+        return ret;
+    }
+    current->parts.push_back(part);
+    
+    return ret;
+}
+
+int SrsHlsEncoder::flush_audio()
+{
+    int ret = ERROR_SUCCESS;
+    
+    if ((ret = muxer->write_audio(cache->audio)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // write success, clear and free the ts message.
+    srs_freep(cache->audio);
+    
+    return ret;
+}
+
+int SrsHlsEncoder::flush_video()
+{
+    int ret = ERROR_SUCCESS;
+    
+    if ((ret = muxer->write_video(cache->video)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // write success, clear and free the ts message.
+    srs_freep(cache->video);
+    
+    return ret;
+}
+
+#endif
+
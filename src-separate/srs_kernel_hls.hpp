@@ -0,0 +1,282 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2015 SRS(ossrs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef SRS_KERNEL_HLS_HPP
+#define SRS_KERNEL_HLS_HPP
+
+/*
+#include <srs_kernel_hls.hpp>
+*/
+#include <srs_core.hpp>
+
+#if !defined(SRS_EXPORT_LIBRTMP)
+
+#include <string>
+#include <vector>
+#include <sstream>
+
+#include <srs_kernel_file.hpp>
+
+class SrsAvcAacCodec;
+class SrsCodecSample;
+class SrsTsCache;
+class SrsTsContext;
+class SrsTSMuxer;
+
+// the ratio of EXT-X-TARGETDURATION to the fragment, the segment is
+// reaped without keyframe when its duration reach the target duration,
+// for the EXTINF must never exceed it.
+#define SRS_HLS_TD_RATIO 1.5
+
+/**
+* the partial segment of low latency hls, a ts file in the m3u8,
+* the concatenation of parts is the segment.
+*/
+struct SrsHlsPart
+{
+    // the duration in seconds of part.
+    double duration;
+    // the uri of ts file in m3u8, relative to the m3u8.
+    std::string uri;
+    // whether the part starts with keyframe, or is audio.
+    bool independent;
+};
+
+/**
+* the hls segment, a ts file in the m3u8.
+*/
+class SrsHlsSegment
+{
+public:
+    // the duration in seconds of segment.
+    double duration;
+    // the sequence number of segment in m3u8.
+    int sequence_no;
+    // the uri of ts file in m3u8, relative to the m3u8.
+    std::string uri;
+    // the full path of ts file.
+    std::string full_path;
+    // the dts in tbn 90000 of first frame in segment.
+    int64_t segment_start_dts;
+    // the parts of segment written, empty when not low latency.
+    std::vector<SrsHlsPart> parts;
+public:
+    SrsHlsSegment();
+    virtual ~SrsHlsSegment();
+public:
+    /**
+    * update the duration of segment by the dts of frame.
+    * @remark the frame dts before the start is ignored.
+    */
+    virtual void update_duration(int64_t current_frame_dts);
+};
+
+/**
+* the writer of hls segment, which also writes the ts to the part file
+* when opened, so the part is available before the segment reaped.
+*/
+class SrsHlsSegmentWriter : public SrsFileWriter
+{
+private:
+    SrsFileWriter* part;
+public:
+    SrsHlsSegmentWriter();
+    virtual ~SrsHlsSegmentWriter();
+public:
+    /**
+    * open the part file, the ts written to both segment and part.
+    */
+    virtual int open_part(std::string p);
+    /**
+    * close the part file, flush the buffered ts of part.
+    * @return the error of flush or close, the part is always closed.
+    */
+    virtual int close_part();
+public:
+    virtual void set_sync(SrsFileSync v);
+    virtual int writev(iovec* iov, int iovcnt, ssize_t* pnwrite);
+};
+
+/**
+* encode the flv audio/video to hls, the ts segments and m3u8 playlist.
+* the segment is reaped at the video keyframe when its duration exceed
+* the fragment, or at the audio frame for pure audio stream, and it's
+* always reaped when its duration reach the EXT-X-TARGETDURATION, which
+* is the fragment*SRS_HLS_TD_RATIO.
+* the ts and m3u8 are written to the .tmp file then renamed, so the
+* player never gets a partial file, and the m3u8 only contains the
+* segments in the window, the segment out of window is removed from
+* disk when cleanup.
+* for example, the m3u8 file /data/live.m3u8, the segments are
+* /data/live-0.ts, /data/live-1.ts, ...
+* 
+* for low latency hls, each segment is also written as parts, for
+* example, /data/live-0.0.ts, /data/live-0.1.ts, ..., the part is
+* reaped when its duration reach the part target, and the m3u8 is
+* refreshed with the EXT-X-PART and EXT-X-PRELOAD-HINT of next part.
+* the delta m3u8 with EXT-X-SKIP is written to /data/live_delta.m3u8,
+* for the request with _HLS_skip=YES.
+*/
+class SrsHlsEncoder
+{
+private:
+    // the path of m3u8 file.
+    std::string m3u8;
+    // the prefix of ts file path, and the uri in m3u8.
+    std::string ts_dir;
+    std::string ts_prefix;
+    // the min duration in seconds of segment.
+    double hls_fragment;
+    // the max duration in seconds of segments in m3u8.
+    double hls_window;
+    // whether remove the segment out of window.
+    bool hls_cleanup;
+    // the part target duration in seconds, 0 to disable low latency.
+    double hls_part;
+    // whether fdatasync the ts and m3u8 before rename.
+    bool hls_sync;
+    // the path of delta m3u8, for low latency.
+    std::string delta_m3u8;
+private:
+    // the sequence number of next segment.
+    int sequence_no;
+    // the EXT-X-TARGETDURATION of m3u8, derived from the fragment,
+    // never change for the player may cache it.
+    int target_duration;
+    // whether stream has video, to reap segment at keyframe.
+    bool has_video;
+    // the segment to write, NULL when no frame written.
+    SrsHlsSegment* current;
+    // the segments in m3u8.
+    std::vector<SrsHlsSegment*> segments;
+    // the part to write, of current segment.
+    bool part_opened;
+    bool part_independent;
+    int64_t part_start_dts;
+    int64_t part_last_dts;
+    // the max interval of frames in part, to reap before exceed.
+    int64_t part_interval;
+private:
+    SrsHlsSegmentWriter* writer;
+    SrsAvcAacCodec* codec;
+    SrsCodecSample* sample;
+    SrsTsCache* cache;
+    SrsTsContext* context;
+    SrsTSMuxer* muxer;
+public:
+    SrsHlsEncoder();
+    virtual ~SrsHlsEncoder();
+public:
+    /**
+    * initialize the hls encoder.
+    * @param m3u8_file the path of m3u8, the segments are in the same dir.
+    * @param fragment_ms the min duration of each segment in ms.
+    * @param window_ms the max duration of segments in m3u8 in ms.
+    * @param cleanup whether remove the segment files out of window.
+    */
+    virtual int initialize(std::string m3u8_file, int fragment_ms, int window_ms, bool cleanup);
+    /**
+    * enable the low latency hls, write the segment in parts.
+    * @param part_ms the part target duration in ms, 0 to disable.
+    * @return ERROR_HLS_PART_AFTER_WRITE when any frame written.
+    */
+    virtual int set_part(int part_ms);
+    /**
+    * whether fdatasync the segment, part and m3u8 before rename them,
+    * so the renamed file is never partial after the system crash.
+    */
+    virtual void set_sync(bool v);
+    /**
+    * whether the m3u8 contains the part of segment, for the blocking
+    * playlist reload, the request with _HLS_msn=msn&_HLS_part=part
+    * should be hold until it's ready.
+    * @param msn the sequence number of segment.
+    * @param part the index of part in segment, -1 for the whole segment.
+    */
+    virtual bool is_ready(int msn, int part);
+public:
+    /**
+    * write audio/video packet.
+    * @remark assert data is not NULL.
+    */
+    virtual int write_audio(int64_t timestamp, char* data, int size);
+    virtual int write_video(int64_t timestamp, char* data, int size);
+    /**
+    * reap the current segment and end the m3u8, when stream end.
+    */
+    virtual int close();
+private:
+    /**
+    * open a new segment, the first frame dts is segment_start_dts.
+    */
+    virtual int segment_open(int64_t segment_start_dts);
+    /**
+    * close the current segment, rename to the ts file, then shrink
+    * the window and refresh the m3u8.
+    * @remark the segment and its parts are removed when close failed.
+    */
+    virtual int segment_close(bool end);
+    /**
+    * remove the files of segment failed to close, the tmp file and the
+    * parts renamed, then refresh the m3u8 without its parts.
+    */
+    virtual void segment_discard(SrsHlsSegment* segment);
+    /**
+    * write the m3u8 to .tmp then rename.
+    * @param end whether write the EXT-X-ENDLIST.
+    */
+    virtual int refresh_m3u8(bool end);
+    /**
+    * generate the m3u8 content.
+    * @param delta whether skip the old segments by EXT-X-SKIP.
+    */
+    virtual std::string generate_m3u8(bool end, bool delta);
+    virtual void generate_parts(std::stringstream& ss, SrsHlsSegment* segment);
+    /**
+    * the uri of part in segment of sequence.
+    */
+    virtual std::string part_uri(int sequence, int index);
+    /**
+    * write the m3u8 content to file, by .tmp then rename.
+    */
+    virtual int write_m3u8(std::string path, std::string body);
+    /**
+    * reap the part when it will exceed the part target with the frame,
+    * then open the next part for the frame.
+    * @param independent whether the frame is keyframe or audio.
+    */
+    virtual int part_update(int64_t dts, bool independent);
+    virtual int part_open(int64_t dts, bool independent);
+    /**
+    * close the part, rename to the part file.
+    * @param duration the duration in seconds of part.
+    */
+    virtual int part_close(double duration);
+    virtual int flush_audio();
+    virtual int flush_video();
+};
+
+#endif
+
+#endif
+
@@ -0,0 +1,794 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2015 SRS(ossrs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include <srs_kernel_mp4.hpp>
+
+#if !defined(SRS_EXPORT_LIBRTMP)
+
+#include <string.h>
+using namespace std;
+
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_file.hpp>
+#include <srs_kernel_buffer.hpp>
+#include <srs_kernel_codec.hpp>
+#include <srs_kernel_utility.hpp>
+
+// the timescale of tracks, the flv timestamp in ms.
+#define SRS_MP4_TIMESCALE 1000
+// the samples of each aac frame.
+#define SRS_MP4_AAC_FRAME_SAMPLES 1024
+
+// the sample flags of trun, ISO_IEC_14496-12-base-format-2012.pdf, page 45.
+#define SRS_MP4_SAMPLE_SYNC 0x02000000
+#define SRS_MP4_SAMPLE_NON_SYNC 0x01010000
+
+/**
+* write the integer in big-endian to buffer.
+*/
+void srs_mp4_write_u8(SrsSimpleBuffer* buf, u_int8_t v)
+{
+    buf->append((char*)&v, 1);
+}
+
+void srs_mp4_write_u16(SrsSimpleBuffer* buf, u_int16_t v)
+{
+    char b[2] = { (char)(v >> 8), (char)v };
+    buf->append(b, 2);
+}
+
+void srs_mp4_write_u32(SrsSimpleBuffer* buf, u_int32_t v)
+{
+    char b[4] = { (char)(v >> 24), (char)(v >> 16), (char)(v >> 8), (char)v };
+    buf->append(b, 4);
+}
+
+void srs_mp4_write_u64(SrsSimpleBuffer* buf, u_int64_t v)
+{
+    srs_mp4_write_u32(buf, (u_int32_t)(v >> 32));
+    srs_mp4_write_u32(buf, (u_int32_t)v);
+}
+
+/**
+* append the chunk, merge with the last one when the bytes are continuous.
+*/
+void srs_mp4_append_chunk(std::vector<SrsMp4Chunk>& chunks, char* bytes, int size)
+{
+    if (!chunks.empty()) {
+        SrsMp4Chunk& last = chunks.back();
+        if ((!bytes && !last.bytes) || (bytes && last.bytes && last.bytes + last.size == bytes)) {
+            last.size += size;
+            return;
+        }
+    }
+    
+    SrsMp4Chunk chunk;
+    chunk.bytes = bytes;
+    chunk.size = size;
+    chunks.push_back(chunk);
+}
+
+void srs_mp4_write_zeros(SrsSimpleBuffer* buf, int size)
+{
+    for (int i = 0; i < size; i++) {
+        srs_mp4_write_u8(buf, 0);
+    }
+}
+
+/**
+* start a box, the size is patched when box end.
+* @return the start offset of box.
+*/
+int srs_mp4_box_start(SrsSimpleBuffer* buf, const char* type)
+{
+    int start = buf->length();
+    srs_mp4_write_u32(buf, 0);
+    buf->append(type, 4);
+    return start;
+}
+
+int srs_mp4_full_box_start(SrsSimpleBuffer* buf, const char* type, u_int8_t version, u_int32_t flags)
+{
+    int start = srs_mp4_box_start(buf, type);
+    srs_mp4_write_u32(buf, ((u_int32_t)version << 24) | (flags & 0xffffff));
+    return start;
+}
+
+void srs_mp4_patch_u32(SrsSimpleBuffer* buf, int pos, u_int32_t v)
+{
+    char* p = buf->bytes() + pos;
+    p[0] = (char)(v >> 24);
+    p[1] = (char)(v >> 16);
+    p[2] = (char)(v >> 8);
+    p[3] = (char)v;
+}
+
+void srs_mp4_box_end(SrsSimpleBuffer* buf, int start)
+{
+    srs_mp4_patch_u32(buf, start, (u_int32_t)(buf->length() - start));
+}
+
+/**
+* the unity matrix of mvhd and tkhd.
+*/
+void srs_mp4_write_matrix(SrsSimpleBuffer* buf)
+{
+    u_int32_t matrix[] = { 0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000 };
+    for (int i = 0; i < 9; i++) {
+        srs_mp4_write_u32(buf, matrix[i]);
+    }
+}
+
+SrsMp4Encoder::SrsMp4Encoder()
+{
+    writer = NULL;
+    codec = new SrsAvcAacCodec();
+    sample = new SrsCodecSample();
+    fragment_duration = 0;
+    got_init = has_video = has_audio = false;
+    sequence_number = 0;
+    video_mdat = new SrsSimpleBuffer();
+    fragment_start = 0;
+    video_duration = audio_duration = 0;
+}
+
+SrsMp4Encoder::~SrsMp4Encoder()
+{
+    srs_freep(codec);
+    srs_freep(sample);
+    srs_freep(video_mdat);
+    
+    std::vector<char*>::iterator it;
+    for (it = packets.begin(); it != packets.end(); ++it) {
+        char* packet = *it;
+        srs_freepa(packet);
+    }
+    packets.clear();
+}
+
+int SrsMp4Encoder::initialize(SrsFileWriter* fw, int fragment_ms)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(fw);
+    
+    if (!fw->is_open()) {
+        ret = ERROR_KERNEL_MP4_STREAM_CLOSED;
+        srs_warn("stream is not open for encoder. ret=%d", ret);
+        return ret;
+    }
+    
+    writer = fw;
+    fragment_duration = srs_max(0, fragment_ms);
+    
+    return ret;
+}
+
+int SrsMp4Encoder::write_audio(int64_t timestamp, char* data, int size)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(data);
+    
+    bool referenced = false;
+    ret = do_write_audio(timestamp, data, size, &referenced);
+    
+    if (referenced) {
+        packets.push_back(data);
+    } else {
+        srs_freepa(data);
+    }
+    
+    return ret;
+}
+
+int SrsMp4Encoder::write_video(int64_t timestamp, char* data, int size)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(data);
+    
+    bool referenced = false;
+    ret = do_write_video(timestamp, data, size, &referenced);
+    
+    if (referenced) {
+        packets.push_back(data);
+    } else {
+        srs_freepa(data);
+    }
+    
+    return ret;
+}
+
+int SrsMp4Encoder::flush()
+{
+    if (videos.empty() && audios.empty()) {
+        return ERROR_SUCCESS;
+    }
+    
+    return write_fragment(-1, -1);
+}
+
+int SrsMp4Encoder::do_write_audio(int64_t timestamp, char* data, int size, bool* preferenced)
+{
+    int ret = ERROR_SUCCESS;
+    
+    sample->clear();
+    if ((ret = codec->audio_aac_demux(data, size, sample)) != ERROR_SUCCESS) {
+        // ignore the mp3, only aac in mp4.
+        if (ret == ERROR_HLS_TRY_MP3) {
+            return ERROR_SUCCESS;
+        }
+        srs_error("mp4 aac demux audio failed. ret=%d", ret);
+        return ret;
+    }
+    
+    if (codec->audio_codec_id != SrsCodecAudioAAC) {
+        return ret;
+    }
+    
+    // the track is not in the init segment, which is written by the first fragment.
+    if (got_init && !has_audio && codec->is_aac_codec_ok()) {
+        ret = ERROR_KERNEL_MP4_TRACK_LATE;
+        srs_error("mp4 audio track not in init segment, sequence header is late. ret=%d", ret);
+        return ret;
+    }
+    
+    if (sample->aac_packet_type == SrsCodecAudioTypeSequenceHeader) {
+        return ret;
+    }
+    
+    if (!codec->is_aac_codec_ok() || sample->nb_sample_units <= 0) {
+        return ret;
+    }
+    
+    int64_t dts = timestamp & 0x7fffffff;
+    
+    // for pure audio, fragment by audio.
+    bool pure_audio = got_init? !has_video : !codec->is_avc_codec_ok();
+    if (pure_audio && !audios.empty() && dts - fragment_start >= fragment_duration) {
+        if ((ret = write_fragment(-1, dts)) != ERROR_SUCCESS) {
+            return ret;
+        }
+    }
+    
+    if (videos.empty() && audios.empty()) {
+        fragment_start = dts;
+    }
+    
+    SrsCodecSampleUnit* unit = &sample->sample_units[0];
+    
+    SrsMp4Sample s;
+    s.dts = dts;
+    s.cts = 0;
+    s.size = (u_int32_t)unit->size;
+    s.keyframe = true;
+    audios.push_back(s);
+    
+    // the raw aac frame in packet.
+    if (unit->size > 0) {
+        srs_mp4_append_chunk(audio_chunks, unit->bytes, unit->size);
+        *preferenced = true;
+    }
+    
+    return ret;
+}
+
+int SrsMp4Encoder::do_write_video(int64_t timestamp, char* data, int size, bool* preferenced)
+{
+    int ret = ERROR_SUCCESS;
+    
+    sample->clear();
+    if ((ret = codec->video_avc_demux(data, size, sample)) != ERROR_SUCCESS) {
+        srs_error("mp4 codec demux video failed. ret=%d", ret);
+        return ret;
+    }
+    
+    // ignore info frame,
+    // @see https://github.com/ossrs/srs/issues/288#issuecomment-69863909
+    if (sample->frame_type == SrsCodecVideoAVCFrameVideoInfoFrame) {
+        return ret;
+    }
+    
+    if (codec->video_codec_id != SrsCodecVideoAVC && codec->video_codec_id != SrsCodecVideoHEVC) {
+        return ret;
+    }
+    
+    // the track is not in the init segment, which is written by the first fragment.
+    if (got_init && !has_video && codec->is_avc_codec_ok()) {
+        ret = ERROR_KERNEL_MP4_TRACK_LATE;
+        srs_error("mp4 video track not in init segment, sequence header is late. ret=%d", ret);
+        return ret;
+    }
+    
+    if (sample->avc_packet_type == SrsCodecVideoAVCTypeSequenceHeader) {
+        return ret;
+    }
+    
+    if (!codec->is_avc_codec_ok()) {
+        return ret;
+    }
+    
+    // the fragment of video always starts with keyframe.
+    bool keyframe = sample->frame_type == SrsCodecVideoAVCFrameKeyFrame;
+    if (videos.empty() && !keyframe) {
+        return ret;
+    }
+    
+    int64_t dts = timestamp & 0x7fffffff;
+    
+    if (keyframe && !videos.empty() && dts - fragment_start >= fragment_duration) {
+        if ((ret = write_fragment(dts, -1)) != ERROR_SUCCESS) {
+            return ret;
+        }
+    }
+    
+    if (videos.empty() && audios.empty()) {
+        fragment_start = dts;
+    }
+    
+    SrsMp4Sample s;
+    s.dts = dts;
+    s.cts = sample->cts;
+    s.size = 0;
+    s.keyframe = keyframe;
+    
+    for (int i = 0; i < sample->nb_sample_units; i++) {
+        SrsCodecSampleUnit* unit = &sample->sample_units[i];
+        if (unit->size <= 0) {
+            continue;
+        }
+        
+        s.size += 4 + unit->size;
+        
+        // reference the NALU with its 4bytes length in packet, 
+        // or copy to mdat with 4bytes length, for annexb or other length.
+        char* p = unit->bytes - 4;
+        if (p >= data) {
+            u_int32_t length = ((u_int32_t)(u_int8_t)p[0] << 24) | ((u_int32_t)(u_int8_t)p[1] << 16)
+                | ((u_int32_t)(u_int8_t)p[2] << 8) | (u_int32_t)(u_int8_t)p[3];
+            if (length == (u_int32_t)unit->size) {
+                srs_mp4_append_chunk(video_chunks, p, 4 + unit->size);
+                *preferenced = true;
+                continue;
+            }
+        }
+        
+        srs_mp4_write_u32(video_mdat, (u_int32_t)unit->size);
+        video_mdat->append(unit->bytes, unit->size);
+        srs_mp4_append_chunk(video_chunks, NULL, 4 + unit->size);
+    }
+    videos.push_back(s);
+    
+    return ret;
+}
+
+void SrsMp4Encoder::clear_fragment()
+{
+    videos.clear();
+    audios.clear();
+    video_chunks.clear();
+    audio_chunks.clear();
+    video_mdat->erase(video_mdat->length());
+    
+    std::vector<char*>::iterator it;
+    for (it = packets.begin(); it != packets.end(); ++it) {
+        char* packet = *it;
+        srs_freepa(packet);
+    }
+    packets.clear();
+}
+
+int SrsMp4Encoder::write_init()
+{
+    int ret = ERROR_SUCCESS;
+    
+    has_video = codec->is_avc_codec_ok();
+    has_audio = codec->is_aac_codec_ok();
+    got_init = true;
+    
+    SrsSimpleBuffer buf;
+    
+    // ISO_IEC_14496-12-base-format-2012.pdf, page 17.
+    int ftyp = srs_mp4_box_start(&buf, "ftyp");
+    buf.append("iso6", 4);
+    srs_mp4_write_u32(&buf, 0);
+    buf.append("iso6", 4);
+    buf.append("isom", 4);
+    buf.append("mp41", 4);
+    srs_mp4_box_end(&buf, ftyp);
+    
+    int moov = srs_mp4_box_start(&buf, "moov");
+    
+    // ISO_IEC_14496-12-base-format-2012.pdf, page 23.
+    int mvhd = srs_mp4_full_box_start(&buf, "mvhd", 0, 0);
+    srs_mp4_write_u32(&buf, 0); // creation_time
+    srs_mp4_write_u32(&buf, 0); // modification_time
+    srs_mp4_write_u32(&buf, SRS_MP4_TIMESCALE);
+    srs_mp4_write_u32(&buf, 0); // duration
+    srs_mp4_write_u32(&buf, 0x00010000); // rate
+    srs_mp4_write_u16(&buf, 0x0100); // volume
+    srs_mp4_write_zeros(&buf, 10);
+    srs_mp4_write_matrix(&buf);
+    srs_mp4_write_zeros(&buf, 24); // pre_defined
+    srs_mp4_write_u32(&buf, (has_video? 1 : 0) + (has_audio? 1 : 0) + 1); // next_track_ID
+    srs_mp4_box_end(&buf, mvhd);
+    
+    if (has_video) {
+        write_trak(&buf, true);
+    }
+    if (has_audio) {
+        write_trak(&buf, false);
+    }
+    
+    // ISO_IEC_14496-12-base-format-2012.pdf, page 64.
+    int mvex = srs_mp4_box_start(&buf, "mvex");
+    for (u_int32_t track_id = 1; track_id <= (u_int32_t)((has_video? 1 : 0) + (has_audio? 1 : 0)); track_id++) {
+        int trex = srs_mp4_full_box_start(&buf, "trex", 0, 0);
+        srs_mp4_write_u32(&buf, track_id);
+        srs_mp4_write_u32(&buf, 1); // default_sample_description_index
+        srs_mp4_write_u32(&buf, 0); // default_sample_duration
+        srs_mp4_write_u32(&buf, 0); // default_sample_size
+        srs_mp4_write_u32(&buf, 0); // default_sample_flags
+        srs_mp4_box_end(&buf, trex);
+    }
+    srs_mp4_box_end(&buf, mvex);
+    
+    srs_mp4_box_end(&buf, moov);
+    
+    if ((ret = writer->write(buf.bytes(), buf.length(), NULL)) != ERROR_SUCCESS) {
+        srs_error("write mp4 init segment failed. ret=%d", ret);
+        return ret;
+    }
+    
+    srs_info("mp4 init segment, video=%d, audio=%d, size=%d", has_video, has_audio, buf.length());
+    
+    return ret;
+}
+
+void SrsMp4Encoder::write_trak(SrsSimpleBuffer* buf, bool video)
+{
+    u_int32_t track_id = (video || !has_video)? 1 : 2;
+    
+    int trak = srs_mp4_box_start(buf, "trak");
+    
+    // ISO_IEC_14496-12-base-format-2012.pdf, page 25.
+    int tkhd = srs_mp4_full_box_start(buf, "tkhd", 0, 0x03);
+    srs_mp4_write_u32(buf, 0); // creation_time
+    srs_mp4_write_u32(buf, 0); // modification_time
+    srs_mp4_write_u32(buf, track_id);
+    srs_mp4_write_u32(buf, 0); // reserved
+    srs_mp4_write_u32(buf, 0); // duration
+    srs_mp4_write_zeros(buf, 8);
+    srs_mp4_write_u16(buf, 0); // layer
+    srs_mp4_write_u16(buf, 0); // alternate_group
+    srs_mp4_write_u16(buf, video? 0 : 0x0100); // volume
+    srs_mp4_write_u16(buf, 0);
+    srs_mp4_write_matrix(buf);
+    srs_mp4_write_u32(buf, video? ((u_int32_t)codec->width << 16) : 0);
+    srs_mp4_write_u32(buf, video? ((u_int32_t)codec->height << 16) : 0);
+    srs_mp4_box_end(buf, tkhd);
+    
+    int mdia = srs_mp4_box_start(buf, "mdia");
+    
+    int mdhd = srs_mp4_full_box_start(buf, "mdhd", 0, 0);
+    srs_mp4_write_u32(buf, 0); // creation_time
+    srs_mp4_write_u32(buf, 0); // modification_time
+    srs_mp4_write_u32(buf, SRS_MP4_TIMESCALE);
+    srs_mp4_write_u32(buf, 0); // duration
+    srs_mp4_write_u16(buf, 0x55c4); // language, und
+    srs_mp4_write_u16(buf, 0);
+    srs_mp4_box_end(buf, mdhd);
+    
+    int hdlr = srs_mp4_full_box_start(buf, "hdlr", 0, 0);
+    srs_mp4_write_u32(buf, 0); // pre_defined
+    buf->append(video? "vide" : "soun", 4);
+    srs_mp4_write_zeros(buf, 12);
+    const char* name = video? "VideoHandler" : "SoundHandler";
+    buf->append(name, (int)strlen(name) + 1);
+    srs_mp4_box_end(buf, hdlr);
+    
+    int minf = srs_mp4_box_start(buf, "minf");
+    
+    if (video) {
+        int vmhd = srs_mp4_full_box_start(buf, "vmhd", 0, 0x01);
+        srs_mp4_write_zeros(buf, 8); // graphicsmode and opcolor
+        srs_mp4_box_end(buf, vmhd);
+    } else {
+        int smhd = srs_mp4_full_box_start(buf, "smhd", 0, 0);
+        srs_mp4_write_zeros(buf, 4); // balance and reserved
+        srs_mp4_box_end(buf, smhd);
+    }
+    
+    int dinf = srs_mp4_box_start(buf, "dinf");
+    int dref = srs_mp4_full_box_start(buf, "dref", 0, 0);
+    srs_mp4_write_u32(buf, 1);
+    int url = srs_mp4_full_box_start(buf, "url ", 0, 0x01);
+    srs_mp4_box_end(buf, url);
+    srs_mp4_box_end(buf, dref);
+    srs_mp4_box_end(buf, dinf);
+    
+    int stbl = srs_mp4_box_start(buf, "stbl");
+    
+    int stsd = srs_mp4_full_box_start(buf, "stsd", 0, 0);
+    srs_mp4_write_u32(buf, 1);
+    if (video) {
+        bool is_hevc = codec->video_codec_id == SrsCodecVideoHEVC;
+        
+        // H.264-AVC-ISO_IEC_14496-15.pdf, page 22.
+        // for hevc, the hvc1 with hvcC, ISO_IEC_14496-15-2014.pdf, page 57.
+        int avc1 = srs_mp4_box_start(buf, is_hevc? "hvc1" : "avc1");
+        srs_mp4_write_zeros(buf, 6);
+        srs_mp4_write_u16(buf, 1); // data_reference_index
+        srs_mp4_write_zeros(buf, 16); // pre_defined and reserved
+        srs_mp4_write_u16(buf, (u_int16_t)codec->width);
+        srs_mp4_write_u16(buf, (u_int16_t)codec->height);
+        srs_mp4_write_u32(buf, 0x00480000); // horizresolution
+        srs_mp4_write_u32(buf, 0x00480000); // vertresolution
+        srs_mp4_write_u32(buf, 0);
+        srs_mp4_write_u16(buf, 1); // frame_count
+        srs_mp4_write_zeros(buf, 32); // compressorname
+        srs_mp4_write_u16(buf, 0x0018); // depth
+        srs_mp4_write_u16(buf, 0xffff); // pre_defined
+        
+        // the NALUs in mdat always use 4bytes length.
+        int avcc = srs_mp4_box_start(buf, is_hevc? "hvcC" : "avcC");
+        int pos = buf->length();
+        buf->append(codec->avc_extra_data, codec->avc_extra_size);
+        if (is_hevc && codec->avc_extra_size > 21) {
+            buf->bytes()[pos + 21] |= 0x03;
+        } else if (!is_hevc && codec->avc_extra_size > 4) {
+            buf->bytes()[pos + 4] = (char)0xff;
+        }
+        srs_mp4_box_end(buf, avcc);
+        
+        srs_mp4_box_end(buf, avc1);
+    } else {
+        // ISO_IEC_14496-12-base-format-2012.pdf, page 40.
+        int mp4a = srs_mp4_box_start(buf, "mp4a");
+        srs_mp4_write_zeros(buf, 6);
+        srs_mp4_write_u16(buf, 1); // data_reference_index
+        srs_mp4_write_zeros(buf, 8);
+        srs_mp4_write_u16(buf, codec->aac_channels);
+        srs_mp4_write_u16(buf, 16); // samplesize
+        srs_mp4_write_u32(buf, 0);
+        int sample_rate = 0;
+        if (codec->aac_sample_rate < SRS_AAC_SAMPLE_RATE_UNSET) {
+            sample_rate = aac_sample_rates[codec->aac_sample_rate];
+        }
+        srs_mp4_write_u32(buf, (u_int32_t)sample_rate << 16);
+        
+        // ES_Descriptor, ISO_IEC_14496-1-System.pdf, page 31.
+        int esds = srs_mp4_full_box_start(buf, "esds", 0, 0);
+        int nb_extra = codec->aac_extra_size;
+        srs_mp4_write_u8(buf, 0x03); // ES_DescrTag
+        srs_mp4_write_u8(buf, (u_int8_t)(3 + 2 + 13 + 2 + nb_extra + 3));
+        srs_mp4_write_u16(buf, 0); // ES_ID
+        srs_mp4_write_u8(buf, 0);
+        srs_mp4_write_u8(buf, 0x04); // DecoderConfigDescrTag
+        srs_mp4_write_u8(buf, (u_int8_t)(13 + 2 + nb_extra));
+        srs_mp4_write_u8(buf, 0x40); // objectTypeIndication, aac
+        srs_mp4_write_u8(buf, 0x15); // streamType audio, upStream 0, reserved 1
+        srs_mp4_write_zeros(buf, 3); // bufferSizeDB
+        srs_mp4_write_u32(buf, 0); // maxBitrate
+        srs_mp4_write_u32(buf, 0); // avgBitrate
+        srs_mp4_write_u8(buf, 0x05); // DecSpecificInfoTag
+        srs_mp4_write_u8(buf, (u_int8_t)nb_extra);
+        buf->append(codec->aac_extra_data, nb_extra);
+        srs_mp4_write_u8(buf, 0x06); // SLConfigDescrTag
+        srs_mp4_write_u8(buf, 1);
+        srs_mp4_write_u8(buf, 0x02);
+        srs_mp4_box_end(buf, esds);
+        
+        srs_mp4_box_end(buf, mp4a);
+    }
+    srs_mp4_box_end(buf, stsd);
+    
+    // the empty sample tables, the samples are in fragments.
+    const char* tables[] = { "stts", "stsc", "stco" };
+    for (int i = 0; i < 3; i++) {
+        int table = srs_mp4_full_box_start(buf, tables[i], 0, 0);
+        srs_mp4_write_u32(buf, 0);
+        srs_mp4_box_end(buf, table);
+    }
+    int stsz = srs_mp4_full_box_start(buf, "stsz", 0, 0);
+    srs_mp4_write_u32(buf, 0); // sample_size
+    srs_mp4_write_u32(buf, 0); // sample_count
+    srs_mp4_box_end(buf, stsz);
+    
+    srs_mp4_box_end(buf, stbl);
+    srs_mp4_box_end(buf, minf);
+    srs_mp4_box_end(buf, mdia);
+    srs_mp4_box_end(buf, trak);
+}
+
+int SrsMp4Encoder::write_fragment(int64_t next_video_dts, int64_t next_audio_dts)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (!got_init && (ret = write_init()) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // drop the samples of track not in init segment,
+    // the packets are freed when fragment written.
+    if (!has_video && !videos.empty()) {
+        videos.clear();
+        video_chunks.clear();
+        video_mdat->erase(video_mdat->length());
+    }
+    if (!has_audio && !audios.empty()) {
+        audios.clear();
+        audio_chunks.clear();
+    }
+    if (videos.empty() && audios.empty()) {
+        clear_fragment();
+        return ret;
+    }
+    
+    SrsSimpleBuffer moof;
+    
+    // ISO_IEC_14496-12-base-format-2012.pdf, page 66.
+    int moof_start = srs_mp4_box_start(&moof, "moof");
+    
+    int mfhd = srs_mp4_full_box_start(&moof, "mfhd", 0, 0);
+    srs_mp4_write_u32(&moof, ++sequence_number);
+    srs_mp4_box_end(&moof, mfhd);
+    
+    int video_offset = -1;
+    int audio_offset = -1;
+    if (!videos.empty()) {
+        write_traf(&moof, true, next_video_dts, &video_offset);
+    }
+    if (!audios.empty()) {
+        write_traf(&moof, false, next_audio_dts, &audio_offset);
+    }
+    
+    srs_mp4_box_end(&moof, moof_start);
+    
+    // the data offset is from the start of moof, the video before audio in mdat.
+    int nb_video = 0;
+    int nb_audio = 0;
+    std::vector<SrsMp4Chunk>::iterator it;
+    for (it = video_chunks.begin(); it != video_chunks.end(); ++it) {
+        nb_video += it->size;
+    }
+    for (it = audio_chunks.begin(); it != audio_chunks.end(); ++it) {
+        nb_audio += it->size;
+    }
+    if (video_offset >= 0) {
+        srs_mp4_patch_u32(&moof, video_offset, (u_int32_t)(moof.length() + 8));
+    }
+    if (audio_offset >= 0) {
+        srs_mp4_patch_u32(&moof, audio_offset, (u_int32_t)(moof.length() + 8 + nb_video));
+    }
+    
+    char mdat[8];
+    u_int32_t mdat_size = 8 + nb_video + nb_audio;
+    mdat[0] = (char)(mdat_size >> 24);
+    mdat[1] = (char)(mdat_size >> 16);
+    mdat[2] = (char)(mdat_size >> 8);
+    mdat[3] = (char)mdat_size;
+    memcpy(mdat + 4, "mdat", 4);
+    
+    // write the moof and mdat in one writev, the mdat references the packets.
+    std::vector<iovec> iovs(2 + video_chunks.size() + audio_chunks.size());
+    iovs[0].iov_base = moof.bytes();
+    iovs[0].iov_len = moof.length();
+    iovs[1].iov_base = mdat;
+    iovs[1].iov_len = 8;
+    
+    int nb_iovs = 2;
+    char* copied = video_mdat->bytes();
+    for (it = video_chunks.begin(); it != video_chunks.end(); ++it) {
+        SrsMp4Chunk& chunk = *it;
+        if (chunk.bytes) {
+            iovs[nb_iovs].iov_base = chunk.bytes;
+        } else {
+            iovs[nb_iovs].iov_base = copied;
+            copied += chunk.size;
+        }
+        iovs[nb_iovs++].iov_len = chunk.size;
+    }
+    for (it = audio_chunks.begin(); it != audio_chunks.end(); ++it) {
+        iovs[nb_iovs].iov_base = it->bytes;
+        iovs[nb_iovs++].iov_len = it->size;
+    }
+    
+    if ((ret = writer->writev(&iovs[0], nb_iovs, NULL)) != ERROR_SUCCESS) {
+        srs_error("write mp4 fragment failed. ret=%d", ret);
+        return ret;
+    }
+    
+    srs_info("mp4 fragment #%u, video=%d, audio=%d, size=%d", 
+        sequence_number, (int)videos.size(), (int)audios.size(), moof.length() + mdat_size);
+    
+    clear_fragment();
+    
+    return ret;
+}
+
+void SrsMp4Encoder::write_traf(SrsSimpleBuffer* buf, bool video, int64_t next_dts, int* pdata_offset)
+{
+    std::vector<SrsMp4Sample>& samples = video? videos : audios;
+    u_int32_t& last_duration = video? video_duration : audio_duration;
+    u_int32_t track_id = (video || !has_video)? 1 : 2;
+    
+    int traf = srs_mp4_box_start(buf, "traf");
+    
+    // default-base-is-moof, ISO_IEC_14496-12-base-format-2012.pdf, page 68.
+    int tfhd = srs_mp4_full_box_start(buf, "tfhd", 0, 0x020000);
+    srs_mp4_write_u32(buf, track_id);
+    srs_mp4_box_end(buf, tfhd);
+    
+    int tfdt = srs_mp4_full_box_start(buf, "tfdt", 1, 0);
+    srs_mp4_write_u64(buf, (u_int64_t)samples[0].dts);
+    srs_mp4_box_end(buf, tfdt);
+    
+    // data-offset, sample-duration and sample-size, 
+    // for video, sample-flags and signed sample-composition-time-offset.
+    u_int32_t flags = 0x000001 | 0x000100 | 0x000200;
+    if (video) {
+        flags |= 0x000400 | 0x000800;
+    }
+    int trun = srs_mp4_full_box_start(buf, "trun", video? 1 : 0, flags);
+    srs_mp4_write_u32(buf, (u_int32_t)samples.size());
+    *pdata_offset = buf->length();
+    srs_mp4_write_u32(buf, 0);
+    
+    // the duration of aac frame, when the next dts of track is unknown,
+    // for the audio timeline must continue to the tfdt of next fragment.
+    u_int32_t aac_duration = 0;
+    if (!video && codec->aac_sample_rate < SRS_AAC_SAMPLE_RATE_UNSET && aac_sample_rates[codec->aac_sample_rate] > 0) {
+        int sample_rate = aac_sample_rates[codec->aac_sample_rate];
+        aac_duration = (u_int32_t)((SRS_MP4_AAC_FRAME_SAMPLES * SRS_MP4_TIMESCALE + sample_rate / 2) / sample_rate);
+    }
+    
+    for (int i = 0; i < (int)samples.size(); i++) {
+        SrsMp4Sample& s = samples[i];
+        
+        // the duration of last sample is guessed by next sample of track, 
+        // the aac frame duration, or previous one.
+        int64_t next = (i < (int)samples.size() - 1)? samples[i + 1].dts : next_dts;
+        if (next > s.dts) {
+            last_duration = (u_int32_t)(next - s.dts);
+        } else if (aac_duration > 0) {
+            last_duration = aac_duration;
+        }
+        
+        srs_mp4_write_u32(buf, last_duration);
+        srs_mp4_write_u32(buf, s.size);
+        if (video) {
+            srs_mp4_write_u32(buf, s.keyframe? SRS_MP4_SAMPLE_SYNC : SRS_MP4_SAMPLE_NON_SYNC);
+            srs_mp4_write_u32(buf, (u_int32_t)s.cts);
+        }
+    }
+    srs_mp4_box_end(buf, trun);
+    
+    srs_mp4_box_end(buf, traf);
+}
+
+#endif
+
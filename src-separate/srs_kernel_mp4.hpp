@@ -0,0 +1,167 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2015 SRS(ossrs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#ifndef SRS_KERNEL_MP4_HPP
+#define SRS_KERNEL_MP4_HPP
+
+/*
+#include <srs_kernel_mp4.hpp>
+*/
+#include <srs_core.hpp>
+
+#if !defined(SRS_EXPORT_LIBRTMP)
+
+#include <vector>
+
+#include <srs_kernel_codec.hpp>
+
+class SrsFileWriter;
+class SrsSimpleBuffer;
+
+/**
+* the sample of fmp4 fragment, the data is in the mdat of fragment.
+*/
+struct SrsMp4Sample
+{
+    // the dts in ms.
+    int64_t dts;
+    // the cts in ms, pts = dts + cts.
+    int32_t cts;
+    u_int32_t size;
+    bool keyframe;
+};
+
+/**
+* the data of samples in mdat, which references the bytes of packet,
+* or copied to the mdat buffer of track when not referenced.
+*/
+struct SrsMp4Chunk
+{
+    // the bytes in packet, NULL for the next size bytes in mdat buffer.
+    char* bytes;
+    int size;
+};
+
+/**
+* encode the flv audio/video to fragmented mp4(fmp4), for DASH/HLS(CMAF).
+* the init segment(ftyp+moov) is written before the first fragment,
+* with the tracks of h.264 and aac which sequence header is demuxed,
+* then each fragment(moof+mdat) starts at the video keyframe,
+* or the audio when there is no video.
+* @remark the timescale of tracks is 1000, the flv timestamp in ms.
+* @remark the sequence header change is ignored, for it's in the init segment.
+* @remark the track which sequence header comes after the init segment
+*       written is not in the init segment, the write fails with
+*       ERROR_KERNEL_MP4_TRACK_LATE.
+*/
+class SrsMp4Encoder
+{
+private:
+    SrsFileWriter* writer;
+private:
+    SrsAvcAacCodec* codec;
+    SrsCodecSample* sample;
+    // the min duration in ms of fragment.
+    int fragment_duration;
+    // whether the init segment is written, and the tracks in it.
+    bool got_init;
+    bool has_video;
+    bool has_audio;
+    u_int32_t sequence_number;
+private:
+    // the samples and data of current fragment.
+    std::vector<SrsMp4Sample> videos;
+    std::vector<SrsMp4Sample> audios;
+    std::vector<SrsMp4Chunk> video_chunks;
+    std::vector<SrsMp4Chunk> audio_chunks;
+    // the video NALUs copied to mdat, which length is not 4bytes.
+    SrsSimpleBuffer* video_mdat;
+    // the packets referenced by chunks, freed when fragment written.
+    std::vector<char*> packets;
+    int64_t fragment_start;
+    // the duration of last sample, for the last one of fragment.
+    u_int32_t video_duration;
+    u_int32_t audio_duration;
+public:
+    SrsMp4Encoder();
+    virtual ~SrsMp4Encoder();
+public:
+    /**
+    * initialize the underlayer file stream.
+    * @param fw the writer to use for mp4 encoder, user must free it.
+    * @param fragment_ms the min duration of each fragment in ms.
+    */
+    virtual int initialize(SrsFileWriter* fw, int fragment_ms);
+public:
+    /**
+    * write audio/video packet, the payload is referenced by fragment
+    * to write to mdat without copy.
+    * @remark assert data is not NULL.
+    * @remark the data is owned by encoder, user should never free it,
+    *       even if error, which is freed by srs_freepa.
+    */
+    virtual int write_audio(int64_t timestamp, char* data, int size);
+    virtual int write_video(int64_t timestamp, char* data, int size);
+    /**
+    * write the samples of current fragment, when stream end.
+    */
+    virtual int flush();
+private:
+    /**
+    * write the packet to current fragment.
+    * @param preferenced output whether the data is referenced by fragment.
+    */
+    virtual int do_write_audio(int64_t timestamp, char* data, int size, bool* preferenced);
+    virtual int do_write_video(int64_t timestamp, char* data, int size, bool* preferenced);
+    /**
+    * clear the samples of current fragment and free the packets.
+    */
+    virtual void clear_fragment();
+    /**
+    * write the init segment, the ftyp and moov.
+    */
+    virtual int write_init();
+    /**
+    * write the current fragment, the moof and mdat.
+    * @param next_video_dts the dts of next video sample, for the duration
+    *       of last video sample, -1 when unknown.
+    * @param next_audio_dts the dts of next audio sample, -1 when unknown.
+    */
+    virtual int write_fragment(int64_t next_video_dts, int64_t next_audio_dts);
+    /**
+    * write the trak of video or audio to moov.
+    */
+    virtual void write_trak(SrsSimpleBuffer* buf, bool video);
+    /**
+    * write the traf of video or audio to moof.
+    * @param next_dts the dts of next sample of this track, -1 when unknown.
+    * @param pdata_offset output the offset of data_offset in buf, to patch.
+    */
+    virtual void write_traf(SrsSimpleBuffer* buf, bool video, int64_t next_dts, int* pdata_offset);
+};
+
+#endif
+
+#endif
+
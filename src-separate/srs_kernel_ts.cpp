@@ -58,6 +58,14 @@ using namespace std;
 #define TS_AUDIO_AAC_PID 0x101
 #define TS_AUDIO_MP3_PID 0x102
 
+// the max step of messages in tbn 90000, to schedule the PSI and PCR.
+#define SRS_TS_MAX_STEP 18000
+
+// the PAT and PMT must in one ts packet,
+// the PAT is 17+4*N bytes, the PMT is 21+5*N bytes.
+#define SRS_TS_MAX_PROGRAMS 42
+#define SRS_TS_MAX_STREAMS 33
+
 string srs_ts_stream2string(SrsTsStream stream)
 {
     switch (stream) {
@@ -67,6 +75,7 @@ string srs_ts_stream2string(SrsTsStream stream)
         case SrsTsStreamAudioAC3: return "AC3";
         case SrsTsStreamAudioDTS: return "AudioDTS";
         case SrsTsStreamVideoH264: return "H.264";
+        case SrsTsStreamVideoHEVC: return "H.265";
         case SrsTsStreamVideoMpeg4: return "MP4";
         case SrsTsStreamAudioMpeg4: return "MP4A";
         default: return "Other";
@@ -152,6 +161,23 @@ bool SrsTsMessage::fresh()
     return payload->length() == 0;
 }
 
+void SrsTsMessage::reset()
+{
+    dts = pts = 0;
+    sid = (SrsTsPESStreamId)0x00;
+    continuity_counter = 0;
+    PES_packet_length = 0;
+    is_discontinuity = false;
+    start_pts = 0;
+    write_pcr = false;
+    
+    // the payload maybe detached by user.
+    if (!payload) {
+        payload = new SrsSimpleBuffer();
+    }
+    payload->erase(payload->length());
+}
+
 bool SrsTsMessage::is_audio()
 {
     return ((sid >> 5) & 0x07) == SrsTsPESStreamIdAudioChecker;
@@ -184,6 +210,7 @@ SrsTsMessage* SrsTsMessage::detach()
     cp->sid = sid;
     cp->PES_packet_length = PES_packet_length;
     cp->continuity_counter = continuity_counter;
+    srs_freep(cp->payload);
     cp->payload = payload;
     payload = NULL;
     return cp;
@@ -197,21 +224,246 @@ ISrsTsHandler::~ISrsTsHandler()
 {
 }
 
+/**
+* write the ts header and adaptation field to buf.
+* @param nb_af_reserved the stuffing bytes of adaptation field, -1 for no adaptation field.
+* @param pcr the pcr to write in adaptation field, -1 to ignore.
+* @return the bytes written.
+*/
+int srs_ts_encode_header(char* buf, int16_t pid, bool unit_start, u_int8_t continuity_counter,
+    int nb_af_reserved, bool discontinuity, int64_t pcr
+) {
+    char* p = buf;
+    
+    // 4B ts packet header.
+    *p++ = 0x47;
+    *p++ = (char)(((pid >> 8) & 0x1F) | (unit_start? 0x40 : 0x00));
+    *p++ = (char)(pid & 0xFF);
+    
+    SrsTsAdaptationFieldType afc = (nb_af_reserved >= 0)? SrsTsAdaptationFieldTypeBoth : SrsTsAdaptationFieldTypePayloadOnly;
+    *p++ = (char)(((afc << 4) & 0x30) | (continuity_counter & 0x0F));
+    
+    if (nb_af_reserved < 0) {
+        return (int)(p - buf);
+    }
+    
+    // adaptation field, 1B length, 1B flags, 6B pcr and stuffings.
+    *p++ = (char)(1 + (pcr >= 0? 6 : 0) + nb_af_reserved);
+    *p++ = (char)((discontinuity? 0x80 : 0x00) | (pcr >= 0? 0x10 : 0x00));
+    
+    if (pcr >= 0) {
+        // @remark, use pcr base and ignore the extension
+        // @see https://github.com/ossrs/srs/issues/250#issuecomment-71349370
+        int64_t pcrv = 0;
+        pcrv |= (0x3F << 9) & 0x7E00;
+        pcrv |= (pcr << 15) & 0xFFFFFFFF8000LL;
+        
+        *p++ = (char)(pcrv >> 40);
+        *p++ = (char)(pcrv >> 32);
+        *p++ = (char)(pcrv >> 24);
+        *p++ = (char)(pcrv >> 16);
+        *p++ = (char)(pcrv >> 8);
+        *p++ = (char)pcrv;
+    }
+    
+    memset(p, 0xFF, nb_af_reserved);
+    p += nb_af_reserved;
+    
+    return (int)(p - buf);
+}
+
+/**
+* write the 33bits dts or pts of PES header.
+*/
+char* srs_ts_encode_33bits_dts_pts(char* p, u_int8_t fb, int64_t v)
+{
+    int32_t val = 0;
+    
+    val = fb << 4 | (((v >> 30) & 0x07) << 1) | 1;
+    *p++ = val;
+    
+    val = (((v >> 15) & 0x7fff) << 1) | 1;
+    *p++ = (val >> 8);
+    *p++ = val;
+    
+    val = (((v) & 0x7fff) << 1) | 1;
+    *p++ = (val >> 8);
+    *p++ = val;
+    
+    return p;
+}
+
+/**
+* write the header of the first ts packet of PES, the ts header, adaptation field
+* and PES header, padding with stuffings when the left payload can't fill the packet.
+* @param size the size of PES payload.
+* @param left the size of payload to write in ts packets.
+* @return the bytes written, the payload fill the left bytes of packet.
+* @remark the same bytes as SrsTsPacket::create_pes_first.
+*/
+int srs_ts_encode_pes_first(char* buf, int16_t pid, SrsTsPESStreamId sid, u_int8_t continuity_counter,
+    bool discontinuity, int64_t pcr, int64_t dts, int64_t pts, int size, int left
+) {
+    // the PES header, 6B fixed, 3B flags and the dts/pts.
+    int PES_header_data_length = (dts == pts)? 5 : 10;
+    int nb_pes = 9 + PES_header_data_length;
+    
+    // the adaptation field of pcr, padding with stuffings.
+    int nb_af_reserved = (pcr >= 0)? 0 : -1;
+    int nb_header = 4 + (pcr >= 0? 8 : 0) + nb_pes;
+    int nb_stuffings = SRS_TS_PACKET_SIZE - nb_header - left;
+    if (nb_stuffings > 0) {
+        // consume the af size if possible.
+        nb_af_reserved = (pcr >= 0)? nb_stuffings : srs_max(0, nb_stuffings - 2);
+    }
+    
+    // the discontinuity is only set in the adaptation field of pcr.
+    char* p = buf + srs_ts_encode_header(buf, pid, true, continuity_counter, nb_af_reserved, discontinuity && pcr >= 0, pcr);
+    
+    // 3B packet_start_code_prefix and 1B stream_id.
+    *p++ = 0x00;
+    *p++ = 0x00;
+    *p++ = 0x01;
+    *p++ = (char)sid;
+    
+    // 2B, the actual bytes plus the header size.
+    int32_t pplv = 0;
+    if (size > 0 && size <= 0xFFFF) {
+        pplv = size + 3 + PES_header_data_length;
+        pplv = (pplv > 0xFFFF)? 0 : pplv;
+    }
+    *p++ = (char)(pplv >> 8);
+    *p++ = (char)pplv;
+    
+    // 3B flags, the const2bits is 0x02 and the PTS_DTS_flags.
+    int8_t PTS_DTS_flags = (dts == pts)? 0x02 : 0x03;
+    *p++ = (char)0x80;
+    *p++ = (char)((PTS_DTS_flags << 6) & 0xC0);
+    *p++ = (char)PES_header_data_length;
+    
+    if (PTS_DTS_flags == 0x02) {
+        p = srs_ts_encode_33bits_dts_pts(p, 0x02, pts);
+    } else {
+        p = srs_ts_encode_33bits_dts_pts(p, 0x03, pts);
+        p = srs_ts_encode_33bits_dts_pts(p, 0x01, dts);
+        
+        // check sync, the diff of dts and pts should never greater than 1s.
+        if (dts - pts > 90000 || pts - dts > 90000) {
+            srs_warn("ts: sync dts=%"PRId64", pts=%"PRId64, dts, pts);
+        }
+    }
+    
+    return (int)(p - buf);
+}
+
+/**
+* write the header of the continue ts packet of PES,
+* padding with stuffings when the left payload can't fill the packet.
+* @param pcr the pcr to write in adaptation field, -1 to ignore.
+* @remark the same bytes as SrsTsPacket::create_pes_continue when no pcr.
+*/
+int srs_ts_encode_pes_continue(char* buf, int16_t pid, u_int8_t continuity_counter, int left, int64_t pcr)
+{
+    int nb_af_reserved = (pcr >= 0)? 0 : -1;
+    int nb_stuffings = SRS_TS_PACKET_SIZE - 4 - (pcr >= 0? 8 : 0) - left;
+    if (nb_stuffings > 0) {
+        // consume the af size if possible.
+        nb_af_reserved = (pcr >= 0)? nb_stuffings : srs_max(0, nb_stuffings - 2);
+    }
+    
+    return srs_ts_encode_header(buf, pid, false, continuity_counter, nb_af_reserved, false, pcr);
+}
+
+/**
+* write the adaptation only packet with the pcr, of SRS_TS_PACKET_SIZE bytes.
+* @remark the continuity counter not incremented for the adaptation only packet.
+*/
+void srs_ts_encode_pcr(char* buf, int16_t pid, u_int8_t continuity_counter, int64_t pcr)
+{
+    int nb_af_reserved = SRS_TS_PACKET_SIZE - 4 - 2 - 6;
+    srs_ts_encode_header(buf, pid, false, continuity_counter, nb_af_reserved, false, pcr);
+    buf[3] = (char)((buf[3] & 0xCF) | (SrsTsAdaptationFieldTypeAdaptionOnly << 4));
+}
+
+SrsTsProgram::SrsTsProgram(int16_t n, int16_t pid)
+{
+    number = n;
+    pmt_pid = pid;
+    version = 0;
+    written = false;
+    last_psi_dts = -1;
+    last_pcr_dts = -1;
+    last_pcr = -1;
+    last_pcr_packets = -1;
+    last_dts = -1;
+    max_step = 0;
+}
+
+SrsTsProgram::~SrsTsProgram()
+{
+}
+
+int SrsTsProgram::find(int16_t pid)
+{
+    for (int i = 0; i < (int)pids.size(); i++) {
+        if (pids[i] == pid) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int16_t SrsTsProgram::pcr_pid()
+{
+    for (int i = 0; i < (int)streams.size(); i++) {
+        if (streams[i] == SrsTsStreamVideoH264 || streams[i] == SrsTsStreamVideoHEVC) {
+            return pids[i];
+        }
+    }
+    for (int i = 0; i < (int)streams.size(); i++) {
+        if (streams[i] == SrsTsStreamAudioAAC || streams[i] == SrsTsStreamAudioMp3) {
+            return pids[i];
+        }
+    }
+    return SrsTsPidNULL;
+}
+
 SrsTsContext::SrsTsContext()
 {
     pure_audio = false;
     vcodec = SrsCodecVideoReserved;
     acodec = SrsCodecAudioReserved1;
+    ts_headers = NULL;
+    ts_iovs = NULL;
+    pat_version = 0;
+    pat_written = false;
+    psi_changed = false;
+    psi_interval = 0;
+    pcr_interval = 0;
+    bitrate = 0;
+    nb_ts_packets = 0;
+    
+    pids = new SrsTsChannel*[SRS_TS_PIDS];
+    memset(pids, 0, sizeof(SrsTsChannel*) * SRS_TS_PIDS);
 }
 
 SrsTsContext::~SrsTsContext()
 {
-    std::map<int, SrsTsChannel*>::iterator it;
-    for (it = pids.begin(); it != pids.end(); ++it) {
-        SrsTsChannel* channel = it->second;
+    srs_freepa(ts_headers);
+    srs_freepa(ts_iovs);
+    
+    std::vector<SrsTsProgram*>::iterator it;
+    for (it = programs.begin(); it != programs.end(); ++it) {
+        SrsTsProgram* program = *it;
+        srs_freep(program);
+    }
+    programs.clear();
+    
+    for (int i = 0; i < SRS_TS_PIDS; i++) {
+        SrsTsChannel* channel = pids[i];
         srs_freep(channel);
     }
-    pids.clear();
+    srs_freepa(pids);
 }
 
 bool SrsTsContext::is_pure_audio()
@@ -223,10 +475,9 @@ void SrsTsContext::on_pmt_parsed()
 {
     pure_audio = true;
     
-    std::map<int, SrsTsChannel*>::iterator it;
-    for (it = pids.begin(); it != pids.end(); ++it) {
-        SrsTsChannel* channel = it->second;
-        if (channel->apply == SrsTsPidApplyVideo) {
+    for (int i = 0; i < SRS_TS_PIDS; i++) {
+        SrsTsChannel* channel = pids[i];
+        if (channel && channel->apply == SrsTsPidApplyVideo) {
             pure_audio = false;
         }
     }
@@ -236,11 +487,12 @@ void SrsTsContext::reset()
 {
     vcodec = SrsCodecVideoReserved;
     acodec = SrsCodecAudioReserved1;
+    psi_changed = true;
 }
 
 SrsTsChannel* SrsTsContext::get(int pid)
 {
-    if (pids.find(pid) == pids.end()) {
+    if (pid < 0 || pid >= SRS_TS_PIDS) {
         return NULL;
     }
     return pids[pid];
@@ -248,14 +500,13 @@ SrsTsChannel* SrsTsContext::get(int pid)
 
 void SrsTsContext::set(int pid, SrsTsPidApply apply_pid, SrsTsStream stream)
 {
-    SrsTsChannel* channel = NULL;
-
-    if (pids.find(pid) == pids.end()) {
+    srs_assert(pid >= 0 && pid < SRS_TS_PIDS);
+    
+    SrsTsChannel* channel = pids[pid];
+    if (!channel) {
         channel = new SrsTsChannel();
         channel->context = this;
         pids[pid] = channel;
-    } else {
-        channel = pids[pid];
     }
 
     channel->pid = pid;
@@ -267,43 +518,370 @@ int SrsTsContext::decode(SrsStream* stream, ISrsTsHandler* handler)
 {
     int ret = ERROR_SUCCESS;
 
-    // parse util EOF of stream.
-    // for example, parse multiple times for the PES_packet_length(0) packet.
+    // parse util EOF of stream, each ts packet in place.
     while (!stream->empty()) {
-        SrsTsPacket* packet = new SrsTsPacket(this);
-        SrsAutoFree(SrsTsPacket, packet);
+        char* data = stream->data() + stream->pos();
+        int left = stream->size() - stream->pos();
+        
+        // resync to the next sync byte when lost, for example, the corrupt udp packet,
+        // the sync byte of next packet should also be 0x47 when there is one.
+        if ((u_int8_t)data[0] != 0x47) {
+            int nb_skip = 1;
+            while (nb_skip < left) {
+                if ((u_int8_t)data[nb_skip] == 0x47
+                    && (nb_skip + SRS_TS_PACKET_SIZE >= left || (u_int8_t)data[nb_skip + SRS_TS_PACKET_SIZE] == 0x47)
+                ) {
+                    break;
+                }
+                nb_skip++;
+            }
+            srs_warn("ts: sync byte must be 0x47, actual=%#x, skip %dB to resync", (u_int8_t)data[0], nb_skip);
+            stream->skip(nb_skip);
+            continue;
+        }
+        
+        if (left < SRS_TS_PACKET_SIZE) {
+            srs_warn("ts: drop the partial packet %dB", left);
+            stream->skip(left);
+            break;
+        }
+        stream->skip(SRS_TS_PACKET_SIZE);
+        
+        if ((ret = decode_packet(data, handler)) != ERROR_SUCCESS) {
+            srs_error("mpegts: decode ts packet failed. ret=%d", ret);
+            return ret;
+        }
+    }
+    
+    return ret;
+}
 
+int SrsTsContext::decode_packet(char* data, ISrsTsHandler* handler)
+{
+    int ret = ERROR_SUCCESS;
+    
+    u_int8_t* p = (u_int8_t*)data;
+    
+    // 4B ts packet header, the sync byte is checked by decode.
+    int8_t payload_unit_start_indicator = (p[1] >> 6) & 0x01;
+    int pid = ((p[1] << 8) | p[2]) & 0x1FFF;
+    SrsTsAdaptationFieldType adaption_field_control = (SrsTsAdaptationFieldType)((p[3] >> 4) & 0x03);
+    u_int8_t continuity_counter = p[3] & 0x0F;
+    
+    // the PAT/PMT is rare, decode by the packet.
+    SrsTsChannel* channel = pids[pid];
+    if (pid == SrsTsPidPAT || (channel && channel->apply == SrsTsPidApplyPMT)) {
+        SrsStream stream;
+        if ((ret = stream.initialize(data, SRS_TS_PACKET_SIZE)) != ERROR_SUCCESS) {
+            return ret;
+        }
+        
+        // ignore the corrupt PAT/PMT, the next one will be decoded.
+        SrsTsPacket packet(this);
         SrsTsMessage* msg = NULL;
-        if ((ret = packet->decode(stream, &msg)) != ERROR_SUCCESS) {
-            srs_error("mpegts: decode ts packet failed. ret=%d", ret);
+        if ((ret = packet.decode(&stream, &msg)) != ERROR_SUCCESS) {
+            srs_warn("ts: ignore the corrupt psi packet, pid=%#x. ret=%d", pid, ret);
+            return ERROR_SUCCESS;
+        }
+        return ret;
+    }
+    
+    // left bytes as reserved.
+    if (!channel || (channel->apply != SrsTsPidApplyVideo && channel->apply != SrsTsPidApplyAudio)) {
+        return ret;
+    }
+    
+    // skip the adaptation field.
+    int pos = 4;
+    if (adaption_field_control == SrsTsAdaptationFieldTypeAdaptionOnly || adaption_field_control == SrsTsAdaptationFieldTypeBoth) {
+        int adaption_field_length = p[4];
+        
+        // When the adaptation_field_control value is '11', the value of the adaptation_field_length shall
+        // be in the range 0 to 182.
+        // When the adaptation_field_control value is '10', the value of the adaptation_field_length shall
+        // be 183.
+        if ((adaption_field_control == SrsTsAdaptationFieldTypeBoth && adaption_field_length > 182)
+            || (adaption_field_control == SrsTsAdaptationFieldTypeAdaptionOnly && adaption_field_length != 183)
+        ) {
+            // drop the partial PES, skip util the next unit start.
+            srs_warn("ts: drop PES for invalid af length=%d, afc=%d, pid=%#x", adaption_field_length, adaption_field_control, pid);
+            if (channel->msg) {
+                channel->msg->reset();
+            }
             return ret;
         }
+        
+        pos += 1 + adaption_field_length;
+    }
+    
+    if (adaption_field_control != SrsTsAdaptationFieldTypePayloadOnly && adaption_field_control != SrsTsAdaptationFieldTypeBoth) {
+        return ret;
+    }
+    
+    return decode_pes(channel, payload_unit_start_indicator, continuity_counter,
+        data + pos, SRS_TS_PACKET_SIZE - pos, handler);
+}
 
+/**
+* decode the 33bits dts or pts of PES header.
+*/
+int srs_ts_decode_33bits_dts_pts(u_int8_t* p, int64_t* pv)
+{
+    int ret = ERROR_SUCCESS;
+    
+    // 4bits const, 3bits [32..30], 1bit marker, 15bits [29..15], 1bit marker, 15bits [14..0], 1bit marker.
+    // @remark, we donot check the high 4bits, maybe '0001', '0010' or '0011'.
+    //      so we just ensure the high 4bits is not 0x00.
+    if ((p[0] & 0x01) != 0x01 || ((p[0] >> 4) & 0x0f) == 0x00 || (p[2] & 0x01) != 0x01 || (p[4] & 0x01) != 0x01) {
+        ret = ERROR_STREAM_CASTER_TS_PSE;
+        srs_warn("ts: demux PSE dts/pts failed. ret=%d", ret);
+        return ret;
+    }
+    
+    int64_t v = 0x00;
+    v |= ((int64_t)((p[0] >> 1) & 0x07) << 30) & 0x1c0000000LL;
+    v |= ((int64_t)(((p[1] << 8) | p[2]) >> 1) << 15) & 0x3fff8000LL;
+    v |= (((p[3] << 8) | p[4]) >> 1) & 0x7fff;
+    *pv = v;
+    
+    return ret;
+}
+
+int SrsTsContext::decode_pes(SrsTsChannel* channel, int8_t payload_unit_start_indicator,
+    u_int8_t continuity_counter, char* data, int size, ISrsTsHandler* handler
+) {
+    int ret = ERROR_SUCCESS;
+    
+    // reparse the packet when the message reaped or dropped.
+    while (true) {
+        // init msg, which is reused for all PES of channel.
+        SrsTsMessage* msg = channel->msg;
         if (!msg) {
+            msg = new SrsTsMessage(channel, NULL);
+            channel->msg = msg;
+        }
+        
+        // we must cache the fresh state of msg,
+        // for the PES_packet_length is 0, the first payload_unit_start_indicator always 1,
+        // so should check for the fresh and not completed it.
+        bool is_fresh_msg = msg->fresh();
+        
+        // check when fresh, the payload_unit_start_indicator
+        // should be 1 for the fresh msg, skip util the next unit start,
+        // for example, the partial PES is dropped or join in the middle.
+        if (is_fresh_msg && !payload_unit_start_indicator) {
+            srs_info("ts: skip PES %dB util unit start, pid=%#x, cc=%d", size, channel->pid, continuity_counter);
+            return ret;
+        }
+        
+        // check when not fresh and PES_packet_length>0,
+        // the payload_unit_start_indicator should never be 1 when not completed.
+        if (!is_fresh_msg && msg->PES_packet_length > 0
+            && !msg->completed(payload_unit_start_indicator)
+            && payload_unit_start_indicator
+        ) {
+            srs_error("ts: PES packet length=%d, payload=%d, us=%d, cc=%d, drop it.",
+                msg->PES_packet_length, msg->payload->length(), payload_unit_start_indicator, continuity_counter);
+            msg->reset();
             continue;
         }
-        SrsAutoFree(SrsTsMessage, msg);
-
-        if ((ret = handler->on_ts_message(msg)) != ERROR_SUCCESS) {
-            srs_error("mpegts: handler ts message failed. ret=%d", ret);
+        
+        // check the continuity counter
+        if (!is_fresh_msg) {
+            // late-incoming or duplicated continuity, drop message.
+            // @remark check overflow, the counter plus 1 should greater when invalid.
+            if (msg->continuity_counter >= continuity_counter
+                && ((msg->continuity_counter + 1) & 0x0f) > continuity_counter
+            ) {
+                srs_warn("ts: drop PES %dB for duplicated cc=%#x", size, msg->continuity_counter);
+                return ret;
+            }
+            
+            // when got partially message, the continous count must be continuous, or drop it.
+            if (((msg->continuity_counter + 1) & 0x0f) != continuity_counter) {
+                srs_error("ts: continuity must be continous, msg=%#x, packet=%#x, drop it.",
+                    msg->continuity_counter, continuity_counter);
+                msg->reset();
+                continue;
+            }
+        }
+        msg->continuity_counter = continuity_counter;
+        
+        // for the PES_packet_length(0), reap when completed.
+        if (!is_fresh_msg && msg->completed(payload_unit_start_indicator)) {
+            if ((ret = reap(msg, handler)) != ERROR_SUCCESS) {
+                return ret;
+            }
+            continue;
+        }
+        
+        u_int8_t* p = (u_int8_t*)data;
+        int pos = 0;
+        bool dump = true;
+        
+        // when unit start, parse the fresh msg.
+        if (payload_unit_start_indicator) {
+            // 6B fixed header, 3B packet_start_code_prefix, 1B stream_id, 2B PES_packet_length.
+            if (size < 6 || p[0] != 0x00 || p[1] != 0x00 || p[2] != 0x01) {
+                srs_warn("ts: drop PES for invalid start code, pid=%#x", channel->pid);
+                msg->reset();
+                return ret;
+            }
+            
+            // @remark the sid indicates the elementary stream format.
+            //      the SrsTsPESStreamIdAudio and SrsTsPESStreamIdVideo is start by 0b110 or 0b1110
+            SrsTsPESStreamId sid = (SrsTsPESStreamId)p[3];
+            int PES_packet_length = (p[4] << 8) | p[5];
+            msg->sid = sid;
+            pos = 6;
+            
+            if (sid != SrsTsPESStreamIdProgramStreamMap
+                && sid != SrsTsPESStreamIdPaddingStream
+                && sid != SrsTsPESStreamIdPrivateStream2
+                && sid != SrsTsPESStreamIdEcmStream
+                && sid != SrsTsPESStreamIdEmmStream
+                && sid != SrsTsPESStreamIdProgramStreamDirectory
+                && sid != SrsTsPESStreamIdDsmccStream
+                && sid != SrsTsPESStreamIdH2221TypeE
+            ) {
+                // 3B flags, the PTS_DTS_flags and PES_header_data_length.
+                if (size < pos + 3) {
+                    srs_warn("ts: drop PES for invalid flags, pid=%#x", channel->pid);
+                    msg->reset();
+                    return ret;
+                }
+                int8_t PTS_DTS_flags = (p[pos + 1] >> 6) & 0x03;
+                int PES_header_data_length = p[pos + 2];
+                pos += 3;
+                
+                int nb_required = (PTS_DTS_flags == 0x2)? 5 : ((PTS_DTS_flags == 0x3)? 10 : 0);
+                if (size < pos + PES_header_data_length || PES_header_data_length < nb_required) {
+                    srs_warn("ts: drop PES for invalid header length=%d, pid=%#x", PES_header_data_length, channel->pid);
+                    msg->reset();
+                    return ret;
+                }
+                
+                // 5B
+                if (PTS_DTS_flags == 0x2) {
+                    if (srs_ts_decode_33bits_dts_pts(p + pos, &msg->pts) != ERROR_SUCCESS) {
+                        msg->reset();
+                        return ret;
+                    }
+                    msg->dts = msg->pts;
+                }
+                
+                // 10B
+                if (PTS_DTS_flags == 0x3) {
+                    if (srs_ts_decode_33bits_dts_pts(p + pos, &msg->pts) != ERROR_SUCCESS
+                        || srs_ts_decode_33bits_dts_pts(p + pos + 5, &msg->dts) != ERROR_SUCCESS
+                    ) {
+                        msg->reset();
+                        return ret;
+                    }
+                    
+                    // check sync, the diff of dts and pts should never greater than 1s.
+                    if (msg->dts - msg->pts > 90000 || msg->pts - msg->dts > 90000) {
+                        srs_warn("ts: sync dts=%"PRId64", pts=%"PRId64, msg->dts, msg->pts);
+                    }
+                }
+                
+                // skip the optional fields and stuffings.
+                pos += PES_header_data_length;
+                
+                // the packet size contains the header size,
+                // use 0 packet length when exceed 0xffff, the next unit start indicates the end.
+                if (PES_packet_length > 0) {
+                    msg->PES_packet_length = srs_max(0, PES_packet_length - 3 - PES_header_data_length);
+                }
+            } else if (sid == SrsTsPESStreamIdPaddingStream) {
+                dump = false;
+            } else if (sid != SrsTsPESStreamIdProgramStreamMap
+                && sid != SrsTsPESStreamIdPrivateStream2
+                && sid != SrsTsPESStreamIdEcmStream
+                && sid != SrsTsPESStreamIdEmmStream
+                && sid != SrsTsPESStreamIdProgramStreamDirectory
+                && sid != SrsTsPESStreamIdDsmccStream
+                && sid != SrsTsPESStreamIdH2221TypeE
+            ) {
+                srs_warn("ts: drop the pes packet %dB for stream_id=%#x", size - pos, sid);
+                dump = false;
+            }
+        }
+        
+        // xB, append the payload bytes to message.
+        if (dump) {
+            int nb_bytes = size - pos;
+            if (msg->PES_packet_length > 0) {
+                nb_bytes = srs_min(nb_bytes, msg->PES_packet_length - msg->payload->length());
+            }
+            if (nb_bytes > 0) {
+                msg->payload->append(data + pos, nb_bytes);
+            }
+        }
+        
+        // when fresh and the PES_packet_length is 0,
+        // the payload_unit_start_indicator always be 1,
+        // the message should never EOF for the first packet.
+        if (is_fresh_msg && msg->PES_packet_length == 0) {
             return ret;
         }
+        
+        // check msg, reap when completed.
+        if (msg->completed(payload_unit_start_indicator)) {
+            return reap(msg, handler);
+        }
+        
+        return ret;
     }
+    
+    return ret;
+}
 
+int SrsTsContext::reap(SrsTsMessage* msg, ISrsTsHandler* handler)
+{
+    int ret = ERROR_SUCCESS;
+    
+    ret = handler->on_ts_message(msg);
+    
+    // reuse the message and its payload buffer.
+    msg->reset();
+    
+    if (ret != ERROR_SUCCESS) {
+        srs_error("mpegts: handler ts message failed. ret=%d", ret);
+        return ret;
+    }
+    
     return ret;
 }
 
+/**
+* whether the interval elapsed since the last dts, or will elapse at the next
+* message, about the step later, so the interval is never exceeded.
+* @remark the dts jump backward is also elapsed.
+*/
+bool srs_ts_interval_expired(int64_t dts, int64_t last, int64_t step, int64_t interval)
+{
+    if (last < 0 || dts < last) {
+        return true;
+    }
+    return dts - last + step > interval;
+}
+
 int SrsTsContext::encode(SrsFileWriter* writer, SrsTsMessage* msg, SrsCodecVideo vc, SrsCodecAudio ac)
 {
     int ret = ERROR_SUCCESS;
 
-    SrsTsStream vs, as;
+    SrsTsStream vs = SrsTsStreamReserved, as = SrsTsStreamReserved;
     int16_t video_pid = 0, audio_pid = 0;
     switch (vc) {
         case SrsCodecVideoAVC: 
             vs = SrsTsStreamVideoH264; 
             video_pid = TS_VIDEO_AVC_PID;
             break;
+        case SrsCodecVideoHEVC:
+            vs = SrsTsStreamVideoHEVC;
+            video_pid = TS_VIDEO_AVC_PID;
+            break;
         case SrsCodecVideoDisabled:
             vs = SrsTsStreamReserved;
             break;
@@ -353,90 +931,315 @@ int SrsTsContext::encode(SrsFileWriter* writer, SrsTsMessage* msg, SrsCodecVideo
         return ret;
     }
     
-    // when any codec changed, write PAT/PMT table.
+    // when any codec changed, use a new program of the audio and video,
+    // the version of PAT/PMT increase when changed after written, for the
+    // receiver which cached the tables, @see add_program and set_stream.
     if (vcodec != vc || acodec != ac) {
         vcodec = vc;
         acodec = ac;
-        if ((ret = encode_pat_pmt(writer, video_pid, vs, audio_pid, as)) != ERROR_SUCCESS) {
-            return ret;
+        
+        SrsTsProgram* program = new SrsTsProgram(TS_PMT_NUMBER, TS_PMT_PID);
+        if (as != SrsTsStreamReserved) {
+            program->pids.push_back(audio_pid);
+            program->streams.push_back(as);
+        }
+        if (vs != SrsTsStreamReserved) {
+            program->pids.push_back(video_pid);
+            program->streams.push_back(vs);
         }
+        
+        // the PAT changed when not the only program.
+        SrsTsProgram* prev = fetch_program(TS_PMT_NUMBER);
+        if (pat_written && (!prev || prev->pmt_pid != TS_PMT_PID || programs.size() != 1)) {
+            pat_version = (pat_version + 1) & 0x1F;
+            pat_written = false;
+        }
+        
+        // keep the version and written of PMT when streams not changed.
+        if (prev) {
+            bool changed = prev->pids != program->pids || prev->streams != program->streams;
+            program->version = (changed && prev->written)? (prev->version + 1) & 0x1F : prev->version;
+            program->written = !changed && prev->written;
+        }
+        
+        std::vector<SrsTsProgram*>::iterator it;
+        for (it = programs.begin(); it != programs.end(); ++it) {
+            SrsTsProgram* p = *it;
+            srs_freep(p);
+        }
+        programs.clear();
+        
+        programs.push_back(program);
+        psi_changed = true;
     }
+    
+    int16_t pid = msg->is_audio()? audio_pid : video_pid;
+    return encode_stream(writer, msg, pid);
+}
 
-    // encode the media frame to PES packets over TS.
-    if (msg->is_audio()) {
-        return encode_pes(writer, msg, audio_pid, as, vs == SrsTsStreamReserved);
-    } else {
-        return encode_pes(writer, msg, video_pid, vs, vs == SrsTsStreamReserved);
+int SrsTsContext::add_program(int number, int pmt_pid)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (number <= 0 || number > 0xFFFF || pmt_pid < SrsTsPidAppStart || pmt_pid > SrsTsPidAppEnd
+        || (int)programs.size() >= SRS_TS_MAX_PROGRAMS
+    ) {
+        ret = ERROR_KERNEL_TS_PROGRAM;
+        srs_error("ts: invalid program %d, pmt=%#x, programs=%d. ret=%d", number, pmt_pid, (int)programs.size(), ret);
+        return ret;
+    }
+    
+    std::vector<SrsTsProgram*>::iterator it;
+    for (it = programs.begin(); it != programs.end(); ++it) {
+        SrsTsProgram* program = *it;
+        if (program->number == number || program->pmt_pid == pmt_pid || program->find(pmt_pid) >= 0) {
+            ret = ERROR_KERNEL_TS_PROGRAM;
+            srs_error("ts: program %d or pmt %#x exists. ret=%d", number, pmt_pid, ret);
+            return ret;
+        }
     }
+    
+    programs.push_back(new SrsTsProgram(number, pmt_pid));
+    
+    if (pat_written) {
+        pat_version = (pat_version + 1) & 0x1F;
+        pat_written = false;
+    }
+    psi_changed = true;
+    
+    return ret;
 }
 
-int SrsTsContext::encode_pat_pmt(SrsFileWriter* writer, int16_t vpid, SrsTsStream vs, int16_t apid, SrsTsStream as)
+int SrsTsContext::set_stream(int number, int pid, SrsTsStream stream)
 {
     int ret = ERROR_SUCCESS;
     
-    if (vs != SrsTsStreamVideoH264 && as != SrsTsStreamAudioAAC && as != SrsTsStreamAudioMp3) {
-        ret = ERROR_HLS_NO_STREAM;
-        srs_error("hls: no pmt pcr pid, vs=%d, as=%d. ret=%d", vs, as, ret);
+    SrsTsProgram* program = fetch_program(number);
+    if (!program || pid < SrsTsPidAppStart || pid > SrsTsPidAppEnd) {
+        ret = ERROR_KERNEL_TS_PROGRAM;
+        srs_error("ts: invalid stream %#x of program %d. ret=%d", pid, number, ret);
         return ret;
     }
-
-    int16_t pmt_number = TS_PMT_NUMBER;
-    int16_t pmt_pid = TS_PMT_PID;
-    if (true) {
-        SrsTsPacket* pkt = SrsTsPacket::create_pat(this, pmt_number, pmt_pid);
-        SrsAutoFree(SrsTsPacket, pkt);
-
-        char* buf = new char[SRS_TS_PACKET_SIZE];
-        SrsAutoFreeA(char, buf);
-
-        // set the left bytes with 0xFF.
-        int nb_buf = pkt->size();
-        srs_assert(nb_buf < SRS_TS_PACKET_SIZE);
-        memset(buf + nb_buf, 0xFF, SRS_TS_PACKET_SIZE - nb_buf);
-
-        SrsStream stream;
-        if ((ret = stream.initialize(buf, nb_buf)) != ERROR_SUCCESS) {
+    
+    int index = program->find(pid);
+    if (index >= 0 && program->streams[index] == stream) {
+        return ret;
+    }
+    
+    std::vector<SrsTsProgram*>::iterator it;
+    for (it = programs.begin(); it != programs.end(); ++it) {
+        SrsTsProgram* p = *it;
+        if (p->pmt_pid == pid || (p != program && p->find(pid) >= 0)) {
+            ret = ERROR_KERNEL_TS_PROGRAM;
+            srs_error("ts: stream %#x of program %d exists. ret=%d", pid, number, ret);
             return ret;
         }
-        if ((ret = pkt->encode(&stream)) != ERROR_SUCCESS) {
-            srs_error("ts encode ts packet failed. ret=%d", ret);
+    }
+    
+    if (index >= 0) {
+        program->pids.erase(program->pids.begin() + index);
+        program->streams.erase(program->streams.begin() + index);
+    }
+    
+    if (stream != SrsTsStreamReserved) {
+        if ((int)program->pids.size() >= SRS_TS_MAX_STREAMS) {
+            ret = ERROR_KERNEL_TS_PROGRAM;
+            srs_error("ts: program %d exceed %d streams. ret=%d", number, SRS_TS_MAX_STREAMS, ret);
             return ret;
         }
-        if ((ret = writer->write(buf, SRS_TS_PACKET_SIZE, NULL)) != ERROR_SUCCESS) {
-            srs_error("ts write ts packet failed. ret=%d", ret);
+        
+        // keep the order of stream when type changed.
+        index = (index >= 0)? index : (int)program->pids.size();
+        program->pids.insert(program->pids.begin() + index, (int16_t)pid);
+        program->streams.insert(program->streams.begin() + index, stream);
+    }
+    
+    if (program->written) {
+        program->version = (program->version + 1) & 0x1F;
+        program->written = false;
+    }
+    psi_changed = true;
+    
+    return ret;
+}
+
+int SrsTsContext::encode_stream(SrsFileWriter* writer, SrsTsMessage* msg, int16_t pid)
+{
+    int ret = ERROR_SUCCESS;
+    
+    SrsTsProgram* program = NULL;
+    int index = -1;
+    
+    std::vector<SrsTsProgram*>::iterator it;
+    for (it = programs.begin(); it != programs.end() && index < 0; ++it) {
+        program = *it;
+        index = program->find(pid);
+    }
+    
+    if (index < 0) {
+        srs_info("ts: ignore the unknown stream, pid=%d", pid);
+        return ret;
+    }
+    SrsTsStream sid = program->streams[index];
+    
+    // the step to the next message, about the max step of messages,
+    // ignore the gap of stream which is not the interval of frames.
+    int64_t last_dts = program->last_dts;
+    if (last_dts >= 0 && msg->dts > last_dts && msg->dts - last_dts < SRS_TS_MAX_STEP) {
+        program->max_step = srs_max(program->max_step, msg->dts - last_dts);
+    }
+    program->last_dts = msg->dts;
+    int64_t step = program->max_step;
+    
+    // when any stream changed, or the interval will elapse at the next message, 
+    // write the PAT and all PMT, each program repeat them on its dts.
+    bool psi_expired = psi_interval > 0 && srs_ts_interval_expired(msg->dts, program->last_psi_dts, step, psi_interval);
+    if (psi_changed || psi_expired) {
+        psi_changed = false;
+        for (it = programs.begin(); it != programs.end(); ++it) {
+            SrsTsProgram* p = *it;
+            p->last_psi_dts = p->last_dts;
+        }
+        if ((ret = encode_psi(writer)) != ERROR_SUCCESS) {
             return ret;
         }
     }
-    if (true) {
-        SrsTsPacket* pkt = SrsTsPacket::create_pmt(this, pmt_number, pmt_pid, vpid, vs, apid, as);
-        SrsAutoFree(SrsTsPacket, pkt);
+    
+    // write pcr according to message.
+    bool write_pcr = msg->write_pcr;
+    int16_t pcr_pid = program->pcr_pid();
+    
+    if (pcr_interval <= 0) {
+        // for pure audio, always write pcr.
+        if (pid == pcr_pid && msg->is_audio()) {
+            write_pcr = true;
+        }
+    } else {
+        if (pid == pcr_pid && write_pcr) {
+            program->last_pcr_dts = msg->dts;
+        }
+        
+        if (srs_ts_interval_expired(msg->dts, program->last_pcr_dts, step, pcr_interval)) {
+            program->last_pcr_dts = msg->dts;
+            if (pid == pcr_pid) {
+                write_pcr = true;
+            } else if ((ret = encode_pcr(writer, program, pcr_of(program, msg->dts))) != ERROR_SUCCESS) {
+                return ret;
+            }
+        }
+    }
+    
+    // encode the media frame to PES packets over TS.
+    return encode_pes(writer, msg, program, pid, sid, write_pcr);
+}
+
+void SrsTsContext::set_psi_interval(int psi_ms)
+{
+    psi_interval = srs_max(0, psi_ms) * 90;
+    
+    std::vector<SrsTsProgram*>::iterator it;
+    for (it = programs.begin(); it != programs.end(); ++it) {
+        SrsTsProgram* program = *it;
+        program->last_psi_dts = -1;
+    }
+}
 
-        char* buf = new char[SRS_TS_PACKET_SIZE];
-        SrsAutoFreeA(char, buf);
+void SrsTsContext::set_pcr_interval(int pcr_ms)
+{
+    pcr_interval = srs_max(0, pcr_ms) * 90;
+    
+    std::vector<SrsTsProgram*>::iterator it;
+    for (it = programs.begin(); it != programs.end(); ++it) {
+        SrsTsProgram* program = *it;
+        program->last_pcr_dts = -1;
+    }
+}
 
-        // set the left bytes with 0xFF.
-        int nb_buf = pkt->size();
-        srs_assert(nb_buf < SRS_TS_PACKET_SIZE);
-        memset(buf + nb_buf, 0xFF, SRS_TS_PACKET_SIZE - nb_buf);
+void SrsTsContext::set_bitrate(int64_t bps)
+{
+    bitrate = srs_max(0, bps);
+}
 
-        SrsStream stream;
-        if ((ret = stream.initialize(buf, nb_buf)) != ERROR_SUCCESS) {
-            return ret;
+SrsTsProgram* SrsTsContext::fetch_program(int number)
+{
+    std::vector<SrsTsProgram*>::iterator it;
+    for (it = programs.begin(); it != programs.end(); ++it) {
+        SrsTsProgram* program = *it;
+        if (program->number == number) {
+            return program;
         }
-        if ((ret = pkt->encode(&stream)) != ERROR_SUCCESS) {
-            srs_error("ts encode ts packet failed. ret=%d", ret);
+    }
+    return NULL;
+}
+
+int SrsTsContext::encode_psi(SrsFileWriter* writer)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (true) {
+        SrsTsPacket* pkt = SrsTsPacket::create_pat(this, programs, pat_version);
+        SrsAutoFree(SrsTsPacket, pkt);
+        
+        if ((ret = encode_psi_packet(writer, pkt)) != ERROR_SUCCESS) {
             return ret;
         }
-        if ((ret = writer->write(buf, SRS_TS_PACKET_SIZE, NULL)) != ERROR_SUCCESS) {
-            srs_error("ts write ts packet failed. ret=%d", ret);
+        pat_written = true;
+    }
+    
+    std::vector<SrsTsProgram*>::iterator it;
+    for (it = programs.begin(); it != programs.end(); ++it) {
+        SrsTsProgram* program = *it;
+        
+        SrsTsPacket* pkt = SrsTsPacket::create_pmt(this, program);
+        SrsAutoFree(SrsTsPacket, pkt);
+        
+        if ((ret = encode_psi_packet(writer, pkt)) != ERROR_SUCCESS) {
             return ret;
         }
+        program->written = true;
+    }
+
+    return ret;
+}
+
+int SrsTsContext::encode_psi_packet(SrsFileWriter* writer, SrsTsPacket* pkt)
+{
+    int ret = ERROR_SUCCESS;
+    
+    // the continuity counter of the repeated PAT/PMT.
+    SrsTsChannel* channel = get(pkt->pid);
+    pkt->continuity_counter = channel? channel->continuity_counter : 0;
+    
+    char buf[SRS_TS_PACKET_SIZE];
+    
+    // set the left bytes with 0xFF.
+    int nb_buf = pkt->size();
+    srs_assert(nb_buf < SRS_TS_PACKET_SIZE);
+    memset(buf + nb_buf, 0xFF, SRS_TS_PACKET_SIZE - nb_buf);
+    
+    SrsStream stream;
+    if ((ret = stream.initialize(buf, nb_buf)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    if ((ret = pkt->encode(&stream)) != ERROR_SUCCESS) {
+        srs_error("ts encode ts packet failed. ret=%d", ret);
+        return ret;
+    }
+    if ((ret = writer->write(buf, SRS_TS_PACKET_SIZE, NULL)) != ERROR_SUCCESS) {
+        srs_error("ts write ts packet failed. ret=%d", ret);
+        return ret;
     }
-
+    nb_ts_packets++;
+    
+    // the channel is set when encode the PSI.
+    if ((channel = get(pkt->pid)) != NULL) {
+        channel->continuity_counter = (pkt->continuity_counter + 1) & 0x0F;
+    }
+    
     return ret;
 }
 
-int SrsTsContext::encode_pes(SrsFileWriter* writer, SrsTsMessage* msg, int16_t pid, SrsTsStream sid, bool pure_audio)
+int SrsTsContext::encode_pes(SrsFileWriter* writer, SrsTsMessage* msg, SrsTsProgram* program, int16_t pid, SrsTsStream sid, bool write_pcr)
 {
     int ret = ERROR_SUCCESS;
 
@@ -444,90 +1247,146 @@ int SrsTsContext::encode_pes(SrsFileWriter* writer, SrsTsMessage* msg, int16_t p
         return ret;
     }
 
-    if (sid != SrsTsStreamVideoH264 && sid != SrsTsStreamAudioMp3 && sid != SrsTsStreamAudioAAC) {
+    if (sid != SrsTsStreamVideoH264 && sid != SrsTsStreamVideoHEVC
+        && sid != SrsTsStreamAudioMp3 && sid != SrsTsStreamAudioAAC
+    ) {
         srs_info("ts: ignore the unknown stream, sid=%d", sid);
         return ret;
     }
 
     SrsTsChannel* channel = get(pid);
     srs_assert(channel);
+    
+    if (!ts_headers) {
+        ts_headers = new char[SRS_PERF_TS_WRITEV_PACKETS * SRS_TS_PACKET_SIZE];
+        ts_iovs = new iovec[SRS_PERF_TS_WRITEV_PACKETS * 2];
+    }
 
     char* start = msg->payload->bytes();
     char* end = start + msg->payload->length();
     char* p = start;
+    int nb_packets = 0;
+    
+    int16_t pcr_pid = program->pcr_pid();
+    SrsTsChannel* pcr_channel = get(pcr_pid);
 
     while (p < end) {
-        SrsTsPacket* pkt = NULL;
-        if (p == start) {
-            // write pcr according to message.
-            bool write_pcr = msg->write_pcr;
-            
-            // for pure audio, always write pcr.
-            // TODO: FIXME: maybe only need to write at begin and end of ts.
-            if (pure_audio && msg->is_audio()) {
-                write_pcr = true;
-            }
-
+        char* header = ts_headers + nb_packets * SRS_TS_PACKET_SIZE;
+        int nb_header = 0;
+        int left = 0;
+        
+        // the PCR is due inside the long PES at the bitrate, write it in the packet
+        // of PCR pid, or in an adaptation only packet of the PCR pid.
+        bool due = pcr_due(program);
+        if (due && pid != pcr_pid && pcr_channel) {
+            int64_t pcr = pcr_of(program, -1);
+            srs_ts_encode_pcr(header, pcr_pid, (pcr_channel->continuity_counter - 1) & 0x0F, pcr);
+            on_pcr(program, pcr);
+            nb_header = SRS_TS_PACKET_SIZE;
+        } else if (p == start) {
             // it's ok to set pcr equals to dts,
             // @see https://github.com/ossrs/srs/issues/311
-            int64_t pcr = write_pcr? msg->dts : -1;
+            int64_t pcr = -1;
+            if (write_pcr || (due && pid == pcr_pid)) {
+                pcr = pcr_of(program, msg->dts);
+                on_pcr(program, pcr);
+            }
             
             // TODO: FIXME: finger it why use discontinuity of msg.
-            pkt = SrsTsPacket::create_pes_first(this, 
-                pid, msg->sid, channel->continuity_counter++, msg->is_discontinuity,
-                pcr, msg->dts, msg->pts, msg->payload->length()
+            nb_header = srs_ts_encode_pes_first(header, pid, msg->sid, channel->continuity_counter++,
+                msg->is_discontinuity, pcr, msg->dts, msg->pts, msg->payload->length(), (int)(end - p)
             );
         } else {
-            pkt = SrsTsPacket::create_pes_continue(this, 
-                pid, msg->sid, channel->continuity_counter++
-            );
+            int64_t pcr = -1;
+            if (due && pid == pcr_pid) {
+                pcr = pcr_of(program, -1);
+                on_pcr(program, pcr);
+            }
+            nb_header = srs_ts_encode_pes_continue(header, pid, channel->continuity_counter++, (int)(end - p), pcr);
         }
-        SrsAutoFree(SrsTsPacket, pkt);
-
-        char* buf = new char[SRS_TS_PACKET_SIZE];
-        SrsAutoFreeA(char, buf);
-
-        // set the left bytes with 0xFF.
-        int nb_buf = pkt->size();
-        srs_assert(nb_buf < SRS_TS_PACKET_SIZE);
-
-        int left = (int)srs_min(end - p, SRS_TS_PACKET_SIZE - nb_buf);
-        int nb_stuffings = SRS_TS_PACKET_SIZE - nb_buf - left;
-        if (nb_stuffings > 0) {
-            // set all bytes to stuffings.
-            memset(buf, 0xFF, SRS_TS_PACKET_SIZE);
-
-            // padding with stuffings.
-            pkt->padding(nb_stuffings);
-
-            // size changed, recalc it.
-            nb_buf = pkt->size();
-            srs_assert(nb_buf < SRS_TS_PACKET_SIZE);
-
-            left = (int)srs_min(end - p, SRS_TS_PACKET_SIZE - nb_buf);
-            nb_stuffings = SRS_TS_PACKET_SIZE - nb_buf - left;
-            srs_assert(nb_stuffings == 0);
+        srs_assert(nb_header <= SRS_TS_PACKET_SIZE);
+        
+        // the header is padding with stuffings, the payload fill the packet.
+        if (nb_header < SRS_TS_PACKET_SIZE) {
+            left = (int)srs_min(end - p, SRS_TS_PACKET_SIZE - nb_header);
+            srs_assert(nb_header + left == SRS_TS_PACKET_SIZE);
         }
-        memcpy(buf + nb_buf, p, left);
+        
+        iovec* iovs = ts_iovs + nb_packets * 2;
+        iovs[0].iov_base = header;
+        iovs[0].iov_len = nb_header;
+        iovs[1].iov_base = p;
+        iovs[1].iov_len = left;
         p += left;
-
-        SrsStream stream;
-        if ((ret = stream.initialize(buf, nb_buf)) != ERROR_SUCCESS) {
-            return ret;
-        }
-        if ((ret = pkt->encode(&stream)) != ERROR_SUCCESS) {
-            srs_error("ts encode ts packet failed. ret=%d", ret);
-            return ret;
+        nb_ts_packets++;
+        
+        // write the packets when buffer is full or message is done.
+        if (++nb_packets < SRS_PERF_TS_WRITEV_PACKETS && p < end) {
+            continue;
         }
-        if ((ret = writer->write(buf, SRS_TS_PACKET_SIZE, NULL)) != ERROR_SUCCESS) {
+        if ((ret = writer->writev(ts_iovs, nb_packets * 2, NULL)) != ERROR_SUCCESS) {
             srs_error("ts write ts packet failed. ret=%d", ret);
             return ret;
         }
+        nb_packets = 0;
     }
 
     return ret;
 }
 
+int SrsTsContext::encode_pcr(SrsFileWriter* writer, SrsTsProgram* program, int64_t pcr)
+{
+    int ret = ERROR_SUCCESS;
+    
+    int16_t pid = program->pcr_pid();
+    SrsTsChannel* channel = get(pid);
+    if (!channel) {
+        return ret;
+    }
+    
+    char buf[SRS_TS_PACKET_SIZE];
+    srs_ts_encode_pcr(buf, pid, (channel->continuity_counter - 1) & 0x0F, pcr);
+    
+    if ((ret = writer->write(buf, SRS_TS_PACKET_SIZE, NULL)) != ERROR_SUCCESS) {
+        srs_error("ts write pcr packet failed. ret=%d", ret);
+        return ret;
+    }
+    on_pcr(program, pcr);
+    nb_ts_packets++;
+    
+    return ret;
+}
+
+bool SrsTsContext::pcr_due(SrsTsProgram* program)
+{
+    if (bitrate <= 0 || pcr_interval <= 0 || program->last_pcr_packets < 0) {
+        return false;
+    }
+    
+    // the packets at the bitrate in the interval, at least one.
+    int64_t interval = srs_max(1, pcr_interval * bitrate / (90000LL * SRS_TS_PACKET_SIZE * 8));
+    return nb_ts_packets - program->last_pcr_packets >= interval;
+}
+
+int64_t SrsTsContext::pcr_of(SrsTsProgram* program, int64_t dts)
+{
+    if (bitrate <= 0 || program->last_pcr < 0) {
+        return dts;
+    }
+    
+    // the time of packets written since the last PCR, at the bitrate,
+    // round up, so the PCR is never before the position of packet.
+    int64_t elapsed = (nb_ts_packets - program->last_pcr_packets) * SRS_TS_PACKET_SIZE * 8 * 90000LL;
+    elapsed = (elapsed + bitrate - 1) / bitrate;
+    return srs_max(dts, program->last_pcr + elapsed);
+}
+
+void SrsTsContext::on_pcr(SrsTsProgram* program, int64_t pcr)
+{
+    program->last_pcr = pcr;
+    program->last_pcr_packets = nb_ts_packets;
+}
+
 SrsTsPacket::SrsTsPacket(SrsTsContext* c)
 {
     context = c;
@@ -720,7 +1579,7 @@ void SrsTsPacket::padding(int nb_stuffings)
     }
 }
 
-SrsTsPacket* SrsTsPacket::create_pat(SrsTsContext* context, int16_t pmt_number, int16_t pmt_pid)
+SrsTsPacket* SrsTsPacket::create_pat(SrsTsContext* context, vector<SrsTsProgram*>& programs, int8_t version)
 {
     SrsTsPacket* pkt = new SrsTsPacket(context);
     pkt->sync_byte = 0x47;
@@ -740,26 +1599,28 @@ SrsTsPacket* SrsTsPacket::create_pat(SrsTsContext* context, int16_t pmt_number,
     pat->section_syntax_indicator = 1;
     pat->section_length = 0; // calc in size.
     pat->transport_stream_id = 1;
-    pat->version_number = 0;
+    pat->version_number = version;
     pat->current_next_indicator = 1;
     pat->section_number = 0;
     pat->last_section_number = 0;
-    pat->programs.push_back(new SrsTsPayloadPATProgram(pmt_number, pmt_pid));
+    for (int i = 0; i < (int)programs.size(); i++) {
+        SrsTsProgram* program = programs[i];
+        pat->programs.push_back(new SrsTsPayloadPATProgram(program->number, program->pmt_pid));
+    }
     pat->CRC_32 = 0; // calc in encode.
     return pkt;
 }
 
-SrsTsPacket* SrsTsPacket::create_pmt(SrsTsContext* context, int16_t pmt_number, int16_t pmt_pid, int16_t vpid, SrsTsStream vs, int16_t apid, SrsTsStream as)
+SrsTsPacket* SrsTsPacket::create_pmt(SrsTsContext* context, SrsTsProgram* program)
 {
     SrsTsPacket* pkt = new SrsTsPacket(context);
     pkt->sync_byte = 0x47;
     pkt->transport_error_indicator = 0;
     pkt->payload_unit_start_indicator = 1;
     pkt->transport_priority = 0;
-    pkt->pid = (SrsTsPid)pmt_pid;
+    pkt->pid = (SrsTsPid)program->pmt_pid;
     pkt->transport_scrambling_control = SrsTsScrambledDisabled;
     pkt->adaption_field_control = SrsTsAdaptationFieldTypePayloadOnly;
-    // TODO: FIXME: maybe should continuous in channel.
     pkt->continuity_counter = 0;
     pkt->adaptation_field = NULL;
     SrsTsPayloadPMT* pmt = new SrsTsPayloadPMT(pkt);
@@ -769,28 +1630,17 @@ SrsTsPacket* SrsTsPacket::create_pmt(SrsTsContext* context, int16_t pmt_number,
     pmt->table_id = SrsTsPsiIdPms;
     pmt->section_syntax_indicator = 1;
     pmt->section_length = 0; // calc in size.
-    pmt->program_number = pmt_number;
-    pmt->version_number = 0;
+    pmt->program_number = program->number;
+    pmt->version_number = program->version;
     pmt->current_next_indicator = 1;
     pmt->section_number = 0;
     pmt->last_section_number = 0;
     pmt->program_info_length = 0;
     
-    // must got one valid codec.
-    srs_assert(vs == SrsTsStreamVideoH264 || as == SrsTsStreamAudioAAC || as == SrsTsStreamAudioMp3);
-    
-    // if mp3 or aac specified, use audio to carry pcr.
-    if (as == SrsTsStreamAudioAAC || as == SrsTsStreamAudioMp3) {
-        // use audio to carray pcr by default.
-        // for hls, there must be atleast one audio channel.
-        pmt->PCR_PID = apid;
-        pmt->infos.push_back(new SrsTsPayloadPMTESInfo(as, apid));
-    }
-    
-    // if h.264 specified, use video to carry pcr.
-    if (vs == SrsTsStreamVideoH264) {
-        pmt->PCR_PID = vpid;
-        pmt->infos.push_back(new SrsTsPayloadPMTESInfo(vs, vpid));
+    // the video carry pcr when specified, otherwise the audio.
+    pmt->PCR_PID = program->pcr_pid();
+    for (int i = 0; i < (int)program->pids.size(); i++) {
+        pmt->infos.push_back(new SrsTsPayloadPMTESInfo(program->streams[i], program->pids[i]));
     }
     
     pmt->CRC_32 = 0; // calc in encode.
@@ -1194,7 +2044,7 @@ int SrsTsAdaptationField::encode(SrsStream* stream)
         // @see https://github.com/ossrs/srs/issues/250#issuecomment-71349370
         int64_t pcrv = program_clock_reference_extension & 0x1ff;
         pcrv |= (const1_value0 << 9) & 0x7E00;
-        pcrv |= (program_clock_reference_base << 15) & 0x1FFFFFFFF000000LL;
+        pcrv |= (program_clock_reference_base << 15) & 0xFFFFFFFF8000LL;
 
         pp = (char*)&pcrv;
         *p++ = pp[5];
@@ -2580,6 +3430,7 @@ int SrsTsPayloadPMT::psi_decode(SrsStream* stream)
         // update the apply pid table
         switch (info->stream_type) {
             case SrsTsStreamVideoH264:
+            case SrsTsStreamVideoHEVC:
             case SrsTsStreamVideoMpeg4:
                 packet->context->set(info->elementary_PID, SrsTsPidApplyVideo, info->stream_type);
                 break;
@@ -2667,6 +3518,7 @@ int SrsTsPayloadPMT::psi_encode(SrsStream* stream)
         // update the apply pid table
         switch (info->stream_type) {
             case SrsTsStreamVideoH264:
+            case SrsTsStreamVideoHEVC:
             case SrsTsStreamVideoMpeg4:
                 packet->context->set(info->elementary_PID, SrsTsPidApplyVideo, info->stream_type);
                 break;
@@ -2726,6 +3578,12 @@ int SrsTSMuxer::update_acodec(SrsCodecAudio ac)
     return ERROR_SUCCESS;
 }
 
+int SrsTSMuxer::update_vcodec(SrsCodecVideo vc)
+{
+    vcodec = vc;
+    return ERROR_SUCCESS;
+}
+
 int SrsTSMuxer::write_audio(SrsTsMessage* audio)
 {
     int ret = ERROR_SUCCESS;
@@ -2758,9 +3616,21 @@ int SrsTSMuxer::write_video(SrsTsMessage* video)
     return ret;
 }
 
-void SrsTSMuxer::close()
+int SrsTSMuxer::write_stream(int16_t pid, SrsTsMessage* msg)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if ((ret = context->encode_stream(writer, msg, pid)) != ERROR_SUCCESS) {
+        srs_error("ts encode stream %#x failed. ret=%d", pid, ret);
+        return ret;
+    }
+    
+    return ret;
+}
+
+int SrsTSMuxer::close()
 {
-    writer->close();
+    return writer->close();
 }
 
 SrsCodecVideo SrsTSMuxer::video_codec()
@@ -3000,12 +3870,29 @@ int SrsTsCache::do_cache_avc(SrsAvcAacCodec* codec, SrsCodecSample* sample)
     // H.264-AVC-ISO_IEC_14496-10-2012.pdf, page 105.
     static u_int8_t aud_nalu_7[] = { 0x09, 0xf0};
     
+    // for hevc, the 2bytes nalu header of aud(nal_unit_type:35),
+    // then pic_type u(3) 2 for all slice types, with the rbsp stop bit.
+    // 7.3.2.5 Access unit delimiter RBSP syntax
+    // H.265-HEVC-ITU-T-REC-H.265-201304.pdf, page 44.
+    static u_int8_t aud_nalu_35[] = { 0x46, 0x01, 0x50 };
+    bool is_hevc = sample->vcodec == SrsCodecVideoHEVC;
+    
     // always append a aud nalu for each frame.
     video->payload->append((const char*)fresh_nalu_header, 4);
-    video->payload->append((const char*)aud_nalu_7, 2);
+    if (is_hevc) {
+        video->payload->append((const char*)aud_nalu_35, 3);
+    } else {
+        video->payload->append((const char*)aud_nalu_7, 2);
+    }
     
-    // when ts message(samples) contains IDR, insert sps+pps.
+    // when ts message(samples) contains IDR, insert sps+pps,
+    // for hevc, the IRAP frame, insert vps+sps+pps.
     if (sample->has_idr) {
+        // fresh nalu header before vps.
+        if (is_hevc && codec->videoParameterSetLength > 0) {
+            video->payload->append((const char*)fresh_nalu_header, 4);
+            video->payload->append(codec->videoParameterSetNALUnit, codec->videoParameterSetLength);
+        }
         // fresh nalu header before sps.
         if (codec->sequenceParameterSetLength > 0) {
             // AnnexB prefix, for sps always 4 bytes header
@@ -3033,6 +3920,18 @@ int SrsTsCache::do_cache_avc(SrsAvcAacCodec* codec, SrsCodecSample* sample)
             return ret;
         }
         
+        // for hevc, ignore VPS/SPS/PPS/AUD
+        if (is_hevc) {
+            SrsHevcNaluType hevc_nalu_type = (SrsHevcNaluType)((sample_unit->bytes[0] >> 1) & 0x3f);
+            if (hevc_nalu_type >= SrsHevcNaluTypeVPS && hevc_nalu_type <= SrsHevcNaluTypeAccessUnitDelimiter) {
+                continue;
+            }
+            
+            video->payload->append((const char*)cont_nalu_header, 3);
+            video->payload->append(sample_unit->bytes, sample_unit->size);
+            continue;
+        }
+        
         // 5bits, 7.3.1 NAL unit syntax,
         // H.264-AVC-ISO_IEC_14496-10-2012.pdf, page 83.
         SrsAvcNaluType nal_unit_type = (SrsAvcNaluType)(sample_unit->bytes[0] & 0x1f);
@@ -3100,6 +3999,17 @@ int SrsTsEncoder::initialize(SrsFileWriter* fw)
     return ret;
 }
 
+void SrsTsEncoder::set_interval(int psi_ms, int pcr_ms)
+{
+    context->set_psi_interval(psi_ms);
+    context->set_pcr_interval(pcr_ms);
+}
+
+void SrsTsEncoder::set_bitrate(int64_t bps)
+{
+    context->set_bitrate(bps);
+}
+
 int SrsTsEncoder::write_audio(int64_t timestamp, char* data, int size)
 {
     int ret = ERROR_SUCCESS;
@@ -3166,7 +4076,13 @@ int SrsTsEncoder::write_video(int64_t timestamp, char* data, int size)
         return ret;
     }
     
-    if (codec->video_codec_id != SrsCodecVideoAVC) {
+    if (codec->video_codec_id != SrsCodecVideoAVC && codec->video_codec_id != SrsCodecVideoHEVC) {
+        return ret;
+    }
+    
+    // when codec changed, write new header.
+    if ((ret = muxer->update_vcodec((SrsCodecVideo)codec->video_codec_id)) != ERROR_SUCCESS) {
+        srs_error("http: ts video write header failed. ret=%d", ret);
         return ret;
     }
     
@@ -3214,5 +4130,230 @@ int SrsTsEncoder::flush_video()
     return ret;
 }
 
+SrsTsTrack::SrsTsTrack(int p, int16_t id)
+{
+    program = p;
+    pid = id;
+    codec = new SrsAvcAacCodec();
+    sample = new SrsCodecSample();
+    cache = new SrsTsCache();
+}
+
+SrsTsTrack::~SrsTsTrack()
+{
+    srs_freep(codec);
+    srs_freep(sample);
+    srs_freep(cache);
+}
+
+SrsTsMultiEncoder::SrsTsMultiEncoder()
+{
+    writer = NULL;
+    muxer = NULL;
+    context = new SrsTsContext();
+}
+
+SrsTsMultiEncoder::~SrsTsMultiEncoder()
+{
+    std::vector<SrsTsTrack*>::iterator it;
+    for (it = tracks.begin(); it != tracks.end(); ++it) {
+        SrsTsTrack* track = *it;
+        srs_freep(track);
+    }
+    tracks.clear();
+    
+    srs_freep(muxer);
+    srs_freep(context);
+}
+
+int SrsTsMultiEncoder::initialize(SrsFileWriter* fw)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(fw);
+    
+    if (!fw->is_open()) {
+        ret = ERROR_KERNEL_FLV_STREAM_CLOSED;
+        srs_warn("stream is not open for encoder. ret=%d", ret);
+        return ret;
+    }
+    
+    writer = fw;
+    
+    // the writer is opened by user, never reopen it.
+    srs_freep(muxer);
+    muxer = new SrsTSMuxer(fw, context, SrsCodecAudioAAC, SrsCodecVideoAVC);
+    context->reset();
+    
+    return ret;
+}
+
+void SrsTsMultiEncoder::set_interval(int psi_ms, int pcr_ms)
+{
+    context->set_psi_interval(psi_ms);
+    context->set_pcr_interval(pcr_ms);
+}
+
+void SrsTsMultiEncoder::set_bitrate(int64_t bps)
+{
+    context->set_bitrate(bps);
+}
+
+int SrsTsMultiEncoder::add_track(int program, int pid, int* ptrack)
+{
+    int ret = ERROR_SUCCESS;
+    
+    // the pid over 0x1000 is the PMT of program.
+    if (program <= 0 || program >= 0xFFF || pid < SrsTsPidAppStart || pid >= 0x1000) {
+        ret = ERROR_KERNEL_TS_PROGRAM;
+        srs_error("ts: invalid track %#x of program %d. ret=%d", pid, program, ret);
+        return ret;
+    }
+    
+    bool has_program = false;
+    std::vector<SrsTsTrack*>::iterator it;
+    for (it = tracks.begin(); it != tracks.end(); ++it) {
+        SrsTsTrack* track = *it;
+        if (track->pid == pid) {
+            ret = ERROR_KERNEL_TS_PROGRAM;
+            srs_error("ts: track %#x exists. ret=%d", pid, ret);
+            return ret;
+        }
+        has_program |= track->program == program;
+    }
+    
+    // the stream is set when got the codec of track.
+    if (!has_program && (ret = context->add_program(program, 0x1000 + program)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    tracks.push_back(new SrsTsTrack(program, (int16_t)pid));
+    
+    if (ptrack) {
+        *ptrack = (int)tracks.size() - 1;
+    }
+    
+    return ret;
+}
+
+int SrsTsMultiEncoder::write_audio(int track, int64_t timestamp, char* data, int size)
+{
+    int ret = ERROR_SUCCESS;
+    
+    SrsTsTrack* t = fetch(track);
+    if (!t) {
+        ret = ERROR_KERNEL_TS_PROGRAM;
+        srs_error("ts: invalid track %d. ret=%d", track, ret);
+        return ret;
+    }
+    
+    SrsAvcAacCodec* codec = t->codec;
+    SrsCodecSample* sample = t->sample;
+    
+    sample->clear();
+    if ((ret = codec->audio_aac_demux(data, size, sample)) != ERROR_SUCCESS) {
+        if (ret != ERROR_HLS_TRY_MP3) {
+            srs_error("ts: aac demux audio failed. ret=%d", ret);
+            return ret;
+        }
+        if ((ret = codec->audio_mp3_demux(data, size, sample)) != ERROR_SUCCESS) {
+            srs_error("ts: mp3 demux audio failed. ret=%d", ret);
+            return ret;
+        }
+    }
+    SrsCodecAudio acodec = (SrsCodecAudio)codec->audio_codec_id;
+    
+    // ts support audio codec: aac/mp3
+    if (acodec != SrsCodecAudioAAC && acodec != SrsCodecAudioMP3) {
+        return ret;
+    }
+    
+    // for aac: ignore sequence header
+    if (acodec == SrsCodecAudioAAC && sample->aac_packet_type == SrsCodecAudioTypeSequenceHeader) {
+        return ret;
+    }
+    
+    if ((ret = t->cache->cache_audio(codec, timestamp * 90, sample)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    SrsTsStream stream = (acodec == SrsCodecAudioAAC)? SrsTsStreamAudioAAC : SrsTsStreamAudioMp3;
+    if ((ret = flush(t, t->cache->audio, stream)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    srs_freep(t->cache->audio);
+    
+    return ret;
+}
+
+int SrsTsMultiEncoder::write_video(int track, int64_t timestamp, char* data, int size)
+{
+    int ret = ERROR_SUCCESS;
+    
+    SrsTsTrack* t = fetch(track);
+    if (!t) {
+        ret = ERROR_KERNEL_TS_PROGRAM;
+        srs_error("ts: invalid track %d. ret=%d", track, ret);
+        return ret;
+    }
+    
+    SrsAvcAacCodec* codec = t->codec;
+    SrsCodecSample* sample = t->sample;
+    
+    sample->clear();
+    if ((ret = codec->video_avc_demux(data, size, sample)) != ERROR_SUCCESS) {
+        srs_error("ts: codec demux video failed. ret=%d", ret);
+        return ret;
+    }
+    
+    // ignore info frame,
+    // @see https://github.com/ossrs/srs/issues/288#issuecomment-69863909
+    if (sample->frame_type == SrsCodecVideoAVCFrameVideoInfoFrame) {
+        return ret;
+    }
+    
+    if (codec->video_codec_id != SrsCodecVideoAVC && codec->video_codec_id != SrsCodecVideoHEVC) {
+        return ret;
+    }
+    
+    // ignore sequence header
+    if (sample->frame_type == SrsCodecVideoAVCFrameKeyFrame
+         && sample->avc_packet_type == SrsCodecVideoAVCTypeSequenceHeader) {
+        return ret;
+    }
+    
+    if ((ret = t->cache->cache_video(codec, timestamp * 90, sample)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    SrsTsStream stream = (codec->video_codec_id == SrsCodecVideoHEVC)? SrsTsStreamVideoHEVC : SrsTsStreamVideoH264;
+    if ((ret = flush(t, t->cache->video, stream)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    srs_freep(t->cache->video);
+    
+    return ret;
+}
+
+SrsTsTrack* SrsTsMultiEncoder::fetch(int track)
+{
+    if (track < 0 || track >= (int)tracks.size()) {
+        return NULL;
+    }
+    return tracks[track];
+}
+
+int SrsTsMultiEncoder::flush(SrsTsTrack* track, SrsTsMessage* msg, SrsTsStream stream)
+{
+    int ret = ERROR_SUCCESS;
+    
+    // when codec of track changed, update the PMT.
+    if ((ret = context->set_stream(track->program, track->pid, stream)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    return muxer->write_stream(track->pid, msg);
+}
+
 #endif
 
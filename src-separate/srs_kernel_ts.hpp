@@ -35,6 +35,10 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <map>
 #include <vector>
 
+#ifndef _WIN32
+#include <sys/uio.h>
+#endif
+
 #include <srs_kernel_codec.hpp>
 
 class SrsStream;
@@ -53,6 +57,8 @@ class SrsTsContext;
 
 // Transport Stream packets are 188 bytes in length.
 #define SRS_TS_PACKET_SIZE          188
+// the pid is 13bits, so there are 8192 pids at most.
+#define SRS_TS_PIDS                 8192
 
 // the aggregate pure audio for hls, in ts tbn(ms * 90).
 #define SRS_CONSTS_HLS_PURE_AUDIO_AGGREGATE 720 * 90
@@ -161,6 +167,8 @@ enum SrsTsStream
     // ITU-T Rec. H.222.0 | ISO/IEC 13818-1 Reserved
     // 0x15-0x7F
     SrsTsStreamVideoH264       = 0x1b,
+    // ITU-T Rec. H.265 | ISO/IEC 23008-2 video stream
+    SrsTsStreamVideoHEVC       = 0x24,
     // User Private
     // 0x80-0xFF
     SrsTsStreamAudioAC3        = 0x81,
@@ -301,6 +309,11 @@ public:
     * whether the message is fresh.
     */
     virtual bool fresh();
+    /**
+    * reset the message to decode the next PES,
+    * the bytes of payload is cleared but its buffer is reused.
+    */
+    virtual void reset();
 public:
     /**
     * whether the sid indicates the elementary stream audio.
@@ -341,6 +354,50 @@ public:
     virtual int on_ts_message(SrsTsMessage* msg) = 0;
 };
 
+/**
+* the program of ts, the PMT and its elementary streams,
+* the ts of multiple programs is the MPTS.
+* @see SrsTsContext::add_program
+*/
+class SrsTsProgram
+{
+public:
+    // the program_number in PAT, and the pid of PMT.
+    int16_t number;
+    int16_t pmt_pid;
+    // the pid and type of elementary streams, in the order of PMT.
+    std::vector<int16_t> pids;
+    std::vector<SrsTsStream> streams;
+    // the version of PMT, increase when streams changed after written.
+    int8_t version;
+    bool written;
+public:
+    // the PSI and PCR scheduler, in tbn 90000 of the program.
+    int64_t last_psi_dts;
+    int64_t last_pcr_dts;
+    // the last PCR written, and the count of ts packets when written,
+    // to schedule the PCR by packets at the bitrate, -1 when not written.
+    int64_t last_pcr;
+    int64_t last_pcr_packets;
+    // the dts of last message, and the max step of messages, to estimate the next.
+    int64_t last_dts;
+    int64_t max_step;
+public:
+    SrsTsProgram(int16_t n, int16_t pid);
+    virtual ~SrsTsProgram();
+public:
+    /**
+    * find the elementary stream of pid.
+    * @return the index of stream, -1 when not found.
+    */
+    virtual int find(int16_t pid);
+    /**
+    * the pid to carry the PCR, the first video, or the first audio.
+    * @return SrsTsPidNULL when no stream.
+    */
+    virtual int16_t pcr_pid();
+};
+
 /**
 * the context of ts, to decode the ts stream.
 */
@@ -348,13 +405,34 @@ class SrsTsContext
 {
 // codec
 private:
-    std::map<int, SrsTsChannel*> pids;
+    // the channels indexed by pid, SRS_TS_PIDS entries, NULL for unknown pid.
+    SrsTsChannel** pids;
     bool pure_audio;
 // encoder
 private:
     // when any codec changed, write the PAT/PMT.
     SrsCodecVideo vcodec;
     SrsCodecAudio acodec;
+    // the reused headers of ts packets, each in a SRS_TS_PACKET_SIZE slot,
+    // and the iovs of headers and payloads, to write PES packets by one writev.
+    // @see SRS_PERF_TS_WRITEV_PACKETS
+    char* ts_headers;
+    iovec* ts_iovs;
+    // the programs of ts, a program for the audio and video by default.
+    std::vector<SrsTsProgram*> programs;
+    // the version of PAT, increase when programs changed after written.
+    int8_t pat_version;
+    bool pat_written;
+    // when programs or streams changed, write the PAT/PMT.
+    bool psi_changed;
+    // the interval in tbn 90000 to repeat the PAT/PMT, 0 to write when codec changed.
+    int64_t psi_interval;
+    // the interval in tbn 90000 to write the PCR on the PCR pid, 0 to write by message.
+    int64_t pcr_interval;
+    // the bitrate in bps of ts, and the count of ts packets written,
+    // to write the PCR inside the long PES, 0 to schedule by dts only.
+    int64_t bitrate;
+    int64_t nb_ts_packets;
 public:
     SrsTsContext();
     virtual ~SrsTsContext();
@@ -386,23 +464,108 @@ public:
 // decode methods
 public:
     /**
-    * the stream contains only one ts packet.
+    * the stream contains one or more ts packets, for example, 7 packets of udp.
+    * the PES is parsed in place and assembled in the reused message of channel,
+    * the PAT/PMT is decoded by SrsTsPacket.
     * @param handler the ts message handler to process the msg.
     * @remark we will consume all bytes in stream.
+    * @remark the corrupt packet is recoverable, we resync to the next sync byte
+    *       and drop the partial PES util the next payload_unit_start_indicator,
+    *       so only the error of handler is returned.
     */
     virtual int decode(SrsStream* stream, ISrsTsHandler* handler);
+private:
+    /**
+    * decode a ts packet of SRS_TS_PACKET_SIZE bytes.
+    */
+    virtual int decode_packet(char* data, ISrsTsHandler* handler);
+    /**
+    * decode the PES payload of ts packet for the audio or video channel.
+    * @param data the payload of ts packet, after the header and adaptation field.
+    */
+    virtual int decode_pes(SrsTsChannel* channel, int8_t payload_unit_start_indicator,
+        u_int8_t continuity_counter, char* data, int size, ISrsTsHandler* handler);
+    /**
+    * process the completed message by handler, then reset it to reuse.
+    */
+    virtual int reap(SrsTsMessage* msg, ISrsTsHandler* handler);
 // encode methods
 public:
     /**
     * write the PES packet, the video/audio stream.
+    * the ts contains a program of the video and audio stream.
     * @param msg the video/audio msg to write to ts.
     * @param vc the video codec, write the PAT/PMT table when changed.
     * @param ac the audio codec, write the PAT/PMT table when changed.
+    * @remark never use with the add_program and set_stream.
     */
     virtual int encode(SrsFileWriter* writer, SrsTsMessage* msg, SrsCodecVideo vc, SrsCodecAudio ac);
+    /**
+    * add a program to ts, for the ts of multiple programs(MPTS).
+    * @param number the program_number in PAT, 1-65535.
+    * @param pmt_pid the pid of PMT.
+    */
+    virtual int add_program(int number, int pmt_pid);
+    /**
+    * set the elementary stream of program, for instance, the audio tracks
+    * of languages, the PMT is written with new version when changed.
+    * the PCR of program is carried by the first video, or the first audio.
+    * @param stream the type of stream, SrsTsStreamReserved to remove it.
+    */
+    virtual int set_stream(int number, int pid, SrsTsStream stream);
+    /**
+    * write the PES packet to the elementary stream of pid, @see set_stream.
+    * the PAT/PMT is written when changed, or the interval elapsed on the
+    * dts of program, the PCR is written on the PCR pid of program.
+    */
+    virtual int encode_stream(SrsFileWriter* writer, SrsTsMessage* msg, int16_t pid);
+    /**
+    * repeat the PAT/PMT at the interval of dts, for the broadcast muxer
+    * and udp multicast, the receiver can start at any point.
+    * @param psi_ms the interval in ms, 0 to write only when codec changed.
+    */
+    virtual void set_psi_interval(int psi_ms);
+    /**
+    * write the PCR on the PCR pid at the interval of dts, in the first
+    * packet of PES, or an adaptation only packet when the message is of
+    * other pid, for instance, 40ms for DVB.
+    * @param pcr_ms the interval in ms, 0 to write PCR by message, that is,
+    *       the write_pcr of message, or each audio for pure audio.
+    * @remark the PES longer than the interval, @see set_bitrate.
+    */
+    virtual void set_pcr_interval(int pcr_ms);
+    /**
+    * set the bitrate of ts, to schedule the PCR by the count of packets
+    * as well, the PCR is written in the adaptation field of packet inside
+    * the PES which spans the interval, or an adaptation only packet when
+    * the PES is of other pid, the PCR is extrapolated from the last one.
+    * @param bps the bitrate in bps, 0 to schedule by dts only.
+    * @remark ignored when no pcr interval.
+    */
+    virtual void set_bitrate(int64_t bps);
 private:
-    virtual int encode_pat_pmt(SrsFileWriter* writer, int16_t vpid, SrsTsStream vs, int16_t apid, SrsTsStream as);
-    virtual int encode_pes(SrsFileWriter* writer, SrsTsMessage* msg, int16_t pid, SrsTsStream sid, bool pure_audio);
+    virtual SrsTsProgram* fetch_program(int number);
+    /**
+    * write the PAT and the PMT of all programs.
+    */
+    virtual int encode_psi(SrsFileWriter* writer);
+    virtual int encode_psi_packet(SrsFileWriter* writer, SrsTsPacket* pkt);
+    virtual int encode_pes(SrsFileWriter* writer, SrsTsMessage* msg, SrsTsProgram* program, int16_t pid, SrsTsStream sid, bool write_pcr);
+    /**
+    * write an adaptation only packet with the PCR.
+    */
+    virtual int encode_pcr(SrsFileWriter* writer, SrsTsProgram* program, int64_t pcr);
+    /**
+    * whether the PCR of program is due by the packets written at the bitrate.
+    */
+    virtual bool pcr_due(SrsTsProgram* program);
+    /**
+    * the PCR to write, the dts, but never before the last PCR extrapolated
+    * by the packets written at the bitrate.
+    * @param dts the dts of message, -1 for the packet inside the PES.
+    */
+    virtual int64_t pcr_of(SrsTsProgram* program, int64_t dts);
+    virtual void on_pcr(SrsTsProgram* program, int64_t pcr);
 };
 
 /**
@@ -514,12 +677,9 @@ public:
     virtual void padding(int nb_stuffings);
 public:
     static SrsTsPacket* create_pat(SrsTsContext* context, 
-        int16_t pmt_number, int16_t pmt_pid
-    );
-    static SrsTsPacket* create_pmt(SrsTsContext* context, 
-        int16_t pmt_number, int16_t pmt_pid, int16_t vpid, SrsTsStream vs, 
-        int16_t apid, SrsTsStream as
+        std::vector<SrsTsProgram*>& programs, int8_t version
     );
+    static SrsTsPacket* create_pmt(SrsTsContext* context, SrsTsProgram* program);
     static SrsTsPacket* create_pes_first(SrsTsContext* context, 
         int16_t pid, SrsTsPESStreamId sid, u_int8_t continuity_counter, bool discontinuity, 
         int64_t pcr, int64_t dts, int64_t pts, int size
@@ -1579,6 +1739,11 @@ public:
     */
     virtual int update_acodec(SrsCodecAudio ac);
     /**
+    * update the video codec, the PMT is written with the stream type of
+    * the first video frame, for example, h.265 when the stream is hevc.
+    */
+    virtual int update_vcodec(SrsCodecVideo vc);
+    /**
     * write an audio frame to ts, 
     */
     virtual int write_audio(SrsTsMessage* audio);
@@ -1587,9 +1752,15 @@ public:
     */
     virtual int write_video(SrsTsMessage* video);
     /**
-    * close the writer.
+    * write the message to the elementary stream of pid, for the ts of
+    * multiple programs or tracks, @see SrsTsContext::set_stream
+    */
+    virtual int write_stream(int16_t pid, SrsTsMessage* msg);
+    /**
+    * close the writer, flush the buffered ts to file.
+    * @return the error of flush or close, the writer is always closed.
     */
-    virtual void close();
+    virtual int close();
 public:
     /**
      * get the video codec of ts muxer.
@@ -1653,6 +1824,15 @@ public:
      * @param fw the writer to use for ts encoder, user must free it.
      */
     virtual int initialize(SrsFileWriter* fw);
+    /**
+    * repeat the PAT/PMT and write the PCR at the interval of dts,
+    * @see SrsTsContext::set_psi_interval and set_pcr_interval.
+    */
+    virtual void set_interval(int psi_ms, int pcr_ms);
+    /**
+    * @see SrsTsContext::set_bitrate
+    */
+    virtual void set_bitrate(int64_t bps);
 public:
     /**
     * write audio/video packet.
@@ -1665,6 +1845,73 @@ private:
     virtual int flush_video();
 };
 
+/**
+* the track of ts multiple encoder, the audio or video of an input,
+* which is an elementary stream of program.
+*/
+class SrsTsTrack
+{
+public:
+    // the program number, and the pid of elementary stream.
+    int program;
+    int16_t pid;
+    SrsAvcAacCodec* codec;
+    SrsCodecSample* sample;
+    SrsTsCache* cache;
+public:
+    SrsTsTrack(int p, int16_t id);
+    virtual ~SrsTsTrack();
+};
+
+/**
+* encode the data of multiple inputs to one ts, each input is a track,
+* for example, several rtmp streams in the programs of MPTS, or the audio
+* of languages in a program, the PMT pid of program is 0x1000+program.
+*/
+class SrsTsMultiEncoder
+{
+private:
+    SrsFileWriter* writer;
+private:
+    std::vector<SrsTsTrack*> tracks;
+    SrsTSMuxer* muxer;
+    SrsTsContext* context;
+public:
+    SrsTsMultiEncoder();
+    virtual ~SrsTsMultiEncoder();
+public:
+    /**
+     * initialize the underlayer file stream.
+     * @param fw the writer to use for ts encoder, user must free it.
+     */
+    virtual int initialize(SrsFileWriter* fw);
+    /**
+    * @see SrsTsEncoder::set_interval
+    */
+    virtual void set_interval(int psi_ms, int pcr_ms);
+    /**
+    * @see SrsTsContext::set_bitrate
+    */
+    virtual void set_bitrate(int64_t bps);
+    /**
+    * add a track, the elementary stream of pid in program, the program
+    * is added when not exists.
+    * @param program the program number, 1-4094.
+    * @param ptrack output the index of track.
+    */
+    virtual int add_track(int program, int pid, int* ptrack);
+public:
+    /**
+    * write audio/video packet to track.
+    * @remark assert data is not NULL.
+    */
+    virtual int write_audio(int track, int64_t timestamp, char* data, int size);
+    virtual int write_video(int track, int64_t timestamp, char* data, int size);
+private:
+    virtual SrsTsTrack* fetch(int track);
+    virtual int flush(SrsTsTrack* track, SrsTsMessage* msg, SrsTsStream stream);
+};
+
 #endif
 
 #endif
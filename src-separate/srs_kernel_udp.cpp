@@ -0,0 +1,623 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2015 SRS(ossrs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <srs_kernel_udp.hpp>
+
+#if !defined(SRS_EXPORT_LIBRTMP) && !defined(_WIN32)
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+using namespace std;
+
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_utility.hpp>
+
+// the PCR in tbn 90000 jumps over this is discontinuity.
+#define SRS_TS_UDP_PCR_JUMP 90000
+
+/**
+* the time in us of the monotonic clock, to pace the stream.
+*/
+int64_t srs_udp_now_us()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+/**
+* wait the cond for some us at most.
+*/
+void srs_udp_timedwait(pthread_cond_t* cond, pthread_mutex_t* lock, int64_t us)
+{
+    timeval tv;
+    gettimeofday(&tv, NULL);
+    
+    int64_t abstime = tv.tv_sec * 1000000LL + tv.tv_usec + us;
+    
+    timespec ts;
+    ts.tv_sec = (time_t)(abstime / 1000000);
+    ts.tv_nsec = (long)(abstime % 1000000) * 1000;
+    
+    pthread_cond_timedwait(cond, lock, &ts);
+}
+
+SrsTsUdpWriter::SrsTsUdpWriter()
+{
+    fd = -1;
+    memset(&addr, 0, sizeof(addr));
+    ttl = 16;
+    bitrate = 0;
+    position = 0;
+    
+    nb_packet = 0;
+    current = NULL;
+    nb_packets = 0;
+    base_packets = 0;
+    base_time = -1;
+    base_pcr = -1;
+    last_time = -1;
+    last_pcr = -1;
+    pmt_pid = -1;
+    pcr_pid = -1;
+    
+    started = false;
+    quit = false;
+    error = ERROR_SUCCESS;
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&cond, NULL);
+}
+
+SrsTsUdpWriter::~SrsTsUdpWriter()
+{
+    close();
+    
+    if (current) {
+        srs_freep(current);
+    }
+    
+    std::vector<SrsTsDatagram*>::iterator it;
+    for (it = free_datagrams.begin(); it != free_datagrams.end(); ++it) {
+        SrsTsDatagram* dg = *it;
+        srs_freep(dg);
+    }
+    free_datagrams.clear();
+    
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&lock);
+}
+
+int SrsTsUdpWriter::open(string p)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (p.empty()) {
+        p = url;
+    }
+    
+    // the ts muxer reopen the writer for a new ts.
+    if (fd >= 0 && p == url) {
+        return ret;
+    }
+    
+    close();
+    
+    std::string host = p;
+    if (srs_string_starts_with(host, "udp://")) {
+        host = host.substr(6);
+    }
+    
+    size_t pos = host.rfind(":");
+    int port = (pos == std::string::npos)? 0 : ::atoi(host.substr(pos + 1).c_str());
+    std::string ip = (pos == std::string::npos)? "" : srs_dns_resolve(host.substr(0, pos));
+    if (ip.empty() || port <= 0 || port > 65535) {
+        ret = ERROR_SYSTEM_IP_INVALID;
+        srs_error("udp: invalid url %s. ret=%d", p.c_str(), ret);
+        return ret;
+    }
+    
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr(ip.c_str());
+    
+    if ((fd = ::socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
+        ret = ERROR_SOCKET_CREATE;
+        srs_error("udp: create socket failed. ret=%d", ret);
+        return ret;
+    }
+    
+    if (IN_MULTICAST(ntohl(addr.sin_addr.s_addr))) {
+        unsigned char v = (unsigned char)ttl;
+        if (::setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &v, sizeof(v)) < 0) {
+            ret = ERROR_SOCKET_CREATE;
+            srs_error("udp: set multicast ttl %d failed. ret=%d", ttl, ret);
+            ::close(fd);
+            fd = -1;
+            return ret;
+        }
+    }
+    
+    url = p;
+    position = 0;
+    nb_packet = 0;
+    nb_packets = 0;
+    base_packets = 0;
+    base_time = -1;
+    base_pcr = -1;
+    last_time = -1;
+    last_pcr = -1;
+    pmt_pid = -1;
+    pcr_pid = -1;
+    quit = false;
+    error = ERROR_SUCCESS;
+    
+    if (pthread_create(&tid, NULL, worker, this) != 0) {
+        ret = ERROR_SYSTEM_CREATE_THREAD;
+        srs_error("udp: create send thread failed. ret=%d", ret);
+        ::close(fd);
+        fd = -1;
+        return ret;
+    }
+    started = true;
+    
+    srs_trace("udp: open %s, ip=%s, port=%d, bitrate=%"PRId64, p.c_str(), ip.c_str(), port, bitrate);
+    
+    return ret;
+}
+
+int SrsTsUdpWriter::open_append(string p)
+{
+    return open(p);
+}
+
+int SrsTsUdpWriter::close()
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (fd < 0) {
+        return ret;
+    }
+    
+    if ((ret = flush()) != ERROR_SUCCESS) {
+        srs_warn("udp: flush failed. ret=%d", ret);
+    }
+    
+    if (started) {
+        pthread_mutex_lock(&lock);
+        quit = true;
+        pthread_cond_broadcast(&cond);
+        pthread_mutex_unlock(&lock);
+        
+        pthread_join(tid, NULL);
+        started = false;
+    }
+    
+    // the error of datagrams sent after flush.
+    if (ret == ERROR_SUCCESS && error != ERROR_SUCCESS) {
+        ret = error;
+        srs_error("udp: send failed when close. ret=%d", ret);
+    }
+    
+    ::close(fd);
+    fd = -1;
+    
+    return ret;
+}
+
+bool SrsTsUdpWriter::is_open()
+{
+    return fd >= 0;
+}
+
+void SrsTsUdpWriter::lseek(int64_t /*offset*/)
+{
+    // the stream is not seekable.
+}
+
+int64_t SrsTsUdpWriter::tellg()
+{
+    return position;
+}
+
+int SrsTsUdpWriter::write(void* buf, size_t count, ssize_t* pnwrite)
+{
+    iovec iov;
+    iov.iov_base = (char*)buf;
+    iov.iov_len = count;
+    
+    return writev(&iov, 1, pnwrite);
+}
+
+int SrsTsUdpWriter::writev(iovec* iov, int iovcnt, ssize_t* pnwrite)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (fd < 0) {
+        ret = ERROR_SOCKET_CLOSED;
+        srs_error("udp: write to socket not open. ret=%d", ret);
+        return ret;
+    }
+    
+    ssize_t nwrite = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        char* p = (char*)iov[i].iov_base;
+        int left = (int)iov[i].iov_len;
+        nwrite += left;
+        
+        // the ts packet may be written in some iovs, for instance, the header and payload.
+        while (left > 0) {
+            int nb_copy = srs_min(left, SRS_TS_PACKET_SIZE - nb_packet);
+            memcpy(packet + nb_packet, p, nb_copy);
+            nb_packet += nb_copy;
+            p += nb_copy;
+            left -= nb_copy;
+            
+            if (nb_packet == SRS_TS_PACKET_SIZE) {
+                nb_packet = 0;
+                if ((ret = on_packet(packet)) != ERROR_SUCCESS) {
+                    return ret;
+                }
+            }
+        }
+    }
+    position += nwrite;
+    
+    if (pnwrite) {
+        *pnwrite = nwrite;
+    }
+    
+    return ret;
+}
+
+int SrsTsUdpWriter::flush()
+{
+    if (current && current->size > 0) {
+        return submit();
+    }
+    
+    return ERROR_SUCCESS;
+}
+
+void SrsTsUdpWriter::set_ttl(int v)
+{
+    ttl = srs_max(1, srs_min(255, v));
+}
+
+void SrsTsUdpWriter::set_bitrate(int64_t v)
+{
+    bitrate = srs_max(0, v);
+}
+
+int SrsTsUdpWriter::on_packet(char* pkt)
+{
+    int ret = ERROR_SUCCESS;
+    
+    // the stream is delayed from the first packet.
+    if (base_time < 0) {
+        base_time = last_time = srs_udp_now_us() + SRS_PERF_TS_UDP_DELAY * 1000;
+        base_packets = nb_packets;
+    }
+    
+    u_int8_t* p = (u_int8_t*)pkt;
+    int pid = ((p[1] & 0x1f) << 8) | p[2];
+    if (pid == SrsTsPidPAT || pid == pmt_pid) {
+        on_psi(p, pid);
+    }
+    
+    // the adaptation field with PCR, @see SrsTsAdaptationField::decode
+    // ignore the PCR of other programs, or any PCR when no PMT.
+    if ((p[3] & 0x20) == 0 || p[4] < 7 || (p[5] & 0x10) == 0 || (pcr_pid >= 0 && pid != pcr_pid)) {
+        return append(pkt, time_of(nb_packets));
+    }
+    
+    int64_t pcr = ((int64_t)p[6] << 25) | ((int64_t)p[7] << 17) | ((int64_t)p[8] << 9) | ((int64_t)p[9] << 1) | (p[10] >> 7);
+    
+    // continue the pacing from current packet.
+    if (base_pcr < 0 || pcr < last_pcr || pcr - last_pcr > SRS_TS_UDP_PCR_JUMP) {
+        if (base_pcr >= 0) {
+            srs_warn("udp: ts PCR discontinuity %"PRId64"=>%"PRId64, last_pcr, pcr);
+        }
+        rebase(time_of(nb_packets), pcr);
+    }
+    last_pcr = pcr;
+    
+    // stuff the null packets, to send the PCR packet at its position of bitrate.
+    if (bitrate > 0) {
+        int64_t target = base_packets + (pcr - base_pcr) * bitrate / (90000LL * SRS_TS_PACKET_SIZE * 8);
+        if (target < nb_packets) {
+            srs_warn("udp: ts exceed bitrate %"PRId64", %d packets", bitrate, (int)(nb_packets - target));
+            rebase(time_of(nb_packets), pcr);
+        }
+        
+        if (nb_packets < target) {
+            char null_pkt[SRS_TS_PACKET_SIZE];
+            null_pkt[0] = 0x47;
+            null_pkt[1] = 0x1f;
+            null_pkt[2] = (char)0xff;
+            null_pkt[3] = 0x10;
+            memset(null_pkt + 4, 0xff, SRS_TS_PACKET_SIZE - 4);
+            
+            while (nb_packets < target) {
+                if ((ret = append(null_pkt, time_of(nb_packets))) != ERROR_SUCCESS) {
+                    return ret;
+                }
+            }
+        }
+    }
+    
+    int64_t deadline = time_of(nb_packets);
+    if (bitrate <= 0) {
+        deadline = base_time + (pcr - base_pcr) * 100 / 9;
+    }
+    
+    // the source is late over the delay, restart the delay.
+    int64_t now = srs_udp_now_us();
+    if (deadline < now) {
+        srs_warn("udp: ts late %d ms, pcr=%"PRId64, (int)((now - deadline) / 1000), pcr);
+        deadline = now + SRS_PERF_TS_UDP_DELAY * 1000;
+        rebase(deadline, pcr);
+    }
+    last_time = deadline;
+    
+    return append(pkt, deadline);
+}
+
+void SrsTsUdpWriter::on_psi(u_int8_t* p, int pid)
+{
+    // the section starts in the packet, without adaptation field.
+    if ((p[1] & 0x40) == 0 || (p[3] & 0x30) != 0x10 || p[4] > SRS_TS_PACKET_SIZE - 5 - 12) {
+        return;
+    }
+    
+    u_int8_t* section = p + 5 + p[4];
+    int section_length = ((section[1] & 0x0f) << 8) | section[2];
+    u_int8_t* end = srs_min(section + 3 + section_length - 4, p + SRS_TS_PACKET_SIZE);
+    
+    if (pid != SrsTsPidPAT) {
+        pcr_pid = ((section[8] & 0x1f) << 8) | section[9];
+        return;
+    }
+    
+    // the first program, ignore the network pid of program 0.
+    for (u_int8_t* q = section + 8; q + 4 <= end; q += 4) {
+        int number = (q[0] << 8) | q[1];
+        if (number != 0) {
+            pmt_pid = ((q[2] & 0x1f) << 8) | q[3];
+            break;
+        }
+    }
+}
+
+int SrsTsUdpWriter::append(char* pkt, int64_t deadline)
+{
+    if (!current) {
+        pthread_mutex_lock(&lock);
+        if (!free_datagrams.empty()) {
+            current = free_datagrams.back();
+            free_datagrams.pop_back();
+        }
+        pthread_mutex_unlock(&lock);
+    }
+    if (!current) {
+        current = new SrsTsDatagram();
+        current->size = 0;
+    }
+    
+    memcpy(current->data + current->size, pkt, SRS_TS_PACKET_SIZE);
+    current->size += SRS_TS_PACKET_SIZE;
+    current->deadline = deadline;
+    nb_packets++;
+    
+    if (current->size == (int)sizeof(current->data)) {
+        return submit();
+    }
+    
+    return ERROR_SUCCESS;
+}
+
+int64_t SrsTsUdpWriter::time_of(int64_t n)
+{
+    // the packets between PCRs are sent with the last PCR.
+    if (bitrate <= 0) {
+        return last_time;
+    }
+    
+    double us = (double)(n - base_packets) * SRS_TS_PACKET_SIZE * 8 * 1000000 / bitrate;
+    return base_time + (int64_t)us;
+}
+
+void SrsTsUdpWriter::rebase(int64_t time, int64_t pcr)
+{
+    base_time = last_time = time;
+    base_packets = nb_packets;
+    base_pcr = pcr;
+}
+
+int SrsTsUdpWriter::submit()
+{
+    int ret = ERROR_SUCCESS;
+    
+    pthread_mutex_lock(&lock);
+    
+    // backpressure, for the source is faster than realtime.
+    while (error == ERROR_SUCCESS && (int)datagrams.size() >= SRS_PERF_TS_UDP_INFLIGHT) {
+        pthread_cond_wait(&cond, &lock);
+    }
+    
+    if ((ret = error) == ERROR_SUCCESS) {
+        datagrams.push_back(current);
+        current = NULL;
+        pthread_cond_broadcast(&cond);
+    }
+    
+    pthread_mutex_unlock(&lock);
+    
+    if (ret != ERROR_SUCCESS) {
+        srs_error("udp: send failed. ret=%d", ret);
+    }
+    
+    return ret;
+}
+
+void* SrsTsUdpWriter::worker(void* arg)
+{
+    SrsTsUdpWriter* writer = (SrsTsUdpWriter*)arg;
+    writer->cycle();
+    return NULL;
+}
+
+void SrsTsUdpWriter::cycle()
+{
+    SrsTsDatagram* dgs[SRS_PERF_TS_UDP_BATCH];
+    
+    pthread_mutex_lock(&lock);
+    
+    for (;;) {
+        if (datagrams.empty()) {
+            if (quit) {
+                break;
+            }
+            pthread_cond_wait(&cond, &lock);
+            continue;
+        }
+        
+        // drop the datagrams when send failed.
+        bool failed = error != ERROR_SUCCESS;
+        
+        int64_t now = srs_udp_now_us();
+        int64_t wait = datagrams.front()->deadline - now;
+        if (!failed && wait > 0) {
+            srs_udp_timedwait(&cond, &lock, wait);
+            continue;
+        }
+        
+        int nb_dgs = 0;
+        while (nb_dgs < SRS_PERF_TS_UDP_BATCH && !datagrams.empty()
+            && (failed || datagrams.front()->deadline <= now)
+        ) {
+            dgs[nb_dgs++] = datagrams.front();
+            datagrams.pop_front();
+        }
+        
+        pthread_mutex_unlock(&lock);
+        
+        int ret = ERROR_SUCCESS;
+        if (!failed) {
+            ret = send(dgs, nb_dgs);
+        }
+        
+        pthread_mutex_lock(&lock);
+        
+        if (ret != ERROR_SUCCESS) {
+            error = ret;
+        }
+        
+        for (int i = 0; i < nb_dgs; i++) {
+            dgs[i]->size = 0;
+            free_datagrams.push_back(dgs[i]);
+        }
+        
+        pthread_cond_broadcast(&cond);
+    }
+    
+    pthread_mutex_unlock(&lock);
+}
+
+int SrsTsUdpWriter::send(SrsTsDatagram** dgs, int nb_dgs)
+{
+    int ret = ERROR_SUCCESS;
+    
+#ifdef __linux__
+    mmsghdr msgs[SRS_PERF_TS_UDP_BATCH];
+    iovec iovs[SRS_PERF_TS_UDP_BATCH];
+    memset(msgs, 0, sizeof(mmsghdr) * nb_dgs);
+    
+    for (int i = 0; i < nb_dgs; i++) {
+        iovs[i].iov_base = dgs[i]->data;
+        iovs[i].iov_len = dgs[i]->size;
+        msgs[i].msg_hdr.msg_name = &addr;
+        msgs[i].msg_hdr.msg_namelen = sizeof(addr);
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    
+    int nb_sent = 0;
+    int err = 0;
+    while (nb_sent < nb_dgs) {
+        int r0 = ::sendmmsg(fd, msgs + nb_sent, nb_dgs - nb_sent, 0);
+        if (r0 < 0 && errno == EINTR) {
+            continue;
+        }
+        if (r0 < 0) {
+            err = errno;
+            break;
+        }
+        // no datagram sent without error, the errno is stale, drop the left.
+        if (r0 == 0) {
+            srs_warn("udp: drop %d datagrams, none sent", nb_dgs - nb_sent);
+            return ret;
+        }
+        nb_sent += r0;
+    }
+#else
+    int nb_sent = 0;
+    int err = 0;
+    while (nb_sent < nb_dgs) {
+        ssize_t r0 = ::sendto(fd, dgs[nb_sent]->data, dgs[nb_sent]->size, 0, (sockaddr*)&addr, sizeof(addr));
+        if (r0 < 0 && errno == EINTR) {
+            continue;
+        }
+        if (r0 < 0) {
+            err = errno;
+            break;
+        }
+        nb_sent++;
+    }
+#endif
+    
+    if (nb_sent == nb_dgs) {
+        return ret;
+    }
+    
+    // the udp is lossy, drop the datagrams when no buffer or no peer.
+    if (err == EAGAIN || err == ENOBUFS || err == ECONNREFUSED) {
+        srs_warn("udp: drop %d datagrams, errno=%d", nb_dgs - nb_sent, err);
+        return ret;
+    }
+    
+    ret = ERROR_SOCKET_WRITE;
+    srs_error("udp: send datagrams failed, errno=%d. ret=%d", err, ret);
+    
+    return ret;
+}
+
+#endif
+
@@ -0,0 +1,181 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2015 SRS(ossrs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef SRS_KERNEL_UDP_HPP
+#define SRS_KERNEL_UDP_HPP
+
+/*
+#include <srs_kernel_udp.hpp>
+*/
+#include <srs_core.hpp>
+
+#if !defined(SRS_EXPORT_LIBRTMP) && !defined(_WIN32)
+
+#include <string>
+#include <deque>
+#include <vector>
+
+#include <pthread.h>
+#include <netinet/in.h>
+
+#include <srs_kernel_file.hpp>
+#include <srs_kernel_ts.hpp>
+#include <srs_core_performance.hpp>
+
+/**
+* the datagram of udp ts writer, some ts packets.
+*/
+struct SrsTsDatagram
+{
+    char data[SRS_PERF_TS_UDP_PACKETS * SRS_TS_PACKET_SIZE];
+    int size;
+    // the time in us to send, of the monotonic clock.
+    int64_t deadline;
+};
+
+/**
+* the udp sink of ts muxer, to send the ts to udp unicast or multicast,
+* for example, udp://239.1.1.1:1234, for the broadcast playout.
+* the ts packets are sent in datagrams of 7 packets by a send thread,
+* the datagrams due are sent by one sendmmsg.
+* 
+* the stream is paced by the PCR: 
+*       when no bitrate, each PCR packet is sent at the time of PCR,
+*       and the packets between two PCRs are sent in burst.
+*       when bitrate set, the stream is in constant bitrate, the null
+*       packets are stuffed before each PCR packet to its position at the
+*       bitrate, and all packets are sent at its position.
+* for multiple programs, the stream is paced by the PCR of first program.
+* the stream is delayed SRS_PERF_TS_UDP_DELAY, so the stuffing and the
+* jitter of source are absorbed, and the write blocks when the inflight
+* datagrams exceed SRS_PERF_TS_UDP_INFLIGHT, for instance, the source
+* is faster than realtime.
+* @remark the muxer should write PCR at a fixed interval, for instance,
+*       SrsTsContext::set_pcr_interval(40).
+*/
+class SrsTsUdpWriter : public SrsFileWriter
+{
+private:
+    std::string url;
+    int fd;
+    sockaddr_in addr;
+    int ttl;
+    int64_t bitrate;
+    int64_t position;
+private:
+    // the partial ts packet of writes.
+    char packet[SRS_TS_PACKET_SIZE];
+    int nb_packet;
+    // the datagram to fill the packets.
+    SrsTsDatagram* current;
+    // the count of packets, including the stuffing packets.
+    int64_t nb_packets;
+    // the pacing base, the packet at time in us with the PCR in tbn 90000.
+    int64_t base_packets;
+    int64_t base_time;
+    int64_t base_pcr;
+    // the time in us of last packet.
+    int64_t last_time;
+    int64_t last_pcr;
+    // the PMT and PCR pid of the first program, to pace by its PCR.
+    int pmt_pid;
+    int pcr_pid;
+private:
+    // the inflight datagrams, protected by the lock.
+    std::deque<SrsTsDatagram*> datagrams;
+    std::vector<SrsTsDatagram*> free_datagrams;
+    // the send thread quit when all datagrams sent.
+    bool started;
+    bool quit;
+    // the error of send thread, return by the next write.
+    int error;
+    pthread_t tid;
+    pthread_mutex_t lock;
+    // signaled when datagram queued or sent.
+    pthread_cond_t cond;
+public:
+    SrsTsUdpWriter();
+    virtual ~SrsTsUdpWriter();
+public:
+    /**
+    * open the udp socket and start the send thread.
+    * @param p the url, udp://host:port, or host:port, an empty url to
+    *       reuse the url of writer, for the ts muxer reopen it.
+    */
+    virtual int open(std::string p);
+    virtual int open_append(std::string p);
+    /**
+    * send the datagrams queued, then close the socket.
+    * @return the error of send thread.
+    */
+    virtual int close();
+public:
+    virtual bool is_open();
+    virtual void lseek(int64_t offset);
+    virtual int64_t tellg();
+public:
+    virtual int write(void* buf, size_t count, ssize_t* pnwrite);
+    virtual int writev(iovec* iov, int iovcnt, ssize_t* pnwrite);
+    /**
+    * queue the partial datagram.
+    */
+    virtual int flush();
+public:
+    /**
+    * set the ttl of multicast, apply at the next open.
+    */
+    virtual void set_ttl(int v);
+    /**
+    * set the constant bitrate in bps, 0 to pace by PCR only.
+    * @remark apply at the next open.
+    */
+    virtual void set_bitrate(int64_t v);
+private:
+    /**
+    * pace and queue the ts packet, stuff the null packets before PCR.
+    */
+    virtual int on_packet(char* pkt);
+    /**
+    * parse the PAT and PMT, for the PCR pid of the first program.
+    */
+    virtual void on_psi(u_int8_t* pkt, int pid);
+    virtual int append(char* pkt, int64_t deadline);
+    /**
+    * the time in us to send the packet at, by the pacing base.
+    */
+    virtual int64_t time_of(int64_t n);
+    virtual void rebase(int64_t time, int64_t pcr);
+    /**
+    * queue the current datagram, wait when exceed the inflight.
+    */
+    virtual int submit();
+private:
+    static void* worker(void* arg);
+    virtual void cycle();
+    virtual int send(SrsTsDatagram** dgs, int nb_dgs);
+};
+
+#endif
+
+#endif
+
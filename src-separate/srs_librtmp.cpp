@@ -24,14 +24,17 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <srs_librtmp.hpp>
 
 #include <stdlib.h>
+#include <stdio.h>
 
 // for srs-librtmp, @see https://github.com/ossrs/srs/issues/213
 #ifndef _WIN32
 #include <sys/time.h>
+#include <time.h>
 #endif
 
 #include <string>
 #include <sstream>
+#include <vector>
 using namespace std;
 
 #include <srs_kernel_error.hpp>
@@ -46,6 +49,11 @@ using namespace std;
 #include <srs_kernel_flv.hpp>
 #include <srs_kernel_codec.hpp>
 #include <srs_kernel_file.hpp>
+#include <srs_kernel_buffer.hpp>
+#include <srs_kernel_ts.hpp>
+#include <srs_kernel_hls.hpp>
+#include <srs_kernel_mp4.hpp>
+#include <srs_kernel_udp.hpp>
 #include <srs_lib_bandwidth.hpp>
 #include <srs_raw_avc.hpp>
 
@@ -53,6 +61,54 @@ using namespace std;
 ISrsLog* _srs_log = new ISrsLog();
 ISrsThreadContext* _srs_context = new ISrsThreadContext();
 
+struct Context;
+
+/**
+* the ingester of ts, demux the h.264 and aac from ts,
+* then publish them over RTMP.
+* @see srs_rtmp_write_ts
+*/
+class TsIngester : public ISrsTsHandler
+{
+private:
+    Context* context;
+    SrsTsContext ts;
+    // the partial ts packet at the end of last write,
+    // completed by the next write.
+    char left[SRS_TS_PACKET_SIZE];
+    int nb_left;
+    // the pid of the published video and audio, -1 when not found,
+    // only the first h.264 and aac stream is published.
+    int vpid;
+    int apid;
+    // the last timestamp in 90khz, the raw 33bits one and the unwrapped one,
+    // -1 when not initialized.
+    int64_t last_raw;
+    int64_t last_ts;
+    // the NALUs of video in the PES payload, reused for each PES.
+    vector<char*> nalus;
+    vector<int> nb_nalus;
+public:
+    TsIngester(Context* c);
+    virtual ~TsIngester();
+public:
+    /**
+    * write the ts bytes, the whole ts packets are decoded in place,
+    * the partial ts packet is left for the next write.
+    */
+    virtual int write(char* data, int size);
+// interface ISrsTsHandler
+public:
+    virtual int on_ts_message(SrsTsMessage* msg);
+private:
+    virtual int on_ts_video(SrsTsMessage* msg);
+    virtual int on_ts_audio(SrsTsMessage* msg);
+    /**
+    * unwrap the 33bits timestamp in 90khz, which wraps about 26.5h.
+    */
+    virtual int64_t unwrap(int64_t v);
+};
+
 /**
 * export runtime context.
 */
@@ -71,11 +127,29 @@ struct Context
     // extra request object for connect to server, NULL to ignore.
     SrsRequest* req;
     
-    // the message received cache,
-    // for example, when got aggregate message,
-    // the context will parse to videos/audios,
-    // and return one by one.
-    std::vector<SrsCommonMessage*> msgs;
+    // the aggregate message received,
+    // the context will parse to videos/audios from its payload,
+    // and return one by one, NULL when no aggregate to expand.
+    SrsCommonMessage* aggregate;
+    // the read position of aggregate payload.
+    SrsStream aggregate_stream;
+    // the aggregate message always use abs time, the delta to adjust,
+    // -1 when not initialized.
+    int aggregate_delta;
+    // the payload lent to user by srs_rtmp_read_packet2,
+    // which is free when read again, NULL when not lent.
+    char* lent_payload;
+    
+    // the aggregate message to publish, pack the audio/video tags to it,
+    // @see srs_rtmp_set_aggregate
+    // the max size and duration in ms of aggregate, 0 to disable.
+    int out_aggregate_max_size;
+    int out_aggregate_max_duration;
+    // the payload of aggregate, NULL when sent, alloc when pack tag.
+    char* out_aggregate;
+    // the size of packed tags, and the timestamp of first tag.
+    int out_aggregate_size;
+    u_int32_t out_aggregate_timestamp;
     
     SrsRtmpClient* rtmp;
     SimpleSocketStream* skt;
@@ -83,6 +157,7 @@ struct Context
     
     // the remux raw codec.
     SrsRawH264Stream avc_raw;
+    SrsRawHEVCStream hevc_raw;
     SrsRawAacStream aac_raw;
 
     // for h264 raw stream, 
@@ -98,32 +173,68 @@ struct Context
     // @see https://github.com/ossrs/srs/issues/204
     bool h264_sps_changed;
     bool h264_pps_changed;
+    // for h265 raw stream, the annexb is demuxed by h264_raw_stream.
+    // about VPS/SPS/PPS, @see: 7.3.2, H.265-HEVC-ITU-T-REC-H.265-201304.pdf, page 32
+    std::string h265_vps;
+    std::string h265_sps;
+    std::string h265_pps;
+    // whether the vps, sps and pps sent.
+    bool h265_vps_sps_pps_sent;
+    // send the vps, sps and pps when any changed.
+    bool h265_vps_sps_pps_changed;
     // for aac raw stream,
     // @see: https://github.com/ossrs/srs/issues/212#issuecomment-64146250
     SrsStream aac_raw_stream;
     // the aac sequence header.
     std::string aac_specific_config;
+    // the ingester of ts, NULL when not write ts.
+    // @see srs_rtmp_write_ts
+    TsIngester* ts_ingester;
+    
+    // the startup timing of session, the monotonic time in ms
+    // when each stage done, 0 when not done yet.
+    // @see srs_utils_startup_timing
+    int64_t stime_start;
+    int64_t stime_dns;
+    int64_t stime_connect;
+    int64_t stime_handshake;
+    int64_t stime_connect_app;
+    int64_t stime_create_stream;
+    int64_t stime_play_publish;
+    int64_t stime_first_audio;
+    int64_t stime_first_video;
+    int64_t stime_first_keyframe;
     
     Context() {
         rtmp = NULL;
         skt = NULL;
         req = NULL;
+        aggregate = NULL;
+        aggregate_delta = -1;
+        lent_payload = NULL;
+        out_aggregate_max_size = out_aggregate_max_duration = 0;
+        out_aggregate = NULL;
+        out_aggregate_size = 0;
+        out_aggregate_timestamp = 0;
         stream_id = 0;
         h264_sps_pps_sent = false;
         h264_sps_changed = false;
         h264_pps_changed = false;
+        h265_vps_sps_pps_sent = false;
+        h265_vps_sps_pps_changed = false;
+        ts_ingester = NULL;
+        stime_start = stime_dns = stime_connect = stime_handshake = 0;
+        stime_connect_app = stime_create_stream = stime_play_publish = 0;
+        stime_first_audio = stime_first_video = stime_first_keyframe = 0;
     }
     virtual ~Context() {
         srs_freep(req);
         srs_freep(rtmp);
         srs_freep(skt);
-        
-        std::vector<SrsCommonMessage*>::iterator it;
-        for (it = msgs.begin(); it != msgs.end(); ++it) {
-            SrsCommonMessage* msg = *it;
-            srs_freep(msg);
-        }
-        msgs.clear();
+        srs_freep(aggregate);
+        srs_freepa(lent_payload);
+        srs_freepa(out_aggregate);
+        srs_freep(ts_ingester);
     }
 };
 
@@ -459,6 +570,40 @@ struct Context
     }
 #endif
 
+/**
+* get the monotonic time in ms for the startup timing,
+* which never jump when the system time changed.
+*/
+int64_t srs_librtmp_monotonic_time_ms()
+{
+#ifdef _WIN32
+    return (int64_t)GetTickCount64();
+#else
+    timespec now;
+    if (clock_gettime(CLOCK_MONOTONIC, &now) < 0) {
+        return srs_update_system_time_ms();
+    }
+    return ((int64_t)now.tv_sec) * 1000 + (int64_t)now.tv_nsec / 1000 / 1000;
+#endif
+}
+
+/**
+* mark the startup stage done, only the first time is recorded.
+*/
+void srs_librtmp_context_stage_done(Context* context, int64_t& stime)
+{
+    if (stime > 0) {
+        return;
+    }
+    
+    stime = srs_librtmp_monotonic_time_ms();
+    
+    // the session starts when the first stage starts.
+    if (context->stime_start <= 0) {
+        context->stime_start = stime;
+    }
+}
+
 int srs_librtmp_context_parse_uri(Context* context) 
 {
     int ret = ERROR_SUCCESS;
@@ -563,6 +708,13 @@ void srs_rtmp_destroy(srs_rtmp_t rtmp)
     
     Context* context = (Context*)rtmp;
     
+    // best effort to send the packed packets, ignore the error for closing.
+    int ret = ERROR_SUCCESS;
+    int size = context->out_aggregate_size;
+    if (size > 0 && (ret = srs_rtmp_flush_aggregate(rtmp)) != ERROR_SUCCESS) {
+        srs_warn("flush aggregate %dB when destroy failed. ret=%d", size, ret);
+    }
+    
     srs_freep(context);
 }
 
@@ -592,6 +744,9 @@ int srs_rtmp_dns_resolve(srs_rtmp_t rtmp)
     srs_assert(rtmp != NULL);
     Context* context = (Context*)rtmp;
     
+    // the session starts from dns resolve.
+    srs_librtmp_context_stage_done(context, context->stime_start);
+    
     // parse uri
     if ((ret = srs_librtmp_context_parse_uri(context)) != ERROR_SUCCESS) {
         return ret;
@@ -600,6 +755,7 @@ int srs_rtmp_dns_resolve(srs_rtmp_t rtmp)
     if ((ret = srs_librtmp_context_resolve_host(context)) != ERROR_SUCCESS) {
         return ret;
     }
+    srs_librtmp_context_stage_done(context, context->stime_dns);
     
     return ret;
 }
@@ -614,6 +770,7 @@ int srs_rtmp_connect_server(srs_rtmp_t rtmp)
     if ((ret = srs_librtmp_context_connect(context)) != ERROR_SUCCESS) {
         return ret;
     }
+    srs_librtmp_context_stage_done(context, context->stime_connect);
     
     return ret;
 }
@@ -639,6 +796,7 @@ int srs_rtmp_do_complex_handshake(srs_rtmp_t rtmp)
     if ((ret = context->rtmp->complex_handshake()) != ERROR_SUCCESS) {
         return ret;
     }
+    srs_librtmp_context_stage_done(context, context->stime_handshake);
     
     return ret;
 }
@@ -686,6 +844,7 @@ int srs_rtmp_do_simple_handshake(srs_rtmp_t rtmp)
     if ((ret = context->rtmp->simple_handshake()) != ERROR_SUCCESS) {
         return ret;
     }
+    srs_librtmp_context_stage_done(context, context->stime_handshake);
     
     return ret;
 }
@@ -707,6 +866,7 @@ int srs_rtmp_connect_app(srs_rtmp_t rtmp)
     {
         return ret;
     }
+    srs_librtmp_context_stage_done(context, context->stime_connect_app);
     
     return ret;
 }
@@ -740,6 +900,7 @@ int srs_rtmp_connect_app2(srs_rtmp_t rtmp,
         sip, sserver, sprimary, sauthors, sversion, *srs_id, *srs_pid)) != ERROR_SUCCESS) {
         return ret;
     }
+    srs_librtmp_context_stage_done(context, context->stime_connect_app);
     
     snprintf(srs_server_ip, 128, "%s", sip.c_str());
     snprintf(srs_server, 128, "%s", sserver.c_str());
@@ -760,9 +921,12 @@ int srs_rtmp_play_stream(srs_rtmp_t rtmp)
     if ((ret = context->rtmp->create_stream(context->stream_id)) != ERROR_SUCCESS) {
         return ret;
     }
+    srs_librtmp_context_stage_done(context, context->stime_create_stream);
+    
     if ((ret = context->rtmp->play(context->stream, context->stream_id)) != ERROR_SUCCESS) {
         return ret;
     }
+    srs_librtmp_context_stage_done(context, context->stime_play_publish);
     
     return ret;
 }
@@ -777,10 +941,60 @@ int srs_rtmp_publish_stream(srs_rtmp_t rtmp)
     if ((ret = context->rtmp->fmle_publish(context->stream, context->stream_id)) != ERROR_SUCCESS) {
         return ret;
     }
+    srs_librtmp_context_stage_done(context, context->stime_play_publish);
+    
+    return ret;
+}
+
+int srs_rtmp_pipeline_play_stream(srs_rtmp_t rtmp)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(rtmp != NULL);
+    Context* context = (Context*)rtmp;
+    
+    string tcUrl = srs_generate_tc_url(
+        context->ip, context->vhost, context->app, context->port,
+        context->param
+    );
+    
+    if ((ret = context->rtmp->pipeline_play(context->app, tcUrl, context->req, true,
+        context->stream, context->stream_id)) != ERROR_SUCCESS) 
+    {
+        return ret;
+    }
+    srs_librtmp_context_stage_done(context, context->stime_play_publish);
+    
+    return ret;
+}
+
+int srs_rtmp_pipeline_publish_stream(srs_rtmp_t rtmp)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(rtmp != NULL);
+    Context* context = (Context*)rtmp;
+    
+    string tcUrl = srs_generate_tc_url(
+        context->ip, context->vhost, context->app, context->port,
+        context->param
+    );
+    
+    if ((ret = context->rtmp->pipeline_publish(context->app, tcUrl, context->req, true,
+        context->stream, context->stream_id)) != ERROR_SUCCESS) 
+    {
+        return ret;
+    }
+    srs_librtmp_context_stage_done(context, context->stime_play_publish);
     
     return ret;
 }
 
+srs_bool srs_rtmp_is_pipeline_stream_error(int error_code)
+{
+    return error_code == ERROR_RTMP_PIPELINE_STREAM_ID;
+}
+
 int srs_rtmp_bandwidth_check(srs_rtmp_t rtmp, 
     int64_t* start_time, int64_t* end_time, 
     int* play_kbps, int* publish_kbps,
@@ -822,103 +1036,123 @@ int srs_rtmp_on_aggregate(Context* context, SrsCommonMessage* msg)
 {
     int ret = ERROR_SUCCESS;
     
-    SrsStream aggregate_stream;
-    SrsStream* stream = &aggregate_stream;
-    if ((ret = stream->initialize(msg->payload, msg->size)) != ERROR_SUCCESS) {
+    // detach bytes from packet, the sub messages are views of it.
+    SrsCommonMessage* aggregate = new SrsCommonMessage();
+    aggregate->header = msg->header;
+    aggregate->payload = msg->payload;
+    aggregate->size = msg->size;
+    msg->payload = NULL;
+    
+    srs_freep(context->aggregate);
+    context->aggregate = aggregate;
+    context->aggregate_delta = -1;
+    
+    if ((ret = context->aggregate_stream.initialize(aggregate->payload, aggregate->size)) != ERROR_SUCCESS) {
+        srs_freep(context->aggregate);
         return ret;
     }
     
-    // the aggregate message always use abs time.
-    int delta = -1;
-    
-    while (!stream->empty()) {
-        if (!stream->require(1)) {
-            ret = ERROR_RTMP_AGGREGATE;
-            srs_error("invalid aggregate message type. ret=%d", ret);
-            return ret;
-        }
-        int8_t type = stream->read_1bytes();
-        
-        if (!stream->require(3)) {
-            ret = ERROR_RTMP_AGGREGATE;
-            srs_error("invalid aggregate message size. ret=%d", ret);
-            return ret;
-        }
-        int32_t data_size = stream->read_3bytes();
-        
-        if (data_size < 0) {
-            ret = ERROR_RTMP_AGGREGATE;
-            srs_error("invalid aggregate message size(negative). ret=%d", ret);
-            return ret;
-        }
-        
-        if (!stream->require(3)) {
-            ret = ERROR_RTMP_AGGREGATE;
-            srs_error("invalid aggregate message time. ret=%d", ret);
-            return ret;
-        }
-        int32_t timestamp = stream->read_3bytes();
-        
-        if (!stream->require(1)) {
-            ret = ERROR_RTMP_AGGREGATE;
-            srs_error("invalid aggregate message time(high). ret=%d", ret);
-            return ret;
-        }
-        int32_t time_h = stream->read_1bytes();
-        
-        timestamp |= time_h<<24;
-        timestamp &= 0x7FFFFFFF;
-        
-        // adjust abs timestamp in aggregate msg.
-        if (delta < 0) {
-            delta = (int)msg->header.timestamp - (int)timestamp;
-        }
-        timestamp += delta;
-        
-        if (!stream->require(3)) {
-            ret = ERROR_RTMP_AGGREGATE;
-            srs_error("invalid aggregate message stream_id. ret=%d", ret);
-            return ret;
-        }
-        int32_t stream_id = stream->read_3bytes();
-        
-        if (data_size > 0 && !stream->require(data_size)) {
-            ret = ERROR_RTMP_AGGREGATE;
-            srs_error("invalid aggregate message data. ret=%d", ret);
-            return ret;
-        }
-        
-        // to common message.
-        SrsCommonMessage o;
-        
-        o.header.message_type = type;
-        o.header.payload_length = data_size;
-        o.header.timestamp_delta = timestamp;
-        o.header.timestamp = timestamp;
-        o.header.stream_id = stream_id;
-        o.header.perfer_cid = msg->header.perfer_cid;
-
-        if (data_size > 0) {
-            o.size = data_size;
-            o.payload = new char[o.size];
-            stream->read_bytes(o.payload, o.size);
-        }
-        
-        if (!stream->require(4)) {
-            ret = ERROR_RTMP_AGGREGATE;
-            srs_error("invalid aggregate message previous tag size. ret=%d", ret);
-            return ret;
-        }
-        stream->read_4bytes();
+    return ret;
+}
 
-        // process parsed message
-        SrsCommonMessage* parsed_msg = new SrsCommonMessage();
-        parsed_msg->header = o.header;
-        parsed_msg->payload = o.payload;
-        parsed_msg->size = o.size;
-        o.payload = NULL;
-        context->msgs.push_back(parsed_msg);
+/**
+* parse the next sub message of aggregate message,
+* the payload of sub message is a view of the aggregate payload,
+* which is valid until the aggregate message is free.
+* @param got_msg, false when the aggregate is expanded.
+*/
+int srs_rtmp_aggregate_next(Context* context, 
+    char* type, u_int32_t* timestamp, char** data, int* size,
+    bool* got_msg
+) {
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(context->aggregate);
+    SrsCommonMessage* msg = context->aggregate;
+    SrsStream* stream = &context->aggregate_stream;
+    
+    *got_msg = false;
+    if (stream->empty()) {
+        return ret;
+    }
+    
+    if (!stream->require(1)) {
+        ret = ERROR_RTMP_AGGREGATE;
+        srs_error("invalid aggregate message type. ret=%d", ret);
+        return ret;
+    }
+    int8_t sub_type = stream->read_1bytes();
+    
+    if (!stream->require(3)) {
+        ret = ERROR_RTMP_AGGREGATE;
+        srs_error("invalid aggregate message size. ret=%d", ret);
+        return ret;
+    }
+    int32_t data_size = stream->read_3bytes();
+    
+    if (data_size < 0) {
+        ret = ERROR_RTMP_AGGREGATE;
+        srs_error("invalid aggregate message size(negative). ret=%d", ret);
+        return ret;
+    }
+    
+    if (!stream->require(3)) {
+        ret = ERROR_RTMP_AGGREGATE;
+        srs_error("invalid aggregate message time. ret=%d", ret);
+        return ret;
     }
+    int32_t sub_timestamp = stream->read_3bytes();
+    
+    if (!stream->require(1)) {
+        ret = ERROR_RTMP_AGGREGATE;
+        srs_error("invalid aggregate message time(high). ret=%d", ret);
+        return ret;
+    }
+    int32_t time_h = stream->read_1bytes();
+    
+    sub_timestamp |= time_h<<24;
+    sub_timestamp &= 0x7FFFFFFF;
+    
+    // adjust abs timestamp in aggregate msg.
+    if (context->aggregate_delta < 0) {
+        context->aggregate_delta = (int)msg->header.timestamp - (int)sub_timestamp;
+    }
+    sub_timestamp += context->aggregate_delta;
+    
+    // the stream id of sub message is ignored.
+    if (!stream->require(3)) {
+        ret = ERROR_RTMP_AGGREGATE;
+        srs_error("invalid aggregate message stream_id. ret=%d", ret);
+        return ret;
+    }
+    stream->skip(3);
+    
+    if (data_size > 0 && !stream->require(data_size)) {
+        ret = ERROR_RTMP_AGGREGATE;
+        srs_error("invalid aggregate message data. ret=%d", ret);
+        return ret;
+    }
+    
+    // the view of sub message payload,
+    // map the type and timestamp like srs_rtmp_go_packet.
+    *type = sub_type;
+    if (sub_type == RTMP_MSG_AudioMessage || sub_type == RTMP_MSG_VideoMessage) {
+        *timestamp = (u_int32_t)sub_timestamp;
+    } else if (sub_type == RTMP_MSG_AMF0DataMessage || sub_type == RTMP_MSG_AMF3DataMessage) {
+        *type = SRS_RTMP_TYPE_SCRIPT;
+    }
+    *data = (data_size > 0)? stream->data() + stream->pos() : NULL;
+    *size = data_size;
+    stream->skip(data_size);
+    
+    if (!stream->require(4)) {
+        ret = ERROR_RTMP_AGGREGATE;
+        srs_error("invalid aggregate message previous tag size. ret=%d", ret);
+        return ret;
+    }
+    stream->read_4bytes();
+    
+    *got_msg = true;
     
     return ret;
 }
@@ -968,30 +1202,53 @@ int srs_rtmp_go_packet(Context* context, SrsCommonMessage* msg,
     return ret;
 }
 
-int srs_rtmp_read_packet(srs_rtmp_t rtmp, char* type, u_int32_t* timestamp, char** data, int* size)
-{
-    *type = 0;
-    *timestamp = 0;
-    *data = NULL;
-    *size = 0;
-    
+/**
+* read a packet from the aggregate message or protocol.
+* @param copy, whether copy the payload of aggregate sub message,
+*       when false, the payload is a view of aggregate message.
+* @param lent, output whether the data is a view, user should not free it.
+*/
+int srs_librtmp_context_read(Context* context, bool copy, 
+    char* type, u_int32_t* timestamp, char** data, int* size,
+    bool* lent
+) {
     int ret = ERROR_SUCCESS;
     
-    srs_assert(rtmp != NULL);
-    Context* context = (Context*)rtmp;
+    *lent = false;
     
     for (;;) {
-        SrsCommonMessage* msg = NULL;
-        
-        // read from cache first.
-        if (!context->msgs.empty()) {
-            std::vector<SrsCommonMessage*>::iterator it = context->msgs.begin();
-            msg = *it;
-            context->msgs.erase(it);
+        // expand the aggregate message first.
+        if (context->aggregate) {
+            bool got_msg = false;
+            if ((ret = srs_rtmp_aggregate_next(context, type, timestamp, data, size, &got_msg)) != ERROR_SUCCESS) {
+                srs_freep(context->aggregate);
+                return ret;
+            }
+            
+            // the aggregate is expanded, read from protocol sdk.
+            if (!got_msg) {
+                srs_freep(context->aggregate);
+                continue;
+            }
+            
+            // the empty sub message has no payload to copy or lend.
+            if (*size <= 0) {
+                break;
+            }
+            
+            if (copy) {
+                char* payload = new char[*size];
+                memcpy(payload, *data, *size);
+                *data = payload;
+            } else {
+                *lent = true;
+            }
+            break;
         }
         
         // read from protocol sdk.
-        if (!msg && (ret = context->rtmp->recv_message(&msg)) != ERROR_SUCCESS) {
+        SrsCommonMessage* msg = NULL;
+        if ((ret = context->rtmp->recv_message(&msg)) != ERROR_SUCCESS) {
             return ret;
         }
         
@@ -1014,90 +1271,295 @@ int srs_rtmp_read_packet(srs_rtmp_t rtmp, char* type, u_int32_t* timestamp, char
         }
     }
     
+    // the first audio, video and keyframe for startup timing.
+    if (*type == SRS_RTMP_TYPE_AUDIO) {
+        srs_librtmp_context_stage_done(context, context->stime_first_audio);
+    } else if (*type == SRS_RTMP_TYPE_VIDEO) {
+        srs_librtmp_context_stage_done(context, context->stime_first_video);
+        
+        // ignore the sequence header, which is not a frame.
+        if (srs_utils_flv_video_frame_type(*data, *size) == 1
+            && srs_utils_flv_video_avc_packet_type(*data, *size) != 0
+        ) {
+            srs_librtmp_context_stage_done(context, context->stime_first_keyframe);
+        }
+    }
+    
     return ret;
 }
 
-int srs_rtmp_write_packet(srs_rtmp_t rtmp, char type, u_int32_t timestamp, char* data, int size)
+int srs_rtmp_read_packet(srs_rtmp_t rtmp, char* type, u_int32_t* timestamp, char** data, int* size)
 {
+    *type = 0;
+    *timestamp = 0;
+    *data = NULL;
+    *size = 0;
+    
     int ret = ERROR_SUCCESS;
     
     srs_assert(rtmp != NULL);
     Context* context = (Context*)rtmp;
     
-    SrsSharedPtrMessage* msg = NULL;
-
-    if ((ret = srs_rtmp_create_msg(type, timestamp, data, size, context->stream_id, &msg)) != ERROR_SUCCESS) {
-        return ret;
-    }
-
-    srs_assert(msg);
-
-    // send out encoded msg.
-    if ((ret = context->rtmp->send_and_free_message(msg, context->stream_id)) != ERROR_SUCCESS) {
+    bool lent = false;
+    if ((ret = srs_librtmp_context_read(context, true, type, timestamp, data, size, &lent)) != ERROR_SUCCESS) {
         return ret;
     }
+    srs_assert(!lent);
     
     return ret;
 }
 
-srs_bool srs_rtmp_is_onMetaData(char type, char* data, int size)
+int srs_rtmp_read_packet2(srs_rtmp_t rtmp, char* type, u_int32_t* timestamp, char** data, int* size)
 {
-    int ret = ERROR_SUCCESS;
+    *type = 0;
+    *timestamp = 0;
+    *data = NULL;
+    *size = 0;
     
-    if (type != SRS_RTMP_TYPE_SCRIPT) {
-        return false;
-    }
+    int ret = ERROR_SUCCESS;
     
-    SrsStream stream;
-    if ((ret = stream.initialize(data, size)) != ERROR_SUCCESS) {
-        return false;
-    }
+    srs_assert(rtmp != NULL);
+    Context* context = (Context*)rtmp;
     
-    std::string name;
-    if ((ret = srs_amf0_read_string(&stream, name)) != ERROR_SUCCESS) {
-        return false;
-    }
+    // the data lent to user is invalid now.
+    srs_freepa(context->lent_payload);
     
-    if (name == SRS_CONSTS_RTMP_ON_METADATA) {
-        return true;
+    bool lent = false;
+    if ((ret = srs_librtmp_context_read(context, false, type, timestamp, data, size, &lent)) != ERROR_SUCCESS) {
+        return ret;
     }
     
-    if (name == SRS_CONSTS_RTMP_SET_DATAFRAME) {
-        return true;
+    // the view of aggregate is free with the aggregate,
+    // others are detached from message, free when read again.
+    if (!lent) {
+        context->lent_payload = *data;
     }
     
-    return false;
+    return ret;
 }
 
 /**
-* directly write a audio frame.
+* send the packed tags in aggregate message.
 */
-int srs_write_audio_raw_frame(Context* context,
-    char* frame, int frame_size, SrsRawAacStreamCodec* codec, u_int32_t timestamp
-) {
+int srs_librtmp_context_flush_aggregate(Context* context)
+{
     int ret = ERROR_SUCCESS;
-
-    char* data = NULL;
-    int size = 0;
-    if ((ret = context->aac_raw.mux_aac2flv(frame, frame_size, codec, timestamp, &data, &size)) != ERROR_SUCCESS) {
+    
+    if (context->out_aggregate_size <= 0) {
         return ret;
     }
     
-    return srs_rtmp_write_packet(context, SRS_RTMP_TYPE_AUDIO, timestamp, data, size);
+    SrsMessageHeader header;
+    header.message_type = RTMP_MSG_AggregateMessage;
+    header.payload_length = context->out_aggregate_size;
+    header.timestamp = context->out_aggregate_timestamp;
+    header.stream_id = context->stream_id;
+    header.perfer_cid = RTMP_CID_Video;
+    
+    // the message takes the payload, alloc another when pack tag.
+    SrsSharedPtrMessage* msg = new SrsSharedPtrMessage();
+    if ((ret = msg->create(&header, context->out_aggregate, context->out_aggregate_size)) != ERROR_SUCCESS) {
+        srs_freep(msg);
+        return ret;
+    }
+    context->out_aggregate = NULL;
+    context->out_aggregate_size = 0;
+    
+    if ((ret = context->rtmp->send_and_free_message(msg, context->stream_id)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    return ret;
 }
 
 /**
-* write aac frame in adts.
+* pack the audio/video tag to aggregate message,
+* send the aggregate when this tag reaches the size or duration.
+* @remark the data is always free.
 */
-int srs_write_aac_adts_frame(Context* context, 
-    SrsRawAacStreamCodec* codec, char* frame, int frame_size, u_int32_t timestamp
-) {
+int srs_librtmp_context_aggregate(Context* context, char type, u_int32_t timestamp, char* data, int size)
+{
     int ret = ERROR_SUCCESS;
     
-    // send out aac sequence header if not sent.
-    if (context->aac_specific_config.empty()) {
-        std::string sh;
-        if ((ret = context->aac_raw.mux_sequence_header(codec, sh)) != ERROR_SUCCESS) {
+    int tag_size = SRS_FLV_TAG_HEADER_SIZE + size + SRS_FLV_PREVIOUS_TAG_SIZE;
+    
+    // send the aggregate when full, or the timestamp jump back.
+    if (context->out_aggregate_size > 0) {
+        if (context->out_aggregate_size + tag_size > context->out_aggregate_max_size
+            || timestamp < context->out_aggregate_timestamp
+            || timestamp - context->out_aggregate_timestamp >= (u_int32_t)context->out_aggregate_max_duration
+        ) {
+            if ((ret = srs_librtmp_context_flush_aggregate(context)) != ERROR_SUCCESS) {
+                srs_freepa(data);
+                return ret;
+            }
+        }
+    }
+    
+    // the large tag, send it directly.
+    if (tag_size > context->out_aggregate_max_size) {
+        SrsSharedPtrMessage* msg = NULL;
+        if ((ret = srs_rtmp_create_msg(type, timestamp, data, size, context->stream_id, &msg)) != ERROR_SUCCESS) {
+            return ret;
+        }
+        return context->rtmp->send_and_free_message(msg, context->stream_id);
+    }
+    
+    SrsAutoFreeA(char, data);
+    
+    if (!context->out_aggregate) {
+        context->out_aggregate = new char[context->out_aggregate_max_size];
+    }
+    if (context->out_aggregate_size <= 0) {
+        context->out_aggregate_timestamp = timestamp;
+    }
+    
+    SrsStream stream;
+    if ((ret = stream.initialize(context->out_aggregate + context->out_aggregate_size, tag_size)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // the tag header, the stream id is always 0.
+    stream.write_1bytes(type);
+    stream.write_3bytes(size);
+    stream.write_3bytes((int32_t)(timestamp & 0xFFFFFF));
+    stream.write_1bytes((int8_t)((timestamp >> 24) & 0x7F));
+    stream.write_3bytes(0);
+    stream.write_bytes(data, size);
+    stream.write_4bytes(SRS_FLV_TAG_HEADER_SIZE + size);
+    
+    context->out_aggregate_size += tag_size;
+    
+    // send the aggregate when this tag reaches the duration,
+    // or no space for another tag, never wait for the next packet.
+    if (timestamp - context->out_aggregate_timestamp >= (u_int32_t)context->out_aggregate_max_duration
+        || context->out_aggregate_size + SRS_FLV_TAG_HEADER_SIZE + SRS_FLV_PREVIOUS_TAG_SIZE >= context->out_aggregate_max_size
+    ) {
+        return srs_librtmp_context_flush_aggregate(context);
+    }
+    
+    return ret;
+}
+
+int srs_rtmp_write_packet(srs_rtmp_t rtmp, char type, u_int32_t timestamp, char* data, int size)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(rtmp != NULL);
+    Context* context = (Context*)rtmp;
+    
+    // pack the audio/video to aggregate message when enabled.
+    if (context->out_aggregate_max_size > 0 && (type == SRS_RTMP_TYPE_AUDIO || type == SRS_RTMP_TYPE_VIDEO)) {
+        return srs_librtmp_context_aggregate(context, type, timestamp, data, size);
+    }
+    
+    // send the packed tags first, to keep the order.
+    if ((ret = srs_librtmp_context_flush_aggregate(context)) != ERROR_SUCCESS) {
+        srs_freepa(data);
+        return ret;
+    }
+    
+    SrsSharedPtrMessage* msg = NULL;
+
+    if ((ret = srs_rtmp_create_msg(type, timestamp, data, size, context->stream_id, &msg)) != ERROR_SUCCESS) {
+        return ret;
+    }
+
+    srs_assert(msg);
+
+    // send out encoded msg.
+    if ((ret = context->rtmp->send_and_free_message(msg, context->stream_id)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    return ret;
+}
+
+int srs_rtmp_set_aggregate(srs_rtmp_t rtmp, int max_size, int max_duration)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(rtmp != NULL);
+    Context* context = (Context*)rtmp;
+    
+    // send the packed tags, for the buffer maybe smaller.
+    if ((ret = srs_librtmp_context_flush_aggregate(context)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    srs_freepa(context->out_aggregate);
+    
+    context->out_aggregate_max_size = srs_max(0, max_size);
+    context->out_aggregate_max_duration = srs_max(0, max_duration);
+    
+    return ret;
+}
+
+int srs_rtmp_flush_aggregate(srs_rtmp_t rtmp)
+{
+    srs_assert(rtmp != NULL);
+    Context* context = (Context*)rtmp;
+    
+    return srs_librtmp_context_flush_aggregate(context);
+}
+
+srs_bool srs_rtmp_is_onMetaData(char type, char* data, int size)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (type != SRS_RTMP_TYPE_SCRIPT) {
+        return false;
+    }
+    
+    SrsStream stream;
+    if ((ret = stream.initialize(data, size)) != ERROR_SUCCESS) {
+        return false;
+    }
+    
+    std::string name;
+    if ((ret = srs_amf0_read_string(&stream, name)) != ERROR_SUCCESS) {
+        return false;
+    }
+    
+    if (name == SRS_CONSTS_RTMP_ON_METADATA) {
+        return true;
+    }
+    
+    if (name == SRS_CONSTS_RTMP_SET_DATAFRAME) {
+        return true;
+    }
+    
+    return false;
+}
+
+/**
+* directly write a audio frame.
+*/
+int srs_write_audio_raw_frame(Context* context,
+    char* frame, int frame_size, SrsRawAacStreamCodec* codec, u_int32_t timestamp
+) {
+    int ret = ERROR_SUCCESS;
+
+    char* data = NULL;
+    int size = 0;
+    if ((ret = context->aac_raw.mux_aac2flv(frame, frame_size, codec, timestamp, &data, &size)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    return srs_rtmp_write_packet(context, SRS_RTMP_TYPE_AUDIO, timestamp, data, size);
+}
+
+/**
+* write aac frame in adts.
+*/
+int srs_write_aac_adts_frame(Context* context, 
+    SrsRawAacStreamCodec* codec, char* frame, int frame_size, u_int32_t timestamp
+) {
+    int ret = ERROR_SUCCESS;
+    
+    // send out aac sequence header if not sent.
+    if (context->aac_specific_config.empty()) {
+        std::string sh;
+        if ((ret = context->aac_raw.mux_sequence_header(codec, sh)) != ERROR_SUCCESS) {
             return ret;
         }
         context->aac_specific_config = sh;
@@ -1406,220 +1868,1597 @@ int srs_h264_write_raw_frames(srs_rtmp_t rtmp,
             ) {
                 continue;
             }
-            
-            return ret;
+            
+            return ret;
+        }
+    }
+    
+    return error_code_return;
+}
+
+srs_bool srs_h264_is_dvbsp_error(int error_code)
+{
+    return error_code == ERROR_H264_DROP_BEFORE_SPS_PPS;
+}
+
+srs_bool srs_h264_is_duplicated_sps_error(int error_code)
+{
+    return error_code == ERROR_H264_DUPLICATED_SPS;
+}
+
+srs_bool srs_h264_is_duplicated_pps_error(int error_code)
+{
+    return error_code == ERROR_H264_DUPLICATED_PPS;
+}
+
+srs_bool srs_h264_startswith_annexb(char* h264_raw_data, int h264_raw_size, int* pnb_start_code)
+{
+    SrsStream stream;
+    if (stream.initialize(h264_raw_data, h264_raw_size) != ERROR_SUCCESS) {
+        return false;
+    }
+    
+    return srs_avc_startswith_annexb(&stream, pnb_start_code);
+}
+
+/**
+* write h265 IPB-frame.
+*/
+int srs_write_h265_ipb_frame(Context* context, 
+    char* frame, int frame_size, u_int32_t dts, u_int32_t pts
+) {
+    int ret = ERROR_SUCCESS;
+    
+    // when vps, sps or pps not sent, ignore the packet.
+    if (!context->h265_vps_sps_pps_sent) {
+        return ERROR_HEVC_DROP_BEFORE_VPS_SPS_PPS;
+    }
+    
+    // 6bits, 7.3.1.2 NAL unit header syntax,
+    // H.265-HEVC-ITU-T-REC-H.265-201304.pdf, page 31.
+    SrsHevcNaluType nal_unit_type = (SrsHevcNaluType)((frame[0] >> 1) & 0x3f);
+    
+    // for IRAP frame, the frame is keyframe.
+    SrsCodecVideoAVCFrame frame_type = SrsCodecVideoAVCFrameInterFrame;
+    if (nal_unit_type >= SrsHevcNaluTypeCodedSliceBLA && nal_unit_type <= SrsHevcNaluTypeReservedIRAP23) {
+        frame_type = SrsCodecVideoAVCFrameKeyFrame;
+    }
+    
+    // the NALU with 4bytes size, the same as h264.
+    std::string ibp;
+    if ((ret = context->avc_raw.mux_ipb_frame(frame, frame_size, ibp)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    int8_t packet_type = SrsCodecVideoExPacketTypeCodedFrames;
+    char* flv = NULL;
+    int nb_flv = 0;
+    if ((ret = context->hevc_raw.mux_hevc2flv(ibp, frame_type, packet_type, dts, pts, &flv, &nb_flv)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // the timestamp in rtmp message header is dts.
+    u_int32_t timestamp = dts;
+    return srs_rtmp_write_packet(context, SRS_RTMP_TYPE_VIDEO, timestamp, flv, nb_flv);
+}
+
+/**
+* write the h265 vps/sps/pps in context over RTMP.
+*/
+int srs_write_h265_vps_sps_pps(Context* context, u_int32_t dts, u_int32_t pts)
+{
+    int ret = ERROR_SUCCESS;
+    
+    // send when any changed, and all of them are got.
+    if (!context->h265_vps_sps_pps_changed) {
+        return ret;
+    }
+    if (context->h265_vps.empty() || context->h265_sps.empty() || context->h265_pps.empty()) {
+        return ret;
+    }
+    
+    // h265 raw to HEVCDecoderConfigurationRecord.
+    std::string sh;
+    if ((ret = context->hevc_raw.mux_sequence_header(context->h265_vps, context->h265_sps, context->h265_pps, sh)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // h265 packet to flv packet.
+    int8_t frame_type = SrsCodecVideoAVCFrameKeyFrame;
+    int8_t packet_type = SrsCodecVideoExPacketTypeSequenceStart;
+    char* flv = NULL;
+    int nb_flv = 0;
+    if ((ret = context->hevc_raw.mux_hevc2flv(sh, frame_type, packet_type, dts, pts, &flv, &nb_flv)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // reset vps, sps and pps.
+    context->h265_vps_sps_pps_changed = false;
+    context->h265_vps_sps_pps_sent = true;
+    
+    // the timestamp in rtmp message header is dts.
+    u_int32_t timestamp = dts;
+    return srs_rtmp_write_packet(context, SRS_RTMP_TYPE_VIDEO, timestamp, flv, nb_flv);
+}
+
+/**
+* write h265 raw frame, maybe vps/sps/pps/IPB-frame.
+*/
+int srs_write_h265_raw_frame(Context* context, 
+    char* frame, int frame_size, u_int32_t dts, u_int32_t pts
+) {
+    int ret = ERROR_SUCCESS;
+    
+    // for vps, sps and pps, ignore the duplicated.
+    std::string* pset = NULL;
+    int error_duplicated = ERROR_SUCCESS;
+    if (context->hevc_raw.is_vps(frame, frame_size)) {
+        pset = &context->h265_vps;
+        error_duplicated = ERROR_HEVC_DUPLICATED_VPS;
+    } else if (context->hevc_raw.is_sps(frame, frame_size)) {
+        pset = &context->h265_sps;
+        error_duplicated = ERROR_HEVC_DUPLICATED_SPS;
+    } else if (context->hevc_raw.is_pps(frame, frame_size)) {
+        pset = &context->h265_pps;
+        error_duplicated = ERROR_HEVC_DUPLICATED_PPS;
+    }
+    
+    if (pset) {
+        std::string nalu(frame, frame_size);
+        if (*pset == nalu) {
+            return error_duplicated;
+        }
+        context->h265_vps_sps_pps_changed = true;
+        *pset = nalu;
+        
+        return ret;
+    }
+    
+    // send vps+sps+pps before ipb frames when changed.
+    if ((ret = srs_write_h265_vps_sps_pps(context, dts, pts)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // ibp frame.
+    return srs_write_h265_ipb_frame(context, frame, frame_size, dts, pts);
+}
+
+/**
+* write h265 multiple frames, in annexb format.
+*/
+int srs_h265_write_raw_frames(srs_rtmp_t rtmp, 
+    char* frames, int frames_size, u_int32_t dts, u_int32_t pts
+) {
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(frames != NULL);
+    srs_assert(frames_size > 0);
+    
+    srs_assert(rtmp != NULL);
+    Context* context = (Context*)rtmp;
+    
+    if ((ret = context->h264_raw_stream.initialize(frames, frames_size)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // use the last error, the same as h264.
+    int error_code_return = ret;
+    
+    // send each frame.
+    while (!context->h264_raw_stream.empty()) {
+        char* frame = NULL;
+        int frame_size = 0;
+        if ((ret = context->avc_raw.annexb_demux(&context->h264_raw_stream, &frame, &frame_size)) != ERROR_SUCCESS) {
+            return ret;
+        }
+        
+        // ignore invalid frame,
+        // atleast 1bytes for the nalu type.
+        if (frame_size <= 0) {
+            continue;
+        }
+        
+        // it may be return error, but we must process all packets.
+        if ((ret = srs_write_h265_raw_frame(context, frame, frame_size, dts, pts)) != ERROR_SUCCESS) {
+            error_code_return = ret;
+            
+            // ignore known error, process all packets.
+            if (srs_h265_is_dvbsp_error(ret)
+                || srs_h265_is_duplicated_vps_error(ret)
+                || srs_h265_is_duplicated_sps_error(ret)
+                || srs_h265_is_duplicated_pps_error(ret)
+            ) {
+                continue;
+            }
+            
+            return ret;
+        }
+    }
+    
+    return error_code_return;
+}
+
+srs_bool srs_h265_is_dvbsp_error(int error_code)
+{
+    return error_code == ERROR_HEVC_DROP_BEFORE_VPS_SPS_PPS;
+}
+
+srs_bool srs_h265_is_duplicated_vps_error(int error_code)
+{
+    return error_code == ERROR_HEVC_DUPLICATED_VPS;
+}
+
+srs_bool srs_h265_is_duplicated_sps_error(int error_code)
+{
+    return error_code == ERROR_HEVC_DUPLICATED_SPS;
+}
+
+srs_bool srs_h265_is_duplicated_pps_error(int error_code)
+{
+    return error_code == ERROR_HEVC_DUPLICATED_PPS;
+}
+
+/**
+* the delta of 33bits timestamps in 90khz, a - b, which may wrap.
+*/
+int64_t srs_ts_delta(int64_t a, int64_t b)
+{
+    int64_t delta = (a - b) & 0x1ffffffffLL;
+    if (delta >= 0x100000000LL) {
+        delta -= 0x200000000LL;
+    }
+    return delta;
+}
+
+TsIngester::TsIngester(Context* c)
+{
+    context = c;
+    nb_left = 0;
+    vpid = apid = -1;
+    last_raw = last_ts = -1;
+}
+
+TsIngester::~TsIngester()
+{
+}
+
+/**
+* whether the error of ts ingest is fatal, the system and RTMP protocol
+* error in [1000, 3000), for example, write to socket failed; otherwise,
+* the codec error of corrupt ts, which is recoverable by drop the frame.
+*/
+bool srs_ts_is_fatal_error(int error_code)
+{
+    return error_code != ERROR_SUCCESS && error_code < ERROR_HLS_METADATA;
+}
+
+int TsIngester::write(char* data, int size)
+{
+    int ret = ERROR_SUCCESS;
+    
+    // drop the partial ts packet of last write, when the data starts a packet
+    // which not follows it, for example, the udp datagram is truncated.
+    if (nb_left > 0 && (u_int8_t)data[0] == 0x47
+        && size > SRS_TS_PACKET_SIZE - nb_left && (u_int8_t)data[SRS_TS_PACKET_SIZE - nb_left] != 0x47
+    ) {
+        srs_warn("ts: drop the partial packet %dB", nb_left);
+        nb_left = 0;
+    }
+    
+    // complete the partial ts packet of last write.
+    if (nb_left > 0) {
+        int nb_bytes = srs_min(size, SRS_TS_PACKET_SIZE - nb_left);
+        memcpy(left + nb_left, data, nb_bytes);
+        nb_left += nb_bytes;
+        data += nb_bytes;
+        size -= nb_bytes;
+        
+        if (nb_left < SRS_TS_PACKET_SIZE) {
+            return ret;
+        }
+        nb_left = 0;
+        
+        SrsStream stream;
+        if ((ret = stream.initialize(left, SRS_TS_PACKET_SIZE)) != ERROR_SUCCESS) {
+            return ret;
+        }
+        if ((ret = ts.decode(&stream, this)) != ERROR_SUCCESS) {
+            return ret;
+        }
+    }
+    
+    // resync to the sync byte, to keep the packets aligned with the next write.
+    int nb_skip = 0;
+    while (nb_skip < size && (u_int8_t)data[nb_skip] != 0x47) {
+        nb_skip++;
+    }
+    if (nb_skip > 0) {
+        srs_warn("ts: skip %dB to resync the sync byte", nb_skip);
+        data += nb_skip;
+        size -= nb_skip;
+    }
+    
+    // decode the whole ts packets in place, left the partial one.
+    int nb_packets = size - size % SRS_TS_PACKET_SIZE;
+    if (nb_packets > 0) {
+        SrsStream stream;
+        if ((ret = stream.initialize(data, nb_packets)) != ERROR_SUCCESS) {
+            return ret;
+        }
+        if ((ret = ts.decode(&stream, this)) != ERROR_SUCCESS) {
+            return ret;
+        }
+    }
+    
+    nb_left = size - nb_packets;
+    if (nb_left > 0) {
+        memcpy(left, data + nb_packets, nb_left);
+    }
+    
+    return ret;
+}
+
+int TsIngester::on_ts_message(SrsTsMessage* msg)
+{
+    int ret = ERROR_SUCCESS;
+    
+    SrsTsChannel* channel = msg->channel;
+    srs_assert(channel);
+    
+    // for the MPTS or multiple languages, publish the first stream, ignore others.
+    if (channel->stream == SrsTsStreamVideoH264 || channel->stream == SrsTsStreamVideoHEVC) {
+        if (vpid == -1) {
+            vpid = channel->pid;
+            srs_trace("ts: ingest video pid=%#x", vpid);
+        }
+        if (vpid == channel->pid) {
+            ret = on_ts_video(msg);
+        }
+    } else if (channel->stream == SrsTsStreamAudioAAC) {
+        if (apid == -1) {
+            apid = channel->pid;
+            srs_trace("ts: ingest audio pid=%#x", apid);
+        }
+        if (apid == channel->pid) {
+            ret = on_ts_audio(msg);
+        }
+    } else {
+        srs_info("ts: ignore pid=%#x, stream=%#x, size=%d",
+            channel->pid, channel->stream, msg->payload->length());
+    }
+    
+    // drop the frames of corrupt PES, only the system and RTMP error is fatal.
+    if (ret != ERROR_SUCCESS && !srs_ts_is_fatal_error(ret)) {
+        srs_warn("ts: drop PES pid=%#x, dts=%"PRId64", size=%d. ret=%d",
+            channel->pid, msg->dts, msg->payload->length(), ret);
+        return ERROR_SUCCESS;
+    }
+    
+    return ret;
+}
+
+int TsIngester::on_ts_video(SrsTsMessage* msg)
+{
+    int ret = ERROR_SUCCESS;
+    
+    // the timestamp of RTMP in ms, the tbn of ts is 90khz.
+    int64_t v = unwrap(msg->dts);
+    u_int32_t dts = (u_int32_t)(v / 90);
+    u_int32_t pts = (u_int32_t)((v + srs_ts_delta(msg->pts, msg->dts)) / 90);
+    
+    SrsStream* stream = &context->h264_raw_stream;
+    if ((ret = stream->initialize(msg->payload->bytes(), msg->payload->length())) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // demux the annexb NALUs in place, all slices of PES is a RTMP packet.
+    nalus.clear();
+    nb_nalus.clear();
+    
+    bool is_hevc = msg->channel->stream == SrsTsStreamVideoHEVC;
+    bool keyframe = false;
+    int nb_video = 0;
+    while (!stream->empty()) {
+        char* frame = NULL;
+        int frame_size = 0;
+        if ((ret = context->avc_raw.annexb_demux(stream, &frame, &frame_size)) != ERROR_SUCCESS) {
+            return ret;
+        }
+        
+        if (frame_size <= 0) {
+            continue;
+        }
+        
+        // for hevc, the AUD is ignored, the vps/sps/pps is sent in sequence header.
+        if (is_hevc) {
+            SrsHevcNaluType hevc_nalu_type = (SrsHevcNaluType)((frame[0] >> 1) & 0x3f);
+            if (hevc_nalu_type == SrsHevcNaluTypeAccessUnitDelimiter) {
+                continue;
+            }
+            
+            if (hevc_nalu_type >= SrsHevcNaluTypeVPS && hevc_nalu_type <= SrsHevcNaluTypePPS) {
+                if ((ret = srs_write_h265_raw_frame(context, frame, frame_size, dts, pts)) != ERROR_SUCCESS) {
+                    if (!srs_h265_is_duplicated_vps_error(ret) && !srs_h265_is_duplicated_sps_error(ret)
+                        && !srs_h265_is_duplicated_pps_error(ret)
+                    ) {
+                        return ret;
+                    }
+                }
+                continue;
+            }
+            
+            if (hevc_nalu_type >= SrsHevcNaluTypeCodedSliceBLA && hevc_nalu_type <= SrsHevcNaluTypeReservedIRAP23) {
+                keyframe = true;
+            }
+            
+            nalus.push_back(frame);
+            nb_nalus.push_back(frame_size);
+            nb_video += 4 + frame_size;
+            continue;
+        }
+        
+        SrsAvcNaluType nal_unit_type = (SrsAvcNaluType)(frame[0] & 0x1f);
+        
+        // the AUD is useless for RTMP.
+        if (nal_unit_type == SrsAvcNaluTypeAccessUnitDelimiter) {
+            continue;
+        }
+        
+        // the sps/pps is sent in sequence header when changed.
+        if (nal_unit_type == SrsAvcNaluTypeSPS || nal_unit_type == SrsAvcNaluTypePPS) {
+            if ((ret = srs_write_h264_raw_frame(context, frame, frame_size, dts, pts)) != ERROR_SUCCESS) {
+                if (!srs_h264_is_duplicated_sps_error(ret) && !srs_h264_is_duplicated_pps_error(ret)) {
+                    return ret;
+                }
+            }
+            continue;
+        }
+        
+        if (nal_unit_type == SrsAvcNaluTypeIDR) {
+            keyframe = true;
+        }
+        
+        nalus.push_back(frame);
+        nb_nalus.push_back(frame_size);
+        nb_video += 4 + frame_size;
+    }
+    
+    if (nalus.empty()) {
+        return ERROR_SUCCESS;
+    }
+    
+    // send the sequence header when sps/pps changed.
+    if (is_hevc) {
+        ret = srs_write_h265_vps_sps_pps(context, dts, pts);
+    } else {
+        ret = srs_write_h264_sps_pps(context, dts, pts);
+    }
+    if (ret != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // the ts may start at any frame, drop the video before sps/pps.
+    if (is_hevc? !context->h265_vps_sps_pps_sent : !context->h264_sps_pps_sent) {
+        srs_info("ts: drop video before sps/pps, dts=%u", dts);
+        return ret;
+    }
+    
+    // mux the NALUs to the flv video tag directly, each prefixed by 4bytes size.
+    // @see: E.4.3 Video Tags, video_file_format_spec_v10_1.pdf, page 78
+    // for hevc, the enhanced RTMP header with the FourCC is 3bytes more.
+    int size = (is_hevc? 8 : 5) + nb_video;
+    char* data = new char[size];
+    
+    SrsStream tag;
+    if ((ret = tag.initialize(data, size)) != ERROR_SUCCESS) {
+        srs_freepa(data);
+        return ret;
+    }
+    
+    SrsCodecVideoAVCFrame frame_type = keyframe? SrsCodecVideoAVCFrameKeyFrame : SrsCodecVideoAVCFrameInterFrame;
+    if (is_hevc) {
+        tag.write_1bytes(SRS_FLV_VIDEO_EX_HEADER | (frame_type << 4) | SrsCodecVideoExPacketTypeCodedFrames);
+        tag.write_4bytes(SRS_FLV_VIDEO_FOURCC_HEVC);
+    } else {
+        tag.write_1bytes((frame_type << 4) | SrsCodecVideoAVC);
+        tag.write_1bytes(SrsCodecVideoAVCTypeNALU);
+    }
+    tag.write_3bytes(pts - dts);
+    
+    for (int i = 0; i < (int)nalus.size(); i++) {
+        tag.write_4bytes(nb_nalus[i]);
+        tag.write_bytes(nalus[i], nb_nalus[i]);
+    }
+    
+    return srs_rtmp_write_packet(context, SRS_RTMP_TYPE_VIDEO, dts, data, size);
+}
+
+int TsIngester::on_ts_audio(SrsTsMessage* msg)
+{
+    int ret = ERROR_SUCCESS;
+    
+    int64_t dts = unwrap(msg->dts);
+    
+    SrsStream* stream = &context->aac_raw_stream;
+    if ((ret = stream->initialize(msg->payload->bytes(), msg->payload->length())) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // the PES may contains several ADTS frames, each frame is 1024 samples.
+    for (int i = 0; !stream->empty(); i++) {
+        char* frame = NULL;
+        int frame_size = 0;
+        SrsRawAacStreamCodec codec;
+        if ((ret = context->aac_raw.adts_demux(stream, &frame, &frame_size, codec)) != ERROR_SUCCESS) {
+            return ret;
+        }
+        
+        int64_t v = dts;
+        int sample_rate = aac_sample_rates[codec.sampling_frequency_index & 0x0f];
+        if (sample_rate > 0) {
+            v += (int64_t)i * 1024 * 90000 / sample_rate;
+        }
+        
+        if ((ret = srs_write_aac_adts_frame(context, &codec, frame, frame_size, (u_int32_t)(v / 90))) != ERROR_SUCCESS) {
+            return ret;
+        }
+    }
+    
+    return ret;
+}
+
+int64_t TsIngester::unwrap(int64_t v)
+{
+    if (last_raw < 0) {
+        last_ts = v;
+    } else {
+        last_ts += srs_ts_delta(v, last_raw);
+    }
+    last_raw = v;
+    
+    return srs_max(0, last_ts);
+}
+
+int srs_rtmp_write_ts(srs_rtmp_t rtmp, char* data, int size)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(rtmp != NULL);
+    Context* context = (Context*)rtmp;
+    
+    if (size <= 0) {
+        return ret;
+    }
+    
+    if (!context->ts_ingester) {
+        context->ts_ingester = new TsIngester(context);
+    }
+    
+    return context->ts_ingester->write(data, size);
+}
+
+struct FlvContext
+{
+    SrsFileReader reader;
+    // the sync or async writer.
+    SrsFileWriter* writer;
+    SrsFlvEncoder enc;
+    SrsFlvDecoder dec;
+    SrsFlvIndex index;
+    
+    FlvContext() {
+        writer = new SrsFileWriter();
+    }
+    virtual ~FlvContext() {
+        srs_freep(writer);
+    }
+};
+
+srs_flv_t srs_flv_open_read(const char* file)
+{
+    int ret = ERROR_SUCCESS;
+    
+    FlvContext* flv = new FlvContext();
+    
+    if ((ret = flv->reader.open(file)) != ERROR_SUCCESS) {
+        srs_freep(flv);
+        return NULL;
+    }
+    
+    if ((ret = flv->dec.initialize(&flv->reader)) != ERROR_SUCCESS) {
+        srs_freep(flv);
+        return NULL;
+    }
+    
+    return flv;
+}
+
+srs_flv_t srs_flv_open_mmap(const char* file)
+{
+    int ret = ERROR_SUCCESS;
+    
+    FlvContext* flv = new FlvContext();
+    
+    if ((ret = flv->reader.open_mmap(file)) != ERROR_SUCCESS) {
+        srs_freep(flv);
+        return NULL;
+    }
+    
+    if ((ret = flv->dec.initialize(&flv->reader)) != ERROR_SUCCESS) {
+        srs_freep(flv);
+        return NULL;
+    }
+    
+    return flv;
+}
+
+srs_flv_t srs_flv_open_write(const char* file)
+{
+    int ret = ERROR_SUCCESS;
+    
+    FlvContext* flv = new FlvContext();
+    
+    if ((ret = flv->writer->open(file)) != ERROR_SUCCESS) {
+        srs_freep(flv);
+        return NULL;
+    }
+    
+    if ((ret = flv->enc.initialize(flv->writer)) != ERROR_SUCCESS) {
+        srs_freep(flv);
+        return NULL;
+    }
+    
+    return flv;
+}
+
+srs_flv_t srs_flv_open_write_async(const char* file, int max_inflight, srs_bool nonblocking)
+{
+    int ret = ERROR_SUCCESS;
+    
+    FlvContext* flv = new FlvContext();
+    
+    // the windows use the sync writer.
+#ifndef _WIN32
+    SrsAsyncFileWriter* writer = new SrsAsyncFileWriter();
+    writer->set_inflight(max_inflight, nonblocking);
+    
+    srs_freep(flv->writer);
+    flv->writer = writer;
+#endif
+    
+    if ((ret = flv->writer->open(file)) != ERROR_SUCCESS) {
+        srs_freep(flv);
+        return NULL;
+    }
+    
+    if ((ret = flv->enc.initialize(flv->writer)) != ERROR_SUCCESS) {
+        srs_freep(flv);
+        return NULL;
+    }
+    
+    return flv;
+}
+
+int srs_flv_write_inflight(srs_flv_t flv)
+{
+    FlvContext* context = (FlvContext*)flv;
+    
+#ifndef _WIN32
+    SrsAsyncFileWriter* writer = dynamic_cast<SrsAsyncFileWriter*>(context->writer);
+    if (writer) {
+        return writer->inflight();
+    }
+#endif
+    
+    return 0;
+}
+
+srs_flv_t srs_flv_open_write_direct(const char* file)
+{
+    int ret = ERROR_SUCCESS;
+    
+    FlvContext* flv = new FlvContext();
+    flv->writer->set_direct(true);
+    
+    if ((ret = flv->writer->open(file)) != ERROR_SUCCESS) {
+        srs_freep(flv);
+        return NULL;
+    }
+    
+    if ((ret = flv->enc.initialize(flv->writer)) != ERROR_SUCCESS) {
+        srs_freep(flv);
+        return NULL;
+    }
+    
+    return flv;
+}
+
+int srs_flv_close(srs_flv_t flv)
+{
+    int ret = ERROR_SUCCESS;
+    
+    FlvContext* context = (FlvContext*)flv;
+    
+    // write the buffered tags, the error is lost when free the writer.
+    if (context && context->writer->is_open()) {
+        ret = context->writer->close();
+    }
+    
+    srs_freep(context);
+    
+    return ret;
+}
+
+int srs_flv_read_header(srs_flv_t flv, char header[9])
+{
+    int ret = ERROR_SUCCESS;
+    
+    FlvContext* context = (FlvContext*)flv;
+
+    if (!context->reader.is_open()) {
+        return ERROR_SYSTEM_IO_INVALID;
+    }
+    
+    if ((ret = context->dec.read_header(header)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    char ts[4]; // tag size
+    if ((ret = context->dec.read_previous_tag_size(ts)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    return ret;
+}
+
+int srs_flv_read_tag_header(srs_flv_t flv, char* ptype, int32_t* pdata_size, u_int32_t* ptime)
+{
+    int ret = ERROR_SUCCESS;
+    
+    FlvContext* context = (FlvContext*)flv;
+
+    if (!context->reader.is_open()) {
+        return ERROR_SYSTEM_IO_INVALID;
+    }
+    
+    if ((ret = context->dec.read_tag_header(ptype, pdata_size, ptime)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    return ret;
+}
+
+int srs_flv_read_tag_data(srs_flv_t flv, char* data, int32_t size)
+{
+    int ret = ERROR_SUCCESS;
+    
+    FlvContext* context = (FlvContext*)flv;
+
+    if (!context->reader.is_open()) {
+        return ERROR_SYSTEM_IO_INVALID;
+    }
+    
+    if ((ret = context->dec.read_tag_data(data, size)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    char ts[4]; // tag size
+    if ((ret = context->dec.read_previous_tag_size(ts)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    return ret;
+}
+
+int srs_flv_read_tag_view(srs_flv_t flv, char** pdata, int32_t size)
+{
+    int ret = ERROR_SUCCESS;
+    
+    FlvContext* context = (FlvContext*)flv;
+    
+    if (!context->reader.is_open()) {
+        return ERROR_SYSTEM_IO_INVALID;
+    }
+    
+    if ((ret = context->dec.read_tag_data_view(pdata, size)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    char ts[4]; // tag size
+    if ((ret = context->dec.read_previous_tag_size(ts)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    return ret;
+}
+
+int srs_flv_write_header(srs_flv_t flv, char header[9])
+{
+    int ret = ERROR_SUCCESS;
+    
+    FlvContext* context = (FlvContext*)flv;
+
+    if (!context->writer->is_open()) {
+        return ERROR_SYSTEM_IO_INVALID;
+    }
+    
+    if ((ret = context->enc.write_header(header)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    return ret;
+}
+
+int srs_flv_write_tag(srs_flv_t flv, char type, int32_t time, char* data, int size)
+{
+    int ret = ERROR_SUCCESS;
+    
+    FlvContext* context = (FlvContext*)flv;
+
+    if (!context->writer->is_open()) {
+        return ERROR_SYSTEM_IO_INVALID;
+    }
+    
+    if (type == SRS_RTMP_TYPE_AUDIO) {
+        return context->enc.write_audio(time, data, size);
+    } else if (type == SRS_RTMP_TYPE_VIDEO) {
+        return context->enc.write_video(time, data, size);
+    } else {
+        return context->enc.write_metadata(type, data, size);
+    }
+
+    return ret;
+}
+
+int srs_flv_size_tag(int data_size)
+{
+    return SrsFlvEncoder::size_tag(data_size);
+}
+
+int srs_flv_set_write_buffer(srs_flv_t flv, int size, int interval_ms)
+{
+    FlvContext* context = (FlvContext*)flv;
+    
+    if (!context->writer->is_open()) {
+        return ERROR_SYSTEM_IO_INVALID;
+    }
+    
+    return context->writer->set_buffer(size, interval_ms);
+}
+
+int srs_flv_set_write_sync(srs_flv_t flv, int policy)
+{
+    FlvContext* context = (FlvContext*)flv;
+    
+    if (!context->writer->is_open()) {
+        return ERROR_SYSTEM_IO_INVALID;
+    }
+    
+    if (policy < SRS_FLV_SYNC_NONE || policy > SRS_FLV_SYNC_CLOSE) {
+        return ERROR_SYSTEM_IO_INVALID;
+    }
+    
+    context->writer->set_sync((SrsFileSync)policy);
+    
+    return ERROR_SUCCESS;
+}
+
+int srs_flv_flush(srs_flv_t flv)
+{
+    FlvContext* context = (FlvContext*)flv;
+    
+    if (!context->writer->is_open()) {
+        return ERROR_SYSTEM_IO_INVALID;
+    }
+    
+    return context->writer->flush();
+}
+
+int64_t srs_flv_tellg(srs_flv_t flv)
+{
+    FlvContext* context = (FlvContext*)flv;
+    return context->reader.tellg();
+}
+
+void srs_flv_lseek(srs_flv_t flv, int64_t offset)
+{
+    FlvContext* context = (FlvContext*)flv;
+    context->reader.lseek(offset);
+}
+
+int srs_flv_build_index(const char* file, const char* index_file)
+{
+    int ret = ERROR_SUCCESS;
+    
+    SrsFileReader reader;
+    if ((ret = reader.open(file)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    SrsFlvIndex index;
+    if ((ret = index.build(&reader)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    if ((ret = index.save(index_file)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    return ret;
+}
+
+int srs_flv_load_index(srs_flv_t flv, const char* index_file)
+{
+    int ret = ERROR_SUCCESS;
+    
+    FlvContext* context = (FlvContext*)flv;
+    
+    if (!context->reader.is_open()) {
+        return ERROR_SYSTEM_IO_INVALID;
+    }
+    
+    // use the sidecar when it matches the flv.
+    if (index_file && context->index.load(index_file, context->reader.filesize(), context->reader.mtime()) == ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    if ((ret = context->index.build(&context->reader)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // ignore the error, for the index is ok in memory.
+    if (index_file && (ret = context->index.save(index_file)) != ERROR_SUCCESS) {
+        srs_warn("save flv index to %s failed, ignore. ret=%d", index_file, ret);
+        ret = ERROR_SUCCESS;
+    }
+    
+    return ret;
+}
+
+int srs_flv_seek_keyframe(srs_flv_t flv, u_int32_t time, u_int32_t* ptime)
+{
+    int ret = ERROR_SUCCESS;
+    
+    FlvContext* context = (FlvContext*)flv;
+    
+    if (!context->reader.is_open()) {
+        return ERROR_SYSTEM_IO_INVALID;
+    }
+    
+    int64_t offset = 0;
+    if ((ret = context->index.seek(time, &offset, ptime)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    if (context->reader.lseek(offset) < 0) {
+        return ERROR_SYSTEM_FILE_SEEK;
+    }
+    
+    return ret;
+}
+
+int srs_flv_scan(const char* file, int nb_threads,
+    int64_t* nb_audios, int64_t* nb_videos, int64_t* nb_keyframes,
+    int64_t* nb_errors, int64_t* nb_jumps, u_int32_t* duration,
+    int* video_codec, int* audio_codec
+) {
+    int ret = ERROR_SUCCESS;
+    
+    SrsFileReader reader;
+    if ((ret = reader.open_mmap(file)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    SrsFlvScanner scanner;
+    if ((ret = scanner.initialize(&reader)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    SrsFlvScanStats stats;
+    if ((ret = scanner.scan(nb_threads, &stats)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    if (nb_audios) {
+        *nb_audios = stats.nb_audios;
+    }
+    if (nb_videos) {
+        *nb_videos = stats.nb_videos;
+    }
+    if (nb_keyframes) {
+        *nb_keyframes = stats.nb_keyframes;
+    }
+    if (nb_errors) {
+        *nb_errors = stats.nb_errors;
+    }
+    if (nb_jumps) {
+        *nb_jumps = stats.nb_jumps;
+    }
+    if (duration) {
+        *duration = stats.end_time - stats.start_time;
+    }
+    if (video_codec) {
+        *video_codec = stats.video_codec;
+    }
+    if (audio_codec) {
+        *audio_codec = stats.audio_codec;
+    }
+    
+    return ret;
+}
+
+/**
+* write the header and metadata, then copy the tags of tmp_file to writer.
+*/
+int srs_flv_repair_copy(SrsFileWriter* writer, std::string tmp_file, SrsFlvRepairStats* stats, SrsAmf0EcmaArray* metadata)
+{
+    int ret = ERROR_SUCCESS;
+    
+    SrsFlvEncoder enc;
+    if ((ret = enc.initialize(writer)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // set the audio and video flags, for the repaired file.
+    char flv_header[] = {
+        'F', 'L', 'V', (char)0x01,
+        (char)((stats->has_audio? 0x04 : 0x00) | (stats->has_video? 0x01 : 0x00)),
+        (char)0x00, (char)0x00, (char)0x00, (char)0x09
+    };
+    if ((ret = enc.write_header(flv_header)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    int size = SrsAmf0Size::str(SRS_CONSTS_RTMP_ON_METADATA) + SrsAmf0Size::ecma_array(metadata);
+    char* data = new char[size];
+    SrsAutoFreeA(char, data);
+    
+    SrsStream stream;
+    if ((ret = stream.initialize(data, size)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    if ((ret = srs_amf0_write_string(&stream, SRS_CONSTS_RTMP_ON_METADATA)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    if ((ret = metadata->write(&stream)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    if ((ret = enc.write_metadata(SrsCodecFlvTagScript, data, size)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    SrsFileReader reader;
+    if ((ret = reader.open(tmp_file)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    char* buf = new char[SRS_PERF_FLV_REPAIR_BUFFER];
+    SrsAutoFreeA(char, buf);
+    
+    while (true) {
+        ssize_t nread = 0;
+        if ((ret = reader.read(buf, SRS_PERF_FLV_REPAIR_BUFFER, &nread)) != ERROR_SUCCESS) {
+            break;
+        }
+        if ((ret = writer->write(buf, nread, NULL)) != ERROR_SUCCESS) {
+            return ret;
+        }
+    }
+    
+    if (ret != ERROR_SYSTEM_FILE_EOF) {
+        return ret;
+    }
+    
+    return ERROR_SUCCESS;
+}
+
+/**
+* write the repaired flv, the header and metadata, then the tags in tmp_file.
+* @remark the repaired_file is partial when error, user should remove it.
+*/
+int srs_flv_repair_write(const char* repaired_file, std::string tmp_file, SrsFlvRepairStats* stats, SrsAmf0EcmaArray* metadata)
+{
+    int ret = ERROR_SUCCESS;
+    
+    SrsFileWriter writer;
+    if ((ret = writer.open(repaired_file)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    if ((ret = srs_flv_repair_copy(&writer, tmp_file, stats, metadata)) != ERROR_SUCCESS) {
+        writer.close();
+        return ret;
+    }
+    
+    // the close flushes the buffer, must check it.
+    return writer.close();
+}
+
+/**
+* build the onMetaData of repaired flv, merge the original metadata,
+* with the duration and keyframes of repaired tags.
+* @param positions the offset of keyframes in tags, without the header.
+* @param body_size the bytes of all tags.
+*/
+SrsAmf0EcmaArray* srs_flv_repair_metadata(SrsAmf0Any* original, SrsFlvRepairStats* stats,
+    std::vector<double>& times, std::vector<double>& positions, int64_t body_size
+) {
+    SrsAmf0EcmaArray* metadata = SrsAmf0Any::ecma_array();
+    
+    // copy the original properties, except the generated.
+    if (original && (original->is_ecma_array() || original->is_object())) {
+        int count = original->is_ecma_array()? original->to_ecma_array()->count() : original->to_object()->count();
+        for (int i = 0; i < count; i++) {
+            std::string key;
+            SrsAmf0Any* value = NULL;
+            if (original->is_ecma_array()) {
+                key = original->to_ecma_array()->key_at(i);
+                value = original->to_ecma_array()->value_at(i);
+            } else {
+                key = original->to_object()->key_at(i);
+                value = original->to_object()->value_at(i);
+            }
+            
+            if (key == "duration" || key == "filesize" || key == "keyframes"
+                || key == "hasVideo" || key == "hasAudio" || key == "hasKeyframes"
+            ) {
+                continue;
+            }
+            metadata->set(key, value->copy());
+        }
+    }
+    
+    metadata->set("duration", SrsAmf0Any::number(stats->duration / 1000.0));
+    metadata->set("filesize", SrsAmf0Any::number(0));
+    metadata->set("hasVideo", SrsAmf0Any::boolean(stats->has_video));
+    metadata->set("hasAudio", SrsAmf0Any::boolean(stats->has_audio));
+    metadata->set("hasKeyframes", SrsAmf0Any::boolean(!times.empty()));
+    
+    SrsAmf0Object* keyframes = SrsAmf0Any::object();
+    SrsAmf0StrictArray* filepositions = SrsAmf0Any::strict_array();
+    SrsAmf0StrictArray* keyframe_times = SrsAmf0Any::strict_array();
+    keyframes->set("filepositions", filepositions);
+    keyframes->set("times", keyframe_times);
+    metadata->set("keyframes", keyframes);
+    
+    for (int i = 0; i < (int)times.size(); i++) {
+        filepositions->append(SrsAmf0Any::number(0));
+        keyframe_times->append(SrsAmf0Any::number(times[i]));
+    }
+    
+    // the number is fixed size, so the size of metadata is known now,
+    // to update the filesize and filepositions.
+    int header_size = 9 + SRS_FLV_PREVIOUS_TAG_SIZE + SRS_FLV_TAG_HEADER_SIZE
+        + SrsAmf0Size::str(SRS_CONSTS_RTMP_ON_METADATA) + SrsAmf0Size::ecma_array(metadata)
+        + SRS_FLV_PREVIOUS_TAG_SIZE;
+    
+    metadata->get_property("filesize")->set_number((double)(header_size + body_size));
+    for (int i = 0; i < (int)positions.size(); i++) {
+        filepositions->at(i)->set_number(header_size + positions[i]);
+    }
+    
+    return metadata;
+}
+
+int srs_flv_repair(const char* file, const char* repaired_file, int max_jump_ms,
+    int64_t* nb_errors, int64_t* nb_drops, int64_t* nb_jumps, u_int32_t* duration
+) {
+    int ret = ERROR_SUCCESS;
+    
+    SrsFileReader reader;
+    if ((ret = reader.open(file)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    SrsFlvRepairer repairer;
+    if ((ret = repairer.initialize(&reader)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    repairer.set_max_jump(max_jump_ms);
+    
+    // write the repaired tags to temp file in one pass,
+    // then prepend the metadata which depends on all tags.
+    std::string tmp_file = std::string(repaired_file) + ".tmp";
+    SrsFileWriter tmp_writer;
+    if ((ret = tmp_writer.open(tmp_file)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    SrsFlvEncoder tmp_enc;
+    if ((ret = tmp_enc.initialize(&tmp_writer)) != ERROR_SUCCESS) {
+        tmp_writer.close();
+        ::remove(tmp_file.c_str());
+        return ret;
+    }
+    
+    SrsAmf0Any* original = NULL;
+    SrsAutoFree(SrsAmf0Any, original);
+    
+    std::vector<double> times;
+    std::vector<double> positions;
+    
+    while (true) {
+        char type = 0;
+        int32_t size = 0;
+        u_int32_t time = 0;
+        char* data = NULL;
+        if ((ret = repairer.read_tag(&type, &size, &time, &data)) != ERROR_SUCCESS) {
+            break;
+        }
+        
+        if (type == SrsCodecFlvTagScript) {
+            // merge the first onMetaData, drop the others.
+            SrsStream stream;
+            std::string name;
+            if (stream.initialize(data, size) == ERROR_SUCCESS
+                && srs_amf0_read_string(&stream, name) == ERROR_SUCCESS
+                && name == SRS_CONSTS_RTMP_ON_METADATA
+            ) {
+                if (!original) {
+                    srs_amf0_read_any(&stream, &original);
+                }
+                continue;
+            }
+            ret = tmp_enc.write_metadata(type, data, size);
+        } else if (type == SrsCodecFlvTagAudio) {
+            ret = tmp_enc.write_audio(time, data, size);
+        } else {
+            if (SrsFlvCodec::video_is_keyframe(data, size) && !SrsFlvCodec::video_is_sequence_header(data, size)) {
+                times.push_back(time / 1000.0);
+                positions.push_back((double)tmp_writer.tellg());
+            }
+            ret = tmp_enc.write_video(time, data, size);
+        }
+        
+        if (ret != ERROR_SUCCESS) {
+            break;
         }
     }
     
-    return error_code_return;
+    if (ret != ERROR_SYSTEM_FILE_EOF) {
+        tmp_writer.close();
+        ::remove(tmp_file.c_str());
+        return ret;
+    }
+    ret = ERROR_SUCCESS;
+    
+    int64_t body_size = tmp_writer.tellg();
+    if ((ret = tmp_writer.close()) != ERROR_SUCCESS) {
+        ::remove(tmp_file.c_str());
+        return ret;
+    }
+    
+    SrsFlvRepairStats* stats = repairer.stats();
+    SrsAmf0EcmaArray* metadata = srs_flv_repair_metadata(original, stats, times, positions, body_size);
+    SrsAutoFree(SrsAmf0EcmaArray, metadata);
+    
+    // write the header, metadata, then append the tags.
+    // never leave the partial repaired file.
+    if ((ret = srs_flv_repair_write(repaired_file, tmp_file, stats, metadata)) != ERROR_SUCCESS) {
+        ::remove(repaired_file);
+        ::remove(tmp_file.c_str());
+        return ret;
+    }
+    ::remove(tmp_file.c_str());
+    
+    srs_trace("flv repair %s to %s, tags=%"PRId64", errors=%"PRId64", drops=%"PRId64", jumps=%"PRId64", duration=%u",
+        file, repaired_file, stats->nb_tags, stats->nb_errors, stats->nb_drops, stats->nb_jumps, stats->duration);
+    
+    if (nb_errors) {
+        *nb_errors = stats->nb_errors;
+    }
+    if (nb_drops) {
+        *nb_drops = stats->nb_drops;
+    }
+    if (nb_jumps) {
+        *nb_jumps = stats->nb_jumps;
+    }
+    if (duration) {
+        *duration = stats->duration;
+    }
+    
+    return ret;
 }
 
-srs_bool srs_h264_is_dvbsp_error(int error_code)
+srs_bool srs_flv_is_eof(int error_code)
 {
-    return error_code == ERROR_H264_DROP_BEFORE_SPS_PPS;
+    return error_code == ERROR_SYSTEM_FILE_EOF;
 }
 
-srs_bool srs_h264_is_duplicated_sps_error(int error_code)
+srs_bool srs_flv_is_busy(int error_code)
 {
-    return error_code == ERROR_H264_DUPLICATED_SPS;
+    return error_code == ERROR_SYSTEM_FILE_BUSY;
 }
 
-srs_bool srs_h264_is_duplicated_pps_error(int error_code)
+srs_bool srs_flv_is_sequence_header(char* data, int32_t size)
 {
-    return error_code == ERROR_H264_DUPLICATED_PPS;
+    return SrsFlvCodec::video_is_sequence_header(data, (int)size);
 }
 
-srs_bool srs_h264_startswith_annexb(char* h264_raw_data, int h264_raw_size, int* pnb_start_code)
+srs_bool srs_flv_is_keyframe(char* data, int32_t size)
 {
-    SrsStream stream;
-    if (stream.initialize(h264_raw_data, h264_raw_size) != ERROR_SUCCESS) {
-        return false;
-    }
-    
-    return srs_avc_startswith_annexb(&stream, pnb_start_code);
+    return SrsFlvCodec::video_is_keyframe(data, (int)size);
 }
 
-struct FlvContext
-{
-    SrsFileReader reader;
-    SrsFileWriter writer;
-    SrsFlvEncoder enc;
-    SrsFlvDecoder dec;
-};
-
-srs_flv_t srs_flv_open_read(const char* file)
+srs_hls_t srs_hls_open(const char* m3u8_file, int fragment_ms, int window_ms, srs_bool cleanup)
 {
     int ret = ERROR_SUCCESS;
     
-    FlvContext* flv = new FlvContext();
+    SrsHlsEncoder* hls = new SrsHlsEncoder();
     
-    if ((ret = flv->reader.open(file)) != ERROR_SUCCESS) {
-        srs_freep(flv);
+    if ((ret = hls->initialize(m3u8_file, fragment_ms, window_ms, cleanup)) != ERROR_SUCCESS) {
+        srs_freep(hls);
         return NULL;
     }
     
-    if ((ret = flv->dec.initialize(&flv->reader)) != ERROR_SUCCESS) {
-        srs_freep(flv);
-        return NULL;
+    return hls;
+}
+
+int srs_hls_set_part(srs_hls_t hls, int part_ms)
+{
+    SrsHlsEncoder* encoder = (SrsHlsEncoder*)hls;
+    return encoder->set_part(part_ms);
+}
+
+int srs_hls_set_sync(srs_hls_t hls, srs_bool v)
+{
+    SrsHlsEncoder* encoder = (SrsHlsEncoder*)hls;
+    encoder->set_sync(v);
+    return ERROR_SUCCESS;
+}
+
+srs_bool srs_hls_is_ready(srs_hls_t hls, int msn, int part)
+{
+    SrsHlsEncoder* encoder = (SrsHlsEncoder*)hls;
+    return encoder->is_ready(msn, part);
+}
+
+int srs_hls_write_tag(srs_hls_t hls, char type, u_int32_t time, char* data, int size)
+{
+    SrsHlsEncoder* encoder = (SrsHlsEncoder*)hls;
+    
+    if (type == SRS_RTMP_TYPE_AUDIO) {
+        return encoder->write_audio(time, data, size);
+    } else if (type == SRS_RTMP_TYPE_VIDEO) {
+        return encoder->write_video(time, data, size);
     }
     
-    return flv;
+    return ERROR_SUCCESS;
 }
 
-srs_flv_t srs_flv_open_write(const char* file)
+int srs_hls_close(srs_hls_t hls)
 {
-    int ret = ERROR_SUCCESS;
-    
-    FlvContext* flv = new FlvContext();
+    SrsHlsEncoder* encoder = (SrsHlsEncoder*)hls;
     
-    if ((ret = flv->writer.open(file)) != ERROR_SUCCESS) {
-        srs_freep(flv);
-        return NULL;
+    int ret = ERROR_SUCCESS;
+    if ((ret = encoder->close()) != ERROR_SUCCESS) {
+        srs_warn("hls: close failed. ret=%d", ret);
     }
     
-    if ((ret = flv->enc.initialize(&flv->writer)) != ERROR_SUCCESS) {
-        srs_freep(flv);
-        return NULL;
-    }
+    srs_freep(encoder);
     
-    return flv;
+    return ret;
 }
 
-void srs_flv_close(srs_flv_t flv)
+struct Mp4Context
 {
-    FlvContext* context = (FlvContext*)flv;
-    srs_freep(context);
-}
+    SrsFileWriter writer;
+    SrsMp4Encoder enc;
+};
 
-int srs_flv_read_header(srs_flv_t flv, char header[9])
+srs_mp4_t srs_mp4_open(const char* file, int fragment_ms)
 {
     int ret = ERROR_SUCCESS;
     
-    FlvContext* context = (FlvContext*)flv;
-
-    if (!context->reader.is_open()) {
-        return ERROR_SYSTEM_IO_INVALID;
-    }
+    Mp4Context* mp4 = new Mp4Context();
     
-    if ((ret = context->dec.read_header(header)) != ERROR_SUCCESS) {
-        return ret;
+    if ((ret = mp4->writer.open(file)) != ERROR_SUCCESS) {
+        srs_freep(mp4);
+        return NULL;
     }
     
-    char ts[4]; // tag size
-    if ((ret = context->dec.read_previous_tag_size(ts)) != ERROR_SUCCESS) {
-        return ret;
+    if ((ret = mp4->enc.initialize(&mp4->writer, fragment_ms)) != ERROR_SUCCESS) {
+        srs_freep(mp4);
+        return NULL;
     }
     
-    return ret;
+    return mp4;
 }
 
-int srs_flv_read_tag_header(srs_flv_t flv, char* ptype, int32_t* pdata_size, u_int32_t* ptime)
+int srs_mp4_write_tag(srs_mp4_t mp4, char type, u_int32_t time, char* data, int size)
 {
-    int ret = ERROR_SUCCESS;
+    Mp4Context* context = (Mp4Context*)mp4;
     
-    FlvContext* context = (FlvContext*)flv;
-
-    if (!context->reader.is_open()) {
-        return ERROR_SYSTEM_IO_INVALID;
+    if (type == SRS_RTMP_TYPE_AUDIO) {
+        return context->enc.write_audio(time, data, size);
+    } else if (type == SRS_RTMP_TYPE_VIDEO) {
+        return context->enc.write_video(time, data, size);
     }
     
-    if ((ret = context->dec.read_tag_header(ptype, pdata_size, ptime)) != ERROR_SUCCESS) {
-        return ret;
-    }
+    srs_freepa(data);
     
-    return ret;
+    return ERROR_SUCCESS;
 }
 
-int srs_flv_read_tag_data(srs_flv_t flv, char* data, int32_t size)
+int srs_mp4_close(srs_mp4_t mp4)
 {
-    int ret = ERROR_SUCCESS;
+    Mp4Context* context = (Mp4Context*)mp4;
     
-    FlvContext* context = (FlvContext*)flv;
-
-    if (!context->reader.is_open()) {
-        return ERROR_SYSTEM_IO_INVALID;
+    int ret = ERROR_SUCCESS;
+    if ((ret = context->enc.flush()) != ERROR_SUCCESS) {
+        srs_warn("mp4: flush the last fragment failed. ret=%d", ret);
     }
     
-    if ((ret = context->dec.read_tag_data(data, size)) != ERROR_SUCCESS) {
-        return ret;
+    int r0 = context->writer.close();
+    if (ret == ERROR_SUCCESS) {
+        ret = r0;
     }
     
-    char ts[4]; // tag size
-    if ((ret = context->dec.read_previous_tag_size(ts)) != ERROR_SUCCESS) {
-        return ret;
-    }
+    srs_freep(context);
     
     return ret;
 }
 
-int srs_flv_write_header(srs_flv_t flv, char header[9])
+#ifndef _WIN32
+struct UdpContext
 {
+    SrsTsUdpWriter writer;
+    SrsTsEncoder enc;
+};
+#endif
+
+srs_udp_t srs_udp_open(const char* url, int ttl, int bitrate)
+{
+#ifndef _WIN32
     int ret = ERROR_SUCCESS;
     
-    FlvContext* context = (FlvContext*)flv;
-
-    if (!context->writer.is_open()) {
-        return ERROR_SYSTEM_IO_INVALID;
+    UdpContext* udp = new UdpContext();
+    udp->writer.set_ttl(ttl);
+    udp->writer.set_bitrate(bitrate);
+    
+    if ((ret = udp->writer.open(url)) != ERROR_SUCCESS) {
+        srs_freep(udp);
+        return NULL;
     }
     
-    if ((ret = context->enc.write_header(header)) != ERROR_SUCCESS) {
-        return ret;
+    if ((ret = udp->enc.initialize(&udp->writer)) != ERROR_SUCCESS) {
+        srs_freep(udp);
+        return NULL;
     }
+    udp->enc.set_interval(100, 40);
+    udp->enc.set_bitrate(bitrate);
     
-    return ret;
+    return udp;
+#else
+    return NULL;
+#endif
 }
 
-int srs_flv_write_tag(srs_flv_t flv, char type, int32_t time, char* data, int size)
+int srs_udp_write_tag(srs_udp_t udp, char type, u_int32_t time, char* data, int size)
 {
-    int ret = ERROR_SUCCESS;
-    
-    FlvContext* context = (FlvContext*)flv;
-
-    if (!context->writer.is_open()) {
-        return ERROR_SYSTEM_IO_INVALID;
-    }
+#ifndef _WIN32
+    UdpContext* context = (UdpContext*)udp;
     
     if (type == SRS_RTMP_TYPE_AUDIO) {
         return context->enc.write_audio(time, data, size);
     } else if (type == SRS_RTMP_TYPE_VIDEO) {
         return context->enc.write_video(time, data, size);
-    } else {
-        return context->enc.write_metadata(type, data, size);
     }
-
-    return ret;
+#endif
+    
+    return ERROR_SUCCESS;
 }
 
-int srs_flv_size_tag(int data_size)
+int srs_udp_close(srs_udp_t udp)
 {
-    return SrsFlvEncoder::size_tag(data_size);
+    int ret = ERROR_SUCCESS;
+    
+#ifndef _WIN32
+    UdpContext* context = (UdpContext*)udp;
+    
+    // send the queued datagrams, the error is lost when free the writer.
+    if (context && context->writer.is_open()) {
+        ret = context->writer.close();
+    }
+    
+    srs_freep(context);
+#endif
+    
+    return ret;
 }
 
-int64_t srs_flv_tellg(srs_flv_t flv)
+struct TsMuxerContext
 {
-    FlvContext* context = (FlvContext*)flv;
-    return context->reader.tellg();
-}
+    // the file or udp writer.
+    SrsFileWriter* writer;
+    SrsTsMultiEncoder* enc;
+    
+    TsMuxerContext() {
+        writer = NULL;
+        enc = new SrsTsMultiEncoder();
+    }
+    virtual ~TsMuxerContext() {
+        // the encoder close the writer.
+        srs_freep(enc);
+        srs_freep(writer);
+    }
+};
 
-void srs_flv_lseek(srs_flv_t flv, int64_t offset)
+srs_ts_t srs_ts_open(const char* url, int bitrate)
 {
-    FlvContext* context = (FlvContext*)flv;
-    context->reader.lseek(offset);
+    int ret = ERROR_SUCCESS;
+    
+    TsMuxerContext* ts = new TsMuxerContext();
+    
+    if (!srs_string_starts_with(url, "udp://")) {
+        ts->writer = new SrsFileWriter();
+    } else {
+#ifndef _WIN32
+        SrsTsUdpWriter* writer = new SrsTsUdpWriter();
+        writer->set_bitrate(bitrate);
+        ts->writer = writer;
+#else
+        srs_freep(ts);
+        return NULL;
+#endif
+    }
+    
+    if ((ret = ts->writer->open(url)) != ERROR_SUCCESS) {
+        srs_freep(ts);
+        return NULL;
+    }
+    
+    if ((ret = ts->enc->initialize(ts->writer)) != ERROR_SUCCESS) {
+        srs_freep(ts);
+        return NULL;
+    }
+    ts->enc->set_interval(100, 40);
+    ts->enc->set_bitrate(bitrate);
+    
+    return ts;
 }
 
-srs_bool srs_flv_is_eof(int error_code)
+int srs_ts_add_track(srs_ts_t ts, int program, int pid)
 {
-    return error_code == ERROR_SYSTEM_FILE_EOF;
+    int ret = ERROR_SUCCESS;
+    
+    TsMuxerContext* context = (TsMuxerContext*)ts;
+    
+    int track = -1;
+    if ((ret = context->enc->add_track(program, pid, &track)) != ERROR_SUCCESS) {
+        return -1;
+    }
+    
+    return track;
 }
 
-srs_bool srs_flv_is_sequence_header(char* data, int32_t size)
+int srs_ts_write_tag(srs_ts_t ts, int track, char type, u_int32_t time, char* data, int size)
 {
-    return SrsFlvCodec::video_is_sequence_header(data, (int)size);
+    TsMuxerContext* context = (TsMuxerContext*)ts;
+    
+    if (type == SRS_RTMP_TYPE_AUDIO) {
+        return context->enc->write_audio(track, time, data, size);
+    } else if (type == SRS_RTMP_TYPE_VIDEO) {
+        return context->enc->write_video(track, time, data, size);
+    }
+    
+    return ERROR_SUCCESS;
 }
 
-srs_bool srs_flv_is_keyframe(char* data, int32_t size)
+int srs_ts_close(srs_ts_t ts)
 {
-    return SrsFlvCodec::video_is_keyframe(data, (int)size);
+    int ret = ERROR_SUCCESS;
+    
+    TsMuxerContext* context = (TsMuxerContext*)ts;
+    
+    // write the buffered ts, the error is lost when free the writer.
+    if (context && context->writer && context->writer->is_open()) {
+        ret = context->writer->close();
+    }
+    
+    srs_freep(context);
+    
+    return ret;
 }
 
 srs_amf0_t srs_amf0_parse(char* data, int size, int* nparsed)
@@ -1937,6 +3776,35 @@ int64_t srs_utils_recv_bytes(srs_rtmp_t rtmp)
     return context->rtmp->get_recv_bytes();
 }
 
+int srs_utils_startup_timing(srs_rtmp_t rtmp,
+    int64_t* dns, int64_t* connect, int64_t* handshake,
+    int64_t* connect_app, int64_t* create_stream, int64_t* play_publish,
+    int64_t* first_audio, int64_t* first_video, int64_t* first_keyframe
+) {
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(rtmp != NULL);
+    Context* context = (Context*)rtmp;
+    
+    int64_t* stimes[] = {
+        &context->stime_dns, &context->stime_connect, &context->stime_handshake,
+        &context->stime_connect_app, &context->stime_create_stream, &context->stime_play_publish,
+        &context->stime_first_audio, &context->stime_first_video, &context->stime_first_keyframe
+    };
+    int64_t* elapsed[] = {
+        dns, connect, handshake,
+        connect_app, create_stream, play_publish,
+        first_audio, first_video, first_keyframe
+    };
+    
+    for (int i = 0; i < (int)(sizeof(stimes) / sizeof(int64_t*)); i++) {
+        int64_t stime = *stimes[i];
+        *elapsed[i] = (stime > 0)? stime - context->stime_start : -1;
+    }
+    
+    return ret;
+}
+
 int srs_utils_parse_timestamp(
     u_int32_t time, char type, char* data, int size,
     u_int32_t* ppts
@@ -1948,7 +3816,8 @@ int srs_utils_parse_timestamp(
         return ret;
     }
 
-    if (!SrsFlvCodec::video_is_h264(data, size)) {
+    bool is_hevc = SrsFlvCodec::video_is_hevc(data, size);
+    if (!SrsFlvCodec::video_is_h264(data, size) && !is_hevc) {
         return ERROR_FLV_INVALID_VIDEO_TAG;
     }
 
@@ -1957,6 +3826,22 @@ int srs_utils_parse_timestamp(
         return ret;
     }
     
+    // for the enhanced RTMP, 1bytes header, 4bytes FourCC, then the
+    // 3bytes cts only for the coded frames, others are zero.
+    if (is_hevc && (data[0] & SRS_FLV_VIDEO_EX_HEADER)) {
+        if ((data[0] & 0x0f) != SrsCodecVideoExPacketTypeCodedFrames) {
+            *ppts = time;
+            return ret;
+        }
+        if (size < 8) {
+            return ERROR_FLV_INVALID_VIDEO_TAG;
+        }
+        
+        // skip the FourCC, the cts is the same as avc.
+        data += 3;
+        size -= 3;
+    }
+    
     // 1bytes, frame type and codec id.
     // 1bytes, avc packet type.
     // 3bytes, cts, composition time,
@@ -1998,12 +3883,22 @@ srs_bool srs_utils_flv_tag_is_av(char type)
     return type == SRS_RTMP_TYPE_AUDIO || type == SRS_RTMP_TYPE_VIDEO;
 }
 
+u_int32_t srs_utils_crc32(const void* buf, int size)
+{
+    return srs_crc32(buf, size);
+}
+
 char srs_utils_flv_video_codec_id(char* data, int size)
 {
     if (size < 1) {
         return 0;
     }
 
+    // for the enhanced RTMP, the codec is specified by FourCC.
+    if (data[0] & SRS_FLV_VIDEO_EX_HEADER) {
+        return SrsFlvCodec::video_is_hevc(data, size)? SrsCodecVideoHEVC : 0;
+    }
+    
     char codec_id = data[0];
     codec_id = codec_id & 0x0F;
     
@@ -2016,7 +3911,18 @@ char srs_utils_flv_video_avc_packet_type(char* data, int size)
         return -1;
     }
     
-    if (!SrsFlvCodec::video_is_h264(data, size)) {
+    // for the enhanced RTMP, map the packet type to avc packet type.
+    if (SrsFlvCodec::video_is_hevc(data, size) && (data[0] & SRS_FLV_VIDEO_EX_HEADER)) {
+        switch (data[0] & 0x0f) {
+            case SrsCodecVideoExPacketTypeSequenceStart: return SrsCodecVideoAVCTypeSequenceHeader;
+            case SrsCodecVideoExPacketTypeCodedFrames:
+            case SrsCodecVideoExPacketTypeCodedFramesX: return SrsCodecVideoAVCTypeNALU;
+            case SrsCodecVideoExPacketTypeSequenceEnd: return SrsCodecVideoAVCTypeSequenceHeaderEOF;
+            default: return -1;
+        }
+    }
+    
+    if (!SrsFlvCodec::video_is_h264(data, size) && !SrsFlvCodec::video_is_hevc(data, size)) {
         return -1;
     }
     
@@ -2035,12 +3941,17 @@ char srs_utils_flv_video_frame_type(char* data, int size)
         return -1;
     }
     
-    if (!SrsFlvCodec::video_is_h264(data, size)) {
+    if (!SrsFlvCodec::video_is_h264(data, size) && !SrsFlvCodec::video_is_hevc(data, size)) {
         return -1;
     }
     
+    // for the enhanced RTMP, the frame type is 3bits.
     u_int8_t frame_type = data[0];
-    frame_type = (frame_type >> 4) & 0x0f;
+    if (frame_type & SRS_FLV_VIDEO_EX_HEADER) {
+        frame_type = (frame_type >> 4) & 0x07;
+    } else {
+        frame_type = (frame_type >> 4) & 0x0f;
+    }
     if (frame_type < 1 || frame_type > 5) {
         return -1;
     }
@@ -2162,6 +4073,7 @@ const char* srs_human_flv_video_codec_id2string(char codec_id)
     static const char* vp6_alpha = "VP6Alpha";
     static const char* screen2 = "Screen2";
     static const char* h264 = "H.264";
+    static const char* h265 = "H.265";
     static const char* unknown = "Unknown";
     
     switch (codec_id) {
@@ -2171,6 +4083,7 @@ const char* srs_human_flv_video_codec_id2string(char codec_id)
         case 5: return vp6_alpha;
         case 6: return screen2;
         case 7: return h264;
+        case 12: return h265;
         default: return unknown;
     }
     
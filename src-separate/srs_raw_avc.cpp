@@ -302,6 +302,159 @@ int SrsRawH264Stream::mux_avc2flv(string video, int8_t frame_type, int8_t avc_pa
     return ret;
 }
 
+SrsRawHEVCStream::SrsRawHEVCStream()
+{
+}
+
+SrsRawHEVCStream::~SrsRawHEVCStream()
+{
+}
+
+bool SrsRawHEVCStream::is_vps(char* frame, int nb_frame)
+{
+    srs_assert(nb_frame > 0);
+    
+    // 6bits, 7.3.1.2 NAL unit header syntax,
+    // H.265-HEVC-ITU-T-REC-H.265-201304.pdf, page 31.
+    //  32: VPS, 33: SPS, 34: PPS
+    u_int8_t nal_unit_type = (frame[0] >> 1) & 0x3f;
+    
+    return nal_unit_type == SrsHevcNaluTypeVPS;
+}
+
+bool SrsRawHEVCStream::is_sps(char* frame, int nb_frame)
+{
+    srs_assert(nb_frame > 0);
+    
+    u_int8_t nal_unit_type = (frame[0] >> 1) & 0x3f;
+    
+    return nal_unit_type == SrsHevcNaluTypeSPS;
+}
+
+bool SrsRawHEVCStream::is_pps(char* frame, int nb_frame)
+{
+    srs_assert(nb_frame > 0);
+    
+    u_int8_t nal_unit_type = (frame[0] >> 1) & 0x3f;
+    
+    return nal_unit_type == SrsHevcNaluTypePPS;
+}
+
+int SrsRawHEVCStream::mux_sequence_header(string vps, string sps, string pps, string& sh)
+{
+    int ret = ERROR_SUCCESS;
+    
+    SrsHevcSps info;
+    if ((ret = srs_hevc_demux_sps((char*)sps.data(), (int)sps.length(), &info)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // 23bytes header:
+    //      configurationVersion to lengthSizeMinusOne, numOfArrays
+    // for each of the vps, sps and pps, 5bytes array header:
+    //      array_completeness, NAL_unit_type, numNalus(2B), nalUnitLength(2B)
+    // Nbytes of nalu.
+    //      nalUnit
+    int nb_packet = 23
+        + 5 + (int)vps.length()
+        + 5 + (int)sps.length()
+        + 5 + (int)pps.length();
+    char* packet = new char[nb_packet];
+    SrsAutoFreeA(char, packet);
+    
+    // use stream to generate the hevc packet.
+    SrsStream stream;
+    if ((ret = stream.initialize(packet, nb_packet)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // 8.3.3.1.2 Syntax, ISO_IEC_14496-15-2014.pdf, page 55
+    // configurationVersion
+    stream.write_1bytes(0x01);
+    // general_profile_space(2bits), general_tier_flag(1bit), general_profile_idc(5bits)
+    stream.write_1bytes((info.general_profile_space << 6) | (info.general_tier_flag << 5) | info.general_profile_idc);
+    // general_profile_compatibility_flags
+    stream.write_4bytes(info.general_profile_compatibility_flags);
+    // general_constraint_indicator_flags, 48bits
+    stream.write_4bytes((int32_t)(info.general_constraint_indicator_flags >> 16));
+    stream.write_2bytes((int16_t)(info.general_constraint_indicator_flags & 0xffff));
+    // general_level_idc
+    stream.write_1bytes(info.general_level_idc);
+    // reserved(4bits) 1111, min_spatial_segmentation_idc(12bits) 0
+    stream.write_2bytes(0xf000);
+    // reserved(6bits) 111111, parallelismType(2bits) 0, unknown
+    stream.write_1bytes(0xfc);
+    // reserved(6bits) 111111, chromaFormat(2bits)
+    stream.write_1bytes(0xfc | (info.chroma_format_idc & 0x03));
+    // reserved(5bits) 11111, bitDepthLumaMinus8(3bits)
+    stream.write_1bytes(0xf8 | (info.bit_depth_luma_minus8 & 0x07));
+    // reserved(5bits) 11111, bitDepthChromaMinus8(3bits)
+    stream.write_1bytes(0xf8 | (info.bit_depth_chroma_minus8 & 0x07));
+    // avgFrameRate, 0 for unspecified
+    stream.write_2bytes(0x00);
+    // constantFrameRate(2bits) 0, numTemporalLayers(3bits), temporalIdNested(1bit),
+    // lengthSizeMinusOne(2bits), always use 4bytes size, so we always set it to 0x03.
+    stream.write_1bytes(((info.sps_max_sub_layers_minus1 + 1) << 3) | (info.sps_temporal_id_nesting_flag << 2) | 0x03);
+    // numOfArrays, the vps, sps and pps.
+    stream.write_1bytes(0x03);
+    
+    string nalus[] = { vps, sps, pps };
+    SrsHevcNaluType types[] = { SrsHevcNaluTypeVPS, SrsHevcNaluTypeSPS, SrsHevcNaluTypePPS };
+    for (int i = 0; i < 3; i++) {
+        // array_completeness(1bit) 1, for the parameter sets are not in the stream,
+        // reserved(1bit) 0, NAL_unit_type(6bits)
+        stream.write_1bytes(0x80 | types[i]);
+        // numNalus, always 1
+        stream.write_2bytes(0x01);
+        // nalUnitLength
+        stream.write_2bytes(nalus[i].length());
+        // nalUnit
+        stream.write_string(nalus[i]);
+    }
+    
+    sh = "";
+    sh.append(packet, nb_packet);
+    
+    return ret;
+}
+
+int SrsRawHEVCStream::mux_hevc2flv(string video, int8_t frame_type, int8_t packet_type, u_int32_t dts, u_int32_t pts, char** flv, int* nb_flv)
+{
+    int ret = ERROR_SUCCESS;
+    
+    // for hevc in enhanced RTMP video payload, there is 5 or 8bytes header:
+    //      1bytes, IsExHeader | FrameType | PacketType
+    //      4bytes, FourCC, the 'hvc1'
+    //      3bytes, CompositionTime, the cts, only for the coded frames.
+    // @see https://github.com/veovera/enhanced-rtmp
+    bool has_cts = packet_type == SrsCodecVideoExPacketTypeCodedFrames;
+    int size = (int)video.length() + (has_cts? 8 : 5);
+    char* data = new char[size];
+    
+    SrsStream stream;
+    if ((ret = stream.initialize(data, size)) != ERROR_SUCCESS) {
+        srs_freepa(data);
+        return ret;
+    }
+    
+    stream.write_1bytes(SRS_FLV_VIDEO_EX_HEADER | (frame_type << 4) | packet_type);
+    stream.write_4bytes(SRS_FLV_VIDEO_FOURCC_HEVC);
+    
+    // CompositionTime
+    // cts = pts - dts.
+    if (has_cts) {
+        stream.write_3bytes((int32_t)(pts - dts));
+    }
+    
+    // h.265 raw data.
+    stream.write_string(video);
+    
+    *flv = data;
+    *nb_flv = size;
+    
+    return ret;
+}
+
 SrsRawAacStream::SrsRawAacStream()
 {
 }
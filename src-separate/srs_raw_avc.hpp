@@ -88,6 +88,41 @@ public:
     virtual int mux_avc2flv(std::string video, int8_t frame_type, int8_t avc_packet_type, u_int32_t dts, u_int32_t pts, char** flv, int* nb_flv);
 };
 
+/**
+* the raw h.265 stream, in annexb.
+* @remark the annexb demux and the ibmf NALU are the same as h.264,
+*       use the SrsRawH264Stream for them.
+*/
+class SrsRawHEVCStream
+{
+public:
+    SrsRawHEVCStream();
+    virtual ~SrsRawHEVCStream();
+public:
+    /**
+    * whether the frame is vps, sps or pps.
+    */
+    virtual bool is_vps(char* frame, int nb_frame);
+    virtual bool is_sps(char* frame, int nb_frame);
+    virtual bool is_pps(char* frame, int nb_frame);
+public:
+    /**
+    * mux the vps/sps/pps to the HEVCDecoderConfigurationRecord,
+    * the profile, level and format are parsed from the sps.
+    * @param sh output the sequence header.
+    */
+    virtual int mux_sequence_header(std::string vps, std::string sps, std::string pps, std::string& sh);
+    /**
+    * mux the hevc video packet to flv video packet, in enhanced RTMP.
+    * @param frame_type, SrsCodecVideoAVCFrameKeyFrame or SrsCodecVideoAVCFrameInterFrame.
+    * @param packet_type, SrsCodecVideoExPacketTypeSequenceStart or SrsCodecVideoExPacketTypeCodedFrames.
+    * @param video the h.265 raw data.
+    * @param flv output the muxed flv packet.
+    * @param nb_flv output the muxed flv size.
+    */
+    virtual int mux_hevc2flv(std::string video, int8_t frame_type, int8_t packet_type, u_int32_t dts, u_int32_t pts, char** flv, int* nb_flv);
+};
+
 /**
 * the header of adts sample.
 */
@@ -25,12 +25,14 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include <utility>
 #include <vector>
+#include <algorithm>
 #include <sstream>
 using namespace std;
 
 #include <srs_kernel_log.hpp>
 #include <srs_kernel_error.hpp>
 #include <srs_kernel_stream.hpp>
+#include <srs_core_autofree.hpp>
 
 using namespace _srs_internal;
 
@@ -1239,6 +1241,141 @@ int SrsAmf0Size::any(SrsAmf0Any* o)
     return o->total_size();
 }
 
+SrsAmf0Template::SrsAmf0Template()
+{
+    // the image always starts with a part, maybe empty.
+    parts.push_back("");
+}
+
+SrsAmf0Template::~SrsAmf0Template()
+{
+}
+
+int SrsAmf0Template::append(SrsAmf0Any* value)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(value != NULL);
+    SrsAutoFree(SrsAmf0Any, value);
+    
+    int size = value->total_size();
+    char* bytes = new char[size];
+    SrsAutoFreeA(char, bytes);
+    
+    SrsStream stream;
+    if ((ret = stream.initialize(bytes, size)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    if ((ret = value->write(&stream)) != ERROR_SUCCESS) {
+        srs_error("amf0 template write value failed. ret=%d", ret);
+        return ret;
+    }
+    
+    parts.back().append(bytes, size);
+    
+    return ret;
+}
+
+void SrsAmf0Template::append_object_start()
+{
+    parts.back().append(1, (char)RTMP_AMF0_Object);
+}
+
+void SrsAmf0Template::append_property_name(string name)
+{
+    // the property name is UTF-8 without marker.
+    std::string& part = parts.back();
+    part.append(1, (char)((name.length() >> 8) & 0xff));
+    part.append(1, (char)(name.length() & 0xff));
+    part.append(name);
+}
+
+void SrsAmf0Template::append_object_eof()
+{
+    std::string& part = parts.back();
+    part.append(2, (char)0x00);
+    part.append(1, (char)RTMP_AMF0_ObjectEnd);
+}
+
+void SrsAmf0Template::append_number_field()
+{
+    fields.push_back(RTMP_AMF0_Number);
+    parts.push_back("");
+}
+
+void SrsAmf0Template::append_string_field()
+{
+    fields.push_back(RTMP_AMF0_String);
+    parts.push_back("");
+}
+
+int SrsAmf0Template::nb_numbers()
+{
+    return (int)std::count(fields.begin(), fields.end(), (char)RTMP_AMF0_Number);
+}
+
+int SrsAmf0Template::nb_strings()
+{
+    return (int)std::count(fields.begin(), fields.end(), (char)RTMP_AMF0_String);
+}
+
+int SrsAmf0Template::total_size(string* strings)
+{
+    int size = 0;
+    
+    std::vector<std::string>::iterator it;
+    for (it = parts.begin(); it != parts.end(); ++it) {
+        size += (int)it->length();
+    }
+    
+    for (int i = 0; i < (int)fields.size(); i++) {
+        if (fields[i] == RTMP_AMF0_Number) {
+            size += SrsAmf0Size::number();
+        } else {
+            size += SrsAmf0Size::str(*strings++);
+        }
+    }
+    
+    return size;
+}
+
+int SrsAmf0Template::write(SrsStream* stream, double* numbers, string* strings)
+{
+    int ret = ERROR_SUCCESS;
+    
+    for (int i = 0; i < (int)parts.size(); i++) {
+        std::string& part = parts[i];
+    
+        if (!part.empty()) {
+            if (!stream->require((int)part.length())) {
+                ret = ERROR_RTMP_AMF0_ENCODE;
+                srs_error("amf0 template write part failed. ret=%d", ret);
+                return ret;
+            }
+            stream->write_bytes((char*)part.data(), (int)part.length());
+        }
+    
+        // the last part has no field.
+        if (i >= (int)fields.size()) {
+            break;
+        }
+    
+        if (fields[i] == RTMP_AMF0_Number) {
+            ret = srs_amf0_write_number(stream, *numbers++);
+        } else {
+            ret = srs_amf0_write_string(stream, *strings++);
+        }
+    
+        if (ret != ERROR_SUCCESS) {
+            srs_error("amf0 template write field failed. ret=%d", ret);
+            return ret;
+        }
+    }
+    
+    return ret;
+}
+
 SrsAmf0String::SrsAmf0String(const char* _value)
 {
     marker = RTMP_AMF0_String;
@@ -564,6 +564,68 @@ public:
     static int any(SrsAmf0Any* o);
 };
 
+/**
+* the pre-serialized amf0 image, which contains some number or string fields,
+* the constant parts are encoded once when build the template,
+* and the fields are patched into the image when write.
+* for example, the connect command of client:
+*       "connect", [number], {app: [string], flashVer: "WIN 15,0,0,239", ...}
+* where the [number] and [string] are fields, others are constant parts.
+*/
+class SrsAmf0Template
+{
+private:
+    /**
+    * the marker of fields, RTMP_AMF0_Number or RTMP_AMF0_String.
+    */
+    std::vector<char> fields;
+    /**
+    * the constant parts, the size always equals to fields.size() + 1,
+    * for the image is: part[0], field[0], part[1], ..., field[n-1], part[n].
+    */
+    std::vector<std::string> parts;
+public:
+    SrsAmf0Template();
+    virtual ~SrsAmf0Template();
+// build the template.
+public:
+    /**
+    * append a constant amf0 value to image.
+    * @remark the template will free the value, user should never use it.
+    */
+    virtual int append(SrsAmf0Any* value);
+    /**
+    * append the object marker, the object property name and the object EOF,
+    * use to build the object which contains fields.
+    */
+    virtual void append_object_start();
+    virtual void append_property_name(std::string name);
+    virtual void append_object_eof();
+    /**
+    * append a number or string field to image.
+    */
+    virtual void append_number_field();
+    virtual void append_string_field();
+// write the image with fields.
+public:
+    /**
+    * get the number of number fields and string fields.
+    */
+    virtual int nb_numbers();
+    virtual int nb_strings();
+    /**
+    * get the size of image, when patched with the string fields.
+    * @param strings, the value of string fields, nb_strings() values.
+    */
+    virtual int total_size(std::string* strings);
+    /**
+    * write the image to stream, patch the fields in order.
+    * @param numbers, the value of number fields, nb_numbers() values.
+    * @param strings, the value of string fields, nb_strings() values.
+    */
+    virtual int write(SrsStream* stream, double* numbers, std::string* strings);
+};
+
 /**
 * read anything from stream.
 * @param ppvalue, the output amf0 any elem.
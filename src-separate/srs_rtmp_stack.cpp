@@ -915,6 +915,89 @@ int SrsProtocol::send_and_free_packet(SrsPacket* packet, int stream_id)
     return ret;
 }
 
+int SrsProtocol::send_and_free_packets(SrsPacket** packets, int* stream_ids, int nb_packets)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(packets);
+    srs_assert(nb_packets > 0);
+    
+    std::vector<SrsMessageHeader> headers;
+    std::vector<SrsPacket*> sent;
+    std::vector<SrsSharedPtrMessage*> msgs;
+    
+    // encode all packets to messages, which take the payload.
+    for (int i = 0; i < nb_packets; i++) {
+        SrsPacket* packet = packets[i];
+        srs_assert(packet);
+        
+        int size = 0;
+        char* payload = NULL;
+        if ((ret = packet->encode(size, payload)) != ERROR_SUCCESS) {
+            srs_error("encode RTMP packet to bytes oriented RTMP message failed. ret=%d", ret);
+            break;
+        }
+        
+        // encode packet to payload and size.
+        if (size <= 0 || payload == NULL) {
+            srs_warn("packet is empty, ignore empty message.");
+            continue;
+        }
+        
+        SrsMessageHeader header;
+        header.payload_length = size;
+        header.message_type = packet->get_message_type();
+        header.stream_id = stream_ids[i];
+        header.perfer_cid = packet->get_prefer_cid();
+        headers.push_back(header);
+        sent.push_back(packet);
+        
+        SrsSharedPtrMessage* msg = new SrsSharedPtrMessage();
+        msgs.push_back(msg);
+        if ((ret = msg->create(&header, payload, size)) != ERROR_SUCCESS) {
+            srs_freepa(payload);
+            break;
+        }
+    }
+    
+    // sendout all messages in one writev.
+    if (ret == ERROR_SUCCESS && !msgs.empty()) {
+        ret = do_send_messages(&msgs[0], (int)msgs.size());
+    }
+    
+    for (int i = 0; i < (int)msgs.size(); i++) {
+        SrsSharedPtrMessage* msg = msgs[i];
+        srs_freep(msg);
+    }
+    
+    // update the protocol state by packets in order,
+    // for the response must be decoded by the request.
+    if (ret == ERROR_SUCCESS) {
+        for (int i = 0; i < (int)headers.size(); i++) {
+            if ((ret = on_send_packet(&headers[i], sent[i])) != ERROR_SUCCESS) {
+                break;
+            }
+        }
+    }
+    
+    for (int i = 0; i < nb_packets; i++) {
+        SrsPacket* packet = packets[i];
+        srs_freep(packet);
+    }
+    
+    // donot flush when send failed
+    if (ret != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // flush messages in manual queue
+    if ((ret = manual_response_flush()) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    return ret;
+}
+
 int SrsProtocol::recv_interlaced_message(SrsCommonMessage** pmsg)
 {
     int ret = ERROR_SUCCESS;
@@ -1586,6 +1669,14 @@ int SrsProtocol::on_send_packet(SrsMessageHeader* mh, SrsPacket* packet)
                     break;
                 }
             }
+            if (true) {
+                SrsTemplateCommandPacket* pkt = dynamic_cast<SrsTemplateCommandPacket*>(packet);
+                // the play/publish use transaction id 0, no response.
+                if (pkt && pkt->transaction_id > 0) {
+                    requests[pkt->transaction_id] = pkt->command_name;
+                    break;
+                }
+            }
             break;
         }
         default:
@@ -2047,39 +2138,7 @@ int SrsRtmpClient::connect_app2(
     
     // Connect(vhost, app)
     if (true) {
-        SrsConnectAppPacket* pkt = new SrsConnectAppPacket();
-        
-        pkt->command_object->set("app", SrsAmf0Any::str(app.c_str()));
-        pkt->command_object->set("flashVer", SrsAmf0Any::str("WIN 15,0,0,239"));
-        if (req) {
-            pkt->command_object->set("swfUrl", SrsAmf0Any::str(req->swfUrl.c_str()));
-        } else {
-            pkt->command_object->set("swfUrl", SrsAmf0Any::str());
-        }
-        if (req && req->tcUrl != "") {
-            pkt->command_object->set("tcUrl", SrsAmf0Any::str(req->tcUrl.c_str()));
-        } else {
-            pkt->command_object->set("tcUrl", SrsAmf0Any::str(tc_url.c_str()));
-        }
-        pkt->command_object->set("fpad", SrsAmf0Any::boolean(false));
-        pkt->command_object->set("capabilities", SrsAmf0Any::number(239));
-        pkt->command_object->set("audioCodecs", SrsAmf0Any::number(3575));
-        pkt->command_object->set("videoCodecs", SrsAmf0Any::number(252));
-        pkt->command_object->set("videoFunction", SrsAmf0Any::number(1));
-        if (req) {
-            pkt->command_object->set("pageUrl", SrsAmf0Any::str(req->pageUrl.c_str()));
-        } else {
-            pkt->command_object->set("pageUrl", SrsAmf0Any::str());
-        }
-        pkt->command_object->set("objectEncoding", SrsAmf0Any::number(0));
-        
-        // @see https://github.com/ossrs/srs/issues/160
-        // the debug_srs_upnode is config in vhost and default to true.
-        if (debug_srs_upnode && req && req->args) {
-            srs_freep(pkt->args);
-            pkt->args = req->args->copy()->to_object();
-        }
-        
+        SrsTemplateCommandPacket* pkt = create_connect_app_packet(app, tc_url, req, debug_srs_upnode);
         if ((ret = protocol->send_and_free_packet(pkt, 0)) != ERROR_SUCCESS) {
             return ret;
         }
@@ -2144,7 +2203,7 @@ int SrsRtmpClient::create_stream(int& stream_id)
     
     // CreateStream
     if (true) {
-        SrsCreateStreamPacket* pkt = new SrsCreateStreamPacket();
+        SrsTemplateCommandPacket* pkt = SrsTemplateCommandPacket::create_create_stream(2);
         if ((ret = protocol->send_and_free_packet(pkt, 0)) != ERROR_SUCCESS) {
             return ret;
         }
@@ -2172,43 +2231,26 @@ int SrsRtmpClient::play(string stream, int stream_id)
 {
     int ret = ERROR_SUCCESS;
     
-    // Play(stream)
-    if (true) {
-        SrsPlayPacket* pkt = new SrsPlayPacket();
-        pkt->stream_name = stream;
-        if ((ret = protocol->send_and_free_packet(pkt, stream_id)) != ERROR_SUCCESS) {
-            srs_error("send play stream failed. "
-                "stream=%s, stream_id=%d, ret=%d", 
-                stream.c_str(), stream_id, ret);
-            return ret;
-        }
-    }
-    
-    // SetBufferLength(1000ms)
+    // Play(stream), SetBufferLength(1000ms) and SetChunkSize,
+    // the server never response the play, so we send them in one writev
+    // to start the playback as fast as possible.
     int buffer_length_ms = 1000;
     if (true) {
-        SrsUserControlPacket* pkt = new SrsUserControlPacket();
+        SrsUserControlPacket* buffer = new SrsUserControlPacket();
+        buffer->event_type = SrcPCUCSetBufferLength;
+        buffer->event_data = stream_id;
+        buffer->extra_data = buffer_length_ms;
         
-        pkt->event_type = SrcPCUCSetBufferLength;
-        pkt->event_data = stream_id;
-        pkt->extra_data = buffer_length_ms;
+        SrsSetChunkSizePacket* chunk = new SrsSetChunkSizePacket();
+        chunk->chunk_size = SRS_CONSTS_RTMP_SRS_CHUNK_SIZE;
         
-        if ((ret = protocol->send_and_free_packet(pkt, 0)) != ERROR_SUCCESS) {
-            srs_error("send set buffer length failed. "
-                "stream=%s, stream_id=%d, bufferLength=%d, ret=%d", 
-                stream.c_str(), stream_id, buffer_length_ms, ret);
-            return ret;
-        }
-    }
-    
-    // SetChunkSize
-    if (true) {
-        SrsSetChunkSizePacket* pkt = new SrsSetChunkSizePacket();
-        pkt->chunk_size = SRS_CONSTS_RTMP_SRS_CHUNK_SIZE;
-        if ((ret = protocol->send_and_free_packet(pkt, 0)) != ERROR_SUCCESS) {
-            srs_error("send set chunk size failed. "
-                "stream=%s, chunk_size=%d, ret=%d", 
-                stream.c_str(), SRS_CONSTS_RTMP_SRS_CHUNK_SIZE, ret);
+        SrsPacket* pkts[] = {SrsTemplateCommandPacket::create_play(stream), buffer, chunk};
+        int sids[] = {stream_id, 0, 0};
+        
+        if ((ret = protocol->send_and_free_packets(pkts, sids, 3)) != ERROR_SUCCESS) {
+            srs_error("send play stream failed. "
+                "stream=%s, stream_id=%d, bufferLength=%d, chunk_size=%d, ret=%d", 
+                stream.c_str(), stream_id, buffer_length_ms, SRS_CONSTS_RTMP_SRS_CHUNK_SIZE, ret);
             return ret;
         }
     }
@@ -2234,8 +2276,7 @@ int SrsRtmpClient::publish(string stream, int stream_id)
     
     // publish(stream)
     if (true) {
-        SrsPublishPacket* pkt = new SrsPublishPacket();
-        pkt->stream_name = stream;
+        SrsTemplateCommandPacket* pkt = SrsTemplateCommandPacket::create_publish(stream);
         if ((ret = protocol->send_and_free_packet(pkt, stream_id)) != ERROR_SUCCESS) {
             srs_error("send publish message failed. "
                 "stream=%s, stream_id=%d, ret=%d", 
@@ -2255,7 +2296,7 @@ int SrsRtmpClient::fmle_publish(string stream, int& stream_id)
     
     // SrsFMLEStartPacket
     if (true) {
-        SrsFMLEStartPacket* pkt = SrsFMLEStartPacket::create_release_stream(stream);
+        SrsTemplateCommandPacket* pkt = SrsTemplateCommandPacket::create_release_stream(stream);
         if ((ret = protocol->send_and_free_packet(pkt, 0)) != ERROR_SUCCESS) {
             srs_error("send FMLE publish "
                 "release stream failed. stream=%s, ret=%d", stream.c_str(), ret);
@@ -2265,7 +2306,7 @@ int SrsRtmpClient::fmle_publish(string stream, int& stream_id)
     
     // FCPublish
     if (true) {
-        SrsFMLEStartPacket* pkt = SrsFMLEStartPacket::create_FC_publish(stream);
+        SrsTemplateCommandPacket* pkt = SrsTemplateCommandPacket::create_FC_publish(stream);
         if ((ret = protocol->send_and_free_packet(pkt, 0)) != ERROR_SUCCESS) {
             srs_error("send FMLE publish "
                 "FCPublish failed. stream=%s, ret=%d", stream.c_str(), ret);
@@ -2275,8 +2316,7 @@ int SrsRtmpClient::fmle_publish(string stream, int& stream_id)
     
     // CreateStream
     if (true) {
-        SrsCreateStreamPacket* pkt = new SrsCreateStreamPacket();
-        pkt->transaction_id = 4;
+        SrsTemplateCommandPacket* pkt = SrsTemplateCommandPacket::create_create_stream(4);
         if ((ret = protocol->send_and_free_packet(pkt, 0)) != ERROR_SUCCESS) {
             srs_error("send FMLE publish "
                 "createStream failed. stream=%s, ret=%d", stream.c_str(), ret);
@@ -2301,8 +2341,7 @@ int SrsRtmpClient::fmle_publish(string stream, int& stream_id)
     
     // publish(stream)
     if (true) {
-        SrsPublishPacket* pkt = new SrsPublishPacket();
-        pkt->stream_name = stream;
+        SrsTemplateCommandPacket* pkt = SrsTemplateCommandPacket::create_publish(stream);
         if ((ret = protocol->send_and_free_packet(pkt, stream_id)) != ERROR_SUCCESS) {
             srs_error("send FMLE publish publish failed. "
                 "stream=%s, stream_id=%d, ret=%d", stream.c_str(), stream_id, ret);
@@ -2313,6 +2352,172 @@ int SrsRtmpClient::fmle_publish(string stream, int& stream_id)
     return ret;
 }
 
+int SrsRtmpClient::pipeline_play(
+    string app, string tc_url, SrsRequest* req, bool debug_srs_upnode,
+    string stream, int& stream_id
+) {
+    int ret = ERROR_SUCCESS;
+    
+    // the createStream always response the first stream id 1,
+    // so we play on it before got the response.
+    stream_id = 1;
+    
+    // Connect, SetWindowAckSize, CreateStream, Play, SetBufferLength and SetChunkSize,
+    // the SetChunkSize must be the last one, for it applies after sent.
+    if (true) {
+        SrsSetWindowAckSizePacket* ack = new SrsSetWindowAckSizePacket();
+        ack->ackowledgement_window_size = 2500000;
+        
+        SrsUserControlPacket* buffer = new SrsUserControlPacket();
+        buffer->event_type = SrcPCUCSetBufferLength;
+        buffer->event_data = stream_id;
+        buffer->extra_data = 1000;
+        
+        SrsSetChunkSizePacket* chunk = new SrsSetChunkSizePacket();
+        chunk->chunk_size = SRS_CONSTS_RTMP_SRS_CHUNK_SIZE;
+        
+        SrsPacket* pkts[] = {
+            create_connect_app_packet(app, tc_url, req, debug_srs_upnode), ack,
+            SrsTemplateCommandPacket::create_create_stream(2),
+            SrsTemplateCommandPacket::create_play(stream), buffer, chunk
+        };
+        int sids[] = {0, 0, 0, stream_id, 0, 0};
+        
+        if ((ret = protocol->send_and_free_packets(pkts, sids, 6)) != ERROR_SUCCESS) {
+            srs_error("send pipelined play failed. stream=%s, ret=%d", stream.c_str(), ret);
+            return ret;
+        }
+    }
+    
+    // expect connect _result
+    if (true) {
+        SrsCommonMessage* msg = NULL;
+        SrsConnectAppResPacket* pkt = NULL;
+        if ((ret = expect_message<SrsConnectAppResPacket>(&msg, &pkt)) != ERROR_SUCCESS) {
+            srs_error("expect connect app response message failed. ret=%d", ret);
+            return ret;
+        }
+        SrsAutoFree(SrsCommonMessage, msg);
+        SrsAutoFree(SrsConnectAppResPacket, pkt);
+        srs_info("get connect app response message");
+    }
+    
+    // CreateStream _result.
+    int guess_stream_id = stream_id;
+    if ((ret = expect_create_stream_result(stream_id)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // the stream id we guess is wrong, the play is sent on the wrong stream,
+    // and play again will send duplicated commands, so fail for user to fallback.
+    if (stream_id != guess_stream_id) {
+        ret = ERROR_RTMP_PIPELINE_STREAM_ID;
+        srs_error("pipelined play stream id %d, actual %d. ret=%d", guess_stream_id, stream_id, ret);
+        return ret;
+    }
+    
+    return ret;
+}
+
+int SrsRtmpClient::pipeline_publish(
+    string app, string tc_url, SrsRequest* req, bool debug_srs_upnode,
+    string stream, int& stream_id
+) {
+    int ret = ERROR_SUCCESS;
+    
+    // the createStream always response the first stream id 1,
+    // so we publish on it before got the response.
+    stream_id = 1;
+    
+    // Connect, SetWindowAckSize, releaseStream, FCPublish, CreateStream and publish.
+    if (true) {
+        SrsSetWindowAckSizePacket* ack = new SrsSetWindowAckSizePacket();
+        ack->ackowledgement_window_size = 2500000;
+        
+        SrsPacket* pkts[] = {
+            create_connect_app_packet(app, tc_url, req, debug_srs_upnode), ack,
+            SrsTemplateCommandPacket::create_release_stream(stream),
+            SrsTemplateCommandPacket::create_FC_publish(stream),
+            SrsTemplateCommandPacket::create_create_stream(4),
+            SrsTemplateCommandPacket::create_publish(stream)
+        };
+        int sids[] = {0, 0, 0, 0, 0, stream_id};
+        
+        if ((ret = protocol->send_and_free_packets(pkts, sids, 6)) != ERROR_SUCCESS) {
+            srs_error("send pipelined publish failed. stream=%s, ret=%d", stream.c_str(), ret);
+            return ret;
+        }
+    }
+    
+    // expect connect _result
+    if (true) {
+        SrsCommonMessage* msg = NULL;
+        SrsConnectAppResPacket* pkt = NULL;
+        if ((ret = expect_message<SrsConnectAppResPacket>(&msg, &pkt)) != ERROR_SUCCESS) {
+            srs_error("expect connect app response message failed. ret=%d", ret);
+            return ret;
+        }
+        SrsAutoFree(SrsCommonMessage, msg);
+        SrsAutoFree(SrsConnectAppResPacket, pkt);
+        srs_info("get connect app response message");
+    }
+    
+    // expect result of CreateStream
+    int guess_stream_id = stream_id;
+    if ((ret = expect_create_stream_result(stream_id)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // the stream id we guess is wrong, @see pipeline_play.
+    if (stream_id != guess_stream_id) {
+        ret = ERROR_RTMP_PIPELINE_STREAM_ID;
+        srs_error("pipelined publish stream id %d, actual %d. ret=%d", guess_stream_id, stream_id, ret);
+        return ret;
+    }
+    
+    return ret;
+}
+
+SrsTemplateCommandPacket* SrsRtmpClient::create_connect_app_packet(
+    string app, string tc_url, SrsRequest* req, bool debug_srs_upnode
+) {
+    std::string swf_url = req? req->swfUrl : "";
+    std::string page_url = req? req->pageUrl : "";
+    if (req && req->tcUrl != "") {
+        tc_url = req->tcUrl;
+    }
+    
+    // @see https://github.com/ossrs/srs/issues/160
+    // the debug_srs_upnode is config in vhost and default to true.
+    SrsAmf0Object* args = NULL;
+    if (debug_srs_upnode && req && req->args) {
+        args = req->args->copy()->to_object();
+    }
+    
+    // encode from the pre-serialized template, for the connect is sent
+    // for each client, only the app and urls are changed.
+    return SrsTemplateCommandPacket::create_connect_app(app, tc_url, swf_url, page_url, args);
+}
+
+int SrsRtmpClient::expect_create_stream_result(int& stream_id)
+{
+    int ret = ERROR_SUCCESS;
+    
+    SrsCommonMessage* msg = NULL;
+    SrsCreateStreamResPacket* pkt = NULL;
+    if ((ret = expect_message<SrsCreateStreamResPacket>(&msg, &pkt)) != ERROR_SUCCESS) {
+        srs_error("expect create stream response message failed. ret=%d", ret);
+        return ret;
+    }
+    SrsAutoFree(SrsCommonMessage, msg);
+    SrsAutoFree(SrsCreateStreamResPacket, pkt);
+    srs_info("get create stream response message");
+    
+    stream_id = (int)pkt->stream_id;
+    
+    return ret;
+}
+
 SrsRtmpServer::SrsRtmpServer(ISrsProtocolReaderWriter* skt)
 {
     io = skt;
@@ -3348,6 +3553,197 @@ int SrsConnectAppResPacket::encode_packet(SrsStream* stream)
     return ret;
 }
 
+/**
+* build the amf0 templates of client commands,
+* the template starts with the command name and the transaction id field.
+*/
+static SrsAmf0Template* srs_amf0_command_template(const char* command_name)
+{
+    SrsAmf0Template* tmpl = new SrsAmf0Template();
+    
+    tmpl->append(SrsAmf0Any::str(command_name));
+    tmpl->append_number_field();
+    
+    return tmpl;
+}
+
+static SrsAmf0Template* srs_amf0_connect_app_template()
+{
+    SrsAmf0Template* tmpl = srs_amf0_command_template(RTMP_AMF0_COMMAND_CONNECT);
+    
+    tmpl->append_object_start();
+    tmpl->append_property_name("app");
+    tmpl->append_string_field();
+    tmpl->append_property_name("flashVer");
+    tmpl->append(SrsAmf0Any::str("WIN 15,0,0,239"));
+    tmpl->append_property_name("swfUrl");
+    tmpl->append_string_field();
+    tmpl->append_property_name("tcUrl");
+    tmpl->append_string_field();
+    tmpl->append_property_name("fpad");
+    tmpl->append(SrsAmf0Any::boolean(false));
+    tmpl->append_property_name("capabilities");
+    tmpl->append(SrsAmf0Any::number(239));
+    tmpl->append_property_name("audioCodecs");
+    tmpl->append(SrsAmf0Any::number(3575));
+    tmpl->append_property_name("videoCodecs");
+    tmpl->append(SrsAmf0Any::number(252));
+    tmpl->append_property_name("videoFunction");
+    tmpl->append(SrsAmf0Any::number(1));
+    tmpl->append_property_name("pageUrl");
+    tmpl->append_string_field();
+    tmpl->append_property_name("objectEncoding");
+    tmpl->append(SrsAmf0Any::number(0));
+    tmpl->append_object_eof();
+    
+    return tmpl;
+}
+
+static SrsAmf0Template* srs_amf0_create_stream_template()
+{
+    SrsAmf0Template* tmpl = srs_amf0_command_template(RTMP_AMF0_COMMAND_CREATE_STREAM);
+    tmpl->append(SrsAmf0Any::null());
+    return tmpl;
+}
+
+static SrsAmf0Template* srs_amf0_stream_command_template(const char* command_name)
+{
+    SrsAmf0Template* tmpl = srs_amf0_command_template(command_name);
+    tmpl->append(SrsAmf0Any::null());
+    tmpl->append_string_field();
+    return tmpl;
+}
+
+static SrsAmf0Template* srs_amf0_publish_template()
+{
+    SrsAmf0Template* tmpl = srs_amf0_stream_command_template(RTMP_AMF0_COMMAND_PUBLISH);
+    tmpl->append(SrsAmf0Any::str("live"));
+    return tmpl;
+}
+
+SrsTemplateCommandPacket::SrsTemplateCommandPacket(SrsAmf0Template* t, string name, double tid, int cid)
+{
+    tmpl = t;
+    command_name = name;
+    transaction_id = tid;
+    prefer_cid = cid;
+    // optional
+    args = NULL;
+}
+
+SrsTemplateCommandPacket::~SrsTemplateCommandPacket()
+{
+    srs_freep(args);
+}
+
+SrsTemplateCommandPacket* SrsTemplateCommandPacket::create_connect_app(
+    string app, string tc_url, string swf_url, string page_url, SrsAmf0Object* args
+) {
+    // the templates are built once, and shared by all packets.
+    static SrsAmf0Template* tmpl = srs_amf0_connect_app_template();
+    
+    SrsTemplateCommandPacket* pkt = new SrsTemplateCommandPacket(
+        tmpl, RTMP_AMF0_COMMAND_CONNECT, 1, RTMP_CID_OverConnection);
+    pkt->strings.push_back(app);
+    pkt->strings.push_back(swf_url);
+    pkt->strings.push_back(tc_url);
+    pkt->strings.push_back(page_url);
+    pkt->args = args;
+    return pkt;
+}
+
+SrsTemplateCommandPacket* SrsTemplateCommandPacket::create_create_stream(double transaction_id)
+{
+    static SrsAmf0Template* tmpl = srs_amf0_create_stream_template();
+    
+    return new SrsTemplateCommandPacket(
+        tmpl, RTMP_AMF0_COMMAND_CREATE_STREAM, transaction_id, RTMP_CID_OverConnection);
+}
+
+SrsTemplateCommandPacket* SrsTemplateCommandPacket::create_play(string stream)
+{
+    static SrsAmf0Template* tmpl = srs_amf0_stream_command_template(RTMP_AMF0_COMMAND_PLAY);
+    
+    SrsTemplateCommandPacket* pkt = new SrsTemplateCommandPacket(
+        tmpl, RTMP_AMF0_COMMAND_PLAY, 0, RTMP_CID_OverStream);
+    pkt->strings.push_back(stream);
+    return pkt;
+}
+
+SrsTemplateCommandPacket* SrsTemplateCommandPacket::create_publish(string stream)
+{
+    static SrsAmf0Template* tmpl = srs_amf0_publish_template();
+    
+    SrsTemplateCommandPacket* pkt = new SrsTemplateCommandPacket(
+        tmpl, RTMP_AMF0_COMMAND_PUBLISH, 0, RTMP_CID_OverStream);
+    pkt->strings.push_back(stream);
+    return pkt;
+}
+
+SrsTemplateCommandPacket* SrsTemplateCommandPacket::create_release_stream(string stream)
+{
+    static SrsAmf0Template* tmpl = srs_amf0_stream_command_template(RTMP_AMF0_COMMAND_RELEASE_STREAM);
+    
+    SrsTemplateCommandPacket* pkt = new SrsTemplateCommandPacket(
+        tmpl, RTMP_AMF0_COMMAND_RELEASE_STREAM, 2, RTMP_CID_OverConnection);
+    pkt->strings.push_back(stream);
+    return pkt;
+}
+
+SrsTemplateCommandPacket* SrsTemplateCommandPacket::create_FC_publish(string stream)
+{
+    static SrsAmf0Template* tmpl = srs_amf0_stream_command_template(RTMP_AMF0_COMMAND_FC_PUBLISH);
+    
+    SrsTemplateCommandPacket* pkt = new SrsTemplateCommandPacket(
+        tmpl, RTMP_AMF0_COMMAND_FC_PUBLISH, 3, RTMP_CID_OverConnection);
+    pkt->strings.push_back(stream);
+    return pkt;
+}
+
+int SrsTemplateCommandPacket::get_prefer_cid()
+{
+    return prefer_cid;
+}
+
+int SrsTemplateCommandPacket::get_message_type()
+{
+    return RTMP_MSG_AMF0CommandMessage;
+}
+
+int SrsTemplateCommandPacket::get_size()
+{
+    int size = tmpl->total_size(strings.empty()? NULL : &strings[0]);
+    
+    if (args) {
+        size += SrsAmf0Size::object(args);
+    }
+    
+    return size;
+}
+
+int SrsTemplateCommandPacket::encode_packet(SrsStream* stream)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert((int)strings.size() == tmpl->nb_strings());
+    
+    if ((ret = tmpl->write(stream, &transaction_id, strings.empty()? NULL : &strings[0])) != ERROR_SUCCESS) {
+        srs_error("encode command template failed. command=%s, ret=%d", command_name.c_str(), ret);
+        return ret;
+    }
+    srs_verbose("encode command template success.");
+    
+    if (args && (ret = args->write(stream)) != ERROR_SUCCESS) {
+        srs_error("encode args failed. ret=%d", ret);
+        return ret;
+    }
+    srs_verbose("encode args success.");
+    
+    srs_info("encode %s command packet success.", command_name.c_str());
+    
+    return ret;
+}
+
 SrsCallPacket::SrsCallPacket()
 {
     command_name = "";
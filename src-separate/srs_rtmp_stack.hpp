@@ -65,9 +65,11 @@ class SrsFMLEStartPacket;
 class SrsPublishPacket;
 class SrsOnMetaDataPacket;
 class SrsPlayPacket;
+class SrsTemplateCommandPacket;
 class SrsCommonMessage;
 class SrsPacket;
 class SrsAmf0Object;
+class SrsAmf0Template;
 class IMergeReadHandler;
 
 /****************************************************************************
@@ -363,6 +365,18 @@ public:
     * @param stream_id, the stream id of packet to send over, 0 for control message.
     */
     virtual int send_and_free_packet(SrsPacket* packet, int stream_id);
+    /**
+    * send the RTMP packets in one writev and always free them,
+    * for example, the client pipelines the commands without waiting for responses.
+    * user must never free or use the packets after this method,
+    * for it will always free the packets.
+    * @param packets, the packets to send out, never be NULL.
+    * @param stream_ids, the stream id of each packet to send over, 0 for control message.
+    * @param nb_packets, the size of packets and stream_ids.
+    * @remark the chunk size is applied after all packets sent, so the
+    *       set chunk size packet should be the last one.
+    */
+    virtual int send_and_free_packets(SrsPacket** packets, int* stream_ids, int nb_packets);
 public:
     /**
      * expect a specified message, drop others util got specified one.
@@ -779,6 +793,39 @@ public:
      *       connect-app => FMLE publish
      */
     virtual int fmle_publish(std::string stream, int& stream_id);
+    /**
+     * pipelined session start, send the connect, createStream and play in
+     * one writev without waiting for each response, then validate the
+     * responses in order. the stream id of play is guessed to 1, which is
+     * the first stream of connection.
+     * @return ERROR_RTMP_PIPELINE_STREAM_ID when server returns another stream id,
+     *       the play is sent on the wrong stream, so user should reconnect and
+     *       use the connect_app then play, never play again on this connection.
+     * @remark the srs debug info of connect response is ignored.
+     */
+    virtual int pipeline_play(
+        std::string app, std::string tc_url, SrsRequest* req, bool debug_srs_upnode,
+        std::string stream, int& stream_id
+    );
+    /**
+     * pipelined session start, send the connect and FMLE publish in one writev,
+     * @see pipeline_play.
+     */
+    virtual int pipeline_publish(
+        std::string app, std::string tc_url, SrsRequest* req, bool debug_srs_upnode,
+        std::string stream, int& stream_id
+    );
+private:
+    /**
+     * create the connect packet, use the swfUrl/pageUrl/tcUrl/args of req if specified.
+     */
+    virtual SrsTemplateCommandPacket* create_connect_app_packet(
+        std::string app, std::string tc_url, SrsRequest* req, bool debug_srs_upnode
+    );
+    /**
+     * expect the createStream _result, output the stream id.
+     */
+    virtual int expect_create_stream_result(int& stream_id);
 public:
     /**
      * expect a specified message, drop others util got specified one.
@@ -1101,6 +1148,78 @@ protected:
     virtual int encode_packet(SrsStream* stream);
 };
 
+/**
+* the client command packet, encoded from the pre-serialized amf0 template,
+* which is built once for the command, and only the transaction id and the
+* variable strings(app, tcUrl, stream name etc.) are patched in when encode.
+* @remark only for client to send the connect/createStream/play/publish etc,
+*       the server never decode it, use the concrete packets to decode.
+*/
+class SrsTemplateCommandPacket : public SrsPacket
+{
+public:
+    /**
+    * Name of the command, for the protocol to track the response.
+    */
+    std::string command_name;
+    /**
+    * Transaction ID of the command, 0 when no response.
+    */
+    double transaction_id;
+    /**
+    * the value of string fields of template, in order.
+    */
+    std::vector<std::string> strings;
+    /**
+    * Any optional information, encode after the template.
+    * @remark, optional, user must set it to NULL when not exists.
+    */
+    SrsAmf0Object* args;
+private:
+    // the shared template, never free it.
+    SrsAmf0Template* tmpl;
+    int prefer_cid;
+private:
+    SrsTemplateCommandPacket(SrsAmf0Template* t, std::string name, double tid, int cid);
+public:
+    virtual ~SrsTemplateCommandPacket();
+public:
+    /**
+    * create the connect app command, the same to SrsConnectAppPacket,
+    * with object(app, flashVer, swfUrl, tcUrl, fpad, capabilities, audioCodecs,
+    * videoCodecs, videoFunction, pageUrl, objectEncoding).
+    * @param args the optional args, the packet will free it, NULL to ignore.
+    */
+    static SrsTemplateCommandPacket* create_connect_app(
+        std::string app, std::string tc_url, std::string swf_url, std::string page_url,
+        SrsAmf0Object* args
+    );
+    /**
+    * create the createStream command, the same to SrsCreateStreamPacket.
+    */
+    static SrsTemplateCommandPacket* create_create_stream(double transaction_id);
+    /**
+    * create the play command, the same to SrsPlayPacket without start/duration/reset.
+    */
+    static SrsTemplateCommandPacket* create_play(std::string stream);
+    /**
+    * create the publish command, the same to SrsPublishPacket with type live.
+    */
+    static SrsTemplateCommandPacket* create_publish(std::string stream);
+    /**
+    * create the FMLE start commands, the same to SrsFMLEStartPacket.
+    */
+    static SrsTemplateCommandPacket* create_release_stream(std::string stream);
+    static SrsTemplateCommandPacket* create_FC_publish(std::string stream);
+// encode functions for concrete packet to override.
+public:
+    virtual int get_prefer_cid();
+    virtual int get_message_type();
+protected:
+    virtual int get_size();
+    virtual int encode_packet(SrsStream* stream);
+};
+
 /**
 * 4.1.2. Call
 * The call method of the NetConnection object runs remote procedure
@@ -92,7 +92,7 @@ rudeb0t<nimrod@themanxgroup.tw> \
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -122,19 +122,19 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 // current release version
 #define VERSION_MAJOR       2
 #define VERSION_MINOR       0
-#define VERSION_REVISION    184
+#define VERSION_REVISION    201
 
 // server info.
 #define RTMP_SIG_SRS_KEY "SRS"
 #define RTMP_SIG_SRS_CODE "ZhouGuowen"
 #define RTMP_SIG_SRS_ROLE "origin/edge server"
 #define RTMP_SIG_SRS_NAME RTMP_SIG_SRS_KEY"(Simple RTMP Server)"
-#define RTMP_SIG_SRS_URL_SHORT "github.com/simple-rtmp-server/srs"
+#define RTMP_SIG_SRS_URL_SHORT "github.com/ossrs/srs"
 #define RTMP_SIG_SRS_URL "https://"RTMP_SIG_SRS_URL_SHORT
 #define RTMP_SIG_SRS_WEB "http://ossrs.net"
 #define RTMP_SIG_SRS_EMAIL "winlin@vip.126.com"
 #define RTMP_SIG_SRS_LICENSE "The MIT License (MIT)"
-#define RTMP_SIG_SRS_COPYRIGHT "Copyright (c) 2013-2015 SRS(simple-rtmp-server)"
+#define RTMP_SIG_SRS_COPYRIGHT "Copyright (c) 2013-2015 SRS(ossrs)"
 #define RTMP_SIG_SRS_PRIMARY "SRS/"VERSION_STABLE_BRANCH
 #define RTMP_SIG_SRS_AUTHROS "winlin,wenjie.zhao"
 #define RTMP_SIG_SRS_CONTRIBUTORS_URL RTMP_SIG_SRS_URL"/blob/master/AUTHORS.txt"
@@ -170,7 +170,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
     #define __STDC_FORMAT_MACROS
 #endif
 
-// for srs-librtmp, @see https://github.com/simple-rtmp-server/srs/issues/213
+// for srs-librtmp, @see https://github.com/ossrs/srs/issues/213
 #ifndef _WIN32
 #include <inttypes.h>
 #endif
@@ -194,9 +194,14 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
         p = NULL; \
     } \
     (void)0
-// sometimes, the freepa is useless,
-// it's recomments to free each elem explicit.
-// so we remove the srs_freepa utility.
+// please use the freepa(T[]) to free an array,
+// or the behavior is undefined.
+#define srs_freepa(pa) \
+    if (pa) { \
+        delete[] pa; \
+        pa = NULL; \
+    } \
+    (void)0
 
 /**
 * disable copy constructor of class,
@@ -216,7 +221,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -246,28 +251,41 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //#include <srs_core.hpp>
 
 /**
-* auto free the instance in the current scope, for instance, MyClass* ptr,
-* which is a ptr and this class will:
-*       1. free the ptr.
-*       2. set ptr to NULL.
-* Usage:
-*       MyClass* po = new MyClass();
-*       // ...... use po
-*       SrsAutoFree(MyClass, po);
-*/
+ * auto free the instance in the current scope, for instance, MyClass* ptr,
+ * which is a ptr and this class will:
+ *       1. free the ptr.
+ *       2. set ptr to NULL.
+ *
+ * Usage:
+ *       MyClass* po = new MyClass();
+ *       // ...... use po
+ *       SrsAutoFree(MyClass, po);
+ *
+ * Usage for array:
+ *      MyClass** pa = new MyClass*[size];
+ *      // ....... use pa
+ *      SrsAutoFreeA(MyClass*, pa);
+ *
+ * @remark the MyClass can be basic type, for instance, SrsAutoFreeA(char, pstr),
+ *      where the char* pstr = new char[size].
+ */
 #define SrsAutoFree(className, instance) \
-    impl__SrsAutoFree<className> _auto_free_##instance(&instance)
+impl__SrsAutoFree<className> _auto_free_##instance(&instance, false)
+#define SrsAutoFreeA(className, instance) \
+impl__SrsAutoFree<className> _auto_free_array_##instance(&instance, true)
 template<class T>
 class impl__SrsAutoFree
 {
 private:
     T** ptr;
+    bool is_array;
 public:
     /**
-    * auto delete the ptr.
-    */
-    impl__SrsAutoFree(T** p) {
+     * auto delete the ptr.
+     */
+    impl__SrsAutoFree(T** p, bool array) {
         ptr = p;
+        is_array = array;
     }
     
     virtual ~impl__SrsAutoFree() {
@@ -275,7 +293,11 @@ public:
             return;
         }
         
-        delete *ptr;
+        if (is_array) {
+            delete[] *ptr;
+        } else {
+            delete *ptr;
+        }
         
         *ptr = NULL;
     }
@@ -286,7 +308,7 @@ public:
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -325,12 +347,12 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 * that is, we merge some data to read together.
 * @see SrsConfig::get_mr_enabled()
 * @see SrsConfig::get_mr_sleep_ms()
-* @see https://github.com/simple-rtmp-server/srs/issues/241
+* @see https://github.com/ossrs/srs/issues/241
 * @example, for the default settings, this algorithm will use:
 *       that is, when got nread bytes smaller than 4KB, sleep(780ms).
 */
 /**
-* https://github.com/simple-rtmp-server/srs/issues/241#issuecomment-65554690
+* https://github.com/ossrs/srs/issues/241#issuecomment-65554690
 * The merged read algorithm is ok and can be simplified for:
 *   1. Suppose the client network is ok. All algorithm go wrong when netowrk is not ok.
 *   2. Suppose the client send each packet one by one. Although send some together, it's same.
@@ -356,7 +378,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 * @remark this largely improve performance, from 3.5k+ to 7.5k+.
 *       the latency+ when cache+.
 * @remark the socket send buffer default to 185KB, it large enough.
-* @see https://github.com/simple-rtmp-server/srs/issues/194
+* @see https://github.com/ossrs/srs/issues/194
 * @see SrsConfig::get_mw_sleep_ms()
 * @remark the mw sleep and msgs to send, maybe:
 *       mw_sleep        msgs        iovs
@@ -391,24 +413,24 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 /**
 * whether set the socket send buffer size.
-* @see https://github.com/simple-rtmp-server/srs/issues/251
+* @see https://github.com/ossrs/srs/issues/251
 */
 #define SRS_PERF_MW_SO_SNDBUF
 
 /**
 * whether set the socket recv buffer size.
-* @see https://github.com/simple-rtmp-server/srs/issues/251
+* @see https://github.com/ossrs/srs/issues/251
 */
 #undef SRS_PERF_MW_SO_RCVBUF
 /**
 * whether enable the fast vector for qeueue.
-* @see https://github.com/simple-rtmp-server/srs/issues/251
+* @see https://github.com/ossrs/srs/issues/251
 */
 #define SRS_PERF_QUEUE_FAST_VECTOR
 /**
 * whether use cond wait to send messages.
 * @remark this improve performance for large connectios.
-* @see https://github.com/simple-rtmp-server/srs/issues/251
+* @see https://github.com/ossrs/srs/issues/251
 */
 #define SRS_PERF_QUEUE_COND_WAIT
 #ifdef SRS_PERF_QUEUE_COND_WAIT
@@ -420,14 +442,14 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 * for min latence mode:
 * 1. disable the mr for vhost.
 * 2. use timeout for cond wait for consumer queue.
-* @see https://github.com/simple-rtmp-server/srs/issues/257
+* @see https://github.com/ossrs/srs/issues/257
 */
 #define SRS_PERF_MIN_LATENCY_ENABLED false
 
 /**
 * how many chunk stream to cache, [0, N].
 * to imporove about 10% performance when chunk size small, and 5% for large chunk.
-* @see https://github.com/simple-rtmp-server/srs/issues/249
+* @see https://github.com/ossrs/srs/issues/249
 * @remark 0 to disable the chunk stream cache.
 */
 #define SRS_PERF_CHUNK_STREAM_CACHE 16
@@ -443,21 +465,21 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 /**
 * whether always use complex send algorithm.
 * for some network does not support the complex send,
-* @see https://github.com/simple-rtmp-server/srs/issues/320
+* @see https://github.com/ossrs/srs/issues/320
 */
 //#undef SRS_PERF_COMPLEX_SEND
 #define SRS_PERF_COMPLEX_SEND
 /**
  * whether enable the TCP_NODELAY
  * user maybe need send small tcp packet for some network.
- * @see https://github.com/simple-rtmp-server/srs/issues/320
+ * @see https://github.com/ossrs/srs/issues/320
  */
 #undef SRS_PERF_TCP_NODELAY
 #define SRS_PERF_TCP_NODELAY
 /**
 * set the socket send buffer,
 * to force the server to send smaller tcp packet.
-* @see https://github.com/simple-rtmp-server/srs/issues/320
+* @see https://github.com/ossrs/srs/issues/320
 * @remark undef it to auto calc it by merged write sleep ms.
 * @remark only apply it when SRS_PERF_MW_SO_SNDBUF is defined.
 */
@@ -466,9 +488,63 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
     #undef SRS_PERF_SO_SNDBUF_SIZE
 #endif
 
+/**
+* the read ahead buffer size of file reader, to reduce the read syscalls,
+* for the flv decoder reads the tag header, data and previous tag size one by one.
+* @remark 0 to disable the read ahead buffer.
+*/
+#define SRS_PERF_FILE_READ_BUFFER 131072
+
+/**
+* the write behind buffer size of file writer, to group the small writes
+* of flv/ts/aac/mp3 encoders into one writev syscall.
+* @remark 0 to disable the write behind buffer.
+*/
+#define SRS_PERF_FILE_WRITE_BUFFER 65536
+
+/**
+* the async file writer queues the buffers to the shared write threads,
+* so the disk stall never blocks the caller, for example, the rtmp recorder.
+* the threads of pool to write the files of all async writers.
+* the max inflight buffers of each writer, the backpressure when exceed.
+*/
+#define SRS_PERF_FILE_WRITE_THREADS 2
+#define SRS_PERF_FILE_WRITE_INFLIGHT 16
+
+/**
+* the min bytes of each chunk for the flv scanner threads,
+* the small file is scanned by less threads.
+*/
+#define SRS_PERF_FLV_SCAN_CHUNK 4194304
+
+/**
+* the ts packets of PES to write by one writev, the headers of packets are
+* written to a reused buffer, the payload is sent from message without copy.
+* @remark each packet use 2 iovs, so it must less than IOV_MAX/2.
+*/
+#define SRS_PERF_TS_WRITEV_PACKETS 64
+
+/**
+* the udp ts writer sends 7 ts packets(1316 bytes) in a datagram,
+* the datagrams due are sent by one sendmmsg, at most the batch.
+* the max inflight datagrams of writer, the backpressure when exceed.
+* the delay in ms of the paced stream, to stuff the null packets before
+* the next PCR in time, it should larger than the PCR interval.
+*/
+#define SRS_PERF_TS_UDP_PACKETS 7
+#define SRS_PERF_TS_UDP_BATCH 32
+#define SRS_PERF_TS_UDP_INFLIGHT 1024
+#define SRS_PERF_TS_UDP_DELAY 200
+
+/**
+* the initial window of flv repairer to resync the tags,
+* which grows to the size of the largest tag.
+*/
+#define SRS_PERF_FLV_REPAIR_BUFFER 1048576
+
 /**
  * define the following macro to enable the fast flv encoder.
- * @see https://github.com/simple-rtmp-server/srs/issues/405
+ * @see https://github.com/ossrs/srs/issues/405
  */
 #undef SRS_PERF_FAST_FLV_ENCODER
 #define SRS_PERF_FAST_FLV_ENCODER
@@ -479,7 +555,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -529,7 +605,7 @@ extern void srs_memory_report();
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -558,7 +634,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 //#include <srs_core.hpp>
 
-// for srs-librtmp, @see https://github.com/simple-rtmp-server/srs/issues/213
+// for srs-librtmp, @see https://github.com/ossrs/srs/issues/213
 #ifndef _WIN32
 #define ERROR_SUCCESS                       0
 #endif
@@ -625,13 +701,15 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define ERROR_SYSTEM_DIR_EXISTS             1056
 #define ERROR_SYSTEM_CREATE_DIR             1057
 #define ERROR_SYSTEM_KILL                   1058
+#define ERROR_SYSTEM_FILE_BUSY              1059
+#define ERROR_SYSTEM_CREATE_THREAD          1060
 
 ///////////////////////////////////////////////////////
 // RTMP protocol error.
 ///////////////////////////////////////////////////////
 #define ERROR_RTMP_PLAIN_REQUIRED           2000
 #define ERROR_RTMP_CHUNK_START              2001
-#define ERROR_RTMP_MSG_INVLIAD_SIZE         2002
+#define ERROR_RTMP_MSG_INVALID_SIZE         2002
 #define ERROR_RTMP_AMF0_DECODE              2003
 #define ERROR_RTMP_AMF0_INVALID             2004
 #define ERROR_RTMP_REQ_CONNECT              2005
@@ -678,6 +756,8 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define ERROR_RTP_TYPE97_CORRUPT            2046
 #define ERROR_RTSP_AUDIO_CONFIG             2047
 #define ERROR_RTMP_STREAM_NOT_FOUND         2048
+#define ERROR_RTMP_CLIENT_NOT_FOUND         2049
+#define ERROR_RTMP_PIPELINE_STREAM_ID       2050
 //                                           
 // system control message, 
 // not an error, but special control logic.
@@ -697,7 +777,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define ERROR_HLS_AAC_FRAME_LENGTH          3005
 #define ERROR_HLS_AVC_SAMPLE_SIZE           3006
 #define ERROR_HTTP_PARSE_URI                3007
-#define ERROR_HTTP_DATA_INVLIAD             3008
+#define ERROR_HTTP_DATA_INVALID             3008
 #define ERROR_HTTP_PARSE_HEADER             3009
 #define ERROR_HTTP_HANDLER_MATCH_URL        3010
 #define ERROR_HTTP_HANDLER_INVALID          3011
@@ -756,6 +836,14 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define ERROR_RESPONSE_CODE                 3064
 #define ERROR_RESPONSE_DATA                 3065
 #define ERROR_REQUEST_DATA                  3066
+#define ERROR_KERNEL_FLV_INDEX              3067
+#define ERROR_KERNEL_TS_PROGRAM             3068
+#define ERROR_HEVC_DECODE_ERROR             3069
+#define ERROR_HLS_PART_AFTER_WRITE          3070
+#define ERROR_HEVC_DROP_BEFORE_VPS_SPS_PPS  3071
+#define ERROR_HEVC_DUPLICATED_VPS           3072
+#define ERROR_HEVC_DUPLICATED_SPS           3073
+#define ERROR_HEVC_DUPLICATED_PPS           3074
 
 ///////////////////////////////////////////////////////
 // HTTP/StreamCaster protocol error.
@@ -765,7 +853,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define ERROR_HTTP_URL_NOT_CLEAN            4002
 #define ERROR_HTTP_CONTENT_LENGTH           4003
 #define ERROR_HTTP_LIVE_STREAM_EXT          4004
-#define ERROR_HTTP_STATUS_INVLIAD           4005
+#define ERROR_HTTP_STATUS_INVALID           4005
 #define ERROR_KERNEL_AAC_STREAM_CLOSED      4006
 #define ERROR_AAC_DECODE_ERROR              4007
 #define ERROR_KERNEL_MP3_STREAM_CLOSED      4008
@@ -790,6 +878,14 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define ERROR_AVC_NALU_UEV                  4027
 #define ERROR_AAC_BYTES_INVALID             4028
 #define ERROR_HTTP_REQUEST_EOF              4029
+#define ERROR_KERNEL_MP4_STREAM_CLOSED      4030
+#define ERROR_HTTP_ZERO_COPY_UNSUPPORTED    4031
+#define ERROR_KERNEL_MP4_TRACK_LATE         4032
+
+///////////////////////////////////////////////////////
+// HTTP API error.
+///////////////////////////////////////////////////////
+//#define ERROR_API_METHOD_NOT_ALLOWD
 
 ///////////////////////////////////////////////////////
 // user-define error.
@@ -825,7 +921,7 @@ extern bool srs_is_client_gracefully_close(int error_code);
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -919,6 +1015,13 @@ public:
     virtual void error(const char* tag, int context_id, const char* fmt, ...);
 };
 
+/**
+ * the context id manager to identify context, for instance, the green-thread.
+ * usage:
+ *      _srs_context->generate_id(); // when thread start.
+ *      _srs_context->get_id(); // get current generated id.
+ *      int old_id = _srs_context->set_id(1000); // set context id if need to merge thread context.
+ */
 // the context for multiple clients.
 class ISrsThreadContext
 {
@@ -926,8 +1029,19 @@ public:
     ISrsThreadContext();
     virtual ~ISrsThreadContext();
 public:
+    /**
+     * generate the id for current context.
+     */
     virtual int generate_id();
+    /**
+     * get the generated id of current context.
+     */
     virtual int get_id();
+    /**
+     * set the id of current context.
+     * @return the previous id value; 0 if no context.
+     */
+    virtual int set_id(int v);
 };
 
 // user must provides a log object
@@ -979,7 +1093,7 @@ extern ISrsThreadContext* _srs_context;
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -1157,7 +1271,7 @@ public:
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -1223,6 +1337,7 @@ extern std::string srs_string_remove(std::string str, std::string remove_chars);
 extern bool srs_string_ends_with(std::string str, std::string flag);
 // whether string starts with
 extern bool srs_string_starts_with(std::string str, std::string flag);
+extern bool srs_string_starts_with(std::string str, std::string flag0, std::string flag1);
 // whether string contains with
 extern bool srs_string_contains(std::string str, std::string flag);
 
@@ -1323,7 +1438,7 @@ extern int srs_chunk_header_c3(
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -1352,8 +1467,9 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //#include <srs_core.hpp>
 
 #include <string>
+#include <vector>
 
-// for srs-librtmp, @see https://github.com/simple-rtmp-server/srs/issues/213
+// for srs-librtmp, @see https://github.com/ossrs/srs/issues/213
 #ifndef _WIN32
 #include <sys/uio.h>
 #endif
@@ -1653,7 +1769,7 @@ class SrsSharedPtrMessage
     // 4.1. Message Header
 public:
     // the header can shared, only set the timestamp and stream id.
-    // @see https://github.com/simple-rtmp-server/srs/issues/251
+    // @see https://github.com/ossrs/srs/issues/251
     //SrsSharedMessageHeader header;
     /**
      * Four-byte field that contains a timestamp of the message.
@@ -1688,7 +1804,7 @@ private:
     {
     public:
         // shared message header.
-        // @see https://github.com/simple-rtmp-server/srs/issues/251
+        // @see https://github.com/ossrs/srs/issues/251
         SrsSharedMessageHeader header;
         // actual shared payload.
         char* payload;
@@ -1864,6 +1980,13 @@ public:
     */
     virtual int read_tag_data(char* data, int32_t size);
     /**
+    * read the tag data without copy, only for reader in mmap mode.
+    * @param pdata output the tag data in the mapped file,
+    *       which is valid util the reader closed.
+    * @remark assert pdata not NULL.
+    */
+    virtual int read_tag_data_view(char** pdata, int32_t size);
+    /**
     * read the 4bytes previous tag size.
     * @remark assert previous_tag_size not NULL.
     */
@@ -1913,13 +2036,264 @@ public:
     virtual int lseek(int64_t offset);
 };
 
+/**
+* the seekable point of flv, the video keyframe,
+* or the audio tag when there is no video.
+*/
+struct SrsFlvIndexEntry
+{
+    // the timestamp of tag in ms.
+    u_int32_t timestamp;
+    // the start offset of tag header in file.
+    int64_t offset;
+    // SRS_FLV_INDEX_KEYFRAME or SRS_FLV_INDEX_AUDIO.
+    int8_t flags;
+};
+
+#define SRS_FLV_INDEX_KEYFRAME 0x01
+#define SRS_FLV_INDEX_AUDIO 0x02
+
+/**
+* the keyframe index of flv, to seek to the keyframe by time
+* in O(log n) without scanning the whole file.
+* the index is saved to a binary sidecar file, in big-endian:
+*       4B magic "FLVI", 1B version, 3B reserved,
+*       8B flv file size, 8B flv mtime in ms, 4B count of entries,
+*       then each entry is 4B timestamp, 8B offset and 1B flags.
+* the sidecar is stale when the flv file size or mtime changed.
+*/
+class SrsFlvIndex
+{
+private:
+    std::vector<SrsFlvIndexEntry> entries;
+    // the size of flv file indexed.
+    int64_t flv_size;
+    // the modify time in ms of flv file indexed.
+    int64_t flv_mtime;
+public:
+    SrsFlvIndex();
+    virtual ~SrsFlvIndex();
+public:
+    /**
+    * build the index by scanning all tags of flv file,
+    * only the tag header and first 2bytes of video are read.
+    * @remark the position of reader is restored after build.
+    */
+    virtual int build(SrsFileReader* fr);
+    /**
+    * load the index from sidecar file.
+    * @param size the size of flv file, the index must match it.
+    * @param mtime the modify time in ms of flv file, the index must match it.
+    * @return ERROR_KERNEL_FLV_INDEX when sidecar is invalid or stale.
+    */
+    virtual int load(std::string path, int64_t size, int64_t mtime);
+    /**
+    * save the index to sidecar file, write to a temp file
+    * then rename to path, so readers never see partial index.
+    */
+    virtual int save(std::string path);
+    /**
+    * find the last seekable point at or before the time,
+    * or the first point when time is before it.
+    * @param poffset output the offset of tag header.
+    * @param ptime output the timestamp of tag.
+    * @return ERROR_KERNEL_FLV_INDEX when index is empty.
+    */
+    virtual int seek(u_int32_t time, int64_t* poffset, u_int32_t* ptime);
+    /**
+    * get the count of seekable points.
+    */
+    virtual int size();
+};
+
+/**
+* the statistics of flv scanner.
+*/
+struct SrsFlvScanStats
+{
+    int64_t nb_tags;
+    int64_t nb_audios;
+    int64_t nb_videos;
+    int64_t nb_scripts;
+    int64_t nb_keyframes;
+    // the corrupt tags, invalid type, size or previous tag size,
+    // including the truncated tag at the end of file.
+    int64_t nb_errors;
+    // the offset of first corrupt tag, -1 for none.
+    int64_t error_offset;
+    // the count of timestamp jump backward.
+    int64_t nb_jumps;
+    // the timestamp of the first and last tag.
+    u_int32_t first_time;
+    u_int32_t last_time;
+    // the min and max timestamp of tags.
+    u_int32_t start_time;
+    u_int32_t end_time;
+    // the SrsCodecVideo and SrsCodecAudio, -1 for none.
+    int video_codec;
+    int audio_codec;
+    
+    SrsFlvScanStats();
+};
+
+/**
+* scan and validate the flv file in parallel, the file is split to chunks
+* at tag boundaries, resynchronized by the previous tag size,
+* then the chunks are scanned by threads and the stats are merged.
+* @remark the reader must be opened in mmap mode.
+*/
+class SrsFlvScanner
+{
+private:
+    // the whole mapped file.
+    char* data;
+    int64_t size;
+public:
+    SrsFlvScanner();
+    virtual ~SrsFlvScanner();
+public:
+    /**
+    * initialize the scanner by the reader in mmap mode.
+    * @remark the reader must be alive when scan.
+    */
+    virtual int initialize(SrsFileReader* fr);
+    /**
+    * scan the file by threads.
+    * @param nb_threads the max threads, 0 to use the cpu cores.
+    */
+    virtual int scan(int nb_threads, SrsFlvScanStats* stats);
+private:
+    /**
+    * whether the offset is the start of tag, and its previous tag size matches.
+    */
+    virtual bool is_tag(int64_t offset);
+    /**
+    * find the first tag in [start, end) which next tag is also valid.
+    * @return the offset of tag, -1 for not found.
+    */
+    virtual int64_t resync(int64_t start, int64_t end);
+    /**
+    * scan the tags which start in [start, end).
+    */
+    virtual void scan_chunk(int64_t start, int64_t end, SrsFlvScanStats* stats);
+    static void* worker(void* arg);
+};
+
+// the max jitter of timestamp, the delta of tags out of
+// [-SRS_FLV_REPAIR_MAX_JITTER_MS, max_jump] is corrected,
+// where the max_jump default to SRS_FLV_REPAIR_MAX_JUMP_MS.
+#define SRS_FLV_REPAIR_MAX_JITTER_MS 1000
+#define SRS_FLV_REPAIR_MAX_JUMP_MS 10000
+// the delta to use when timestamp is corrected.
+#define SRS_FLV_REPAIR_DEFAULT_FRAME_MS 10
+
+/**
+* the statistics of flv repairer.
+*/
+struct SrsFlvRepairStats
+{
+    // the valid tags output.
+    int64_t nb_tags;
+    // the corrupt regions skipped, including the truncated tail.
+    int64_t nb_errors;
+    // the valid tags dropped, for no sequence header or keyframe before it.
+    int64_t nb_drops;
+    // the timestamps corrected.
+    int64_t nb_jumps;
+    // whether got audio or video tags.
+    bool has_audio;
+    bool has_video;
+    // the timestamp of the last tag, that is the duration.
+    u_int32_t duration;
+    
+    SrsFlvRepairStats();
+};
+
+/**
+* repair the flv file in a single pass over the buffered reader,
+* resync the corrupt tags by the previous tag size, drop the truncated tail,
+* the undecodable tags before the sequence header or keyframe,
+* and correct the timestamp to monotonic, start at 0.
+*/
+class SrsFlvRepairer
+{
+private:
+    SrsFileReader* reader;
+    // the window of file to resync, [pos, end) is unparsed.
+    char* buf;
+    int nb_buf;
+    int pos;
+    int end;
+    bool eof;
+    // whether in the corrupt region, to count the region once.
+    bool corrupt;
+    // the last input and output timestamp for jitter correction.
+    bool got_tag;
+    int64_t last_time;
+    int64_t last_correct_time;
+    int64_t last_audio_time;
+    int64_t last_video_time;
+    // the max forward jump in ms to keep, 0 to keep all.
+    int max_jump;
+    // whether got the sequence header and keyframe of stream.
+    bool got_avc_sh;
+    bool got_aac_sh;
+    bool got_keyframe;
+    SrsFlvRepairStats _stats;
+public:
+    SrsFlvRepairer();
+    virtual ~SrsFlvRepairer();
+public:
+    /**
+    * initialize the repairer by the reader, read the flv header.
+    * @remark the header is skipped when corrupt, the tags are resync.
+    */
+    virtual int initialize(SrsFileReader* fr);
+    /**
+    * set the max forward jump of timestamp in ms to keep, for example,
+    * the pause of publisher, the larger jump is corrupt and corrected.
+    * @param v the max jump in ms, 0 to keep all forward jumps.
+    */
+    virtual void set_max_jump(int v);
+    /**
+    * read the next valid tag, the timestamp is corrected.
+    * @param pdata output the data of tag, valid until next read.
+    * @return ERROR_SYSTEM_FILE_EOF when no more valid tag.
+    */
+    virtual int read_tag(char* ptype, int32_t* psize, u_int32_t* ptime, char** pdata);
+    virtual SrsFlvRepairStats* stats();
+private:
+    /**
+    * ensure there are size bytes in window from pos.
+    * @return false when EOF before size bytes.
+    */
+    virtual bool fill(int size);
+    /**
+    * whether the tag at pos of window is valid and completed,
+    * its previous tag size matches, or the next tag is valid.
+    */
+    virtual bool check_tag();
+    /**
+    * whether the bytes is a valid tag header.
+    */
+    virtual bool is_tag_header(u_int8_t* p);
+    /**
+    * whether the tag is decodable, update the state of stream.
+    */
+    virtual bool is_decodable(char type, char* data, int32_t size);
+    /**
+    * correct the timestamp of tag.
+    */
+    virtual u_int32_t correct(char type, u_int32_t time);
+};
+
 #endif
 
 // following is generated by src/kernel/srs_kernel_codec.hpp
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -2011,6 +2385,7 @@ enum SrsCodecVideoAVCType
 //     5 = On2 VP6 with alpha channel
 //     6 = Screen video version 2
 //     7 = AVC
+//     12 = HEVC, not in the spec, the de facto extension of the CDNs.
 enum SrsCodecVideo
 {
     // set to the zero to reserved, for array map.
@@ -2027,9 +2402,35 @@ enum SrsCodecVideo
     SrsCodecVideoOn2VP6WithAlphaChannel = 5,
     SrsCodecVideoScreenVideoVersion2     = 6,
     SrsCodecVideoAVC                     = 7,
+    SrsCodecVideoHEVC                    = 12,
 };
 std::string srs_codec_video2str(SrsCodecVideo codec);
 
+/**
+* the enhanced RTMP video tag header, when the IsExHeader bit is set,
+* the first byte is IsExHeader UB[1], FrameType UB[3], PacketType UB[4],
+* then the FourCC UI32 of the codec, for example, 'hvc1' for HEVC.
+* @see https://github.com/veovera/enhanced-rtmp
+*/
+#define SRS_FLV_VIDEO_EX_HEADER 0x80
+#define SRS_FLV_VIDEO_FOURCC_HEVC 0x68766331
+
+// PacketType UB [4] IF IsExHeader
+// The following values are defined:
+//     0 = sequence start, the HEVCDecoderConfigurationRecord
+//     1 = coded frames, with SI24 CompositionTime
+//     2 = sequence end
+//     3 = coded frames, without CompositionTime, it's zero
+enum SrsCodecVideoExPacketType
+{
+    SrsCodecVideoExPacketTypeSequenceStart          = 0,
+    SrsCodecVideoExPacketTypeCodedFrames            = 1,
+    SrsCodecVideoExPacketTypeSequenceEnd            = 2,
+    SrsCodecVideoExPacketTypeCodedFramesX           = 3,
+    SrsCodecVideoExPacketTypeMetadata               = 4,
+    SrsCodecVideoExPacketTypeMPEG2TSSequenceStart   = 5,
+};
+
 // SoundFormat UB [4] 
 // Format of SoundData. The following values are defined:
 //     0 = Linear PCM, platform endian
@@ -2137,6 +2538,10 @@ public:
     */
     static bool video_is_h264(char* data, int size);
     /**
+    * check codec hevc, the codec id 12 or the enhanced RTMP 'hvc1'.
+    */
+    static bool video_is_hevc(char* data, int size);
+    /**
     * check codec aac.
     */
     static bool audio_is_aac(char* data, int size);
@@ -2164,12 +2569,6 @@ extern int aac_sample_rates[];
 #define SRS_SRS_MAX_CODEC_SAMPLE 128
 #define SRS_AAC_SAMPLE_RATE_UNSET 15
 
-// in ms, for HLS aac flush the audio
-#define SRS_CONF_DEFAULT_AAC_DELAY 60
-
-// max PES packets size to flush the video.
-#define SRS_AUTO_HLS_AUDIO_CACHE_SIZE 128 * 1024
-
 /**
 * the FLV/RTMP supported audio sample size.
 * Size of each audio sample. This parameter only pertains to
@@ -2248,6 +2647,71 @@ enum SrsAvcNaluType
 };
 std::string srs_codec_avc_nalu2str(SrsAvcNaluType nalu_type);
 
+/**
+ * Table 7-1 - NAL unit type codes and NAL unit type classes
+ * H.265-HEVC-ITU-T-REC-H.265-201304.pdf, page 60.
+ * the nal_unit_type is the 6bits after the forbidden_zero_bit,
+ * that is (nalu[0] >> 1) & 0x3f.
+ */
+enum SrsHevcNaluType
+{
+    // Coded slice segment of a non-TSA, non-STSA trailing picture
+    SrsHevcNaluTypeCodedSliceTrailN = 0,
+    SrsHevcNaluTypeCodedSliceTrailR = 1,
+    // Coded slice segment of a BLA picture
+    SrsHevcNaluTypeCodedSliceBLA = 16,
+    SrsHevcNaluTypeCodedSliceBLANoLeading = 18,
+    // Coded slice segment of an IDR picture
+    SrsHevcNaluTypeCodedSliceIDR = 19,
+    SrsHevcNaluTypeCodedSliceIDRNoLeading = 20,
+    // Coded slice segment of a CRA picture
+    SrsHevcNaluTypeCodedSliceCRA = 21,
+    // Reserved IRAP VCL NAL unit types, the last of IRAP.
+    SrsHevcNaluTypeReservedIRAP23 = 23,
+    // Video parameter set video_parameter_set_rbsp( )
+    SrsHevcNaluTypeVPS = 32,
+    // Sequence parameter set seq_parameter_set_rbsp( )
+    SrsHevcNaluTypeSPS = 33,
+    // Picture parameter set pic_parameter_set_rbsp( )
+    SrsHevcNaluTypePPS = 34,
+    // Access unit delimiter access_unit_delimiter_rbsp( )
+    SrsHevcNaluTypeAccessUnitDelimiter = 35,
+    // Supplemental enhancement information sei_rbsp( )
+    SrsHevcNaluTypePrefixSEI = 39,
+    SrsHevcNaluTypeSuffixSEI = 40,
+};
+std::string srs_codec_hevc_nalu2str(SrsHevcNaluType nalu_type);
+
+/**
+* the hevc sps fields required by the HEVCDecoderConfigurationRecord,
+* @see 7.3.2.2 Sequence parameter set RBSP syntax
+*       H.265-HEVC-ITU-T-REC-H.265-201304.pdf, page 33.
+*/
+struct SrsHevcSps
+{
+    // profile_tier_level( 1, sps_max_sub_layers_minus1 )
+    u_int8_t general_profile_space;
+    u_int8_t general_tier_flag;
+    u_int8_t general_profile_idc;
+    u_int32_t general_profile_compatibility_flags;
+    // the 48bits general_progressive_source_flag to general_reserved_zero_43bits.
+    int64_t general_constraint_indicator_flags;
+    u_int8_t general_level_idc;
+    u_int8_t sps_max_sub_layers_minus1;
+    u_int8_t sps_temporal_id_nesting_flag;
+    int32_t chroma_format_idc;
+    int32_t pic_width_in_luma_samples;
+    int32_t pic_height_in_luma_samples;
+    int32_t bit_depth_luma_minus8;
+    int32_t bit_depth_chroma_minus8;
+};
+
+/**
+* demux the hevc sps NALU, which starts with the 2bytes NALU header.
+* @param sps the output sps fields.
+*/
+int srs_hevc_demux_sps(char* frame, int nb_frame, SrsHevcSps* sps);
+
 /**
 * the codec sample unit.
 * for h.264 video packet, a NALU is a sample unit.
@@ -2305,9 +2769,11 @@ public:
     int32_t cts;
 public:
     // video specified
+    SrsCodecVideo vcodec;
     SrsCodecVideoAVCFrame frame_type;
     SrsCodecVideoAVCType avc_packet_type;
-    // whether sample_units contains IDR frame.
+    // whether sample_units contains IDR frame,
+    // for hevc, whether contains IRAP(BLA/IDR/CRA) frame.
     bool has_idr;
     SrsAvcNaluType first_nalu_type;
 public:
@@ -2353,7 +2819,7 @@ enum SrsAvcPayloadFormat
 
 /**
 * the aac profile, for ADTS(HLS/TS)
-* @see https://github.com/simple-rtmp-server/srs/issues/310
+* @see https://github.com/ossrs/srs/issues/310
 */
 enum SrsAacProfile
 {
@@ -2443,6 +2909,8 @@ enum SrsAvcLevel
 };
 std::string srs_codec_avc_level2str(SrsAvcLevel level);
 
+#if !defined(SRS_EXPORT_LIBRTMP)
+
 /**
 * the h264/avc and aac codec, for media stream.
 *
@@ -2489,6 +2957,10 @@ public:
     char*           sequenceParameterSetNALUnit;
     u_int16_t       pictureParameterSetLength;
     char*           pictureParameterSetNALUnit;
+    // for hevc, the vps, while the sps/pps reuse the fields of avc,
+    // and the avc_extra_data is the HEVCDecoderConfigurationRecord.
+    u_int16_t       videoParameterSetLength;
+    char*           videoParameterSetNALUnit;
 private:
     // the avc payload format.
     SrsAvcPayloadFormat payload_format;
@@ -2523,6 +2995,9 @@ public:
     */
     int             aac_extra_size;
     char*           aac_extra_data;
+public:
+    // for sequence header, whether parse the h.264 sps.
+    bool            avc_parse_sps;
 public:
     SrsAvcAacCodec();
     virtual ~SrsAvcAacCodec();
@@ -2547,6 +3022,8 @@ public:
     * demux the video specified data(frame_type, codec_id, ...) to sample.
     * demux the h.264 sepcified data(avc_profile, ...) to codec from sequence header.
     * demux the h.264 NALUs to sampe units.
+    * @remark the hevc in codec id 12 or enhanced RTMP is also demuxed,
+    *       where the avc_packet_type is mapped to SequenceHeader or NALU.
     */
     virtual int video_avc_demux(char* data, int size, SrsCodecSample* sample);
 public:
@@ -2560,6 +3037,11 @@ private:
     * decode the sps and pps.
     */
     virtual int avc_demux_sps_pps(SrsStream* stream);
+    /**
+    * when hevc packet is sequence header, decode the vps, sps and pps
+    * from the HEVCDecoderConfigurationRecord.
+    */
+    virtual int hevc_demux_vps_sps_pps(SrsStream* stream);
     /**
      * decode the sps rbsp stream.
      */
@@ -2577,12 +3059,14 @@ private:
     virtual int avc_demux_ibmf_format(SrsStream* stream, SrsCodecSample* sample);
 };
 
+#endif
+
 #endif
 // following is generated by src/kernel/srs_kernel_file.hpp
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -2611,20 +3095,58 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //#include <srs_core.hpp>
 
 #include <string>
+#include <deque>
+#include <vector>
 
-// for srs-librtmp, @see https://github.com/simple-rtmp-server/srs/issues/213
+// for srs-librtmp, @see https://github.com/ossrs/srs/issues/213
 #ifndef _WIN32
 #include <sys/uio.h>
+#include <pthread.h>
 #endif
 
+/**
+* the policy to sync the data of file writer to disk.
+*/
+enum SrsFileSync
+{
+    // never sync, the kernel writes back the data.
+    SrsFileSyncNone = 0,
+    // fdatasync when flush the buffer to file.
+    SrsFileSyncFlush = 1,
+    // fdatasync when close the file.
+    SrsFileSyncClose = 2,
+};
+
 /**
 * file writer, to write to file.
+* the writes are buffered and flushed by writev in batch, 
+* when buffer is full, interval elapsed, seek or close.
+* @remark the interval is checked by the next write, there is no timer,
+*       so the buffer of an idle stream stays in memory util the next
+*       write or close, user should flush() when the stream is idle.
 */
 class SrsFileWriter
 {
 private:
     std::string path;
     int fd;
+private:
+    // the write behind buffer, NULL when disabled.
+    char* buf;
+    int nb_buf;
+    // the capacity of buffer, aligned when direct.
+    int buf_size;
+    // the configured size to flush, 0 to disable the buffer.
+    int flush_size;
+    // the interval in ms to flush, 0 to flush only when buffer is full.
+    // checked by write, never flush when no write.
+    int flush_interval;
+    int64_t last_flush;
+    SrsFileSync sync;
+    // whether to use O_DIRECT for the next open.
+    bool direct;
+    // whether the fd is in O_DIRECT mode.
+    bool directed;
 public:
     SrsFileWriter();
     virtual ~SrsFileWriter();
@@ -2640,10 +3162,11 @@ public:
      */
     virtual int open_append(std::string p);
     /**
-     * close current writer.
+     * close current writer, flush the buffered data and sync by policy.
      * @remark user can reopen again.
+     * @return the error of flush, sync or close, the writer is always closed.
      */
-    virtual void close();
+    virtual int close();
 public:
     virtual bool is_open();
     virtual void lseek(int64_t offset);
@@ -2656,11 +3179,146 @@ public:
     virtual int write(void* buf, size_t count, ssize_t* pnwrite);
     /**
      * for the HTTP FLV, to writev to improve performance.
-     * @see https://github.com/simple-rtmp-server/srs/issues/405
+     * @see https://github.com/ossrs/srs/issues/405
      */
     virtual int writev(iovec* iov, int iovcnt, ssize_t* pnwrite);
+    /**
+    * flush the buffered data to file.
+    * @remark for O_DIRECT, the tail unaligned block is written 
+    *       by disable the O_DIRECT of fd, so the writes after flush
+    *       use the page cache, only flush before close for O_DIRECT.
+    */
+    virtual int flush();
+public:
+    /**
+    * set the write behind buffer, apply to current file.
+    * @param size the bytes to flush, 0 to write through without buffer.
+    * @param interval_ms flush when the interval elapsed, 0 to ignore.
+    *       the interval is checked by the next write, not by timer.
+    */
+    virtual int set_buffer(int size, int interval_ms);
+    /**
+    * set the policy to fdatasync the data.
+    */
+    virtual void set_sync(SrsFileSync v);
+    /**
+    * whether open the file with O_DIRECT to bypass the page cache,
+    * the buffer is aligned to write in blocks.
+    * @remark apply at the next open, ignore when not supported.
+    */
+    virtual void set_direct(bool v);
+private:
+    virtual int open_fd(std::string p, int flags);
+    /**
+    * flush the buffer to file.
+    * @param all whether write the tail unaligned bytes for O_DIRECT.
+    */
+    virtual int do_flush(bool all);
+    /**
+    * write all bytes of iovs, the buffer is written before iovs.
+    */
+    virtual int do_writev(char* data, int size, iovec* iov, int iovcnt);
+    virtual int do_sync();
 };
 
+#ifndef _WIN32
+class SrsFileWritePool;
+
+/**
+* the buffer of async file writer, queued to write.
+*/
+struct SrsFileChunk
+{
+    char* data;
+    int size;
+};
+
+/**
+* async file writer, the writes are copied to buffers and written
+* by the shared write threads, so the caller never blocks on disk.
+* the buffers of each writer are written in order, by one thread a time.
+* when the inflight buffers exceed the max, the write blocks util
+* some buffer written, or fails with ERROR_SYSTEM_FILE_BUSY in 
+* nonblocking mode, and the caller can drop the data.
+* @remark the file is opened and closed in the caller thread,
+*       the close waits for all buffers written.
+*/
+class SrsAsyncFileWriter : public SrsFileWriter
+{
+    friend class SrsFileWritePool;
+private:
+    // the underlayer writer, used by write thread.
+    SrsFileWriter* file;
+    // the buffer to copy the writes, queued when full.
+    SrsFileChunk* current;
+    int chunk_size;
+    int chunk_interval;
+    int64_t last_submit;
+    int max_inflight;
+    bool nonblocking;
+    // the logical offset of file, the written and queued bytes.
+    int64_t position;
+private:
+    // the inflight buffers, protected by the lock of pool.
+    std::deque<SrsFileChunk*> chunks;
+    std::vector<SrsFileChunk*> free_chunks;
+    // whether in the ready queue of pool, or writing by thread.
+    bool scheduled;
+    // the error of write thread, return by the next write.
+    int error;
+    // signaled when buffer written.
+    pthread_cond_t cond;
+public:
+    SrsAsyncFileWriter();
+    virtual ~SrsAsyncFileWriter();
+public:
+    virtual int open(std::string p);
+    virtual int open_append(std::string p);
+    virtual int close();
+public:
+    virtual bool is_open();
+    virtual void lseek(int64_t offset);
+    virtual int64_t tellg();
+public:
+    virtual int write(void* buf, size_t count, ssize_t* pnwrite);
+    virtual int writev(iovec* iov, int iovcnt, ssize_t* pnwrite);
+    /**
+    * queue the buffer and wait for all buffers written.
+    */
+    virtual int flush();
+public:
+    /**
+    * set the size of buffer, and flush interval for the current buffer.
+    * @param size the bytes of each buffer, at least 4KB.
+    * @remark the current buffer is queued when the interval elapsed by
+    *       the next write, user should flush() when the stream is idle.
+    */
+    virtual int set_buffer(int size, int interval_ms);
+    virtual void set_sync(SrsFileSync v);
+    virtual void set_direct(bool v);
+    /**
+    * set the max inflight buffers of this writer.
+    * @param v when nonblocking, write fails with ERROR_SYSTEM_FILE_BUSY
+    *       when exceed, otherwise blocks util some buffer written.
+    */
+    virtual void set_inflight(int max, bool v);
+    /**
+    * get the count of inflight buffers, for caller to detect the disk stall.
+    */
+    virtual int inflight();
+private:
+    virtual int on_opened();
+    /**
+    * queue the current buffer to write.
+    */
+    virtual void submit();
+    /**
+    * wait for all buffers written.
+    */
+    virtual int drain();
+};
+#endif
+
 /**
 * file reader, to read from file.
 */
@@ -2669,6 +3327,22 @@ class SrsFileReader
 private:
     std::string path;
     int fd;
+    // the read ahead buffer, alloc when read.
+    // @see SRS_PERF_FILE_READ_BUFFER
+    char* buf;
+    // the size of bytes in buffer, and the read position of buffer.
+    int nb_buf;
+    int buf_pos;
+    // the file offset of fd, which is the end of bytes in buffer,
+    // or the read position of mmap file.
+    int64_t offset;
+    // whether open in mmap mode, the whole file is mapped to memory.
+    bool mapped;
+    char* mmap_data;
+    int64_t mmap_size;
+    // the window of mmap file advised to read ahead, [start, end).
+    int64_t advised_start;
+    int64_t advised_end;
 public:
     SrsFileReader();
     virtual ~SrsFileReader();
@@ -2678,6 +3352,14 @@ public:
      * @param p a string indicates the path of file to open.
      */
     virtual int open(std::string p);
+    /**
+     * open file reader in mmap mode, map the whole file to memory,
+     * the read_view() can return the bytes without copy.
+     * @param p a string indicates the path of file to open.
+     * @remark the file must be smaller than the address space,
+     *       for example, 2GB for 32bits system.
+     */
+    virtual int open_mmap(std::string p);
     /**
      * close current reader.
      * @remark user can reopen again.
@@ -2690,12 +3372,40 @@ public:
     virtual void skip(int64_t size);
     virtual int64_t lseek(int64_t offset);
     virtual int64_t filesize();
+    /**
+    * get the modify time of file in ms, 0 when unknown.
+    */
+    virtual int64_t mtime();
 public:
     /**
-    * read from file. 
+    * read from file, read ahead to buffer when the count is small,
+    * and always read count bytes util EOF.
     * @param pnread the output nb_read, NULL to ignore.
+    * @return ERROR_SYSTEM_FILE_EOF when no bytes to read.
     */
     virtual int read(void* buf, size_t count, ssize_t* pnread);
+    /**
+    * read count bytes from mmap file without copy, 
+    * the bytes is valid util the reader closed.
+    * @param pdata output the bytes in the mapped memory.
+    * @return ERROR_SYSTEM_FILE_EOF when no enough bytes to read,
+    *       ERROR_SYSTEM_IO_INVALID when not open in mmap mode.
+    */
+    virtual int read_view(size_t count, char** pdata);
+    /**
+    * hint the kernel to read ahead the bytes from current position,
+    * for the reader will read them soon, for example, after seek.
+    * @remark ignore when not in mmap mode, or the position already advised.
+    */
+    virtual void will_read(size_t count);
+public:
+    virtual bool is_mmap();
+    /**
+    * get the fd of file, for example, to sendfile from it.
+    * @remark user must use tellg() as the read position, for the fd
+    *       position is ahead of it when read buffer is not empty.
+    */
+    virtual int get_fd();
 };
 
 #endif
@@ -2704,7 +3414,7 @@ public:
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -2803,7 +3513,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 /**
 * for performance issue, 
-* the iovs cache, @see https://github.com/simple-rtmp-server/srs/issues/194
+* the iovs cache, @see https://github.com/ossrs/srs/issues/194
 * iovs cache for multiple messages for each connections.
 * suppose the chunk size is 64k, each message send in a chunk which needs only 2 iovec,
 * so the iovs max should be (SRS_PERF_MW_MSGS * 2)
@@ -2813,7 +3523,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define SRS_CONSTS_IOVS_MAX (SRS_PERF_MW_MSGS * 2)
 /**
 * for performance issue, 
-* the c0c3 cache, @see https://github.com/simple-rtmp-server/srs/issues/194
+* the c0c3 cache, @see https://github.com/ossrs/srs/issues/194
 * c0c3 cache for multiple messages for each connections.
 * each c0 <= 16byes, suppose the chunk size is 64k,
 * each message send in a chunk which needs only a c0 header,
@@ -3090,7 +3800,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -3118,6 +3828,8 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 //#include <srs_core.hpp>
 
+#if !defined(SRS_EXPORT_LIBRTMP)
+
 #include <string>
 
 //#include <srs_kernel_codec.hpp>
@@ -3160,11 +3872,13 @@ public:
 
 #endif
 
+#endif
+
 // following is generated by src/kernel/srs_kernel_mp3.hpp
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -3192,6 +3906,8 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 //#include <srs_core.hpp>
 
+#if !defined(SRS_EXPORT_LIBRTMP)
+
 #include <string>
 
 class SrsStream;
@@ -3231,11 +3947,13 @@ public:
 
 #endif
 
+#endif
+
 // following is generated by src/kernel/srs_kernel_ts.hpp
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -3263,10 +3981,16 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 //#include <srs_core.hpp>
 
+#if !defined(SRS_EXPORT_LIBRTMP)
+
 #include <string>
 #include <map>
 #include <vector>
 
+#ifndef _WIN32
+#include <sys/uio.h>
+#endif
+
 //#include <srs_kernel_codec.hpp>
 
 class SrsStream;
@@ -3285,6 +4009,11 @@ class SrsTsContext;
 
 // Transport Stream packets are 188 bytes in length.
 #define SRS_TS_PACKET_SIZE          188
+// the pid is 13bits, so there are 8192 pids at most.
+#define SRS_TS_PIDS                 8192
+
+// the aggregate pure audio for hls, in ts tbn(ms * 90).
+#define SRS_CONSTS_HLS_PURE_AUDIO_AGGREGATE 720 * 90
 
 /**
 * the pid of ts packet,
@@ -3390,6 +4119,8 @@ enum SrsTsStream
     // ITU-T Rec. H.222.0 | ISO/IEC 13818-1 Reserved
     // 0x15-0x7F
     SrsTsStreamVideoH264       = 0x1b,
+    // ITU-T Rec. H.265 | ISO/IEC 23008-2 video stream
+    SrsTsStreamVideoHEVC       = 0x24,
     // User Private
     // 0x80-0xFF
     SrsTsStreamAudioAC3        = 0x81,
@@ -3530,6 +4261,11 @@ public:
     * whether the message is fresh.
     */
     virtual bool fresh();
+    /**
+    * reset the message to decode the next PES,
+    * the bytes of payload is cleared but its buffer is reused.
+    */
+    virtual void reset();
 public:
     /**
     * whether the sid indicates the elementary stream audio.
@@ -3570,6 +4306,50 @@ public:
     virtual int on_ts_message(SrsTsMessage* msg) = 0;
 };
 
+/**
+* the program of ts, the PMT and its elementary streams,
+* the ts of multiple programs is the MPTS.
+* @see SrsTsContext::add_program
+*/
+class SrsTsProgram
+{
+public:
+    // the program_number in PAT, and the pid of PMT.
+    int16_t number;
+    int16_t pmt_pid;
+    // the pid and type of elementary streams, in the order of PMT.
+    std::vector<int16_t> pids;
+    std::vector<SrsTsStream> streams;
+    // the version of PMT, increase when streams changed after written.
+    int8_t version;
+    bool written;
+public:
+    // the PSI and PCR scheduler, in tbn 90000 of the program.
+    int64_t last_psi_dts;
+    int64_t last_pcr_dts;
+    // the last PCR written, and the count of ts packets when written,
+    // to schedule the PCR by packets at the bitrate, -1 when not written.
+    int64_t last_pcr;
+    int64_t last_pcr_packets;
+    // the dts of last message, and the max step of messages, to estimate the next.
+    int64_t last_dts;
+    int64_t max_step;
+public:
+    SrsTsProgram(int16_t n, int16_t pid);
+    virtual ~SrsTsProgram();
+public:
+    /**
+    * find the elementary stream of pid.
+    * @return the index of stream, -1 when not found.
+    */
+    virtual int find(int16_t pid);
+    /**
+    * the pid to carry the PCR, the first video, or the first audio.
+    * @return SrsTsPidNULL when no stream.
+    */
+    virtual int16_t pcr_pid();
+};
+
 /**
 * the context of ts, to decode the ts stream.
 */
@@ -3577,13 +4357,34 @@ class SrsTsContext
 {
 // codec
 private:
-    std::map<int, SrsTsChannel*> pids;
+    // the channels indexed by pid, SRS_TS_PIDS entries, NULL for unknown pid.
+    SrsTsChannel** pids;
     bool pure_audio;
 // encoder
 private:
     // when any codec changed, write the PAT/PMT.
     SrsCodecVideo vcodec;
     SrsCodecAudio acodec;
+    // the reused headers of ts packets, each in a SRS_TS_PACKET_SIZE slot,
+    // and the iovs of headers and payloads, to write PES packets by one writev.
+    // @see SRS_PERF_TS_WRITEV_PACKETS
+    char* ts_headers;
+    iovec* ts_iovs;
+    // the programs of ts, a program for the audio and video by default.
+    std::vector<SrsTsProgram*> programs;
+    // the version of PAT, increase when programs changed after written.
+    int8_t pat_version;
+    bool pat_written;
+    // when programs or streams changed, write the PAT/PMT.
+    bool psi_changed;
+    // the interval in tbn 90000 to repeat the PAT/PMT, 0 to write when codec changed.
+    int64_t psi_interval;
+    // the interval in tbn 90000 to write the PCR on the PCR pid, 0 to write by message.
+    int64_t pcr_interval;
+    // the bitrate in bps of ts, and the count of ts packets written,
+    // to write the PCR inside the long PES, 0 to schedule by dts only.
+    int64_t bitrate;
+    int64_t nb_ts_packets;
 public:
     SrsTsContext();
     virtual ~SrsTsContext();
@@ -3591,6 +4392,7 @@ public:
     /**
      * whether the hls stream is pure audio stream.
      */
+    // TODO: FIXME: merge with muxer codec detect.
     virtual bool is_pure_audio();
     /**
      * when PMT table parsed, we know some info about stream.
@@ -3614,23 +4416,108 @@ public:
 // decode methods
 public:
     /**
-    * the stream contains only one ts packet.
+    * the stream contains one or more ts packets, for example, 7 packets of udp.
+    * the PES is parsed in place and assembled in the reused message of channel,
+    * the PAT/PMT is decoded by SrsTsPacket.
     * @param handler the ts message handler to process the msg.
     * @remark we will consume all bytes in stream.
+    * @remark the corrupt packet is recoverable, we resync to the next sync byte
+    *       and drop the partial PES util the next payload_unit_start_indicator,
+    *       so only the error of handler is returned.
     */
     virtual int decode(SrsStream* stream, ISrsTsHandler* handler);
+private:
+    /**
+    * decode a ts packet of SRS_TS_PACKET_SIZE bytes.
+    */
+    virtual int decode_packet(char* data, ISrsTsHandler* handler);
+    /**
+    * decode the PES payload of ts packet for the audio or video channel.
+    * @param data the payload of ts packet, after the header and adaptation field.
+    */
+    virtual int decode_pes(SrsTsChannel* channel, int8_t payload_unit_start_indicator,
+        u_int8_t continuity_counter, char* data, int size, ISrsTsHandler* handler);
+    /**
+    * process the completed message by handler, then reset it to reuse.
+    */
+    virtual int reap(SrsTsMessage* msg, ISrsTsHandler* handler);
 // encode methods
 public:
     /**
     * write the PES packet, the video/audio stream.
+    * the ts contains a program of the video and audio stream.
     * @param msg the video/audio msg to write to ts.
     * @param vc the video codec, write the PAT/PMT table when changed.
     * @param ac the audio codec, write the PAT/PMT table when changed.
+    * @remark never use with the add_program and set_stream.
     */
     virtual int encode(SrsFileWriter* writer, SrsTsMessage* msg, SrsCodecVideo vc, SrsCodecAudio ac);
+    /**
+    * add a program to ts, for the ts of multiple programs(MPTS).
+    * @param number the program_number in PAT, 1-65535.
+    * @param pmt_pid the pid of PMT.
+    */
+    virtual int add_program(int number, int pmt_pid);
+    /**
+    * set the elementary stream of program, for instance, the audio tracks
+    * of languages, the PMT is written with new version when changed.
+    * the PCR of program is carried by the first video, or the first audio.
+    * @param stream the type of stream, SrsTsStreamReserved to remove it.
+    */
+    virtual int set_stream(int number, int pid, SrsTsStream stream);
+    /**
+    * write the PES packet to the elementary stream of pid, @see set_stream.
+    * the PAT/PMT is written when changed, or the interval elapsed on the
+    * dts of program, the PCR is written on the PCR pid of program.
+    */
+    virtual int encode_stream(SrsFileWriter* writer, SrsTsMessage* msg, int16_t pid);
+    /**
+    * repeat the PAT/PMT at the interval of dts, for the broadcast muxer
+    * and udp multicast, the receiver can start at any point.
+    * @param psi_ms the interval in ms, 0 to write only when codec changed.
+    */
+    virtual void set_psi_interval(int psi_ms);
+    /**
+    * write the PCR on the PCR pid at the interval of dts, in the first
+    * packet of PES, or an adaptation only packet when the message is of
+    * other pid, for instance, 40ms for DVB.
+    * @param pcr_ms the interval in ms, 0 to write PCR by message, that is,
+    *       the write_pcr of message, or each audio for pure audio.
+    * @remark the PES longer than the interval, @see set_bitrate.
+    */
+    virtual void set_pcr_interval(int pcr_ms);
+    /**
+    * set the bitrate of ts, to schedule the PCR by the count of packets
+    * as well, the PCR is written in the adaptation field of packet inside
+    * the PES which spans the interval, or an adaptation only packet when
+    * the PES is of other pid, the PCR is extrapolated from the last one.
+    * @param bps the bitrate in bps, 0 to schedule by dts only.
+    * @remark ignored when no pcr interval.
+    */
+    virtual void set_bitrate(int64_t bps);
 private:
-    virtual int encode_pat_pmt(SrsFileWriter* writer, int16_t vpid, SrsTsStream vs, int16_t apid, SrsTsStream as);
-    virtual int encode_pes(SrsFileWriter* writer, SrsTsMessage* msg, int16_t pid, SrsTsStream sid, bool pure_audio);
+    virtual SrsTsProgram* fetch_program(int number);
+    /**
+    * write the PAT and the PMT of all programs.
+    */
+    virtual int encode_psi(SrsFileWriter* writer);
+    virtual int encode_psi_packet(SrsFileWriter* writer, SrsTsPacket* pkt);
+    virtual int encode_pes(SrsFileWriter* writer, SrsTsMessage* msg, SrsTsProgram* program, int16_t pid, SrsTsStream sid, bool write_pcr);
+    /**
+    * write an adaptation only packet with the PCR.
+    */
+    virtual int encode_pcr(SrsFileWriter* writer, SrsTsProgram* program, int64_t pcr);
+    /**
+    * whether the PCR of program is due by the packets written at the bitrate.
+    */
+    virtual bool pcr_due(SrsTsProgram* program);
+    /**
+    * the PCR to write, the dts, but never before the last PCR extrapolated
+    * by the packets written at the bitrate.
+    * @param dts the dts of message, -1 for the packet inside the PES.
+    */
+    virtual int64_t pcr_of(SrsTsProgram* program, int64_t dts);
+    virtual void on_pcr(SrsTsProgram* program, int64_t pcr);
 };
 
 /**
@@ -3742,12 +4629,9 @@ public:
     virtual void padding(int nb_stuffings);
 public:
     static SrsTsPacket* create_pat(SrsTsContext* context, 
-        int16_t pmt_number, int16_t pmt_pid
-    );
-    static SrsTsPacket* create_pmt(SrsTsContext* context, 
-        int16_t pmt_number, int16_t pmt_pid, int16_t vpid, SrsTsStream vs, 
-        int16_t apid, SrsTsStream as
+        std::vector<SrsTsProgram*>& programs, int8_t version
     );
+    static SrsTsPacket* create_pmt(SrsTsContext* context, SrsTsProgram* program);
     static SrsTsPacket* create_pes_first(SrsTsContext* context, 
         int16_t pid, SrsTsPESStreamId sid, u_int8_t continuity_counter, bool discontinuity, 
         int64_t pcr, int64_t dts, int64_t pts, int size
@@ -4803,10 +5687,15 @@ public:
     * for user may need to update the acodec to mp3 or others,
     * so we use delay write PSI, when write audio or video.
     * @remark for audio aac codec, for example, SRS1, it's ok to write PSI when open ts.
-    * @see https://github.com/simple-rtmp-server/srs/issues/301
+    * @see https://github.com/ossrs/srs/issues/301
     */
     virtual int update_acodec(SrsCodecAudio ac);
     /**
+    * update the video codec, the PMT is written with the stream type of
+    * the first video frame, for example, h.265 when the stream is hevc.
+    */
+    virtual int update_vcodec(SrsCodecVideo vc);
+    /**
     * write an audio frame to ts, 
     */
     virtual int write_audio(SrsTsMessage* audio);
@@ -4815,9 +5704,20 @@ public:
     */
     virtual int write_video(SrsTsMessage* video);
     /**
-    * close the writer.
+    * write the message to the elementary stream of pid, for the ts of
+    * multiple programs or tracks, @see SrsTsContext::set_stream
     */
-    virtual void close();
+    virtual int write_stream(int16_t pid, SrsTsMessage* msg);
+    /**
+    * close the writer, flush the buffered ts to file.
+    * @return the error of flush or close, the writer is always closed.
+    */
+    virtual int close();
+public:
+    /**
+     * get the video codec of ts muxer.
+     */
+    virtual SrsCodecVideo video_codec();
 };
 
 /**
@@ -4876,6 +5776,497 @@ public:
      * @param fw the writer to use for ts encoder, user must free it.
      */
     virtual int initialize(SrsFileWriter* fw);
+    /**
+    * repeat the PAT/PMT and write the PCR at the interval of dts,
+    * @see SrsTsContext::set_psi_interval and set_pcr_interval.
+    */
+    virtual void set_interval(int psi_ms, int pcr_ms);
+    /**
+    * @see SrsTsContext::set_bitrate
+    */
+    virtual void set_bitrate(int64_t bps);
+public:
+    /**
+    * write audio/video packet.
+    * @remark assert data is not NULL.
+    */
+    virtual int write_audio(int64_t timestamp, char* data, int size);
+    virtual int write_video(int64_t timestamp, char* data, int size);
+private:
+    virtual int flush_audio();
+    virtual int flush_video();
+};
+
+/**
+* the track of ts multiple encoder, the audio or video of an input,
+* which is an elementary stream of program.
+*/
+class SrsTsTrack
+{
+public:
+    // the program number, and the pid of elementary stream.
+    int program;
+    int16_t pid;
+    SrsAvcAacCodec* codec;
+    SrsCodecSample* sample;
+    SrsTsCache* cache;
+public:
+    SrsTsTrack(int p, int16_t id);
+    virtual ~SrsTsTrack();
+};
+
+/**
+* encode the data of multiple inputs to one ts, each input is a track,
+* for example, several rtmp streams in the programs of MPTS, or the audio
+* of languages in a program, the PMT pid of program is 0x1000+program.
+*/
+class SrsTsMultiEncoder
+{
+private:
+    SrsFileWriter* writer;
+private:
+    std::vector<SrsTsTrack*> tracks;
+    SrsTSMuxer* muxer;
+    SrsTsContext* context;
+public:
+    SrsTsMultiEncoder();
+    virtual ~SrsTsMultiEncoder();
+public:
+    /**
+     * initialize the underlayer file stream.
+     * @param fw the writer to use for ts encoder, user must free it.
+     */
+    virtual int initialize(SrsFileWriter* fw);
+    /**
+    * @see SrsTsEncoder::set_interval
+    */
+    virtual void set_interval(int psi_ms, int pcr_ms);
+    /**
+    * @see SrsTsContext::set_bitrate
+    */
+    virtual void set_bitrate(int64_t bps);
+    /**
+    * add a track, the elementary stream of pid in program, the program
+    * is added when not exists.
+    * @param program the program number, 1-4094.
+    * @param ptrack output the index of track.
+    */
+    virtual int add_track(int program, int pid, int* ptrack);
+public:
+    /**
+    * write audio/video packet to track.
+    * @remark assert data is not NULL.
+    */
+    virtual int write_audio(int track, int64_t timestamp, char* data, int size);
+    virtual int write_video(int track, int64_t timestamp, char* data, int size);
+private:
+    virtual SrsTsTrack* fetch(int track);
+    virtual int flush(SrsTsTrack* track, SrsTsMessage* msg, SrsTsStream stream);
+};
+
+#endif
+
+#endif
+
+// following is generated by src/kernel/srs_kernel_udp.hpp
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2015 SRS(ossrs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef SRS_KERNEL_UDP_HPP
+#define SRS_KERNEL_UDP_HPP
+
+/*
+//#include <srs_kernel_udp.hpp>
+*/
+//#include <srs_core.hpp>
+
+#if !defined(SRS_EXPORT_LIBRTMP) && !defined(_WIN32)
+
+#include <string>
+#include <deque>
+#include <vector>
+
+#include <pthread.h>
+#include <netinet/in.h>
+
+//#include <srs_kernel_file.hpp>
+//#include <srs_kernel_ts.hpp>
+//#include <srs_core_performance.hpp>
+
+/**
+* the datagram of udp ts writer, some ts packets.
+*/
+struct SrsTsDatagram
+{
+    char data[SRS_PERF_TS_UDP_PACKETS * SRS_TS_PACKET_SIZE];
+    int size;
+    // the time in us to send, of the monotonic clock.
+    int64_t deadline;
+};
+
+/**
+* the udp sink of ts muxer, to send the ts to udp unicast or multicast,
+* for example, udp://239.1.1.1:1234, for the broadcast playout.
+* the ts packets are sent in datagrams of 7 packets by a send thread,
+* the datagrams due are sent by one sendmmsg.
+* 
+* the stream is paced by the PCR: 
+*       when no bitrate, each PCR packet is sent at the time of PCR,
+*       and the packets between two PCRs are sent in burst.
+*       when bitrate set, the stream is in constant bitrate, the null
+*       packets are stuffed before each PCR packet to its position at the
+*       bitrate, and all packets are sent at its position.
+* for multiple programs, the stream is paced by the PCR of first program.
+* the stream is delayed SRS_PERF_TS_UDP_DELAY, so the stuffing and the
+* jitter of source are absorbed, and the write blocks when the inflight
+* datagrams exceed SRS_PERF_TS_UDP_INFLIGHT, for instance, the source
+* is faster than realtime.
+* @remark the muxer should write PCR at a fixed interval, for instance,
+*       SrsTsContext::set_pcr_interval(40).
+*/
+class SrsTsUdpWriter : public SrsFileWriter
+{
+private:
+    std::string url;
+    int fd;
+    sockaddr_in addr;
+    int ttl;
+    int64_t bitrate;
+    int64_t position;
+private:
+    // the partial ts packet of writes.
+    char packet[SRS_TS_PACKET_SIZE];
+    int nb_packet;
+    // the datagram to fill the packets.
+    SrsTsDatagram* current;
+    // the count of packets, including the stuffing packets.
+    int64_t nb_packets;
+    // the pacing base, the packet at time in us with the PCR in tbn 90000.
+    int64_t base_packets;
+    int64_t base_time;
+    int64_t base_pcr;
+    // the time in us of last packet.
+    int64_t last_time;
+    int64_t last_pcr;
+    // the PMT and PCR pid of the first program, to pace by its PCR.
+    int pmt_pid;
+    int pcr_pid;
+private:
+    // the inflight datagrams, protected by the lock.
+    std::deque<SrsTsDatagram*> datagrams;
+    std::vector<SrsTsDatagram*> free_datagrams;
+    // the send thread quit when all datagrams sent.
+    bool started;
+    bool quit;
+    // the error of send thread, return by the next write.
+    int error;
+    pthread_t tid;
+    pthread_mutex_t lock;
+    // signaled when datagram queued or sent.
+    pthread_cond_t cond;
+public:
+    SrsTsUdpWriter();
+    virtual ~SrsTsUdpWriter();
+public:
+    /**
+    * open the udp socket and start the send thread.
+    * @param p the url, udp://host:port, or host:port, an empty url to
+    *       reuse the url of writer, for the ts muxer reopen it.
+    */
+    virtual int open(std::string p);
+    virtual int open_append(std::string p);
+    /**
+    * send the datagrams queued, then close the socket.
+    * @return the error of send thread.
+    */
+    virtual int close();
+public:
+    virtual bool is_open();
+    virtual void lseek(int64_t offset);
+    virtual int64_t tellg();
+public:
+    virtual int write(void* buf, size_t count, ssize_t* pnwrite);
+    virtual int writev(iovec* iov, int iovcnt, ssize_t* pnwrite);
+    /**
+    * queue the partial datagram.
+    */
+    virtual int flush();
+public:
+    /**
+    * set the ttl of multicast, apply at the next open.
+    */
+    virtual void set_ttl(int v);
+    /**
+    * set the constant bitrate in bps, 0 to pace by PCR only.
+    * @remark apply at the next open.
+    */
+    virtual void set_bitrate(int64_t v);
+private:
+    /**
+    * pace and queue the ts packet, stuff the null packets before PCR.
+    */
+    virtual int on_packet(char* pkt);
+    /**
+    * parse the PAT and PMT, for the PCR pid of the first program.
+    */
+    virtual void on_psi(u_int8_t* pkt, int pid);
+    virtual int append(char* pkt, int64_t deadline);
+    /**
+    * the time in us to send the packet at, by the pacing base.
+    */
+    virtual int64_t time_of(int64_t n);
+    virtual void rebase(int64_t time, int64_t pcr);
+    /**
+    * queue the current datagram, wait when exceed the inflight.
+    */
+    virtual int submit();
+private:
+    static void* worker(void* arg);
+    virtual void cycle();
+    virtual int send(SrsTsDatagram** dgs, int nb_dgs);
+};
+
+#endif
+
+#endif
+
+// following is generated by src/kernel/srs_kernel_hls.hpp
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2015 SRS(ossrs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef SRS_KERNEL_HLS_HPP
+#define SRS_KERNEL_HLS_HPP
+
+/*
+//#include <srs_kernel_hls.hpp>
+*/
+//#include <srs_core.hpp>
+
+#if !defined(SRS_EXPORT_LIBRTMP)
+
+#include <string>
+#include <vector>
+#include <sstream>
+
+//#include <srs_kernel_file.hpp>
+
+class SrsAvcAacCodec;
+class SrsCodecSample;
+class SrsTsCache;
+class SrsTsContext;
+class SrsTSMuxer;
+
+// the ratio of EXT-X-TARGETDURATION to the fragment, the segment is
+// reaped without keyframe when its duration reach the target duration,
+// for the EXTINF must never exceed it.
+#define SRS_HLS_TD_RATIO 1.5
+
+/**
+* the partial segment of low latency hls, a ts file in the m3u8,
+* the concatenation of parts is the segment.
+*/
+struct SrsHlsPart
+{
+    // the duration in seconds of part.
+    double duration;
+    // the uri of ts file in m3u8, relative to the m3u8.
+    std::string uri;
+    // whether the part starts with keyframe, or is audio.
+    bool independent;
+};
+
+/**
+* the hls segment, a ts file in the m3u8.
+*/
+class SrsHlsSegment
+{
+public:
+    // the duration in seconds of segment.
+    double duration;
+    // the sequence number of segment in m3u8.
+    int sequence_no;
+    // the uri of ts file in m3u8, relative to the m3u8.
+    std::string uri;
+    // the full path of ts file.
+    std::string full_path;
+    // the dts in tbn 90000 of first frame in segment.
+    int64_t segment_start_dts;
+    // the parts of segment written, empty when not low latency.
+    std::vector<SrsHlsPart> parts;
+public:
+    SrsHlsSegment();
+    virtual ~SrsHlsSegment();
+public:
+    /**
+    * update the duration of segment by the dts of frame.
+    * @remark the frame dts before the start is ignored.
+    */
+    virtual void update_duration(int64_t current_frame_dts);
+};
+
+/**
+* the writer of hls segment, which also writes the ts to the part file
+* when opened, so the part is available before the segment reaped.
+*/
+class SrsHlsSegmentWriter : public SrsFileWriter
+{
+private:
+    SrsFileWriter* part;
+public:
+    SrsHlsSegmentWriter();
+    virtual ~SrsHlsSegmentWriter();
+public:
+    /**
+    * open the part file, the ts written to both segment and part.
+    */
+    virtual int open_part(std::string p);
+    /**
+    * close the part file, flush the buffered ts of part.
+    * @return the error of flush or close, the part is always closed.
+    */
+    virtual int close_part();
+public:
+    virtual void set_sync(SrsFileSync v);
+    virtual int writev(iovec* iov, int iovcnt, ssize_t* pnwrite);
+};
+
+/**
+* encode the flv audio/video to hls, the ts segments and m3u8 playlist.
+* the segment is reaped at the video keyframe when its duration exceed
+* the fragment, or at the audio frame for pure audio stream, and it's
+* always reaped when its duration reach the EXT-X-TARGETDURATION, which
+* is the fragment*SRS_HLS_TD_RATIO.
+* the ts and m3u8 are written to the .tmp file then renamed, so the
+* player never gets a partial file, and the m3u8 only contains the
+* segments in the window, the segment out of window is removed from
+* disk when cleanup.
+* for example, the m3u8 file /data/live.m3u8, the segments are
+* /data/live-0.ts, /data/live-1.ts, ...
+* 
+* for low latency hls, each segment is also written as parts, for
+* example, /data/live-0.0.ts, /data/live-0.1.ts, ..., the part is
+* reaped when its duration reach the part target, and the m3u8 is
+* refreshed with the EXT-X-PART and EXT-X-PRELOAD-HINT of next part.
+* the delta m3u8 with EXT-X-SKIP is written to /data/live_delta.m3u8,
+* for the request with _HLS_skip=YES.
+*/
+class SrsHlsEncoder
+{
+private:
+    // the path of m3u8 file.
+    std::string m3u8;
+    // the prefix of ts file path, and the uri in m3u8.
+    std::string ts_dir;
+    std::string ts_prefix;
+    // the min duration in seconds of segment.
+    double hls_fragment;
+    // the max duration in seconds of segments in m3u8.
+    double hls_window;
+    // whether remove the segment out of window.
+    bool hls_cleanup;
+    // the part target duration in seconds, 0 to disable low latency.
+    double hls_part;
+    // whether fdatasync the ts and m3u8 before rename.
+    bool hls_sync;
+    // the path of delta m3u8, for low latency.
+    std::string delta_m3u8;
+private:
+    // the sequence number of next segment.
+    int sequence_no;
+    // the EXT-X-TARGETDURATION of m3u8, derived from the fragment,
+    // never change for the player may cache it.
+    int target_duration;
+    // whether stream has video, to reap segment at keyframe.
+    bool has_video;
+    // the segment to write, NULL when no frame written.
+    SrsHlsSegment* current;
+    // the segments in m3u8.
+    std::vector<SrsHlsSegment*> segments;
+    // the part to write, of current segment.
+    bool part_opened;
+    bool part_independent;
+    int64_t part_start_dts;
+    int64_t part_last_dts;
+    // the max interval of frames in part, to reap before exceed.
+    int64_t part_interval;
+private:
+    SrsHlsSegmentWriter* writer;
+    SrsAvcAacCodec* codec;
+    SrsCodecSample* sample;
+    SrsTsCache* cache;
+    SrsTsContext* context;
+    SrsTSMuxer* muxer;
+public:
+    SrsHlsEncoder();
+    virtual ~SrsHlsEncoder();
+public:
+    /**
+    * initialize the hls encoder.
+    * @param m3u8_file the path of m3u8, the segments are in the same dir.
+    * @param fragment_ms the min duration of each segment in ms.
+    * @param window_ms the max duration of segments in m3u8 in ms.
+    * @param cleanup whether remove the segment files out of window.
+    */
+    virtual int initialize(std::string m3u8_file, int fragment_ms, int window_ms, bool cleanup);
+    /**
+    * enable the low latency hls, write the segment in parts.
+    * @param part_ms the part target duration in ms, 0 to disable.
+    * @return ERROR_HLS_PART_AFTER_WRITE when any frame written.
+    */
+    virtual int set_part(int part_ms);
+    /**
+    * whether fdatasync the segment, part and m3u8 before rename them,
+    * so the renamed file is never partial after the system crash.
+    */
+    virtual void set_sync(bool v);
+    /**
+    * whether the m3u8 contains the part of segment, for the blocking
+    * playlist reload, the request with _HLS_msn=msn&_HLS_part=part
+    * should be hold until it's ready.
+    * @param msn the sequence number of segment.
+    * @param part the index of part in segment, -1 for the whole segment.
+    */
+    virtual bool is_ready(int msn, int part);
 public:
     /**
     * write audio/video packet.
@@ -4883,18 +6274,238 @@ public:
     */
     virtual int write_audio(int64_t timestamp, char* data, int size);
     virtual int write_video(int64_t timestamp, char* data, int size);
+    /**
+    * reap the current segment and end the m3u8, when stream end.
+    */
+    virtual int close();
 private:
+    /**
+    * open a new segment, the first frame dts is segment_start_dts.
+    */
+    virtual int segment_open(int64_t segment_start_dts);
+    /**
+    * close the current segment, rename to the ts file, then shrink
+    * the window and refresh the m3u8.
+    * @remark the segment and its parts are removed when close failed.
+    */
+    virtual int segment_close(bool end);
+    /**
+    * remove the files of segment failed to close, the tmp file and the
+    * parts renamed, then refresh the m3u8 without its parts.
+    */
+    virtual void segment_discard(SrsHlsSegment* segment);
+    /**
+    * write the m3u8 to .tmp then rename.
+    * @param end whether write the EXT-X-ENDLIST.
+    */
+    virtual int refresh_m3u8(bool end);
+    /**
+    * generate the m3u8 content.
+    * @param delta whether skip the old segments by EXT-X-SKIP.
+    */
+    virtual std::string generate_m3u8(bool end, bool delta);
+    virtual void generate_parts(std::stringstream& ss, SrsHlsSegment* segment);
+    /**
+    * the uri of part in segment of sequence.
+    */
+    virtual std::string part_uri(int sequence, int index);
+    /**
+    * write the m3u8 content to file, by .tmp then rename.
+    */
+    virtual int write_m3u8(std::string path, std::string body);
+    /**
+    * reap the part when it will exceed the part target with the frame,
+    * then open the next part for the frame.
+    * @param independent whether the frame is keyframe or audio.
+    */
+    virtual int part_update(int64_t dts, bool independent);
+    virtual int part_open(int64_t dts, bool independent);
+    /**
+    * close the part, rename to the part file.
+    * @param duration the duration in seconds of part.
+    */
+    virtual int part_close(double duration);
     virtual int flush_audio();
     virtual int flush_video();
 };
 
 #endif
 
+#endif
+
+// following is generated by src/kernel/srs_kernel_mp4.hpp
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2015 SRS(ossrs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#ifndef SRS_KERNEL_MP4_HPP
+#define SRS_KERNEL_MP4_HPP
+
+/*
+//#include <srs_kernel_mp4.hpp>
+*/
+//#include <srs_core.hpp>
+
+#if !defined(SRS_EXPORT_LIBRTMP)
+
+#include <vector>
+
+//#include <srs_kernel_codec.hpp>
+
+class SrsFileWriter;
+class SrsSimpleBuffer;
+
+/**
+* the sample of fmp4 fragment, the data is in the mdat of fragment.
+*/
+struct SrsMp4Sample
+{
+    // the dts in ms.
+    int64_t dts;
+    // the cts in ms, pts = dts + cts.
+    int32_t cts;
+    u_int32_t size;
+    bool keyframe;
+};
+
+/**
+* the data of samples in mdat, which references the bytes of packet,
+* or copied to the mdat buffer of track when not referenced.
+*/
+struct SrsMp4Chunk
+{
+    // the bytes in packet, NULL for the next size bytes in mdat buffer.
+    char* bytes;
+    int size;
+};
+
+/**
+* encode the flv audio/video to fragmented mp4(fmp4), for DASH/HLS(CMAF).
+* the init segment(ftyp+moov) is written before the first fragment,
+* with the tracks of h.264 and aac which sequence header is demuxed,
+* then each fragment(moof+mdat) starts at the video keyframe,
+* or the audio when there is no video.
+* @remark the timescale of tracks is 1000, the flv timestamp in ms.
+* @remark the sequence header change is ignored, for it's in the init segment.
+* @remark the track which sequence header comes after the init segment
+*       written is not in the init segment, the write fails with
+*       ERROR_KERNEL_MP4_TRACK_LATE.
+*/
+class SrsMp4Encoder
+{
+private:
+    SrsFileWriter* writer;
+private:
+    SrsAvcAacCodec* codec;
+    SrsCodecSample* sample;
+    // the min duration in ms of fragment.
+    int fragment_duration;
+    // whether the init segment is written, and the tracks in it.
+    bool got_init;
+    bool has_video;
+    bool has_audio;
+    u_int32_t sequence_number;
+private:
+    // the samples and data of current fragment.
+    std::vector<SrsMp4Sample> videos;
+    std::vector<SrsMp4Sample> audios;
+    std::vector<SrsMp4Chunk> video_chunks;
+    std::vector<SrsMp4Chunk> audio_chunks;
+    // the video NALUs copied to mdat, which length is not 4bytes.
+    SrsSimpleBuffer* video_mdat;
+    // the packets referenced by chunks, freed when fragment written.
+    std::vector<char*> packets;
+    int64_t fragment_start;
+    // the duration of last sample, for the last one of fragment.
+    u_int32_t video_duration;
+    u_int32_t audio_duration;
+public:
+    SrsMp4Encoder();
+    virtual ~SrsMp4Encoder();
+public:
+    /**
+    * initialize the underlayer file stream.
+    * @param fw the writer to use for mp4 encoder, user must free it.
+    * @param fragment_ms the min duration of each fragment in ms.
+    */
+    virtual int initialize(SrsFileWriter* fw, int fragment_ms);
+public:
+    /**
+    * write audio/video packet, the payload is referenced by fragment
+    * to write to mdat without copy.
+    * @remark assert data is not NULL.
+    * @remark the data is owned by encoder, user should never free it,
+    *       even if error, which is freed by srs_freepa.
+    */
+    virtual int write_audio(int64_t timestamp, char* data, int size);
+    virtual int write_video(int64_t timestamp, char* data, int size);
+    /**
+    * write the samples of current fragment, when stream end.
+    */
+    virtual int flush();
+private:
+    /**
+    * write the packet to current fragment.
+    * @param preferenced output whether the data is referenced by fragment.
+    */
+    virtual int do_write_audio(int64_t timestamp, char* data, int size, bool* preferenced);
+    virtual int do_write_video(int64_t timestamp, char* data, int size, bool* preferenced);
+    /**
+    * clear the samples of current fragment and free the packets.
+    */
+    virtual void clear_fragment();
+    /**
+    * write the init segment, the ftyp and moov.
+    */
+    virtual int write_init();
+    /**
+    * write the current fragment, the moof and mdat.
+    * @param next_video_dts the dts of next video sample, for the duration
+    *       of last video sample, -1 when unknown.
+    * @param next_audio_dts the dts of next audio sample, -1 when unknown.
+    */
+    virtual int write_fragment(int64_t next_video_dts, int64_t next_audio_dts);
+    /**
+    * write the trak of video or audio to moov.
+    */
+    virtual void write_trak(SrsSimpleBuffer* buf, bool video);
+    /**
+    * write the traf of video or audio to moof.
+    * @param next_dts the dts of next sample of this track, -1 when unknown.
+    * @param pdata_offset output the offset of data_offset in buf, to patch.
+    */
+    virtual void write_traf(SrsSimpleBuffer* buf, bool video, int64_t next_dts, int* pdata_offset);
+};
+
+#endif
+
+#endif
+
 // following is generated by src/kernel/srs_kernel_buffer.hpp
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -4967,7 +6578,7 @@ public:
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -5371,6 +6982,10 @@ public:
     * @remark user should never free the returned value, copy it if needed.
     */
     virtual SrsAmf0Any* ensure_property_number(std::string name);
+    /**
+     * remove the property specified by name.
+     */
+    virtual void remove(std::string name);
 };
 
 /**
@@ -5526,6 +7141,68 @@ public:
     static int any(SrsAmf0Any* o);
 };
 
+/**
+* the pre-serialized amf0 image, which contains some number or string fields,
+* the constant parts are encoded once when build the template,
+* and the fields are patched into the image when write.
+* for example, the connect command of client:
+*       "connect", [number], {app: [string], flashVer: "WIN 15,0,0,239", ...}
+* where the [number] and [string] are fields, others are constant parts.
+*/
+class SrsAmf0Template
+{
+private:
+    /**
+    * the marker of fields, RTMP_AMF0_Number or RTMP_AMF0_String.
+    */
+    std::vector<char> fields;
+    /**
+    * the constant parts, the size always equals to fields.size() + 1,
+    * for the image is: part[0], field[0], part[1], ..., field[n-1], part[n].
+    */
+    std::vector<std::string> parts;
+public:
+    SrsAmf0Template();
+    virtual ~SrsAmf0Template();
+// build the template.
+public:
+    /**
+    * append a constant amf0 value to image.
+    * @remark the template will free the value, user should never use it.
+    */
+    virtual int append(SrsAmf0Any* value);
+    /**
+    * append the object marker, the object property name and the object EOF,
+    * use to build the object which contains fields.
+    */
+    virtual void append_object_start();
+    virtual void append_property_name(std::string name);
+    virtual void append_object_eof();
+    /**
+    * append a number or string field to image.
+    */
+    virtual void append_number_field();
+    virtual void append_string_field();
+// write the image with fields.
+public:
+    /**
+    * get the number of number fields and string fields.
+    */
+    virtual int nb_numbers();
+    virtual int nb_strings();
+    /**
+    * get the size of image, when patched with the string fields.
+    * @param strings, the value of string fields, nb_strings() values.
+    */
+    virtual int total_size(std::string* strings);
+    /**
+    * write the image to stream, patch the fields in order.
+    * @param numbers, the value of number fields, nb_numbers() values.
+    * @param strings, the value of string fields, nb_strings() values.
+    */
+    virtual int write(SrsStream* stream, double* numbers, std::string* strings);
+};
+
 /**
 * read anything from stream.
 * @param ppvalue, the output amf0 any elem.
@@ -5661,7 +7338,7 @@ namespace _srs_internal
     * 2.13 Date Type
     * time-zone = S16 ; reserved, not supported should be set to 0x0000
     * date-type = date-marker DOUBLE time-zone
-    * @see: https://github.com/simple-rtmp-server/srs/issues/185
+    * @see: https://github.com/ossrs/srs/issues/185
     */
     class SrsAmf0Date : public SrsAmf0Any
     {
@@ -5769,6 +7446,7 @@ namespace _srs_internal
         virtual SrsAmf0Any* get_property(std::string name);
         virtual SrsAmf0Any* ensure_property_string(std::string name);
         virtual SrsAmf0Any* ensure_property_number(std::string name);
+        virtual void remove(std::string name);
     public:
         virtual void copy(SrsUnSortedHashtable* src);
     };
@@ -5812,7 +7490,7 @@ namespace _srs_internal
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -5841,7 +7519,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 //#include <srs_core.hpp>
 
-// for srs-librtmp, @see https://github.com/simple-rtmp-server/srs/issues/213
+// for srs-librtmp, @see https://github.com/ossrs/srs/issues/213
 #ifndef _WIN32
 #include <sys/uio.h>
 #endif
@@ -5997,7 +7675,7 @@ public:
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -6030,7 +7708,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <vector>
 #include <string>
 
-// for srs-librtmp, @see https://github.com/simple-rtmp-server/srs/issues/213
+// for srs-librtmp, @see https://github.com/ossrs/srs/issues/213
 #ifndef _WIN32
 #include <sys/uio.h>
 #endif
@@ -6061,9 +7739,11 @@ class SrsFMLEStartPacket;
 class SrsPublishPacket;
 class SrsOnMetaDataPacket;
 class SrsPlayPacket;
+class SrsTemplateCommandPacket;
 class SrsCommonMessage;
 class SrsPacket;
 class SrsAmf0Object;
+class SrsAmf0Template;
 class IMergeReadHandler;
 
 /****************************************************************************
@@ -6212,7 +7892,7 @@ private:
     /**
     * cache some frequently used chunk header.
     * cs_cache, the chunk stream cache.
-    * @see https://github.com/simple-rtmp-server/srs/issues/249
+    * @see https://github.com/ossrs/srs/issues/249
     */
     SrsChunkStream** cs_cache;
     /**
@@ -6230,7 +7910,7 @@ private:
     /**
     * whether auto response when recv messages.
     * default to true for it's very easy to use the protocol stack.
-    * @see: https://github.com/simple-rtmp-server/srs/issues/217
+    * @see: https://github.com/ossrs/srs/issues/217
     */
     bool auto_response_when_recv;
     /**
@@ -6268,7 +7948,7 @@ public:
     /**
     * set the auto response message when recv for protocol stack.
     * @param v, whether auto response message when recv message.
-    * @see: https://github.com/simple-rtmp-server/srs/issues/217
+    * @see: https://github.com/ossrs/srs/issues/217
     */
     virtual void set_auto_response(bool v);
     /**
@@ -6286,7 +7966,7 @@ public:
     * that is, we merge some data to read together.
     * @param v true to ename merged read.
     * @param handler the handler when merge read is enabled.
-    * @see https://github.com/simple-rtmp-server/srs/issues/241
+    * @see https://github.com/ossrs/srs/issues/241
     */
     virtual void set_merge_read(bool v, IMergeReadHandler* handler);
     /**
@@ -6294,7 +7974,7 @@ public:
     * @param buffer the size of buffer.
     * @remark when MR(SRS_PERF_MERGED_READ) disabled, always set to 8K.
     * @remark when buffer changed, the previous ptr maybe invalid.
-    * @see https://github.com/simple-rtmp-server/srs/issues/241
+    * @see https://github.com/ossrs/srs/issues/241
     */
     virtual void set_recv_buffer(int buffer_size);
 #endif
@@ -6359,6 +8039,18 @@ public:
     * @param stream_id, the stream id of packet to send over, 0 for control message.
     */
     virtual int send_and_free_packet(SrsPacket* packet, int stream_id);
+    /**
+    * send the RTMP packets in one writev and always free them,
+    * for example, the client pipelines the commands without waiting for responses.
+    * user must never free or use the packets after this method,
+    * for it will always free the packets.
+    * @param packets, the packets to send out, never be NULL.
+    * @param stream_ids, the stream id of each packet to send over, 0 for control message.
+    * @param nb_packets, the size of packets and stream_ids.
+    * @remark the chunk size is applied after all packets sent, so the
+    *       set chunk size packet should be the last one.
+    */
+    virtual int send_and_free_packets(SrsPacket** packets, int* stream_ids, int nb_packets);
 public:
     /**
      * expect a specified message, drop others util got specified one.
@@ -6559,12 +8251,12 @@ public:
     std::string stream;
     // for play live stream,
     // used to specified the stop when exceed the duration.
-    // @see https://github.com/simple-rtmp-server/srs/issues/45
+    // @see https://github.com/ossrs/srs/issues/45
     // in ms.
     double duration;
     // the token in the connect request,
     // used for edge traverse to origin authentication,
-    // @see https://github.com/simple-rtmp-server/srs/issues/104
+    // @see https://github.com/ossrs/srs/issues/104
     SrsAmf0Object* args;
 public:
     SrsRequest();
@@ -6618,6 +8310,7 @@ enum SrsRtmpConnType
     SrsRtmpConnFlashPublish,
 };
 std::string srs_client_type_string(SrsRtmpConnType type);
+bool srs_client_type_is_publish(SrsRtmpConnType type);
 
 /**
  * store the handshake bytes,
@@ -6774,6 +8467,39 @@ public:
      *       connect-app => FMLE publish
      */
     virtual int fmle_publish(std::string stream, int& stream_id);
+    /**
+     * pipelined session start, send the connect, createStream and play in
+     * one writev without waiting for each response, then validate the
+     * responses in order. the stream id of play is guessed to 1, which is
+     * the first stream of connection.
+     * @return ERROR_RTMP_PIPELINE_STREAM_ID when server returns another stream id,
+     *       the play is sent on the wrong stream, so user should reconnect and
+     *       use the connect_app then play, never play again on this connection.
+     * @remark the srs debug info of connect response is ignored.
+     */
+    virtual int pipeline_play(
+        std::string app, std::string tc_url, SrsRequest* req, bool debug_srs_upnode,
+        std::string stream, int& stream_id
+    );
+    /**
+     * pipelined session start, send the connect and FMLE publish in one writev,
+     * @see pipeline_play.
+     */
+    virtual int pipeline_publish(
+        std::string app, std::string tc_url, SrsRequest* req, bool debug_srs_upnode,
+        std::string stream, int& stream_id
+    );
+private:
+    /**
+     * create the connect packet, use the swfUrl/pageUrl/tcUrl/args of req if specified.
+     */
+    virtual SrsTemplateCommandPacket* create_connect_app_packet(
+        std::string app, std::string tc_url, SrsRequest* req, bool debug_srs_upnode
+    );
+    /**
+     * expect the createStream _result, output the stream id.
+     */
+    virtual int expect_create_stream_result(int& stream_id);
 public:
     /**
      * expect a specified message, drop others util got specified one.
@@ -6818,7 +8544,7 @@ public:
     /**
      * set the auto response message when recv for protocol stack.
      * @param v, whether auto response message when recv message.
-     * @see: https://github.com/simple-rtmp-server/srs/issues/217
+     * @see: https://github.com/ossrs/srs/issues/217
      */
     virtual void set_auto_response(bool v);
 #ifdef SRS_PERF_MERGED_READ
@@ -6828,7 +8554,7 @@ public:
      * that is, we merge some data to read together.
      * @param v true to ename merged read.
      * @param handler the handler when merge read is enabled.
-     * @see https://github.com/simple-rtmp-server/srs/issues/241
+     * @see https://github.com/ossrs/srs/issues/241
      */
     virtual void set_merge_read(bool v, IMergeReadHandler* handler);
     /**
@@ -6836,7 +8562,7 @@ public:
      * @param buffer the size of buffer.
      * @remark when MR(SRS_PERF_MERGED_READ) disabled, always set to 8K.
      * @remark when buffer changed, the previous ptr maybe invalid.
-     * @see https://github.com/simple-rtmp-server/srs/issues/241
+     * @see https://github.com/ossrs/srs/issues/241
      */
     virtual void set_recv_buffer(int buffer_size);
 #endif
@@ -6891,7 +8617,7 @@ public:
      * @param stream_id, the stream id of packet to send over, 0 for control message.
      *
      * @remark performance issue, to support 6k+ 250kbps client,
-     *       @see https://github.com/simple-rtmp-server/srs/issues/194
+     *       @see https://github.com/ossrs/srs/issues/194
      */
     virtual int send_and_free_messages(SrsSharedPtrMessage** msgs, int nb_msgs, int stream_id);
     /**
@@ -7096,6 +8822,78 @@ protected:
     virtual int encode_packet(SrsStream* stream);
 };
 
+/**
+* the client command packet, encoded from the pre-serialized amf0 template,
+* which is built once for the command, and only the transaction id and the
+* variable strings(app, tcUrl, stream name etc.) are patched in when encode.
+* @remark only for client to send the connect/createStream/play/publish etc,
+*       the server never decode it, use the concrete packets to decode.
+*/
+class SrsTemplateCommandPacket : public SrsPacket
+{
+public:
+    /**
+    * Name of the command, for the protocol to track the response.
+    */
+    std::string command_name;
+    /**
+    * Transaction ID of the command, 0 when no response.
+    */
+    double transaction_id;
+    /**
+    * the value of string fields of template, in order.
+    */
+    std::vector<std::string> strings;
+    /**
+    * Any optional information, encode after the template.
+    * @remark, optional, user must set it to NULL when not exists.
+    */
+    SrsAmf0Object* args;
+private:
+    // the shared template, never free it.
+    SrsAmf0Template* tmpl;
+    int prefer_cid;
+private:
+    SrsTemplateCommandPacket(SrsAmf0Template* t, std::string name, double tid, int cid);
+public:
+    virtual ~SrsTemplateCommandPacket();
+public:
+    /**
+    * create the connect app command, the same to SrsConnectAppPacket,
+    * with object(app, flashVer, swfUrl, tcUrl, fpad, capabilities, audioCodecs,
+    * videoCodecs, videoFunction, pageUrl, objectEncoding).
+    * @param args the optional args, the packet will free it, NULL to ignore.
+    */
+    static SrsTemplateCommandPacket* create_connect_app(
+        std::string app, std::string tc_url, std::string swf_url, std::string page_url,
+        SrsAmf0Object* args
+    );
+    /**
+    * create the createStream command, the same to SrsCreateStreamPacket.
+    */
+    static SrsTemplateCommandPacket* create_create_stream(double transaction_id);
+    /**
+    * create the play command, the same to SrsPlayPacket without start/duration/reset.
+    */
+    static SrsTemplateCommandPacket* create_play(std::string stream);
+    /**
+    * create the publish command, the same to SrsPublishPacket with type live.
+    */
+    static SrsTemplateCommandPacket* create_publish(std::string stream);
+    /**
+    * create the FMLE start commands, the same to SrsFMLEStartPacket.
+    */
+    static SrsTemplateCommandPacket* create_release_stream(std::string stream);
+    static SrsTemplateCommandPacket* create_FC_publish(std::string stream);
+// encode functions for concrete packet to override.
+public:
+    virtual int get_prefer_cid();
+    virtual int get_message_type();
+protected:
+    virtual int get_size();
+    virtual int encode_packet(SrsStream* stream);
+};
+
 /**
 * 4.1.2. Call
 * The call method of the NetConnection object runs remote procedure
@@ -7752,13 +9550,13 @@ public:
     std::string command_name;
     /**
     * whether allow access the sample of video.
-    * @see: https://github.com/simple-rtmp-server/srs/issues/49
+    * @see: https://github.com/ossrs/srs/issues/49
     * @see: http://help.adobe.com/en_US/FlashPlatform/reference/actionscript/3/flash/net/NetStream.html#videoSampleAccess
     */
     bool video_sample_access;
     /**
     * whether allow access the sample of audio.
-    * @see: https://github.com/simple-rtmp-server/srs/issues/49
+    * @see: https://github.com/ossrs/srs/issues/49
     * @see: http://help.adobe.com/en_US/FlashPlatform/reference/actionscript/3/flash/net/NetStream.html#audioSampleAccess
     */
     bool audio_sample_access;
@@ -8053,7 +9851,7 @@ protected:
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -8600,7 +10398,7 @@ public:
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -8628,7 +10426,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 //#include <srs_core.hpp>
 
-// for srs-librtmp, @see https://github.com/simple-rtmp-server/srs/issues/213
+// for srs-librtmp, @see https://github.com/ossrs/srs/issues/213
 #ifndef _WIN32
 #include <sys/uio.h>
 #endif
@@ -8714,7 +10512,7 @@ extern int srs_write_large_iovs(ISrsProtocolReaderWriter* skt, iovec* iovs, int
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -8791,7 +10589,7 @@ private:
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -8829,7 +10627,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 * to improve read performance, merge some packets then read,
 * when it on and read small bytes, we sleep to wait more data.,
 * that is, we merge some data to read together.
-* @see https://github.com/simple-rtmp-server/srs/issues/241
+* @see https://github.com/ossrs/srs/issues/241
 */
 class IMergeReadHandler
 {
@@ -8867,7 +10665,7 @@ private:
 #endif
     // the user-space buffer to fill by reader,
     // which use fast index and reset when chunk body read ok.
-    // @see https://github.com/simple-rtmp-server/srs/issues/248
+    // @see https://github.com/ossrs/srs/issues/248
     // ptr to the current read position.
     char* p;
     // ptr to the content end.
@@ -8896,7 +10694,7 @@ public:
     * @param buffer the size of buffer. ignore when smaller than SRS_MAX_SOCKET_BUFFER.
     * @remark when MR(SRS_PERF_MERGED_READ) disabled, always set to 8K.
     * @remark when buffer changed, the previous ptr maybe invalid.
-    * @see https://github.com/simple-rtmp-server/srs/issues/241
+    * @see https://github.com/ossrs/srs/issues/241
     */
     virtual void set_buffer(int buffer_size);
 public:
@@ -8937,7 +10735,7 @@ public:
     * that is, we merge some data to read together.
     * @param v true to ename merged read.
     * @param handler the handler when merge read is enabled.
-    * @see https://github.com/simple-rtmp-server/srs/issues/241
+    * @see https://github.com/ossrs/srs/issues/241
     * @remark the merged read is optional, ignore if not specifies.
     */
     virtual void set_merge_read(bool v, IMergeReadHandler* handler);
@@ -8949,7 +10747,7 @@ public:
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -9036,6 +10834,41 @@ public:
     virtual int mux_avc2flv(std::string video, int8_t frame_type, int8_t avc_packet_type, u_int32_t dts, u_int32_t pts, char** flv, int* nb_flv);
 };
 
+/**
+* the raw h.265 stream, in annexb.
+* @remark the annexb demux and the ibmf NALU are the same as h.264,
+*       use the SrsRawH264Stream for them.
+*/
+class SrsRawHEVCStream
+{
+public:
+    SrsRawHEVCStream();
+    virtual ~SrsRawHEVCStream();
+public:
+    /**
+    * whether the frame is vps, sps or pps.
+    */
+    virtual bool is_vps(char* frame, int nb_frame);
+    virtual bool is_sps(char* frame, int nb_frame);
+    virtual bool is_pps(char* frame, int nb_frame);
+public:
+    /**
+    * mux the vps/sps/pps to the HEVCDecoderConfigurationRecord,
+    * the profile, level and format are parsed from the sps.
+    * @param sh output the sequence header.
+    */
+    virtual int mux_sequence_header(std::string vps, std::string sps, std::string pps, std::string& sh);
+    /**
+    * mux the hevc video packet to flv video packet, in enhanced RTMP.
+    * @param frame_type, SrsCodecVideoAVCFrameKeyFrame or SrsCodecVideoAVCFrameInterFrame.
+    * @param packet_type, SrsCodecVideoExPacketTypeSequenceStart or SrsCodecVideoExPacketTypeCodedFrames.
+    * @param video the h.265 raw data.
+    * @param flv output the muxed flv packet.
+    * @param nb_flv output the muxed flv size.
+    */
+    virtual int mux_hevc2flv(std::string video, int8_t frame_type, int8_t packet_type, u_int32_t dts, u_int32_t pts, char** flv, int* nb_flv);
+};
+
 /**
 * the header of adts sample.
 */
@@ -9094,7 +10927,7 @@ public:
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -9123,6 +10956,8 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 //#include <srs_core.hpp>
 
+#if !defined(SRS_EXPORT_LIBRTMP)
+
 #include <string>
 #include <sstream>
 
@@ -9807,11 +11642,13 @@ private:
 
 #endif
 
+#endif
+
 // following is generated by src/protocol/srs_http_stack.hpp
 /*
  The MIT License (MIT)
  
- Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+ Copyright (c) 2013-2015 SRS(ossrs)
  
  Permission is hereby granted, free of charge, to any person obtaining a copy of
  this software and associated documentation files (the "Software"), to deal in
@@ -9835,15 +11672,17 @@ private:
 #define SRS_PROTOCOL_HTTP_HPP
 
 /*
- //#include <srs_http_stack.hpp>
- */
+//#include <srs_http_stack.hpp>
+*/
 //#include <srs_core.hpp>
 
+#if !defined(SRS_EXPORT_LIBRTMP)
+
 #include <map>
 #include <string>
 #include <vector>
 
-// for srs-librtmp, @see https://github.com/simple-rtmp-server/srs/issues/213
+// for srs-librtmp, @see https://github.com/ossrs/srs/issues/213
 #ifndef _WIN32
 #include <sys/uio.h>
 #endif
@@ -9886,8 +11725,19 @@ class ISrsHttpResponseWriter;
 #define SRS_CONSTS_HTTP_PUT HTTP_PUT
 #define SRS_CONSTS_HTTP_DELETE HTTP_DELETE
 
-// helper function: response in json format.
-extern int srs_http_response_json(ISrsHttpResponseWriter* w, std::string data);
+// Error replies to the request with the specified error message and HTTP code.
+// The error message should be plain text.
+extern int srs_go_http_error(ISrsHttpResponseWriter* w, int code);
+extern int srs_go_http_error(ISrsHttpResponseWriter* w, int code, std::string error);
+
+/**
+ * send the file bytes [offset, offset + size) of in_fd to out_fd by sendfile,
+ * or by splice when sendfile not work, without copy to user space.
+ * @param pnwrite the output nb_write, NULL to ignore.
+ * @remark wait for out_fd writable when it's nonblocking.
+ * @return ERROR_HTTP_ZERO_COPY_UNSUPPORTED when not supported by system.
+ */
+extern int srs_sendfile(int out_fd, int in_fd, int64_t offset, int64_t size, int64_t* pnwrite);
 
 // get the status text of code.
 extern std::string srs_generate_http_status_text(int status);
@@ -10005,7 +11855,7 @@ public:
     virtual int write(char* data, int size) = 0;
     /**
      * for the HTTP FLV, to writev to improve performance.
-     * @see https://github.com/simple-rtmp-server/srs/issues/405
+     * @see https://github.com/ossrs/srs/issues/405
      */
     virtual int writev(iovec* iov, int iovcnt, ssize_t* pnwrite) = 0;
     
@@ -10016,6 +11866,18 @@ public:
     // send error codes.
     // @remark, user must set header then write or write_header.
     virtual void write_header(int code) = 0;
+    
+    /**
+     * write the file bytes [offset, offset + size) from fd to peer without
+     * copy to user space, for example, by sendfile or splice.
+     * the header is sent before the bytes when not sent yet.
+     * @param pnwrite the output nb_write, NULL to ignore.
+     * @return ERROR_HTTP_ZERO_COPY_UNSUPPORTED when the writer not support
+     *       zero copy, user should use write instead.
+     * @remark the default implements is not supported, the writer over
+     *       socket can use srs_sendfile to implement it.
+     */
+    virtual int sendfile(int fd, int64_t offset, int64_t size, int64_t* pnwrite);
 };
 
 /**
@@ -10112,20 +11974,24 @@ private:
 protected:
     /**
      * when access flv file with x.flv?start=xxx
+     * the flv header and sequence headers are prepended to the data from offset.
+     * @remark serve the whole file when no sequence header in flv.
      */
-    virtual int serve_flv_stream(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath, int offset);
+    virtual int serve_flv_stream(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath, int64_t offset);
     /**
-     * when access mp4 file with x.mp4?range=start-end
-     * @param start the start offset in bytes.
-     * @param end the end offset in bytes. -1 to end of file.
+     * when access mp4 file with x.mp4?range=start-end or the Range header,
+     * response 206 Partial Content with the Content-Range header.
+     * @param start the start offset in bytes, -1 for the suffix range.
+     * @param end the end offset in bytes. -1 to end of file,
+     *       or the length of the last bytes for the suffix range.
      * @remark response data in [start, end].
      */
-    virtual int serve_mp4_stream(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath, int start, int end);
+    virtual int serve_mp4_stream(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath, int64_t start, int64_t end);
 protected:
     /**
      * copy the fs to response writer in size bytes.
      */
-    virtual int copy(ISrsHttpResponseWriter* w, SrsFileReader* fs, ISrsHttpMessage* r, int size);
+    virtual int copy(ISrsHttpResponseWriter* w, SrsFileReader* fs, ISrsHttpMessage* r, int64_t size);
 };
 
 // the mux entry for server mux.
@@ -10297,7 +12163,16 @@ public:
     virtual std::string url() = 0;
     virtual std::string host() = 0;
     virtual std::string path() = 0;
+    virtual std::string query() = 0;
     virtual std::string ext() = 0;
+    /**
+     * get the RESTful id,
+     * for example, pattern is /api/v1/streams, path is /api/v1/streams/100,
+     * then the rest id is 100.
+     * @param pattern the handler pattern which will serve the request.
+     * @return the REST id; -1 if not matched.
+     */
+    virtual int parse_rest_id(std::string pattern) = 0;
 public:
     /**
      * read body to string.
@@ -10326,14 +12201,22 @@ public:
     virtual int request_header_count() = 0;
     virtual std::string request_header_key_at(int index) = 0;
     virtual std::string request_header_value_at(int index) = 0;
+public:
+    /**
+     * whether the current request is JSONP,
+     * which has a "callback=xxx" in QueryString.
+     */
+    virtual bool is_jsonp() = 0;
 };
 
+#endif
+
 #endif
 // following is generated by src/protocol/srs_protocol_kbps.hpp
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -10571,7 +12454,7 @@ public:
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -10611,7 +12494,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 * Windows SRS-LIBRTMP pre-declare
 **************************************************************
 *************************************************************/
-// for srs-librtmp, @see https://github.com/simple-rtmp-server/srs/issues/213
+// for srs-librtmp, @see https://github.com/ossrs/srs/issues/213
 #ifdef _WIN32
     // include windows first.
     #include <windows.h>
@@ -10680,6 +12563,8 @@ extern srs_rtmp_t srs_rtmp_create2(const char* url);
 /**
 * close and destroy the rtmp stack.
 * @remark, user should never use the rtmp again.
+* @remark, the packed packets of aggregate are flushed in best effort, the
+*       error is ignored, use srs_rtmp_flush_aggregate before to check it.
 */
 extern void srs_rtmp_destroy(srs_rtmp_t rtmp);
 
@@ -10775,6 +12660,39 @@ extern int srs_rtmp_play_stream(srs_rtmp_t rtmp);
 */
 extern int srs_rtmp_publish_stream(srs_rtmp_t rtmp);
 
+/**
+* pipelined session start, which send the connect, createStream and play
+* in one write without waiting for each response, then validate the
+* responses in order, to save two or three round trips for long RTT links.
+* category: play
+* previous: handshake
+* next: destroy
+* @remark it equals to srs_rtmp_connect_app then srs_rtmp_play_stream,
+*       but the srs debug info of connect response is ignored.
+* @remark the stream id is guessed to 1, when server returns another one,
+*       it fails and srs_rtmp_is_pipeline_stream_error is true, user should
+*       destroy it and reconnect without pipeline.
+* @return 0, success; otherwise, failed.
+*/
+extern int srs_rtmp_pipeline_play_stream(srs_rtmp_t rtmp);
+
+/**
+* pipelined session start, which send the connect and publish commands
+* in one write, @see srs_rtmp_pipeline_play_stream.
+* category: publish
+* previous: handshake
+* next: destroy
+* @remark it equals to srs_rtmp_connect_app then srs_rtmp_publish_stream.
+* @return 0, success; otherwise, failed.
+*/
+extern int srs_rtmp_pipeline_publish_stream(srs_rtmp_t rtmp);
+/**
+* whether the pipelined session failed for the stream id is not the guessed
+* one, the play or publish is sent on the wrong stream, so user should
+* reconnect and use srs_rtmp_connect_app then play or publish.
+*/
+extern srs_bool srs_rtmp_is_pipeline_stream_error(int error_code);
+
 /**
 * do bandwidth check with srs server.
 * 
@@ -10835,6 +12753,42 @@ extern int srs_rtmp_write_packet(srs_rtmp_t rtmp,
     char type, u_int32_t timestamp, char* data, int size
 );
 
+/**
+* pack the audio/video packets to RTMP aggregate message when publish,
+* to reduce the message header and chunk overhead, the aggregate is sent
+* once the packed packets reach the size or duration, or write other packets,
+* so a packet is delayed at most max_duration ms.
+* @param max_size, the max payload size of aggregate in bytes, 0 to disable,
+*       the packet larger than it is sent directly.
+* @param max_duration, the max duration of aggregate in ms, 0 to send the
+*       aggregate of each packet immediately, without any latency.
+* @remark srs_rtmp_destroy sends the packed packets in best effort, user should
+*       call srs_rtmp_flush_aggregate before destroy to get the error, and for
+*       the latency of live stream, keep the duration small.
+*
+* @return 0, success; otherswise, failed.
+*/
+extern int srs_rtmp_set_aggregate(srs_rtmp_t rtmp, int max_size, int max_duration);
+/**
+* send the packed audio/video packets in aggregate message.
+*
+* @return 0, success; otherswise, failed.
+*/
+extern int srs_rtmp_flush_aggregate(srs_rtmp_t rtmp);
+
+/**
+* read a audio/video/script-data packet from rtmp stream, without copy.
+* the params are the same to srs_rtmp_read_packet, but the data is owned by
+* the library and valid until the next read or destroy, the sub messages of
+* aggregate message are the views of the aggregate payload.
+* @remark: for read, user must never free the data, copy it when need to keep it.
+*
+* @return 0, success; otherswise, failed.
+*/
+extern int srs_rtmp_read_packet2(srs_rtmp_t rtmp, 
+    char* type, u_int32_t* timestamp, char** data, int* size
+);
+
 /**
 * whether type is script data and the data is onMetaData.
 */
@@ -10891,7 +12845,7 @@ extern srs_bool srs_rtmp_is_onMetaData(char type, char* data, int size);
 * @remark for aac, only support profile 1-4, AAC main/LC/SSR/LTP,
 *       @see aac-mp4a-format-ISO_IEC_14496-3+2001.pdf, page 23, 1.5.1.1 Audio object type
 *
-* @see https://github.com/simple-rtmp-server/srs/issues/212
+* @see https://github.com/ossrs/srs/issues/212
 * @see E.4.2.1 AUDIODATA of video_file_format_spec_v10_1.pdf
 * 
 * @return 0, success; otherswise, failed.
@@ -10947,7 +12901,7 @@ extern int srs_aac_adts_frame_size(char* aac_raw_data, int ac_raw_size);
 * @remark, cts = pts - dts
 * @remark, use srs_h264_startswith_annexb to check whether frame is annexb format.
 * @example /trunk/research/librtmp/srs_h264_raw_publish.c
-* @see https://github.com/simple-rtmp-server/srs/issues/66
+* @see https://github.com/ossrs/srs/issues/66
 * 
 * @return 0, success; otherswise, failed.
 *       for dvbsp error, @see srs_h264_is_dvbsp_error().
@@ -10989,7 +12943,7 @@ extern int srs_h264_write_raw_frames(srs_rtmp_t rtmp,
 /**
 * whether error_code is dvbsp(drop video before sps/pps/sequence-header) error.
 *
-* @see https://github.com/simple-rtmp-server/srs/issues/203
+* @see https://github.com/ossrs/srs/issues/203
 * @example /trunk/research/librtmp/srs_h264_raw_publish.c
 * @remark why drop video?
 *       some encoder, for example, ipcamera, will send sps/pps before each IFrame,
@@ -11000,14 +12954,14 @@ extern srs_bool srs_h264_is_dvbsp_error(int error_code);
 /**
 * whether error_code is duplicated sps error.
 * 
-* @see https://github.com/simple-rtmp-server/srs/issues/204
+* @see https://github.com/ossrs/srs/issues/204
 * @example /trunk/research/librtmp/srs_h264_raw_publish.c
 */
 extern srs_bool srs_h264_is_duplicated_sps_error(int error_code);
 /**
 * whether error_code is duplicated pps error.
 * 
-* @see https://github.com/simple-rtmp-server/srs/issues/204
+* @see https://github.com/ossrs/srs/issues/204
 * @example /trunk/research/librtmp/srs_h264_raw_publish.c
 */
 extern srs_bool srs_h264_is_duplicated_pps_error(int error_code);
@@ -11029,6 +12983,94 @@ extern srs_bool srs_h264_startswith_annexb(
     int* pnb_start_code
 );
 
+/*************************************************************
+**************************************************************
+* h265 raw codec
+**************************************************************
+*************************************************************/
+/**
+* write h.265 raw frame over RTMP to rtmp server, in enhanced RTMP,
+* that is, the video tag with the FourCC 'hvc1'.
+* @param frames the input h265 raw data, encoded h.265 I/P/B frames data.
+*       frames can be one or more than one frame,
+*       each frame prefixed annexb header, by N[00] 00 00 01, where N>=0, 
+*       for instance, frame = header(00 00 00 01) + payload(40 01 0C 01 FF FF ...)
+* @param frames_size the size of h265 raw data. 
+*       assert frames_size > 0, at least has 1 bytes header.
+* @param dts the dts of h.265 raw data.
+* @param pts the pts of h.265 raw data.
+* 
+* @remark, user should free the frames.
+* @remark, the tbn of dts/pts is 1/1000 for RTMP, that is, in ms.
+* @remark, the vps, sps and pps are muxed to HEVCDecoderConfigurationRecord,
+*       sent before the first frame, or the next frame when any changed.
+* @remark, the IRAP(BLA/IDR/CRA) frame is keyframe.
+* @example /trunk/research/librtmp/srs_h265_raw_publish.c
+* @see https://github.com/veovera/enhanced-rtmp
+* 
+* @return 0, success; otherswise, failed.
+*       for dvbsp error, @see srs_h265_is_dvbsp_error().
+*       for duplictated vps error, @see srs_h265_is_duplicated_vps_error().
+*       for duplictated sps error, @see srs_h265_is_duplicated_sps_error().
+*       for duplictated pps error, @see srs_h265_is_duplicated_pps_error().
+*/
+extern int srs_h265_write_raw_frames(srs_rtmp_t rtmp, 
+    char* frames, int frames_size, u_int32_t dts, u_int32_t pts
+);
+/**
+* whether error_code is dvbsp(drop video before vps/sps/pps/sequence-header) error.
+* @see srs_h264_is_dvbsp_error
+* @example /trunk/research/librtmp/srs_h265_raw_publish.c
+*/
+extern srs_bool srs_h265_is_dvbsp_error(int error_code);
+/**
+* whether error_code is duplicated vps error.
+* @example /trunk/research/librtmp/srs_h265_raw_publish.c
+*/
+extern srs_bool srs_h265_is_duplicated_vps_error(int error_code);
+/**
+* whether error_code is duplicated sps error.
+* @example /trunk/research/librtmp/srs_h265_raw_publish.c
+*/
+extern srs_bool srs_h265_is_duplicated_sps_error(int error_code);
+/**
+* whether error_code is duplicated pps error.
+* @example /trunk/research/librtmp/srs_h265_raw_publish.c
+*/
+extern srs_bool srs_h265_is_duplicated_pps_error(int error_code);
+
+/*************************************************************
+**************************************************************
+* ts ingest
+**************************************************************
+*************************************************************/
+/**
+* write the ts bytes over RTMP to rtmp server, the h.264/h.265 and aac in ts
+* are published, for example, to ingest the udp or file ts to RTMP.
+* the PES is reassembled from ts packets, the annexb NALUs and aac
+* ADTS frames are demuxed from PES in place, the timestamp in 90khz is
+* converted to ms, and the video sequence header and aac sequence header
+* are sent before the first frame, the h.265 is sent in enhanced RTMP.
+* @param data, the ts bytes, for example, a udp datagram of 7 ts packets,
+*       or any block of ts file, the partial ts packet at the end is kept
+*       util the next write completes it.
+* @param size, the size of ts bytes.
+*
+* @remark, user should free the data.
+* @remark, only the first video and the first aac stream is published,
+*       for the ts of multiple programs, the others are ignored.
+* @remark, the video before the first sps/pps(and vps for h.265) is dropped.
+* @remark, the ts must be written in realtime, it is not paced by the library.
+* @remark, the corrupt ts is recoverable, the bytes before the sync byte are
+*       skipped, and the PES of bad packet or codec data is dropped with a
+*       warning, then the ingest continues from the next PES.
+* @example /trunk/research/librtmp/srs_ingest_ts.c
+*
+* @return 0, success; otherswise, the fatal error of system or RTMP, for
+*       example, write to server failed, user should stop the ingest.
+*/
+extern int srs_rtmp_write_ts(srs_rtmp_t rtmp, char* data, int size);
+
 /*************************************************************
 **************************************************************
 * flv codec
@@ -11042,7 +13084,43 @@ typedef void* srs_flv_t;
 /* open flv file for both read/write. */
 extern srs_flv_t srs_flv_open_read(const char* file);
 extern srs_flv_t srs_flv_open_write(const char* file);
-extern void srs_flv_close(srs_flv_t flv);
+/**
+* open flv file for write with O_DIRECT to bypass the page cache,
+* the tags are written in aligned blocks by the write buffer.
+* @remark use the page cache when O_DIRECT not supported.
+*/
+extern srs_flv_t srs_flv_open_write_direct(const char* file);
+/**
+* open flv file for write in async mode, the tags are copied to buffers
+* and written by the shared write threads, so the disk stall never
+* blocks the caller, for example, the rtmp recorder.
+* @param max_inflight, the max buffers(64KB each) to write, 
+*       the backpressure when exceed.
+* @param nonblocking, when exceed, whether srs_flv_write_tag fails 
+*       with error srs_flv_is_busy(), otherwise blocks util written.
+* @remark the srs_flv_close waits for all buffers written.
+* @remark use sync writer for windows.
+*/
+extern srs_flv_t srs_flv_open_write_async(const char* file, int max_inflight, srs_bool nonblocking);
+/**
+* get the inflight buffers of async writer, to detect the disk stall.
+* @return the count of buffers, 0 for sync writer.
+*/
+extern int srs_flv_write_inflight(srs_flv_t flv);
+/**
+* close the flv file, write the buffered tags for writer.
+* @return the error of writing the buffered tags, 0 for reader.
+* @remark the flv is always free, even if error.
+*/
+extern int srs_flv_close(srs_flv_t flv);
+/**
+* open flv file for read in mmap mode, the whole file is mapped to memory,
+* user can read the tag data without copy by srs_flv_read_tag_view().
+* @remark the file must fit in the address space, for instance, 
+*       a huge file over 2GB is not supported on 32bits system.
+* @remark not supported on windows, always return NULL.
+*/
+extern srs_flv_t srs_flv_open_mmap(const char* file);
 /**
 * read the flv header. 9bytes header. 
 * @param header, @see E.2 The FLV header, flv_v10_1.pdf in SRS doc.
@@ -11079,6 +13157,15 @@ extern int srs_flv_read_tag_header(srs_flv_t flv,
 */
 extern int srs_flv_read_tag_data(srs_flv_t flv, char* data, int32_t size);
 /**
+* read the tag data without copy, only for flv opened by srs_flv_open_mmap().
+* drop the 4bytes previous tag size.
+* @param pdata, output the data in the mapped file, user never free it.
+* @param size, the size of data to read, get by srs_flv_read_tag_header().
+* @remark the data is valid until srs_flv_close(), read only.
+* @return ERROR_SYSTEM_IO_INVALID when flv not opened in mmap mode.
+*/
+extern int srs_flv_read_tag_view(srs_flv_t flv, char** pdata, int32_t size);
+/**
 * write the flv header. 9bytes header. 
 * @param header, @see E.2 The FLV header, flv_v10_1.pdf in SRS doc.
 *   3bytes, signature, "FLV",
@@ -11106,14 +13193,113 @@ extern int srs_flv_write_tag(srs_flv_t flv,
 * @return the size of tag.
 */
 extern int srs_flv_size_tag(int data_size);
+/* write buffer */
+/**
+* the writes are grouped in a write behind buffer, flushed by writev 
+* when the buffer is full, the interval elapsed, seek or close.
+* @param size, the bytes of buffer, 0 to write each tag to file.
+*       default to 64KB.
+* @param interval_ms, flush when elapsed, 0 to flush when full.
+* @return 0, success; otherswise, failed.
+* @remark the interval is checked when write the next tag, there is no
+*       timer, so the buffered tags of an idle stream are not written
+*       util the next tag or srs_flv_close, user should srs_flv_flush
+*       when no tag written for a while, for example, the publisher stopped.
+*/
+extern int srs_flv_set_write_buffer(srs_flv_t flv, int size, int interval_ms);
+/* the policy to sync the written data to disk, default to none. */
+#define SRS_FLV_SYNC_NONE 0
+/* fdatasync after each flush of buffer. */
+#define SRS_FLV_SYNC_FLUSH 1
+/* fdatasync when srs_flv_close. */
+#define SRS_FLV_SYNC_CLOSE 2
+extern int srs_flv_set_write_sync(srs_flv_t flv, int policy);
+/**
+* flush the buffered tags to file.
+* @remark for srs_flv_open_write_direct, the tail unaligned block is
+*       written by disable the O_DIRECT, so the tags after flush use the
+*       page cache, use srs_flv_close to write all tags instead.
+*/
+extern int srs_flv_flush(srs_flv_t flv);
 /* file stream */
 /* file stream tellg to get offset */
 extern int64_t srs_flv_tellg(srs_flv_t flv);
 /* seek file stream, offset is form the start of file */
 extern void srs_flv_lseek(srs_flv_t flv, int64_t offset);
+/* keyframe index */
+/**
+* build the keyframe index of flv file, save to the sidecar index_file.
+* the index is the timestamp and offset of each video keyframe,
+* or audio tag per second when no video.
+* @return 0, success; otherswise, failed.
+*/
+extern int srs_flv_build_index(const char* file, const char* index_file);
+/**
+* load the keyframe index for the flv opened for read,
+* from the sidecar index_file when it matches the flv file size and mtime,
+* or build it by scanning the flv and save to index_file.
+* @param index_file, the sidecar file, NULL to build in memory only.
+* @return 0, success; otherswise, failed.
+*/
+extern int srs_flv_load_index(srs_flv_t flv, const char* index_file);
+/**
+* seek to the keyframe at or before the time, in O(log n) by the index.
+* the next read is the tag header of the keyframe.
+* @param time, the timestamp in ms to seek to.
+* @param ptime, output the timestamp of keyframe, NULL to ignore.
+* @remark user must load the index by srs_flv_load_index() first.
+* @return 0, success; otherswise, failed.
+*/
+extern int srs_flv_seek_keyframe(srs_flv_t flv, u_int32_t time, u_int32_t* ptime);
+/* validation */
+/**
+* scan and validate the flv file by threads, the file is mapped and split 
+* to chunks at the tag boundaries, each scanned by a thread.
+* @param nb_threads, the max threads, 0 to use all cpu cores.
+* @param nb_audios, output the count of audio tags, NULL to ignore.
+* @param nb_videos, output the count of video tags, NULL to ignore.
+* @param nb_keyframes, output the count of video keyframes, NULL to ignore.
+* @param nb_errors, output the count of corrupt tags, NULL to ignore.
+* @param nb_jumps, output the count of timestamp jump backward, NULL to ignore.
+* @param duration, output the duration in ms, NULL to ignore.
+* @param video_codec, output the codec id of video, -1 for no video.
+* @param audio_codec, output the sound format of audio, -1 for no audio.
+* @return 0, success; otherswise, failed.
+*/
+extern int srs_flv_scan(const char* file, int nb_threads,
+    int64_t* nb_audios, int64_t* nb_videos, int64_t* nb_keyframes,
+    int64_t* nb_errors, int64_t* nb_jumps, u_int32_t* duration,
+    int* video_codec, int* audio_codec
+);
+/* repair */
+/**
+* repair the flv file in one pass, write to the repaired_file, which
+* resync and drop the corrupt tags, truncate at the last valid tag,
+* drop the tags before the sequence header or keyframe, correct the
+* timestamp to monotonic from 0, and inject the onMetaData with the
+* duration and keyframes for seeking.
+* @param repaired_file, the output file, must not be the input file.
+* @param max_jump_ms, the max forward jump of timestamp in ms to keep,
+*       for example, the pause of publisher, the larger jump is corrupt
+*       and corrected to 10ms. 0 to keep all forward jumps.
+*       the jitter back over 1000ms is always corrected.
+* @param nb_errors, output the count of corrupt regions, NULL to ignore.
+* @param nb_drops, output the count of undecodable tags dropped, NULL to ignore.
+* @param nb_jumps, output the count of timestamps corrected, NULL to ignore.
+* @param duration, output the duration in ms, NULL to ignore.
+* @remark the tags are written to repaired_file.tmp, then the metadata is
+*       prepended when done, the tmp file is removed.
+* @return 0, success; otherswise, failed, the repaired_file and its tmp
+*       file are removed.
+*/
+extern int srs_flv_repair(const char* file, const char* repaired_file, int max_jump_ms,
+    int64_t* nb_errors, int64_t* nb_drops, int64_t* nb_jumps, u_int32_t* duration
+);
 /* error code */
 /* whether the error code indicates EOF */
 extern srs_bool srs_flv_is_eof(int error_code);
+/* whether the error code indicates the async writer is busy, user can drop the tag. */
+extern srs_bool srs_flv_is_busy(int error_code);
 /* media codec */
 /**
 * whether the video body is sequence header 
@@ -11128,6 +13314,191 @@ extern srs_bool srs_flv_is_sequence_header(char* data, int32_t size);
 */
 extern srs_bool srs_flv_is_keyframe(char* data, int32_t size);
 
+/*************************************************************
+**************************************************************
+* hls muxer
+**************************************************************
+*************************************************************/
+typedef void* srs_hls_t;
+/**
+* open the hls muxer, to segment the flv audio/video to ts files and
+* a rolling m3u8, for example, the m3u8 /data/live.m3u8, the segments
+* are /data/live-0.ts, /data/live-1.ts, ...
+* @param m3u8_file, the path of m3u8, the segments in the same dir.
+* @param fragment_ms, the min duration of segment in ms, the segment is
+*       reaped at the video keyframe, or any audio frame for pure audio.
+* @param window_ms, the max duration of segments in m3u8 in ms.
+* @param cleanup, whether remove the segment files out of window.
+* @remark the ts and m3u8 are written to .tmp then renamed, so the
+*       player never gets a partial file.
+* @return the hls muxer, NULL for error.
+*/
+extern srs_hls_t srs_hls_open(const char* m3u8_file, 
+    int fragment_ms, int window_ms, srs_bool cleanup
+);
+/**
+* enable the low latency hls, each segment is also written in parts,
+* for example, /data/live-0.0.ts, /data/live-0.1.ts, ..., which are
+* listed by EXT-X-PART with the EXT-X-PRELOAD-HINT of next part, and
+* the delta m3u8 with EXT-X-SKIP is written to /data/live_delta.m3u8.
+* @param part_ms, the part target duration in ms, for example, 200-500ms.
+* @remark must be called before any tag written.
+* @return 0, success; otherswise, failed, for example, called after the
+*       tag written.
+*/
+extern int srs_hls_set_part(srs_hls_t hls, int part_ms);
+/**
+* whether fdatasync the ts and m3u8 before rename them, so the renamed
+* file is complete on disk even after the system crash, default to false.
+* @return 0, success; otherswise, failed.
+*/
+extern int srs_hls_set_sync(srs_hls_t hls, srs_bool v);
+/**
+* whether the m3u8 contains the part, for the http server to hold the
+* blocking playlist reload util ready, _HLS_msn=msn&_HLS_part=part.
+* @param part, the index of part in segment, -1 for the whole segment.
+* @remark call in the thread writes the hls.
+*/
+extern srs_bool srs_hls_is_ready(srs_hls_t hls, int msn, int part);
+/**
+* write the flv tag to hls, the script tag is ignored.
+* @param type, the type of tag, SRS_RTMP_TYPE_AUDIO or SRS_RTMP_TYPE_VIDEO.
+* @param time, the dts of tag in ms.
+* @param data, the data of tag, user should free it.
+* @return 0, success; otherswise, failed.
+*/
+extern int srs_hls_write_tag(srs_hls_t hls, 
+    char type, u_int32_t time, char* data, int size
+);
+/**
+* reap the last segment and end the m3u8, then free the muxer.
+* @return 0, success; otherswise, the last segment or m3u8 failed to write,
+*       the muxer is always freed.
+*/
+extern int srs_hls_close(srs_hls_t hls);
+
+/*************************************************************
+**************************************************************
+* fmp4 muxer
+**************************************************************
+*************************************************************/
+typedef void* srs_mp4_t;
+/**
+* open the fragmented mp4 muxer, to mux the flv h.264/h.265 and aac to
+* fmp4 file, for DASH or HLS(CMAF). the init segment is written with
+* the tracks which sequence header got before the first fragment, then
+* each fragment starts at the video keyframe, or any audio for pure audio.
+* @param file, the path of mp4 file.
+* @param fragment_ms, the min duration of fragment in ms.
+* @return the mp4 muxer, NULL for error.
+*/
+extern srs_mp4_t srs_mp4_open(const char* file, int fragment_ms);
+/**
+* write the flv tag to mp4, the script tag is ignored.
+* @param type, the type of tag, SRS_RTMP_TYPE_AUDIO or SRS_RTMP_TYPE_VIDEO.
+* @param time, the dts of tag in ms.
+* @param data, the data of tag, written to mdat without copy.
+* @remark user should never free the data, even if error, the muxer
+*       frees it when the fragment written.
+* @remark the track which sequence header comes after the first fragment
+*       is not in the init segment, the write fails for its tags.
+* @return 0, success; otherswise, failed.
+*/
+extern int srs_mp4_write_tag(srs_mp4_t mp4, 
+    char type, u_int32_t time, char* data, int size
+);
+/**
+* write the last fragment and close the file, then free the muxer.
+* @return 0, success; otherswise, the last fragment or file failed to
+*       write, the muxer is always freed.
+*/
+extern int srs_mp4_close(srs_mp4_t mp4);
+
+/*************************************************************
+**************************************************************
+* udp ts muxer
+**************************************************************
+*************************************************************/
+typedef void* srs_udp_t;
+/**
+* open the udp muxer, to mux the flv audio/video to ts and send to udp
+* unicast or multicast, in datagrams of 7 ts packets, for example, to
+* feed the broadcast playout. the PAT/PMT is repeated every 100ms, and
+* the PCR is written every 40ms, the stream is paced by PCR.
+* @param url, the udp url, for example, udp://239.1.1.1:1234
+* @param ttl, the ttl of multicast, ignored for unicast.
+* @param bitrate, the constant bitrate in bps, the null packets are
+*       stuffed to the bitrate, and the PCR is written inside the long
+*       PES by packets at the bitrate, 0 to send in the bitrate of stream.
+* @remark the stream is delayed 200ms, for the pacing.
+* @remark not supported on windows.
+* @return the udp muxer, NULL for error.
+*/
+extern srs_udp_t srs_udp_open(const char* url, int ttl, int bitrate);
+/**
+* write the flv tag to udp, the script tag is ignored.
+* @param type, the type of tag, SRS_RTMP_TYPE_AUDIO or SRS_RTMP_TYPE_VIDEO.
+* @param time, the dts of tag in ms.
+* @param data, the data of tag, user should free it.
+* @remark block when the stream is faster than realtime.
+* @return 0, success; otherswise, failed.
+*/
+extern int srs_udp_write_tag(srs_udp_t udp, 
+    char type, u_int32_t time, char* data, int size
+);
+/**
+* send the ts queued, then free the muxer.
+* @return the error of sending the queued ts.
+* @remark the udp is always free, even if error.
+*/
+extern int srs_udp_close(srs_udp_t udp);
+
+/*************************************************************
+**************************************************************
+* ts muxer of multiple inputs
+**************************************************************
+*************************************************************/
+typedef void* srs_ts_t;
+/**
+* open the ts muxer of multiple inputs, to mux the flv audio/video of
+* inputs to the tracks of one ts, for example, several rtmp streams in
+* the programs of MPTS, or the audio of languages in one program.
+* the PAT/PMT is repeated every 100ms, and the PCR is written every 40ms.
+* @param url, the path of ts file, or the udp url, for example, 
+*       udp://239.1.1.1:1234, @see srs_udp_open
+* @param bitrate, the constant bitrate in bps, the PCR is written inside
+*       the long PES by packets at the bitrate, and for udp, the null
+*       packets are stuffed to the bitrate, 0 to ignore.
+* @return the ts muxer, NULL for error.
+*/
+extern srs_ts_t srs_ts_open(const char* url, int bitrate);
+/**
+* add a track to ts, the audio or video of an input, which is the
+* elementary stream of pid in the program.
+* @param program, the program number, 1-4094, the pid of PMT is 0x1000+program.
+* @param pid, the pid of elementary stream, 0x10-0xfff.
+* @remark the stream is written to PMT when got the first frame of track.
+* @return the index of track, >= 0; otherwise, failed.
+*/
+extern int srs_ts_add_track(srs_ts_t ts, int program, int pid);
+/**
+* write the flv tag to the track of ts, the script tag is ignored.
+* @param track, the index of track, @see srs_ts_add_track.
+* @param type, the type of tag, SRS_RTMP_TYPE_AUDIO or SRS_RTMP_TYPE_VIDEO.
+* @param time, the dts of tag in ms.
+* @param data, the data of tag, user should free it.
+* @return 0, success; otherswise, failed.
+*/
+extern int srs_ts_write_tag(srs_ts_t ts, int track, 
+    char type, u_int32_t time, char* data, int size
+);
+/**
+* close the ts and free the muxer.
+* @return the error of writing the buffered ts.
+* @remark the ts is always free, even if error.
+*/
+extern int srs_ts_close(srs_ts_t ts);
+
 /*************************************************************
 **************************************************************
 * amf0 codec
@@ -11207,6 +13578,33 @@ extern int64_t srs_utils_send_bytes(srs_rtmp_t rtmp);
 */
 extern int64_t srs_utils_recv_bytes(srs_rtmp_t rtmp);
 
+/**
+* get the startup timing of rtmp session, to find which stage dominates
+* the startup latency. all values are the elapsed time in ms from the session
+* start(srs_rtmp_dns_resolve), use the monotonic clock which never jump.
+*
+* @param dns, output the time when dns resolved.
+* @param connect, output the time when tcp connected.
+* @param handshake, output the time when rtmp handshake done.
+* @param connect_app, output the time when connect app done.
+* @param create_stream, output the time when create stream done.
+* @param play_publish, output the time when play or publish done.
+* @param first_audio, output the time when got the first audio packet.
+* @param first_video, output the time when got the first video packet.
+* @param first_keyframe, output the time when got the first video keyframe,
+*       the sequence header is ignored.
+*
+* @return 0, success; otherswise, failed.
+* @remark, -1 when the stage is not done or not measured, for example, the
+*       publish never output create_stream, and the pipelined session never
+*       output connect_app and create_stream.
+*/
+extern int srs_utils_startup_timing(srs_rtmp_t rtmp,
+    int64_t* dns, int64_t* connect, int64_t* handshake,
+    int64_t* connect_app, int64_t* create_stream, int64_t* play_publish,
+    int64_t* first_audio, int64_t* first_video, int64_t* first_keyframe
+);
+
 /**
 * parse the dts and pts by time in header and data in tag,
 * or to parse the RTMP packet by srs_rtmp_read_packet().
@@ -11220,7 +13618,7 @@ extern int64_t srs_utils_recv_bytes(srs_rtmp_t rtmp);
 * @return 0, success; otherswise, failed.
 * @remark, the dts always equals to @param time.
 * @remark, the pts=dts for audio or data.
-* @remark, video only support h.264.
+* @remark, video only support h.264 and h.265.
 */
 extern int srs_utils_parse_timestamp(
     u_int32_t time, char type, char* data, int size,
@@ -11236,6 +13634,12 @@ extern srs_bool srs_utils_flv_tag_is_audio(char type);
 extern srs_bool srs_utils_flv_tag_is_video(char type);
 extern srs_bool srs_utils_flv_tag_is_av(char type);
 
+/**
+ * calc the crc32 of bytes, the MPEG-2 CRC of ts PSI, polynomial 0x04c11db7,
+ * msb first, initial value 0xffffffff and no final xor.
+ */
+extern u_int32_t srs_utils_crc32(const void* buf, int size);
+
 /**
 * get the CodecID of video tag.
 * Codec Identifier. The following values are defined:
@@ -11245,6 +13649,7 @@ extern srs_bool srs_utils_flv_tag_is_av(char type);
 *           5 = On2 VP6 with alpha channel
 *           6 = Screen video version 2
 *           7 = AVC
+*           12 = HEVC, the codec id 12 or the enhanced RTMP 'hvc1'.
 * @return the code id. 0 for error.
 */
 extern char srs_utils_flv_video_codec_id(char* data, int size);
@@ -11256,6 +13661,8 @@ extern char srs_utils_flv_video_codec_id(char* data, int size);
 *           1 = AVC NALU
 *           2 = AVC end of sequence (lower level NALU sequence ender is
 *               not required or supported)
+* @remark for the enhanced RTMP hevc, the sequence start is mapped to 0,
+*       the coded frames to 1, and the sequence end to 2.
 * @return the avc packet type. -1(0xff) for error.
 */
 extern char srs_utils_flv_video_avc_packet_type(char* data, int size);
@@ -11367,6 +13774,7 @@ extern const char* srs_human_flv_tag_type2string(char type);
 *           VP6Alpha = On2 VP6 with alpha channel
 *           Screen2 = Screen video version 2
 *           H.264 = AVC
+*           H.265 = HEVC
 *           otherwise, "Unknown"
 * @remark user never free the return char*, 
 *   it's static shared const string.
@@ -11605,7 +14013,7 @@ typedef void* srs_hijack_io_t;
 * Windows SRS-LIBRTMP solution
 **************************************************************
 *************************************************************/
-// for srs-librtmp, @see https://github.com/simple-rtmp-server/srs/issues/213
+// for srs-librtmp, @see https://github.com/ossrs/srs/issues/213
 #ifdef _WIN32
     // for time.
     #define _CRT_SECURE_NO_WARNINGS
@@ -11665,7 +14073,7 @@ typedef void* srs_hijack_io_t;
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -11697,7 +14105,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //#include <srs_rtmp_io.hpp>
 //#include <srs_librtmp.hpp>
 
-// for srs-librtmp, @see https://github.com/simple-rtmp-server/srs/issues/213
+// for srs-librtmp, @see https://github.com/ossrs/srs/issues/213
 #ifndef _WIN32
     #define SOCKET int
 #endif
@@ -11744,7 +14152,7 @@ public:
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -11835,7 +14243,7 @@ private:
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -11862,7 +14270,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -11888,7 +14296,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -11914,7 +14322,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -12001,7 +14409,7 @@ void srs_memory_report()
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -12041,7 +14449,7 @@ bool srs_is_client_gracefully_close(int error_code)
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -12116,12 +14524,17 @@ int ISrsThreadContext::get_id()
     return 0;
 }
 
+int ISrsThreadContext::set_id(int /*v*/)
+{
+    return 0;
+}
+
 
 // following is generated by src/kernel/srs_kernel_stream.cpp
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -12180,7 +14593,7 @@ int SrsStream::initialize(char* b, int nb)
 
     nb_bytes = nb;
     p = bytes = b;
-    srs_info("init stream ok, size=%d", size);
+    srs_info("init stream ok, size=%d", size());
 
     return ret;
 }
@@ -12207,7 +14620,7 @@ bool SrsStream::empty()
 
 bool SrsStream::require(int required_size)
 {
-    srs_assert(required_size > 0);
+    srs_assert(required_size >= 0);
     
     return required_size <= nb_bytes - (p - bytes);
 }
@@ -12411,7 +14824,7 @@ int8_t SrsBitStream::read_bit() {
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -12433,7 +14846,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 //#include <srs_kernel_utility.hpp>
 
-// for srs-librtmp, @see https://github.com/simple-rtmp-server/srs/issues/213
+// for srs-librtmp, @see https://github.com/ossrs/srs/issues/213
 #ifndef _WIN32
 #include <unistd.h>
 #include <netdb.h>
@@ -12484,8 +14897,11 @@ int srs_avc_nalu_read_uev(SrsBitStream* stream, int32_t& v)
     
     v = (1 << leadingZeroBits) - 1;
     for (int i = 0; i < leadingZeroBits; i++) {
+        if (stream->empty()) {
+            return ERROR_AVC_NALU_UEV;
+        }
         int32_t b = stream->read_bit();
-        v += b << (leadingZeroBits - 1);
+        v += b << (leadingZeroBits - 1 - i);
     }
     
     return ret;
@@ -12532,7 +14948,7 @@ int64_t srs_update_system_time_ms()
         return -1;
     }
 
-    // @see: https://github.com/simple-rtmp-server/srs/issues/35
+    // @see: https://github.com/ossrs/srs/issues/35
     // we must convert the tv_sec/tv_usec to int64_t.
     int64_t now_us = ((int64_t)now.tv_sec) * 1000 * 1000 + (int64_t)now.tv_usec;
     
@@ -12554,7 +14970,7 @@ int64_t srs_update_system_time_ms()
     if (diff < 0 || diff > 1000 * SYS_TIME_RESOLUTION_US) {
         srs_warn("system time jump, history=%"PRId64"us, now=%"PRId64"us, diff=%"PRId64"us", 
             _srs_system_time_us_cache, now_us, diff);
-        // @see: https://github.com/simple-rtmp-server/srs/issues/109
+        // @see: https://github.com/ossrs/srs/issues/109
         _srs_system_time_startup_time += diff;
     }
     
@@ -12689,6 +15105,11 @@ bool srs_string_starts_with(string str, string flag)
     return str.find(flag) == 0;
 }
 
+bool srs_string_starts_with(string str, string flag0, string flag1)
+{
+    return srs_string_starts_with(str, flag0) || srs_string_starts_with(str, flag1);
+}
+
 bool srs_string_contains(string str, string flag)
 {
     return str.find(flag) != string::npos;
@@ -12717,7 +15138,7 @@ int srs_do_create_dir_recursively(string dir)
     }
     
     // create curren dir.
-    // for srs-librtmp, @see https://github.com/simple-rtmp-server/srs/issues/213
+    // for srs-librtmp, @see https://github.com/ossrs/srs/issues/213
 #ifndef _WIN32
     mode_t mode = S_IRUSR|S_IWUSR|S_IXUSR|S_IRGRP|S_IWGRP|S_IXGRP|S_IROTH|S_IXOTH;
     if (::mkdir(dir.c_str(), mode) < 0) {
@@ -12904,12 +15325,391 @@ static const u_int32_t crc_table[256] = {
 	0xbcb4666d, 0xb8757bda, 0xb5365d03, 0xb1f740b4
 };
 
+/**
+* the tables of slicing-by-8, the crc_slicing_table[k][i] is the crc of
+* byte i followed by k zero bytes, so the 8 bytes are processed by 8
+* independent lookups, instead of 8 dependent lookups.
+* @remark the crc_slicing_table[0] is the crc_table.
+* @remark constant initialized, for the PSI may be encoded by the static
+*       initializer of other translation unit.
+*/
+static const u_int32_t crc_slicing_table[8][256] = {
+	{
+		0x00000000, 0x04c11db7, 0x09823b6e, 0x0d4326d9, 0x130476dc, 0x17c56b6b,
+		0x1a864db2, 0x1e475005, 0x2608edb8, 0x22c9f00f, 0x2f8ad6d6, 0x2b4bcb61,
+		0x350c9b64, 0x31cd86d3, 0x3c8ea00a, 0x384fbdbd, 0x4c11db70, 0x48d0c6c7,
+		0x4593e01e, 0x4152fda9, 0x5f15adac, 0x5bd4b01b, 0x569796c2, 0x52568b75,
+		0x6a1936c8, 0x6ed82b7f, 0x639b0da6, 0x675a1011, 0x791d4014, 0x7ddc5da3,
+		0x709f7b7a, 0x745e66cd, 0x9823b6e0, 0x9ce2ab57, 0x91a18d8e, 0x95609039,
+		0x8b27c03c, 0x8fe6dd8b, 0x82a5fb52, 0x8664e6e5, 0xbe2b5b58, 0xbaea46ef,
+		0xb7a96036, 0xb3687d81, 0xad2f2d84, 0xa9ee3033, 0xa4ad16ea, 0xa06c0b5d,
+		0xd4326d90, 0xd0f37027, 0xddb056fe, 0xd9714b49, 0xc7361b4c, 0xc3f706fb,
+		0xceb42022, 0xca753d95, 0xf23a8028, 0xf6fb9d9f, 0xfbb8bb46, 0xff79a6f1,
+		0xe13ef6f4, 0xe5ffeb43, 0xe8bccd9a, 0xec7dd02d, 0x34867077, 0x30476dc0,
+		0x3d044b19, 0x39c556ae, 0x278206ab, 0x23431b1c, 0x2e003dc5, 0x2ac12072,
+		0x128e9dcf, 0x164f8078, 0x1b0ca6a1, 0x1fcdbb16, 0x018aeb13, 0x054bf6a4,
+		0x0808d07d, 0x0cc9cdca, 0x7897ab07, 0x7c56b6b0, 0x71159069, 0x75d48dde,
+		0x6b93dddb, 0x6f52c06c, 0x6211e6b5, 0x66d0fb02, 0x5e9f46bf, 0x5a5e5b08,
+		0x571d7dd1, 0x53dc6066, 0x4d9b3063, 0x495a2dd4, 0x44190b0d, 0x40d816ba,
+		0xaca5c697, 0xa864db20, 0xa527fdf9, 0xa1e6e04e, 0xbfa1b04b, 0xbb60adfc,
+		0xb6238b25, 0xb2e29692, 0x8aad2b2f, 0x8e6c3698, 0x832f1041, 0x87ee0df6,
+		0x99a95df3, 0x9d684044, 0x902b669d, 0x94ea7b2a, 0xe0b41de7, 0xe4750050,
+		0xe9362689, 0xedf73b3e, 0xf3b06b3b, 0xf771768c, 0xfa325055, 0xfef34de2,
+		0xc6bcf05f, 0xc27dede8, 0xcf3ecb31, 0xcbffd686, 0xd5b88683, 0xd1799b34,
+		0xdc3abded, 0xd8fba05a, 0x690ce0ee, 0x6dcdfd59, 0x608edb80, 0x644fc637,
+		0x7a089632, 0x7ec98b85, 0x738aad5c, 0x774bb0eb, 0x4f040d56, 0x4bc510e1,
+		0x46863638, 0x42472b8f, 0x5c007b8a, 0x58c1663d, 0x558240e4, 0x51435d53,
+		0x251d3b9e, 0x21dc2629, 0x2c9f00f0, 0x285e1d47, 0x36194d42, 0x32d850f5,
+		0x3f9b762c, 0x3b5a6b9b, 0x0315d626, 0x07d4cb91, 0x0a97ed48, 0x0e56f0ff,
+		0x1011a0fa, 0x14d0bd4d, 0x19939b94, 0x1d528623, 0xf12f560e, 0xf5ee4bb9,
+		0xf8ad6d60, 0xfc6c70d7, 0xe22b20d2, 0xe6ea3d65, 0xeba91bbc, 0xef68060b,
+		0xd727bbb6, 0xd3e6a601, 0xdea580d8, 0xda649d6f, 0xc423cd6a, 0xc0e2d0dd,
+		0xcda1f604, 0xc960ebb3, 0xbd3e8d7e, 0xb9ff90c9, 0xb4bcb610, 0xb07daba7,
+		0xae3afba2, 0xaafbe615, 0xa7b8c0cc, 0xa379dd7b, 0x9b3660c6, 0x9ff77d71,
+		0x92b45ba8, 0x9675461f, 0x8832161a, 0x8cf30bad, 0x81b02d74, 0x857130c3,
+		0x5d8a9099, 0x594b8d2e, 0x5408abf7, 0x50c9b640, 0x4e8ee645, 0x4a4ffbf2,
+		0x470cdd2b, 0x43cdc09c, 0x7b827d21, 0x7f436096, 0x7200464f, 0x76c15bf8,
+		0x68860bfd, 0x6c47164a, 0x61043093, 0x65c52d24, 0x119b4be9, 0x155a565e,
+		0x18197087, 0x1cd86d30, 0x029f3d35, 0x065e2082, 0x0b1d065b, 0x0fdc1bec,
+		0x3793a651, 0x3352bbe6, 0x3e119d3f, 0x3ad08088, 0x2497d08d, 0x2056cd3a,
+		0x2d15ebe3, 0x29d4f654, 0xc5a92679, 0xc1683bce, 0xcc2b1d17, 0xc8ea00a0,
+		0xd6ad50a5, 0xd26c4d12, 0xdf2f6bcb, 0xdbee767c, 0xe3a1cbc1, 0xe760d676,
+		0xea23f0af, 0xeee2ed18, 0xf0a5bd1d, 0xf464a0aa, 0xf9278673, 0xfde69bc4,
+		0x89b8fd09, 0x8d79e0be, 0x803ac667, 0x84fbdbd0, 0x9abc8bd5, 0x9e7d9662,
+		0x933eb0bb, 0x97ffad0c, 0xafb010b1, 0xab710d06, 0xa6322bdf, 0xa2f33668,
+		0xbcb4666d, 0xb8757bda, 0xb5365d03, 0xb1f740b4
+	},
+	{
+		0x00000000, 0xd219c1dc, 0xa0f29e0f, 0x72eb5fd3, 0x452421a9, 0x973de075,
+		0xe5d6bfa6, 0x37cf7e7a, 0x8a484352, 0x5851828e, 0x2abadd5d, 0xf8a31c81,
+		0xcf6c62fb, 0x1d75a327, 0x6f9efcf4, 0xbd873d28, 0x10519b13, 0xc2485acf,
+		0xb0a3051c, 0x62bac4c0, 0x5575baba, 0x876c7b66, 0xf58724b5, 0x279ee569,
+		0x9a19d841, 0x4800199d, 0x3aeb464e, 0xe8f28792, 0xdf3df9e8, 0x0d243834,
+		0x7fcf67e7, 0xadd6a63b, 0x20a33626, 0xf2baf7fa, 0x8051a829, 0x524869f5,
+		0x6587178f, 0xb79ed653, 0xc5758980, 0x176c485c, 0xaaeb7574, 0x78f2b4a8,
+		0x0a19eb7b, 0xd8002aa7, 0xefcf54dd, 0x3dd69501, 0x4f3dcad2, 0x9d240b0e,
+		0x30f2ad35, 0xe2eb6ce9, 0x9000333a, 0x4219f2e6, 0x75d68c9c, 0xa7cf4d40,
+		0xd5241293, 0x073dd34f, 0xbabaee67, 0x68a32fbb, 0x1a487068, 0xc851b1b4,
+		0xff9ecfce, 0x2d870e12, 0x5f6c51c1, 0x8d75901d, 0x41466c4c, 0x935fad90,
+		0xe1b4f243, 0x33ad339f, 0x04624de5, 0xd67b8c39, 0xa490d3ea, 0x76891236,
+		0xcb0e2f1e, 0x1917eec2, 0x6bfcb111, 0xb9e570cd, 0x8e2a0eb7, 0x5c33cf6b,
+		0x2ed890b8, 0xfcc15164, 0x5117f75f, 0x830e3683, 0xf1e56950, 0x23fca88c,
+		0x1433d6f6, 0xc62a172a, 0xb4c148f9, 0x66d88925, 0xdb5fb40d, 0x094675d1,
+		0x7bad2a02, 0xa9b4ebde, 0x9e7b95a4, 0x4c625478, 0x3e890bab, 0xec90ca77,
+		0x61e55a6a, 0xb3fc9bb6, 0xc117c465, 0x130e05b9, 0x24c17bc3, 0xf6d8ba1f,
+		0x8433e5cc, 0x562a2410, 0xebad1938, 0x39b4d8e4, 0x4b5f8737, 0x994646eb,
+		0xae893891, 0x7c90f94d, 0x0e7ba69e, 0xdc626742, 0x71b4c179, 0xa3ad00a5,
+		0xd1465f76, 0x035f9eaa, 0x3490e0d0, 0xe689210c, 0x94627edf, 0x467bbf03,
+		0xfbfc822b, 0x29e543f7, 0x5b0e1c24, 0x8917ddf8, 0xbed8a382, 0x6cc1625e,
+		0x1e2a3d8d, 0xcc33fc51, 0x828cd898, 0x50951944, 0x227e4697, 0xf067874b,
+		0xc7a8f931, 0x15b138ed, 0x675a673e, 0xb543a6e2, 0x08c49bca, 0xdadd5a16,
+		0xa83605c5, 0x7a2fc419, 0x4de0ba63, 0x9ff97bbf, 0xed12246c, 0x3f0be5b0,
+		0x92dd438b, 0x40c48257, 0x322fdd84, 0xe0361c58, 0xd7f96222, 0x05e0a3fe,
+		0x770bfc2d, 0xa5123df1, 0x189500d9, 0xca8cc105, 0xb8679ed6, 0x6a7e5f0a,
+		0x5db12170, 0x8fa8e0ac, 0xfd43bf7f, 0x2f5a7ea3, 0xa22feebe, 0x70362f62,
+		0x02dd70b1, 0xd0c4b16d, 0xe70bcf17, 0x35120ecb, 0x47f95118, 0x95e090c4,
+		0x2867adec, 0xfa7e6c30, 0x889533e3, 0x5a8cf23f, 0x6d438c45, 0xbf5a4d99,
+		0xcdb1124a, 0x1fa8d396, 0xb27e75ad, 0x6067b471, 0x128ceba2, 0xc0952a7e,
+		0xf75a5404, 0x254395d8, 0x57a8ca0b, 0x85b10bd7, 0x383636ff, 0xea2ff723,
+		0x98c4a8f0, 0x4add692c, 0x7d121756, 0xaf0bd68a, 0xdde08959, 0x0ff94885,
+		0xc3cab4d4, 0x11d37508, 0x63382adb, 0xb121eb07, 0x86ee957d, 0x54f754a1,
+		0x261c0b72, 0xf405caae, 0x4982f786, 0x9b9b365a, 0xe9706989, 0x3b69a855,
+		0x0ca6d62f, 0xdebf17f3, 0xac544820, 0x7e4d89fc, 0xd39b2fc7, 0x0182ee1b,
+		0x7369b1c8, 0xa1707014, 0x96bf0e6e, 0x44a6cfb2, 0x364d9061, 0xe45451bd,
+		0x59d36c95, 0x8bcaad49, 0xf921f29a, 0x2b383346, 0x1cf74d3c, 0xceee8ce0,
+		0xbc05d333, 0x6e1c12ef, 0xe36982f2, 0x3170432e, 0x439b1cfd, 0x9182dd21,
+		0xa64da35b, 0x74546287, 0x06bf3d54, 0xd4a6fc88, 0x6921c1a0, 0xbb38007c,
+		0xc9d35faf, 0x1bca9e73, 0x2c05e009, 0xfe1c21d5, 0x8cf77e06, 0x5eeebfda,
+		0xf33819e1, 0x2121d83d, 0x53ca87ee, 0x81d34632, 0xb61c3848, 0x6405f994,
+		0x16eea647, 0xc4f7679b, 0x79705ab3, 0xab699b6f, 0xd982c4bc, 0x0b9b0560,
+		0x3c547b1a, 0xee4dbac6, 0x9ca6e515, 0x4ebf24c9
+	},
+	{
+		0x00000000, 0x01d8ac87, 0x03b1590e, 0x0269f589, 0x0762b21c, 0x06ba1e9b,
+		0x04d3eb12, 0x050b4795, 0x0ec56438, 0x0f1dc8bf, 0x0d743d36, 0x0cac91b1,
+		0x09a7d624, 0x087f7aa3, 0x0a168f2a, 0x0bce23ad, 0x1d8ac870, 0x1c5264f7,
+		0x1e3b917e, 0x1fe33df9, 0x1ae87a6c, 0x1b30d6eb, 0x19592362, 0x18818fe5,
+		0x134fac48, 0x129700cf, 0x10fef546, 0x112659c1, 0x142d1e54, 0x15f5b2d3,
+		0x179c475a, 0x1644ebdd, 0x3b1590e0, 0x3acd3c67, 0x38a4c9ee, 0x397c6569,
+		0x3c7722fc, 0x3daf8e7b, 0x3fc67bf2, 0x3e1ed775, 0x35d0f4d8, 0x3408585f,
+		0x3661add6, 0x37b90151, 0x32b246c4, 0x336aea43, 0x31031fca, 0x30dbb34d,
+		0x269f5890, 0x2747f417, 0x252e019e, 0x24f6ad19, 0x21fdea8c, 0x2025460b,
+		0x224cb382, 0x23941f05, 0x285a3ca8, 0x2982902f, 0x2beb65a6, 0x2a33c921,
+		0x2f388eb4, 0x2ee02233, 0x2c89d7ba, 0x2d517b3d, 0x762b21c0, 0x77f38d47,
+		0x759a78ce, 0x7442d449, 0x714993dc, 0x70913f5b, 0x72f8cad2, 0x73206655,
+		0x78ee45f8, 0x7936e97f, 0x7b5f1cf6, 0x7a87b071, 0x7f8cf7e4, 0x7e545b63,
+		0x7c3daeea, 0x7de5026d, 0x6ba1e9b0, 0x6a794537, 0x6810b0be, 0x69c81c39,
+		0x6cc35bac, 0x6d1bf72b, 0x6f7202a2, 0x6eaaae25, 0x65648d88, 0x64bc210f,
+		0x66d5d486, 0x670d7801, 0x62063f94, 0x63de9313, 0x61b7669a, 0x606fca1d,
+		0x4d3eb120, 0x4ce61da7, 0x4e8fe82e, 0x4f5744a9, 0x4a5c033c, 0x4b84afbb,
+		0x49ed5a32, 0x4835f6b5, 0x43fbd518, 0x4223799f, 0x404a8c16, 0x41922091,
+		0x44996704, 0x4541cb83, 0x47283e0a, 0x46f0928d, 0x50b47950, 0x516cd5d7,
+		0x5305205e, 0x52dd8cd9, 0x57d6cb4c, 0x560e67cb, 0x54679242, 0x55bf3ec5,
+		0x5e711d68, 0x5fa9b1ef, 0x5dc04466, 0x5c18e8e1, 0x5913af74, 0x58cb03f3,
+		0x5aa2f67a, 0x5b7a5afd, 0xec564380, 0xed8eef07, 0xefe71a8e, 0xee3fb609,
+		0xeb34f19c, 0xeaec5d1b, 0xe885a892, 0xe95d0415, 0xe29327b8, 0xe34b8b3f,
+		0xe1227eb6, 0xe0fad231, 0xe5f195a4, 0xe4293923, 0xe640ccaa, 0xe798602d,
+		0xf1dc8bf0, 0xf0042777, 0xf26dd2fe, 0xf3b57e79, 0xf6be39ec, 0xf766956b,
+		0xf50f60e2, 0xf4d7cc65, 0xff19efc8, 0xfec1434f, 0xfca8b6c6, 0xfd701a41,
+		0xf87b5dd4, 0xf9a3f153, 0xfbca04da, 0xfa12a85d, 0xd743d360, 0xd69b7fe7,
+		0xd4f28a6e, 0xd52a26e9, 0xd021617c, 0xd1f9cdfb, 0xd3903872, 0xd24894f5,
+		0xd986b758, 0xd85e1bdf, 0xda37ee56, 0xdbef42d1, 0xdee40544, 0xdf3ca9c3,
+		0xdd555c4a, 0xdc8df0cd, 0xcac91b10, 0xcb11b797, 0xc978421e, 0xc8a0ee99,
+		0xcdaba90c, 0xcc73058b, 0xce1af002, 0xcfc25c85, 0xc40c7f28, 0xc5d4d3af,
+		0xc7bd2626, 0xc6658aa1, 0xc36ecd34, 0xc2b661b3, 0xc0df943a, 0xc10738bd,
+		0x9a7d6240, 0x9ba5cec7, 0x99cc3b4e, 0x981497c9, 0x9d1fd05c, 0x9cc77cdb,
+		0x9eae8952, 0x9f7625d5, 0x94b80678, 0x9560aaff, 0x97095f76, 0x96d1f3f1,
+		0x93dab464, 0x920218e3, 0x906bed6a, 0x91b341ed, 0x87f7aa30, 0x862f06b7,
+		0x8446f33e, 0x859e5fb9, 0x8095182c, 0x814db4ab, 0x83244122, 0x82fceda5,
+		0x8932ce08, 0x88ea628f, 0x8a839706, 0x8b5b3b81, 0x8e507c14, 0x8f88d093,
+		0x8de1251a, 0x8c39899d, 0xa168f2a0, 0xa0b05e27, 0xa2d9abae, 0xa3010729,
+		0xa60a40bc, 0xa7d2ec3b, 0xa5bb19b2, 0xa463b535, 0xafad9698, 0xae753a1f,
+		0xac1ccf96, 0xadc46311, 0xa8cf2484, 0xa9178803, 0xab7e7d8a, 0xaaa6d10d,
+		0xbce23ad0, 0xbd3a9657, 0xbf5363de, 0xbe8bcf59, 0xbb8088cc, 0xba58244b,
+		0xb831d1c2, 0xb9e97d45, 0xb2275ee8, 0xb3fff26f, 0xb19607e6, 0xb04eab61,
+		0xb545ecf4, 0xb49d4073, 0xb6f4b5fa, 0xb72c197d
+	},
+	{
+		0x00000000, 0xdc6d9ab7, 0xbc1a28d9, 0x6077b26e, 0x7cf54c05, 0xa098d6b2,
+		0xc0ef64dc, 0x1c82fe6b, 0xf9ea980a, 0x258702bd, 0x45f0b0d3, 0x999d2a64,
+		0x851fd40f, 0x59724eb8, 0x3905fcd6, 0xe5686661, 0xf7142da3, 0x2b79b714,
+		0x4b0e057a, 0x97639fcd, 0x8be161a6, 0x578cfb11, 0x37fb497f, 0xeb96d3c8,
+		0x0efeb5a9, 0xd2932f1e, 0xb2e49d70, 0x6e8907c7, 0x720bf9ac, 0xae66631b,
+		0xce11d175, 0x127c4bc2, 0xeae946f1, 0x3684dc46, 0x56f36e28, 0x8a9ef49f,
+		0x961c0af4, 0x4a719043, 0x2a06222d, 0xf66bb89a, 0x1303defb, 0xcf6e444c,
+		0xaf19f622, 0x73746c95, 0x6ff692fe, 0xb39b0849, 0xd3ecba27, 0x0f812090,
+		0x1dfd6b52, 0xc190f1e5, 0xa1e7438b, 0x7d8ad93c, 0x61082757, 0xbd65bde0,
+		0xdd120f8e, 0x017f9539, 0xe417f358, 0x387a69ef, 0x580ddb81, 0x84604136,
+		0x98e2bf5d, 0x448f25ea, 0x24f89784, 0xf8950d33, 0xd1139055, 0x0d7e0ae2,
+		0x6d09b88c, 0xb164223b, 0xade6dc50, 0x718b46e7, 0x11fcf489, 0xcd916e3e,
+		0x28f9085f, 0xf49492e8, 0x94e32086, 0x488eba31, 0x540c445a, 0x8861deed,
+		0xe8166c83, 0x347bf634, 0x2607bdf6, 0xfa6a2741, 0x9a1d952f, 0x46700f98,
+		0x5af2f1f3, 0x869f6b44, 0xe6e8d92a, 0x3a85439d, 0xdfed25fc, 0x0380bf4b,
+		0x63f70d25, 0xbf9a9792, 0xa31869f9, 0x7f75f34e, 0x1f024120, 0xc36fdb97,
+		0x3bfad6a4, 0xe7974c13, 0x87e0fe7d, 0x5b8d64ca, 0x470f9aa1, 0x9b620016,
+		0xfb15b278, 0x277828cf, 0xc2104eae, 0x1e7dd419, 0x7e0a6677, 0xa267fcc0,
+		0xbee502ab, 0x6288981c, 0x02ff2a72, 0xde92b0c5, 0xcceefb07, 0x108361b0,
+		0x70f4d3de, 0xac994969, 0xb01bb702, 0x6c762db5, 0x0c019fdb, 0xd06c056c,
+		0x3504630d, 0xe969f9ba, 0x891e4bd4, 0x5573d163, 0x49f12f08, 0x959cb5bf,
+		0xf5eb07d1, 0x29869d66, 0xa6e63d1d, 0x7a8ba7aa, 0x1afc15c4, 0xc6918f73,
+		0xda137118, 0x067eebaf, 0x660959c1, 0xba64c376, 0x5f0ca517, 0x83613fa0,
+		0xe3168dce, 0x3f7b1779, 0x23f9e912, 0xff9473a5, 0x9fe3c1cb, 0x438e5b7c,
+		0x51f210be, 0x8d9f8a09, 0xede83867, 0x3185a2d0, 0x2d075cbb, 0xf16ac60c,
+		0x911d7462, 0x4d70eed5, 0xa81888b4, 0x74751203, 0x1402a06d, 0xc86f3ada,
+		0xd4edc4b1, 0x08805e06, 0x68f7ec68, 0xb49a76df, 0x4c0f7bec, 0x9062e15b,
+		0xf0155335, 0x2c78c982, 0x30fa37e9, 0xec97ad5e, 0x8ce01f30, 0x508d8587,
+		0xb5e5e3e6, 0x69887951, 0x09ffcb3f, 0xd5925188, 0xc910afe3, 0x157d3554,
+		0x750a873a, 0xa9671d8d, 0xbb1b564f, 0x6776ccf8, 0x07017e96, 0xdb6ce421,
+		0xc7ee1a4a, 0x1b8380fd, 0x7bf43293, 0xa799a824, 0x42f1ce45, 0x9e9c54f2,
+		0xfeebe69c, 0x22867c2b, 0x3e048240, 0xe26918f7, 0x821eaa99, 0x5e73302e,
+		0x77f5ad48, 0xab9837ff, 0xcbef8591, 0x17821f26, 0x0b00e14d, 0xd76d7bfa,
+		0xb71ac994, 0x6b775323, 0x8e1f3542, 0x5272aff5, 0x32051d9b, 0xee68872c,
+		0xf2ea7947, 0x2e87e3f0, 0x4ef0519e, 0x929dcb29, 0x80e180eb, 0x5c8c1a5c,
+		0x3cfba832, 0xe0963285, 0xfc14ccee, 0x20795659, 0x400ee437, 0x9c637e80,
+		0x790b18e1, 0xa5668256, 0xc5113038, 0x197caa8f, 0x05fe54e4, 0xd993ce53,
+		0xb9e47c3d, 0x6589e68a, 0x9d1cebb9, 0x4171710e, 0x2106c360, 0xfd6b59d7,
+		0xe1e9a7bc, 0x3d843d0b, 0x5df38f65, 0x819e15d2, 0x64f673b3, 0xb89be904,
+		0xd8ec5b6a, 0x0481c1dd, 0x18033fb6, 0xc46ea501, 0xa419176f, 0x78748dd8,
+		0x6a08c61a, 0xb6655cad, 0xd612eec3, 0x0a7f7474, 0x16fd8a1f, 0xca9010a8,
+		0xaae7a2c6, 0x768a3871, 0x93e25e10, 0x4f8fc4a7, 0x2ff876c9, 0xf395ec7e,
+		0xef171215, 0x337a88a2, 0x530d3acc, 0x8f60a07b
+	},
+	{
+		0x00000000, 0x490d678d, 0x921acf1a, 0xdb17a897, 0x20f48383, 0x69f9e40e,
+		0xb2ee4c99, 0xfbe32b14, 0x41e90706, 0x08e4608b, 0xd3f3c81c, 0x9afeaf91,
+		0x611d8485, 0x2810e308, 0xf3074b9f, 0xba0a2c12, 0x83d20e0c, 0xcadf6981,
+		0x11c8c116, 0x58c5a69b, 0xa3268d8f, 0xea2bea02, 0x313c4295, 0x78312518,
+		0xc23b090a, 0x8b366e87, 0x5021c610, 0x192ca19d, 0xe2cf8a89, 0xabc2ed04,
+		0x70d54593, 0x39d8221e, 0x036501af, 0x4a686622, 0x917fceb5, 0xd872a938,
+		0x2391822c, 0x6a9ce5a1, 0xb18b4d36, 0xf8862abb, 0x428c06a9, 0x0b816124,
+		0xd096c9b3, 0x999bae3e, 0x6278852a, 0x2b75e2a7, 0xf0624a30, 0xb96f2dbd,
+		0x80b70fa3, 0xc9ba682e, 0x12adc0b9, 0x5ba0a734, 0xa0438c20, 0xe94eebad,
+		0x3259433a, 0x7b5424b7, 0xc15e08a5, 0x88536f28, 0x5344c7bf, 0x1a49a032,
+		0xe1aa8b26, 0xa8a7ecab, 0x73b0443c, 0x3abd23b1, 0x06ca035e, 0x4fc764d3,
+		0x94d0cc44, 0xddddabc9, 0x263e80dd, 0x6f33e750, 0xb4244fc7, 0xfd29284a,
+		0x47230458, 0x0e2e63d5, 0xd539cb42, 0x9c34accf, 0x67d787db, 0x2edae056,
+		0xf5cd48c1, 0xbcc02f4c, 0x85180d52, 0xcc156adf, 0x1702c248, 0x5e0fa5c5,
+		0xa5ec8ed1, 0xece1e95c, 0x37f641cb, 0x7efb2646, 0xc4f10a54, 0x8dfc6dd9,
+		0x56ebc54e, 0x1fe6a2c3, 0xe40589d7, 0xad08ee5a, 0x761f46cd, 0x3f122140,
+		0x05af02f1, 0x4ca2657c, 0x97b5cdeb, 0xdeb8aa66, 0x255b8172, 0x6c56e6ff,
+		0xb7414e68, 0xfe4c29e5, 0x444605f7, 0x0d4b627a, 0xd65ccaed, 0x9f51ad60,
+		0x64b28674, 0x2dbfe1f9, 0xf6a8496e, 0xbfa52ee3, 0x867d0cfd, 0xcf706b70,
+		0x1467c3e7, 0x5d6aa46a, 0xa6898f7e, 0xef84e8f3, 0x34934064, 0x7d9e27e9,
+		0xc7940bfb, 0x8e996c76, 0x558ec4e1, 0x1c83a36c, 0xe7608878, 0xae6deff5,
+		0x757a4762, 0x3c7720ef, 0x0d9406bc, 0x44996131, 0x9f8ec9a6, 0xd683ae2b,
+		0x2d60853f, 0x646de2b2, 0xbf7a4a25, 0xf6772da8, 0x4c7d01ba, 0x05706637,
+		0xde67cea0, 0x976aa92d, 0x6c898239, 0x2584e5b4, 0xfe934d23, 0xb79e2aae,
+		0x8e4608b0, 0xc74b6f3d, 0x1c5cc7aa, 0x5551a027, 0xaeb28b33, 0xe7bfecbe,
+		0x3ca84429, 0x75a523a4, 0xcfaf0fb6, 0x86a2683b, 0x5db5c0ac, 0x14b8a721,
+		0xef5b8c35, 0xa656ebb8, 0x7d41432f, 0x344c24a2, 0x0ef10713, 0x47fc609e,
+		0x9cebc809, 0xd5e6af84, 0x2e058490, 0x6708e31d, 0xbc1f4b8a, 0xf5122c07,
+		0x4f180015, 0x06156798, 0xdd02cf0f, 0x940fa882, 0x6fec8396, 0x26e1e41b,
+		0xfdf64c8c, 0xb4fb2b01, 0x8d23091f, 0xc42e6e92, 0x1f39c605, 0x5634a188,
+		0xadd78a9c, 0xe4daed11, 0x3fcd4586, 0x76c0220b, 0xccca0e19, 0x85c76994,
+		0x5ed0c103, 0x17dda68e, 0xec3e8d9a, 0xa533ea17, 0x7e244280, 0x3729250d,
+		0x0b5e05e2, 0x4253626f, 0x9944caf8, 0xd049ad75, 0x2baa8661, 0x62a7e1ec,
+		0xb9b0497b, 0xf0bd2ef6, 0x4ab702e4, 0x03ba6569, 0xd8adcdfe, 0x91a0aa73,
+		0x6a438167, 0x234ee6ea, 0xf8594e7d, 0xb15429f0, 0x888c0bee, 0xc1816c63,
+		0x1a96c4f4, 0x539ba379, 0xa878886d, 0xe175efe0, 0x3a624777, 0x736f20fa,
+		0xc9650ce8, 0x80686b65, 0x5b7fc3f2, 0x1272a47f, 0xe9918f6b, 0xa09ce8e6,
+		0x7b8b4071, 0x328627fc, 0x083b044d, 0x413663c0, 0x9a21cb57, 0xd32cacda,
+		0x28cf87ce, 0x61c2e043, 0xbad548d4, 0xf3d82f59, 0x49d2034b, 0x00df64c6,
+		0xdbc8cc51, 0x92c5abdc, 0x692680c8, 0x202be745, 0xfb3c4fd2, 0xb231285f,
+		0x8be90a41, 0xc2e46dcc, 0x19f3c55b, 0x50fea2d6, 0xab1d89c2, 0xe210ee4f,
+		0x390746d8, 0x700a2155, 0xca000d47, 0x830d6aca, 0x581ac25d, 0x1117a5d0,
+		0xeaf48ec4, 0xa3f9e949, 0x78ee41de, 0x31e32653
+	},
+	{
+		0x00000000, 0x1b280d78, 0x36501af0, 0x2d781788, 0x6ca035e0, 0x77883898,
+		0x5af02f10, 0x41d82268, 0xd9406bc0, 0xc26866b8, 0xef107130, 0xf4387c48,
+		0xb5e05e20, 0xaec85358, 0x83b044d0, 0x989849a8, 0xb641ca37, 0xad69c74f,
+		0x8011d0c7, 0x9b39ddbf, 0xdae1ffd7, 0xc1c9f2af, 0xecb1e527, 0xf799e85f,
+		0x6f01a1f7, 0x7429ac8f, 0x5951bb07, 0x4279b67f, 0x03a19417, 0x1889996f,
+		0x35f18ee7, 0x2ed9839f, 0x684289d9, 0x736a84a1, 0x5e129329, 0x453a9e51,
+		0x04e2bc39, 0x1fcab141, 0x32b2a6c9, 0x299aabb1, 0xb102e219, 0xaa2aef61,
+		0x8752f8e9, 0x9c7af591, 0xdda2d7f9, 0xc68ada81, 0xebf2cd09, 0xf0dac071,
+		0xde0343ee, 0xc52b4e96, 0xe853591e, 0xf37b5466, 0xb2a3760e, 0xa98b7b76,
+		0x84f36cfe, 0x9fdb6186, 0x0743282e, 0x1c6b2556, 0x311332de, 0x2a3b3fa6,
+		0x6be31dce, 0x70cb10b6, 0x5db3073e, 0x469b0a46, 0xd08513b2, 0xcbad1eca,
+		0xe6d50942, 0xfdfd043a, 0xbc252652, 0xa70d2b2a, 0x8a753ca2, 0x915d31da,
+		0x09c57872, 0x12ed750a, 0x3f956282, 0x24bd6ffa, 0x65654d92, 0x7e4d40ea,
+		0x53355762, 0x481d5a1a, 0x66c4d985, 0x7decd4fd, 0x5094c375, 0x4bbcce0d,
+		0x0a64ec65, 0x114ce11d, 0x3c34f695, 0x271cfbed, 0xbf84b245, 0xa4acbf3d,
+		0x89d4a8b5, 0x92fca5cd, 0xd32487a5, 0xc80c8add, 0xe5749d55, 0xfe5c902d,
+		0xb8c79a6b, 0xa3ef9713, 0x8e97809b, 0x95bf8de3, 0xd467af8b, 0xcf4fa2f3,
+		0xe237b57b, 0xf91fb803, 0x6187f1ab, 0x7aaffcd3, 0x57d7eb5b, 0x4cffe623,
+		0x0d27c44b, 0x160fc933, 0x3b77debb, 0x205fd3c3, 0x0e86505c, 0x15ae5d24,
+		0x38d64aac, 0x23fe47d4, 0x622665bc, 0x790e68c4, 0x54767f4c, 0x4f5e7234,
+		0xd7c63b9c, 0xccee36e4, 0xe196216c, 0xfabe2c14, 0xbb660e7c, 0xa04e0304,
+		0x8d36148c, 0x961e19f4, 0xa5cb3ad3, 0xbee337ab, 0x939b2023, 0x88b32d5b,
+		0xc96b0f33, 0xd243024b, 0xff3b15c3, 0xe41318bb, 0x7c8b5113, 0x67a35c6b,
+		0x4adb4be3, 0x51f3469b, 0x102b64f3, 0x0b03698b, 0x267b7e03, 0x3d53737b,
+		0x138af0e4, 0x08a2fd9c, 0x25daea14, 0x3ef2e76c, 0x7f2ac504, 0x6402c87c,
+		0x497adff4, 0x5252d28c, 0xcaca9b24, 0xd1e2965c, 0xfc9a81d4, 0xe7b28cac,
+		0xa66aaec4, 0xbd42a3bc, 0x903ab434, 0x8b12b94c, 0xcd89b30a, 0xd6a1be72,
+		0xfbd9a9fa, 0xe0f1a482, 0xa12986ea, 0xba018b92, 0x97799c1a, 0x8c519162,
+		0x14c9d8ca, 0x0fe1d5b2, 0x2299c23a, 0x39b1cf42, 0x7869ed2a, 0x6341e052,
+		0x4e39f7da, 0x5511faa2, 0x7bc8793d, 0x60e07445, 0x4d9863cd, 0x56b06eb5,
+		0x17684cdd, 0x0c4041a5, 0x2138562d, 0x3a105b55, 0xa28812fd, 0xb9a01f85,
+		0x94d8080d, 0x8ff00575, 0xce28271d, 0xd5002a65, 0xf8783ded, 0xe3503095,
+		0x754e2961, 0x6e662419, 0x431e3391, 0x58363ee9, 0x19ee1c81, 0x02c611f9,
+		0x2fbe0671, 0x34960b09, 0xac0e42a1, 0xb7264fd9, 0x9a5e5851, 0x81765529,
+		0xc0ae7741, 0xdb867a39, 0xf6fe6db1, 0xedd660c9, 0xc30fe356, 0xd827ee2e,
+		0xf55ff9a6, 0xee77f4de, 0xafafd6b6, 0xb487dbce, 0x99ffcc46, 0x82d7c13e,
+		0x1a4f8896, 0x016785ee, 0x2c1f9266, 0x37379f1e, 0x76efbd76, 0x6dc7b00e,
+		0x40bfa786, 0x5b97aafe, 0x1d0ca0b8, 0x0624adc0, 0x2b5cba48, 0x3074b730,
+		0x71ac9558, 0x6a849820, 0x47fc8fa8, 0x5cd482d0, 0xc44ccb78, 0xdf64c600,
+		0xf21cd188, 0xe934dcf0, 0xa8ecfe98, 0xb3c4f3e0, 0x9ebce468, 0x8594e910,
+		0xab4d6a8f, 0xb06567f7, 0x9d1d707f, 0x86357d07, 0xc7ed5f6f, 0xdcc55217,
+		0xf1bd459f, 0xea9548e7, 0x720d014f, 0x69250c37, 0x445d1bbf, 0x5f7516c7,
+		0x1ead34af, 0x058539d7, 0x28fd2e5f, 0x33d52327
+	},
+	{
+		0x00000000, 0x4f576811, 0x9eaed022, 0xd1f9b833, 0x399cbdf3, 0x76cbd5e2,
+		0xa7326dd1, 0xe86505c0, 0x73397be6, 0x3c6e13f7, 0xed97abc4, 0xa2c0c3d5,
+		0x4aa5c615, 0x05f2ae04, 0xd40b1637, 0x9b5c7e26, 0xe672f7cc, 0xa9259fdd,
+		0x78dc27ee, 0x378b4fff, 0xdfee4a3f, 0x90b9222e, 0x41409a1d, 0x0e17f20c,
+		0x954b8c2a, 0xda1ce43b, 0x0be55c08, 0x44b23419, 0xacd731d9, 0xe38059c8,
+		0x3279e1fb, 0x7d2e89ea, 0xc824f22f, 0x87739a3e, 0x568a220d, 0x19dd4a1c,
+		0xf1b84fdc, 0xbeef27cd, 0x6f169ffe, 0x2041f7ef, 0xbb1d89c9, 0xf44ae1d8,
+		0x25b359eb, 0x6ae431fa, 0x8281343a, 0xcdd65c2b, 0x1c2fe418, 0x53788c09,
+		0x2e5605e3, 0x61016df2, 0xb0f8d5c1, 0xffafbdd0, 0x17cab810, 0x589dd001,
+		0x89646832, 0xc6330023, 0x5d6f7e05, 0x12381614, 0xc3c1ae27, 0x8c96c636,
+		0x64f3c3f6, 0x2ba4abe7, 0xfa5d13d4, 0xb50a7bc5, 0x9488f9e9, 0xdbdf91f8,
+		0x0a2629cb, 0x457141da, 0xad14441a, 0xe2432c0b, 0x33ba9438, 0x7cedfc29,
+		0xe7b1820f, 0xa8e6ea1e, 0x791f522d, 0x36483a3c, 0xde2d3ffc, 0x917a57ed,
+		0x4083efde, 0x0fd487cf, 0x72fa0e25, 0x3dad6634, 0xec54de07, 0xa303b616,
+		0x4b66b3d6, 0x0431dbc7, 0xd5c863f4, 0x9a9f0be5, 0x01c375c3, 0x4e941dd2,
+		0x9f6da5e1, 0xd03acdf0, 0x385fc830, 0x7708a021, 0xa6f11812, 0xe9a67003,
+		0x5cac0bc6, 0x13fb63d7, 0xc202dbe4, 0x8d55b3f5, 0x6530b635, 0x2a67de24,
+		0xfb9e6617, 0xb4c90e06, 0x2f957020, 0x60c21831, 0xb13ba002, 0xfe6cc813,
+		0x1609cdd3, 0x595ea5c2, 0x88a71df1, 0xc7f075e0, 0xbadefc0a, 0xf589941b,
+		0x24702c28, 0x6b274439, 0x834241f9, 0xcc1529e8, 0x1dec91db, 0x52bbf9ca,
+		0xc9e787ec, 0x86b0effd, 0x574957ce, 0x181e3fdf, 0xf07b3a1f, 0xbf2c520e,
+		0x6ed5ea3d, 0x2182822c, 0x2dd0ee65, 0x62878674, 0xb37e3e47, 0xfc295656,
+		0x144c5396, 0x5b1b3b87, 0x8ae283b4, 0xc5b5eba5, 0x5ee99583, 0x11befd92,
+		0xc04745a1, 0x8f102db0, 0x67752870, 0x28224061, 0xf9dbf852, 0xb68c9043,
+		0xcba219a9, 0x84f571b8, 0x550cc98b, 0x1a5ba19a, 0xf23ea45a, 0xbd69cc4b,
+		0x6c907478, 0x23c71c69, 0xb89b624f, 0xf7cc0a5e, 0x2635b26d, 0x6962da7c,
+		0x8107dfbc, 0xce50b7ad, 0x1fa90f9e, 0x50fe678f, 0xe5f41c4a, 0xaaa3745b,
+		0x7b5acc68, 0x340da479, 0xdc68a1b9, 0x933fc9a8, 0x42c6719b, 0x0d91198a,
+		0x96cd67ac, 0xd99a0fbd, 0x0863b78e, 0x4734df9f, 0xaf51da5f, 0xe006b24e,
+		0x31ff0a7d, 0x7ea8626c, 0x0386eb86, 0x4cd18397, 0x9d283ba4, 0xd27f53b5,
+		0x3a1a5675, 0x754d3e64, 0xa4b48657, 0xebe3ee46, 0x70bf9060, 0x3fe8f871,
+		0xee114042, 0xa1462853, 0x49232d93, 0x06744582, 0xd78dfdb1, 0x98da95a0,
+		0xb958178c, 0xf60f7f9d, 0x27f6c7ae, 0x68a1afbf, 0x80c4aa7f, 0xcf93c26e,
+		0x1e6a7a5d, 0x513d124c, 0xca616c6a, 0x8536047b, 0x54cfbc48, 0x1b98d459,
+		0xf3fdd199, 0xbcaab988, 0x6d5301bb, 0x220469aa, 0x5f2ae040, 0x107d8851,
+		0xc1843062, 0x8ed35873, 0x66b65db3, 0x29e135a2, 0xf8188d91, 0xb74fe580,
+		0x2c139ba6, 0x6344f3b7, 0xb2bd4b84, 0xfdea2395, 0x158f2655, 0x5ad84e44,
+		0x8b21f677, 0xc4769e66, 0x717ce5a3, 0x3e2b8db2, 0xefd23581, 0xa0855d90,
+		0x48e05850, 0x07b73041, 0xd64e8872, 0x9919e063, 0x02459e45, 0x4d12f654,
+		0x9ceb4e67, 0xd3bc2676, 0x3bd923b6, 0x748e4ba7, 0xa577f394, 0xea209b85,
+		0x970e126f, 0xd8597a7e, 0x09a0c24d, 0x46f7aa5c, 0xae92af9c, 0xe1c5c78d,
+		0x303c7fbe, 0x7f6b17af, 0xe4376989, 0xab600198, 0x7a99b9ab, 0x35ced1ba,
+		0xddabd47a, 0x92fcbc6b, 0x43050458, 0x0c526c49
+	},
+	{
+		0x00000000, 0x5ba1dcca, 0xb743b994, 0xece2655e, 0x6a466e9f, 0x31e7b255,
+		0xdd05d70b, 0x86a40bc1, 0xd48cdd3e, 0x8f2d01f4, 0x63cf64aa, 0x386eb860,
+		0xbecab3a1, 0xe56b6f6b, 0x09890a35, 0x5228d6ff, 0xadd8a7cb, 0xf6797b01,
+		0x1a9b1e5f, 0x413ac295, 0xc79ec954, 0x9c3f159e, 0x70dd70c0, 0x2b7cac0a,
+		0x79547af5, 0x22f5a63f, 0xce17c361, 0x95b61fab, 0x1312146a, 0x48b3c8a0,
+		0xa451adfe, 0xfff07134, 0x5f705221, 0x04d18eeb, 0xe833ebb5, 0xb392377f,
+		0x35363cbe, 0x6e97e074, 0x8275852a, 0xd9d459e0, 0x8bfc8f1f, 0xd05d53d5,
+		0x3cbf368b, 0x671eea41, 0xe1bae180, 0xba1b3d4a, 0x56f95814, 0x0d5884de,
+		0xf2a8f5ea, 0xa9092920, 0x45eb4c7e, 0x1e4a90b4, 0x98ee9b75, 0xc34f47bf,
+		0x2fad22e1, 0x740cfe2b, 0x262428d4, 0x7d85f41e, 0x91679140, 0xcac64d8a,
+		0x4c62464b, 0x17c39a81, 0xfb21ffdf, 0xa0802315, 0xbee0a442, 0xe5417888,
+		0x09a31dd6, 0x5202c11c, 0xd4a6cadd, 0x8f071617, 0x63e57349, 0x3844af83,
+		0x6a6c797c, 0x31cda5b6, 0xdd2fc0e8, 0x868e1c22, 0x002a17e3, 0x5b8bcb29,
+		0xb769ae77, 0xecc872bd, 0x13380389, 0x4899df43, 0xa47bba1d, 0xffda66d7,
+		0x797e6d16, 0x22dfb1dc, 0xce3dd482, 0x959c0848, 0xc7b4deb7, 0x9c15027d,
+		0x70f76723, 0x2b56bbe9, 0xadf2b028, 0xf6536ce2, 0x1ab109bc, 0x4110d576,
+		0xe190f663, 0xba312aa9, 0x56d34ff7, 0x0d72933d, 0x8bd698fc, 0xd0774436,
+		0x3c952168, 0x6734fda2, 0x351c2b5d, 0x6ebdf797, 0x825f92c9, 0xd9fe4e03,
+		0x5f5a45c2, 0x04fb9908, 0xe819fc56, 0xb3b8209c, 0x4c4851a8, 0x17e98d62,
+		0xfb0be83c, 0xa0aa34f6, 0x260e3f37, 0x7dafe3fd, 0x914d86a3, 0xcaec5a69,
+		0x98c48c96, 0xc365505c, 0x2f873502, 0x7426e9c8, 0xf282e209, 0xa9233ec3,
+		0x45c15b9d, 0x1e608757, 0x79005533, 0x22a189f9, 0xce43eca7, 0x95e2306d,
+		0x13463bac, 0x48e7e766, 0xa4058238, 0xffa45ef2, 0xad8c880d, 0xf62d54c7,
+		0x1acf3199, 0x416eed53, 0xc7cae692, 0x9c6b3a58, 0x70895f06, 0x2b2883cc,
+		0xd4d8f2f8, 0x8f792e32, 0x639b4b6c, 0x383a97a6, 0xbe9e9c67, 0xe53f40ad,
+		0x09dd25f3, 0x527cf939, 0x00542fc6, 0x5bf5f30c, 0xb7179652, 0xecb64a98,
+		0x6a124159, 0x31b39d93, 0xdd51f8cd, 0x86f02407, 0x26700712, 0x7dd1dbd8,
+		0x9133be86, 0xca92624c, 0x4c36698d, 0x1797b547, 0xfb75d019, 0xa0d40cd3,
+		0xf2fcda2c, 0xa95d06e6, 0x45bf63b8, 0x1e1ebf72, 0x98bab4b3, 0xc31b6879,
+		0x2ff90d27, 0x7458d1ed, 0x8ba8a0d9, 0xd0097c13, 0x3ceb194d, 0x674ac587,
+		0xe1eece46, 0xba4f128c, 0x56ad77d2, 0x0d0cab18, 0x5f247de7, 0x0485a12d,
+		0xe867c473, 0xb3c618b9, 0x35621378, 0x6ec3cfb2, 0x8221aaec, 0xd9807626,
+		0xc7e0f171, 0x9c412dbb, 0x70a348e5, 0x2b02942f, 0xada69fee, 0xf6074324,
+		0x1ae5267a, 0x4144fab0, 0x136c2c4f, 0x48cdf085, 0xa42f95db, 0xff8e4911,
+		0x792a42d0, 0x228b9e1a, 0xce69fb44, 0x95c8278e, 0x6a3856ba, 0x31998a70,
+		0xdd7bef2e, 0x86da33e4, 0x007e3825, 0x5bdfe4ef, 0xb73d81b1, 0xec9c5d7b,
+		0xbeb48b84, 0xe515574e, 0x09f73210, 0x5256eeda, 0xd4f2e51b, 0x8f5339d1,
+		0x63b15c8f, 0x38108045, 0x9890a350, 0xc3317f9a, 0x2fd31ac4, 0x7472c60e,
+		0xf2d6cdcf, 0xa9771105, 0x4595745b, 0x1e34a891, 0x4c1c7e6e, 0x17bda2a4,
+		0xfb5fc7fa, 0xa0fe1b30, 0x265a10f1, 0x7dfbcc3b, 0x9119a965, 0xcab875af,
+		0x3548049b, 0x6ee9d851, 0x820bbd0f, 0xd9aa61c5, 0x5f0e6a04, 0x04afb6ce,
+		0xe84dd390, 0xb3ec0f5a, 0xe1c4d9a5, 0xba65056f, 0x56876031, 0x0d26bcfb,
+		0x8b82b73a, 0xd0236bf0, 0x3cc10eae, 0x6760d264
+	}
+};
+
 // @see http://www.stmc.edu.hk/~vincent/ffmpeg_0.4.9-pre1/libavformat/mpegtsenc.c
 unsigned int mpegts_crc32(const u_int8_t *data, int len)
 {
     register int i;
     unsigned int crc = 0xffffffff;
     
+    // slicing-by-8, the crc is msb first, so the bytes are big-endian.
+    const u_int32_t (*t)[256] = crc_slicing_table;
+    for (; len >= 8; len -= 8, data += 8) {
+        crc ^= ((u_int32_t)data[0] << 24) | ((u_int32_t)data[1] << 16) | ((u_int32_t)data[2] << 8) | data[3];
+        crc = t[7][crc >> 24] ^ t[6][(crc >> 16) & 0xff] ^ t[5][(crc >> 8) & 0xff] ^ t[4][crc & 0xff]
+            ^ t[3][data[4]] ^ t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
+    }
+    
     for (i=0; i<len; i++)
         crc = (crc << 8) ^ crc_table[((crc >> 24) ^ *data++) & 0xff];
     
@@ -13307,7 +16107,7 @@ int srs_chunk_header_c3(
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -13329,12 +16129,14 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 //#include <srs_kernel_flv.hpp>
 
-// for srs-librtmp, @see https://github.com/simple-rtmp-server/srs/issues/213
+// for srs-librtmp, @see https://github.com/ossrs/srs/issues/213
 #ifndef _WIN32
 #include <unistd.h>
+#include <pthread.h>
 #endif
 
 #include <fcntl.h>
+#include <stdio.h>
 #include <sstream>
 using namespace std;
 
@@ -13345,6 +16147,7 @@ using namespace std;
 //#include <srs_kernel_codec.hpp>
 //#include <srs_kernel_utility.hpp>
 //#include <srs_core_mem_watch.hpp>
+//#include <srs_core_autofree.hpp>
 
 SrsMessageHeader::SrsMessageHeader()
 {
@@ -13469,12 +16272,12 @@ SrsCommonMessage::~SrsCommonMessage()
 #ifdef SRS_AUTO_MEM_WATCH
     srs_memory_unwatch(payload);
 #endif
-    srs_freep(payload);
+    srs_freepa(payload);
 }
 
 void SrsCommonMessage::create_payload(int size)
 {
-    srs_freep(payload);
+    srs_freepa(payload);
     
     payload = new char[size];
     srs_verbose("create payload for RTMP message. size=%d", size);
@@ -13496,7 +16299,7 @@ SrsSharedPtrMessage::SrsSharedPtrPayload::~SrsSharedPtrPayload()
 #ifdef SRS_AUTO_MEM_WATCH
     srs_memory_unwatch(payload);
 #endif
-    srs_freep(payload);
+    srs_freepa(payload);
 }
 
 SrsSharedPtrMessage::SrsSharedPtrMessage()
@@ -13656,9 +16459,9 @@ SrsFlvEncoder::~SrsFlvEncoder()
     srs_freep(tag_stream);
     
 #ifdef SRS_PERF_FAST_FLV_ENCODER
-    srs_freep(tag_headers);
-    srs_freep(iovss_cache);
-    srs_freep(ppts);
+    srs_freepa(tag_headers);
+    srs_freepa(iovss_cache);
+    srs_freepa(ppts);
 #endif
 }
 
@@ -13687,7 +16490,7 @@ int SrsFlvEncoder::write_header()
     char flv_header[] = {
         'F', 'L', 'V', // Signatures "FLV"
         (char)0x01, // File version (for example, 0x01 for FLV version 1)
-        (char)0x00, // 4, audio; 1, video; 5 audio+video.
+        (char)0x05, // 4, audio; 1, video; 5 audio+video.
         (char)0x00, (char)0x00, (char)0x00, (char)0x09 // DataOffset UI32 The length of this header in bytes
     };
     
@@ -13795,7 +16598,7 @@ int SrsFlvEncoder::write_tags(SrsSharedPtrMessage** msgs, int count)
     int nb_iovss = 3 * count;
     iovec* iovss = iovss_cache;
     if (nb_iovss_cache < nb_iovss) {
-        srs_freep(iovss_cache);
+        srs_freepa(iovss_cache);
         
         nb_iovss_cache = nb_iovss;
         iovss = iovss_cache = new iovec[nb_iovss];
@@ -13804,7 +16607,7 @@ int SrsFlvEncoder::write_tags(SrsSharedPtrMessage** msgs, int count)
     // realloc the tag headers.
     char* cache = tag_headers;
     if (nb_tag_headers < count) {
-        srs_freep(tag_headers);
+        srs_freepa(tag_headers);
         
         nb_tag_headers = count;
         cache = tag_headers = new char[SRS_FLV_TAG_HEADER_SIZE * count];
@@ -13813,7 +16616,7 @@ int SrsFlvEncoder::write_tags(SrsSharedPtrMessage** msgs, int count)
     // realloc the pts.
     char* pts = ppts;
     if (nb_ppts < count) {
-        srs_freep(ppts);
+        srs_freepa(ppts);
         
         nb_ppts = count;
         pts = ppts = new char[SRS_FLV_PREVIOUS_TAG_SIZE * count];
@@ -14106,6 +16909,28 @@ int SrsFlvDecoder::read_tag_data(char* data, int32_t size)
 
 }
 
+int SrsFlvDecoder::read_tag_data_view(char** pdata, int32_t size)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(pdata);
+    
+    if (size < 0) {
+        ret = ERROR_SYSTEM_IO_INVALID;
+        srs_error("read flv tag data view invalid size=%d. ret=%d", size, ret);
+        return ret;
+    }
+    
+    if ((ret = reader->read_view((size_t)size, pdata)) != ERROR_SUCCESS) {
+        if (ret != ERROR_SYSTEM_FILE_EOF) {
+            srs_error("read flv tag data view failed. ret=%d", ret);
+        }
+        return ret;
+    }
+    
+    return ret;
+}
+
 int SrsFlvDecoder::read_previous_tag_size(char previous_tag_size[4])
 {
     int ret = ERROR_SUCCESS;
@@ -14284,12 +17109,854 @@ int SrsFlvVodStreamDecoder::lseek(int64_t offset)
     return ret;
 }
 
+// the size of sidecar header and entry.
+#define SRS_FLV_INDEX_HEADER_SIZE 28
+#define SRS_FLV_INDEX_ENTRY_SIZE 13
+// for audio only flv, index the audio tag in interval of ms.
+#define SRS_FLV_INDEX_AUDIO_INTERVAL 1000
+// the version of sidecar, 2 adds the mtime of flv.
+#define SRS_FLV_INDEX_VERSION 2
+
+SrsFlvIndex::SrsFlvIndex()
+{
+    flv_size = 0;
+    flv_mtime = 0;
+}
+
+SrsFlvIndex::~SrsFlvIndex()
+{
+}
+
+int SrsFlvIndex::build(SrsFileReader* fr)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(fr);
+    
+    entries.clear();
+    flv_size = fr->filesize();
+    flv_mtime = fr->mtime();
+    
+    int64_t pos = fr->tellg();
+    fr->lseek(0);
+    
+    // the 9bytes header and 4bytes previous tag size.
+    char header[13];
+    if ((ret = fr->read(header, 13, NULL)) != ERROR_SUCCESS) {
+        srs_error("flv index read header failed. ret=%d", ret);
+        fr->lseek(pos);
+        return ret;
+    }
+    if (header[0] != 'F' || header[1] != 'L' || header[2] != 'V') {
+        ret = ERROR_KERNEL_FLV_HEADER;
+        srs_error("flv index header invalid. ret=%d", ret);
+        fr->lseek(pos);
+        return ret;
+    }
+    
+    // the audio points, used when there is no video.
+    std::vector<SrsFlvIndexEntry> audios;
+    
+    char tag_header[SRS_FLV_TAG_HEADER_SIZE];
+    SrsStream stream;
+    for (;;) {
+        int64_t offset = fr->tellg();
+        
+        // a partial tag at the end of file is ignored.
+        if ((ret = fr->read(tag_header, SRS_FLV_TAG_HEADER_SIZE, NULL)) != ERROR_SUCCESS) {
+            break;
+        }
+        
+        if ((ret = stream.initialize(tag_header, SRS_FLV_TAG_HEADER_SIZE)) != ERROR_SUCCESS) {
+            break;
+        }
+        int8_t type = stream.read_1bytes();
+        int32_t data_size = stream.read_3bytes();
+        u_int32_t time = (u_int32_t)stream.read_3bytes();
+        time |= (u_int32_t)(u_int8_t)stream.read_1bytes() << 24;
+        
+        if (offset + SRS_FLV_TAG_HEADER_SIZE + data_size > flv_size) {
+            break;
+        }
+        
+        SrsFlvIndexEntry entry;
+        entry.timestamp = time;
+        entry.offset = offset;
+        
+        int64_t body = fr->tellg();
+        if (type == 0x09 && data_size >= 2) {
+            // 5bytes for the enhanced RTMP header with FourCC.
+            char video[5];
+            int nb_video = srs_min((int)data_size, (int)sizeof(video));
+            if ((ret = fr->read(video, nb_video, NULL)) != ERROR_SUCCESS) {
+                break;
+            }
+            // the entries must be sorted for binary search, ignore the keyframe jump back.
+            if (SrsFlvCodec::video_is_keyframe(video, nb_video) && !SrsFlvCodec::video_is_sequence_header(video, nb_video)
+                && (entries.empty() || time >= entries.back().timestamp)
+            ) {
+                entry.flags = SRS_FLV_INDEX_KEYFRAME;
+                entries.push_back(entry);
+            }
+        } else if (type == 0x08 && entries.empty()) {
+            // signed delta, the audio jump back is ignored.
+            if (audios.empty() || (int64_t)time - (int64_t)audios.back().timestamp >= SRS_FLV_INDEX_AUDIO_INTERVAL) {
+                entry.flags = SRS_FLV_INDEX_AUDIO;
+                audios.push_back(entry);
+            }
+        }
+        
+        fr->lseek(body + data_size + SRS_FLV_PREVIOUS_TAG_SIZE);
+    }
+    ret = ERROR_SUCCESS;
+    
+    if (entries.empty()) {
+        entries = audios;
+    }
+    
+    fr->lseek(pos);
+    srs_info("flv index build %d points, size=%"PRId64, (int)entries.size(), flv_size);
+    
+    return ret;
+}
+
+int SrsFlvIndex::load(string path, int64_t size, int64_t mtime)
+{
+    int ret = ERROR_SUCCESS;
+    
+    SrsFileReader fr;
+    if ((ret = fr.open(path)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    int64_t nb_file = fr.filesize();
+    if (nb_file < SRS_FLV_INDEX_HEADER_SIZE || (nb_file - SRS_FLV_INDEX_HEADER_SIZE) % SRS_FLV_INDEX_ENTRY_SIZE) {
+        ret = ERROR_KERNEL_FLV_INDEX;
+        srs_warn("flv index %s size invalid, size=%"PRId64". ret=%d", path.c_str(), nb_file, ret);
+        return ret;
+    }
+    
+    char* data = new char[nb_file];
+    SrsAutoFreeA(char, data);
+    if ((ret = fr.read(data, (size_t)nb_file, NULL)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    SrsStream stream;
+    if ((ret = stream.initialize(data, (int)nb_file)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    bool magic = data[0] == 'F' && data[1] == 'L' && data[2] == 'V' && data[3] == 'I';
+    stream.skip(4);
+    int8_t version = stream.read_1bytes();
+    stream.skip(3);
+    int64_t indexed_size = stream.read_8bytes();
+    int64_t indexed_mtime = stream.read_8bytes();
+    int nb_entries = stream.read_4bytes();
+    
+    if (!magic || version != SRS_FLV_INDEX_VERSION || nb_entries < 0
+        || (int64_t)nb_entries * SRS_FLV_INDEX_ENTRY_SIZE != nb_file - SRS_FLV_INDEX_HEADER_SIZE
+    ) {
+        ret = ERROR_KERNEL_FLV_INDEX;
+        srs_warn("flv index %s invalid, version=%d, entries=%d. ret=%d", path.c_str(), version, nb_entries, ret);
+        return ret;
+    }
+    
+    if (indexed_size != size || indexed_mtime != mtime) {
+        ret = ERROR_KERNEL_FLV_INDEX;
+        srs_warn("flv index %s stale, indexed=%"PRId64"/%"PRId64", size=%"PRId64", mtime=%"PRId64". ret=%d",
+            path.c_str(), indexed_size, indexed_mtime, size, mtime, ret);
+        return ret;
+    }
+    
+    entries.resize(nb_entries);
+    for (int i = 0; i < nb_entries; i++) {
+        SrsFlvIndexEntry& entry = entries[i];
+        entry.timestamp = (u_int32_t)stream.read_4bytes();
+        entry.offset = stream.read_8bytes();
+        entry.flags = stream.read_1bytes();
+    }
+    flv_size = size;
+    flv_mtime = mtime;
+    
+    return ret;
+}
+
+int SrsFlvIndex::save(string path)
+{
+    int ret = ERROR_SUCCESS;
+    
+    int nb_data = SRS_FLV_INDEX_HEADER_SIZE + SRS_FLV_INDEX_ENTRY_SIZE * (int)entries.size();
+    char* data = new char[nb_data];
+    SrsAutoFreeA(char, data);
+    
+    SrsStream stream;
+    if ((ret = stream.initialize(data, nb_data)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    stream.write_bytes((char*)"FLVI", 4);
+    stream.write_1bytes(SRS_FLV_INDEX_VERSION);
+    stream.write_1bytes(0);
+    stream.write_2bytes(0);
+    stream.write_8bytes(flv_size);
+    stream.write_8bytes(flv_mtime);
+    stream.write_4bytes((int32_t)entries.size());
+    
+    std::vector<SrsFlvIndexEntry>::iterator it;
+    for (it = entries.begin(); it != entries.end(); ++it) {
+        SrsFlvIndexEntry& entry = *it;
+        stream.write_4bytes((int32_t)entry.timestamp);
+        stream.write_8bytes(entry.offset);
+        stream.write_1bytes(entry.flags);
+    }
+    
+    std::string tmp = path + ".tmp";
+    
+    if (true) {
+        SrsFileWriter fw;
+        if ((ret = fw.open(tmp)) != ERROR_SUCCESS) {
+            return ret;
+        }
+        if ((ret = fw.write(data, nb_data, NULL)) != ERROR_SUCCESS) {
+            ::remove(tmp.c_str());
+            return ret;
+        }
+        // never replace the index by the partial one.
+        if ((ret = fw.close()) != ERROR_SUCCESS) {
+            ::remove(tmp.c_str());
+            return ret;
+        }
+    }
+    
+    if (::rename(tmp.c_str(), path.c_str()) < 0) {
+        ret = ERROR_SYSTEM_FILE_RENAME;
+        srs_error("rename flv index %s to %s failed. ret=%d", tmp.c_str(), path.c_str(), ret);
+        return ret;
+    }
+    
+    return ret;
+}
+
+int SrsFlvIndex::seek(u_int32_t time, int64_t* poffset, u_int32_t* ptime)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(poffset);
+    
+    if (entries.empty()) {
+        ret = ERROR_KERNEL_FLV_INDEX;
+        srs_warn("flv index empty to seek %u. ret=%d", time, ret);
+        return ret;
+    }
+    
+    // binary search the last point which timestamp <= time.
+    int low = 0;
+    int high = (int)entries.size() - 1;
+    while (low < high) {
+        int mid = low + (high - low + 1) / 2;
+        if (entries[mid].timestamp <= time) {
+            low = mid;
+        } else {
+            high = mid - 1;
+        }
+    }
+    
+    SrsFlvIndexEntry& entry = entries[low];
+    *poffset = entry.offset;
+    if (ptime) {
+        *ptime = entry.timestamp;
+    }
+    
+    return ret;
+}
+
+int SrsFlvIndex::size()
+{
+    return (int)entries.size();
+}
+
+SrsFlvScanStats::SrsFlvScanStats()
+{
+    nb_tags = nb_audios = nb_videos = nb_scripts = nb_keyframes = 0;
+    nb_errors = nb_jumps = 0;
+    error_offset = -1;
+    first_time = last_time = 0;
+    start_time = end_time = 0;
+    video_codec = audio_codec = -1;
+}
+
+/**
+* the chunk to scan by thread.
+*/
+struct SrsFlvScanChunk
+{
+    SrsFlvScanner* scanner;
+    int64_t start;
+    int64_t end;
+    SrsFlvScanStats stats;
+};
+
+SrsFlvScanner::SrsFlvScanner()
+{
+    data = NULL;
+    size = 0;
+}
+
+SrsFlvScanner::~SrsFlvScanner()
+{
+}
+
+int SrsFlvScanner::initialize(SrsFileReader* fr)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(fr);
+    
+    if (!fr->is_mmap()) {
+        ret = ERROR_SYSTEM_IO_INVALID;
+        srs_error("flv scanner requires mmap reader. ret=%d", ret);
+        return ret;
+    }
+    
+    // view the whole file, then restore the position.
+    int64_t pos = fr->tellg();
+    size = fr->filesize();
+    fr->lseek(0);
+    
+    ret = fr->read_view((size_t)size, &data);
+    fr->lseek(pos);
+    
+    if (ret != ERROR_SUCCESS) {
+        srs_error("flv scanner view file failed. ret=%d", ret);
+        return ret;
+    }
+    
+    if (size < 13 || data[0] != 'F' || data[1] != 'L' || data[2] != 'V') {
+        ret = ERROR_KERNEL_FLV_HEADER;
+        srs_error("flv scanner header invalid, size=%"PRId64". ret=%d", size, ret);
+        return ret;
+    }
+    
+    return ret;
+}
+
+int SrsFlvScanner::scan(int nb_threads, SrsFlvScanStats* stats)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(stats);
+    srs_assert(data);
+    
+    if (nb_threads <= 0) {
+#ifndef _WIN32
+        nb_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    }
+    nb_threads = srs_max(1, srs_min(nb_threads, (int)(size / SRS_PERF_FLV_SCAN_CHUNK)));
+    
+    // split at the tag boundaries after the 9bytes header and 4bytes tag size.
+    std::vector<SrsFlvScanChunk> chunks(nb_threads);
+    for (int i = 0; i < nb_threads; i++) {
+        SrsFlvScanChunk& chunk = chunks[i];
+        chunk.scanner = this;
+        chunk.start = 13;
+        chunk.end = size;
+        
+        if (i > 0) {
+            int64_t start = resync(13 + (size - 13) * i / nb_threads, size);
+            chunk.start = srs_max(chunks[i - 1].start, (start < 0)? size : start);
+            chunks[i - 1].end = chunk.start;
+        }
+    }
+    
+    // scan the chunks, the first one in current thread.
+#ifndef _WIN32
+    std::vector<pthread_t> tids(nb_threads);
+    std::vector<bool> started(nb_threads, false);
+    for (int i = 1; i < nb_threads; i++) {
+        started[i] = pthread_create(&tids[i], NULL, worker, &chunks[i]) == 0;
+    }
+#endif
+    
+    for (int i = 0; i < nb_threads; i++) {
+#ifndef _WIN32
+        if (started[i]) {
+            pthread_join(tids[i], NULL);
+            continue;
+        }
+#endif
+        SrsFlvScanChunk& chunk = chunks[i];
+        scan_chunk(chunk.start, chunk.end, &chunk.stats);
+    }
+    
+    // merge the stats of chunks in order.
+    bool got_tag = false;
+    for (int i = 0; i < nb_threads; i++) {
+        SrsFlvScanStats& s = chunks[i].stats;
+        if (s.error_offset >= 0 && stats->error_offset < 0) {
+            stats->error_offset = s.error_offset;
+        }
+        stats->nb_errors += s.nb_errors;
+        
+        if (s.nb_tags <= 0) {
+            continue;
+        }
+        
+        if (!got_tag) {
+            stats->first_time = s.first_time;
+            stats->start_time = s.start_time;
+            stats->end_time = s.end_time;
+        } else if (s.first_time < stats->last_time) {
+            stats->nb_jumps++;
+        }
+        
+        stats->nb_tags += s.nb_tags;
+        stats->nb_audios += s.nb_audios;
+        stats->nb_videos += s.nb_videos;
+        stats->nb_scripts += s.nb_scripts;
+        stats->nb_keyframes += s.nb_keyframes;
+        stats->nb_jumps += s.nb_jumps;
+        stats->last_time = s.last_time;
+        stats->start_time = srs_min(stats->start_time, s.start_time);
+        stats->end_time = srs_max(stats->end_time, s.end_time);
+        
+        if (s.video_codec >= 0) {
+            stats->video_codec = s.video_codec;
+        }
+        if (s.audio_codec >= 0) {
+            stats->audio_codec = s.audio_codec;
+        }
+        got_tag = true;
+    }
+    
+    srs_info("flv scan %"PRId64" tags by %d threads, errors=%"PRId64, stats->nb_tags, nb_threads, stats->nb_errors);
+    
+    return ret;
+}
+
+bool SrsFlvScanner::is_tag(int64_t offset)
+{
+    if (offset < 0 || offset + SRS_FLV_TAG_HEADER_SIZE + SRS_FLV_PREVIOUS_TAG_SIZE > size) {
+        return false;
+    }
+    
+    u_int8_t* p = (u_int8_t*)data + offset;
+    
+    // the filter bit and reserved bits are ignored.
+    int8_t type = p[0] & 0x1f;
+    if (type != 0x08 && type != 0x09 && type != 0x12) {
+        return false;
+    }
+    
+    // StreamID UI24 Always 0.
+    if (p[8] != 0 || p[9] != 0 || p[10] != 0) {
+        return false;
+    }
+    
+    int32_t data_size = (p[1] << 16) | (p[2] << 8) | p[3];
+    if (offset + SRS_FLV_TAG_HEADER_SIZE + data_size + SRS_FLV_PREVIOUS_TAG_SIZE > size) {
+        return false;
+    }
+    
+    // the previous tag size must be the size of this tag.
+    u_int8_t* pts = p + SRS_FLV_TAG_HEADER_SIZE + data_size;
+    u_int32_t tag_size = (pts[0] << 24) | (pts[1] << 16) | (pts[2] << 8) | pts[3];
+    
+    return tag_size == (u_int32_t)(SRS_FLV_TAG_HEADER_SIZE + data_size);
+}
+
+int64_t SrsFlvScanner::resync(int64_t start, int64_t end)
+{
+    for (int64_t offset = start; offset < end; offset++) {
+        if (!is_tag(offset)) {
+            continue;
+        }
+        
+        // the next tag must be valid, or at the end of file.
+        u_int8_t* p = (u_int8_t*)data + offset;
+        int32_t data_size = (p[1] << 16) | (p[2] << 8) | p[3];
+        int64_t next = offset + SRS_FLV_TAG_HEADER_SIZE + data_size + SRS_FLV_PREVIOUS_TAG_SIZE;
+        if (next == size || is_tag(next)) {
+            return offset;
+        }
+    }
+    
+    return -1;
+}
+
+void SrsFlvScanner::scan_chunk(int64_t start, int64_t end, SrsFlvScanStats* stats)
+{
+    int64_t offset = start;
+    
+    while (offset < end) {
+        if (!is_tag(offset)) {
+            if (stats->error_offset < 0) {
+                stats->error_offset = offset;
+            }
+            stats->nb_errors++;
+            
+            if ((offset = resync(offset + 1, end)) < 0) {
+                break;
+            }
+            continue;
+        }
+        
+        u_int8_t* p = (u_int8_t*)data + offset;
+        int8_t type = p[0] & 0x1f;
+        int32_t data_size = (p[1] << 16) | (p[2] << 8) | p[3];
+        u_int32_t time = (u_int32_t)((p[7] << 24) | (p[4] << 16) | (p[5] << 8) | p[6]);
+        char* body = (char*)p + SRS_FLV_TAG_HEADER_SIZE;
+        
+        if (stats->nb_tags == 0) {
+            stats->first_time = stats->start_time = stats->end_time = time;
+        } else if (time < stats->last_time) {
+            stats->nb_jumps++;
+        }
+        stats->nb_tags++;
+        stats->last_time = time;
+        stats->start_time = srs_min(stats->start_time, time);
+        stats->end_time = srs_max(stats->end_time, time);
+        
+        if (type == 0x09) {
+            stats->nb_videos++;
+            if (data_size > 0) {
+                stats->video_codec = SrsFlvCodec::video_is_hevc(body, data_size)? SrsCodecVideoHEVC : body[0] & 0x0f;
+            }
+            if (SrsFlvCodec::video_is_keyframe(body, data_size) && !SrsFlvCodec::video_is_sequence_header(body, data_size)) {
+                stats->nb_keyframes++;
+            }
+        } else if (type == 0x08) {
+            stats->nb_audios++;
+            if (data_size > 0) {
+                stats->audio_codec = (body[0] >> 4) & 0x0f;
+            }
+        } else {
+            stats->nb_scripts++;
+        }
+        
+        offset += SRS_FLV_TAG_HEADER_SIZE + data_size + SRS_FLV_PREVIOUS_TAG_SIZE;
+    }
+}
+
+void* SrsFlvScanner::worker(void* arg)
+{
+    SrsFlvScanChunk* chunk = (SrsFlvScanChunk*)arg;
+    chunk->scanner->scan_chunk(chunk->start, chunk->end, &chunk->stats);
+    return NULL;
+}
+
+SrsFlvRepairStats::SrsFlvRepairStats()
+{
+    nb_tags = nb_errors = nb_drops = nb_jumps = 0;
+    has_audio = has_video = false;
+    duration = 0;
+}
+
+SrsFlvRepairer::SrsFlvRepairer()
+{
+    reader = NULL;
+    buf = NULL;
+    nb_buf = pos = end = 0;
+    eof = corrupt = false;
+    got_tag = false;
+    last_time = last_correct_time = 0;
+    last_audio_time = last_video_time = 0;
+    max_jump = SRS_FLV_REPAIR_MAX_JUMP_MS;
+    got_avc_sh = got_aac_sh = got_keyframe = false;
+}
+
+SrsFlvRepairer::~SrsFlvRepairer()
+{
+    srs_freepa(buf);
+}
+
+int SrsFlvRepairer::initialize(SrsFileReader* fr)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(fr);
+    reader = fr;
+    
+    srs_freepa(buf);
+    nb_buf = SRS_PERF_FLV_REPAIR_BUFFER;
+    buf = new char[nb_buf];
+    pos = end = 0;
+    
+    // 9bytes header and 4bytes first previous-tag-size,
+    // resync from the start when header is corrupt.
+    if (!fill(9) || buf[0] != 'F' || buf[1] != 'L' || buf[2] != 'V') {
+        srs_warn("flv repair header corrupt, resync tags.");
+        _stats.nb_errors++;
+        return ret;
+    }
+    
+    u_int8_t* p = (u_int8_t*)buf;
+    int32_t offset = (p[5] << 24) | (p[6] << 16) | (p[7] << 8) | p[8];
+    if (offset < 9 || offset > SRS_PERF_FLV_REPAIR_BUFFER || !fill(offset + SRS_FLV_PREVIOUS_TAG_SIZE)) {
+        srs_warn("flv repair header offset=%d invalid, resync tags.", offset);
+        _stats.nb_errors++;
+        pos = 9;
+        return ret;
+    }
+    pos = offset + SRS_FLV_PREVIOUS_TAG_SIZE;
+    
+    return ret;
+}
+
+void SrsFlvRepairer::set_max_jump(int v)
+{
+    max_jump = srs_max(0, v);
+}
+
+int SrsFlvRepairer::read_tag(char* ptype, int32_t* psize, u_int32_t* ptime, char** pdata)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(reader);
+    
+    while (true) {
+        // drop the truncated tail.
+        if (!fill(SRS_FLV_TAG_HEADER_SIZE)) {
+            if (end > pos) {
+                srs_warn("flv repair drop truncated tail %d bytes", end - pos);
+                if (!corrupt) {
+                    _stats.nb_errors++;
+                }
+                pos = end;
+            }
+            return ERROR_SYSTEM_FILE_EOF;
+        }
+        
+        // skip the corrupt bytes util the next valid tag.
+        if (!check_tag()) {
+            if (!corrupt) {
+                _stats.nb_errors++;
+                corrupt = true;
+            }
+            pos++;
+            continue;
+        }
+        corrupt = false;
+        
+        u_int8_t* p = (u_int8_t*)buf + pos;
+        char type = (char)(p[0] & 0x1f);
+        int32_t size = (p[1] << 16) | (p[2] << 8) | p[3];
+        u_int32_t time = (u_int32_t)((p[7] << 24) | (p[4] << 16) | (p[5] << 8) | p[6]);
+        char* data = (char*)p + SRS_FLV_TAG_HEADER_SIZE;
+        
+        // the previous tag size of the last tag maybe truncated.
+        pos += srs_min(SRS_FLV_TAG_HEADER_SIZE + size + SRS_FLV_PREVIOUS_TAG_SIZE, end - pos);
+        
+        if (!is_decodable(type, data, size)) {
+            _stats.nb_drops++;
+            continue;
+        }
+        
+        if (type == SrsCodecFlvTagScript) {
+            time = (u_int32_t)last_correct_time;
+        } else {
+            time = correct(type, time);
+        }
+        _stats.nb_tags++;
+        
+        *ptype = type;
+        *psize = size;
+        *ptime = time;
+        *pdata = data;
+        break;
+    }
+    
+    return ret;
+}
+
+SrsFlvRepairStats* SrsFlvRepairer::stats()
+{
+    return &_stats;
+}
+
+bool SrsFlvRepairer::fill(int size)
+{
+    if (end - pos >= size) {
+        return true;
+    }
+    
+    if (eof) {
+        return false;
+    }
+    
+    // move the unparsed bytes to the start of window.
+    if (pos > 0) {
+        if (end > pos) {
+            memmove(buf, buf + pos, end - pos);
+        }
+        end -= pos;
+        pos = 0;
+    }
+    
+    // grow the window for large tag.
+    if (size > nb_buf) {
+        int nb_size = srs_max(size, nb_buf * 2);
+        char* nbuf = new char[nb_size];
+        memcpy(nbuf, buf, end);
+        srs_freepa(buf);
+        buf = nbuf;
+        nb_buf = nb_size;
+    }
+    
+    while (end < size) {
+        ssize_t nread = 0;
+        int ret = reader->read(buf + end, nb_buf - end, &nread);
+        
+        // the read error is also considered as EOF, to output the valid tags.
+        if (ret != ERROR_SUCCESS || nread <= 0) {
+            if (ret != ERROR_SYSTEM_FILE_EOF) {
+                srs_warn("flv repair read failed, as EOF. ret=%d", ret);
+            }
+            eof = true;
+            break;
+        }
+        end += (int)nread;
+    }
+    
+    return end - pos >= size;
+}
+
+bool SrsFlvRepairer::check_tag()
+{
+    if (!is_tag_header((u_int8_t*)buf + pos)) {
+        return false;
+    }
+    
+    u_int8_t* p = (u_int8_t*)buf + pos;
+    int32_t tag_size = SRS_FLV_TAG_HEADER_SIZE + ((p[1] << 16) | (p[2] << 8) | p[3]);
+    
+    // the tag data is truncated.
+    if (!fill(tag_size)) {
+        return false;
+    }
+    
+    // the last tag without previous tag size.
+    if (!fill(tag_size + SRS_FLV_PREVIOUS_TAG_SIZE)) {
+        return true;
+    }
+    
+    // the previous tag size must be the size of this tag.
+    p = (u_int8_t*)buf + pos + tag_size;
+    u_int32_t previous = (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+    if (previous == (u_int32_t)tag_size) {
+        return true;
+    }
+    
+    // some muxer write the wrong previous tag size,
+    // accept it when the next tag is valid, or at the end of file.
+    if (!fill(tag_size + SRS_FLV_PREVIOUS_TAG_SIZE + SRS_FLV_TAG_HEADER_SIZE)) {
+        return end - pos == tag_size + SRS_FLV_PREVIOUS_TAG_SIZE;
+    }
+    return is_tag_header((u_int8_t*)buf + pos + tag_size + SRS_FLV_PREVIOUS_TAG_SIZE);
+}
+
+bool SrsFlvRepairer::is_tag_header(u_int8_t* p)
+{
+    // the filter bit and reserved bits are ignored.
+    int8_t type = p[0] & 0x1f;
+    if (type != SrsCodecFlvTagAudio && type != SrsCodecFlvTagVideo && type != SrsCodecFlvTagScript) {
+        return false;
+    }
+    
+    // StreamID UI24 Always 0.
+    return p[8] == 0 && p[9] == 0 && p[10] == 0;
+}
+
+bool SrsFlvRepairer::is_decodable(char type, char* data, int32_t size)
+{
+    if (size <= 0) {
+        return false;
+    }
+    
+    if (type == SrsCodecFlvTagVideo) {
+        if (!SrsFlvCodec::video_is_acceptable(data, size)) {
+            return false;
+        }
+        
+        // the avc/hevc frames are undecodable before the sequence header.
+        if (SrsFlvCodec::video_is_h264(data, size) || SrsFlvCodec::video_is_hevc(data, size)) {
+            if (SrsFlvCodec::video_is_sequence_header(data, size)) {
+                got_avc_sh = true;
+                return true;
+            }
+            if (!got_avc_sh) {
+                return false;
+            }
+        }
+        
+        // the inter frames are undecodable before the keyframe.
+        if (SrsFlvCodec::video_is_keyframe(data, size)) {
+            got_keyframe = true;
+        }
+        if (!got_keyframe) {
+            return false;
+        }
+        
+        _stats.has_video = true;
+        return true;
+    }
+    
+    if (type == SrsCodecFlvTagAudio) {
+        // the aac frames are undecodable before the sequence header.
+        if (SrsFlvCodec::audio_is_aac(data, size)) {
+            if (SrsFlvCodec::audio_is_sequence_header(data, size)) {
+                got_aac_sh = true;
+            }
+            if (!got_aac_sh) {
+                return false;
+            }
+        }
+        
+        _stats.has_audio = true;
+        return true;
+    }
+    
+    return true;
+}
+
+u_int32_t SrsFlvRepairer::correct(char type, u_int32_t time)
+{
+    // start at 0, and use the delta of input timestamp,
+    // use the default delta when jitter or jump over max_jump.
+    if (!got_tag) {
+        got_tag = true;
+        last_correct_time = 0;
+    } else {
+        int64_t delta = (int64_t)time - last_time;
+        if (delta < -SRS_FLV_REPAIR_MAX_JITTER_MS || (max_jump > 0 && delta > max_jump)) {
+            delta = SRS_FLV_REPAIR_DEFAULT_FRAME_MS;
+            _stats.nb_jumps++;
+        }
+        last_correct_time = srs_max(0, last_correct_time + delta);
+    }
+    last_time = time;
+    
+    // the timestamp of each stream must be monotonic.
+    int64_t ts = last_correct_time;
+    if (type == SrsCodecFlvTagAudio) {
+        ts = last_audio_time = srs_max(ts, last_audio_time);
+    } else {
+        ts = last_video_time = srs_max(ts, last_video_time);
+    }
+    
+    _stats.duration = srs_max(_stats.duration, (u_int32_t)ts);
+    
+    return (u_int32_t)ts;
+}
+
 
 // following is generated by src/kernel/srs_kernel_codec.cpp
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -14326,6 +17993,8 @@ string srs_codec_video2str(SrsCodecVideo codec)
     switch (codec) {
         case SrsCodecVideoAVC: 
             return "H264";
+        case SrsCodecVideoHEVC:
+            return "H265";
         case SrsCodecVideoOn2VP6:
         case SrsCodecVideoOn2VP6WithAlphaChannel:
             return "VP6";
@@ -14485,15 +18154,26 @@ bool SrsFlvCodec::video_is_keyframe(char* data, int size)
     }
 
     char frame_type = data[0];
-    frame_type = (frame_type >> 4) & 0x0F;
+    if (frame_type & SRS_FLV_VIDEO_EX_HEADER) {
+        frame_type = (frame_type >> 4) & 0x07;
+    } else {
+        frame_type = (frame_type >> 4) & 0x0F;
+    }
     
     return frame_type == SrsCodecVideoAVCFrameKeyFrame;
 }
 
 bool SrsFlvCodec::video_is_sequence_header(char* data, int size)
 {
-    // sequence header only for h264
-    if (!video_is_h264(data, size)) {
+    // for the enhanced RTMP hevc, the packet type is in the first byte.
+    if (video_is_hevc(data, size) && (data[0] & SRS_FLV_VIDEO_EX_HEADER)) {
+        char packet_type = data[0] & 0x0F;
+        return video_is_keyframe(data, size)
+            && packet_type == SrsCodecVideoExPacketTypeSequenceStart;
+    }
+    
+    // sequence header only for h264 and the hevc in codec id 12.
+    if (!video_is_h264(data, size) && !video_is_hevc(data, size)) {
         return false;
     }
     
@@ -14536,11 +18216,40 @@ bool SrsFlvCodec::video_is_h264(char* data, int size)
     }
 
     char codec_id = data[0];
+    if (codec_id & SRS_FLV_VIDEO_EX_HEADER) {
+        return false;
+    }
     codec_id = codec_id & 0x0F;
     
     return codec_id == SrsCodecVideoAVC;
 }
 
+bool SrsFlvCodec::video_is_hevc(char* data, int size)
+{
+    // 1bytes required.
+    if (size < 1) {
+        return false;
+    }
+    
+    // the enhanced RTMP, 1bytes header and 4bytes FourCC.
+    if (data[0] & SRS_FLV_VIDEO_EX_HEADER) {
+        if (size < 5) {
+            return false;
+        }
+        
+        SrsStream stream;
+        if (stream.initialize(data + 1, 4) != ERROR_SUCCESS) {
+            return false;
+        }
+        return stream.read_4bytes() == SRS_FLV_VIDEO_FOURCC_HEVC;
+    }
+    
+    char codec_id = data[0];
+    codec_id = codec_id & 0x0F;
+    
+    return codec_id == SrsCodecVideoHEVC;
+}
+
 bool SrsFlvCodec::audio_is_aac(char* data, int size)
 {
     // 1bytes required.
@@ -14563,13 +18272,22 @@ bool SrsFlvCodec::video_is_acceptable(char* data, int size)
     
     char frame_type = data[0];
     char codec_id = frame_type & 0x0f;
+    
+    // the enhanced RTMP, only hevc is supported.
+    if (frame_type & SRS_FLV_VIDEO_EX_HEADER) {
+        frame_type = (frame_type >> 4) & 0x07;
+        if (frame_type < 1 || frame_type > 5) {
+            return false;
+        }
+        return video_is_hevc(data, size);
+    }
     frame_type = (frame_type >> 4) & 0x0f;
     
     if (frame_type < 1 || frame_type > 5) {
         return false;
     }
     
-    if (codec_id < 2 || codec_id > 7) {
+    if ((codec_id < 2 || codec_id > 7) && codec_id != SrsCodecVideoHEVC) {
         return false;
     }
     
@@ -14600,6 +18318,165 @@ string srs_codec_avc_nalu2str(SrsAvcNaluType nalu_type)
     }
 }
 
+string srs_codec_hevc_nalu2str(SrsHevcNaluType nalu_type)
+{
+    switch (nalu_type) {
+        case SrsHevcNaluTypeCodedSliceTrailN: return "TrailN";
+        case SrsHevcNaluTypeCodedSliceTrailR: return "TrailR";
+        case SrsHevcNaluTypeCodedSliceBLA: return "BLA";
+        case SrsHevcNaluTypeCodedSliceBLANoLeading: return "BLANoLeading";
+        case SrsHevcNaluTypeCodedSliceIDR: return "IDR";
+        case SrsHevcNaluTypeCodedSliceIDRNoLeading: return "IDRNoLeading";
+        case SrsHevcNaluTypeCodedSliceCRA: return "CRA";
+        case SrsHevcNaluTypeVPS: return "VPS";
+        case SrsHevcNaluTypeSPS: return "SPS";
+        case SrsHevcNaluTypePPS: return "PPS";
+        case SrsHevcNaluTypeAccessUnitDelimiter: return "AccessUnitDelimiter";
+        case SrsHevcNaluTypePrefixSEI: return "PrefixSEI";
+        case SrsHevcNaluTypeSuffixSEI: return "SuffixSEI";
+        default: return "Other";
+    }
+}
+
+int srs_hevc_demux_sps(char* frame, int nb_frame, SrsHevcSps* sps)
+{
+    int ret = ERROR_SUCCESS;
+    
+    // 7.3.1.2 NAL unit header syntax, 2bytes.
+    // H.265-HEVC-ITU-T-REC-H.265-201304.pdf, page 31.
+    if (nb_frame < 2 || ((frame[0] >> 1) & 0x3f) != SrsHevcNaluTypeSPS) {
+        ret = ERROR_HEVC_DECODE_ERROR;
+        srs_error("hevc sps nal_unit_type shall be 33. ret=%d", ret);
+        return ret;
+    }
+    
+    // decode the rbsp from sps.
+    // XX 00 00 03 XX, the 03 byte is emulation_prevention_three_byte, drop it.
+    char* rbsp = new char[nb_frame];
+    SrsAutoFreeA(char, rbsp);
+    
+    int nb_rbsp = 0;
+    int nb_zeros = 0;
+    for (int i = 2; i < nb_frame; i++) {
+        if (nb_zeros == 2 && frame[i] == 0x03) {
+            nb_zeros = 0;
+            continue;
+        }
+        rbsp[nb_rbsp++] = frame[i];
+        nb_zeros = frame[i]? 0 : nb_zeros + 1;
+    }
+    
+    SrsStream stream;
+    if ((ret = stream.initialize(rbsp, nb_rbsp)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // 7.3.2.2 Sequence parameter set RBSP syntax, 1byte
+    // H.265-HEVC-ITU-T-REC-H.265-201304.pdf, page 33.
+    //      sps_video_parameter_set_id u(4)
+    //      sps_max_sub_layers_minus1 u(3)
+    //      sps_temporal_id_nesting_flag u(1)
+    // 7.3.3 Profile, tier and level syntax, 12bytes for general.
+    // H.265-HEVC-ITU-T-REC-H.265-201304.pdf, page 36.
+    if (!stream.require(13)) {
+        ret = ERROR_HEVC_DECODE_ERROR;
+        srs_error("hevc sps profile_tier_level required 13bytes. ret=%d", ret);
+        return ret;
+    }
+    int8_t v = stream.read_1bytes();
+    sps->sps_max_sub_layers_minus1 = (v >> 1) & 0x07;
+    sps->sps_temporal_id_nesting_flag = v & 0x01;
+    
+    v = stream.read_1bytes();
+    sps->general_profile_space = (v >> 6) & 0x03;
+    sps->general_tier_flag = (v >> 5) & 0x01;
+    sps->general_profile_idc = v & 0x1f;
+    sps->general_profile_compatibility_flags = (u_int32_t)stream.read_4bytes();
+    sps->general_constraint_indicator_flags = (int64_t)(u_int32_t)stream.read_4bytes() << 16;
+    sps->general_constraint_indicator_flags |= (u_int16_t)stream.read_2bytes();
+    sps->general_level_idc = stream.read_1bytes();
+    
+    // the sub layers, 2bits present flags for each of the 8 layers,
+    // then the profile of 88bits and the level of 8bits when present.
+    if (sps->sps_max_sub_layers_minus1 > 0) {
+        if (!stream.require(2)) {
+            ret = ERROR_HEVC_DECODE_ERROR;
+            srs_error("hevc sps sub layer flags required 2bytes. ret=%d", ret);
+            return ret;
+        }
+        u_int16_t flags = (u_int16_t)stream.read_2bytes();
+        
+        for (int i = 0; i < sps->sps_max_sub_layers_minus1; i++) {
+            int nb_skip = 0;
+            if ((flags >> (15 - 2 * i)) & 0x01) {
+                nb_skip += 11;
+            }
+            if ((flags >> (14 - 2 * i)) & 0x01) {
+                nb_skip += 1;
+            }
+            
+            if (!stream.require(nb_skip)) {
+                ret = ERROR_HEVC_DECODE_ERROR;
+                srs_error("hevc sps sub layer %d required %dbytes. ret=%d", i, nb_skip, ret);
+                return ret;
+            }
+            stream.skip(nb_skip);
+        }
+    }
+    
+    SrsBitStream bs;
+    if ((ret = bs.initialize(&stream)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    int32_t sps_seq_parameter_set_id = -1;
+    if ((ret = srs_avc_nalu_read_uev(&bs, sps_seq_parameter_set_id)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    if ((ret = srs_avc_nalu_read_uev(&bs, sps->chroma_format_idc)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    if (sps->chroma_format_idc == 3) {
+        int8_t separate_colour_plane_flag = -1;
+        if ((ret = srs_avc_nalu_read_bit(&bs, separate_colour_plane_flag)) != ERROR_SUCCESS) {
+            return ret;
+        }
+    }
+    
+    if ((ret = srs_avc_nalu_read_uev(&bs, sps->pic_width_in_luma_samples)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    if ((ret = srs_avc_nalu_read_uev(&bs, sps->pic_height_in_luma_samples)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    int8_t conformance_window_flag = -1;
+    if ((ret = srs_avc_nalu_read_bit(&bs, conformance_window_flag)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    if (conformance_window_flag) {
+        // conf_win_left/right/top/bottom_offset
+        for (int i = 0; i < 4; i++) {
+            int32_t conf_win_offset = -1;
+            if ((ret = srs_avc_nalu_read_uev(&bs, conf_win_offset)) != ERROR_SUCCESS) {
+                return ret;
+            }
+        }
+    }
+    
+    if ((ret = srs_avc_nalu_read_uev(&bs, sps->bit_depth_luma_minus8)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    if ((ret = srs_avc_nalu_read_uev(&bs, sps->bit_depth_chroma_minus8)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    srs_info("hevc sps parse profile=%d, level=%d, sps_id=%d, %dx%d", sps->general_profile_idc,
+        sps->general_level_idc, sps_seq_parameter_set_id, sps->pic_width_in_luma_samples, sps->pic_height_in_luma_samples);
+    
+    return ret;
+}
+
 SrsCodecSampleUnit::SrsCodecSampleUnit()
 {
     size = 0;
@@ -14625,6 +18502,7 @@ void SrsCodecSample::clear()
     nb_sample_units = 0;
 
     cts = 0;
+    vcodec = SrsCodecVideoReserved;
     frame_type = SrsCodecVideoAVCFrameReserved;
     avc_packet_type = SrsCodecVideoAVCTypeReserved;
     has_idr = false;
@@ -14652,6 +18530,17 @@ int SrsCodecSample::add_sample_unit(char* bytes, int size)
     sample_unit->bytes = bytes;
     sample_unit->size = size;
     
+    // for hevc, the IRAP(BLA/IDR/CRA) is the random access point.
+    if (is_video && vcodec == SrsCodecVideoHEVC) {
+        SrsHevcNaluType nal_unit_type = (SrsHevcNaluType)((bytes[0] >> 1) & 0x3f);
+        
+        if (nal_unit_type >= SrsHevcNaluTypeCodedSliceBLA && nal_unit_type <= SrsHevcNaluTypeReservedIRAP23) {
+            has_idr = true;
+        }
+        
+        return ret;
+    }
+    
     // for video, parse the nalu type, set the IDR flag.
     if (is_video) {
         SrsAvcNaluType nal_unit_type = (SrsAvcNaluType)(bytes[0] & 0x1f);
@@ -14668,8 +18557,12 @@ int SrsCodecSample::add_sample_unit(char* bytes, int size)
     return ret;
 }
 
+#if !defined(SRS_EXPORT_LIBRTMP)
+
 SrsAvcAacCodec::SrsAvcAacCodec()
 {
+    avc_parse_sps               = true;
+    
     width                       = 0;
     height                      = 0;
     duration                    = 0;
@@ -14696,6 +18589,8 @@ SrsAvcAacCodec::SrsAvcAacCodec()
     sequenceParameterSetNALUnit = NULL;
     pictureParameterSetLength   = 0;
     pictureParameterSetNALUnit  = NULL;
+    videoParameterSetLength     = 0;
+    videoParameterSetNALUnit    = NULL;
 
     payload_format = SrsAvcPayloadFormatGuess;
     stream = new SrsStream();
@@ -14703,12 +18598,13 @@ SrsAvcAacCodec::SrsAvcAacCodec()
 
 SrsAvcAacCodec::~SrsAvcAacCodec()
 {
-    srs_freep(avc_extra_data);
-    srs_freep(aac_extra_data);
+    srs_freepa(avc_extra_data);
+    srs_freepa(aac_extra_data);
 
     srs_freep(stream);
-    srs_freep(sequenceParameterSetNALUnit);
-    srs_freep(pictureParameterSetNALUnit);
+    srs_freepa(sequenceParameterSetNALUnit);
+    srs_freepa(pictureParameterSetNALUnit);
+    srs_freepa(videoParameterSetNALUnit);
 }
 
 bool SrsAvcAacCodec::is_avc_codec_ok()
@@ -14784,7 +18680,7 @@ int SrsAvcAacCodec::audio_aac_demux(char* data, int size, SrsCodecSample* sample
         // 1.6.2.1 AudioSpecificConfig, in aac-mp4a-format-ISO_IEC_14496-3+2001.pdf, page 33.
         aac_extra_size = stream->size() - stream->pos();
         if (aac_extra_size > 0) {
-            srs_freep(aac_extra_data);
+            srs_freepa(aac_extra_data);
             aac_extra_data = new char[aac_extra_size];
             memcpy(aac_extra_data, stream->data() + stream->pos(), aac_extra_size);
 
@@ -14903,7 +18799,7 @@ int SrsAvcAacCodec::audio_aac_sequence_header_demux(char* data, int size)
     // TODO: FIXME: to support aac he/he-v2, see: ngx_rtmp_codec_parse_aac_header
     // @see: https://github.com/winlinvip/nginx-rtmp-module/commit/3a5f9eea78fc8d11e8be922aea9ac349b9dcbfc2
     // 
-    // donot force to LC, @see: https://github.com/simple-rtmp-server/srs/issues/81
+    // donot force to LC, @see: https://github.com/ossrs/srs/issues/81
     // the source will print the sequence header info.
     //if (aac_profile > 3) {
         // Mark all extended profiles as LC
@@ -14940,38 +18836,93 @@ int SrsAvcAacCodec::video_avc_demux(char* data, int size, SrsCodecSample* sample
     // @see: E.4.3 Video Tags, video_file_format_spec_v10_1.pdf, page 78
     int8_t frame_type = stream->read_1bytes();
     int8_t codec_id = frame_type & 0x0f;
-    frame_type = (frame_type >> 4) & 0x0f;
+    
+    // for the enhanced RTMP, the low 4bits is the packet type,
+    // and the codec is specified by the FourCC.
+    // @see https://github.com/veovera/enhanced-rtmp
+    bool is_ex_header = (frame_type & SRS_FLV_VIDEO_EX_HEADER) != 0;
+    int8_t ex_packet_type = codec_id;
+    if (is_ex_header) {
+        frame_type = (frame_type >> 4) & 0x07;
+    } else {
+        frame_type = (frame_type >> 4) & 0x0f;
+    }
     
     sample->frame_type = (SrsCodecVideoAVCFrame)frame_type;
     
     // ignore info frame without error,
-    // @see https://github.com/simple-rtmp-server/srs/issues/288#issuecomment-69863909
+    // @see https://github.com/ossrs/srs/issues/288#issuecomment-69863909
     if (sample->frame_type == SrsCodecVideoAVCFrameVideoInfoFrame) {
         srs_warn("avc igone the info frame, ret=%d", ret);
         return ret;
     }
     
-    // only support h.264/avc
-    if (codec_id != SrsCodecVideoAVC) {
-        ret = ERROR_HLS_DECODE_ERROR;
-        srs_error("avc only support video h.264/avc codec. actual=%d, ret=%d", codec_id, ret);
-        return ret;
+    if (is_ex_header) {
+        if (!stream->require(4)) {
+            ret = ERROR_HLS_DECODE_ERROR;
+            srs_error("avc decode fourcc failed. ret=%d", ret);
+            return ret;
+        }
+        int32_t fourcc = stream->read_4bytes();
+        if (fourcc != SRS_FLV_VIDEO_FOURCC_HEVC) {
+            ret = ERROR_HEVC_DECODE_ERROR;
+            srs_error("avc only support enhanced hevc. fourcc=%#x, ret=%d", fourcc, ret);
+            return ret;
+        }
+        codec_id = SrsCodecVideoHEVC;
     }
-    video_codec_id = codec_id;
     
-    if (!stream->require(4)) {
+    // only support h.264/avc and h.265/hevc
+    if (codec_id != SrsCodecVideoAVC && codec_id != SrsCodecVideoHEVC) {
         ret = ERROR_HLS_DECODE_ERROR;
-        srs_error("avc decode avc_packet_type failed. ret=%d", ret);
+        srs_error("avc only support video h.264/avc or h.265/hevc codec. actual=%d, ret=%d", codec_id, ret);
         return ret;
     }
-    int8_t avc_packet_type = stream->read_1bytes();
-    int32_t composition_time = stream->read_3bytes();
+    video_codec_id = codec_id;
+    sample->vcodec = (SrsCodecVideo)codec_id;
+    
+    int8_t avc_packet_type = SrsCodecVideoAVCTypeReserved;
+    int32_t composition_time = 0;
+    if (is_ex_header) {
+        // map the enhanced packet type to avc packet type,
+        // only the coded frames carry the composition time.
+        if (ex_packet_type == SrsCodecVideoExPacketTypeSequenceStart) {
+            avc_packet_type = SrsCodecVideoAVCTypeSequenceHeader;
+        } else if (ex_packet_type == SrsCodecVideoExPacketTypeCodedFrames
+            || ex_packet_type == SrsCodecVideoExPacketTypeCodedFramesX
+        ) {
+            avc_packet_type = SrsCodecVideoAVCTypeNALU;
+        } else if (ex_packet_type == SrsCodecVideoExPacketTypeSequenceEnd) {
+            avc_packet_type = SrsCodecVideoAVCTypeSequenceHeaderEOF;
+        }
+        
+        if (ex_packet_type == SrsCodecVideoExPacketTypeCodedFrames) {
+            if (!stream->require(3)) {
+                ret = ERROR_HLS_DECODE_ERROR;
+                srs_error("avc decode composition_time failed. ret=%d", ret);
+                return ret;
+            }
+            composition_time = stream->read_3bytes();
+        }
+    } else {
+        if (!stream->require(4)) {
+            ret = ERROR_HLS_DECODE_ERROR;
+            srs_error("avc decode avc_packet_type failed. ret=%d", ret);
+            return ret;
+        }
+        avc_packet_type = stream->read_1bytes();
+        composition_time = stream->read_3bytes();
+    }
     
     // pts = dts + cts.
     sample->cts = composition_time;
     sample->avc_packet_type = (SrsCodecVideoAVCType)avc_packet_type;
     
-    if (avc_packet_type == SrsCodecVideoAVCTypeSequenceHeader) {
+    if (avc_packet_type == SrsCodecVideoAVCTypeSequenceHeader && codec_id == SrsCodecVideoHEVC) {
+        if ((ret = hevc_demux_vps_sps_pps(stream)) != ERROR_SUCCESS) {
+            return ret;
+        }
+    } else if (avc_packet_type == SrsCodecVideoAVCTypeSequenceHeader) {
         if ((ret = avc_demux_sps_pps(stream)) != ERROR_SUCCESS) {
             return ret;
         }
@@ -15048,7 +18999,7 @@ int SrsAvcAacCodec::avc_demux_sps_pps(SrsStream* stream)
     // 5.2.4.1.1 Syntax, H.264-AVC-ISO_IEC_14496-15.pdf, page 16
     avc_extra_size = stream->size() - stream->pos();
     if (avc_extra_size > 0) {
-        srs_freep(avc_extra_data);
+        srs_freepa(avc_extra_data);
         avc_extra_data = new char[avc_extra_size];
         memcpy(avc_extra_data, stream->data() + stream->pos(), avc_extra_size);
     }
@@ -15109,7 +19060,7 @@ int SrsAvcAacCodec::avc_demux_sps_pps(SrsStream* stream)
         return ret;
     }
     if (sequenceParameterSetLength > 0) {
-        srs_freep(sequenceParameterSetNALUnit);
+        srs_freepa(sequenceParameterSetNALUnit);
         sequenceParameterSetNALUnit = new char[sequenceParameterSetLength];
         stream->read_bytes(sequenceParameterSetNALUnit, sequenceParameterSetLength);
     }
@@ -15138,7 +19089,7 @@ int SrsAvcAacCodec::avc_demux_sps_pps(SrsStream* stream)
         return ret;
     }
     if (pictureParameterSetLength > 0) {
-        srs_freep(pictureParameterSetNALUnit);
+        srs_freepa(pictureParameterSetNALUnit);
         pictureParameterSetNALUnit = new char[pictureParameterSetLength];
         stream->read_bytes(pictureParameterSetNALUnit, pictureParameterSetLength);
     }
@@ -15146,6 +19097,110 @@ int SrsAvcAacCodec::avc_demux_sps_pps(SrsStream* stream)
     return avc_demux_sps();
 }
 
+int SrsAvcAacCodec::hevc_demux_vps_sps_pps(SrsStream* stream)
+{
+    int ret = ERROR_SUCCESS;
+    
+    // HEVCDecoderConfigurationRecord
+    // 8.3.3.1.2 Syntax, ISO_IEC_14496-15-2014.pdf, page 55
+    avc_extra_size = stream->size() - stream->pos();
+    if (avc_extra_size > 0) {
+        srs_freepa(avc_extra_data);
+        avc_extra_data = new char[avc_extra_size];
+        memcpy(avc_extra_data, stream->data() + stream->pos(), avc_extra_size);
+    }
+    
+    // 22bytes from configurationVersion to lengthSizeMinusOne,
+    // then 1byte numOfArrays.
+    if (!stream->require(23)) {
+        ret = ERROR_HEVC_DECODE_ERROR;
+        srs_error("hevc decode sequenc header failed. ret=%d", ret);
+        return ret;
+    }
+    stream->skip(21);
+    
+    // parse the NALU size.
+    int8_t lengthSizeMinusOne = stream->read_1bytes();
+    lengthSizeMinusOne &= 0x03;
+    NAL_unit_length = lengthSizeMinusOne;
+    
+    // the same as avc, the value of this field shall be one of 0, 1, or 3.
+    if (NAL_unit_length == 2) {
+        ret = ERROR_HEVC_DECODE_ERROR;
+        srs_error("hevc lengthSizeMinusOne should never be 2. ret=%d", ret);
+        return ret;
+    }
+    
+    // the parameter sets of the previous sequence header.
+    videoParameterSetLength = sequenceParameterSetLength = pictureParameterSetLength = 0;
+    
+    // each array is array_completeness(1bit), reserved(1bit), NAL_unit_type(6bits),
+    // numNalus(2B), then each NALU is nalUnitLength(2B) and nalUnit.
+    u_int8_t numOfArrays = stream->read_1bytes();
+    for (int i = 0; i < numOfArrays; i++) {
+        if (!stream->require(3)) {
+            ret = ERROR_HEVC_DECODE_ERROR;
+            srs_error("hevc decode sequenc header array failed. ret=%d", ret);
+            return ret;
+        }
+        SrsHevcNaluType nal_unit_type = (SrsHevcNaluType)(stream->read_1bytes() & 0x3f);
+        u_int16_t numNalus = stream->read_2bytes();
+        
+        for (int j = 0; j < numNalus; j++) {
+            if (!stream->require(2)) {
+                ret = ERROR_HEVC_DECODE_ERROR;
+                srs_error("hevc decode sequenc header nalu size failed. ret=%d", ret);
+                return ret;
+            }
+            u_int16_t nalUnitLength = stream->read_2bytes();
+            if (!stream->require(nalUnitLength)) {
+                ret = ERROR_HEVC_DECODE_ERROR;
+                srs_error("hevc decode sequenc header nalu data failed. ret=%d", ret);
+                return ret;
+            }
+            
+            // only use the first vps, sps and pps.
+            u_int16_t* pnb = NULL;
+            char** pnalu = NULL;
+            if (nal_unit_type == SrsHevcNaluTypeVPS) {
+                pnb = &videoParameterSetLength;
+                pnalu = &videoParameterSetNALUnit;
+            } else if (nal_unit_type == SrsHevcNaluTypeSPS) {
+                pnb = &sequenceParameterSetLength;
+                pnalu = &sequenceParameterSetNALUnit;
+            } else if (nal_unit_type == SrsHevcNaluTypePPS) {
+                pnb = &pictureParameterSetLength;
+                pnalu = &pictureParameterSetNALUnit;
+            }
+            
+            if (!pnb || *pnb > 0 || nalUnitLength == 0) {
+                stream->skip(nalUnitLength);
+                continue;
+            }
+            
+            srs_freepa(*pnalu);
+            *pnalu = new char[nalUnitLength];
+            *pnb = nalUnitLength;
+            stream->read_bytes(*pnalu, nalUnitLength);
+        }
+    }
+    
+    // we donot parse the detail of sps.
+    // @see https://github.com/ossrs/srs/issues/474
+    if (!avc_parse_sps || !sequenceParameterSetLength) {
+        return ret;
+    }
+    
+    SrsHevcSps sps;
+    if ((ret = srs_hevc_demux_sps(sequenceParameterSetNALUnit, sequenceParameterSetLength, &sps)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    width = sps.pic_width_in_luma_samples;
+    height = sps.pic_height_in_luma_samples;
+    
+    return ret;
+}
+
 int SrsAvcAacCodec::avc_demux_sps()
 {
     int ret = ERROR_SUCCESS;
@@ -15198,7 +19253,7 @@ int SrsAvcAacCodec::avc_demux_sps()
     // decode the rbsp from sps.
     // rbsp[ i ] a raw byte sequence payload is specified as an ordered sequence of bytes.
     int8_t* rbsp = new int8_t[sequenceParameterSetLength];
-    SrsAutoFree(int8_t, rbsp);
+    SrsAutoFreeA(int8_t, rbsp);
     
     int nb_rbsp = 0;
     while (!stream.empty()) {
@@ -15227,6 +19282,12 @@ int SrsAvcAacCodec::avc_demux_sps_rbsp(char* rbsp, int nb_rbsp)
 {
     int ret = ERROR_SUCCESS;
     
+    // we donot parse the detail of sps.
+    // @see https://github.com/ossrs/srs/issues/474
+    if (!avc_parse_sps) {
+        return ret;
+    }
+    
     // reparse the rbsp.
     SrsStream stream;
     if ((ret = stream.initialize(rbsp, nb_rbsp)) != ERROR_SUCCESS) {
@@ -15479,7 +19540,7 @@ int SrsAvcAacCodec::avc_demux_ibmf_format(SrsStream* stream, SrsCodecSample* sam
         }
         
         // maybe stream is invalid format.
-        // see: https://github.com/simple-rtmp-server/srs/issues/183
+        // see: https://github.com/ossrs/srs/issues/183
         if (NALUnitLength < 0) {
             ret = ERROR_HLS_DECODE_ERROR;
             srs_error("maybe stream is AnnexB format. ret=%d", ret);
@@ -15505,11 +19566,13 @@ int SrsAvcAacCodec::avc_demux_ibmf_format(SrsStream* stream, SrsCodecSample* sam
     return ret;
 }
 
+#endif
+
 // following is generated by src/kernel/srs_kernel_file.cpp
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -15531,22 +19594,41 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 //#include <srs_kernel_file.hpp>
 
-// for srs-librtmp, @see https://github.com/simple-rtmp-server/srs/issues/213
+// for srs-librtmp, @see https://github.com/ossrs/srs/issues/213
 #ifndef _WIN32
 #include <unistd.h>
 #include <sys/uio.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 #endif
 
 #include <fcntl.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sstream>
 using namespace std;
 
 //#include <srs_kernel_log.hpp>
 //#include <srs_kernel_error.hpp>
+//#include <srs_kernel_utility.hpp>
+//#include <srs_core_performance.hpp>
+
+// the aligned size of block for O_DIRECT.
+#define SRS_FILE_DIRECT_ALIGN 4096
+// the max iovs for each writev, the IOV_MAX of linux is 1024.
+#define SRS_FILE_WRITEV_IOVS 64
 
 SrsFileWriter::SrsFileWriter()
 {
     fd = -1;
+    buf = NULL;
+    nb_buf = buf_size = 0;
+    flush_size = SRS_PERF_FILE_WRITE_BUFFER;
+    flush_interval = 0;
+    last_flush = 0;
+    sync = SrsFileSyncNone;
+    direct = directed = false;
 }
 
 SrsFileWriter::~SrsFileWriter()
@@ -15556,29 +19638,15 @@ SrsFileWriter::~SrsFileWriter()
 
 int SrsFileWriter::open(string p)
 {
-    int ret = ERROR_SUCCESS;
-    
-    if (fd > 0) {
-        ret = ERROR_SYSTEM_FILE_ALREADY_OPENED;
-        srs_error("file %s already opened. ret=%d", path.c_str(), ret);
-        return ret;
-    }
-    
-    int flags = O_CREAT|O_WRONLY|O_TRUNC;
-    mode_t mode = S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP|S_IROTH;
-
-    if ((fd = ::open(p.c_str(), flags, mode)) < 0) {
-        ret = ERROR_SYSTEM_FILE_OPENE;
-        srs_error("open file %s failed. ret=%d", p.c_str(), ret);
-        return ret;
-    }
-    
-    path = p;
-    
-    return ret;
+    return open_fd(p, O_CREAT|O_WRONLY|O_TRUNC);
 }
 
 int SrsFileWriter::open_append(string p)
+{
+    return open_fd(p, O_APPEND|O_WRONLY);
+}
+
+int SrsFileWriter::open_fd(string p, int flags)
 {
     int ret = ERROR_SUCCESS;
     
@@ -15588,36 +19656,65 @@ int SrsFileWriter::open_append(string p)
         return ret;
     }
     
-    int flags = O_APPEND|O_WRONLY;
     mode_t mode = S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP|S_IROTH;
-
-    if ((fd = ::open(p.c_str(), flags, mode)) < 0) {
+    
+    // the O_DIRECT requires the offset aligned, so never append.
+#ifdef O_DIRECT
+    if (direct && (flags & O_APPEND) == 0) {
+        if ((fd = ::open(p.c_str(), flags|O_DIRECT, mode)) >= 0) {
+            directed = true;
+        } else {
+            srs_warn("open file %s in direct mode failed, use page cache.", p.c_str());
+        }
+    }
+#endif
+    
+    if (fd < 0 && (fd = ::open(p.c_str(), flags, mode)) < 0) {
         ret = ERROR_SYSTEM_FILE_OPENE;
         srs_error("open file %s failed. ret=%d", p.c_str(), ret);
         return ret;
     }
     
     path = p;
+    last_flush = srs_update_system_time_ms();
+    
+    if ((ret = set_buffer(flush_size, flush_interval)) != ERROR_SUCCESS) {
+        return ret;
+    }
     
     return ret;
 }
 
-void SrsFileWriter::close()
+int SrsFileWriter::close()
 {
     int ret = ERROR_SUCCESS;
     
     if (fd < 0) {
-        return;
+        return ret;
     }
     
-    if (::close(fd) < 0) {
+    // always close the fd, return the first error.
+    if ((ret = flush()) != ERROR_SUCCESS) {
+        srs_error("flush file %s failed. ret=%d", path.c_str(), ret);
+    }
+    
+    int r0 = ERROR_SUCCESS;
+    if (ret == ERROR_SUCCESS && sync == SrsFileSyncClose && (r0 = do_sync()) != ERROR_SUCCESS) {
+        ret = r0;
+    }
+    
+    free(buf);
+    buf = NULL;
+    nb_buf = buf_size = 0;
+    directed = false;
+    
+    if (::close(fd) < 0 && ret == ERROR_SUCCESS) {
         ret = ERROR_SYSTEM_FILE_CLOSE;
         srs_error("close file %s failed. ret=%d", path.c_str(), ret);
-        return;
     }
     fd = -1;
     
-    return;
+    return ret;
 }
 
 bool SrsFileWriter::is_open()
@@ -15627,199 +19724,1097 @@ bool SrsFileWriter::is_open()
 
 void SrsFileWriter::lseek(int64_t offset)
 {
+    int ret = ERROR_SUCCESS;
+    
+    if ((ret = flush()) != ERROR_SUCCESS) {
+        srs_error("flush file %s for seek failed. ret=%d", path.c_str(), ret);
+    }
+    
     ::lseek(fd, (off_t)offset, SEEK_SET);
 }
 
 int64_t SrsFileWriter::tellg()
 {
-    return (int64_t)::lseek(fd, 0, SEEK_CUR);
+    return (int64_t)::lseek(fd, 0, SEEK_CUR) + nb_buf;
 }
 
 int SrsFileWriter::write(void* buf, size_t count, ssize_t* pnwrite)
+{
+    iovec iov;
+    iov.iov_base = (char*)buf;
+    iov.iov_len = count;
+    
+    return writev(&iov, 1, pnwrite);
+}
+
+int SrsFileWriter::writev(iovec* iov, int iovcnt, ssize_t* pnwrite)
 {
     int ret = ERROR_SUCCESS;
     
-    ssize_t nwrite;
-    // TODO: FIXME: use st_write.
-    if ((nwrite = ::write(fd, buf, count)) < 0) {
-        ret = ERROR_SYSTEM_FILE_WRITE;
-        srs_error("write to file %s failed. ret=%d", path.c_str(), ret);
-        return ret;
+    ssize_t nwrite = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        nwrite += (ssize_t)iov[i].iov_len;
     }
     
-    if (pnwrite != NULL) {
+    if (!buf) {
+        // write through by one writev.
+        if ((ret = do_writev(NULL, 0, iov, iovcnt)) != ERROR_SUCCESS) {
+            return ret;
+        }
+    } else if (nb_buf + nwrite <= buf_size) {
+        // group the small writes in buffer.
+        for (int i = 0; i < iovcnt; i++) {
+            memcpy(buf + nb_buf, iov[i].iov_base, iov[i].iov_len);
+            nb_buf += (int)iov[i].iov_len;
+        }
+    } else if (!directed) {
+        // write the buffer and iovs in one writev.
+        if ((ret = do_writev(buf, nb_buf, iov, iovcnt)) != ERROR_SUCCESS) {
+            return ret;
+        }
+        nb_buf = 0;
+        last_flush = srs_update_system_time_ms();
+    } else {
+        // the O_DIRECT always writes the aligned buffer.
+        for (int i = 0; i < iovcnt; i++) {
+            char* p = (char*)iov[i].iov_base;
+            int left = (int)iov[i].iov_len;
+            while (left > 0) {
+                int nb_copy = srs_min(left, buf_size - nb_buf);
+                memcpy(buf + nb_buf, p, nb_copy);
+                nb_buf += nb_copy;
+                p += nb_copy;
+                left -= nb_copy;
+                
+                if (nb_buf == buf_size && (ret = do_flush(false)) != ERROR_SUCCESS) {
+                    return ret;
+                }
+            }
+        }
+    }
+    
+    // flush when interval elapsed.
+    if (buf && nb_buf > 0 && flush_interval > 0 && srs_update_system_time_ms() - last_flush >= flush_interval) {
+        if ((ret = do_flush(false)) != ERROR_SUCCESS) {
+            return ret;
+        }
+    }
+    
+    if (pnwrite) {
         *pnwrite = nwrite;
     }
     
     return ret;
 }
 
-int SrsFileWriter::writev(iovec* iov, int iovcnt, ssize_t* pnwrite)
+int SrsFileWriter::flush()
+{
+    return do_flush(true);
+}
+
+int SrsFileWriter::set_buffer(int size, int interval_ms)
 {
     int ret = ERROR_SUCCESS;
     
-    ssize_t nwrite = 0;
-    for (int i = 0; i < iovcnt; i++) {
-        iovec* piov = iov + i;
-        ssize_t this_nwrite = 0;
-        if ((ret = write(piov->iov_base, piov->iov_len, &this_nwrite)) != ERROR_SUCCESS) {
+    flush_size = srs_max(0, size);
+    flush_interval = srs_max(0, interval_ms);
+    
+    if (fd < 0) {
+        return ret;
+    }
+    
+    // the O_DIRECT must write the aligned blocks by buffer.
+    int size_aligned = flush_size;
+    if (directed) {
+        size_aligned = srs_max(flush_size, SRS_FILE_DIRECT_ALIGN);
+        size_aligned = (size_aligned + SRS_FILE_DIRECT_ALIGN - 1) / SRS_FILE_DIRECT_ALIGN * SRS_FILE_DIRECT_ALIGN;
+    }
+    
+    if (buf && size_aligned == buf_size) {
+        return ret;
+    }
+    
+    if ((ret = do_flush(false)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    char* data = NULL;
+    if (size_aligned > 0) {
+#ifndef _WIN32
+        if (posix_memalign((void**)&data, SRS_FILE_DIRECT_ALIGN, size_aligned) != 0) {
+            data = NULL;
+        }
+#else
+        data = (char*)malloc(size_aligned);
+#endif
+        if (!data) {
+            ret = ERROR_SYSTEM_FILE_WRITE;
+            srs_error("alloc write buffer %d of file %s failed. ret=%d", size_aligned, path.c_str(), ret);
             return ret;
         }
-        nwrite += this_nwrite;
+        if (nb_buf > 0) {
+            memcpy(data, buf, nb_buf);
+        }
     }
     
-    if (pnwrite) {
-        *pnwrite = nwrite;
-    }
+    free(buf);
+    buf = data;
+    buf_size = size_aligned;
     
     return ret;
 }
 
-SrsFileReader::SrsFileReader()
+void SrsFileWriter::set_sync(SrsFileSync v)
 {
-    fd = -1;
+    sync = v;
 }
 
-SrsFileReader::~SrsFileReader()
+void SrsFileWriter::set_direct(bool v)
 {
-    close();
+    direct = v;
 }
 
-int SrsFileReader::open(string p)
+int SrsFileWriter::do_flush(bool all)
 {
     int ret = ERROR_SUCCESS;
     
-    if (fd > 0) {
-        ret = ERROR_SYSTEM_FILE_ALREADY_OPENED;
-        srs_error("file %s already opened. ret=%d", path.c_str(), ret);
+    if (!buf || nb_buf <= 0) {
         return ret;
     }
+    
+    int size = nb_buf;
+    
+    // the O_DIRECT only writes the aligned blocks, 
+    // and clear the O_DIRECT to write the tail.
+    if (directed) {
+        size = nb_buf / SRS_FILE_DIRECT_ALIGN * SRS_FILE_DIRECT_ALIGN;
+        
+        if (all && size < nb_buf) {
+            if (size > 0 && (ret = do_writev(buf, size, NULL, 0)) != ERROR_SUCCESS) {
+                return ret;
+            }
+            memmove(buf, buf + size, nb_buf - size);
+            nb_buf -= size;
+            
+#ifdef O_DIRECT
+            int flags = ::fcntl(fd, F_GETFL);
+            if (flags < 0 || ::fcntl(fd, F_SETFL, flags & ~O_DIRECT) < 0) {
+                ret = ERROR_SYSTEM_FILE_WRITE;
+                srs_error("clear direct of file %s failed. ret=%d", path.c_str(), ret);
+                return ret;
+            }
+#endif
+            directed = false;
+            size = nb_buf;
+        }
+    }
+    
+    if (size > 0) {
+        if ((ret = do_writev(buf, size, NULL, 0)) != ERROR_SUCCESS) {
+            return ret;
+        }
+        if (size < nb_buf) {
+            memmove(buf, buf + size, nb_buf - size);
+        }
+        nb_buf -= size;
+    }
+    last_flush = srs_update_system_time_ms();
+    
+    return ret;
+}
 
-    if ((fd = ::open(p.c_str(), O_RDONLY)) < 0) {
-        ret = ERROR_SYSTEM_FILE_OPENE;
-        srs_error("open file %s failed. ret=%d", p.c_str(), ret);
+int SrsFileWriter::do_writev(char* data, int size, iovec* iov, int iovcnt)
+{
+    int ret = ERROR_SUCCESS;
+    
+    iovec iovs[SRS_FILE_WRITEV_IOVS];
+    int nb_iovs = 0;
+    
+    if (size > 0) {
+        iovs[nb_iovs].iov_base = data;
+        iovs[nb_iovs].iov_len = size;
+        nb_iovs++;
+    }
+    
+    while (nb_iovs > 0 || iovcnt > 0) {
+        // fill the iovs by the left of user iovs.
+        while (nb_iovs < SRS_FILE_WRITEV_IOVS && iovcnt > 0) {
+            if (iov->iov_len > 0) {
+                iovs[nb_iovs++] = *iov;
+            }
+            iov++;
+            iovcnt--;
+        }
+        if (nb_iovs <= 0) {
+            break;
+        }
+        
+        ssize_t nwrite;
+        // TODO: FIXME: use st_write.
+        if ((nwrite = ::writev(fd, iovs, nb_iovs)) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ret = ERROR_SYSTEM_FILE_WRITE;
+            srs_error("write to file %s failed. ret=%d", path.c_str(), ret);
+            return ret;
+        }
+        
+        // consume the written bytes, keep the partial one.
+        int nb_done = 0;
+        while (nb_done < nb_iovs && nwrite >= (ssize_t)iovs[nb_done].iov_len) {
+            nwrite -= (ssize_t)iovs[nb_done].iov_len;
+            nb_done++;
+        }
+        if (nb_done < nb_iovs && nwrite > 0) {
+            iovs[nb_done].iov_base = (char*)iovs[nb_done].iov_base + nwrite;
+            iovs[nb_done].iov_len -= nwrite;
+        }
+        memmove(iovs, iovs + nb_done, (nb_iovs - nb_done) * sizeof(iovec));
+        nb_iovs -= nb_done;
+    }
+    
+    if (sync == SrsFileSyncFlush && (ret = do_sync()) != ERROR_SUCCESS) {
         return ret;
     }
     
-    path = p;
+    return ret;
+}
+
+int SrsFileWriter::do_sync()
+{
+    int ret = ERROR_SUCCESS;
+    
+#ifndef _WIN32
+#ifdef __linux__
+    int r0 = ::fdatasync(fd);
+#else
+    int r0 = ::fsync(fd);
+#endif
+    if (r0 < 0) {
+        ret = ERROR_SYSTEM_FILE_WRITE;
+        srs_error("sync file %s failed. ret=%d", path.c_str(), ret);
+        return ret;
+    }
+#endif
     
     return ret;
 }
 
-void SrsFileReader::close()
+#ifndef _WIN32
+/**
+* the shared write threads of async file writers,
+* the ready writers are written in round-robin, a buffer each time.
+*/
+class SrsFileWritePool
+{
+public:
+    pthread_mutex_t lock;
+private:
+    pthread_cond_t cond;
+    std::deque<SrsAsyncFileWriter*> ready;
+    bool started;
+public:
+    SrsFileWritePool();
+    virtual ~SrsFileWritePool();
+public:
+    /**
+    * start the write threads when not started.
+    */
+    virtual int start();
+    /**
+    * put the writer to ready queue.
+    * @remark user must hold the lock.
+    */
+    virtual void schedule(SrsAsyncFileWriter* writer);
+private:
+    static void* worker(void* arg);
+    virtual void cycle();
+};
+
+SrsFileWritePool::SrsFileWritePool()
+{
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&cond, NULL);
+    started = false;
+}
+
+SrsFileWritePool::~SrsFileWritePool()
+{
+    // the threads never quit, so never destroy the lock.
+}
+
+int SrsFileWritePool::start()
 {
     int ret = ERROR_SUCCESS;
     
-    if (fd < 0) {
-        return;
+    pthread_mutex_lock(&lock);
+    
+    for (int i = 0; !started && i < SRS_PERF_FILE_WRITE_THREADS; i++) {
+        pthread_t tid;
+        if (pthread_create(&tid, NULL, worker, this) != 0) {
+            ret = ERROR_SYSTEM_CREATE_THREAD;
+            srs_error("create file write thread failed. ret=%d", ret);
+            break;
+        }
+        pthread_detach(tid);
     }
     
-    if (::close(fd) < 0) {
-        ret = ERROR_SYSTEM_FILE_CLOSE;
-        srs_error("close file %s failed. ret=%d", path.c_str(), ret);
+    // the started threads are ok to work.
+    started = true;
+    
+    pthread_mutex_unlock(&lock);
+    
+    return ret;
+}
+
+void SrsFileWritePool::schedule(SrsAsyncFileWriter* writer)
+{
+    if (writer->scheduled) {
         return;
     }
-    fd = -1;
     
-    return;
+    writer->scheduled = true;
+    ready.push_back(writer);
+    pthread_cond_signal(&cond);
 }
 
-bool SrsFileReader::is_open()
+void* SrsFileWritePool::worker(void* arg)
 {
-    return fd > 0;
+    SrsFileWritePool* pool = (SrsFileWritePool*)arg;
+    pool->cycle();
+    return NULL;
 }
 
-int64_t SrsFileReader::tellg()
+void SrsFileWritePool::cycle()
 {
-    return (int64_t)::lseek(fd, 0, SEEK_CUR);
+    pthread_mutex_lock(&lock);
+    
+    for (;;) {
+        while (ready.empty()) {
+            pthread_cond_wait(&cond, &lock);
+        }
+        
+        // the writer is owned by this thread util rescheduled,
+        // so its buffers are written in order.
+        SrsAsyncFileWriter* writer = ready.front();
+        ready.pop_front();
+        
+        SrsFileChunk* chunk = writer->chunks.front();
+        bool failed = writer->error != ERROR_SUCCESS;
+        
+        pthread_mutex_unlock(&lock);
+        
+        // drop the left buffers when write failed.
+        int ret = ERROR_SUCCESS;
+        if (!failed) {
+            ret = writer->file->write(chunk->data, chunk->size, NULL);
+        }
+        
+        pthread_mutex_lock(&lock);
+        
+        if (ret != ERROR_SUCCESS) {
+            writer->error = ret;
+        }
+        
+        writer->chunks.pop_front();
+        chunk->size = 0;
+        writer->free_chunks.push_back(chunk);
+        
+        if (!writer->chunks.empty()) {
+            ready.push_back(writer);
+        } else {
+            writer->scheduled = false;
+        }
+        
+        // @remark never use the writer after unlock, for it may be freed.
+        pthread_cond_broadcast(&writer->cond);
+    }
 }
 
-void SrsFileReader::skip(int64_t size)
+static SrsFileWritePool _srs_file_write_pool;
+
+SrsAsyncFileWriter::SrsAsyncFileWriter()
 {
-    ::lseek(fd, (off_t)size, SEEK_CUR);
+    file = new SrsFileWriter();
+    current = NULL;
+    chunk_size = srs_max(SRS_PERF_FILE_WRITE_BUFFER, SRS_FILE_DIRECT_ALIGN);
+    chunk_interval = 0;
+    last_submit = 0;
+    max_inflight = SRS_PERF_FILE_WRITE_INFLIGHT;
+    nonblocking = false;
+    position = 0;
+    scheduled = false;
+    error = ERROR_SUCCESS;
+    pthread_cond_init(&cond, NULL);
 }
 
-int64_t SrsFileReader::lseek(int64_t offset)
+SrsAsyncFileWriter::~SrsAsyncFileWriter()
 {
-    return (int64_t)::lseek(fd, (off_t)offset, SEEK_SET);
+    close();
+    
+    if (current) {
+        srs_freepa(current->data);
+        srs_freep(current);
+    }
+    
+    std::vector<SrsFileChunk*>::iterator it;
+    for (it = free_chunks.begin(); it != free_chunks.end(); ++it) {
+        SrsFileChunk* chunk = *it;
+        srs_freepa(chunk->data);
+        srs_freep(chunk);
+    }
+    free_chunks.clear();
+    
+    srs_freep(file);
+    pthread_cond_destroy(&cond);
 }
 
-int64_t SrsFileReader::filesize()
+int SrsAsyncFileWriter::open(string p)
 {
-    int64_t cur = tellg();
-    int64_t size = (int64_t)::lseek(fd, 0, SEEK_END);
-    ::lseek(fd, (off_t)cur, SEEK_SET);
-    return size;
+    int ret = ERROR_SUCCESS;
+    
+    if ((ret = file->open(p)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    return on_opened();
 }
 
-int SrsFileReader::read(void* buf, size_t count, ssize_t* pnread)
+int SrsAsyncFileWriter::open_append(string p)
 {
     int ret = ERROR_SUCCESS;
     
-    ssize_t nread;
-    // TODO: FIXME: use st_read.
-    if ((nread = ::read(fd, buf, count)) < 0) {
-        ret = ERROR_SYSTEM_FILE_READ;
-        srs_error("read from file %s failed. ret=%d", path.c_str(), ret);
+    if ((ret = file->open_append(p)) != ERROR_SUCCESS) {
         return ret;
     }
     
-    if (nread == 0) {
-        ret = ERROR_SYSTEM_FILE_EOF;
+    return on_opened();
+}
+
+int SrsAsyncFileWriter::close()
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (!file->is_open()) {
         return ret;
     }
     
-    if (pnread != NULL) {
-        *pnread = nread;
+    if ((ret = flush()) != ERROR_SUCCESS) {
+        srs_error("async flush file failed. ret=%d", ret);
     }
     
+    int r0 = file->close();
+    if (ret == ERROR_SUCCESS) {
+        ret = r0;
+    }
+    error = ERROR_SUCCESS;
+    
     return ret;
 }
 
-// following is generated by src/kernel/srs_kernel_consts.cpp
-/*
-The MIT License (MIT)
-
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
-
-Permission is hereby granted, free of charge, to any person obtaining a copy of
-this software and associated documentation files (the "Software"), to deal in
-the Software without restriction, including without limitation the rights to
-use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
-the Software, and to permit persons to whom the Software is furnished to do so,
-subject to the following conditions:
-
-The above copyright notice and this permission notice shall be included in all
-copies or substantial portions of the Software.
-
-THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
-IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
-FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
-COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
-IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
-CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
-*/
-
-//#include <srs_kernel_consts.hpp>
-
-
-// following is generated by src/kernel/srs_kernel_aac.cpp
-/*
-The MIT License (MIT)
+bool SrsAsyncFileWriter::is_open()
+{
+    return file->is_open();
+}
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+void SrsAsyncFileWriter::lseek(int64_t offset)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if ((ret = flush()) != ERROR_SUCCESS) {
+        srs_error("async flush file for seek failed. ret=%d", ret);
+    }
+    
+    file->lseek(offset);
+    position = offset;
+}
 
-Permission is hereby granted, free of charge, to any person obtaining a copy of
-this software and associated documentation files (the "Software"), to deal in
-the Software without restriction, including without limitation the rights to
-use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
-the Software, and to permit persons to whom the Software is furnished to do so,
-subject to the following conditions:
+int64_t SrsAsyncFileWriter::tellg()
+{
+    return position;
+}
 
-The above copyright notice and this permission notice shall be included in all
-copies or substantial portions of the Software.
+int SrsAsyncFileWriter::write(void* buf, size_t count, ssize_t* pnwrite)
+{
+    iovec iov;
+    iov.iov_base = (char*)buf;
+    iov.iov_len = count;
+    
+    return writev(&iov, 1, pnwrite);
+}
 
-THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+int SrsAsyncFileWriter::writev(iovec* iov, int iovcnt, ssize_t* pnwrite)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (!file->is_open()) {
+        ret = ERROR_SYSTEM_FILE_WRITE;
+        srs_error("async write to file not open. ret=%d", ret);
+        return ret;
+    }
+    
+    ssize_t nwrite = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        nwrite += (ssize_t)iov[i].iov_len;
+    }
+    
+    // the count of buffers to queue by this write.
+    int nb_submit = (int)(((current? current->size : 0) + nwrite) / chunk_size);
+    
+    pthread_mutex_lock(&_srs_file_write_pool.lock);
+    
+    // backpressure, but always allow the huge write when queue empty.
+    while (error == ERROR_SUCCESS && nb_submit > 0 && !chunks.empty()
+        && (int)chunks.size() + nb_submit > max_inflight
+    ) {
+        if (nonblocking) {
+            pthread_mutex_unlock(&_srs_file_write_pool.lock);
+            return ERROR_SYSTEM_FILE_BUSY;
+        }
+        pthread_cond_wait(&cond, &_srs_file_write_pool.lock);
+    }
+    ret = error;
+    
+    pthread_mutex_unlock(&_srs_file_write_pool.lock);
+    
+    if (ret != ERROR_SUCCESS) {
+        srs_error("async write to file failed. ret=%d", ret);
+        return ret;
+    }
+    
+    for (int i = 0; i < iovcnt; i++) {
+        char* p = (char*)iov[i].iov_base;
+        int left = (int)iov[i].iov_len;
+        
+        while (left > 0) {
+            if (!current) {
+                pthread_mutex_lock(&_srs_file_write_pool.lock);
+                if (!free_chunks.empty()) {
+                    current = free_chunks.back();
+                    free_chunks.pop_back();
+                }
+                pthread_mutex_unlock(&_srs_file_write_pool.lock);
+            }
+            if (!current) {
+                current = new SrsFileChunk();
+                current->data = new char[chunk_size];
+                current->size = 0;
+            }
+            
+            int nb_copy = srs_min(left, chunk_size - current->size);
+            memcpy(current->data + current->size, p, nb_copy);
+            current->size += nb_copy;
+            p += nb_copy;
+            left -= nb_copy;
+            
+            if (current->size == chunk_size) {
+                submit();
+            }
+        }
+    }
+    position += nwrite;
+    
+    // queue the buffer when interval elapsed.
+    if (current && chunk_interval > 0 && srs_update_system_time_ms() - last_submit >= chunk_interval) {
+        submit();
+    }
+    
+    if (pnwrite) {
+        *pnwrite = nwrite;
+    }
+    
+    return ret;
+}
+
+int SrsAsyncFileWriter::flush()
+{
+    if (current && current->size > 0) {
+        submit();
+    }
+    
+    return drain();
+}
+
+int SrsAsyncFileWriter::set_buffer(int size, int interval_ms)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if ((ret = flush()) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // the size of free buffers changed, free them.
+    pthread_mutex_lock(&_srs_file_write_pool.lock);
+    
+    if (current) {
+        free_chunks.push_back(current);
+        current = NULL;
+    }
+    
+    std::vector<SrsFileChunk*>::iterator it;
+    for (it = free_chunks.begin(); it != free_chunks.end(); ++it) {
+        SrsFileChunk* chunk = *it;
+        srs_freepa(chunk->data);
+        srs_freep(chunk);
+    }
+    free_chunks.clear();
+    
+    chunk_size = srs_max(size, SRS_FILE_DIRECT_ALIGN);
+    chunk_interval = srs_max(0, interval_ms);
+    
+    pthread_mutex_unlock(&_srs_file_write_pool.lock);
+    
+    return ret;
+}
+
+void SrsAsyncFileWriter::set_sync(SrsFileSync v)
+{
+    // the sync policy is used by write thread.
+    flush();
+    file->set_sync(v);
+}
+
+void SrsAsyncFileWriter::set_direct(bool v)
+{
+    file->set_direct(v);
+}
+
+void SrsAsyncFileWriter::set_inflight(int max, bool v)
+{
+    pthread_mutex_lock(&_srs_file_write_pool.lock);
+    max_inflight = srs_max(1, max);
+    nonblocking = v;
+    pthread_mutex_unlock(&_srs_file_write_pool.lock);
+}
+
+int SrsAsyncFileWriter::inflight()
+{
+    pthread_mutex_lock(&_srs_file_write_pool.lock);
+    int nb_chunks = (int)chunks.size();
+    pthread_mutex_unlock(&_srs_file_write_pool.lock);
+    
+    return nb_chunks;
+}
+
+int SrsAsyncFileWriter::on_opened()
+{
+    int ret = ERROR_SUCCESS;
+    
+    // the write thread writes each buffer by one syscall.
+    if ((ret = file->set_buffer(0, 0)) != ERROR_SUCCESS) {
+        file->close();
+        return ret;
+    }
+    
+    if ((ret = _srs_file_write_pool.start()) != ERROR_SUCCESS) {
+        file->close();
+        return ret;
+    }
+    
+    position = file->tellg();
+    last_submit = srs_update_system_time_ms();
+    error = ERROR_SUCCESS;
+    
+    return ret;
+}
+
+void SrsAsyncFileWriter::submit()
+{
+    pthread_mutex_lock(&_srs_file_write_pool.lock);
+    
+    chunks.push_back(current);
+    current = NULL;
+    _srs_file_write_pool.schedule(this);
+    
+    pthread_mutex_unlock(&_srs_file_write_pool.lock);
+    
+    last_submit = srs_update_system_time_ms();
+}
+
+int SrsAsyncFileWriter::drain()
+{
+    int ret = ERROR_SUCCESS;
+    
+    pthread_mutex_lock(&_srs_file_write_pool.lock);
+    
+    while (scheduled) {
+        pthread_cond_wait(&cond, &_srs_file_write_pool.lock);
+    }
+    ret = error;
+    
+    pthread_mutex_unlock(&_srs_file_write_pool.lock);
+    
+    return ret;
+}
+#endif
+
+SrsFileReader::SrsFileReader()
+{
+    fd = -1;
+    buf = NULL;
+    nb_buf = buf_pos = 0;
+    offset = 0;
+    mapped = false;
+    mmap_data = NULL;
+    mmap_size = 0;
+    advised_start = advised_end = 0;
+}
+
+SrsFileReader::~SrsFileReader()
+{
+    close();
+    srs_freepa(buf);
+}
+
+int SrsFileReader::open(string p)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (fd > 0) {
+        ret = ERROR_SYSTEM_FILE_ALREADY_OPENED;
+        srs_error("file %s already opened. ret=%d", path.c_str(), ret);
+        return ret;
+    }
+
+    if ((fd = ::open(p.c_str(), O_RDONLY)) < 0) {
+        ret = ERROR_SYSTEM_FILE_OPENE;
+        srs_error("open file %s failed. ret=%d", p.c_str(), ret);
+        return ret;
+    }
+    
+    // the file is always read sequentially, so hint the kernel to read ahead.
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    
+    path = p;
+    nb_buf = buf_pos = 0;
+    offset = 0;
+    
+    return ret;
+}
+
+int SrsFileReader::open_mmap(string p)
+{
+    int ret = ERROR_SUCCESS;
+    
+#ifndef _WIN32
+    if ((ret = open(p)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        ret = ERROR_SYSTEM_FILE_OPENE;
+        srs_error("stat file %s failed. ret=%d", p.c_str(), ret);
+        close();
+        return ret;
+    }
+    
+    // the huge file must fit in the address space.
+    int64_t size = (int64_t)st.st_size;
+    if ((u_int64_t)size > (u_int64_t)((size_t)-1)) {
+        ret = ERROR_SYSTEM_FILE_OPENE;
+        srs_error("mmap file %s too large, size=%"PRId64". ret=%d", p.c_str(), size, ret);
+        close();
+        return ret;
+    }
+    
+    // empty file is never mapped, always EOF.
+    if (size > 0) {
+        void* data = ::mmap(NULL, (size_t)size, PROT_READ, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED) {
+            ret = ERROR_SYSTEM_FILE_OPENE;
+            srs_error("mmap file %s failed, size=%"PRId64". ret=%d", p.c_str(), size, ret);
+            close();
+            return ret;
+        }
+        
+        // the file is generally read sequentially.
+        madvise(data, (size_t)size, MADV_SEQUENTIAL);
+        
+        mmap_data = (char*)data;
+    }
+    
+    mapped = true;
+    mmap_size = size;
+#else
+    ret = ERROR_SYSTEM_FILE_OPENE;
+    srs_error("mmap file %s not supported. ret=%d", p.c_str(), ret);
+#endif
+    
+    return ret;
+}
+
+void SrsFileReader::close()
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (fd < 0) {
+        return;
+    }
+    
+#ifndef _WIN32
+    if (mmap_data) {
+        ::munmap(mmap_data, (size_t)mmap_size);
+    }
+#endif
+    mapped = false;
+    mmap_data = NULL;
+    mmap_size = 0;
+    advised_start = advised_end = 0;
+    
+    if (::close(fd) < 0) {
+        ret = ERROR_SYSTEM_FILE_CLOSE;
+        srs_error("close file %s failed. ret=%d", path.c_str(), ret);
+        return;
+    }
+    fd = -1;
+    nb_buf = buf_pos = 0;
+    offset = 0;
+    
+    return;
+}
+
+bool SrsFileReader::is_open()
+{
+    return fd > 0;
+}
+
+int64_t SrsFileReader::tellg()
+{
+    return offset - (nb_buf - buf_pos);
+}
+
+void SrsFileReader::skip(int64_t size)
+{
+    lseek(tellg() + size);
+}
+
+int64_t SrsFileReader::lseek(int64_t offset)
+{
+    // the mmap file only update the read position.
+    if (mapped) {
+        if (offset < 0) {
+            return -1;
+        }
+        this->offset = offset;
+        will_read(SRS_PERF_FILE_READ_BUFFER);
+        return offset;
+    }
+    
+    // seek in buffer, for the decoder always skip the small tags.
+    int64_t buf_start = this->offset - nb_buf;
+    if (offset >= buf_start && offset <= this->offset) {
+        buf_pos = (int)(offset - buf_start);
+        return offset;
+    }
+    
+    int64_t pos = (int64_t)::lseek(fd, (off_t)offset, SEEK_SET);
+    if (pos >= 0) {
+        this->offset = pos;
+        nb_buf = buf_pos = 0;
+    }
+    
+    return pos;
+}
+
+int64_t SrsFileReader::filesize()
+{
+    if (mapped) {
+        return mmap_size;
+    }
+    
+    int64_t size = (int64_t)::lseek(fd, 0, SEEK_END);
+    ::lseek(fd, (off_t)offset, SEEK_SET);
+    return size;
+}
+
+int64_t SrsFileReader::mtime()
+{
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        return 0;
+    }
+    
+#if defined(__APPLE__)
+    return (int64_t)st.st_mtimespec.tv_sec * 1000 + st.st_mtimespec.tv_nsec / 1000000;
+#elif defined(_WIN32)
+    return (int64_t)st.st_mtime * 1000;
+#else
+    return (int64_t)st.st_mtim.tv_sec * 1000 + st.st_mtim.tv_nsec / 1000000;
+#endif
+}
+
+int SrsFileReader::read(void* buf, size_t count, ssize_t* pnread)
+{
+    int ret = ERROR_SUCCESS;
+    
+    char* p = (char*)buf;
+    size_t nread = 0;
+    
+    // copy from the mmap file.
+    if (mapped && offset < mmap_size) {
+        nread = (size_t)srs_min((int64_t)count, mmap_size - offset);
+        memcpy(p, mmap_data + offset, nread);
+        offset += nread;
+    }
+    
+    while (!mapped && nread < count) {
+        // consume the bytes in buffer first.
+        if (buf_pos < nb_buf) {
+            int nb_copy = (int)srs_min((size_t)(nb_buf - buf_pos), count - nread);
+            memcpy(p + nread, this->buf + buf_pos, nb_copy);
+            buf_pos += nb_copy;
+            nread += nb_copy;
+            continue;
+        }
+        
+        // directly read to user buffer when large.
+        char* target = this->buf;
+        size_t size = SRS_PERF_FILE_READ_BUFFER;
+        if (count - nread >= (size_t)SRS_PERF_FILE_READ_BUFFER) {
+            target = p + nread;
+            size = count - nread;
+        } else if (!this->buf) {
+            target = this->buf = new char[SRS_PERF_FILE_READ_BUFFER];
+        }
+        
+        ssize_t nb_read;
+        // TODO: FIXME: use st_read.
+        if ((nb_read = ::read(fd, target, size)) < 0) {
+            ret = ERROR_SYSTEM_FILE_READ;
+            srs_error("read from file %s failed. ret=%d", path.c_str(), ret);
+            return ret;
+        }
+        
+        // EOF, return the bytes read.
+        if (nb_read == 0) {
+            break;
+        }
+        offset += nb_read;
+        
+        if (target == p + nread) {
+            nread += nb_read;
+        } else {
+            nb_buf = (int)nb_read;
+            buf_pos = 0;
+        }
+    }
+    
+    if (nread == 0 && count > 0) {
+        ret = ERROR_SYSTEM_FILE_EOF;
+        return ret;
+    }
+    
+    if (pnread != NULL) {
+        *pnread = nread;
+    }
+    
+    return ret;
+}
+
+int SrsFileReader::read_view(size_t count, char** pdata)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (!mapped) {
+        ret = ERROR_SYSTEM_IO_INVALID;
+        srs_error("read view of file %s not mmap. ret=%d", path.c_str(), ret);
+        return ret;
+    }
+    
+    // the count maybe a negative size casted by caller, never move back.
+    if (offset < 0 || offset > mmap_size || (u_int64_t)count > (u_int64_t)(mmap_size - offset)) {
+        ret = ERROR_SYSTEM_FILE_EOF;
+        return ret;
+    }
+    
+    *pdata = mmap_data + offset;
+    offset += count;
+    
+    return ret;
+}
+
+void SrsFileReader::will_read(size_t count)
+{
+#ifndef _WIN32
+    if (!mmap_data || offset < 0 || offset >= mmap_size) {
+        return;
+    }
+    
+    // ignore when the position is in the window already advised,
+    // so the sequential seek only advise once for each window.
+    if (offset >= advised_start && offset < advised_end) {
+        return;
+    }
+    
+    // the madvise requires the address aligned to page.
+    static int64_t page_size = (int64_t)sysconf(_SC_PAGESIZE);
+    int64_t start = offset - offset % page_size;
+    int64_t end = srs_min(mmap_size, offset + (int64_t)count);
+    
+    madvise(mmap_data + start, (size_t)(end - start), MADV_WILLNEED);
+    advised_start = start;
+    advised_end = end;
+#endif
+}
+
+bool SrsFileReader::is_mmap()
+{
+    return mapped;
+}
+
+int SrsFileReader::get_fd()
+{
+    return fd;
+}
+
+// following is generated by src/kernel/srs_kernel_consts.cpp
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2015 SRS(ossrs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//#include <srs_kernel_consts.hpp>
+
+
+// following is generated by src/kernel/srs_kernel_aac.cpp
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2015 SRS(ossrs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
 IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
 FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
 COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
@@ -15829,7 +20824,9 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 //#include <srs_kernel_aac.hpp>
 
-// for srs-librtmp, @see https://github.com/simple-rtmp-server/srs/issues/213
+#if !defined(SRS_EXPORT_LIBRTMP)
+
+// for srs-librtmp, @see https://github.com/ossrs/srs/issues/213
 #ifndef _WIN32
 #include <unistd.h>
 #endif
@@ -15956,7 +20953,7 @@ int SrsAacEncoder::write_audio(int64_t timestamp, char* data, int size)
     // write the ADTS header.
     // @see aac-mp4a-format-ISO_IEC_14496-3+2001.pdf, page 75,
     //      1.A.2.2 Audio_Data_Transport_Stream frame, ADTS
-    // @see https://github.com/simple-rtmp-server/srs/issues/212#issuecomment-64145885
+    // @see https://github.com/ossrs/srs/issues/212#issuecomment-64145885
     // byte_alignment()
     
     // adts_fixed_header:
@@ -16024,11 +21021,13 @@ int SrsAacEncoder::write_audio(int64_t timestamp, char* data, int size)
     return ret;
 }
 
+#endif
+
 // following is generated by src/kernel/srs_kernel_mp3.cpp
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -16050,7 +21049,9 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 //#include <srs_kernel_mp3.hpp>
 
-// for srs-librtmp, @see https://github.com/simple-rtmp-server/srs/issues/213
+#if !defined(SRS_EXPORT_LIBRTMP)
+
+// for srs-librtmp, @see https://github.com/ossrs/srs/issues/213
 #ifndef _WIN32
 #include <unistd.h>
 #endif
@@ -16152,11 +21153,13 @@ int SrsMp3Encoder::write_audio(int64_t timestamp, char* data, int size)
     return writer->write(data + stream->pos(), size - stream->pos(), NULL);
 }
 
+#endif
+
 // following is generated by src/kernel/srs_kernel_ts.cpp
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -16178,7 +21181,9 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 //#include <srs_kernel_ts.hpp>
 
-// for srs-librtmp, @see https://github.com/simple-rtmp-server/srs/issues/213
+#if !defined(SRS_EXPORT_LIBRTMP)
+
+// for srs-librtmp, @see https://github.com/ossrs/srs/issues/213
 #ifndef _WIN32
 #include <unistd.h>
 #endif
@@ -16211,6 +21216,14 @@ using namespace std;
 #define TS_AUDIO_AAC_PID 0x101
 #define TS_AUDIO_MP3_PID 0x102
 
+// the max step of messages in tbn 90000, to schedule the PSI and PCR.
+#define SRS_TS_MAX_STEP 18000
+
+// the PAT and PMT must in one ts packet,
+// the PAT is 17+4*N bytes, the PMT is 21+5*N bytes.
+#define SRS_TS_MAX_PROGRAMS 42
+#define SRS_TS_MAX_STREAMS 33
+
 string srs_ts_stream2string(SrsTsStream stream)
 {
     switch (stream) {
@@ -16220,6 +21233,7 @@ string srs_ts_stream2string(SrsTsStream stream)
         case SrsTsStreamAudioAC3: return "AC3";
         case SrsTsStreamAudioDTS: return "AudioDTS";
         case SrsTsStreamVideoH264: return "H.264";
+        case SrsTsStreamVideoHEVC: return "H.265";
         case SrsTsStreamVideoMpeg4: return "MP4";
         case SrsTsStreamAudioMpeg4: return "MP4A";
         default: return "Other";
@@ -16305,6 +21319,23 @@ bool SrsTsMessage::fresh()
     return payload->length() == 0;
 }
 
+void SrsTsMessage::reset()
+{
+    dts = pts = 0;
+    sid = (SrsTsPESStreamId)0x00;
+    continuity_counter = 0;
+    PES_packet_length = 0;
+    is_discontinuity = false;
+    start_pts = 0;
+    write_pcr = false;
+    
+    // the payload maybe detached by user.
+    if (!payload) {
+        payload = new SrsSimpleBuffer();
+    }
+    payload->erase(payload->length());
+}
+
 bool SrsTsMessage::is_audio()
 {
     return ((sid >> 5) & 0x07) == SrsTsPESStreamIdAudioChecker;
@@ -16337,6 +21368,7 @@ SrsTsMessage* SrsTsMessage::detach()
     cp->sid = sid;
     cp->PES_packet_length = PES_packet_length;
     cp->continuity_counter = continuity_counter;
+    srs_freep(cp->payload);
     cp->payload = payload;
     payload = NULL;
     return cp;
@@ -16350,21 +21382,246 @@ ISrsTsHandler::~ISrsTsHandler()
 {
 }
 
+/**
+* write the ts header and adaptation field to buf.
+* @param nb_af_reserved the stuffing bytes of adaptation field, -1 for no adaptation field.
+* @param pcr the pcr to write in adaptation field, -1 to ignore.
+* @return the bytes written.
+*/
+int srs_ts_encode_header(char* buf, int16_t pid, bool unit_start, u_int8_t continuity_counter,
+    int nb_af_reserved, bool discontinuity, int64_t pcr
+) {
+    char* p = buf;
+    
+    // 4B ts packet header.
+    *p++ = 0x47;
+    *p++ = (char)(((pid >> 8) & 0x1F) | (unit_start? 0x40 : 0x00));
+    *p++ = (char)(pid & 0xFF);
+    
+    SrsTsAdaptationFieldType afc = (nb_af_reserved >= 0)? SrsTsAdaptationFieldTypeBoth : SrsTsAdaptationFieldTypePayloadOnly;
+    *p++ = (char)(((afc << 4) & 0x30) | (continuity_counter & 0x0F));
+    
+    if (nb_af_reserved < 0) {
+        return (int)(p - buf);
+    }
+    
+    // adaptation field, 1B length, 1B flags, 6B pcr and stuffings.
+    *p++ = (char)(1 + (pcr >= 0? 6 : 0) + nb_af_reserved);
+    *p++ = (char)((discontinuity? 0x80 : 0x00) | (pcr >= 0? 0x10 : 0x00));
+    
+    if (pcr >= 0) {
+        // @remark, use pcr base and ignore the extension
+        // @see https://github.com/ossrs/srs/issues/250#issuecomment-71349370
+        int64_t pcrv = 0;
+        pcrv |= (0x3F << 9) & 0x7E00;
+        pcrv |= (pcr << 15) & 0xFFFFFFFF8000LL;
+        
+        *p++ = (char)(pcrv >> 40);
+        *p++ = (char)(pcrv >> 32);
+        *p++ = (char)(pcrv >> 24);
+        *p++ = (char)(pcrv >> 16);
+        *p++ = (char)(pcrv >> 8);
+        *p++ = (char)pcrv;
+    }
+    
+    memset(p, 0xFF, nb_af_reserved);
+    p += nb_af_reserved;
+    
+    return (int)(p - buf);
+}
+
+/**
+* write the 33bits dts or pts of PES header.
+*/
+char* srs_ts_encode_33bits_dts_pts(char* p, u_int8_t fb, int64_t v)
+{
+    int32_t val = 0;
+    
+    val = fb << 4 | (((v >> 30) & 0x07) << 1) | 1;
+    *p++ = val;
+    
+    val = (((v >> 15) & 0x7fff) << 1) | 1;
+    *p++ = (val >> 8);
+    *p++ = val;
+    
+    val = (((v) & 0x7fff) << 1) | 1;
+    *p++ = (val >> 8);
+    *p++ = val;
+    
+    return p;
+}
+
+/**
+* write the header of the first ts packet of PES, the ts header, adaptation field
+* and PES header, padding with stuffings when the left payload can't fill the packet.
+* @param size the size of PES payload.
+* @param left the size of payload to write in ts packets.
+* @return the bytes written, the payload fill the left bytes of packet.
+* @remark the same bytes as SrsTsPacket::create_pes_first.
+*/
+int srs_ts_encode_pes_first(char* buf, int16_t pid, SrsTsPESStreamId sid, u_int8_t continuity_counter,
+    bool discontinuity, int64_t pcr, int64_t dts, int64_t pts, int size, int left
+) {
+    // the PES header, 6B fixed, 3B flags and the dts/pts.
+    int PES_header_data_length = (dts == pts)? 5 : 10;
+    int nb_pes = 9 + PES_header_data_length;
+    
+    // the adaptation field of pcr, padding with stuffings.
+    int nb_af_reserved = (pcr >= 0)? 0 : -1;
+    int nb_header = 4 + (pcr >= 0? 8 : 0) + nb_pes;
+    int nb_stuffings = SRS_TS_PACKET_SIZE - nb_header - left;
+    if (nb_stuffings > 0) {
+        // consume the af size if possible.
+        nb_af_reserved = (pcr >= 0)? nb_stuffings : srs_max(0, nb_stuffings - 2);
+    }
+    
+    // the discontinuity is only set in the adaptation field of pcr.
+    char* p = buf + srs_ts_encode_header(buf, pid, true, continuity_counter, nb_af_reserved, discontinuity && pcr >= 0, pcr);
+    
+    // 3B packet_start_code_prefix and 1B stream_id.
+    *p++ = 0x00;
+    *p++ = 0x00;
+    *p++ = 0x01;
+    *p++ = (char)sid;
+    
+    // 2B, the actual bytes plus the header size.
+    int32_t pplv = 0;
+    if (size > 0 && size <= 0xFFFF) {
+        pplv = size + 3 + PES_header_data_length;
+        pplv = (pplv > 0xFFFF)? 0 : pplv;
+    }
+    *p++ = (char)(pplv >> 8);
+    *p++ = (char)pplv;
+    
+    // 3B flags, the const2bits is 0x02 and the PTS_DTS_flags.
+    int8_t PTS_DTS_flags = (dts == pts)? 0x02 : 0x03;
+    *p++ = (char)0x80;
+    *p++ = (char)((PTS_DTS_flags << 6) & 0xC0);
+    *p++ = (char)PES_header_data_length;
+    
+    if (PTS_DTS_flags == 0x02) {
+        p = srs_ts_encode_33bits_dts_pts(p, 0x02, pts);
+    } else {
+        p = srs_ts_encode_33bits_dts_pts(p, 0x03, pts);
+        p = srs_ts_encode_33bits_dts_pts(p, 0x01, dts);
+        
+        // check sync, the diff of dts and pts should never greater than 1s.
+        if (dts - pts > 90000 || pts - dts > 90000) {
+            srs_warn("ts: sync dts=%"PRId64", pts=%"PRId64, dts, pts);
+        }
+    }
+    
+    return (int)(p - buf);
+}
+
+/**
+* write the header of the continue ts packet of PES,
+* padding with stuffings when the left payload can't fill the packet.
+* @param pcr the pcr to write in adaptation field, -1 to ignore.
+* @remark the same bytes as SrsTsPacket::create_pes_continue when no pcr.
+*/
+int srs_ts_encode_pes_continue(char* buf, int16_t pid, u_int8_t continuity_counter, int left, int64_t pcr)
+{
+    int nb_af_reserved = (pcr >= 0)? 0 : -1;
+    int nb_stuffings = SRS_TS_PACKET_SIZE - 4 - (pcr >= 0? 8 : 0) - left;
+    if (nb_stuffings > 0) {
+        // consume the af size if possible.
+        nb_af_reserved = (pcr >= 0)? nb_stuffings : srs_max(0, nb_stuffings - 2);
+    }
+    
+    return srs_ts_encode_header(buf, pid, false, continuity_counter, nb_af_reserved, false, pcr);
+}
+
+/**
+* write the adaptation only packet with the pcr, of SRS_TS_PACKET_SIZE bytes.
+* @remark the continuity counter not incremented for the adaptation only packet.
+*/
+void srs_ts_encode_pcr(char* buf, int16_t pid, u_int8_t continuity_counter, int64_t pcr)
+{
+    int nb_af_reserved = SRS_TS_PACKET_SIZE - 4 - 2 - 6;
+    srs_ts_encode_header(buf, pid, false, continuity_counter, nb_af_reserved, false, pcr);
+    buf[3] = (char)((buf[3] & 0xCF) | (SrsTsAdaptationFieldTypeAdaptionOnly << 4));
+}
+
+SrsTsProgram::SrsTsProgram(int16_t n, int16_t pid)
+{
+    number = n;
+    pmt_pid = pid;
+    version = 0;
+    written = false;
+    last_psi_dts = -1;
+    last_pcr_dts = -1;
+    last_pcr = -1;
+    last_pcr_packets = -1;
+    last_dts = -1;
+    max_step = 0;
+}
+
+SrsTsProgram::~SrsTsProgram()
+{
+}
+
+int SrsTsProgram::find(int16_t pid)
+{
+    for (int i = 0; i < (int)pids.size(); i++) {
+        if (pids[i] == pid) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int16_t SrsTsProgram::pcr_pid()
+{
+    for (int i = 0; i < (int)streams.size(); i++) {
+        if (streams[i] == SrsTsStreamVideoH264 || streams[i] == SrsTsStreamVideoHEVC) {
+            return pids[i];
+        }
+    }
+    for (int i = 0; i < (int)streams.size(); i++) {
+        if (streams[i] == SrsTsStreamAudioAAC || streams[i] == SrsTsStreamAudioMp3) {
+            return pids[i];
+        }
+    }
+    return SrsTsPidNULL;
+}
+
 SrsTsContext::SrsTsContext()
 {
     pure_audio = false;
     vcodec = SrsCodecVideoReserved;
     acodec = SrsCodecAudioReserved1;
+    ts_headers = NULL;
+    ts_iovs = NULL;
+    pat_version = 0;
+    pat_written = false;
+    psi_changed = false;
+    psi_interval = 0;
+    pcr_interval = 0;
+    bitrate = 0;
+    nb_ts_packets = 0;
+    
+    pids = new SrsTsChannel*[SRS_TS_PIDS];
+    memset(pids, 0, sizeof(SrsTsChannel*) * SRS_TS_PIDS);
 }
 
 SrsTsContext::~SrsTsContext()
 {
-    std::map<int, SrsTsChannel*>::iterator it;
-    for (it = pids.begin(); it != pids.end(); ++it) {
-        SrsTsChannel* channel = it->second;
+    srs_freepa(ts_headers);
+    srs_freepa(ts_iovs);
+    
+    std::vector<SrsTsProgram*>::iterator it;
+    for (it = programs.begin(); it != programs.end(); ++it) {
+        SrsTsProgram* program = *it;
+        srs_freep(program);
+    }
+    programs.clear();
+    
+    for (int i = 0; i < SRS_TS_PIDS; i++) {
+        SrsTsChannel* channel = pids[i];
         srs_freep(channel);
     }
-    pids.clear();
+    srs_freepa(pids);
 }
 
 bool SrsTsContext::is_pure_audio()
@@ -16376,10 +21633,9 @@ void SrsTsContext::on_pmt_parsed()
 {
     pure_audio = true;
     
-    std::map<int, SrsTsChannel*>::iterator it;
-    for (it = pids.begin(); it != pids.end(); ++it) {
-        SrsTsChannel* channel = it->second;
-        if (channel->apply == SrsTsPidApplyVideo) {
+    for (int i = 0; i < SRS_TS_PIDS; i++) {
+        SrsTsChannel* channel = pids[i];
+        if (channel && channel->apply == SrsTsPidApplyVideo) {
             pure_audio = false;
         }
     }
@@ -16389,11 +21645,12 @@ void SrsTsContext::reset()
 {
     vcodec = SrsCodecVideoReserved;
     acodec = SrsCodecAudioReserved1;
+    psi_changed = true;
 }
 
 SrsTsChannel* SrsTsContext::get(int pid)
 {
-    if (pids.find(pid) == pids.end()) {
+    if (pid < 0 || pid >= SRS_TS_PIDS) {
         return NULL;
     }
     return pids[pid];
@@ -16401,14 +21658,13 @@ SrsTsChannel* SrsTsContext::get(int pid)
 
 void SrsTsContext::set(int pid, SrsTsPidApply apply_pid, SrsTsStream stream)
 {
-    SrsTsChannel* channel = NULL;
-
-    if (pids.find(pid) == pids.end()) {
+    srs_assert(pid >= 0 && pid < SRS_TS_PIDS);
+    
+    SrsTsChannel* channel = pids[pid];
+    if (!channel) {
         channel = new SrsTsChannel();
         channel->context = this;
         pids[pid] = channel;
-    } else {
-        channel = pids[pid];
     }
 
     channel->pid = pid;
@@ -16420,60 +21676,387 @@ int SrsTsContext::decode(SrsStream* stream, ISrsTsHandler* handler)
 {
     int ret = ERROR_SUCCESS;
 
-    // parse util EOF of stream.
-    // for example, parse multiple times for the PES_packet_length(0) packet.
+    // parse util EOF of stream, each ts packet in place.
     while (!stream->empty()) {
-        SrsTsPacket* packet = new SrsTsPacket(this);
-        SrsAutoFree(SrsTsPacket, packet);
-
-        SrsTsMessage* msg = NULL;
-        if ((ret = packet->decode(stream, &msg)) != ERROR_SUCCESS) {
-            srs_error("mpegts: decode ts packet failed. ret=%d", ret);
-            return ret;
-        }
-
-        if (!msg) {
+        char* data = stream->data() + stream->pos();
+        int left = stream->size() - stream->pos();
+        
+        // resync to the next sync byte when lost, for example, the corrupt udp packet,
+        // the sync byte of next packet should also be 0x47 when there is one.
+        if ((u_int8_t)data[0] != 0x47) {
+            int nb_skip = 1;
+            while (nb_skip < left) {
+                if ((u_int8_t)data[nb_skip] == 0x47
+                    && (nb_skip + SRS_TS_PACKET_SIZE >= left || (u_int8_t)data[nb_skip + SRS_TS_PACKET_SIZE] == 0x47)
+                ) {
+                    break;
+                }
+                nb_skip++;
+            }
+            srs_warn("ts: sync byte must be 0x47, actual=%#x, skip %dB to resync", (u_int8_t)data[0], nb_skip);
+            stream->skip(nb_skip);
             continue;
         }
-        SrsAutoFree(SrsTsMessage, msg);
-
-        if ((ret = handler->on_ts_message(msg)) != ERROR_SUCCESS) {
-            srs_error("mpegts: handler ts message failed. ret=%d", ret);
+        
+        if (left < SRS_TS_PACKET_SIZE) {
+            srs_warn("ts: drop the partial packet %dB", left);
+            stream->skip(left);
+            break;
+        }
+        stream->skip(SRS_TS_PACKET_SIZE);
+        
+        if ((ret = decode_packet(data, handler)) != ERROR_SUCCESS) {
+            srs_error("mpegts: decode ts packet failed. ret=%d", ret);
             return ret;
         }
     }
-
+    
     return ret;
 }
 
-int SrsTsContext::encode(SrsFileWriter* writer, SrsTsMessage* msg, SrsCodecVideo vc, SrsCodecAudio ac)
+int SrsTsContext::decode_packet(char* data, ISrsTsHandler* handler)
 {
     int ret = ERROR_SUCCESS;
-
-    SrsTsStream vs, as;
-    int16_t video_pid = 0, audio_pid = 0;
-    switch (vc) {
-        case SrsCodecVideoAVC: 
-            vs = SrsTsStreamVideoH264; 
-            video_pid = TS_VIDEO_AVC_PID;
-            break;
-        case SrsCodecVideoDisabled:
-            vs = SrsTsStreamReserved;
-            break;
-        case SrsCodecVideoReserved:
-        case SrsCodecVideoReserved1:
-        case SrsCodecVideoReserved2:
-        case SrsCodecVideoSorensonH263:
-        case SrsCodecVideoScreenVideo:
-        case SrsCodecVideoOn2VP6:
-        case SrsCodecVideoOn2VP6WithAlphaChannel:
-        case SrsCodecVideoScreenVideoVersion2:
-            vs = SrsTsStreamReserved;
-            break;
-    }
-    switch (ac) {
-        case SrsCodecAudioAAC:
-            as = SrsTsStreamAudioAAC; 
+    
+    u_int8_t* p = (u_int8_t*)data;
+    
+    // 4B ts packet header, the sync byte is checked by decode.
+    int8_t payload_unit_start_indicator = (p[1] >> 6) & 0x01;
+    int pid = ((p[1] << 8) | p[2]) & 0x1FFF;
+    SrsTsAdaptationFieldType adaption_field_control = (SrsTsAdaptationFieldType)((p[3] >> 4) & 0x03);
+    u_int8_t continuity_counter = p[3] & 0x0F;
+    
+    // the PAT/PMT is rare, decode by the packet.
+    SrsTsChannel* channel = pids[pid];
+    if (pid == SrsTsPidPAT || (channel && channel->apply == SrsTsPidApplyPMT)) {
+        SrsStream stream;
+        if ((ret = stream.initialize(data, SRS_TS_PACKET_SIZE)) != ERROR_SUCCESS) {
+            return ret;
+        }
+        
+        // ignore the corrupt PAT/PMT, the next one will be decoded.
+        SrsTsPacket packet(this);
+        SrsTsMessage* msg = NULL;
+        if ((ret = packet.decode(&stream, &msg)) != ERROR_SUCCESS) {
+            srs_warn("ts: ignore the corrupt psi packet, pid=%#x. ret=%d", pid, ret);
+            return ERROR_SUCCESS;
+        }
+        return ret;
+    }
+    
+    // left bytes as reserved.
+    if (!channel || (channel->apply != SrsTsPidApplyVideo && channel->apply != SrsTsPidApplyAudio)) {
+        return ret;
+    }
+    
+    // skip the adaptation field.
+    int pos = 4;
+    if (adaption_field_control == SrsTsAdaptationFieldTypeAdaptionOnly || adaption_field_control == SrsTsAdaptationFieldTypeBoth) {
+        int adaption_field_length = p[4];
+        
+        // When the adaptation_field_control value is '11', the value of the adaptation_field_length shall
+        // be in the range 0 to 182.
+        // When the adaptation_field_control value is '10', the value of the adaptation_field_length shall
+        // be 183.
+        if ((adaption_field_control == SrsTsAdaptationFieldTypeBoth && adaption_field_length > 182)
+            || (adaption_field_control == SrsTsAdaptationFieldTypeAdaptionOnly && adaption_field_length != 183)
+        ) {
+            // drop the partial PES, skip util the next unit start.
+            srs_warn("ts: drop PES for invalid af length=%d, afc=%d, pid=%#x", adaption_field_length, adaption_field_control, pid);
+            if (channel->msg) {
+                channel->msg->reset();
+            }
+            return ret;
+        }
+        
+        pos += 1 + adaption_field_length;
+    }
+    
+    if (adaption_field_control != SrsTsAdaptationFieldTypePayloadOnly && adaption_field_control != SrsTsAdaptationFieldTypeBoth) {
+        return ret;
+    }
+    
+    return decode_pes(channel, payload_unit_start_indicator, continuity_counter,
+        data + pos, SRS_TS_PACKET_SIZE - pos, handler);
+}
+
+/**
+* decode the 33bits dts or pts of PES header.
+*/
+int srs_ts_decode_33bits_dts_pts(u_int8_t* p, int64_t* pv)
+{
+    int ret = ERROR_SUCCESS;
+    
+    // 4bits const, 3bits [32..30], 1bit marker, 15bits [29..15], 1bit marker, 15bits [14..0], 1bit marker.
+    // @remark, we donot check the high 4bits, maybe '0001', '0010' or '0011'.
+    //      so we just ensure the high 4bits is not 0x00.
+    if ((p[0] & 0x01) != 0x01 || ((p[0] >> 4) & 0x0f) == 0x00 || (p[2] & 0x01) != 0x01 || (p[4] & 0x01) != 0x01) {
+        ret = ERROR_STREAM_CASTER_TS_PSE;
+        srs_warn("ts: demux PSE dts/pts failed. ret=%d", ret);
+        return ret;
+    }
+    
+    int64_t v = 0x00;
+    v |= ((int64_t)((p[0] >> 1) & 0x07) << 30) & 0x1c0000000LL;
+    v |= ((int64_t)(((p[1] << 8) | p[2]) >> 1) << 15) & 0x3fff8000LL;
+    v |= (((p[3] << 8) | p[4]) >> 1) & 0x7fff;
+    *pv = v;
+    
+    return ret;
+}
+
+int SrsTsContext::decode_pes(SrsTsChannel* channel, int8_t payload_unit_start_indicator,
+    u_int8_t continuity_counter, char* data, int size, ISrsTsHandler* handler
+) {
+    int ret = ERROR_SUCCESS;
+    
+    // reparse the packet when the message reaped or dropped.
+    while (true) {
+        // init msg, which is reused for all PES of channel.
+        SrsTsMessage* msg = channel->msg;
+        if (!msg) {
+            msg = new SrsTsMessage(channel, NULL);
+            channel->msg = msg;
+        }
+        
+        // we must cache the fresh state of msg,
+        // for the PES_packet_length is 0, the first payload_unit_start_indicator always 1,
+        // so should check for the fresh and not completed it.
+        bool is_fresh_msg = msg->fresh();
+        
+        // check when fresh, the payload_unit_start_indicator
+        // should be 1 for the fresh msg, skip util the next unit start,
+        // for example, the partial PES is dropped or join in the middle.
+        if (is_fresh_msg && !payload_unit_start_indicator) {
+            srs_info("ts: skip PES %dB util unit start, pid=%#x, cc=%d", size, channel->pid, continuity_counter);
+            return ret;
+        }
+        
+        // check when not fresh and PES_packet_length>0,
+        // the payload_unit_start_indicator should never be 1 when not completed.
+        if (!is_fresh_msg && msg->PES_packet_length > 0
+            && !msg->completed(payload_unit_start_indicator)
+            && payload_unit_start_indicator
+        ) {
+            srs_error("ts: PES packet length=%d, payload=%d, us=%d, cc=%d, drop it.",
+                msg->PES_packet_length, msg->payload->length(), payload_unit_start_indicator, continuity_counter);
+            msg->reset();
+            continue;
+        }
+        
+        // check the continuity counter
+        if (!is_fresh_msg) {
+            // late-incoming or duplicated continuity, drop message.
+            // @remark check overflow, the counter plus 1 should greater when invalid.
+            if (msg->continuity_counter >= continuity_counter
+                && ((msg->continuity_counter + 1) & 0x0f) > continuity_counter
+            ) {
+                srs_warn("ts: drop PES %dB for duplicated cc=%#x", size, msg->continuity_counter);
+                return ret;
+            }
+            
+            // when got partially message, the continous count must be continuous, or drop it.
+            if (((msg->continuity_counter + 1) & 0x0f) != continuity_counter) {
+                srs_error("ts: continuity must be continous, msg=%#x, packet=%#x, drop it.",
+                    msg->continuity_counter, continuity_counter);
+                msg->reset();
+                continue;
+            }
+        }
+        msg->continuity_counter = continuity_counter;
+        
+        // for the PES_packet_length(0), reap when completed.
+        if (!is_fresh_msg && msg->completed(payload_unit_start_indicator)) {
+            if ((ret = reap(msg, handler)) != ERROR_SUCCESS) {
+                return ret;
+            }
+            continue;
+        }
+        
+        u_int8_t* p = (u_int8_t*)data;
+        int pos = 0;
+        bool dump = true;
+        
+        // when unit start, parse the fresh msg.
+        if (payload_unit_start_indicator) {
+            // 6B fixed header, 3B packet_start_code_prefix, 1B stream_id, 2B PES_packet_length.
+            if (size < 6 || p[0] != 0x00 || p[1] != 0x00 || p[2] != 0x01) {
+                srs_warn("ts: drop PES for invalid start code, pid=%#x", channel->pid);
+                msg->reset();
+                return ret;
+            }
+            
+            // @remark the sid indicates the elementary stream format.
+            //      the SrsTsPESStreamIdAudio and SrsTsPESStreamIdVideo is start by 0b110 or 0b1110
+            SrsTsPESStreamId sid = (SrsTsPESStreamId)p[3];
+            int PES_packet_length = (p[4] << 8) | p[5];
+            msg->sid = sid;
+            pos = 6;
+            
+            if (sid != SrsTsPESStreamIdProgramStreamMap
+                && sid != SrsTsPESStreamIdPaddingStream
+                && sid != SrsTsPESStreamIdPrivateStream2
+                && sid != SrsTsPESStreamIdEcmStream
+                && sid != SrsTsPESStreamIdEmmStream
+                && sid != SrsTsPESStreamIdProgramStreamDirectory
+                && sid != SrsTsPESStreamIdDsmccStream
+                && sid != SrsTsPESStreamIdH2221TypeE
+            ) {
+                // 3B flags, the PTS_DTS_flags and PES_header_data_length.
+                if (size < pos + 3) {
+                    srs_warn("ts: drop PES for invalid flags, pid=%#x", channel->pid);
+                    msg->reset();
+                    return ret;
+                }
+                int8_t PTS_DTS_flags = (p[pos + 1] >> 6) & 0x03;
+                int PES_header_data_length = p[pos + 2];
+                pos += 3;
+                
+                int nb_required = (PTS_DTS_flags == 0x2)? 5 : ((PTS_DTS_flags == 0x3)? 10 : 0);
+                if (size < pos + PES_header_data_length || PES_header_data_length < nb_required) {
+                    srs_warn("ts: drop PES for invalid header length=%d, pid=%#x", PES_header_data_length, channel->pid);
+                    msg->reset();
+                    return ret;
+                }
+                
+                // 5B
+                if (PTS_DTS_flags == 0x2) {
+                    if (srs_ts_decode_33bits_dts_pts(p + pos, &msg->pts) != ERROR_SUCCESS) {
+                        msg->reset();
+                        return ret;
+                    }
+                    msg->dts = msg->pts;
+                }
+                
+                // 10B
+                if (PTS_DTS_flags == 0x3) {
+                    if (srs_ts_decode_33bits_dts_pts(p + pos, &msg->pts) != ERROR_SUCCESS
+                        || srs_ts_decode_33bits_dts_pts(p + pos + 5, &msg->dts) != ERROR_SUCCESS
+                    ) {
+                        msg->reset();
+                        return ret;
+                    }
+                    
+                    // check sync, the diff of dts and pts should never greater than 1s.
+                    if (msg->dts - msg->pts > 90000 || msg->pts - msg->dts > 90000) {
+                        srs_warn("ts: sync dts=%"PRId64", pts=%"PRId64, msg->dts, msg->pts);
+                    }
+                }
+                
+                // skip the optional fields and stuffings.
+                pos += PES_header_data_length;
+                
+                // the packet size contains the header size,
+                // use 0 packet length when exceed 0xffff, the next unit start indicates the end.
+                if (PES_packet_length > 0) {
+                    msg->PES_packet_length = srs_max(0, PES_packet_length - 3 - PES_header_data_length);
+                }
+            } else if (sid == SrsTsPESStreamIdPaddingStream) {
+                dump = false;
+            } else if (sid != SrsTsPESStreamIdProgramStreamMap
+                && sid != SrsTsPESStreamIdPrivateStream2
+                && sid != SrsTsPESStreamIdEcmStream
+                && sid != SrsTsPESStreamIdEmmStream
+                && sid != SrsTsPESStreamIdProgramStreamDirectory
+                && sid != SrsTsPESStreamIdDsmccStream
+                && sid != SrsTsPESStreamIdH2221TypeE
+            ) {
+                srs_warn("ts: drop the pes packet %dB for stream_id=%#x", size - pos, sid);
+                dump = false;
+            }
+        }
+        
+        // xB, append the payload bytes to message.
+        if (dump) {
+            int nb_bytes = size - pos;
+            if (msg->PES_packet_length > 0) {
+                nb_bytes = srs_min(nb_bytes, msg->PES_packet_length - msg->payload->length());
+            }
+            if (nb_bytes > 0) {
+                msg->payload->append(data + pos, nb_bytes);
+            }
+        }
+        
+        // when fresh and the PES_packet_length is 0,
+        // the payload_unit_start_indicator always be 1,
+        // the message should never EOF for the first packet.
+        if (is_fresh_msg && msg->PES_packet_length == 0) {
+            return ret;
+        }
+        
+        // check msg, reap when completed.
+        if (msg->completed(payload_unit_start_indicator)) {
+            return reap(msg, handler);
+        }
+        
+        return ret;
+    }
+    
+    return ret;
+}
+
+int SrsTsContext::reap(SrsTsMessage* msg, ISrsTsHandler* handler)
+{
+    int ret = ERROR_SUCCESS;
+    
+    ret = handler->on_ts_message(msg);
+    
+    // reuse the message and its payload buffer.
+    msg->reset();
+    
+    if (ret != ERROR_SUCCESS) {
+        srs_error("mpegts: handler ts message failed. ret=%d", ret);
+        return ret;
+    }
+    
+    return ret;
+}
+
+/**
+* whether the interval elapsed since the last dts, or will elapse at the next
+* message, about the step later, so the interval is never exceeded.
+* @remark the dts jump backward is also elapsed.
+*/
+bool srs_ts_interval_expired(int64_t dts, int64_t last, int64_t step, int64_t interval)
+{
+    if (last < 0 || dts < last) {
+        return true;
+    }
+    return dts - last + step > interval;
+}
+
+int SrsTsContext::encode(SrsFileWriter* writer, SrsTsMessage* msg, SrsCodecVideo vc, SrsCodecAudio ac)
+{
+    int ret = ERROR_SUCCESS;
+
+    SrsTsStream vs = SrsTsStreamReserved, as = SrsTsStreamReserved;
+    int16_t video_pid = 0, audio_pid = 0;
+    switch (vc) {
+        case SrsCodecVideoAVC: 
+            vs = SrsTsStreamVideoH264; 
+            video_pid = TS_VIDEO_AVC_PID;
+            break;
+        case SrsCodecVideoHEVC:
+            vs = SrsTsStreamVideoHEVC;
+            video_pid = TS_VIDEO_AVC_PID;
+            break;
+        case SrsCodecVideoDisabled:
+            vs = SrsTsStreamReserved;
+            break;
+        case SrsCodecVideoReserved:
+        case SrsCodecVideoReserved1:
+        case SrsCodecVideoReserved2:
+        case SrsCodecVideoSorensonH263:
+        case SrsCodecVideoScreenVideo:
+        case SrsCodecVideoOn2VP6:
+        case SrsCodecVideoOn2VP6WithAlphaChannel:
+        case SrsCodecVideoScreenVideoVersion2:
+            vs = SrsTsStreamReserved;
+            break;
+    }
+    switch (ac) {
+        case SrsCodecAudioAAC:
+            as = SrsTsStreamAudioAAC; 
             audio_pid = TS_AUDIO_AAC_PID;
             break;
         case SrsCodecAudioMP3:
@@ -16506,90 +22089,315 @@ int SrsTsContext::encode(SrsFileWriter* writer, SrsTsMessage* msg, SrsCodecVideo
         return ret;
     }
     
-    // when any codec changed, write PAT/PMT table.
+    // when any codec changed, use a new program of the audio and video,
+    // the version of PAT/PMT increase when changed after written, for the
+    // receiver which cached the tables, @see add_program and set_stream.
     if (vcodec != vc || acodec != ac) {
         vcodec = vc;
         acodec = ac;
-        if ((ret = encode_pat_pmt(writer, video_pid, vs, audio_pid, as)) != ERROR_SUCCESS) {
-            return ret;
+        
+        SrsTsProgram* program = new SrsTsProgram(TS_PMT_NUMBER, TS_PMT_PID);
+        if (as != SrsTsStreamReserved) {
+            program->pids.push_back(audio_pid);
+            program->streams.push_back(as);
+        }
+        if (vs != SrsTsStreamReserved) {
+            program->pids.push_back(video_pid);
+            program->streams.push_back(vs);
+        }
+        
+        // the PAT changed when not the only program.
+        SrsTsProgram* prev = fetch_program(TS_PMT_NUMBER);
+        if (pat_written && (!prev || prev->pmt_pid != TS_PMT_PID || programs.size() != 1)) {
+            pat_version = (pat_version + 1) & 0x1F;
+            pat_written = false;
         }
+        
+        // keep the version and written of PMT when streams not changed.
+        if (prev) {
+            bool changed = prev->pids != program->pids || prev->streams != program->streams;
+            program->version = (changed && prev->written)? (prev->version + 1) & 0x1F : prev->version;
+            program->written = !changed && prev->written;
+        }
+        
+        std::vector<SrsTsProgram*>::iterator it;
+        for (it = programs.begin(); it != programs.end(); ++it) {
+            SrsTsProgram* p = *it;
+            srs_freep(p);
+        }
+        programs.clear();
+        
+        programs.push_back(program);
+        psi_changed = true;
     }
+    
+    int16_t pid = msg->is_audio()? audio_pid : video_pid;
+    return encode_stream(writer, msg, pid);
+}
 
-    // encode the media frame to PES packets over TS.
-    if (msg->is_audio()) {
-        return encode_pes(writer, msg, audio_pid, as, vs == SrsTsStreamReserved);
-    } else {
-        return encode_pes(writer, msg, video_pid, vs, vs == SrsTsStreamReserved);
+int SrsTsContext::add_program(int number, int pmt_pid)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (number <= 0 || number > 0xFFFF || pmt_pid < SrsTsPidAppStart || pmt_pid > SrsTsPidAppEnd
+        || (int)programs.size() >= SRS_TS_MAX_PROGRAMS
+    ) {
+        ret = ERROR_KERNEL_TS_PROGRAM;
+        srs_error("ts: invalid program %d, pmt=%#x, programs=%d. ret=%d", number, pmt_pid, (int)programs.size(), ret);
+        return ret;
+    }
+    
+    std::vector<SrsTsProgram*>::iterator it;
+    for (it = programs.begin(); it != programs.end(); ++it) {
+        SrsTsProgram* program = *it;
+        if (program->number == number || program->pmt_pid == pmt_pid || program->find(pmt_pid) >= 0) {
+            ret = ERROR_KERNEL_TS_PROGRAM;
+            srs_error("ts: program %d or pmt %#x exists. ret=%d", number, pmt_pid, ret);
+            return ret;
+        }
+    }
+    
+    programs.push_back(new SrsTsProgram(number, pmt_pid));
+    
+    if (pat_written) {
+        pat_version = (pat_version + 1) & 0x1F;
+        pat_written = false;
     }
+    psi_changed = true;
+    
+    return ret;
 }
 
-int SrsTsContext::encode_pat_pmt(SrsFileWriter* writer, int16_t vpid, SrsTsStream vs, int16_t apid, SrsTsStream as)
+int SrsTsContext::set_stream(int number, int pid, SrsTsStream stream)
 {
     int ret = ERROR_SUCCESS;
     
-    if (vs != SrsTsStreamVideoH264 && as != SrsTsStreamAudioAAC && as != SrsTsStreamAudioMp3) {
-        ret = ERROR_HLS_NO_STREAM;
-        srs_error("hls: no pmt pcr pid, vs=%d, as=%d. ret=%d", vs, as, ret);
+    SrsTsProgram* program = fetch_program(number);
+    if (!program || pid < SrsTsPidAppStart || pid > SrsTsPidAppEnd) {
+        ret = ERROR_KERNEL_TS_PROGRAM;
+        srs_error("ts: invalid stream %#x of program %d. ret=%d", pid, number, ret);
         return ret;
     }
-
-    int16_t pmt_number = TS_PMT_NUMBER;
-    int16_t pmt_pid = TS_PMT_PID;
-    if (true) {
-        SrsTsPacket* pkt = SrsTsPacket::create_pat(this, pmt_number, pmt_pid);
-        SrsAutoFree(SrsTsPacket, pkt);
-
-        char* buf = new char[SRS_TS_PACKET_SIZE];
-        SrsAutoFree(char, buf);
-
-        // set the left bytes with 0xFF.
-        int nb_buf = pkt->size();
-        srs_assert(nb_buf < SRS_TS_PACKET_SIZE);
-        memset(buf + nb_buf, 0xFF, SRS_TS_PACKET_SIZE - nb_buf);
-
-        SrsStream stream;
-        if ((ret = stream.initialize(buf, nb_buf)) != ERROR_SUCCESS) {
+    
+    int index = program->find(pid);
+    if (index >= 0 && program->streams[index] == stream) {
+        return ret;
+    }
+    
+    std::vector<SrsTsProgram*>::iterator it;
+    for (it = programs.begin(); it != programs.end(); ++it) {
+        SrsTsProgram* p = *it;
+        if (p->pmt_pid == pid || (p != program && p->find(pid) >= 0)) {
+            ret = ERROR_KERNEL_TS_PROGRAM;
+            srs_error("ts: stream %#x of program %d exists. ret=%d", pid, number, ret);
             return ret;
         }
-        if ((ret = pkt->encode(&stream)) != ERROR_SUCCESS) {
-            srs_error("ts encode ts packet failed. ret=%d", ret);
+    }
+    
+    if (index >= 0) {
+        program->pids.erase(program->pids.begin() + index);
+        program->streams.erase(program->streams.begin() + index);
+    }
+    
+    if (stream != SrsTsStreamReserved) {
+        if ((int)program->pids.size() >= SRS_TS_MAX_STREAMS) {
+            ret = ERROR_KERNEL_TS_PROGRAM;
+            srs_error("ts: program %d exceed %d streams. ret=%d", number, SRS_TS_MAX_STREAMS, ret);
             return ret;
         }
-        if ((ret = writer->write(buf, SRS_TS_PACKET_SIZE, NULL)) != ERROR_SUCCESS) {
-            srs_error("ts write ts packet failed. ret=%d", ret);
+        
+        // keep the order of stream when type changed.
+        index = (index >= 0)? index : (int)program->pids.size();
+        program->pids.insert(program->pids.begin() + index, (int16_t)pid);
+        program->streams.insert(program->streams.begin() + index, stream);
+    }
+    
+    if (program->written) {
+        program->version = (program->version + 1) & 0x1F;
+        program->written = false;
+    }
+    psi_changed = true;
+    
+    return ret;
+}
+
+int SrsTsContext::encode_stream(SrsFileWriter* writer, SrsTsMessage* msg, int16_t pid)
+{
+    int ret = ERROR_SUCCESS;
+    
+    SrsTsProgram* program = NULL;
+    int index = -1;
+    
+    std::vector<SrsTsProgram*>::iterator it;
+    for (it = programs.begin(); it != programs.end() && index < 0; ++it) {
+        program = *it;
+        index = program->find(pid);
+    }
+    
+    if (index < 0) {
+        srs_info("ts: ignore the unknown stream, pid=%d", pid);
+        return ret;
+    }
+    SrsTsStream sid = program->streams[index];
+    
+    // the step to the next message, about the max step of messages,
+    // ignore the gap of stream which is not the interval of frames.
+    int64_t last_dts = program->last_dts;
+    if (last_dts >= 0 && msg->dts > last_dts && msg->dts - last_dts < SRS_TS_MAX_STEP) {
+        program->max_step = srs_max(program->max_step, msg->dts - last_dts);
+    }
+    program->last_dts = msg->dts;
+    int64_t step = program->max_step;
+    
+    // when any stream changed, or the interval will elapse at the next message, 
+    // write the PAT and all PMT, each program repeat them on its dts.
+    bool psi_expired = psi_interval > 0 && srs_ts_interval_expired(msg->dts, program->last_psi_dts, step, psi_interval);
+    if (psi_changed || psi_expired) {
+        psi_changed = false;
+        for (it = programs.begin(); it != programs.end(); ++it) {
+            SrsTsProgram* p = *it;
+            p->last_psi_dts = p->last_dts;
+        }
+        if ((ret = encode_psi(writer)) != ERROR_SUCCESS) {
             return ret;
         }
     }
-    if (true) {
-        SrsTsPacket* pkt = SrsTsPacket::create_pmt(this, pmt_number, pmt_pid, vpid, vs, apid, as);
-        SrsAutoFree(SrsTsPacket, pkt);
+    
+    // write pcr according to message.
+    bool write_pcr = msg->write_pcr;
+    int16_t pcr_pid = program->pcr_pid();
+    
+    if (pcr_interval <= 0) {
+        // for pure audio, always write pcr.
+        if (pid == pcr_pid && msg->is_audio()) {
+            write_pcr = true;
+        }
+    } else {
+        if (pid == pcr_pid && write_pcr) {
+            program->last_pcr_dts = msg->dts;
+        }
+        
+        if (srs_ts_interval_expired(msg->dts, program->last_pcr_dts, step, pcr_interval)) {
+            program->last_pcr_dts = msg->dts;
+            if (pid == pcr_pid) {
+                write_pcr = true;
+            } else if ((ret = encode_pcr(writer, program, pcr_of(program, msg->dts))) != ERROR_SUCCESS) {
+                return ret;
+            }
+        }
+    }
+    
+    // encode the media frame to PES packets over TS.
+    return encode_pes(writer, msg, program, pid, sid, write_pcr);
+}
 
-        char* buf = new char[SRS_TS_PACKET_SIZE];
-        SrsAutoFree(char, buf);
+void SrsTsContext::set_psi_interval(int psi_ms)
+{
+    psi_interval = srs_max(0, psi_ms) * 90;
+    
+    std::vector<SrsTsProgram*>::iterator it;
+    for (it = programs.begin(); it != programs.end(); ++it) {
+        SrsTsProgram* program = *it;
+        program->last_psi_dts = -1;
+    }
+}
 
-        // set the left bytes with 0xFF.
-        int nb_buf = pkt->size();
-        srs_assert(nb_buf < SRS_TS_PACKET_SIZE);
-        memset(buf + nb_buf, 0xFF, SRS_TS_PACKET_SIZE - nb_buf);
+void SrsTsContext::set_pcr_interval(int pcr_ms)
+{
+    pcr_interval = srs_max(0, pcr_ms) * 90;
+    
+    std::vector<SrsTsProgram*>::iterator it;
+    for (it = programs.begin(); it != programs.end(); ++it) {
+        SrsTsProgram* program = *it;
+        program->last_pcr_dts = -1;
+    }
+}
 
-        SrsStream stream;
-        if ((ret = stream.initialize(buf, nb_buf)) != ERROR_SUCCESS) {
-            return ret;
+void SrsTsContext::set_bitrate(int64_t bps)
+{
+    bitrate = srs_max(0, bps);
+}
+
+SrsTsProgram* SrsTsContext::fetch_program(int number)
+{
+    std::vector<SrsTsProgram*>::iterator it;
+    for (it = programs.begin(); it != programs.end(); ++it) {
+        SrsTsProgram* program = *it;
+        if (program->number == number) {
+            return program;
         }
-        if ((ret = pkt->encode(&stream)) != ERROR_SUCCESS) {
-            srs_error("ts encode ts packet failed. ret=%d", ret);
+    }
+    return NULL;
+}
+
+int SrsTsContext::encode_psi(SrsFileWriter* writer)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (true) {
+        SrsTsPacket* pkt = SrsTsPacket::create_pat(this, programs, pat_version);
+        SrsAutoFree(SrsTsPacket, pkt);
+        
+        if ((ret = encode_psi_packet(writer, pkt)) != ERROR_SUCCESS) {
             return ret;
         }
-        if ((ret = writer->write(buf, SRS_TS_PACKET_SIZE, NULL)) != ERROR_SUCCESS) {
-            srs_error("ts write ts packet failed. ret=%d", ret);
+        pat_written = true;
+    }
+    
+    std::vector<SrsTsProgram*>::iterator it;
+    for (it = programs.begin(); it != programs.end(); ++it) {
+        SrsTsProgram* program = *it;
+        
+        SrsTsPacket* pkt = SrsTsPacket::create_pmt(this, program);
+        SrsAutoFree(SrsTsPacket, pkt);
+        
+        if ((ret = encode_psi_packet(writer, pkt)) != ERROR_SUCCESS) {
             return ret;
         }
+        program->written = true;
     }
 
     return ret;
 }
 
-int SrsTsContext::encode_pes(SrsFileWriter* writer, SrsTsMessage* msg, int16_t pid, SrsTsStream sid, bool pure_audio)
+int SrsTsContext::encode_psi_packet(SrsFileWriter* writer, SrsTsPacket* pkt)
+{
+    int ret = ERROR_SUCCESS;
+    
+    // the continuity counter of the repeated PAT/PMT.
+    SrsTsChannel* channel = get(pkt->pid);
+    pkt->continuity_counter = channel? channel->continuity_counter : 0;
+    
+    char buf[SRS_TS_PACKET_SIZE];
+    
+    // set the left bytes with 0xFF.
+    int nb_buf = pkt->size();
+    srs_assert(nb_buf < SRS_TS_PACKET_SIZE);
+    memset(buf + nb_buf, 0xFF, SRS_TS_PACKET_SIZE - nb_buf);
+    
+    SrsStream stream;
+    if ((ret = stream.initialize(buf, nb_buf)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    if ((ret = pkt->encode(&stream)) != ERROR_SUCCESS) {
+        srs_error("ts encode ts packet failed. ret=%d", ret);
+        return ret;
+    }
+    if ((ret = writer->write(buf, SRS_TS_PACKET_SIZE, NULL)) != ERROR_SUCCESS) {
+        srs_error("ts write ts packet failed. ret=%d", ret);
+        return ret;
+    }
+    nb_ts_packets++;
+    
+    // the channel is set when encode the PSI.
+    if ((channel = get(pkt->pid)) != NULL) {
+        channel->continuity_counter = (pkt->continuity_counter + 1) & 0x0F;
+    }
+    
+    return ret;
+}
+
+int SrsTsContext::encode_pes(SrsFileWriter* writer, SrsTsMessage* msg, SrsTsProgram* program, int16_t pid, SrsTsStream sid, bool write_pcr)
 {
     int ret = ERROR_SUCCESS;
 
@@ -16597,87 +22405,146 @@ int SrsTsContext::encode_pes(SrsFileWriter* writer, SrsTsMessage* msg, int16_t p
         return ret;
     }
 
-    if (sid != SrsTsStreamVideoH264 && sid != SrsTsStreamAudioMp3 && sid != SrsTsStreamAudioAAC) {
+    if (sid != SrsTsStreamVideoH264 && sid != SrsTsStreamVideoHEVC
+        && sid != SrsTsStreamAudioMp3 && sid != SrsTsStreamAudioAAC
+    ) {
         srs_info("ts: ignore the unknown stream, sid=%d", sid);
         return ret;
     }
 
     SrsTsChannel* channel = get(pid);
     srs_assert(channel);
+    
+    if (!ts_headers) {
+        ts_headers = new char[SRS_PERF_TS_WRITEV_PACKETS * SRS_TS_PACKET_SIZE];
+        ts_iovs = new iovec[SRS_PERF_TS_WRITEV_PACKETS * 2];
+    }
 
     char* start = msg->payload->bytes();
     char* end = start + msg->payload->length();
     char* p = start;
+    int nb_packets = 0;
+    
+    int16_t pcr_pid = program->pcr_pid();
+    SrsTsChannel* pcr_channel = get(pcr_pid);
 
     while (p < end) {
-        SrsTsPacket* pkt = NULL;
-        if (p == start) {
-            // for pure audio stream, always write pcr.
-            bool write_pcr = msg->write_pcr;
-            if (pure_audio && msg->is_audio()) {
-                write_pcr = true;
-            }
-
+        char* header = ts_headers + nb_packets * SRS_TS_PACKET_SIZE;
+        int nb_header = 0;
+        int left = 0;
+        
+        // the PCR is due inside the long PES at the bitrate, write it in the packet
+        // of PCR pid, or in an adaptation only packet of the PCR pid.
+        bool due = pcr_due(program);
+        if (due && pid != pcr_pid && pcr_channel) {
+            int64_t pcr = pcr_of(program, -1);
+            srs_ts_encode_pcr(header, pcr_pid, (pcr_channel->continuity_counter - 1) & 0x0F, pcr);
+            on_pcr(program, pcr);
+            nb_header = SRS_TS_PACKET_SIZE;
+        } else if (p == start) {
             // it's ok to set pcr equals to dts,
-            // @see https://github.com/simple-rtmp-server/srs/issues/311
-            int64_t pcr = write_pcr? msg->dts : -1;
+            // @see https://github.com/ossrs/srs/issues/311
+            int64_t pcr = -1;
+            if (write_pcr || (due && pid == pcr_pid)) {
+                pcr = pcr_of(program, msg->dts);
+                on_pcr(program, pcr);
+            }
             
             // TODO: FIXME: finger it why use discontinuity of msg.
-            pkt = SrsTsPacket::create_pes_first(this, 
-                pid, msg->sid, channel->continuity_counter++, msg->is_discontinuity,
-                pcr, msg->dts, msg->pts, msg->payload->length()
+            nb_header = srs_ts_encode_pes_first(header, pid, msg->sid, channel->continuity_counter++,
+                msg->is_discontinuity, pcr, msg->dts, msg->pts, msg->payload->length(), (int)(end - p)
             );
         } else {
-            pkt = SrsTsPacket::create_pes_continue(this, 
-                pid, msg->sid, channel->continuity_counter++
-            );
+            int64_t pcr = -1;
+            if (due && pid == pcr_pid) {
+                pcr = pcr_of(program, -1);
+                on_pcr(program, pcr);
+            }
+            nb_header = srs_ts_encode_pes_continue(header, pid, channel->continuity_counter++, (int)(end - p), pcr);
         }
-        SrsAutoFree(SrsTsPacket, pkt);
-
-        char* buf = new char[SRS_TS_PACKET_SIZE];
-        SrsAutoFree(char, buf);
-
-        // set the left bytes with 0xFF.
-        int nb_buf = pkt->size();
-        srs_assert(nb_buf < SRS_TS_PACKET_SIZE);
-
-        int left = (int)srs_min(end - p, SRS_TS_PACKET_SIZE - nb_buf);
-        int nb_stuffings = SRS_TS_PACKET_SIZE - nb_buf - left;
-        if (nb_stuffings > 0) {
-            // set all bytes to stuffings.
-            memset(buf, 0xFF, SRS_TS_PACKET_SIZE);
-
-            // padding with stuffings.
-            pkt->padding(nb_stuffings);
-
-            // size changed, recalc it.
-            nb_buf = pkt->size();
-            srs_assert(nb_buf < SRS_TS_PACKET_SIZE);
-
-            left = (int)srs_min(end - p, SRS_TS_PACKET_SIZE - nb_buf);
-            nb_stuffings = SRS_TS_PACKET_SIZE - nb_buf - left;
-            srs_assert(nb_stuffings == 0);
+        srs_assert(nb_header <= SRS_TS_PACKET_SIZE);
+        
+        // the header is padding with stuffings, the payload fill the packet.
+        if (nb_header < SRS_TS_PACKET_SIZE) {
+            left = (int)srs_min(end - p, SRS_TS_PACKET_SIZE - nb_header);
+            srs_assert(nb_header + left == SRS_TS_PACKET_SIZE);
         }
-        memcpy(buf + nb_buf, p, left);
+        
+        iovec* iovs = ts_iovs + nb_packets * 2;
+        iovs[0].iov_base = header;
+        iovs[0].iov_len = nb_header;
+        iovs[1].iov_base = p;
+        iovs[1].iov_len = left;
         p += left;
-
-        SrsStream stream;
-        if ((ret = stream.initialize(buf, nb_buf)) != ERROR_SUCCESS) {
-            return ret;
-        }
-        if ((ret = pkt->encode(&stream)) != ERROR_SUCCESS) {
-            srs_error("ts encode ts packet failed. ret=%d", ret);
-            return ret;
+        nb_ts_packets++;
+        
+        // write the packets when buffer is full or message is done.
+        if (++nb_packets < SRS_PERF_TS_WRITEV_PACKETS && p < end) {
+            continue;
         }
-        if ((ret = writer->write(buf, SRS_TS_PACKET_SIZE, NULL)) != ERROR_SUCCESS) {
+        if ((ret = writer->writev(ts_iovs, nb_packets * 2, NULL)) != ERROR_SUCCESS) {
             srs_error("ts write ts packet failed. ret=%d", ret);
             return ret;
         }
+        nb_packets = 0;
     }
 
     return ret;
 }
 
+int SrsTsContext::encode_pcr(SrsFileWriter* writer, SrsTsProgram* program, int64_t pcr)
+{
+    int ret = ERROR_SUCCESS;
+    
+    int16_t pid = program->pcr_pid();
+    SrsTsChannel* channel = get(pid);
+    if (!channel) {
+        return ret;
+    }
+    
+    char buf[SRS_TS_PACKET_SIZE];
+    srs_ts_encode_pcr(buf, pid, (channel->continuity_counter - 1) & 0x0F, pcr);
+    
+    if ((ret = writer->write(buf, SRS_TS_PACKET_SIZE, NULL)) != ERROR_SUCCESS) {
+        srs_error("ts write pcr packet failed. ret=%d", ret);
+        return ret;
+    }
+    on_pcr(program, pcr);
+    nb_ts_packets++;
+    
+    return ret;
+}
+
+bool SrsTsContext::pcr_due(SrsTsProgram* program)
+{
+    if (bitrate <= 0 || pcr_interval <= 0 || program->last_pcr_packets < 0) {
+        return false;
+    }
+    
+    // the packets at the bitrate in the interval, at least one.
+    int64_t interval = srs_max(1, pcr_interval * bitrate / (90000LL * SRS_TS_PACKET_SIZE * 8));
+    return nb_ts_packets - program->last_pcr_packets >= interval;
+}
+
+int64_t SrsTsContext::pcr_of(SrsTsProgram* program, int64_t dts)
+{
+    if (bitrate <= 0 || program->last_pcr < 0) {
+        return dts;
+    }
+    
+    // the time of packets written since the last PCR, at the bitrate,
+    // round up, so the PCR is never before the position of packet.
+    int64_t elapsed = (nb_ts_packets - program->last_pcr_packets) * SRS_TS_PACKET_SIZE * 8 * 90000LL;
+    elapsed = (elapsed + bitrate - 1) / bitrate;
+    return srs_max(dts, program->last_pcr + elapsed);
+}
+
+void SrsTsContext::on_pcr(SrsTsProgram* program, int64_t pcr)
+{
+    program->last_pcr = pcr;
+    program->last_pcr_packets = nb_ts_packets;
+}
+
 SrsTsPacket::SrsTsPacket(SrsTsContext* c)
 {
     context = c;
@@ -16870,7 +22737,7 @@ void SrsTsPacket::padding(int nb_stuffings)
     }
 }
 
-SrsTsPacket* SrsTsPacket::create_pat(SrsTsContext* context, int16_t pmt_number, int16_t pmt_pid)
+SrsTsPacket* SrsTsPacket::create_pat(SrsTsContext* context, vector<SrsTsProgram*>& programs, int8_t version)
 {
     SrsTsPacket* pkt = new SrsTsPacket(context);
     pkt->sync_byte = 0x47;
@@ -16890,26 +22757,28 @@ SrsTsPacket* SrsTsPacket::create_pat(SrsTsContext* context, int16_t pmt_number,
     pat->section_syntax_indicator = 1;
     pat->section_length = 0; // calc in size.
     pat->transport_stream_id = 1;
-    pat->version_number = 0;
+    pat->version_number = version;
     pat->current_next_indicator = 1;
     pat->section_number = 0;
     pat->last_section_number = 0;
-    pat->programs.push_back(new SrsTsPayloadPATProgram(pmt_number, pmt_pid));
+    for (int i = 0; i < (int)programs.size(); i++) {
+        SrsTsProgram* program = programs[i];
+        pat->programs.push_back(new SrsTsPayloadPATProgram(program->number, program->pmt_pid));
+    }
     pat->CRC_32 = 0; // calc in encode.
     return pkt;
 }
 
-SrsTsPacket* SrsTsPacket::create_pmt(SrsTsContext* context, int16_t pmt_number, int16_t pmt_pid, int16_t vpid, SrsTsStream vs, int16_t apid, SrsTsStream as)
+SrsTsPacket* SrsTsPacket::create_pmt(SrsTsContext* context, SrsTsProgram* program)
 {
     SrsTsPacket* pkt = new SrsTsPacket(context);
     pkt->sync_byte = 0x47;
     pkt->transport_error_indicator = 0;
     pkt->payload_unit_start_indicator = 1;
     pkt->transport_priority = 0;
-    pkt->pid = (SrsTsPid)pmt_pid;
+    pkt->pid = (SrsTsPid)program->pmt_pid;
     pkt->transport_scrambling_control = SrsTsScrambledDisabled;
     pkt->adaption_field_control = SrsTsAdaptationFieldTypePayloadOnly;
-    // TODO: FIXME: maybe should continuous in channel.
     pkt->continuity_counter = 0;
     pkt->adaptation_field = NULL;
     SrsTsPayloadPMT* pmt = new SrsTsPayloadPMT(pkt);
@@ -16919,28 +22788,17 @@ SrsTsPacket* SrsTsPacket::create_pmt(SrsTsContext* context, int16_t pmt_number,
     pmt->table_id = SrsTsPsiIdPms;
     pmt->section_syntax_indicator = 1;
     pmt->section_length = 0; // calc in size.
-    pmt->program_number = pmt_number;
-    pmt->version_number = 0;
+    pmt->program_number = program->number;
+    pmt->version_number = program->version;
     pmt->current_next_indicator = 1;
     pmt->section_number = 0;
     pmt->last_section_number = 0;
     pmt->program_info_length = 0;
     
-    // must got one valid codec.
-    srs_assert(vs == SrsTsStreamVideoH264 || as == SrsTsStreamAudioAAC || as == SrsTsStreamAudioMp3);
-    
-    // if mp3 or aac specified, use audio to carry pcr.
-    if (as == SrsTsStreamAudioAAC || as == SrsTsStreamAudioMp3) {
-        // use audio to carray pcr by default.
-        // for hls, there must be atleast one audio channel.
-        pmt->PCR_PID = apid;
-        pmt->infos.push_back(new SrsTsPayloadPMTESInfo(as, apid));
-    }
-    
-    // if h.264 specified, use video to carry pcr.
-    if (vs == SrsTsStreamVideoH264) {
-        pmt->PCR_PID = vpid;
-        pmt->infos.push_back(new SrsTsPayloadPMTESInfo(vs, vpid));
+    // the video carry pcr when specified, otherwise the audio.
+    pmt->PCR_PID = program->pcr_pid();
+    for (int i = 0; i < (int)program->pids.size(); i++) {
+        pmt->infos.push_back(new SrsTsPayloadPMTESInfo(program->streams[i], program->pids[i]));
     }
     
     pmt->CRC_32 = 0; // calc in encode.
@@ -17065,7 +22923,7 @@ SrsTsAdaptationField::SrsTsAdaptationField(SrsTsPacket* pkt)
 
 SrsTsAdaptationField::~SrsTsAdaptationField()
 {
-    srs_freep(transport_private_data);
+    srs_freepa(transport_private_data);
 }
 
 int SrsTsAdaptationField::decode(SrsStream* stream)
@@ -17134,7 +22992,7 @@ int SrsTsAdaptationField::decode(SrsStream* stream)
         pp[0] = *p++;
         
         // @remark, use pcr base and ignore the extension
-        // @see https://github.com/simple-rtmp-server/srs/issues/250#issuecomment-71349370
+        // @see https://github.com/ossrs/srs/issues/250#issuecomment-71349370
         program_clock_reference_extension = pcrv & 0x1ff;
         const1_value0 = (pcrv >> 9) & 0x3F;
         program_clock_reference_base = (pcrv >> 15) & 0x1ffffffffLL;
@@ -17161,7 +23019,7 @@ int SrsTsAdaptationField::decode(SrsStream* stream)
         pp[0] = *p++;
         
         // @remark, use pcr base and ignore the extension
-        // @see https://github.com/simple-rtmp-server/srs/issues/250#issuecomment-71349370
+        // @see https://github.com/ossrs/srs/issues/250#issuecomment-71349370
         original_program_clock_reference_extension = opcrv & 0x1ff;
         const1_value2 = (opcrv >> 9) & 0x3F;
         original_program_clock_reference_base = (opcrv >> 15) & 0x1ffffffffLL;
@@ -17190,7 +23048,7 @@ int SrsTsAdaptationField::decode(SrsStream* stream)
                 srs_error("ts: demux af transport_private_data_flag failed. ret=%d", ret);
                 return ret;
             }
-            srs_freep(transport_private_data);
+            srs_freepa(transport_private_data);
             transport_private_data = new char[transport_private_data_length];
             stream->read_bytes(transport_private_data, transport_private_data_length);
         }
@@ -17341,10 +23199,10 @@ int SrsTsAdaptationField::encode(SrsStream* stream)
         stream->skip(6);
         
         // @remark, use pcr base and ignore the extension
-        // @see https://github.com/simple-rtmp-server/srs/issues/250#issuecomment-71349370
+        // @see https://github.com/ossrs/srs/issues/250#issuecomment-71349370
         int64_t pcrv = program_clock_reference_extension & 0x1ff;
         pcrv |= (const1_value0 << 9) & 0x7E00;
-        pcrv |= (program_clock_reference_base << 15) & 0x1FFFFFFFF000000LL;
+        pcrv |= (program_clock_reference_base << 15) & 0xFFFFFFFF8000LL;
 
         pp = (char*)&pcrv;
         *p++ = pp[5];
@@ -17475,9 +23333,9 @@ SrsTsPayloadPES::SrsTsPayloadPES(SrsTsPacket* p) : SrsTsPayload(p)
 
 SrsTsPayloadPES::~SrsTsPayloadPES()
 {
-    srs_freep(PES_private_data);
-    srs_freep(pack_field);
-    srs_freep(PES_extension_field);
+    srs_freepa(PES_private_data);
+    srs_freepa(pack_field);
+    srs_freepa(PES_extension_field);
 }
 
 int SrsTsPayloadPES::decode(SrsStream* stream, SrsTsMessage** ppmsg)
@@ -17754,7 +23612,7 @@ int SrsTsPayloadPES::decode(SrsStream* stream, SrsTsMessage** ppmsg)
 
                 // 16B
                 if (PES_private_data_flag) {
-                    srs_freep(PES_private_data);
+                    srs_freepa(PES_private_data);
                     PES_private_data = new char[16];
                     stream->read_bytes(PES_private_data, 16);
                 }
@@ -17770,7 +23628,7 @@ int SrsTsPayloadPES::decode(SrsStream* stream, SrsTsMessage** ppmsg)
                             srs_error("ts: demux PSE ext pack failed. ret=%d", ret);
                             return ret;
                         }
-                        srs_freep(pack_field);
+                        srs_freepa(pack_field);
                         pack_field = new char[pack_field_length];
                         stream->read_bytes(pack_field, pack_field_length);
                     }
@@ -17808,7 +23666,7 @@ int SrsTsPayloadPES::decode(SrsStream* stream, SrsTsMessage** ppmsg)
                             srs_error("ts: demux PSE ext field failed. ret=%d", ret);
                             return ret;
                         }
-                        srs_freep(PES_extension_field);
+                        srs_freepa(PES_extension_field);
                         PES_extension_field = new char[PES_extension_field_length];
                         stream->read_bytes(PES_extension_field, PES_extension_field_length);
                     }
@@ -18571,7 +24429,7 @@ SrsTsPayloadPMTESInfo::SrsTsPayloadPMTESInfo(SrsTsStream st, int16_t epid)
 
 SrsTsPayloadPMTESInfo::~SrsTsPayloadPMTESInfo()
 {
-    srs_freep(ES_info);
+    srs_freepa(ES_info);
 }
 
 int SrsTsPayloadPMTESInfo::decode(SrsStream* stream)
@@ -18601,7 +24459,7 @@ int SrsTsPayloadPMTESInfo::decode(SrsStream* stream)
             srs_error("ts: demux PMT es info data failed. ret=%d", ret);
             return ret;
         }
-        srs_freep(ES_info);
+        srs_freepa(ES_info);
         ES_info = new char[ES_info_length];
         stream->read_bytes(ES_info, ES_info_length);
     }
@@ -18658,7 +24516,7 @@ SrsTsPayloadPMT::SrsTsPayloadPMT(SrsTsPacket* p) : SrsTsPayloadPSI(p)
 
 SrsTsPayloadPMT::~SrsTsPayloadPMT()
 {
-    srs_freep(program_info_desc);
+    srs_freepa(program_info_desc);
 
     std::vector<SrsTsPayloadPMTESInfo*>::iterator it;
     for (it = infos.begin(); it != infos.end(); ++it) {
@@ -18712,7 +24570,7 @@ int SrsTsPayloadPMT::psi_decode(SrsStream* stream)
             return ret;
         }
 
-        srs_freep(program_info_desc);
+        srs_freepa(program_info_desc);
         program_info_desc = new char[program_info_length];
         stream->read_bytes(program_info_desc, program_info_length);
     }
@@ -18730,6 +24588,7 @@ int SrsTsPayloadPMT::psi_decode(SrsStream* stream)
         // update the apply pid table
         switch (info->stream_type) {
             case SrsTsStreamVideoH264:
+            case SrsTsStreamVideoHEVC:
             case SrsTsStreamVideoMpeg4:
                 packet->context->set(info->elementary_PID, SrsTsPidApplyVideo, info->stream_type);
                 break;
@@ -18817,6 +24676,7 @@ int SrsTsPayloadPMT::psi_encode(SrsStream* stream)
         // update the apply pid table
         switch (info->stream_type) {
             case SrsTsStreamVideoH264:
+            case SrsTsStreamVideoHEVC:
             case SrsTsStreamVideoMpeg4:
                 packet->context->set(info->elementary_PID, SrsTsPidApplyVideo, info->stream_type);
                 break;
@@ -18876,6 +24736,12 @@ int SrsTSMuxer::update_acodec(SrsCodecAudio ac)
     return ERROR_SUCCESS;
 }
 
+int SrsTSMuxer::update_vcodec(SrsCodecVideo vc)
+{
+    vcodec = vc;
+    return ERROR_SUCCESS;
+}
+
 int SrsTSMuxer::write_audio(SrsTsMessage* audio)
 {
     int ret = ERROR_SUCCESS;
@@ -18908,9 +24774,26 @@ int SrsTSMuxer::write_video(SrsTsMessage* video)
     return ret;
 }
 
-void SrsTSMuxer::close()
+int SrsTSMuxer::write_stream(int16_t pid, SrsTsMessage* msg)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if ((ret = context->encode_stream(writer, msg, pid)) != ERROR_SUCCESS) {
+        srs_error("ts encode stream %#x failed. ret=%d", pid, ret);
+        return ret;
+    }
+    
+    return ret;
+}
+
+int SrsTSMuxer::close()
+{
+    return writer->close();
+}
+
+SrsCodecVideo SrsTSMuxer::video_codec()
 {
-    writer->close();
+    return vcodec;
 }
 
 SrsTsCache::SrsTsCache()
@@ -18933,11 +24816,12 @@ int SrsTsCache::cache_audio(SrsAvcAacCodec* codec, int64_t dts, SrsCodecSample*
     if (!audio) {
         audio = new SrsTsMessage();
         audio->write_pcr = false;
-        audio->start_pts = dts;
+        audio->dts = audio->pts = audio->start_pts = dts;
     }
 
-    audio->dts = dts;
-    audio->pts = audio->dts;
+    // TODO: FIXME: refine code.
+    //audio->dts = dts;
+    //audio->pts = audio->dts;
     audio->sid = SrsTsPESStreamIdAudioCommon;
     
     // must be aac or mp3
@@ -19144,12 +25028,29 @@ int SrsTsCache::do_cache_avc(SrsAvcAacCodec* codec, SrsCodecSample* sample)
     // H.264-AVC-ISO_IEC_14496-10-2012.pdf, page 105.
     static u_int8_t aud_nalu_7[] = { 0x09, 0xf0};
     
+    // for hevc, the 2bytes nalu header of aud(nal_unit_type:35),
+    // then pic_type u(3) 2 for all slice types, with the rbsp stop bit.
+    // 7.3.2.5 Access unit delimiter RBSP syntax
+    // H.265-HEVC-ITU-T-REC-H.265-201304.pdf, page 44.
+    static u_int8_t aud_nalu_35[] = { 0x46, 0x01, 0x50 };
+    bool is_hevc = sample->vcodec == SrsCodecVideoHEVC;
+    
     // always append a aud nalu for each frame.
     video->payload->append((const char*)fresh_nalu_header, 4);
-    video->payload->append((const char*)aud_nalu_7, 2);
+    if (is_hevc) {
+        video->payload->append((const char*)aud_nalu_35, 3);
+    } else {
+        video->payload->append((const char*)aud_nalu_7, 2);
+    }
     
-    // when ts message(samples) contains IDR, insert sps+pps.
+    // when ts message(samples) contains IDR, insert sps+pps,
+    // for hevc, the IRAP frame, insert vps+sps+pps.
     if (sample->has_idr) {
+        // fresh nalu header before vps.
+        if (is_hevc && codec->videoParameterSetLength > 0) {
+            video->payload->append((const char*)fresh_nalu_header, 4);
+            video->payload->append(codec->videoParameterSetNALUnit, codec->videoParameterSetLength);
+        }
         // fresh nalu header before sps.
         if (codec->sequenceParameterSetLength > 0) {
             // AnnexB prefix, for sps always 4 bytes header
@@ -19177,6 +25078,18 @@ int SrsTsCache::do_cache_avc(SrsAvcAacCodec* codec, SrsCodecSample* sample)
             return ret;
         }
         
+        // for hevc, ignore VPS/SPS/PPS/AUD
+        if (is_hevc) {
+            SrsHevcNaluType hevc_nalu_type = (SrsHevcNaluType)((sample_unit->bytes[0] >> 1) & 0x3f);
+            if (hevc_nalu_type >= SrsHevcNaluTypeVPS && hevc_nalu_type <= SrsHevcNaluTypeAccessUnitDelimiter) {
+                continue;
+            }
+            
+            video->payload->append((const char*)cont_nalu_header, 3);
+            video->payload->append(sample_unit->bytes, sample_unit->size);
+            continue;
+        }
+        
         // 5bits, 7.3.1 NAL unit syntax,
         // H.264-AVC-ISO_IEC_14496-10-2012.pdf, page 83.
         SrsAvcNaluType nal_unit_type = (SrsAvcNaluType)(sample_unit->bytes[0] & 0x1f);
@@ -19244,6 +25157,17 @@ int SrsTsEncoder::initialize(SrsFileWriter* fw)
     return ret;
 }
 
+void SrsTsEncoder::set_interval(int psi_ms, int pcr_ms)
+{
+    context->set_psi_interval(psi_ms);
+    context->set_pcr_interval(pcr_ms);
+}
+
+void SrsTsEncoder::set_bitrate(int64_t bps)
+{
+    context->set_bitrate(bps);
+}
+
 int SrsTsEncoder::write_audio(int64_t timestamp, char* data, int size)
 {
     int ret = ERROR_SUCCESS;
@@ -19287,20 +25211,11 @@ int SrsTsEncoder::write_audio(int64_t timestamp, char* data, int size)
         return ret;
     }
     
-    // flush if buffer exceed max size.
-    if (cache->audio->payload->length() > SRS_AUTO_HLS_AUDIO_CACHE_SIZE) {
-        return flush_video();
-    }
-
-    // TODO: config it.
-    // in ms, audio delay to flush the audios.
-    int64_t audio_delay = SRS_CONF_DEFAULT_AAC_DELAY;
-    // flush if audio delay exceed
-    if (dts - cache->audio->start_pts > audio_delay * 90) {
-        return flush_audio();
-    }
-
-    return ret;
+    // TODO: FIXME: for pure audio, aggregate some frame to one.
+    
+    // always flush audio frame by frame.
+    // @see https://github.com/ossrs/srs/issues/512
+    return flush_audio();
 }
 
 int SrsTsEncoder::write_video(int64_t timestamp, char* data, int size)
@@ -19314,12 +25229,18 @@ int SrsTsEncoder::write_video(int64_t timestamp, char* data, int size)
     }
     
     // ignore info frame,
-    // @see https://github.com/simple-rtmp-server/srs/issues/288#issuecomment-69863909
+    // @see https://github.com/ossrs/srs/issues/288#issuecomment-69863909
     if (sample->frame_type == SrsCodecVideoAVCFrameVideoInfoFrame) {
         return ret;
     }
     
-    if (codec->video_codec_id != SrsCodecVideoAVC) {
+    if (codec->video_codec_id != SrsCodecVideoAVC && codec->video_codec_id != SrsCodecVideoHEVC) {
+        return ret;
+    }
+    
+    // when codec changed, write new header.
+    if ((ret = muxer->update_vcodec((SrsCodecVideo)codec->video_codec_id)) != ERROR_SUCCESS) {
+        srs_error("http: ts video write header failed. ret=%d", ret);
         return ret;
     }
     
@@ -19367,83 +25288,239 @@ int SrsTsEncoder::flush_video()
     return ret;
 }
 
+SrsTsTrack::SrsTsTrack(int p, int16_t id)
+{
+    program = p;
+    pid = id;
+    codec = new SrsAvcAacCodec();
+    sample = new SrsCodecSample();
+    cache = new SrsTsCache();
+}
 
-// following is generated by src/kernel/srs_kernel_buffer.cpp
-/*
-The MIT License (MIT)
-
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
-
-Permission is hereby granted, free of charge, to any person obtaining a copy of
-this software and associated documentation files (the "Software"), to deal in
-the Software without restriction, including without limitation the rights to
-use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
-the Software, and to permit persons to whom the Software is furnished to do so,
-subject to the following conditions:
-
-The above copyright notice and this permission notice shall be included in all
-copies or substantial portions of the Software.
+SrsTsTrack::~SrsTsTrack()
+{
+    srs_freep(codec);
+    srs_freep(sample);
+    srs_freep(cache);
+}
 
-THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
-IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
-FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
-COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
-IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
-CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
-*/
+SrsTsMultiEncoder::SrsTsMultiEncoder()
+{
+    writer = NULL;
+    muxer = NULL;
+    context = new SrsTsContext();
+}
 
-//#include <srs_kernel_buffer.hpp>
+SrsTsMultiEncoder::~SrsTsMultiEncoder()
+{
+    std::vector<SrsTsTrack*>::iterator it;
+    for (it = tracks.begin(); it != tracks.end(); ++it) {
+        SrsTsTrack* track = *it;
+        srs_freep(track);
+    }
+    tracks.clear();
+    
+    srs_freep(muxer);
+    srs_freep(context);
+}
 
-//#include <srs_kernel_error.hpp>
-//#include <srs_kernel_log.hpp>
-//#include <srs_kernel_utility.hpp>
-//#include <srs_core_performance.hpp>
+int SrsTsMultiEncoder::initialize(SrsFileWriter* fw)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(fw);
+    
+    if (!fw->is_open()) {
+        ret = ERROR_KERNEL_FLV_STREAM_CLOSED;
+        srs_warn("stream is not open for encoder. ret=%d", ret);
+        return ret;
+    }
+    
+    writer = fw;
+    
+    // the writer is opened by user, never reopen it.
+    srs_freep(muxer);
+    muxer = new SrsTSMuxer(fw, context, SrsCodecAudioAAC, SrsCodecVideoAVC);
+    context->reset();
+    
+    return ret;
+}
 
-SrsSimpleBuffer::SrsSimpleBuffer()
+void SrsTsMultiEncoder::set_interval(int psi_ms, int pcr_ms)
 {
+    context->set_psi_interval(psi_ms);
+    context->set_pcr_interval(pcr_ms);
 }
 
-SrsSimpleBuffer::~SrsSimpleBuffer()
+void SrsTsMultiEncoder::set_bitrate(int64_t bps)
 {
+    context->set_bitrate(bps);
 }
 
-int SrsSimpleBuffer::length()
+int SrsTsMultiEncoder::add_track(int program, int pid, int* ptrack)
 {
-    int len = (int)data.size();
-    srs_assert(len >= 0);
-    return len;
+    int ret = ERROR_SUCCESS;
+    
+    // the pid over 0x1000 is the PMT of program.
+    if (program <= 0 || program >= 0xFFF || pid < SrsTsPidAppStart || pid >= 0x1000) {
+        ret = ERROR_KERNEL_TS_PROGRAM;
+        srs_error("ts: invalid track %#x of program %d. ret=%d", pid, program, ret);
+        return ret;
+    }
+    
+    bool has_program = false;
+    std::vector<SrsTsTrack*>::iterator it;
+    for (it = tracks.begin(); it != tracks.end(); ++it) {
+        SrsTsTrack* track = *it;
+        if (track->pid == pid) {
+            ret = ERROR_KERNEL_TS_PROGRAM;
+            srs_error("ts: track %#x exists. ret=%d", pid, ret);
+            return ret;
+        }
+        has_program |= track->program == program;
+    }
+    
+    // the stream is set when got the codec of track.
+    if (!has_program && (ret = context->add_program(program, 0x1000 + program)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    tracks.push_back(new SrsTsTrack(program, (int16_t)pid));
+    
+    if (ptrack) {
+        *ptrack = (int)tracks.size() - 1;
+    }
+    
+    return ret;
 }
 
-char* SrsSimpleBuffer::bytes()
+int SrsTsMultiEncoder::write_audio(int track, int64_t timestamp, char* data, int size)
 {
-    return (length() == 0)? NULL : &data.at(0);
+    int ret = ERROR_SUCCESS;
+    
+    SrsTsTrack* t = fetch(track);
+    if (!t) {
+        ret = ERROR_KERNEL_TS_PROGRAM;
+        srs_error("ts: invalid track %d. ret=%d", track, ret);
+        return ret;
+    }
+    
+    SrsAvcAacCodec* codec = t->codec;
+    SrsCodecSample* sample = t->sample;
+    
+    sample->clear();
+    if ((ret = codec->audio_aac_demux(data, size, sample)) != ERROR_SUCCESS) {
+        if (ret != ERROR_HLS_TRY_MP3) {
+            srs_error("ts: aac demux audio failed. ret=%d", ret);
+            return ret;
+        }
+        if ((ret = codec->audio_mp3_demux(data, size, sample)) != ERROR_SUCCESS) {
+            srs_error("ts: mp3 demux audio failed. ret=%d", ret);
+            return ret;
+        }
+    }
+    SrsCodecAudio acodec = (SrsCodecAudio)codec->audio_codec_id;
+    
+    // ts support audio codec: aac/mp3
+    if (acodec != SrsCodecAudioAAC && acodec != SrsCodecAudioMP3) {
+        return ret;
+    }
+    
+    // for aac: ignore sequence header
+    if (acodec == SrsCodecAudioAAC && sample->aac_packet_type == SrsCodecAudioTypeSequenceHeader) {
+        return ret;
+    }
+    
+    if ((ret = t->cache->cache_audio(codec, timestamp * 90, sample)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    SrsTsStream stream = (acodec == SrsCodecAudioAAC)? SrsTsStreamAudioAAC : SrsTsStreamAudioMp3;
+    if ((ret = flush(t, t->cache->audio, stream)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    srs_freep(t->cache->audio);
+    
+    return ret;
 }
 
-void SrsSimpleBuffer::erase(int size)
+int SrsTsMultiEncoder::write_video(int track, int64_t timestamp, char* data, int size)
 {
-    if (size <= 0) {
-        return;
+    int ret = ERROR_SUCCESS;
+    
+    SrsTsTrack* t = fetch(track);
+    if (!t) {
+        ret = ERROR_KERNEL_TS_PROGRAM;
+        srs_error("ts: invalid track %d. ret=%d", track, ret);
+        return ret;
     }
     
-    if (size >= length()) {
-        data.clear();
-        return;
+    SrsAvcAacCodec* codec = t->codec;
+    SrsCodecSample* sample = t->sample;
+    
+    sample->clear();
+    if ((ret = codec->video_avc_demux(data, size, sample)) != ERROR_SUCCESS) {
+        srs_error("ts: codec demux video failed. ret=%d", ret);
+        return ret;
     }
     
-    data.erase(data.begin(), data.begin() + size);
+    // ignore info frame,
+    // @see https://github.com/ossrs/srs/issues/288#issuecomment-69863909
+    if (sample->frame_type == SrsCodecVideoAVCFrameVideoInfoFrame) {
+        return ret;
+    }
+    
+    if (codec->video_codec_id != SrsCodecVideoAVC && codec->video_codec_id != SrsCodecVideoHEVC) {
+        return ret;
+    }
+    
+    // ignore sequence header
+    if (sample->frame_type == SrsCodecVideoAVCFrameKeyFrame
+         && sample->avc_packet_type == SrsCodecVideoAVCTypeSequenceHeader) {
+        return ret;
+    }
+    
+    if ((ret = t->cache->cache_video(codec, timestamp * 90, sample)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    SrsTsStream stream = (codec->video_codec_id == SrsCodecVideoHEVC)? SrsTsStreamVideoHEVC : SrsTsStreamVideoH264;
+    if ((ret = flush(t, t->cache->video, stream)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    srs_freep(t->cache->video);
+    
+    return ret;
 }
 
-void SrsSimpleBuffer::append(const char* bytes, int size)
+SrsTsTrack* SrsTsMultiEncoder::fetch(int track)
 {
-    srs_assert(size > 0);
+    if (track < 0 || track >= (int)tracks.size()) {
+        return NULL;
+    }
+    return tracks[track];
+}
 
-    data.insert(data.end(), bytes, bytes + size);
+int SrsTsMultiEncoder::flush(SrsTsTrack* track, SrsTsMessage* msg, SrsTsStream stream)
+{
+    int ret = ERROR_SUCCESS;
+    
+    // when codec of track changed, update the PMT.
+    if ((ret = context->set_stream(track->program, track->pid, stream)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    return muxer->write_stream(track->pid, msg);
 }
-// following is generated by src/protocol/srs_rtmp_amf0.cpp
+
+#endif
+
+
+// following is generated by src/kernel/srs_kernel_udp.cpp
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -19463,191 +25540,2435 @@ IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
 CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 
-//#include <srs_rtmp_amf0.hpp>
+//#include <srs_kernel_udp.hpp>
 
-#include <utility>
-#include <vector>
-#include <sstream>
+#if !defined(SRS_EXPORT_LIBRTMP) && !defined(_WIN32)
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
 using namespace std;
 
 //#include <srs_kernel_log.hpp>
 //#include <srs_kernel_error.hpp>
-//#include <srs_kernel_stream.hpp>
-
-using namespace _srs_internal;
-
-// AMF0 marker
-#define RTMP_AMF0_Number                     0x00
-#define RTMP_AMF0_Boolean                     0x01
-#define RTMP_AMF0_String                     0x02
-#define RTMP_AMF0_Object                     0x03
-#define RTMP_AMF0_MovieClip                 0x04 // reserved, not supported
-#define RTMP_AMF0_Null                         0x05
-#define RTMP_AMF0_Undefined                 0x06
-#define RTMP_AMF0_Reference                 0x07
-#define RTMP_AMF0_EcmaArray                 0x08
-#define RTMP_AMF0_ObjectEnd                 0x09
-#define RTMP_AMF0_StrictArray                 0x0A
-#define RTMP_AMF0_Date                         0x0B
-#define RTMP_AMF0_LongString                 0x0C
-#define RTMP_AMF0_UnSupported                 0x0D
-#define RTMP_AMF0_RecordSet                 0x0E // reserved, not supported
-#define RTMP_AMF0_XmlDocument                 0x0F
-#define RTMP_AMF0_TypedObject                 0x10
-// AVM+ object is the AMF3 object.
-#define RTMP_AMF0_AVMplusObject             0x11
-// origin array whos data takes the same form as LengthValueBytes
-#define RTMP_AMF0_OriginStrictArray         0x20
+//#include <srs_kernel_utility.hpp>
 
-// User defined
-#define RTMP_AMF0_Invalid                     0x3F
+// the PCR in tbn 90000 jumps over this is discontinuity.
+#define SRS_TS_UDP_PCR_JUMP 90000
 
-SrsAmf0Any::SrsAmf0Any()
+/**
+* the time in us of the monotonic clock, to pace the stream.
+*/
+int64_t srs_udp_now_us()
 {
-    marker = RTMP_AMF0_Invalid;
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
 }
 
-SrsAmf0Any::~SrsAmf0Any()
+/**
+* wait the cond for some us at most.
+*/
+void srs_udp_timedwait(pthread_cond_t* cond, pthread_mutex_t* lock, int64_t us)
 {
+    timeval tv;
+    gettimeofday(&tv, NULL);
+    
+    int64_t abstime = tv.tv_sec * 1000000LL + tv.tv_usec + us;
+    
+    timespec ts;
+    ts.tv_sec = (time_t)(abstime / 1000000);
+    ts.tv_nsec = (long)(abstime % 1000000) * 1000;
+    
+    pthread_cond_timedwait(cond, lock, &ts);
 }
 
-bool SrsAmf0Any::is_string()
+SrsTsUdpWriter::SrsTsUdpWriter()
 {
-    return marker == RTMP_AMF0_String;
-}
-
-bool SrsAmf0Any::is_boolean()
+    fd = -1;
+    memset(&addr, 0, sizeof(addr));
+    ttl = 16;
+    bitrate = 0;
+    position = 0;
+    
+    nb_packet = 0;
+    current = NULL;
+    nb_packets = 0;
+    base_packets = 0;
+    base_time = -1;
+    base_pcr = -1;
+    last_time = -1;
+    last_pcr = -1;
+    pmt_pid = -1;
+    pcr_pid = -1;
+    
+    started = false;
+    quit = false;
+    error = ERROR_SUCCESS;
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&cond, NULL);
+}
+
+SrsTsUdpWriter::~SrsTsUdpWriter()
 {
-    return marker == RTMP_AMF0_Boolean;
+    close();
+    
+    if (current) {
+        srs_freep(current);
+    }
+    
+    std::vector<SrsTsDatagram*>::iterator it;
+    for (it = free_datagrams.begin(); it != free_datagrams.end(); ++it) {
+        SrsTsDatagram* dg = *it;
+        srs_freep(dg);
+    }
+    free_datagrams.clear();
+    
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&lock);
 }
 
-bool SrsAmf0Any::is_number()
+int SrsTsUdpWriter::open(string p)
 {
-    return marker == RTMP_AMF0_Number;
+    int ret = ERROR_SUCCESS;
+    
+    if (p.empty()) {
+        p = url;
+    }
+    
+    // the ts muxer reopen the writer for a new ts.
+    if (fd >= 0 && p == url) {
+        return ret;
+    }
+    
+    close();
+    
+    std::string host = p;
+    if (srs_string_starts_with(host, "udp://")) {
+        host = host.substr(6);
+    }
+    
+    size_t pos = host.rfind(":");
+    int port = (pos == std::string::npos)? 0 : ::atoi(host.substr(pos + 1).c_str());
+    std::string ip = (pos == std::string::npos)? "" : srs_dns_resolve(host.substr(0, pos));
+    if (ip.empty() || port <= 0 || port > 65535) {
+        ret = ERROR_SYSTEM_IP_INVALID;
+        srs_error("udp: invalid url %s. ret=%d", p.c_str(), ret);
+        return ret;
+    }
+    
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr(ip.c_str());
+    
+    if ((fd = ::socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
+        ret = ERROR_SOCKET_CREATE;
+        srs_error("udp: create socket failed. ret=%d", ret);
+        return ret;
+    }
+    
+    if (IN_MULTICAST(ntohl(addr.sin_addr.s_addr))) {
+        unsigned char v = (unsigned char)ttl;
+        if (::setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &v, sizeof(v)) < 0) {
+            ret = ERROR_SOCKET_CREATE;
+            srs_error("udp: set multicast ttl %d failed. ret=%d", ttl, ret);
+            ::close(fd);
+            fd = -1;
+            return ret;
+        }
+    }
+    
+    url = p;
+    position = 0;
+    nb_packet = 0;
+    nb_packets = 0;
+    base_packets = 0;
+    base_time = -1;
+    base_pcr = -1;
+    last_time = -1;
+    last_pcr = -1;
+    pmt_pid = -1;
+    pcr_pid = -1;
+    quit = false;
+    error = ERROR_SUCCESS;
+    
+    if (pthread_create(&tid, NULL, worker, this) != 0) {
+        ret = ERROR_SYSTEM_CREATE_THREAD;
+        srs_error("udp: create send thread failed. ret=%d", ret);
+        ::close(fd);
+        fd = -1;
+        return ret;
+    }
+    started = true;
+    
+    srs_trace("udp: open %s, ip=%s, port=%d, bitrate=%"PRId64, p.c_str(), ip.c_str(), port, bitrate);
+    
+    return ret;
 }
 
-bool SrsAmf0Any::is_null()
+int SrsTsUdpWriter::open_append(string p)
 {
-    return marker == RTMP_AMF0_Null;
+    return open(p);
 }
 
-bool SrsAmf0Any::is_undefined()
+int SrsTsUdpWriter::close()
 {
-    return marker == RTMP_AMF0_Undefined;
+    int ret = ERROR_SUCCESS;
+    
+    if (fd < 0) {
+        return ret;
+    }
+    
+    if ((ret = flush()) != ERROR_SUCCESS) {
+        srs_warn("udp: flush failed. ret=%d", ret);
+    }
+    
+    if (started) {
+        pthread_mutex_lock(&lock);
+        quit = true;
+        pthread_cond_broadcast(&cond);
+        pthread_mutex_unlock(&lock);
+        
+        pthread_join(tid, NULL);
+        started = false;
+    }
+    
+    // the error of datagrams sent after flush.
+    if (ret == ERROR_SUCCESS && error != ERROR_SUCCESS) {
+        ret = error;
+        srs_error("udp: send failed when close. ret=%d", ret);
+    }
+    
+    ::close(fd);
+    fd = -1;
+    
+    return ret;
 }
 
-bool SrsAmf0Any::is_object()
+bool SrsTsUdpWriter::is_open()
 {
-    return marker == RTMP_AMF0_Object;
+    return fd >= 0;
 }
 
-bool SrsAmf0Any::is_ecma_array()
+void SrsTsUdpWriter::lseek(int64_t /*offset*/)
 {
-    return marker == RTMP_AMF0_EcmaArray;
+    // the stream is not seekable.
 }
 
-bool SrsAmf0Any::is_strict_array()
+int64_t SrsTsUdpWriter::tellg()
 {
-    return marker == RTMP_AMF0_StrictArray;
+    return position;
 }
 
-bool SrsAmf0Any::is_date()
+int SrsTsUdpWriter::write(void* buf, size_t count, ssize_t* pnwrite)
 {
-    return marker == RTMP_AMF0_Date;
+    iovec iov;
+    iov.iov_base = (char*)buf;
+    iov.iov_len = count;
+    
+    return writev(&iov, 1, pnwrite);
 }
 
-bool SrsAmf0Any::is_complex_object()
+int SrsTsUdpWriter::writev(iovec* iov, int iovcnt, ssize_t* pnwrite)
 {
-    return is_object() || is_object_eof() || is_ecma_array() || is_strict_array();
+    int ret = ERROR_SUCCESS;
+    
+    if (fd < 0) {
+        ret = ERROR_SOCKET_CLOSED;
+        srs_error("udp: write to socket not open. ret=%d", ret);
+        return ret;
+    }
+    
+    ssize_t nwrite = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        char* p = (char*)iov[i].iov_base;
+        int left = (int)iov[i].iov_len;
+        nwrite += left;
+        
+        // the ts packet may be written in some iovs, for instance, the header and payload.
+        while (left > 0) {
+            int nb_copy = srs_min(left, SRS_TS_PACKET_SIZE - nb_packet);
+            memcpy(packet + nb_packet, p, nb_copy);
+            nb_packet += nb_copy;
+            p += nb_copy;
+            left -= nb_copy;
+            
+            if (nb_packet == SRS_TS_PACKET_SIZE) {
+                nb_packet = 0;
+                if ((ret = on_packet(packet)) != ERROR_SUCCESS) {
+                    return ret;
+                }
+            }
+        }
+    }
+    position += nwrite;
+    
+    if (pnwrite) {
+        *pnwrite = nwrite;
+    }
+    
+    return ret;
 }
 
-string SrsAmf0Any::to_str()
+int SrsTsUdpWriter::flush()
 {
-    SrsAmf0String* p = dynamic_cast<SrsAmf0String*>(this);
-    srs_assert(p != NULL);
-    return p->value;
+    if (current && current->size > 0) {
+        return submit();
+    }
+    
+    return ERROR_SUCCESS;
 }
 
-const char* SrsAmf0Any::to_str_raw()
+void SrsTsUdpWriter::set_ttl(int v)
 {
-    SrsAmf0String* p = dynamic_cast<SrsAmf0String*>(this);
-    srs_assert(p != NULL);
-    return p->value.data();
+    ttl = srs_max(1, srs_min(255, v));
 }
 
-bool SrsAmf0Any::to_boolean()
+void SrsTsUdpWriter::set_bitrate(int64_t v)
 {
-    SrsAmf0Boolean* p = dynamic_cast<SrsAmf0Boolean*>(this);
-    srs_assert(p != NULL);
-    return p->value;
+    bitrate = srs_max(0, v);
 }
 
-double SrsAmf0Any::to_number()
+int SrsTsUdpWriter::on_packet(char* pkt)
 {
-    SrsAmf0Number* p = dynamic_cast<SrsAmf0Number*>(this);
-    srs_assert(p != NULL);
-    return p->value;
+    int ret = ERROR_SUCCESS;
+    
+    // the stream is delayed from the first packet.
+    if (base_time < 0) {
+        base_time = last_time = srs_udp_now_us() + SRS_PERF_TS_UDP_DELAY * 1000;
+        base_packets = nb_packets;
+    }
+    
+    u_int8_t* p = (u_int8_t*)pkt;
+    int pid = ((p[1] & 0x1f) << 8) | p[2];
+    if (pid == SrsTsPidPAT || pid == pmt_pid) {
+        on_psi(p, pid);
+    }
+    
+    // the adaptation field with PCR, @see SrsTsAdaptationField::decode
+    // ignore the PCR of other programs, or any PCR when no PMT.
+    if ((p[3] & 0x20) == 0 || p[4] < 7 || (p[5] & 0x10) == 0 || (pcr_pid >= 0 && pid != pcr_pid)) {
+        return append(pkt, time_of(nb_packets));
+    }
+    
+    int64_t pcr = ((int64_t)p[6] << 25) | ((int64_t)p[7] << 17) | ((int64_t)p[8] << 9) | ((int64_t)p[9] << 1) | (p[10] >> 7);
+    
+    // continue the pacing from current packet.
+    if (base_pcr < 0 || pcr < last_pcr || pcr - last_pcr > SRS_TS_UDP_PCR_JUMP) {
+        if (base_pcr >= 0) {
+            srs_warn("udp: ts PCR discontinuity %"PRId64"=>%"PRId64, last_pcr, pcr);
+        }
+        rebase(time_of(nb_packets), pcr);
+    }
+    last_pcr = pcr;
+    
+    // stuff the null packets, to send the PCR packet at its position of bitrate.
+    if (bitrate > 0) {
+        int64_t target = base_packets + (pcr - base_pcr) * bitrate / (90000LL * SRS_TS_PACKET_SIZE * 8);
+        if (target < nb_packets) {
+            srs_warn("udp: ts exceed bitrate %"PRId64", %d packets", bitrate, (int)(nb_packets - target));
+            rebase(time_of(nb_packets), pcr);
+        }
+        
+        if (nb_packets < target) {
+            char null_pkt[SRS_TS_PACKET_SIZE];
+            null_pkt[0] = 0x47;
+            null_pkt[1] = 0x1f;
+            null_pkt[2] = (char)0xff;
+            null_pkt[3] = 0x10;
+            memset(null_pkt + 4, 0xff, SRS_TS_PACKET_SIZE - 4);
+            
+            while (nb_packets < target) {
+                if ((ret = append(null_pkt, time_of(nb_packets))) != ERROR_SUCCESS) {
+                    return ret;
+                }
+            }
+        }
+    }
+    
+    int64_t deadline = time_of(nb_packets);
+    if (bitrate <= 0) {
+        deadline = base_time + (pcr - base_pcr) * 100 / 9;
+    }
+    
+    // the source is late over the delay, restart the delay.
+    int64_t now = srs_udp_now_us();
+    if (deadline < now) {
+        srs_warn("udp: ts late %d ms, pcr=%"PRId64, (int)((now - deadline) / 1000), pcr);
+        deadline = now + SRS_PERF_TS_UDP_DELAY * 1000;
+        rebase(deadline, pcr);
+    }
+    last_time = deadline;
+    
+    return append(pkt, deadline);
 }
 
-int64_t SrsAmf0Any::to_date()
+void SrsTsUdpWriter::on_psi(u_int8_t* p, int pid)
 {
-    SrsAmf0Date* p = dynamic_cast<SrsAmf0Date*>(this);
-    srs_assert(p != NULL);
-    return p->date();
+    // the section starts in the packet, without adaptation field.
+    if ((p[1] & 0x40) == 0 || (p[3] & 0x30) != 0x10 || p[4] > SRS_TS_PACKET_SIZE - 5 - 12) {
+        return;
+    }
+    
+    u_int8_t* section = p + 5 + p[4];
+    int section_length = ((section[1] & 0x0f) << 8) | section[2];
+    u_int8_t* end = srs_min(section + 3 + section_length - 4, p + SRS_TS_PACKET_SIZE);
+    
+    if (pid != SrsTsPidPAT) {
+        pcr_pid = ((section[8] & 0x1f) << 8) | section[9];
+        return;
+    }
+    
+    // the first program, ignore the network pid of program 0.
+    for (u_int8_t* q = section + 8; q + 4 <= end; q += 4) {
+        int number = (q[0] << 8) | q[1];
+        if (number != 0) {
+            pmt_pid = ((q[2] & 0x1f) << 8) | q[3];
+            break;
+        }
+    }
 }
 
-int16_t SrsAmf0Any::to_date_time_zone()
+int SrsTsUdpWriter::append(char* pkt, int64_t deadline)
 {
-    SrsAmf0Date* p = dynamic_cast<SrsAmf0Date*>(this);
-    srs_assert(p != NULL);
-    return p->time_zone();
+    if (!current) {
+        pthread_mutex_lock(&lock);
+        if (!free_datagrams.empty()) {
+            current = free_datagrams.back();
+            free_datagrams.pop_back();
+        }
+        pthread_mutex_unlock(&lock);
+    }
+    if (!current) {
+        current = new SrsTsDatagram();
+        current->size = 0;
+    }
+    
+    memcpy(current->data + current->size, pkt, SRS_TS_PACKET_SIZE);
+    current->size += SRS_TS_PACKET_SIZE;
+    current->deadline = deadline;
+    nb_packets++;
+    
+    if (current->size == (int)sizeof(current->data)) {
+        return submit();
+    }
+    
+    return ERROR_SUCCESS;
 }
 
-SrsAmf0Object* SrsAmf0Any::to_object()
+int64_t SrsTsUdpWriter::time_of(int64_t n)
 {
-    SrsAmf0Object* p = dynamic_cast<SrsAmf0Object*>(this);
-    srs_assert(p != NULL);
-    return p;
+    // the packets between PCRs are sent with the last PCR.
+    if (bitrate <= 0) {
+        return last_time;
+    }
+    
+    double us = (double)(n - base_packets) * SRS_TS_PACKET_SIZE * 8 * 1000000 / bitrate;
+    return base_time + (int64_t)us;
 }
 
-SrsAmf0EcmaArray* SrsAmf0Any::to_ecma_array()
+void SrsTsUdpWriter::rebase(int64_t time, int64_t pcr)
 {
-    SrsAmf0EcmaArray* p = dynamic_cast<SrsAmf0EcmaArray*>(this);
-    srs_assert(p != NULL);
-    return p;
+    base_time = last_time = time;
+    base_packets = nb_packets;
+    base_pcr = pcr;
 }
 
-SrsAmf0StrictArray* SrsAmf0Any::to_strict_array()
+int SrsTsUdpWriter::submit()
 {
-    SrsAmf0StrictArray* p = dynamic_cast<SrsAmf0StrictArray*>(this);
-    srs_assert(p != NULL);
-    return p;
+    int ret = ERROR_SUCCESS;
+    
+    pthread_mutex_lock(&lock);
+    
+    // backpressure, for the source is faster than realtime.
+    while (error == ERROR_SUCCESS && (int)datagrams.size() >= SRS_PERF_TS_UDP_INFLIGHT) {
+        pthread_cond_wait(&cond, &lock);
+    }
+    
+    if ((ret = error) == ERROR_SUCCESS) {
+        datagrams.push_back(current);
+        current = NULL;
+        pthread_cond_broadcast(&cond);
+    }
+    
+    pthread_mutex_unlock(&lock);
+    
+    if (ret != ERROR_SUCCESS) {
+        srs_error("udp: send failed. ret=%d", ret);
+    }
+    
+    return ret;
 }
 
-void SrsAmf0Any::set_number(double value)
+void* SrsTsUdpWriter::worker(void* arg)
 {
-    SrsAmf0Number* p = dynamic_cast<SrsAmf0Number*>(this);
-    srs_assert(p != NULL);
-    p->value = value;
+    SrsTsUdpWriter* writer = (SrsTsUdpWriter*)arg;
+    writer->cycle();
+    return NULL;
 }
 
-bool SrsAmf0Any::is_object_eof()
+void SrsTsUdpWriter::cycle()
 {
-    return marker == RTMP_AMF0_ObjectEnd;
+    SrsTsDatagram* dgs[SRS_PERF_TS_UDP_BATCH];
+    
+    pthread_mutex_lock(&lock);
+    
+    for (;;) {
+        if (datagrams.empty()) {
+            if (quit) {
+                break;
+            }
+            pthread_cond_wait(&cond, &lock);
+            continue;
+        }
+        
+        // drop the datagrams when send failed.
+        bool failed = error != ERROR_SUCCESS;
+        
+        int64_t now = srs_udp_now_us();
+        int64_t wait = datagrams.front()->deadline - now;
+        if (!failed && wait > 0) {
+            srs_udp_timedwait(&cond, &lock, wait);
+            continue;
+        }
+        
+        int nb_dgs = 0;
+        while (nb_dgs < SRS_PERF_TS_UDP_BATCH && !datagrams.empty()
+            && (failed || datagrams.front()->deadline <= now)
+        ) {
+            dgs[nb_dgs++] = datagrams.front();
+            datagrams.pop_front();
+        }
+        
+        pthread_mutex_unlock(&lock);
+        
+        int ret = ERROR_SUCCESS;
+        if (!failed) {
+            ret = send(dgs, nb_dgs);
+        }
+        
+        pthread_mutex_lock(&lock);
+        
+        if (ret != ERROR_SUCCESS) {
+            error = ret;
+        }
+        
+        for (int i = 0; i < nb_dgs; i++) {
+            dgs[i]->size = 0;
+            free_datagrams.push_back(dgs[i]);
+        }
+        
+        pthread_cond_broadcast(&cond);
+    }
+    
+    pthread_mutex_unlock(&lock);
 }
 
-void srs_fill_level_spaces(stringstream& ss, int level)
+int SrsTsUdpWriter::send(SrsTsDatagram** dgs, int nb_dgs)
 {
-    for (int i = 0; i < level; i++) {
-        ss << "    ";
+    int ret = ERROR_SUCCESS;
+    
+#ifdef __linux__
+    mmsghdr msgs[SRS_PERF_TS_UDP_BATCH];
+    iovec iovs[SRS_PERF_TS_UDP_BATCH];
+    memset(msgs, 0, sizeof(mmsghdr) * nb_dgs);
+    
+    for (int i = 0; i < nb_dgs; i++) {
+        iovs[i].iov_base = dgs[i]->data;
+        iovs[i].iov_len = dgs[i]->size;
+        msgs[i].msg_hdr.msg_name = &addr;
+        msgs[i].msg_hdr.msg_namelen = sizeof(addr);
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
     }
-}
-void srs_amf0_do_print(SrsAmf0Any* any, stringstream& ss, int level)
-{
-    if (any->is_boolean()) {
-        ss << "Boolean " << (any->to_boolean()? "true":"false") << endl;
-    } else if (any->is_number()) {
-        ss << "Number " << std::fixed << any->to_number() << endl;
+    
+    int nb_sent = 0;
+    int err = 0;
+    while (nb_sent < nb_dgs) {
+        int r0 = ::sendmmsg(fd, msgs + nb_sent, nb_dgs - nb_sent, 0);
+        if (r0 < 0 && errno == EINTR) {
+            continue;
+        }
+        if (r0 < 0) {
+            err = errno;
+            break;
+        }
+        // no datagram sent without error, the errno is stale, drop the left.
+        if (r0 == 0) {
+            srs_warn("udp: drop %d datagrams, none sent", nb_dgs - nb_sent);
+            return ret;
+        }
+        nb_sent += r0;
+    }
+#else
+    int nb_sent = 0;
+    int err = 0;
+    while (nb_sent < nb_dgs) {
+        ssize_t r0 = ::sendto(fd, dgs[nb_sent]->data, dgs[nb_sent]->size, 0, (sockaddr*)&addr, sizeof(addr));
+        if (r0 < 0 && errno == EINTR) {
+            continue;
+        }
+        if (r0 < 0) {
+            err = errno;
+            break;
+        }
+        nb_sent++;
+    }
+#endif
+    
+    if (nb_sent == nb_dgs) {
+        return ret;
+    }
+    
+    // the udp is lossy, drop the datagrams when no buffer or no peer.
+    if (err == EAGAIN || err == ENOBUFS || err == ECONNREFUSED) {
+        srs_warn("udp: drop %d datagrams, errno=%d", nb_dgs - nb_sent, err);
+        return ret;
+    }
+    
+    ret = ERROR_SOCKET_WRITE;
+    srs_error("udp: send datagrams failed, errno=%d. ret=%d", err, ret);
+    
+    return ret;
+}
+
+#endif
+
+// following is generated by src/kernel/srs_kernel_hls.cpp
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2015 SRS(ossrs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//#include <srs_kernel_hls.hpp>
+
+#if !defined(SRS_EXPORT_LIBRTMP)
+
+#include <stdio.h>
+#include <unistd.h>
+#include <math.h>
+#include <sstream>
+using namespace std;
+
+//#include <srs_kernel_log.hpp>
+//#include <srs_kernel_error.hpp>
+//#include <srs_kernel_file.hpp>
+//#include <srs_kernel_codec.hpp>
+//#include <srs_kernel_consts.hpp>
+//#include <srs_kernel_ts.hpp>
+//#include <srs_kernel_utility.hpp>
+
+SrsHlsSegment::SrsHlsSegment()
+{
+    duration = 0;
+    sequence_no = 0;
+    segment_start_dts = 0;
+}
+
+SrsHlsSegment::~SrsHlsSegment()
+{
+}
+
+void SrsHlsSegment::update_duration(int64_t current_frame_dts)
+{
+    // we use dts to calc the duration,
+    // for the frame of previous segment may be later than the first one.
+    if (current_frame_dts < segment_start_dts) {
+        return;
+    }
+    
+    duration = (current_frame_dts - segment_start_dts) / 90000.0;
+}
+
+SrsHlsSegmentWriter::SrsHlsSegmentWriter()
+{
+    part = new SrsFileWriter();
+}
+
+SrsHlsSegmentWriter::~SrsHlsSegmentWriter()
+{
+    srs_freep(part);
+}
+
+int SrsHlsSegmentWriter::open_part(string p)
+{
+    return part->open(p);
+}
+
+int SrsHlsSegmentWriter::close_part()
+{
+    return part->close();
+}
+
+void SrsHlsSegmentWriter::set_sync(SrsFileSync v)
+{
+    SrsFileWriter::set_sync(v);
+    part->set_sync(v);
+}
+
+int SrsHlsSegmentWriter::writev(iovec* iov, int iovcnt, ssize_t* pnwrite)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if ((ret = SrsFileWriter::writev(iov, iovcnt, pnwrite)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    if (part->is_open() && (ret = part->writev(iov, iovcnt, NULL)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    return ret;
+}
+
+SrsHlsEncoder::SrsHlsEncoder()
+{
+    hls_fragment = 0;
+    hls_window = 0;
+    hls_cleanup = false;
+    hls_part = 0;
+    hls_sync = false;
+    
+    sequence_no = 0;
+    target_duration = 0;
+    has_video = false;
+    current = NULL;
+    part_opened = false;
+    part_independent = false;
+    part_start_dts = 0;
+    part_last_dts = 0;
+    part_interval = 0;
+    
+    writer = new SrsHlsSegmentWriter();
+    codec = new SrsAvcAacCodec();
+    sample = new SrsCodecSample();
+    cache = new SrsTsCache();
+    context = new SrsTsContext();
+    muxer = new SrsTSMuxer(writer, context, SrsCodecAudioAAC, SrsCodecVideoAVC);
+}
+
+SrsHlsEncoder::~SrsHlsEncoder()
+{
+    std::vector<SrsHlsSegment*>::iterator it;
+    for (it = segments.begin(); it != segments.end(); ++it) {
+        SrsHlsSegment* segment = *it;
+        srs_freep(segment);
+    }
+    segments.clear();
+    
+    srs_freep(current);
+    srs_freep(muxer);
+    srs_freep(writer);
+    srs_freep(codec);
+    srs_freep(sample);
+    srs_freep(cache);
+    srs_freep(context);
+}
+
+int SrsHlsEncoder::initialize(string m3u8_file, int fragment_ms, int window_ms, bool cleanup)
+{
+    int ret = ERROR_SUCCESS;
+    
+    m3u8 = m3u8_file;
+    
+    // the segments in the dir of m3u8, named by the m3u8 without ext.
+    size_t pos = string::npos;
+    if ((pos = m3u8.rfind("/")) != string::npos) {
+        ts_dir = m3u8.substr(0, pos + 1);
+    }
+    ts_prefix = m3u8.substr(ts_dir.length());
+    if ((pos = ts_prefix.rfind(".")) != string::npos) {
+        ts_prefix = ts_prefix.substr(0, pos);
+    }
+    
+    hls_fragment = srs_max(0, fragment_ms) / 1000.0;
+    hls_window = srs_max(0, window_ms) / 1000.0;
+    hls_cleanup = cleanup;
+    target_duration = srs_max(1, (int)ceil(hls_fragment * SRS_HLS_TD_RATIO));
+    
+    delta_m3u8 = ts_dir + ts_prefix + "_delta.m3u8";
+    
+    return ret;
+}
+
+int SrsHlsEncoder::set_part(int part_ms)
+{
+    int ret = ERROR_SUCCESS;
+    
+    // the segment written is not in parts.
+    if (current || !segments.empty()) {
+        ret = ERROR_HLS_PART_AFTER_WRITE;
+        srs_error("hls: set part after frame written. ret=%d", ret);
+        return ret;
+    }
+    
+    hls_part = srs_max(0, part_ms) / 1000.0;
+    
+    return ret;
+}
+
+void SrsHlsEncoder::set_sync(bool v)
+{
+    hls_sync = v;
+    writer->set_sync(v? SrsFileSyncClose : SrsFileSyncNone);
+}
+
+bool SrsHlsEncoder::is_ready(int msn, int part)
+{
+    // the reaped segments.
+    int next = current? current->sequence_no : sequence_no;
+    if (msn < next) {
+        return true;
+    }
+    
+    // the parts of current segment.
+    if (current && msn == current->sequence_no && part >= 0) {
+        return part < (int)current->parts.size();
+    }
+    
+    return false;
+}
+
+int SrsHlsEncoder::write_audio(int64_t timestamp, char* data, int size)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(data);
+    
+    sample->clear();
+    if ((ret = codec->audio_aac_demux(data, size, sample)) != ERROR_SUCCESS) {
+        if (ret != ERROR_HLS_TRY_MP3) {
+            srs_error("hls: aac demux audio failed. ret=%d", ret);
+            return ret;
+        }
+        if ((ret = codec->audio_mp3_demux(data, size, sample)) != ERROR_SUCCESS) {
+            srs_error("hls: mp3 demux audio failed. ret=%d", ret);
+            return ret;
+        }
+    }
+    SrsCodecAudio acodec = (SrsCodecAudio)codec->audio_codec_id;
+    
+    // ts support audio codec: aac/mp3
+    if (acodec != SrsCodecAudioAAC && acodec != SrsCodecAudioMP3) {
+        return ret;
+    }
+    
+    // when codec changed, write new header.
+    if ((ret = muxer->update_acodec(acodec)) != ERROR_SUCCESS) {
+        srs_error("hls: audio write header failed. ret=%d", ret);
+        return ret;
+    }
+    
+    // for aac: ignore sequence header
+    if (acodec == SrsCodecAudioAAC && sample->aac_packet_type == SrsCodecAudioTypeSequenceHeader) {
+        return ret;
+    }
+    
+    int64_t dts = timestamp * 90;
+    
+    // for pure audio, reap the segment at any frame,
+    // and always reap when reach the target duration.
+    if (current) {
+        current->update_duration(dts);
+        if ((!has_video && current->duration >= hls_fragment) || current->duration >= target_duration) {
+            if ((ret = segment_close(false)) != ERROR_SUCCESS) {
+                return ret;
+            }
+        }
+    }
+    
+    if (!current && (ret = segment_open(dts)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    current->update_duration(dts);
+    
+    // the audio is always independent for the pure audio.
+    if ((ret = part_update(dts, !has_video)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // write audio to cache.
+    if ((ret = cache->cache_audio(codec, dts, sample)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    return flush_audio();
+}
+
+int SrsHlsEncoder::write_video(int64_t timestamp, char* data, int size)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(data);
+    
+    sample->clear();
+    if ((ret = codec->video_avc_demux(data, size, sample)) != ERROR_SUCCESS) {
+        srs_error("hls: codec demux video failed. ret=%d", ret);
+        return ret;
+    }
+    
+    // ignore info frame,
+    // @see https://github.com/ossrs/srs/issues/288#issuecomment-69863909
+    if (sample->frame_type == SrsCodecVideoAVCFrameVideoInfoFrame) {
+        return ret;
+    }
+    
+    if (codec->video_codec_id != SrsCodecVideoAVC && codec->video_codec_id != SrsCodecVideoHEVC) {
+        return ret;
+    }
+    
+    // when codec changed, write new header.
+    if ((ret = muxer->update_vcodec((SrsCodecVideo)codec->video_codec_id)) != ERROR_SUCCESS) {
+        srs_error("hls: video write header failed. ret=%d", ret);
+        return ret;
+    }
+    
+    // ignore sequence header
+    if (sample->frame_type == SrsCodecVideoAVCFrameKeyFrame
+         && sample->avc_packet_type == SrsCodecVideoAVCTypeSequenceHeader) {
+        return ret;
+    }
+    has_video = true;
+    
+    int64_t dts = timestamp * 90;
+    
+    // reap the segment at keyframe, so each segment starts with keyframe,
+    // while the segment without keyframe is reaped at the target duration.
+    if (current) {
+        bool keyframe = sample->frame_type == SrsCodecVideoAVCFrameKeyFrame;
+        current->update_duration(dts);
+        if ((keyframe && current->duration >= hls_fragment) || current->duration >= target_duration) {
+            if ((ret = segment_close(false)) != ERROR_SUCCESS) {
+                return ret;
+            }
+        }
+    }
+    
+    if (!current && (ret = segment_open(dts)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    current->update_duration(dts);
+    
+    if ((ret = part_update(dts, sample->frame_type == SrsCodecVideoAVCFrameKeyFrame)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // write video to cache.
+    if ((ret = cache->cache_video(codec, dts, sample)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    return flush_video();
+}
+
+int SrsHlsEncoder::close()
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (current) {
+        return segment_close(true);
+    }
+    
+    if (!segments.empty()) {
+        return refresh_m3u8(true);
+    }
+    
+    return ret;
+}
+
+int SrsHlsEncoder::segment_open(int64_t segment_start_dts)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(!current);
+    
+    current = new SrsHlsSegment();
+    current->sequence_no = sequence_no++;
+    current->segment_start_dts = segment_start_dts;
+    
+    std::stringstream ss;
+    ss << ts_prefix << "-" << current->sequence_no << ".ts";
+    current->uri = ss.str();
+    current->full_path = ts_dir + current->uri;
+    
+    // open the tmp file, the PSI is written when the first frame written.
+    std::string tmp_file = current->full_path + ".tmp";
+    if ((ret = muxer->open(tmp_file)) != ERROR_SUCCESS) {
+        srs_error("hls: open segment %s failed. ret=%d", tmp_file.c_str(), ret);
+        return ret;
+    }
+    srs_info("hls: open segment %s, seq=%d", tmp_file.c_str(), current->sequence_no);
+    
+    return ret;
+}
+
+int SrsHlsEncoder::segment_close(bool end)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(current);
+    
+    // the last part is the left of segment.
+    if (part_opened) {
+        double duration = current->duration;
+        std::vector<SrsHlsPart>::iterator it;
+        for (it = current->parts.begin(); it != current->parts.end(); ++it) {
+            duration -= it->duration;
+        }
+        if ((ret = part_close(srs_max(0, duration))) != ERROR_SUCCESS) {
+            return ret;
+        }
+    }
+    
+    SrsHlsSegment* segment = current;
+    current = NULL;
+    
+    // the ts must be flushed to disk before rename, or the player gets a partial ts.
+    std::string tmp_file = segment->full_path + ".tmp";
+    if ((ret = muxer->close()) != ERROR_SUCCESS) {
+        srs_error("hls: close segment %s failed. ret=%d", tmp_file.c_str(), ret);
+        segment_discard(segment);
+        return ret;
+    }
+    if (::rename(tmp_file.c_str(), segment->full_path.c_str()) < 0) {
+        ret = ERROR_SYSTEM_FILE_RENAME;
+        srs_error("hls: rename %s to %s failed. ret=%d", tmp_file.c_str(), segment->full_path.c_str(), ret);
+        segment_discard(segment);
+        return ret;
+    }
+    srs_info("hls: reap segment %s, duration=%.3f", segment->full_path.c_str(), segment->duration);
+    
+    segments.push_back(segment);
+    
+    // shrink the segments out of window, but keep the newest.
+    int remove_index = -1;
+    double duration = 0;
+    for (int i = (int)segments.size() - 1; i >= 0; i--) {
+        duration += segments[i]->duration;
+        if (duration > hls_window) {
+            remove_index = i;
+            break;
+        }
+    }
+    
+    std::vector<SrsHlsSegment*> expired;
+    for (int i = 0; i < remove_index && !segments.empty(); i++) {
+        expired.push_back(segments[0]);
+        segments.erase(segments.begin());
+    }
+    
+    // refresh the m3u8 before remove the ts, for the player may reading it.
+    ret = refresh_m3u8(end);
+    
+    std::vector<SrsHlsSegment*>::iterator it;
+    for (it = expired.begin(); it != expired.end(); ++it) {
+        SrsHlsSegment* segment = *it;
+        if (hls_cleanup && ::unlink(segment->full_path.c_str()) < 0) {
+            srs_warn("hls: cleanup segment %s failed.", segment->full_path.c_str());
+        }
+        for (int i = 0; hls_cleanup && i < (int)segment->parts.size(); i++) {
+            std::string part_file = ts_dir + segment->parts[i].uri;
+            if (::unlink(part_file.c_str()) < 0) {
+                srs_warn("hls: cleanup part %s failed.", part_file.c_str());
+            }
+        }
+        srs_freep(segment);
+    }
+    
+    return ret;
+}
+
+void SrsHlsEncoder::segment_discard(SrsHlsSegment* segment)
+{
+    int ret = ERROR_SUCCESS;
+    
+    std::string tmp_file = segment->full_path + ".tmp";
+    if (::unlink(tmp_file.c_str()) < 0) {
+        srs_warn("hls: remove segment %s failed.", tmp_file.c_str());
+    }
+    
+    // the parts are listed in m3u8, refresh it without them before remove.
+    std::vector<SrsHlsPart> parts = segment->parts;
+    srs_freep(segment);
+    
+    if (!parts.empty() && (ret = refresh_m3u8(false)) != ERROR_SUCCESS) {
+        srs_warn("hls: refresh m3u8 without the discarded parts failed. ret=%d", ret);
+    }
+    
+    std::vector<SrsHlsPart>::iterator it;
+    for (it = parts.begin(); it != parts.end(); ++it) {
+        std::string part_file = ts_dir + it->uri;
+        if (::unlink(part_file.c_str()) < 0) {
+            srs_warn("hls: remove part %s failed.", part_file.c_str());
+        }
+    }
+}
+
+int SrsHlsEncoder::refresh_m3u8(bool end)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (segments.empty() && (!current || current->parts.empty())) {
+        return ret;
+    }
+    
+    if ((ret = write_m3u8(m3u8, generate_m3u8(end, false))) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    if (hls_part > 0 && (ret = write_m3u8(delta_m3u8, generate_m3u8(end, true))) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    return ret;
+}
+
+string SrsHlsEncoder::generate_m3u8(bool end, bool delta)
+{
+    std::stringstream ss;
+    ss.precision(3);
+    ss.setf(std::ios::fixed, std::ios::floatfield);
+    
+    // the EXT-X-SKIP requires version 9.
+    ss << "#EXTM3U" << SRS_CONSTS_LF
+        << "#EXT-X-VERSION:" << (hls_part > 0? 9 : 3) << SRS_CONSTS_LF
+        << "#EXT-X-TARGETDURATION:" << target_duration << SRS_CONSTS_LF;
+    
+    // the skip boundary must be at least six times the target duration,
+    // and the part hold back at least twice the part target, use three.
+    double skip_until = 6.0 * target_duration;
+    if (hls_part > 0) {
+        ss << "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,CAN-SKIP-UNTIL=" << skip_until
+            << ",PART-HOLD-BACK=" << 3 * hls_part << SRS_CONSTS_LF
+            << "#EXT-X-PART-INF:PART-TARGET=" << hls_part << SRS_CONSTS_LF;
+    }
+    
+    int sequence = segments.empty()? current->sequence_no : segments[0]->sequence_no;
+    ss << "#EXT-X-MEDIA-SEQUENCE:" << sequence << SRS_CONSTS_LF;
+    
+    // the segments older than the skip boundary are skipped in delta,
+    // and the parts are removed when older than three target durations.
+    int nb_skips = 0;
+    int parts_index = (int)segments.size();
+    double duration = 0;
+    for (int i = (int)segments.size() - 1; i >= 0; i--) {
+        duration += segments[i]->duration;
+        if (duration <= 3.0 * target_duration) {
+            parts_index = i;
+        }
+        if (delta && duration > skip_until) {
+            nb_skips = i + 1;
+            break;
+        }
+    }
+    if (nb_skips > 0) {
+        ss << "#EXT-X-SKIP:SKIPPED-SEGMENTS=" << nb_skips << SRS_CONSTS_LF;
+    }
+    
+    for (int i = nb_skips; i < (int)segments.size(); i++) {
+        SrsHlsSegment* segment = segments[i];
+        if (i >= parts_index) {
+            generate_parts(ss, segment);
+        }
+        ss << "#EXTINF:" << segment->duration << "," << SRS_CONSTS_LF
+            << segment->uri << SRS_CONSTS_LF;
+    }
+    
+    // the parts of current segment, and hint the next part.
+    if (hls_part > 0 && !end) {
+        if (current) {
+            generate_parts(ss, current);
+        }
+        int index = current? (int)current->parts.size() : 0;
+        ss << "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"" << part_uri(sequence_no - (current? 1 : 0), index) << "\"" << SRS_CONSTS_LF;
+    }
+    
+    if (end) {
+        ss << "#EXT-X-ENDLIST" << SRS_CONSTS_LF;
+    }
+    
+    return ss.str();
+}
+
+void SrsHlsEncoder::generate_parts(std::stringstream& ss, SrsHlsSegment* segment)
+{
+    std::vector<SrsHlsPart>::iterator it;
+    for (it = segment->parts.begin(); it != segment->parts.end(); ++it) {
+        SrsHlsPart& part = *it;
+        ss << "#EXT-X-PART:DURATION=" << part.duration << ",URI=\"" << part.uri << "\"";
+        if (part.independent) {
+            ss << ",INDEPENDENT=YES";
+        }
+        ss << SRS_CONSTS_LF;
+    }
+}
+
+string SrsHlsEncoder::part_uri(int sequence, int index)
+{
+    std::stringstream ss;
+    ss << ts_prefix << "-" << sequence << "." << index << ".ts";
+    return ss.str();
+}
+
+int SrsHlsEncoder::write_m3u8(string path, string body)
+{
+    int ret = ERROR_SUCCESS;
+    
+    std::string tmp_file = path + ".tmp";
+    
+    if (true) {
+        SrsFileWriter fw;
+        if ((ret = fw.open(tmp_file)) != ERROR_SUCCESS) {
+            srs_error("hls: open m3u8 %s failed. ret=%d", tmp_file.c_str(), ret);
+            return ret;
+        }
+        if (hls_sync) {
+            fw.set_sync(SrsFileSyncClose);
+        }
+        if ((ret = fw.write((void*)body.data(), body.length(), NULL)) != ERROR_SUCCESS) {
+            srs_error("hls: write m3u8 %s failed. ret=%d", tmp_file.c_str(), ret);
+            fw.close();
+            ::unlink(tmp_file.c_str());
+            return ret;
+        }
+        if ((ret = fw.close()) != ERROR_SUCCESS) {
+            srs_error("hls: close m3u8 %s failed. ret=%d", tmp_file.c_str(), ret);
+            ::unlink(tmp_file.c_str());
+            return ret;
+        }
+    }
+    
+    if (::rename(tmp_file.c_str(), path.c_str()) < 0) {
+        ret = ERROR_SYSTEM_FILE_RENAME;
+        srs_error("hls: rename %s to %s failed. ret=%d", tmp_file.c_str(), path.c_str(), ret);
+        ::unlink(tmp_file.c_str());
+        return ret;
+    }
+    
+    return ret;
+}
+
+int SrsHlsEncoder::part_update(int64_t dts, bool independent)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (hls_part <= 0) {
+        return ret;
+    }
+    
+    // reap the part before the frame, when the part with the frame,
+    // about the max interval of frames, will exceed the part target.
+    if (part_opened) {
+        if (dts > part_last_dts) {
+            part_interval = srs_max(part_interval, dts - part_last_dts);
+            part_last_dts = dts;
+        }
+        double duration = (dts - part_start_dts) / 90000.0;
+        if (duration + part_interval / 90000.0 <= hls_part) {
+            return ret;
+        }
+        if ((ret = part_close(duration)) != ERROR_SUCCESS) {
+            return ret;
+        }
+    }
+    
+    if ((ret = part_open(dts, independent)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // refresh when part reaped, or the first part of segment,
+    // to update the preload hint.
+    return refresh_m3u8(false);
+}
+
+int SrsHlsEncoder::part_open(int64_t dts, bool independent)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(current && !part_opened);
+    
+    std::string tmp_file = ts_dir + part_uri(current->sequence_no, (int)current->parts.size()) + ".tmp";
+    if ((ret = writer->open_part(tmp_file)) != ERROR_SUCCESS) {
+        srs_error("hls: open part %s failed. ret=%d", tmp_file.c_str(), ret);
+        return ret;
+    }
+    
+    // write the PSI for the player to start at the independent part.
+    if (independent && !current->parts.empty()) {
+        context->reset();
+    }
+    
+    part_opened = true;
+    part_independent = independent;
+    part_start_dts = part_last_dts = dts;
+    part_interval = 0;
+    
+    return ret;
+}
+
+int SrsHlsEncoder::part_close(double duration)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(current && part_opened);
+    
+    part_opened = false;
+    
+    SrsHlsPart part;
+    part.duration = duration;
+    part.uri = part_uri(current->sequence_no, (int)current->parts.size());
+    part.independent = part_independent;
+    
+    // the part must be flushed to disk before rename, or the player gets a partial ts.
+    std::string part_file = ts_dir + part.uri;
+    std::string tmp_file = part_file + ".tmp";
+    if ((ret = writer->close_part()) != ERROR_SUCCESS) {
+        srs_error("hls: close part %s failed. ret=%d", tmp_file.c_str(), ret);
+        ::unlink(tmp_file.c_str());
+        return ret;
+    }
+    if (::rename(tmp_file.c_str(), part_file.c_str()) < 0) {
+        ret = ERROR_SYSTEM_FILE_RENAME;
+        srs_error("hls: rename %s to %s failed. ret=%d", tmp_file.c_str(), part_file.c_str(), ret);
+        ::unlink(tmp_file.c_str());
+        return ret;
+    }
+    current->parts.push_back(part);
+    
+    return ret;
+}
+
+int SrsHlsEncoder::flush_audio()
+{
+    int ret = ERROR_SUCCESS;
+    
+    if ((ret = muxer->write_audio(cache->audio)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // write success, clear and free the ts message.
+    srs_freep(cache->audio);
+    
+    return ret;
+}
+
+int SrsHlsEncoder::flush_video()
+{
+    int ret = ERROR_SUCCESS;
+    
+    if ((ret = muxer->write_video(cache->video)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // write success, clear and free the ts message.
+    srs_freep(cache->video);
+    
+    return ret;
+}
+
+#endif
+
+// following is generated by src/kernel/srs_kernel_mp4.cpp
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2015 SRS(ossrs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+//#include <srs_kernel_mp4.hpp>
+
+#if !defined(SRS_EXPORT_LIBRTMP)
+
+#include <string.h>
+using namespace std;
+
+//#include <srs_kernel_log.hpp>
+//#include <srs_kernel_error.hpp>
+//#include <srs_kernel_file.hpp>
+//#include <srs_kernel_buffer.hpp>
+//#include <srs_kernel_codec.hpp>
+//#include <srs_kernel_utility.hpp>
+
+// the timescale of tracks, the flv timestamp in ms.
+#define SRS_MP4_TIMESCALE 1000
+// the samples of each aac frame.
+#define SRS_MP4_AAC_FRAME_SAMPLES 1024
+
+// the sample flags of trun, ISO_IEC_14496-12-base-format-2012.pdf, page 45.
+#define SRS_MP4_SAMPLE_SYNC 0x02000000
+#define SRS_MP4_SAMPLE_NON_SYNC 0x01010000
+
+/**
+* write the integer in big-endian to buffer.
+*/
+void srs_mp4_write_u8(SrsSimpleBuffer* buf, u_int8_t v)
+{
+    buf->append((char*)&v, 1);
+}
+
+void srs_mp4_write_u16(SrsSimpleBuffer* buf, u_int16_t v)
+{
+    char b[2] = { (char)(v >> 8), (char)v };
+    buf->append(b, 2);
+}
+
+void srs_mp4_write_u32(SrsSimpleBuffer* buf, u_int32_t v)
+{
+    char b[4] = { (char)(v >> 24), (char)(v >> 16), (char)(v >> 8), (char)v };
+    buf->append(b, 4);
+}
+
+void srs_mp4_write_u64(SrsSimpleBuffer* buf, u_int64_t v)
+{
+    srs_mp4_write_u32(buf, (u_int32_t)(v >> 32));
+    srs_mp4_write_u32(buf, (u_int32_t)v);
+}
+
+/**
+* append the chunk, merge with the last one when the bytes are continuous.
+*/
+void srs_mp4_append_chunk(std::vector<SrsMp4Chunk>& chunks, char* bytes, int size)
+{
+    if (!chunks.empty()) {
+        SrsMp4Chunk& last = chunks.back();
+        if ((!bytes && !last.bytes) || (bytes && last.bytes && last.bytes + last.size == bytes)) {
+            last.size += size;
+            return;
+        }
+    }
+    
+    SrsMp4Chunk chunk;
+    chunk.bytes = bytes;
+    chunk.size = size;
+    chunks.push_back(chunk);
+}
+
+void srs_mp4_write_zeros(SrsSimpleBuffer* buf, int size)
+{
+    for (int i = 0; i < size; i++) {
+        srs_mp4_write_u8(buf, 0);
+    }
+}
+
+/**
+* start a box, the size is patched when box end.
+* @return the start offset of box.
+*/
+int srs_mp4_box_start(SrsSimpleBuffer* buf, const char* type)
+{
+    int start = buf->length();
+    srs_mp4_write_u32(buf, 0);
+    buf->append(type, 4);
+    return start;
+}
+
+int srs_mp4_full_box_start(SrsSimpleBuffer* buf, const char* type, u_int8_t version, u_int32_t flags)
+{
+    int start = srs_mp4_box_start(buf, type);
+    srs_mp4_write_u32(buf, ((u_int32_t)version << 24) | (flags & 0xffffff));
+    return start;
+}
+
+void srs_mp4_patch_u32(SrsSimpleBuffer* buf, int pos, u_int32_t v)
+{
+    char* p = buf->bytes() + pos;
+    p[0] = (char)(v >> 24);
+    p[1] = (char)(v >> 16);
+    p[2] = (char)(v >> 8);
+    p[3] = (char)v;
+}
+
+void srs_mp4_box_end(SrsSimpleBuffer* buf, int start)
+{
+    srs_mp4_patch_u32(buf, start, (u_int32_t)(buf->length() - start));
+}
+
+/**
+* the unity matrix of mvhd and tkhd.
+*/
+void srs_mp4_write_matrix(SrsSimpleBuffer* buf)
+{
+    u_int32_t matrix[] = { 0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000 };
+    for (int i = 0; i < 9; i++) {
+        srs_mp4_write_u32(buf, matrix[i]);
+    }
+}
+
+SrsMp4Encoder::SrsMp4Encoder()
+{
+    writer = NULL;
+    codec = new SrsAvcAacCodec();
+    sample = new SrsCodecSample();
+    fragment_duration = 0;
+    got_init = has_video = has_audio = false;
+    sequence_number = 0;
+    video_mdat = new SrsSimpleBuffer();
+    fragment_start = 0;
+    video_duration = audio_duration = 0;
+}
+
+SrsMp4Encoder::~SrsMp4Encoder()
+{
+    srs_freep(codec);
+    srs_freep(sample);
+    srs_freep(video_mdat);
+    
+    std::vector<char*>::iterator it;
+    for (it = packets.begin(); it != packets.end(); ++it) {
+        char* packet = *it;
+        srs_freepa(packet);
+    }
+    packets.clear();
+}
+
+int SrsMp4Encoder::initialize(SrsFileWriter* fw, int fragment_ms)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(fw);
+    
+    if (!fw->is_open()) {
+        ret = ERROR_KERNEL_MP4_STREAM_CLOSED;
+        srs_warn("stream is not open for encoder. ret=%d", ret);
+        return ret;
+    }
+    
+    writer = fw;
+    fragment_duration = srs_max(0, fragment_ms);
+    
+    return ret;
+}
+
+int SrsMp4Encoder::write_audio(int64_t timestamp, char* data, int size)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(data);
+    
+    bool referenced = false;
+    ret = do_write_audio(timestamp, data, size, &referenced);
+    
+    if (referenced) {
+        packets.push_back(data);
+    } else {
+        srs_freepa(data);
+    }
+    
+    return ret;
+}
+
+int SrsMp4Encoder::write_video(int64_t timestamp, char* data, int size)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(data);
+    
+    bool referenced = false;
+    ret = do_write_video(timestamp, data, size, &referenced);
+    
+    if (referenced) {
+        packets.push_back(data);
+    } else {
+        srs_freepa(data);
+    }
+    
+    return ret;
+}
+
+int SrsMp4Encoder::flush()
+{
+    if (videos.empty() && audios.empty()) {
+        return ERROR_SUCCESS;
+    }
+    
+    return write_fragment(-1, -1);
+}
+
+int SrsMp4Encoder::do_write_audio(int64_t timestamp, char* data, int size, bool* preferenced)
+{
+    int ret = ERROR_SUCCESS;
+    
+    sample->clear();
+    if ((ret = codec->audio_aac_demux(data, size, sample)) != ERROR_SUCCESS) {
+        // ignore the mp3, only aac in mp4.
+        if (ret == ERROR_HLS_TRY_MP3) {
+            return ERROR_SUCCESS;
+        }
+        srs_error("mp4 aac demux audio failed. ret=%d", ret);
+        return ret;
+    }
+    
+    if (codec->audio_codec_id != SrsCodecAudioAAC) {
+        return ret;
+    }
+    
+    // the track is not in the init segment, which is written by the first fragment.
+    if (got_init && !has_audio && codec->is_aac_codec_ok()) {
+        ret = ERROR_KERNEL_MP4_TRACK_LATE;
+        srs_error("mp4 audio track not in init segment, sequence header is late. ret=%d", ret);
+        return ret;
+    }
+    
+    if (sample->aac_packet_type == SrsCodecAudioTypeSequenceHeader) {
+        return ret;
+    }
+    
+    if (!codec->is_aac_codec_ok() || sample->nb_sample_units <= 0) {
+        return ret;
+    }
+    
+    int64_t dts = timestamp & 0x7fffffff;
+    
+    // for pure audio, fragment by audio.
+    bool pure_audio = got_init? !has_video : !codec->is_avc_codec_ok();
+    if (pure_audio && !audios.empty() && dts - fragment_start >= fragment_duration) {
+        if ((ret = write_fragment(-1, dts)) != ERROR_SUCCESS) {
+            return ret;
+        }
+    }
+    
+    if (videos.empty() && audios.empty()) {
+        fragment_start = dts;
+    }
+    
+    SrsCodecSampleUnit* unit = &sample->sample_units[0];
+    
+    SrsMp4Sample s;
+    s.dts = dts;
+    s.cts = 0;
+    s.size = (u_int32_t)unit->size;
+    s.keyframe = true;
+    audios.push_back(s);
+    
+    // the raw aac frame in packet.
+    if (unit->size > 0) {
+        srs_mp4_append_chunk(audio_chunks, unit->bytes, unit->size);
+        *preferenced = true;
+    }
+    
+    return ret;
+}
+
+int SrsMp4Encoder::do_write_video(int64_t timestamp, char* data, int size, bool* preferenced)
+{
+    int ret = ERROR_SUCCESS;
+    
+    sample->clear();
+    if ((ret = codec->video_avc_demux(data, size, sample)) != ERROR_SUCCESS) {
+        srs_error("mp4 codec demux video failed. ret=%d", ret);
+        return ret;
+    }
+    
+    // ignore info frame,
+    // @see https://github.com/ossrs/srs/issues/288#issuecomment-69863909
+    if (sample->frame_type == SrsCodecVideoAVCFrameVideoInfoFrame) {
+        return ret;
+    }
+    
+    if (codec->video_codec_id != SrsCodecVideoAVC && codec->video_codec_id != SrsCodecVideoHEVC) {
+        return ret;
+    }
+    
+    // the track is not in the init segment, which is written by the first fragment.
+    if (got_init && !has_video && codec->is_avc_codec_ok()) {
+        ret = ERROR_KERNEL_MP4_TRACK_LATE;
+        srs_error("mp4 video track not in init segment, sequence header is late. ret=%d", ret);
+        return ret;
+    }
+    
+    if (sample->avc_packet_type == SrsCodecVideoAVCTypeSequenceHeader) {
+        return ret;
+    }
+    
+    if (!codec->is_avc_codec_ok()) {
+        return ret;
+    }
+    
+    // the fragment of video always starts with keyframe.
+    bool keyframe = sample->frame_type == SrsCodecVideoAVCFrameKeyFrame;
+    if (videos.empty() && !keyframe) {
+        return ret;
+    }
+    
+    int64_t dts = timestamp & 0x7fffffff;
+    
+    if (keyframe && !videos.empty() && dts - fragment_start >= fragment_duration) {
+        if ((ret = write_fragment(dts, -1)) != ERROR_SUCCESS) {
+            return ret;
+        }
+    }
+    
+    if (videos.empty() && audios.empty()) {
+        fragment_start = dts;
+    }
+    
+    SrsMp4Sample s;
+    s.dts = dts;
+    s.cts = sample->cts;
+    s.size = 0;
+    s.keyframe = keyframe;
+    
+    for (int i = 0; i < sample->nb_sample_units; i++) {
+        SrsCodecSampleUnit* unit = &sample->sample_units[i];
+        if (unit->size <= 0) {
+            continue;
+        }
+        
+        s.size += 4 + unit->size;
+        
+        // reference the NALU with its 4bytes length in packet, 
+        // or copy to mdat with 4bytes length, for annexb or other length.
+        char* p = unit->bytes - 4;
+        if (p >= data) {
+            u_int32_t length = ((u_int32_t)(u_int8_t)p[0] << 24) | ((u_int32_t)(u_int8_t)p[1] << 16)
+                | ((u_int32_t)(u_int8_t)p[2] << 8) | (u_int32_t)(u_int8_t)p[3];
+            if (length == (u_int32_t)unit->size) {
+                srs_mp4_append_chunk(video_chunks, p, 4 + unit->size);
+                *preferenced = true;
+                continue;
+            }
+        }
+        
+        srs_mp4_write_u32(video_mdat, (u_int32_t)unit->size);
+        video_mdat->append(unit->bytes, unit->size);
+        srs_mp4_append_chunk(video_chunks, NULL, 4 + unit->size);
+    }
+    videos.push_back(s);
+    
+    return ret;
+}
+
+void SrsMp4Encoder::clear_fragment()
+{
+    videos.clear();
+    audios.clear();
+    video_chunks.clear();
+    audio_chunks.clear();
+    video_mdat->erase(video_mdat->length());
+    
+    std::vector<char*>::iterator it;
+    for (it = packets.begin(); it != packets.end(); ++it) {
+        char* packet = *it;
+        srs_freepa(packet);
+    }
+    packets.clear();
+}
+
+int SrsMp4Encoder::write_init()
+{
+    int ret = ERROR_SUCCESS;
+    
+    has_video = codec->is_avc_codec_ok();
+    has_audio = codec->is_aac_codec_ok();
+    got_init = true;
+    
+    SrsSimpleBuffer buf;
+    
+    // ISO_IEC_14496-12-base-format-2012.pdf, page 17.
+    int ftyp = srs_mp4_box_start(&buf, "ftyp");
+    buf.append("iso6", 4);
+    srs_mp4_write_u32(&buf, 0);
+    buf.append("iso6", 4);
+    buf.append("isom", 4);
+    buf.append("mp41", 4);
+    srs_mp4_box_end(&buf, ftyp);
+    
+    int moov = srs_mp4_box_start(&buf, "moov");
+    
+    // ISO_IEC_14496-12-base-format-2012.pdf, page 23.
+    int mvhd = srs_mp4_full_box_start(&buf, "mvhd", 0, 0);
+    srs_mp4_write_u32(&buf, 0); // creation_time
+    srs_mp4_write_u32(&buf, 0); // modification_time
+    srs_mp4_write_u32(&buf, SRS_MP4_TIMESCALE);
+    srs_mp4_write_u32(&buf, 0); // duration
+    srs_mp4_write_u32(&buf, 0x00010000); // rate
+    srs_mp4_write_u16(&buf, 0x0100); // volume
+    srs_mp4_write_zeros(&buf, 10);
+    srs_mp4_write_matrix(&buf);
+    srs_mp4_write_zeros(&buf, 24); // pre_defined
+    srs_mp4_write_u32(&buf, (has_video? 1 : 0) + (has_audio? 1 : 0) + 1); // next_track_ID
+    srs_mp4_box_end(&buf, mvhd);
+    
+    if (has_video) {
+        write_trak(&buf, true);
+    }
+    if (has_audio) {
+        write_trak(&buf, false);
+    }
+    
+    // ISO_IEC_14496-12-base-format-2012.pdf, page 64.
+    int mvex = srs_mp4_box_start(&buf, "mvex");
+    for (u_int32_t track_id = 1; track_id <= (u_int32_t)((has_video? 1 : 0) + (has_audio? 1 : 0)); track_id++) {
+        int trex = srs_mp4_full_box_start(&buf, "trex", 0, 0);
+        srs_mp4_write_u32(&buf, track_id);
+        srs_mp4_write_u32(&buf, 1); // default_sample_description_index
+        srs_mp4_write_u32(&buf, 0); // default_sample_duration
+        srs_mp4_write_u32(&buf, 0); // default_sample_size
+        srs_mp4_write_u32(&buf, 0); // default_sample_flags
+        srs_mp4_box_end(&buf, trex);
+    }
+    srs_mp4_box_end(&buf, mvex);
+    
+    srs_mp4_box_end(&buf, moov);
+    
+    if ((ret = writer->write(buf.bytes(), buf.length(), NULL)) != ERROR_SUCCESS) {
+        srs_error("write mp4 init segment failed. ret=%d", ret);
+        return ret;
+    }
+    
+    srs_info("mp4 init segment, video=%d, audio=%d, size=%d", has_video, has_audio, buf.length());
+    
+    return ret;
+}
+
+void SrsMp4Encoder::write_trak(SrsSimpleBuffer* buf, bool video)
+{
+    u_int32_t track_id = (video || !has_video)? 1 : 2;
+    
+    int trak = srs_mp4_box_start(buf, "trak");
+    
+    // ISO_IEC_14496-12-base-format-2012.pdf, page 25.
+    int tkhd = srs_mp4_full_box_start(buf, "tkhd", 0, 0x03);
+    srs_mp4_write_u32(buf, 0); // creation_time
+    srs_mp4_write_u32(buf, 0); // modification_time
+    srs_mp4_write_u32(buf, track_id);
+    srs_mp4_write_u32(buf, 0); // reserved
+    srs_mp4_write_u32(buf, 0); // duration
+    srs_mp4_write_zeros(buf, 8);
+    srs_mp4_write_u16(buf, 0); // layer
+    srs_mp4_write_u16(buf, 0); // alternate_group
+    srs_mp4_write_u16(buf, video? 0 : 0x0100); // volume
+    srs_mp4_write_u16(buf, 0);
+    srs_mp4_write_matrix(buf);
+    srs_mp4_write_u32(buf, video? ((u_int32_t)codec->width << 16) : 0);
+    srs_mp4_write_u32(buf, video? ((u_int32_t)codec->height << 16) : 0);
+    srs_mp4_box_end(buf, tkhd);
+    
+    int mdia = srs_mp4_box_start(buf, "mdia");
+    
+    int mdhd = srs_mp4_full_box_start(buf, "mdhd", 0, 0);
+    srs_mp4_write_u32(buf, 0); // creation_time
+    srs_mp4_write_u32(buf, 0); // modification_time
+    srs_mp4_write_u32(buf, SRS_MP4_TIMESCALE);
+    srs_mp4_write_u32(buf, 0); // duration
+    srs_mp4_write_u16(buf, 0x55c4); // language, und
+    srs_mp4_write_u16(buf, 0);
+    srs_mp4_box_end(buf, mdhd);
+    
+    int hdlr = srs_mp4_full_box_start(buf, "hdlr", 0, 0);
+    srs_mp4_write_u32(buf, 0); // pre_defined
+    buf->append(video? "vide" : "soun", 4);
+    srs_mp4_write_zeros(buf, 12);
+    const char* name = video? "VideoHandler" : "SoundHandler";
+    buf->append(name, (int)strlen(name) + 1);
+    srs_mp4_box_end(buf, hdlr);
+    
+    int minf = srs_mp4_box_start(buf, "minf");
+    
+    if (video) {
+        int vmhd = srs_mp4_full_box_start(buf, "vmhd", 0, 0x01);
+        srs_mp4_write_zeros(buf, 8); // graphicsmode and opcolor
+        srs_mp4_box_end(buf, vmhd);
+    } else {
+        int smhd = srs_mp4_full_box_start(buf, "smhd", 0, 0);
+        srs_mp4_write_zeros(buf, 4); // balance and reserved
+        srs_mp4_box_end(buf, smhd);
+    }
+    
+    int dinf = srs_mp4_box_start(buf, "dinf");
+    int dref = srs_mp4_full_box_start(buf, "dref", 0, 0);
+    srs_mp4_write_u32(buf, 1);
+    int url = srs_mp4_full_box_start(buf, "url ", 0, 0x01);
+    srs_mp4_box_end(buf, url);
+    srs_mp4_box_end(buf, dref);
+    srs_mp4_box_end(buf, dinf);
+    
+    int stbl = srs_mp4_box_start(buf, "stbl");
+    
+    int stsd = srs_mp4_full_box_start(buf, "stsd", 0, 0);
+    srs_mp4_write_u32(buf, 1);
+    if (video) {
+        bool is_hevc = codec->video_codec_id == SrsCodecVideoHEVC;
+        
+        // H.264-AVC-ISO_IEC_14496-15.pdf, page 22.
+        // for hevc, the hvc1 with hvcC, ISO_IEC_14496-15-2014.pdf, page 57.
+        int avc1 = srs_mp4_box_start(buf, is_hevc? "hvc1" : "avc1");
+        srs_mp4_write_zeros(buf, 6);
+        srs_mp4_write_u16(buf, 1); // data_reference_index
+        srs_mp4_write_zeros(buf, 16); // pre_defined and reserved
+        srs_mp4_write_u16(buf, (u_int16_t)codec->width);
+        srs_mp4_write_u16(buf, (u_int16_t)codec->height);
+        srs_mp4_write_u32(buf, 0x00480000); // horizresolution
+        srs_mp4_write_u32(buf, 0x00480000); // vertresolution
+        srs_mp4_write_u32(buf, 0);
+        srs_mp4_write_u16(buf, 1); // frame_count
+        srs_mp4_write_zeros(buf, 32); // compressorname
+        srs_mp4_write_u16(buf, 0x0018); // depth
+        srs_mp4_write_u16(buf, 0xffff); // pre_defined
+        
+        // the NALUs in mdat always use 4bytes length.
+        int avcc = srs_mp4_box_start(buf, is_hevc? "hvcC" : "avcC");
+        int pos = buf->length();
+        buf->append(codec->avc_extra_data, codec->avc_extra_size);
+        if (is_hevc && codec->avc_extra_size > 21) {
+            buf->bytes()[pos + 21] |= 0x03;
+        } else if (!is_hevc && codec->avc_extra_size > 4) {
+            buf->bytes()[pos + 4] = (char)0xff;
+        }
+        srs_mp4_box_end(buf, avcc);
+        
+        srs_mp4_box_end(buf, avc1);
+    } else {
+        // ISO_IEC_14496-12-base-format-2012.pdf, page 40.
+        int mp4a = srs_mp4_box_start(buf, "mp4a");
+        srs_mp4_write_zeros(buf, 6);
+        srs_mp4_write_u16(buf, 1); // data_reference_index
+        srs_mp4_write_zeros(buf, 8);
+        srs_mp4_write_u16(buf, codec->aac_channels);
+        srs_mp4_write_u16(buf, 16); // samplesize
+        srs_mp4_write_u32(buf, 0);
+        int sample_rate = 0;
+        if (codec->aac_sample_rate < SRS_AAC_SAMPLE_RATE_UNSET) {
+            sample_rate = aac_sample_rates[codec->aac_sample_rate];
+        }
+        srs_mp4_write_u32(buf, (u_int32_t)sample_rate << 16);
+        
+        // ES_Descriptor, ISO_IEC_14496-1-System.pdf, page 31.
+        int esds = srs_mp4_full_box_start(buf, "esds", 0, 0);
+        int nb_extra = codec->aac_extra_size;
+        srs_mp4_write_u8(buf, 0x03); // ES_DescrTag
+        srs_mp4_write_u8(buf, (u_int8_t)(3 + 2 + 13 + 2 + nb_extra + 3));
+        srs_mp4_write_u16(buf, 0); // ES_ID
+        srs_mp4_write_u8(buf, 0);
+        srs_mp4_write_u8(buf, 0x04); // DecoderConfigDescrTag
+        srs_mp4_write_u8(buf, (u_int8_t)(13 + 2 + nb_extra));
+        srs_mp4_write_u8(buf, 0x40); // objectTypeIndication, aac
+        srs_mp4_write_u8(buf, 0x15); // streamType audio, upStream 0, reserved 1
+        srs_mp4_write_zeros(buf, 3); // bufferSizeDB
+        srs_mp4_write_u32(buf, 0); // maxBitrate
+        srs_mp4_write_u32(buf, 0); // avgBitrate
+        srs_mp4_write_u8(buf, 0x05); // DecSpecificInfoTag
+        srs_mp4_write_u8(buf, (u_int8_t)nb_extra);
+        buf->append(codec->aac_extra_data, nb_extra);
+        srs_mp4_write_u8(buf, 0x06); // SLConfigDescrTag
+        srs_mp4_write_u8(buf, 1);
+        srs_mp4_write_u8(buf, 0x02);
+        srs_mp4_box_end(buf, esds);
+        
+        srs_mp4_box_end(buf, mp4a);
+    }
+    srs_mp4_box_end(buf, stsd);
+    
+    // the empty sample tables, the samples are in fragments.
+    const char* tables[] = { "stts", "stsc", "stco" };
+    for (int i = 0; i < 3; i++) {
+        int table = srs_mp4_full_box_start(buf, tables[i], 0, 0);
+        srs_mp4_write_u32(buf, 0);
+        srs_mp4_box_end(buf, table);
+    }
+    int stsz = srs_mp4_full_box_start(buf, "stsz", 0, 0);
+    srs_mp4_write_u32(buf, 0); // sample_size
+    srs_mp4_write_u32(buf, 0); // sample_count
+    srs_mp4_box_end(buf, stsz);
+    
+    srs_mp4_box_end(buf, stbl);
+    srs_mp4_box_end(buf, minf);
+    srs_mp4_box_end(buf, mdia);
+    srs_mp4_box_end(buf, trak);
+}
+
+int SrsMp4Encoder::write_fragment(int64_t next_video_dts, int64_t next_audio_dts)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (!got_init && (ret = write_init()) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // drop the samples of track not in init segment,
+    // the packets are freed when fragment written.
+    if (!has_video && !videos.empty()) {
+        videos.clear();
+        video_chunks.clear();
+        video_mdat->erase(video_mdat->length());
+    }
+    if (!has_audio && !audios.empty()) {
+        audios.clear();
+        audio_chunks.clear();
+    }
+    if (videos.empty() && audios.empty()) {
+        clear_fragment();
+        return ret;
+    }
+    
+    SrsSimpleBuffer moof;
+    
+    // ISO_IEC_14496-12-base-format-2012.pdf, page 66.
+    int moof_start = srs_mp4_box_start(&moof, "moof");
+    
+    int mfhd = srs_mp4_full_box_start(&moof, "mfhd", 0, 0);
+    srs_mp4_write_u32(&moof, ++sequence_number);
+    srs_mp4_box_end(&moof, mfhd);
+    
+    int video_offset = -1;
+    int audio_offset = -1;
+    if (!videos.empty()) {
+        write_traf(&moof, true, next_video_dts, &video_offset);
+    }
+    if (!audios.empty()) {
+        write_traf(&moof, false, next_audio_dts, &audio_offset);
+    }
+    
+    srs_mp4_box_end(&moof, moof_start);
+    
+    // the data offset is from the start of moof, the video before audio in mdat.
+    int nb_video = 0;
+    int nb_audio = 0;
+    std::vector<SrsMp4Chunk>::iterator it;
+    for (it = video_chunks.begin(); it != video_chunks.end(); ++it) {
+        nb_video += it->size;
+    }
+    for (it = audio_chunks.begin(); it != audio_chunks.end(); ++it) {
+        nb_audio += it->size;
+    }
+    if (video_offset >= 0) {
+        srs_mp4_patch_u32(&moof, video_offset, (u_int32_t)(moof.length() + 8));
+    }
+    if (audio_offset >= 0) {
+        srs_mp4_patch_u32(&moof, audio_offset, (u_int32_t)(moof.length() + 8 + nb_video));
+    }
+    
+    char mdat[8];
+    u_int32_t mdat_size = 8 + nb_video + nb_audio;
+    mdat[0] = (char)(mdat_size >> 24);
+    mdat[1] = (char)(mdat_size >> 16);
+    mdat[2] = (char)(mdat_size >> 8);
+    mdat[3] = (char)mdat_size;
+    memcpy(mdat + 4, "mdat", 4);
+    
+    // write the moof and mdat in one writev, the mdat references the packets.
+    std::vector<iovec> iovs(2 + video_chunks.size() + audio_chunks.size());
+    iovs[0].iov_base = moof.bytes();
+    iovs[0].iov_len = moof.length();
+    iovs[1].iov_base = mdat;
+    iovs[1].iov_len = 8;
+    
+    int nb_iovs = 2;
+    char* copied = video_mdat->bytes();
+    for (it = video_chunks.begin(); it != video_chunks.end(); ++it) {
+        SrsMp4Chunk& chunk = *it;
+        if (chunk.bytes) {
+            iovs[nb_iovs].iov_base = chunk.bytes;
+        } else {
+            iovs[nb_iovs].iov_base = copied;
+            copied += chunk.size;
+        }
+        iovs[nb_iovs++].iov_len = chunk.size;
+    }
+    for (it = audio_chunks.begin(); it != audio_chunks.end(); ++it) {
+        iovs[nb_iovs].iov_base = it->bytes;
+        iovs[nb_iovs++].iov_len = it->size;
+    }
+    
+    if ((ret = writer->writev(&iovs[0], nb_iovs, NULL)) != ERROR_SUCCESS) {
+        srs_error("write mp4 fragment failed. ret=%d", ret);
+        return ret;
+    }
+    
+    srs_info("mp4 fragment #%u, video=%d, audio=%d, size=%d", 
+        sequence_number, (int)videos.size(), (int)audios.size(), moof.length() + mdat_size);
+    
+    clear_fragment();
+    
+    return ret;
+}
+
+void SrsMp4Encoder::write_traf(SrsSimpleBuffer* buf, bool video, int64_t next_dts, int* pdata_offset)
+{
+    std::vector<SrsMp4Sample>& samples = video? videos : audios;
+    u_int32_t& last_duration = video? video_duration : audio_duration;
+    u_int32_t track_id = (video || !has_video)? 1 : 2;
+    
+    int traf = srs_mp4_box_start(buf, "traf");
+    
+    // default-base-is-moof, ISO_IEC_14496-12-base-format-2012.pdf, page 68.
+    int tfhd = srs_mp4_full_box_start(buf, "tfhd", 0, 0x020000);
+    srs_mp4_write_u32(buf, track_id);
+    srs_mp4_box_end(buf, tfhd);
+    
+    int tfdt = srs_mp4_full_box_start(buf, "tfdt", 1, 0);
+    srs_mp4_write_u64(buf, (u_int64_t)samples[0].dts);
+    srs_mp4_box_end(buf, tfdt);
+    
+    // data-offset, sample-duration and sample-size, 
+    // for video, sample-flags and signed sample-composition-time-offset.
+    u_int32_t flags = 0x000001 | 0x000100 | 0x000200;
+    if (video) {
+        flags |= 0x000400 | 0x000800;
+    }
+    int trun = srs_mp4_full_box_start(buf, "trun", video? 1 : 0, flags);
+    srs_mp4_write_u32(buf, (u_int32_t)samples.size());
+    *pdata_offset = buf->length();
+    srs_mp4_write_u32(buf, 0);
+    
+    // the duration of aac frame, when the next dts of track is unknown,
+    // for the audio timeline must continue to the tfdt of next fragment.
+    u_int32_t aac_duration = 0;
+    if (!video && codec->aac_sample_rate < SRS_AAC_SAMPLE_RATE_UNSET && aac_sample_rates[codec->aac_sample_rate] > 0) {
+        int sample_rate = aac_sample_rates[codec->aac_sample_rate];
+        aac_duration = (u_int32_t)((SRS_MP4_AAC_FRAME_SAMPLES * SRS_MP4_TIMESCALE + sample_rate / 2) / sample_rate);
+    }
+    
+    for (int i = 0; i < (int)samples.size(); i++) {
+        SrsMp4Sample& s = samples[i];
+        
+        // the duration of last sample is guessed by next sample of track, 
+        // the aac frame duration, or previous one.
+        int64_t next = (i < (int)samples.size() - 1)? samples[i + 1].dts : next_dts;
+        if (next > s.dts) {
+            last_duration = (u_int32_t)(next - s.dts);
+        } else if (aac_duration > 0) {
+            last_duration = aac_duration;
+        }
+        
+        srs_mp4_write_u32(buf, last_duration);
+        srs_mp4_write_u32(buf, s.size);
+        if (video) {
+            srs_mp4_write_u32(buf, s.keyframe? SRS_MP4_SAMPLE_SYNC : SRS_MP4_SAMPLE_NON_SYNC);
+            srs_mp4_write_u32(buf, (u_int32_t)s.cts);
+        }
+    }
+    srs_mp4_box_end(buf, trun);
+    
+    srs_mp4_box_end(buf, traf);
+}
+
+#endif
+
+// following is generated by src/kernel/srs_kernel_buffer.cpp
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2015 SRS(ossrs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//#include <srs_kernel_buffer.hpp>
+
+//#include <srs_kernel_error.hpp>
+//#include <srs_kernel_log.hpp>
+//#include <srs_kernel_utility.hpp>
+//#include <srs_core_performance.hpp>
+
+SrsSimpleBuffer::SrsSimpleBuffer()
+{
+}
+
+SrsSimpleBuffer::~SrsSimpleBuffer()
+{
+}
+
+int SrsSimpleBuffer::length()
+{
+    int len = (int)data.size();
+    srs_assert(len >= 0);
+    return len;
+}
+
+char* SrsSimpleBuffer::bytes()
+{
+    return (length() == 0)? NULL : &data.at(0);
+}
+
+void SrsSimpleBuffer::erase(int size)
+{
+    if (size <= 0) {
+        return;
+    }
+    
+    if (size >= length()) {
+        data.clear();
+        return;
+    }
+    
+    data.erase(data.begin(), data.begin() + size);
+}
+
+void SrsSimpleBuffer::append(const char* bytes, int size)
+{
+    srs_assert(size > 0);
+
+    data.insert(data.end(), bytes, bytes + size);
+}
+// following is generated by src/protocol/srs_rtmp_amf0.cpp
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2015 SRS(ossrs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//#include <srs_rtmp_amf0.hpp>
+
+#include <utility>
+#include <vector>
+#include <algorithm>
+#include <sstream>
+using namespace std;
+
+//#include <srs_kernel_log.hpp>
+//#include <srs_kernel_error.hpp>
+//#include <srs_kernel_stream.hpp>
+//#include <srs_core_autofree.hpp>
+
+using namespace _srs_internal;
+
+// AMF0 marker
+#define RTMP_AMF0_Number                     0x00
+#define RTMP_AMF0_Boolean                     0x01
+#define RTMP_AMF0_String                     0x02
+#define RTMP_AMF0_Object                     0x03
+#define RTMP_AMF0_MovieClip                 0x04 // reserved, not supported
+#define RTMP_AMF0_Null                         0x05
+#define RTMP_AMF0_Undefined                 0x06
+#define RTMP_AMF0_Reference                 0x07
+#define RTMP_AMF0_EcmaArray                 0x08
+#define RTMP_AMF0_ObjectEnd                 0x09
+#define RTMP_AMF0_StrictArray                 0x0A
+#define RTMP_AMF0_Date                         0x0B
+#define RTMP_AMF0_LongString                 0x0C
+#define RTMP_AMF0_UnSupported                 0x0D
+#define RTMP_AMF0_RecordSet                 0x0E // reserved, not supported
+#define RTMP_AMF0_XmlDocument                 0x0F
+#define RTMP_AMF0_TypedObject                 0x10
+// AVM+ object is the AMF3 object.
+#define RTMP_AMF0_AVMplusObject             0x11
+// origin array whos data takes the same form as LengthValueBytes
+#define RTMP_AMF0_OriginStrictArray         0x20
+
+// User defined
+#define RTMP_AMF0_Invalid                     0x3F
+
+SrsAmf0Any::SrsAmf0Any()
+{
+    marker = RTMP_AMF0_Invalid;
+}
+
+SrsAmf0Any::~SrsAmf0Any()
+{
+}
+
+bool SrsAmf0Any::is_string()
+{
+    return marker == RTMP_AMF0_String;
+}
+
+bool SrsAmf0Any::is_boolean()
+{
+    return marker == RTMP_AMF0_Boolean;
+}
+
+bool SrsAmf0Any::is_number()
+{
+    return marker == RTMP_AMF0_Number;
+}
+
+bool SrsAmf0Any::is_null()
+{
+    return marker == RTMP_AMF0_Null;
+}
+
+bool SrsAmf0Any::is_undefined()
+{
+    return marker == RTMP_AMF0_Undefined;
+}
+
+bool SrsAmf0Any::is_object()
+{
+    return marker == RTMP_AMF0_Object;
+}
+
+bool SrsAmf0Any::is_ecma_array()
+{
+    return marker == RTMP_AMF0_EcmaArray;
+}
+
+bool SrsAmf0Any::is_strict_array()
+{
+    return marker == RTMP_AMF0_StrictArray;
+}
+
+bool SrsAmf0Any::is_date()
+{
+    return marker == RTMP_AMF0_Date;
+}
+
+bool SrsAmf0Any::is_complex_object()
+{
+    return is_object() || is_object_eof() || is_ecma_array() || is_strict_array();
+}
+
+string SrsAmf0Any::to_str()
+{
+    SrsAmf0String* p = dynamic_cast<SrsAmf0String*>(this);
+    srs_assert(p != NULL);
+    return p->value;
+}
+
+const char* SrsAmf0Any::to_str_raw()
+{
+    SrsAmf0String* p = dynamic_cast<SrsAmf0String*>(this);
+    srs_assert(p != NULL);
+    return p->value.data();
+}
+
+bool SrsAmf0Any::to_boolean()
+{
+    SrsAmf0Boolean* p = dynamic_cast<SrsAmf0Boolean*>(this);
+    srs_assert(p != NULL);
+    return p->value;
+}
+
+double SrsAmf0Any::to_number()
+{
+    SrsAmf0Number* p = dynamic_cast<SrsAmf0Number*>(this);
+    srs_assert(p != NULL);
+    return p->value;
+}
+
+int64_t SrsAmf0Any::to_date()
+{
+    SrsAmf0Date* p = dynamic_cast<SrsAmf0Date*>(this);
+    srs_assert(p != NULL);
+    return p->date();
+}
+
+int16_t SrsAmf0Any::to_date_time_zone()
+{
+    SrsAmf0Date* p = dynamic_cast<SrsAmf0Date*>(this);
+    srs_assert(p != NULL);
+    return p->time_zone();
+}
+
+SrsAmf0Object* SrsAmf0Any::to_object()
+{
+    SrsAmf0Object* p = dynamic_cast<SrsAmf0Object*>(this);
+    srs_assert(p != NULL);
+    return p;
+}
+
+SrsAmf0EcmaArray* SrsAmf0Any::to_ecma_array()
+{
+    SrsAmf0EcmaArray* p = dynamic_cast<SrsAmf0EcmaArray*>(this);
+    srs_assert(p != NULL);
+    return p;
+}
+
+SrsAmf0StrictArray* SrsAmf0Any::to_strict_array()
+{
+    SrsAmf0StrictArray* p = dynamic_cast<SrsAmf0StrictArray*>(this);
+    srs_assert(p != NULL);
+    return p;
+}
+
+void SrsAmf0Any::set_number(double value)
+{
+    SrsAmf0Number* p = dynamic_cast<SrsAmf0Number*>(this);
+    srs_assert(p != NULL);
+    p->value = value;
+}
+
+bool SrsAmf0Any::is_object_eof()
+{
+    return marker == RTMP_AMF0_ObjectEnd;
+}
+
+void srs_fill_level_spaces(stringstream& ss, int level)
+{
+    for (int i = 0; i < level; i++) {
+        ss << "    ";
+    }
+}
+void srs_amf0_do_print(SrsAmf0Any* any, stringstream& ss, int level)
+{
+    if (any->is_boolean()) {
+        ss << "Boolean " << (any->to_boolean()? "true":"false") << endl;
+    } else if (any->is_number()) {
+        ss << "Number " << std::fixed << any->to_number() << endl;
     } else if (any->is_string()) {
         ss << "String " << any->to_str() << endl;
     } else if (any->is_date()) {
@@ -19955,6 +28276,24 @@ SrsAmf0Any* SrsUnSortedHashtable::ensure_property_number(string name)
     return prop;
 }
 
+void SrsUnSortedHashtable::remove(string name)
+{
+    std::vector<SrsAmf0ObjectPropertyType>::iterator it;
+    
+    for (it = properties.begin(); it != properties.end();) {
+        std::string key = it->first;
+        SrsAmf0Any* any = it->second;
+        
+        if (key == name) {
+            srs_freep(any);
+            
+            it = properties.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
 void SrsUnSortedHashtable::copy(SrsUnSortedHashtable* src)
 {
     std::vector<SrsAmf0ObjectPropertyType>::iterator it;
@@ -20229,6 +28568,11 @@ SrsAmf0Any* SrsAmf0Object::ensure_property_number(string name)
     return properties->ensure_property_number(name);
 }
 
+void SrsAmf0Object::remove(string name)
+{
+    properties->remove(name);
+}
+
 SrsAmf0EcmaArray::SrsAmf0EcmaArray()
 {
     _count = 0;
@@ -20658,6 +29002,141 @@ int SrsAmf0Size::any(SrsAmf0Any* o)
     return o->total_size();
 }
 
+SrsAmf0Template::SrsAmf0Template()
+{
+    // the image always starts with a part, maybe empty.
+    parts.push_back("");
+}
+
+SrsAmf0Template::~SrsAmf0Template()
+{
+}
+
+int SrsAmf0Template::append(SrsAmf0Any* value)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(value != NULL);
+    SrsAutoFree(SrsAmf0Any, value);
+    
+    int size = value->total_size();
+    char* bytes = new char[size];
+    SrsAutoFreeA(char, bytes);
+    
+    SrsStream stream;
+    if ((ret = stream.initialize(bytes, size)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    if ((ret = value->write(&stream)) != ERROR_SUCCESS) {
+        srs_error("amf0 template write value failed. ret=%d", ret);
+        return ret;
+    }
+    
+    parts.back().append(bytes, size);
+    
+    return ret;
+}
+
+void SrsAmf0Template::append_object_start()
+{
+    parts.back().append(1, (char)RTMP_AMF0_Object);
+}
+
+void SrsAmf0Template::append_property_name(string name)
+{
+    // the property name is UTF-8 without marker.
+    std::string& part = parts.back();
+    part.append(1, (char)((name.length() >> 8) & 0xff));
+    part.append(1, (char)(name.length() & 0xff));
+    part.append(name);
+}
+
+void SrsAmf0Template::append_object_eof()
+{
+    std::string& part = parts.back();
+    part.append(2, (char)0x00);
+    part.append(1, (char)RTMP_AMF0_ObjectEnd);
+}
+
+void SrsAmf0Template::append_number_field()
+{
+    fields.push_back(RTMP_AMF0_Number);
+    parts.push_back("");
+}
+
+void SrsAmf0Template::append_string_field()
+{
+    fields.push_back(RTMP_AMF0_String);
+    parts.push_back("");
+}
+
+int SrsAmf0Template::nb_numbers()
+{
+    return (int)std::count(fields.begin(), fields.end(), (char)RTMP_AMF0_Number);
+}
+
+int SrsAmf0Template::nb_strings()
+{
+    return (int)std::count(fields.begin(), fields.end(), (char)RTMP_AMF0_String);
+}
+
+int SrsAmf0Template::total_size(string* strings)
+{
+    int size = 0;
+    
+    std::vector<std::string>::iterator it;
+    for (it = parts.begin(); it != parts.end(); ++it) {
+        size += (int)it->length();
+    }
+    
+    for (int i = 0; i < (int)fields.size(); i++) {
+        if (fields[i] == RTMP_AMF0_Number) {
+            size += SrsAmf0Size::number();
+        } else {
+            size += SrsAmf0Size::str(*strings++);
+        }
+    }
+    
+    return size;
+}
+
+int SrsAmf0Template::write(SrsStream* stream, double* numbers, string* strings)
+{
+    int ret = ERROR_SUCCESS;
+    
+    for (int i = 0; i < (int)parts.size(); i++) {
+        std::string& part = parts[i];
+    
+        if (!part.empty()) {
+            if (!stream->require((int)part.length())) {
+                ret = ERROR_RTMP_AMF0_ENCODE;
+                srs_error("amf0 template write part failed. ret=%d", ret);
+                return ret;
+            }
+            stream->write_bytes((char*)part.data(), (int)part.length());
+        }
+    
+        // the last part has no field.
+        if (i >= (int)fields.size()) {
+            break;
+        }
+    
+        if (fields[i] == RTMP_AMF0_Number) {
+            ret = srs_amf0_write_number(stream, *numbers++);
+        } else {
+            ret = srs_amf0_write_string(stream, *strings++);
+        }
+    
+        if (ret != ERROR_SUCCESS) {
+            srs_error("amf0 template write field failed. ret=%d", ret);
+            return ret;
+        }
+    }
+    
+    return ret;
+}
+
 SrsAmf0String::SrsAmf0String(const char* _value)
 {
     marker = RTMP_AMF0_String;
@@ -21335,7 +29814,7 @@ namespace _srs_internal
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -21409,7 +29888,7 @@ ISrsProtocolReaderWriter::~ISrsProtocolReaderWriter()
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -21440,7 +29919,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //#include <srs_rtmp_utility.hpp>
 //#include <srs_rtmp_handshake.hpp>
 
-// for srs-librtmp, @see https://github.com/simple-rtmp-server/srs/issues/213
+// for srs-librtmp, @see https://github.com/ossrs/srs/issues/213
 #ifndef _WIN32
 #include <unistd.h>
 #endif
@@ -21559,14 +30038,14 @@ int SrsPacket::encode(int& psize, char*& ppayload)
         
         if ((ret = stream.initialize(payload, size)) != ERROR_SUCCESS) {
             srs_error("initialize the stream failed. ret=%d", ret);
-            srs_freep(payload);
+            srs_freepa(payload);
             return ret;
         }
     }
     
     if ((ret = encode_packet(&stream)) != ERROR_SUCCESS) {
         srs_error("encode the packet failed. ret=%d", ret);
-        srs_freep(payload);
+        srs_freepa(payload);
         return ret;
     }
     
@@ -21687,7 +30166,7 @@ SrsProtocol::~SrsProtocol()
         SrsChunkStream* cs = cs_cache[i];
         srs_freep(cs);
     }
-    srs_freep(cs_cache);
+    srs_freepa(cs_cache);
 }
 
 void SrsProtocol::set_auto_response(bool v)
@@ -22040,7 +30519,7 @@ int SrsProtocol::do_send_and_free_packet(SrsPacket* packet, int stream_id)
     header.perfer_cid = packet->get_prefer_cid();
     
     ret = do_simple_send(&header, payload, size);
-    srs_freep(payload);
+    srs_freepa(payload);
     if (ret == ERROR_SUCCESS) {
         ret = on_send_packet(&header, packet);
     }
@@ -22323,6 +30802,89 @@ int SrsProtocol::send_and_free_packet(SrsPacket* packet, int stream_id)
     return ret;
 }
 
+int SrsProtocol::send_and_free_packets(SrsPacket** packets, int* stream_ids, int nb_packets)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(packets);
+    srs_assert(nb_packets > 0);
+    
+    std::vector<SrsMessageHeader> headers;
+    std::vector<SrsPacket*> sent;
+    std::vector<SrsSharedPtrMessage*> msgs;
+    
+    // encode all packets to messages, which take the payload.
+    for (int i = 0; i < nb_packets; i++) {
+        SrsPacket* packet = packets[i];
+        srs_assert(packet);
+        
+        int size = 0;
+        char* payload = NULL;
+        if ((ret = packet->encode(size, payload)) != ERROR_SUCCESS) {
+            srs_error("encode RTMP packet to bytes oriented RTMP message failed. ret=%d", ret);
+            break;
+        }
+        
+        // encode packet to payload and size.
+        if (size <= 0 || payload == NULL) {
+            srs_warn("packet is empty, ignore empty message.");
+            continue;
+        }
+        
+        SrsMessageHeader header;
+        header.payload_length = size;
+        header.message_type = packet->get_message_type();
+        header.stream_id = stream_ids[i];
+        header.perfer_cid = packet->get_prefer_cid();
+        headers.push_back(header);
+        sent.push_back(packet);
+        
+        SrsSharedPtrMessage* msg = new SrsSharedPtrMessage();
+        msgs.push_back(msg);
+        if ((ret = msg->create(&header, payload, size)) != ERROR_SUCCESS) {
+            srs_freepa(payload);
+            break;
+        }
+    }
+    
+    // sendout all messages in one writev.
+    if (ret == ERROR_SUCCESS && !msgs.empty()) {
+        ret = do_send_messages(&msgs[0], (int)msgs.size());
+    }
+    
+    for (int i = 0; i < (int)msgs.size(); i++) {
+        SrsSharedPtrMessage* msg = msgs[i];
+        srs_freep(msg);
+    }
+    
+    // update the protocol state by packets in order,
+    // for the response must be decoded by the request.
+    if (ret == ERROR_SUCCESS) {
+        for (int i = 0; i < (int)headers.size(); i++) {
+            if ((ret = on_send_packet(&headers[i], sent[i])) != ERROR_SUCCESS) {
+                break;
+            }
+        }
+    }
+    
+    for (int i = 0; i < nb_packets; i++) {
+        SrsPacket* packet = packets[i];
+        srs_freep(packet);
+    }
+    
+    // donot flush when send failed
+    if (ret != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // flush messages in manual queue
+    if ((ret = manual_response_flush()) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    return ret;
+}
+
 int SrsProtocol::recv_interlaced_message(SrsCommonMessage** pmsg)
 {
     int ret = ERROR_SUCCESS;
@@ -22345,7 +30907,7 @@ int SrsProtocol::recv_interlaced_message(SrsCommonMessage** pmsg)
     SrsChunkStream* chunk = NULL;
     
     // use chunk stream cache to get the chunk info.
-    // @see https://github.com/simple-rtmp-server/srs/issues/249
+    // @see https://github.com/ossrs/srs/issues/249
     if (cid < SRS_PERF_CHUNK_STREAM_CACHE) {
         // chunk stream cache hit.
         srs_verbose("cs-cache hit, cid=%d", cid);
@@ -22556,7 +31118,7 @@ int SrsProtocol::read_message_header(SrsChunkStream* chunk, char fmt)
         // 0x04             where: message_type=4(protocol control user-control message)
         // 0x00 0x06            where: event Ping(0x06)
         // 0x00 0x00 0x0d 0x0f  where: event data 4bytes ping timestamp.
-        // @see: https://github.com/simple-rtmp-server/srs/issues/98
+        // @see: https://github.com/ossrs/srs/issues/98
         if (chunk->cid == RTMP_CID_ProtocolControl && fmt == RTMP_FMT_TYPE1) {
             srs_warn("accept cid=2, fmt=1 to make librtmp happy.");
         } else {
@@ -22726,7 +31288,7 @@ int SrsProtocol::read_message_header(SrsChunkStream* chunk, char fmt)
         pp[0] = *p++;
 
         // always use 31bits timestamp, for some server may use 32bits extended timestamp.
-        // @see https://github.com/simple-rtmp-server/srs/issues/111
+        // @see https://github.com/ossrs/srs/issues/111
         timestamp &= 0x7fffffff;
         
         /**
@@ -22916,12 +31478,12 @@ int SrsProtocol::on_recv_message(SrsCommonMessage* msg)
 
             // for some server, the actual chunk size can greater than the max value(65536),
             // so we just warning the invalid chunk size, and actually use it is ok,
-            // @see: https://github.com/simple-rtmp-server/srs/issues/160
+            // @see: https://github.com/ossrs/srs/issues/160
             if (pkt->chunk_size < SRS_CONSTS_RTMP_MIN_CHUNK_SIZE 
                 || pkt->chunk_size > SRS_CONSTS_RTMP_MAX_CHUNK_SIZE) 
             {
                 srs_warn("accept chunk size %d, but should in [%d, %d], "
-                    "@see: https://github.com/simple-rtmp-server/srs/issues/160",
+                    "@see: https://github.com/ossrs/srs/issues/160",
                     pkt->chunk_size, SRS_CONSTS_RTMP_MIN_CHUNK_SIZE, 
                     SRS_CONSTS_RTMP_MAX_CHUNK_SIZE);
             }
@@ -22994,6 +31556,14 @@ int SrsProtocol::on_send_packet(SrsMessageHeader* mh, SrsPacket* packet)
                     break;
                 }
             }
+            if (true) {
+                SrsTemplateCommandPacket* pkt = dynamic_cast<SrsTemplateCommandPacket*>(packet);
+                // the play/publish use transaction id 0, no response.
+                if (pkt && pkt->transaction_id > 0) {
+                    requests[pkt->transaction_id] = pkt->command_name;
+                    break;
+                }
+            }
             break;
         }
         default:
@@ -23155,12 +31725,17 @@ string srs_client_type_string(SrsRtmpConnType type)
 {
     switch (type) {
         case SrsRtmpConnPlay: return "Play";
-        case SrsRtmpConnFlashPublish: return "publish(FlashPublish)";
-        case SrsRtmpConnFMLEPublish: return "publish(FMLEPublish)";
+        case SrsRtmpConnFlashPublish: return "flash-publish)";
+        case SrsRtmpConnFMLEPublish: return "fmle-publish";
         default: return "Unknown";
     }
 }
 
+bool srs_client_type_is_publish(SrsRtmpConnType type)
+{
+    return type != SrsRtmpConnPlay;
+}
+
 SrsHandshakeBytes::SrsHandshakeBytes()
 {
     c0c1 = s0s1s2 = c2 = NULL;
@@ -23168,9 +31743,9 @@ SrsHandshakeBytes::SrsHandshakeBytes()
 
 SrsHandshakeBytes::~SrsHandshakeBytes()
 {
-    srs_freep(c0c1);
-    srs_freep(s0s1s2);
-    srs_freep(c2);
+    srs_freepa(c0c1);
+    srs_freepa(s0s1s2);
+    srs_freepa(c2);
 }
 
 int SrsHandshakeBytes::read_c0c1(ISrsProtocolReaderWriter* io)
@@ -23280,7 +31855,7 @@ int SrsHandshakeBytes::create_s0s1s2(const char* c1)
     }
     
     // if c1 specified, copy c1 to s2.
-    // @see: https://github.com/simple-rtmp-server/srs/issues/46
+    // @see: https://github.com/ossrs/srs/issues/46
     if (c1) {
         memcpy(s0s1s2 + 1537, c1, 1536);
     }
@@ -23450,39 +32025,7 @@ int SrsRtmpClient::connect_app2(
     
     // Connect(vhost, app)
     if (true) {
-        SrsConnectAppPacket* pkt = new SrsConnectAppPacket();
-        
-        pkt->command_object->set("app", SrsAmf0Any::str(app.c_str()));
-        pkt->command_object->set("flashVer", SrsAmf0Any::str("WIN 15,0,0,239"));
-        if (req) {
-            pkt->command_object->set("swfUrl", SrsAmf0Any::str(req->swfUrl.c_str()));
-        } else {
-            pkt->command_object->set("swfUrl", SrsAmf0Any::str());
-        }
-        if (req && req->tcUrl != "") {
-            pkt->command_object->set("tcUrl", SrsAmf0Any::str(req->tcUrl.c_str()));
-        } else {
-            pkt->command_object->set("tcUrl", SrsAmf0Any::str(tc_url.c_str()));
-        }
-        pkt->command_object->set("fpad", SrsAmf0Any::boolean(false));
-        pkt->command_object->set("capabilities", SrsAmf0Any::number(239));
-        pkt->command_object->set("audioCodecs", SrsAmf0Any::number(3575));
-        pkt->command_object->set("videoCodecs", SrsAmf0Any::number(252));
-        pkt->command_object->set("videoFunction", SrsAmf0Any::number(1));
-        if (req) {
-            pkt->command_object->set("pageUrl", SrsAmf0Any::str(req->pageUrl.c_str()));
-        } else {
-            pkt->command_object->set("pageUrl", SrsAmf0Any::str());
-        }
-        pkt->command_object->set("objectEncoding", SrsAmf0Any::number(0));
-        
-        // @see https://github.com/simple-rtmp-server/srs/issues/160
-        // the debug_srs_upnode is config in vhost and default to true.
-        if (debug_srs_upnode && req && req->args) {
-            srs_freep(pkt->args);
-            pkt->args = req->args->copy()->to_object();
-        }
-        
+        SrsTemplateCommandPacket* pkt = create_connect_app_packet(app, tc_url, req, debug_srs_upnode);
         if ((ret = protocol->send_and_free_packet(pkt, 0)) != ERROR_SUCCESS) {
             return ret;
         }
@@ -23547,7 +32090,7 @@ int SrsRtmpClient::create_stream(int& stream_id)
     
     // CreateStream
     if (true) {
-        SrsCreateStreamPacket* pkt = new SrsCreateStreamPacket();
+        SrsTemplateCommandPacket* pkt = SrsTemplateCommandPacket::create_create_stream(2);
         if ((ret = protocol->send_and_free_packet(pkt, 0)) != ERROR_SUCCESS) {
             return ret;
         }
@@ -23575,43 +32118,26 @@ int SrsRtmpClient::play(string stream, int stream_id)
 {
     int ret = ERROR_SUCCESS;
     
-    // Play(stream)
-    if (true) {
-        SrsPlayPacket* pkt = new SrsPlayPacket();
-        pkt->stream_name = stream;
-        if ((ret = protocol->send_and_free_packet(pkt, stream_id)) != ERROR_SUCCESS) {
-            srs_error("send play stream failed. "
-                "stream=%s, stream_id=%d, ret=%d", 
-                stream.c_str(), stream_id, ret);
-            return ret;
-        }
-    }
-    
-    // SetBufferLength(1000ms)
+    // Play(stream), SetBufferLength(1000ms) and SetChunkSize,
+    // the server never response the play, so we send them in one writev
+    // to start the playback as fast as possible.
     int buffer_length_ms = 1000;
     if (true) {
-        SrsUserControlPacket* pkt = new SrsUserControlPacket();
+        SrsUserControlPacket* buffer = new SrsUserControlPacket();
+        buffer->event_type = SrcPCUCSetBufferLength;
+        buffer->event_data = stream_id;
+        buffer->extra_data = buffer_length_ms;
         
-        pkt->event_type = SrcPCUCSetBufferLength;
-        pkt->event_data = stream_id;
-        pkt->extra_data = buffer_length_ms;
+        SrsSetChunkSizePacket* chunk = new SrsSetChunkSizePacket();
+        chunk->chunk_size = SRS_CONSTS_RTMP_SRS_CHUNK_SIZE;
         
-        if ((ret = protocol->send_and_free_packet(pkt, 0)) != ERROR_SUCCESS) {
-            srs_error("send set buffer length failed. "
-                "stream=%s, stream_id=%d, bufferLength=%d, ret=%d", 
-                stream.c_str(), stream_id, buffer_length_ms, ret);
-            return ret;
-        }
-    }
-    
-    // SetChunkSize
-    if (true) {
-        SrsSetChunkSizePacket* pkt = new SrsSetChunkSizePacket();
-        pkt->chunk_size = SRS_CONSTS_RTMP_SRS_CHUNK_SIZE;
-        if ((ret = protocol->send_and_free_packet(pkt, 0)) != ERROR_SUCCESS) {
-            srs_error("send set chunk size failed. "
-                "stream=%s, chunk_size=%d, ret=%d", 
-                stream.c_str(), SRS_CONSTS_RTMP_SRS_CHUNK_SIZE, ret);
+        SrsPacket* pkts[] = {SrsTemplateCommandPacket::create_play(stream), buffer, chunk};
+        int sids[] = {stream_id, 0, 0};
+        
+        if ((ret = protocol->send_and_free_packets(pkts, sids, 3)) != ERROR_SUCCESS) {
+            srs_error("send play stream failed. "
+                "stream=%s, stream_id=%d, bufferLength=%d, chunk_size=%d, ret=%d", 
+                stream.c_str(), stream_id, buffer_length_ms, SRS_CONSTS_RTMP_SRS_CHUNK_SIZE, ret);
             return ret;
         }
     }
@@ -23637,8 +32163,7 @@ int SrsRtmpClient::publish(string stream, int stream_id)
     
     // publish(stream)
     if (true) {
-        SrsPublishPacket* pkt = new SrsPublishPacket();
-        pkt->stream_name = stream;
+        SrsTemplateCommandPacket* pkt = SrsTemplateCommandPacket::create_publish(stream);
         if ((ret = protocol->send_and_free_packet(pkt, stream_id)) != ERROR_SUCCESS) {
             srs_error("send publish message failed. "
                 "stream=%s, stream_id=%d, ret=%d", 
@@ -23658,7 +32183,7 @@ int SrsRtmpClient::fmle_publish(string stream, int& stream_id)
     
     // SrsFMLEStartPacket
     if (true) {
-        SrsFMLEStartPacket* pkt = SrsFMLEStartPacket::create_release_stream(stream);
+        SrsTemplateCommandPacket* pkt = SrsTemplateCommandPacket::create_release_stream(stream);
         if ((ret = protocol->send_and_free_packet(pkt, 0)) != ERROR_SUCCESS) {
             srs_error("send FMLE publish "
                 "release stream failed. stream=%s, ret=%d", stream.c_str(), ret);
@@ -23668,7 +32193,7 @@ int SrsRtmpClient::fmle_publish(string stream, int& stream_id)
     
     // FCPublish
     if (true) {
-        SrsFMLEStartPacket* pkt = SrsFMLEStartPacket::create_FC_publish(stream);
+        SrsTemplateCommandPacket* pkt = SrsTemplateCommandPacket::create_FC_publish(stream);
         if ((ret = protocol->send_and_free_packet(pkt, 0)) != ERROR_SUCCESS) {
             srs_error("send FMLE publish "
                 "FCPublish failed. stream=%s, ret=%d", stream.c_str(), ret);
@@ -23678,8 +32203,7 @@ int SrsRtmpClient::fmle_publish(string stream, int& stream_id)
     
     // CreateStream
     if (true) {
-        SrsCreateStreamPacket* pkt = new SrsCreateStreamPacket();
-        pkt->transaction_id = 4;
+        SrsTemplateCommandPacket* pkt = SrsTemplateCommandPacket::create_create_stream(4);
         if ((ret = protocol->send_and_free_packet(pkt, 0)) != ERROR_SUCCESS) {
             srs_error("send FMLE publish "
                 "createStream failed. stream=%s, ret=%d", stream.c_str(), ret);
@@ -23704,8 +32228,7 @@ int SrsRtmpClient::fmle_publish(string stream, int& stream_id)
     
     // publish(stream)
     if (true) {
-        SrsPublishPacket* pkt = new SrsPublishPacket();
-        pkt->stream_name = stream;
+        SrsTemplateCommandPacket* pkt = SrsTemplateCommandPacket::create_publish(stream);
         if ((ret = protocol->send_and_free_packet(pkt, stream_id)) != ERROR_SUCCESS) {
             srs_error("send FMLE publish publish failed. "
                 "stream=%s, stream_id=%d, ret=%d", stream.c_str(), stream_id, ret);
@@ -23716,6 +32239,172 @@ int SrsRtmpClient::fmle_publish(string stream, int& stream_id)
     return ret;
 }
 
+int SrsRtmpClient::pipeline_play(
+    string app, string tc_url, SrsRequest* req, bool debug_srs_upnode,
+    string stream, int& stream_id
+) {
+    int ret = ERROR_SUCCESS;
+    
+    // the createStream always response the first stream id 1,
+    // so we play on it before got the response.
+    stream_id = 1;
+    
+    // Connect, SetWindowAckSize, CreateStream, Play, SetBufferLength and SetChunkSize,
+    // the SetChunkSize must be the last one, for it applies after sent.
+    if (true) {
+        SrsSetWindowAckSizePacket* ack = new SrsSetWindowAckSizePacket();
+        ack->ackowledgement_window_size = 2500000;
+        
+        SrsUserControlPacket* buffer = new SrsUserControlPacket();
+        buffer->event_type = SrcPCUCSetBufferLength;
+        buffer->event_data = stream_id;
+        buffer->extra_data = 1000;
+        
+        SrsSetChunkSizePacket* chunk = new SrsSetChunkSizePacket();
+        chunk->chunk_size = SRS_CONSTS_RTMP_SRS_CHUNK_SIZE;
+        
+        SrsPacket* pkts[] = {
+            create_connect_app_packet(app, tc_url, req, debug_srs_upnode), ack,
+            SrsTemplateCommandPacket::create_create_stream(2),
+            SrsTemplateCommandPacket::create_play(stream), buffer, chunk
+        };
+        int sids[] = {0, 0, 0, stream_id, 0, 0};
+        
+        if ((ret = protocol->send_and_free_packets(pkts, sids, 6)) != ERROR_SUCCESS) {
+            srs_error("send pipelined play failed. stream=%s, ret=%d", stream.c_str(), ret);
+            return ret;
+        }
+    }
+    
+    // expect connect _result
+    if (true) {
+        SrsCommonMessage* msg = NULL;
+        SrsConnectAppResPacket* pkt = NULL;
+        if ((ret = expect_message<SrsConnectAppResPacket>(&msg, &pkt)) != ERROR_SUCCESS) {
+            srs_error("expect connect app response message failed. ret=%d", ret);
+            return ret;
+        }
+        SrsAutoFree(SrsCommonMessage, msg);
+        SrsAutoFree(SrsConnectAppResPacket, pkt);
+        srs_info("get connect app response message");
+    }
+    
+    // CreateStream _result.
+    int guess_stream_id = stream_id;
+    if ((ret = expect_create_stream_result(stream_id)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // the stream id we guess is wrong, the play is sent on the wrong stream,
+    // and play again will send duplicated commands, so fail for user to fallback.
+    if (stream_id != guess_stream_id) {
+        ret = ERROR_RTMP_PIPELINE_STREAM_ID;
+        srs_error("pipelined play stream id %d, actual %d. ret=%d", guess_stream_id, stream_id, ret);
+        return ret;
+    }
+    
+    return ret;
+}
+
+int SrsRtmpClient::pipeline_publish(
+    string app, string tc_url, SrsRequest* req, bool debug_srs_upnode,
+    string stream, int& stream_id
+) {
+    int ret = ERROR_SUCCESS;
+    
+    // the createStream always response the first stream id 1,
+    // so we publish on it before got the response.
+    stream_id = 1;
+    
+    // Connect, SetWindowAckSize, releaseStream, FCPublish, CreateStream and publish.
+    if (true) {
+        SrsSetWindowAckSizePacket* ack = new SrsSetWindowAckSizePacket();
+        ack->ackowledgement_window_size = 2500000;
+        
+        SrsPacket* pkts[] = {
+            create_connect_app_packet(app, tc_url, req, debug_srs_upnode), ack,
+            SrsTemplateCommandPacket::create_release_stream(stream),
+            SrsTemplateCommandPacket::create_FC_publish(stream),
+            SrsTemplateCommandPacket::create_create_stream(4),
+            SrsTemplateCommandPacket::create_publish(stream)
+        };
+        int sids[] = {0, 0, 0, 0, 0, stream_id};
+        
+        if ((ret = protocol->send_and_free_packets(pkts, sids, 6)) != ERROR_SUCCESS) {
+            srs_error("send pipelined publish failed. stream=%s, ret=%d", stream.c_str(), ret);
+            return ret;
+        }
+    }
+    
+    // expect connect _result
+    if (true) {
+        SrsCommonMessage* msg = NULL;
+        SrsConnectAppResPacket* pkt = NULL;
+        if ((ret = expect_message<SrsConnectAppResPacket>(&msg, &pkt)) != ERROR_SUCCESS) {
+            srs_error("expect connect app response message failed. ret=%d", ret);
+            return ret;
+        }
+        SrsAutoFree(SrsCommonMessage, msg);
+        SrsAutoFree(SrsConnectAppResPacket, pkt);
+        srs_info("get connect app response message");
+    }
+    
+    // expect result of CreateStream
+    int guess_stream_id = stream_id;
+    if ((ret = expect_create_stream_result(stream_id)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // the stream id we guess is wrong, @see pipeline_play.
+    if (stream_id != guess_stream_id) {
+        ret = ERROR_RTMP_PIPELINE_STREAM_ID;
+        srs_error("pipelined publish stream id %d, actual %d. ret=%d", guess_stream_id, stream_id, ret);
+        return ret;
+    }
+    
+    return ret;
+}
+
+SrsTemplateCommandPacket* SrsRtmpClient::create_connect_app_packet(
+    string app, string tc_url, SrsRequest* req, bool debug_srs_upnode
+) {
+    std::string swf_url = req? req->swfUrl : "";
+    std::string page_url = req? req->pageUrl : "";
+    if (req && req->tcUrl != "") {
+        tc_url = req->tcUrl;
+    }
+    
+    // @see https://github.com/ossrs/srs/issues/160
+    // the debug_srs_upnode is config in vhost and default to true.
+    SrsAmf0Object* args = NULL;
+    if (debug_srs_upnode && req && req->args) {
+        args = req->args->copy()->to_object();
+    }
+    
+    // encode from the pre-serialized template, for the connect is sent
+    // for each client, only the app and urls are changed.
+    return SrsTemplateCommandPacket::create_connect_app(app, tc_url, swf_url, page_url, args);
+}
+
+int SrsRtmpClient::expect_create_stream_result(int& stream_id)
+{
+    int ret = ERROR_SUCCESS;
+    
+    SrsCommonMessage* msg = NULL;
+    SrsCreateStreamResPacket* pkt = NULL;
+    if ((ret = expect_message<SrsCreateStreamResPacket>(&msg, &pkt)) != ERROR_SUCCESS) {
+        srs_error("expect create stream response message failed. ret=%d", ret);
+        return ret;
+    }
+    SrsAutoFree(SrsCommonMessage, msg);
+    SrsAutoFree(SrsCreateStreamResPacket, pkt);
+    srs_info("get create stream response message");
+    
+    stream_id = (int)pkt->stream_id;
+    
+    return ret;
+}
+
 SrsRtmpServer::SrsRtmpServer(ISrsProtocolReaderWriter* skt)
 {
     io = skt;
@@ -24033,7 +32722,7 @@ int SrsRtmpServer::identify_client(int stream_id, SrsRtmpConnType& type, string&
         }
         // call msg,
         // support response null first,
-        // @see https://github.com/simple-rtmp-server/srs/issues/106
+        // @see https://github.com/ossrs/srs/issues/106
         // TODO: FIXME: response in right way, or forward in edge mode.
         SrsCallPacket* call = dynamic_cast<SrsCallPacket*>(pkt);
         if (call) {
@@ -24041,7 +32730,9 @@ int SrsRtmpServer::identify_client(int stream_id, SrsRtmpConnType& type, string&
             res->command_object = SrsAmf0Any::null();
             res->response = SrsAmf0Any::null();
             if ((ret = protocol->send_and_free_packet(res, 0)) != ERROR_SUCCESS) {
-                srs_warn("response call failed. ret=%d", ret);
+                if (!srs_is_system_control_error(ret) && !srs_is_client_gracefully_close(ret)) {
+                    srs_warn("response call failed. ret=%d", ret);
+                }
                 return ret;
             }
             continue;
@@ -24123,7 +32814,7 @@ int SrsRtmpServer::start_play(int stream_id)
         SrsSampleAccessPacket* pkt = new SrsSampleAccessPacket();
 
         // allow audio/video sample.
-        // @see: https://github.com/simple-rtmp-server/srs/issues/49
+        // @see: https://github.com/ossrs/srs/issues/49
         pkt->audio_sample_access = true;
         pkt->video_sample_access = true;
         
@@ -24554,7 +33245,7 @@ int SrsConnectAppPacket::decode(SrsStream* stream)
     if (!stream->empty()) {
         srs_freep(args);
         
-        // see: https://github.com/simple-rtmp-server/srs/issues/186
+        // see: https://github.com/ossrs/srs/issues/186
         // the args maybe any amf0, for instance, a string. we should drop if not object.
         SrsAmf0Any* any = NULL;
         if ((ret = SrsAmf0Any::discovery(stream, &any)) != ERROR_SUCCESS) {
@@ -24749,6 +33440,197 @@ int SrsConnectAppResPacket::encode_packet(SrsStream* stream)
     return ret;
 }
 
+/**
+* build the amf0 templates of client commands,
+* the template starts with the command name and the transaction id field.
+*/
+static SrsAmf0Template* srs_amf0_command_template(const char* command_name)
+{
+    SrsAmf0Template* tmpl = new SrsAmf0Template();
+    
+    tmpl->append(SrsAmf0Any::str(command_name));
+    tmpl->append_number_field();
+    
+    return tmpl;
+}
+
+static SrsAmf0Template* srs_amf0_connect_app_template()
+{
+    SrsAmf0Template* tmpl = srs_amf0_command_template(RTMP_AMF0_COMMAND_CONNECT);
+    
+    tmpl->append_object_start();
+    tmpl->append_property_name("app");
+    tmpl->append_string_field();
+    tmpl->append_property_name("flashVer");
+    tmpl->append(SrsAmf0Any::str("WIN 15,0,0,239"));
+    tmpl->append_property_name("swfUrl");
+    tmpl->append_string_field();
+    tmpl->append_property_name("tcUrl");
+    tmpl->append_string_field();
+    tmpl->append_property_name("fpad");
+    tmpl->append(SrsAmf0Any::boolean(false));
+    tmpl->append_property_name("capabilities");
+    tmpl->append(SrsAmf0Any::number(239));
+    tmpl->append_property_name("audioCodecs");
+    tmpl->append(SrsAmf0Any::number(3575));
+    tmpl->append_property_name("videoCodecs");
+    tmpl->append(SrsAmf0Any::number(252));
+    tmpl->append_property_name("videoFunction");
+    tmpl->append(SrsAmf0Any::number(1));
+    tmpl->append_property_name("pageUrl");
+    tmpl->append_string_field();
+    tmpl->append_property_name("objectEncoding");
+    tmpl->append(SrsAmf0Any::number(0));
+    tmpl->append_object_eof();
+    
+    return tmpl;
+}
+
+static SrsAmf0Template* srs_amf0_create_stream_template()
+{
+    SrsAmf0Template* tmpl = srs_amf0_command_template(RTMP_AMF0_COMMAND_CREATE_STREAM);
+    tmpl->append(SrsAmf0Any::null());
+    return tmpl;
+}
+
+static SrsAmf0Template* srs_amf0_stream_command_template(const char* command_name)
+{
+    SrsAmf0Template* tmpl = srs_amf0_command_template(command_name);
+    tmpl->append(SrsAmf0Any::null());
+    tmpl->append_string_field();
+    return tmpl;
+}
+
+static SrsAmf0Template* srs_amf0_publish_template()
+{
+    SrsAmf0Template* tmpl = srs_amf0_stream_command_template(RTMP_AMF0_COMMAND_PUBLISH);
+    tmpl->append(SrsAmf0Any::str("live"));
+    return tmpl;
+}
+
+SrsTemplateCommandPacket::SrsTemplateCommandPacket(SrsAmf0Template* t, string name, double tid, int cid)
+{
+    tmpl = t;
+    command_name = name;
+    transaction_id = tid;
+    prefer_cid = cid;
+    // optional
+    args = NULL;
+}
+
+SrsTemplateCommandPacket::~SrsTemplateCommandPacket()
+{
+    srs_freep(args);
+}
+
+SrsTemplateCommandPacket* SrsTemplateCommandPacket::create_connect_app(
+    string app, string tc_url, string swf_url, string page_url, SrsAmf0Object* args
+) {
+    // the templates are built once, and shared by all packets.
+    static SrsAmf0Template* tmpl = srs_amf0_connect_app_template();
+    
+    SrsTemplateCommandPacket* pkt = new SrsTemplateCommandPacket(
+        tmpl, RTMP_AMF0_COMMAND_CONNECT, 1, RTMP_CID_OverConnection);
+    pkt->strings.push_back(app);
+    pkt->strings.push_back(swf_url);
+    pkt->strings.push_back(tc_url);
+    pkt->strings.push_back(page_url);
+    pkt->args = args;
+    return pkt;
+}
+
+SrsTemplateCommandPacket* SrsTemplateCommandPacket::create_create_stream(double transaction_id)
+{
+    static SrsAmf0Template* tmpl = srs_amf0_create_stream_template();
+    
+    return new SrsTemplateCommandPacket(
+        tmpl, RTMP_AMF0_COMMAND_CREATE_STREAM, transaction_id, RTMP_CID_OverConnection);
+}
+
+SrsTemplateCommandPacket* SrsTemplateCommandPacket::create_play(string stream)
+{
+    static SrsAmf0Template* tmpl = srs_amf0_stream_command_template(RTMP_AMF0_COMMAND_PLAY);
+    
+    SrsTemplateCommandPacket* pkt = new SrsTemplateCommandPacket(
+        tmpl, RTMP_AMF0_COMMAND_PLAY, 0, RTMP_CID_OverStream);
+    pkt->strings.push_back(stream);
+    return pkt;
+}
+
+SrsTemplateCommandPacket* SrsTemplateCommandPacket::create_publish(string stream)
+{
+    static SrsAmf0Template* tmpl = srs_amf0_publish_template();
+    
+    SrsTemplateCommandPacket* pkt = new SrsTemplateCommandPacket(
+        tmpl, RTMP_AMF0_COMMAND_PUBLISH, 0, RTMP_CID_OverStream);
+    pkt->strings.push_back(stream);
+    return pkt;
+}
+
+SrsTemplateCommandPacket* SrsTemplateCommandPacket::create_release_stream(string stream)
+{
+    static SrsAmf0Template* tmpl = srs_amf0_stream_command_template(RTMP_AMF0_COMMAND_RELEASE_STREAM);
+    
+    SrsTemplateCommandPacket* pkt = new SrsTemplateCommandPacket(
+        tmpl, RTMP_AMF0_COMMAND_RELEASE_STREAM, 2, RTMP_CID_OverConnection);
+    pkt->strings.push_back(stream);
+    return pkt;
+}
+
+SrsTemplateCommandPacket* SrsTemplateCommandPacket::create_FC_publish(string stream)
+{
+    static SrsAmf0Template* tmpl = srs_amf0_stream_command_template(RTMP_AMF0_COMMAND_FC_PUBLISH);
+    
+    SrsTemplateCommandPacket* pkt = new SrsTemplateCommandPacket(
+        tmpl, RTMP_AMF0_COMMAND_FC_PUBLISH, 3, RTMP_CID_OverConnection);
+    pkt->strings.push_back(stream);
+    return pkt;
+}
+
+int SrsTemplateCommandPacket::get_prefer_cid()
+{
+    return prefer_cid;
+}
+
+int SrsTemplateCommandPacket::get_message_type()
+{
+    return RTMP_MSG_AMF0CommandMessage;
+}
+
+int SrsTemplateCommandPacket::get_size()
+{
+    int size = tmpl->total_size(strings.empty()? NULL : &strings[0]);
+    
+    if (args) {
+        size += SrsAmf0Size::object(args);
+    }
+    
+    return size;
+}
+
+int SrsTemplateCommandPacket::encode_packet(SrsStream* stream)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert((int)strings.size() == tmpl->nb_strings());
+    
+    if ((ret = tmpl->write(stream, &transaction_id, strings.empty()? NULL : &strings[0])) != ERROR_SUCCESS) {
+        srs_error("encode command template failed. command=%s, ret=%d", command_name.c_str(), ret);
+        return ret;
+    }
+    srs_verbose("encode command template success.");
+    
+    if (args && (ret = args->write(stream)) != ERROR_SUCCESS) {
+        srs_error("encode args failed. ret=%d", ret);
+        return ret;
+    }
+    srs_verbose("encode args success.");
+    
+    srs_info("encode %s command packet success.", command_name.c_str());
+    
+    return ret;
+}
+
 SrsCallPacket::SrsCallPacket()
 {
     command_name = "";
@@ -26640,7 +35522,7 @@ int SrsUserControlPacket::encode_packet(SrsStream* stream)
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -26839,12 +35721,12 @@ namespace _srs_internal
         
         // maybe the key_size is 127, but dh will write all 128bytes pkey,
         // so, donot need to set/initialize the pkey.
-        // @see https://github.com/simple-rtmp-server/srs/issues/165
+        // @see https://github.com/ossrs/srs/issues/165
         key_size = BN_bn2bin(pdh->pub_key, (unsigned char*)pkey);
         srs_assert(key_size > 0);
         
         // output the size of public key.
-        // @see https://github.com/simple-rtmp-server/srs/issues/165
+        // @see https://github.com/ossrs/srs/issues/165
         srs_assert(key_size <= pkey_size);
         pkey_size = key_size;
         
@@ -26864,7 +35746,7 @@ namespace _srs_internal
         // if failed, donot return, do cleanup, @see ./test/dhtest.c:168
         // maybe the key_size is 127, but dh will write all 128bytes skey,
         // so, donot need to set/initialize the skey.
-        // @see https://github.com/simple-rtmp-server/srs/issues/165
+        // @see https://github.com/ossrs/srs/issues/165
         int32_t key_size = DH_compute_key((unsigned char*)skey, ppk, pdh);
         
         if (key_size < ppkey_size) {
@@ -26958,8 +35840,8 @@ namespace _srs_internal
     
     key_block::~key_block()
     {
-        srs_freep(random0);
-        srs_freep(random1);
+        srs_freepa(random0);
+        srs_freepa(random1);
     }
     
     int key_block::parse(SrsStream* stream)
@@ -26981,7 +35863,7 @@ namespace _srs_internal
         
         random0_size = valid_offset;
         if (random0_size > 0) {
-            srs_freep(random0);
+            srs_freepa(random0);
             random0 = new char[random0_size];
             stream->read_bytes(random0, random0_size);
         }
@@ -26990,7 +35872,7 @@ namespace _srs_internal
         
         random1_size = 764 - valid_offset - 128 - 4;
         if (random1_size > 0) {
-            srs_freep(random1);
+            srs_freepa(random1);
             random1 = new char[random1_size];
             stream->read_bytes(random1, random1_size);
         }
@@ -27040,8 +35922,8 @@ namespace _srs_internal
     
     digest_block::~digest_block()
     {
-        srs_freep(random0);
-        srs_freep(random1);
+        srs_freepa(random0);
+        srs_freepa(random1);
     }
 
     int digest_block::parse(SrsStream* stream)
@@ -27058,7 +35940,7 @@ namespace _srs_internal
         
         random0_size = valid_offset;
         if (random0_size > 0) {
-            srs_freep(random0);
+            srs_freepa(random0);
             random0 = new char[random0_size];
             stream->read_bytes(random0, random0_size);
         }
@@ -27067,7 +35949,7 @@ namespace _srs_internal
         
         random1_size = 764 - 4 - valid_offset - 32;
         if (random1_size > 0) {
-            srs_freep(random1);
+            srs_freepa(random1);
             random1 = new char[random1_size];
             stream->read_bytes(random1, random1_size);
         }
@@ -27126,7 +36008,7 @@ namespace _srs_internal
         }
         
         srs_assert(c1_digest != NULL);
-        SrsAutoFree(char, c1_digest);
+        SrsAutoFreeA(char, c1_digest);
         
         memcpy(digest.digest, c1_digest, 32);
         
@@ -27145,7 +36027,7 @@ namespace _srs_internal
         }
         
         srs_assert(c1_digest != NULL);
-        SrsAutoFree(char, c1_digest);
+        SrsAutoFreeA(char, c1_digest);
         
         is_valid = srs_bytes_equals(digest.digest, c1_digest, 32);
         
@@ -27164,7 +36046,7 @@ namespace _srs_internal
         }
         
         // directly generate the public key.
-        // @see: https://github.com/simple-rtmp-server/srs/issues/148
+        // @see: https://github.com/ossrs/srs/issues/148
         int pkey_size = 128;
         if ((ret = dh.copy_shared_key(c1->get_key(), 128, key.key, pkey_size)) != ERROR_SUCCESS) {
             srs_error("calc s1 key failed. ret=%d", ret);
@@ -27185,7 +36067,7 @@ namespace _srs_internal
         srs_verbose("calc s1 digest success.");
         
         srs_assert(s1_digest != NULL);
-        SrsAutoFree(char, s1_digest);
+        SrsAutoFreeA(char, s1_digest);
         
         memcpy(digest.digest, s1_digest, 32);
         srs_verbose("copy s1 key success.");
@@ -27205,7 +36087,7 @@ namespace _srs_internal
         }
         
         srs_assert(s1_digest != NULL);
-        SrsAutoFree(char, s1_digest);
+        SrsAutoFreeA(char, s1_digest);
         
         is_valid = srs_bytes_equals(digest.digest, s1_digest, 32);
         
@@ -27224,14 +36106,14 @@ namespace _srs_internal
         * @return a new allocated bytes, user must free it.
         */
         char* c1s1_joined_bytes = new char[1536 -32];
-        SrsAutoFree(char, c1s1_joined_bytes);
+        SrsAutoFreeA(char, c1s1_joined_bytes);
         if ((ret = copy_to(owner, c1s1_joined_bytes, 1536 - 32, false)) != ERROR_SUCCESS) {
             return ret;
         }
         
         c1_digest = new char[SRS_OpensslHashSize];
         if ((ret = openssl_HMACsha256(SrsGenuineFPKey, 30, c1s1_joined_bytes, 1536 - 32, c1_digest)) != ERROR_SUCCESS) {
-            srs_freep(c1_digest);
+            srs_freepa(c1_digest);
             srs_error("calc digest for c1 failed. ret=%d", ret);
             return ret;
         }
@@ -27252,14 +36134,14 @@ namespace _srs_internal
         * @return a new allocated bytes, user must free it.
         */
         char* c1s1_joined_bytes = new char[1536 -32];
-        SrsAutoFree(char, c1s1_joined_bytes);
+        SrsAutoFreeA(char, c1s1_joined_bytes);
         if ((ret = copy_to(owner, c1s1_joined_bytes, 1536 - 32, false)) != ERROR_SUCCESS) {
             return ret;
         }
         
         s1_digest = new char[SRS_OpensslHashSize];
         if ((ret = openssl_HMACsha256(SrsGenuineFMSKey, 36, c1s1_joined_bytes, 1536 - 32, s1_digest)) != ERROR_SUCCESS) {
-            srs_freep(s1_digest);
+            srs_freepa(s1_digest);
             srs_error("calc digest for s1 failed. ret=%d", ret);
             return ret;
         }
@@ -27544,7 +36426,7 @@ namespace _srs_internal
         }
         
         // client c1 time and version
-        time = ::time(NULL);
+        time = (int32_t)::time(NULL);
         version = 0x80000702; // client c1 version
 
         // generate signature by schema
@@ -28023,7 +36905,7 @@ int SrsComplexHandshake::handshake_with_server(SrsHandshakeBytes* hs_bytes, ISrs
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -28045,7 +36927,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 //#include <srs_rtmp_utility.hpp>
 
-// for srs-librtmp, @see https://github.com/simple-rtmp-server/srs/issues/213
+// for srs-librtmp, @see https://github.com/ossrs/srs/issues/213
 #ifndef _WIN32
 #include <unistd.h>
 #endif
@@ -28239,7 +37121,7 @@ int srs_rtmp_create_msg(char type, u_int32_t timestamp, char* data, int size, in
 
     // only when failed, we must free the data.
     if ((ret = srs_do_rtmp_create_msg(type, timestamp, data, size, stream_id, ppmsg)) != ERROR_SUCCESS) {
-        srs_freep(data);
+        srs_freepa(data);
         return ret;
     }
 
@@ -28266,10 +37148,10 @@ int srs_write_large_iovs(ISrsProtocolReaderWriter* skt, iovec* iovs, int size, s
     int ret = ERROR_SUCCESS;
     
     // the limits of writev iovs.
-    // for srs-librtmp, @see https://github.com/simple-rtmp-server/srs/issues/213
+    // for srs-librtmp, @see https://github.com/ossrs/srs/issues/213
 #ifndef _WIN32
     // for linux, generally it's 1024.
-    static int limits = sysconf(_SC_IOV_MAX);
+    static int limits = (int)sysconf(_SC_IOV_MAX);
 #else
     static int limits = 1024;
 #endif
@@ -28305,7 +37187,7 @@ int srs_write_large_iovs(ISrsProtocolReaderWriter* skt, iovec* iovs, int size, s
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -28344,7 +37226,7 @@ SrsMessageArray::~SrsMessageArray()
     // we just free the msgs itself,
     // both delete and delete[] is ok,
     // for each msg in msgs is already freed by send_and_free_messages.
-    srs_freep(msgs);
+    srs_freepa(msgs);
 }
 
 void SrsMessageArray::free(int count)
@@ -28371,7 +37253,7 @@ void SrsMessageArray::zero(int count)
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -28558,7 +37440,7 @@ int SrsFastBuffer::grow(ISrsBufferReader* reader, int required_size)
         * to improve read performance, merge some packets then read,
         * when it on and read small bytes, we sleep to wait more data.,
         * that is, we merge some data to read together.
-        * @see https://github.com/simple-rtmp-server/srs/issues/241
+        * @see https://github.com/ossrs/srs/issues/241
         */
         if (merged_read && _handler) {
             _handler->on_read(nread);
@@ -28586,7 +37468,7 @@ void SrsFastBuffer::set_merge_read(bool v, IMergeReadHandler* handler)
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -28742,7 +37624,7 @@ int SrsRawH264Stream::mux_sequence_header(string sps, string pps, u_int32_t dts,
         + 3 + (int)sps.length() 
         + 3 + (int)pps.length();
     char* packet = new char[nb_packet];
-    SrsAutoFree(char, packet);
+    SrsAutoFreeA(char, packet);
 
     // use stream to generate the h264 packet.
     SrsStream stream;
@@ -28821,7 +37703,7 @@ int SrsRawH264Stream::mux_ipb_frame(char* frame, int nb_frame, string& ibp)
     //      NALUnit
     int nb_packet = 4 + nb_frame;
     char* packet = new char[nb_packet];
-    SrsAutoFree(char, packet);
+    SrsAutoFreeA(char, packet);
     
     // use stream to generate the h264 packet.
     SrsStream stream;
@@ -28887,6 +37769,159 @@ int SrsRawH264Stream::mux_avc2flv(string video, int8_t frame_type, int8_t avc_pa
     return ret;
 }
 
+SrsRawHEVCStream::SrsRawHEVCStream()
+{
+}
+
+SrsRawHEVCStream::~SrsRawHEVCStream()
+{
+}
+
+bool SrsRawHEVCStream::is_vps(char* frame, int nb_frame)
+{
+    srs_assert(nb_frame > 0);
+    
+    // 6bits, 7.3.1.2 NAL unit header syntax,
+    // H.265-HEVC-ITU-T-REC-H.265-201304.pdf, page 31.
+    //  32: VPS, 33: SPS, 34: PPS
+    u_int8_t nal_unit_type = (frame[0] >> 1) & 0x3f;
+    
+    return nal_unit_type == SrsHevcNaluTypeVPS;
+}
+
+bool SrsRawHEVCStream::is_sps(char* frame, int nb_frame)
+{
+    srs_assert(nb_frame > 0);
+    
+    u_int8_t nal_unit_type = (frame[0] >> 1) & 0x3f;
+    
+    return nal_unit_type == SrsHevcNaluTypeSPS;
+}
+
+bool SrsRawHEVCStream::is_pps(char* frame, int nb_frame)
+{
+    srs_assert(nb_frame > 0);
+    
+    u_int8_t nal_unit_type = (frame[0] >> 1) & 0x3f;
+    
+    return nal_unit_type == SrsHevcNaluTypePPS;
+}
+
+int SrsRawHEVCStream::mux_sequence_header(string vps, string sps, string pps, string& sh)
+{
+    int ret = ERROR_SUCCESS;
+    
+    SrsHevcSps info;
+    if ((ret = srs_hevc_demux_sps((char*)sps.data(), (int)sps.length(), &info)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // 23bytes header:
+    //      configurationVersion to lengthSizeMinusOne, numOfArrays
+    // for each of the vps, sps and pps, 5bytes array header:
+    //      array_completeness, NAL_unit_type, numNalus(2B), nalUnitLength(2B)
+    // Nbytes of nalu.
+    //      nalUnit
+    int nb_packet = 23
+        + 5 + (int)vps.length()
+        + 5 + (int)sps.length()
+        + 5 + (int)pps.length();
+    char* packet = new char[nb_packet];
+    SrsAutoFreeA(char, packet);
+    
+    // use stream to generate the hevc packet.
+    SrsStream stream;
+    if ((ret = stream.initialize(packet, nb_packet)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // 8.3.3.1.2 Syntax, ISO_IEC_14496-15-2014.pdf, page 55
+    // configurationVersion
+    stream.write_1bytes(0x01);
+    // general_profile_space(2bits), general_tier_flag(1bit), general_profile_idc(5bits)
+    stream.write_1bytes((info.general_profile_space << 6) | (info.general_tier_flag << 5) | info.general_profile_idc);
+    // general_profile_compatibility_flags
+    stream.write_4bytes(info.general_profile_compatibility_flags);
+    // general_constraint_indicator_flags, 48bits
+    stream.write_4bytes((int32_t)(info.general_constraint_indicator_flags >> 16));
+    stream.write_2bytes((int16_t)(info.general_constraint_indicator_flags & 0xffff));
+    // general_level_idc
+    stream.write_1bytes(info.general_level_idc);
+    // reserved(4bits) 1111, min_spatial_segmentation_idc(12bits) 0
+    stream.write_2bytes(0xf000);
+    // reserved(6bits) 111111, parallelismType(2bits) 0, unknown
+    stream.write_1bytes(0xfc);
+    // reserved(6bits) 111111, chromaFormat(2bits)
+    stream.write_1bytes(0xfc | (info.chroma_format_idc & 0x03));
+    // reserved(5bits) 11111, bitDepthLumaMinus8(3bits)
+    stream.write_1bytes(0xf8 | (info.bit_depth_luma_minus8 & 0x07));
+    // reserved(5bits) 11111, bitDepthChromaMinus8(3bits)
+    stream.write_1bytes(0xf8 | (info.bit_depth_chroma_minus8 & 0x07));
+    // avgFrameRate, 0 for unspecified
+    stream.write_2bytes(0x00);
+    // constantFrameRate(2bits) 0, numTemporalLayers(3bits), temporalIdNested(1bit),
+    // lengthSizeMinusOne(2bits), always use 4bytes size, so we always set it to 0x03.
+    stream.write_1bytes(((info.sps_max_sub_layers_minus1 + 1) << 3) | (info.sps_temporal_id_nesting_flag << 2) | 0x03);
+    // numOfArrays, the vps, sps and pps.
+    stream.write_1bytes(0x03);
+    
+    string nalus[] = { vps, sps, pps };
+    SrsHevcNaluType types[] = { SrsHevcNaluTypeVPS, SrsHevcNaluTypeSPS, SrsHevcNaluTypePPS };
+    for (int i = 0; i < 3; i++) {
+        // array_completeness(1bit) 1, for the parameter sets are not in the stream,
+        // reserved(1bit) 0, NAL_unit_type(6bits)
+        stream.write_1bytes(0x80 | types[i]);
+        // numNalus, always 1
+        stream.write_2bytes(0x01);
+        // nalUnitLength
+        stream.write_2bytes(nalus[i].length());
+        // nalUnit
+        stream.write_string(nalus[i]);
+    }
+    
+    sh = "";
+    sh.append(packet, nb_packet);
+    
+    return ret;
+}
+
+int SrsRawHEVCStream::mux_hevc2flv(string video, int8_t frame_type, int8_t packet_type, u_int32_t dts, u_int32_t pts, char** flv, int* nb_flv)
+{
+    int ret = ERROR_SUCCESS;
+    
+    // for hevc in enhanced RTMP video payload, there is 5 or 8bytes header:
+    //      1bytes, IsExHeader | FrameType | PacketType
+    //      4bytes, FourCC, the 'hvc1'
+    //      3bytes, CompositionTime, the cts, only for the coded frames.
+    // @see https://github.com/veovera/enhanced-rtmp
+    bool has_cts = packet_type == SrsCodecVideoExPacketTypeCodedFrames;
+    int size = (int)video.length() + (has_cts? 8 : 5);
+    char* data = new char[size];
+    
+    SrsStream stream;
+    if ((ret = stream.initialize(data, size)) != ERROR_SUCCESS) {
+        srs_freepa(data);
+        return ret;
+    }
+    
+    stream.write_1bytes(SRS_FLV_VIDEO_EX_HEADER | (frame_type << 4) | packet_type);
+    stream.write_4bytes(SRS_FLV_VIDEO_FOURCC_HEVC);
+    
+    // CompositionTime
+    // cts = pts - dts.
+    if (has_cts) {
+        stream.write_3bytes((int32_t)(pts - dts));
+    }
+    
+    // h.265 raw data.
+    stream.write_string(video);
+    
+    *flv = data;
+    *nb_flv = size;
+    
+    return ret;
+}
+
 SrsRawAacStream::SrsRawAacStream()
 {
 }
@@ -28905,7 +37940,7 @@ int SrsRawAacStream::adts_demux(SrsStream* stream, char** pframe, int* pnb_frame
         // decode the ADTS.
         // @see aac-iso-13818-7.pdf, page 26
         //      6.2 Audio Data Transport Stream, ADTS
-        // @see https://github.com/simple-rtmp-server/srs/issues/212#issuecomment-64145885
+        // @see https://github.com/ossrs/srs/issues/212#issuecomment-64145885
         // byte_alignment()
         
         // adts_fixed_header:
@@ -28968,7 +38003,7 @@ int SrsRawAacStream::adts_demux(SrsStream* stream, char** pframe, int* pnb_frame
         int8_t channel_configuration = (sfiv >> 6) & 0x07;
         /*int8_t original = (sfiv >> 5) & 0x01;*/
         /*int8_t home = (sfiv >> 4) & 0x01;*/
-        //int8_t Emphasis; @remark, Emphasis is removed, @see https://github.com/simple-rtmp-server/srs/issues/212#issuecomment-64154736
+        //int8_t Emphasis; @remark, Emphasis is removed, @see https://github.com/ossrs/srs/issues/212#issuecomment-64154736
         // 4bits left.
         // adts_variable_header(), 1.A.2.2.2 Variable Header of ADTS
         // copyright_identification_bit 1 bslbf
@@ -29058,7 +38093,7 @@ int SrsRawAacStream::mux_sequence_header(SrsRawAacStreamCodec* codec, string& sh
     char samplingFrequencyIndex = codec->sampling_frequency_index;
 
     // override the aac samplerate by user specified.
-    // @see https://github.com/simple-rtmp-server/srs/issues/212#issuecomment-64146899
+    // @see https://github.com/ossrs/srs/issues/212#issuecomment-64146899
     switch (codec->sound_rate) {
         case SrsCodecAudioSampleRate11025: 
             samplingFrequencyIndex = 0x0a; break;
@@ -29146,7 +38181,7 @@ int SrsRawAacStream::mux_aac2flv(char* frame, int nb_frame, SrsRawAacStreamCodec
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -29168,6 +38203,8 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 //#include <srs_rtsp_stack.hpp>
 
+#if !defined(SRS_EXPORT_LIBRTMP)
+
 #include <stdlib.h>
 #include <map>
 using namespace std;
@@ -29691,7 +38728,7 @@ int SrsRtspSdp::parse_fmtp_attribute(string attr)
                 }
 
                 char* tmp_sh = new char[item_value.length()];
-                SrsAutoFree(char, tmp_sh);
+                SrsAutoFreeA(char, tmp_sh);
                 int nb_tmp_sh = ff_hex_to_data((u_int8_t*)tmp_sh, item_value.c_str());
                 srs_assert(nb_tmp_sh > 0);
                 audio_sh.append(tmp_sh, nb_tmp_sh);
@@ -29746,7 +38783,7 @@ string SrsRtspSdp::base64_decode(string value)
 
     int nb_output = (int)(value.length() * 2);
     u_int8_t* output = new u_int8_t[nb_output];
-    SrsAutoFree(u_int8_t, output);
+    SrsAutoFreeA(u_int8_t, output);
 
     int ret = srs_av_base64_decode(output, (char*)value.c_str(), nb_output);
     if (ret <= 0) {
@@ -30327,11 +39364,13 @@ int SrsRtspStack::recv_token(std::string& token, SrsRtspTokenState& state, char
 
 #endif
 
+#endif
+
 // following is generated by src/protocol/srs_http_stack.cpp
 /*
  The MIT License (MIT)
  
- Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+ Copyright (c) 2013-2015 SRS(ossrs)
  
  Permission is hereby granted, free of charge, to any person obtaining a copy of
  this software and associated documentation files (the "Software"), to deal in
@@ -30353,18 +39392,161 @@ int SrsRtspStack::recv_token(std::string& token, SrsRtspTokenState& state, char
 
 //#include <srs_http_stack.hpp>
 
+#if !defined(SRS_EXPORT_LIBRTMP)
+
 #include <stdlib.h>
+#include <errno.h>
 #include <sstream>
 #include <algorithm>
 using namespace std;
 
+#ifdef __linux__
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/sendfile.h>
+#endif
+
 //#include <srs_kernel_error.hpp>
 //#include <srs_kernel_log.hpp>
 //#include <srs_kernel_utility.hpp>
 //#include <srs_kernel_file.hpp>
+//#include <srs_kernel_flv.hpp>
+//#include <srs_kernel_codec.hpp>
+//#include <srs_core_autofree.hpp>
+//#include <srs_protocol_json.hpp>
 
 #define SRS_HTTP_DEFAULT_PAGE "index.html"
 
+#ifdef __linux__
+// wait for fd writable, for the nonblocking out fd.
+int srs_sendfile_wait(int fd)
+{
+    int ret = ERROR_SUCCESS;
+    
+    pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLOUT;
+    pfd.revents = 0;
+    
+    int r0 = ::poll(&pfd, 1, (int)(SRS_CONSTS_RTMP_SEND_TIMEOUT_US / 1000));
+    if (r0 == 0) {
+        return ERROR_SOCKET_TIMEOUT;
+    }
+    if (r0 < 0 && errno != EINTR) {
+        return ERROR_SOCKET_WAIT;
+    }
+    
+    return ret;
+}
+
+// splice the file to out fd over pipe, when sendfile not work.
+int srs_sendfile_splice(int out_fd, int in_fd, int64_t offset, int64_t size, int64_t* pnwrite)
+{
+    int ret = ERROR_SUCCESS;
+    
+    int fds[2];
+    if (::pipe(fds) < 0) {
+        return ERROR_HTTP_ZERO_COPY_UNSUPPORTED;
+    }
+    
+    loff_t off = offset;
+    int64_t left = size;
+    // the bytes in pipe, not sent to out fd yet.
+    int64_t inpipe = 0;
+    
+    while (left > 0 || inpipe > 0) {
+        if (left > 0 && inpipe == 0) {
+            ssize_t nb = ::splice(in_fd, &off, fds[1], NULL, (size_t)srs_min(left, (int64_t)1048576), SPLICE_F_MOVE);
+            if (nb < 0 && errno == EINTR) {
+                continue;
+            }
+            if (nb < 0) {
+                ret = (*pnwrite == 0 && errno == EINVAL)? ERROR_HTTP_ZERO_COPY_UNSUPPORTED : ERROR_SYSTEM_FILE_READ;
+                break;
+            }
+            if (nb == 0) {
+                ret = ERROR_SYSTEM_FILE_EOF;
+                break;
+            }
+            left -= nb;
+            inpipe += nb;
+        }
+        
+        ssize_t nb = ::splice(fds[0], NULL, out_fd, NULL, (size_t)inpipe, SPLICE_F_MOVE | SPLICE_F_MORE);
+        if (nb < 0 && errno == EINTR) {
+            continue;
+        }
+        if (nb < 0 && errno == EAGAIN) {
+            if ((ret = srs_sendfile_wait(out_fd)) != ERROR_SUCCESS) {
+                break;
+            }
+            continue;
+        }
+        if (nb < 0) {
+            ret = (*pnwrite == 0 && errno == EINVAL)? ERROR_HTTP_ZERO_COPY_UNSUPPORTED : ERROR_SOCKET_WRITE;
+            break;
+        }
+        inpipe -= nb;
+        *pnwrite += nb;
+    }
+    
+    ::close(fds[0]);
+    ::close(fds[1]);
+    
+    return ret;
+}
+
+int srs_sendfile(int out_fd, int in_fd, int64_t offset, int64_t size, int64_t* pnwrite)
+{
+    int ret = ERROR_SUCCESS;
+    
+    int64_t nwrite = 0;
+    
+    off_t off = (off_t)offset;
+    while (nwrite < size) {
+        ssize_t nb = ::sendfile(out_fd, in_fd, &off, (size_t)srs_min(size - nwrite, (int64_t)0x7ffff000));
+        if (nb < 0 && errno == EINTR) {
+            continue;
+        }
+        if (nb < 0 && errno == EAGAIN) {
+            if ((ret = srs_sendfile_wait(out_fd)) != ERROR_SUCCESS) {
+                break;
+            }
+            continue;
+        }
+        // sendfile not work for the fds, for example, in fd not support mmap.
+        if (nb < 0 && nwrite == 0 && (errno == EINVAL || errno == ENOSYS)) {
+            ret = srs_sendfile_splice(out_fd, in_fd, offset, size, &nwrite);
+            break;
+        }
+        if (nb < 0) {
+            ret = ERROR_SOCKET_WRITE;
+            break;
+        }
+        if (nb == 0) {
+            ret = ERROR_SYSTEM_FILE_EOF;
+            break;
+        }
+        nwrite += nb;
+    }
+    
+    if (pnwrite) {
+        *pnwrite = nwrite;
+    }
+    
+    return ret;
+}
+#else
+int srs_sendfile(int /*out_fd*/, int /*in_fd*/, int64_t /*offset*/, int64_t /*size*/, int64_t* pnwrite)
+{
+    if (pnwrite) {
+        *pnwrite = 0;
+    }
+    return ERROR_HTTP_ZERO_COPY_UNSUPPORTED;
+}
+#endif
+
 // get the status text of code.
 string srs_generate_http_status_text(int status)
 {
@@ -30449,8 +39631,11 @@ string srs_go_http_detect(char* data, int size)
     return "application/octet-stream"; // fallback
 }
 
-// Error replies to the request with the specified error message and HTTP code.
-// The error message should be plain text.
+int srs_go_http_error(ISrsHttpResponseWriter* w, int code)
+{
+    return srs_go_http_error(w, code, srs_generate_http_status_text(code));
+}
+
 int srs_go_http_error(ISrsHttpResponseWriter* w, int code, string error)
 {
     int ret = ERROR_SUCCESS;
@@ -30463,16 +39648,6 @@ int srs_go_http_error(ISrsHttpResponseWriter* w, int code, string error)
     return ret;
 }
 
-int srs_http_response_json(ISrsHttpResponseWriter* w, string data)
-{
-    SrsHttpHeader* h = w->header();
-    
-    h->set_content_length(data.length());
-    h->set_content_type("application/json");
-    
-    return w->write((char*)data.data(), (int)data.length());
-}
-
 SrsHttpHeader::SrsHttpHeader()
 {
 }
@@ -30541,6 +39716,14 @@ ISrsHttpResponseWriter::~ISrsHttpResponseWriter()
 {
 }
 
+int ISrsHttpResponseWriter::sendfile(int /*fd*/, int64_t /*offset*/, int64_t /*size*/, int64_t* pnwrite)
+{
+    if (pnwrite) {
+        *pnwrite = 0;
+    }
+    return ERROR_HTTP_ZERO_COPY_UNSUPPORTED;
+}
+
 ISrsHttpResponseReader::ISrsHttpResponseReader()
 {
 }
@@ -30576,17 +39759,23 @@ SrsHttpRedirectHandler::~SrsHttpRedirectHandler()
 int SrsHttpRedirectHandler::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
 {
     int ret = ERROR_SUCCESS;
-    string msg = "Moved Permsanently";
+    
+    string location = url;
+    if (!r->query().empty()) {
+        location += "?" + r->query();
+    }
+    
+    string msg = "Redirect to" + location;
 
     w->header()->set_content_type("text/plain; charset=utf-8");
     w->header()->set_content_length(msg.length());
-    w->header()->set("Location", url);
+    w->header()->set("Location", location);
     w->write_header(code);
 
     w->write((char*)msg.data(), (int)msg.length());
     w->final_request();
 
-    srs_info("redirect to %s.", url.c_str());
+    srs_info("redirect to %s.", location.c_str());
     return ret;
 }
 
@@ -30605,7 +39794,7 @@ bool SrsHttpNotFoundHandler::is_not_found()
 
 int SrsHttpNotFoundHandler::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
 {
-    return srs_go_http_error(w, SRS_CONSTS_HTTP_NotFound, SRS_CONSTS_HTTP_NotFound_str);
+    return srs_go_http_error(w, SRS_CONSTS_HTTP_NotFound);
 }
 
 SrsHttpFileServer::SrsHttpFileServer(string root_dir)
@@ -30722,9 +39911,9 @@ int SrsHttpFileServer::serve_file(ISrsHttpResponseWriter* w, ISrsHttpMessage* r,
     
     // write body.
     int64_t left = length;
-    if ((ret = copy(w, &fs, r, (int)left)) != ERROR_SUCCESS) {
+    if ((ret = copy(w, &fs, r, left)) != ERROR_SUCCESS) {
         if (!srs_is_client_gracefully_close(ret)) {
-            srs_error("read file=%s size=%d failed, ret=%d", fullpath.c_str(), left, ret);
+            srs_error("read file=%s size=%"PRId64" failed, ret=%d", fullpath.c_str(), left, ret);
         }
         return ret;
     }
@@ -30739,7 +39928,7 @@ int SrsHttpFileServer::serve_flv_file(ISrsHttpResponseWriter* w, ISrsHttpMessage
         return serve_file(w, r, fullpath);
     }
     
-    int offset = ::atoi(start.c_str());
+    int64_t offset = ::atoll(start.c_str());
     if (offset <= 0) {
         return serve_file(w, r, fullpath);
     }
@@ -30757,23 +39946,47 @@ int SrsHttpFileServer::serve_mp4_file(ISrsHttpResponseWriter* w, ISrsHttpMessage
     if (range.empty()) {
         range = r->query_get("bytes");
     }
+    // or, use the standard http Range header, for example, Range: bytes=0-1023
+    for (int i = 0; range.empty() && i < r->request_header_count(); i++) {
+        std::string key = r->request_header_key_at(i);
+        std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+        if (key != "range") {
+            continue;
+        }
+        
+        std::string value = r->request_header_value_at(i);
+        if (srs_string_starts_with(value, "bytes=")) {
+            range = value.substr(6);
+        }
+    }
+    
+    // the mp4 always supports range, even serve the whole file.
+    w->header()->set("Accept-Ranges", "bytes");
     
-    // rollback to serve whole file.
+    // rollback to serve whole file, 
+    // and the multiple ranges are not supported, serve whole file.
     size_t pos = string::npos;
-    if (range.empty() || (pos = range.find("-")) == string::npos) {
+    if (range.empty() || (pos = range.find("-")) == string::npos || range.find(",") != string::npos) {
         return serve_file(w, r, fullpath);
     }
     
-    // parse the start in query string
-    int start = 0;
-    if (pos > 0) {
-        start = ::atoi(range.substr(0, pos).c_str());
+    // the suffix range, the last bytes of file, for example, bytes=-500,
+    // @see RFC7233, 2.1 Byte Ranges.
+    if (pos == 0) {
+        int64_t suffix = ::atoll(range.substr(1).c_str());
+        if (suffix < 0) {
+            return serve_file(w, r, fullpath);
+        }
+        return serve_mp4_stream(w, r, fullpath, -1, suffix);
     }
     
+    // parse the start in query string
+    int64_t start = ::atoll(range.substr(0, pos).c_str());
+    
     // parse end in query string.
-    int end = -1;
+    int64_t end = -1;
     if (pos < range.length() - 1) {
-        end = ::atoi(range.substr(pos + 1).c_str());
+        end = ::atoll(range.substr(pos + 1).c_str());
     }
     
     // invalid param, serve as whole mp4 file.
@@ -30784,26 +39997,212 @@ int SrsHttpFileServer::serve_mp4_file(ISrsHttpResponseWriter* w, ISrsHttpMessage
     return serve_mp4_stream(w, r, fullpath, start, end);
 }
 
-int SrsHttpFileServer::serve_flv_stream(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, string fullpath, int offset)
+int SrsHttpFileServer::serve_flv_stream(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, string fullpath, int64_t offset)
 {
-    return serve_file(w, r, fullpath);
+    int ret = ERROR_SUCCESS;
+    
+    SrsFileReader fs;
+    
+    // open flv file
+    if ((ret = fs.open(fullpath)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    if (offset > fs.filesize()) {
+        ret = ERROR_HTTP_REMUX_OFFSET_OVERFLOW;
+        srs_warn("http flv streaming %s overflow. size=%"PRId64", offset=%"PRId64", ret=%d",
+            fullpath.c_str(), fs.filesize(), offset, ret);
+        return ret;
+    }
+    
+    SrsFlvVodStreamDecoder ffd;
+    
+    // open fast decoder
+    if ((ret = ffd.initialize(&fs)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // save header, send later.
+    char flv_header[13];
+    
+    // send flv header
+    if ((ret = ffd.read_header_ext(flv_header)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // save sequence header, send later
+    int64_t sh_start = 0;
+    int sh_size = 0;
+    if ((ret = ffd.read_sequence_header_summary(&sh_start, &sh_size)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    if (sh_size <= 0) {
+        srs_warn("http flv streaming %s no sequence header, serve whole file.", fullpath.c_str());
+        return serve_file(w, r, fullpath);
+    }
+    
+    char* sh_data = new char[sh_size];
+    SrsAutoFreeA(char, sh_data);
+    if ((ret = fs.read(sh_data, sh_size, NULL)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // the summary is the first audio and video tags, 
+    // serve whole file when none of them is sequence header.
+    bool has_sequence_header = false;
+    for (int pos = 0; pos + SRS_FLV_TAG_HEADER_SIZE <= sh_size;) {
+        char* tag = sh_data + pos;
+        int size = ((u_int8_t)tag[1] << 16) | ((u_int8_t)tag[2] << 8) | (u_int8_t)tag[3];
+        if (pos + SRS_FLV_TAG_HEADER_SIZE + size > sh_size) {
+            break;
+        }
+        
+        char* body = tag + SRS_FLV_TAG_HEADER_SIZE;
+        if ((tag[0] == 0x09 && SrsFlvCodec::video_is_sequence_header(body, size))
+            || (tag[0] == 0x08 && SrsFlvCodec::audio_is_sequence_header(body, size))
+        ) {
+            has_sequence_header = true;
+        }
+        pos += SRS_FLV_TAG_HEADER_SIZE + size + SRS_FLV_PREVIOUS_TAG_SIZE;
+    }
+    if (!has_sequence_header) {
+        srs_warn("http flv streaming %s no sequence header, serve whole file.", fullpath.c_str());
+        return serve_file(w, r, fullpath);
+    }
+    
+    // the offset must not fall into the header or sequence headers,
+    // which are always prepended to the response.
+    if (offset < sh_start + sh_size) {
+        offset = sh_start + sh_size;
+    }
+    
+    // seek to data offset
+    int64_t left = fs.filesize() - offset;
+    
+    // write http header for flv.
+    w->header()->set_content_length(sizeof(flv_header) + sh_size + left);
+    w->header()->set_content_type("video/x-flv");
+    
+    // write flv header and sequence header.
+    if ((ret = w->write(flv_header, sizeof(flv_header))) != ERROR_SUCCESS) {
+        return ret;
+    }
+    if ((ret = w->write(sh_data, sh_size)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // write body.
+    if ((ret = ffd.lseek(offset)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // send data
+    if ((ret = copy(w, &fs, r, left)) != ERROR_SUCCESS) {
+        if (!srs_is_client_gracefully_close(ret)) {
+            srs_error("read flv=%s size=%"PRId64" failed, ret=%d", fullpath.c_str(), left, ret);
+        }
+        return ret;
+    }
+    
+    return w->final_request();
 }
 
-int SrsHttpFileServer::serve_mp4_stream(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, string fullpath, int start, int end)
+int SrsHttpFileServer::serve_mp4_stream(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, string fullpath, int64_t start, int64_t end)
 {
-    return serve_file(w, r, fullpath);
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(start >= -1);
+    srs_assert(end == -1 || end >= 0);
+    
+    SrsFileReader fs;
+    
+    // open mp4 file
+    if ((ret = fs.open(fullpath)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    int64_t filesize = fs.filesize();
+    
+    // the suffix range of the last end bytes, the bytes=-0 is unsatisfiable.
+    if (start == -1) {
+        if (end == 0) {
+            start = filesize;
+        } else {
+            start = srs_max((int64_t)0, filesize - end);
+        }
+        end = -1;
+    }
+    
+    // parse -1 to whole file, the end is inclusive.
+    if (end == -1 || end >= filesize) {
+        end = filesize - 1;
+    }
+    
+    if (start > end) {
+        srs_warn("http mp4 streaming %s overflow. size=%"PRId64", start=%"PRId64", end=%"PRId64,
+            fullpath.c_str(), filesize, start, end);
+        
+        std::stringstream content_range;
+        content_range << "bytes */" << filesize;
+        w->header()->set("Content-Range", content_range.str());
+        
+        return srs_go_http_error(w, SRS_CONSTS_HTTP_RequestedRangeNotSatisfiable);
+    }
+    
+    // seek to data offset, [start, end] for range.
+    int64_t left = end - start + 1;
+    
+    // write http header for mp4.
+    w->header()->set_content_length(left);
+    w->header()->set_content_type("video/mp4");
+    w->header()->set("Accept-Ranges", "bytes");
+    
+    // response the content range header.
+    std::stringstream content_range;
+    content_range << "bytes " << start << "-" << end << "/" << filesize;
+    w->header()->set("Content-Range", content_range.str());
+    
+    w->write_header(SRS_CONSTS_HTTP_PartialContent);
+    
+    // write body.
+    fs.lseek(start);
+    
+    // send data
+    if ((ret = copy(w, &fs, r, left)) != ERROR_SUCCESS) {
+        if (!srs_is_client_gracefully_close(ret)) {
+            srs_error("read mp4=%s size=%"PRId64" failed, ret=%d", fullpath.c_str(), left, ret);
+        }
+        return ret;
+    }
+    
+    return w->final_request();
 }
 
-int SrsHttpFileServer::copy(ISrsHttpResponseWriter* w, SrsFileReader* fs, ISrsHttpMessage* r, int size)
+int SrsHttpFileServer::copy(ISrsHttpResponseWriter* w, SrsFileReader* fs, ISrsHttpMessage* r, int64_t size)
 {
     int ret = ERROR_SUCCESS;
     
-    int left = size;
+    // try zero copy from the fd, then fallback to read and write.
+    if (size > 0) {
+        int64_t pos = fs->tellg();
+        int64_t nwrite = 0;
+        ret = w->sendfile(fs->get_fd(), pos, size, &nwrite);
+        if (ret == ERROR_SUCCESS) {
+            fs->lseek(pos + size);
+            return ret;
+        }
+        if (ret != ERROR_HTTP_ZERO_COPY_UNSUPPORTED || nwrite > 0) {
+            return ret;
+        }
+        ret = ERROR_SUCCESS;
+    }
+    
+    int64_t left = size;
     char* buf = r->http_ts_send_buffer();
     
     while (left > 0) {
         ssize_t nread = -1;
-        int max_read = srs_min(left, SRS_HTTP_TS_SEND_BUFFER_SIZE);
+        int max_read = (int)srs_min(left, (int64_t)SRS_HTTP_TS_SEND_BUFFER_SIZE);
         if ((ret = fs->read(buf, max_read, &nread)) != ERROR_SUCCESS) {
             break;
         }
@@ -30951,7 +40350,7 @@ int SrsHttpServeMux::handle(std::string pattern, ISrsHttpHandler* handler)
             
             entry = new SrsHttpMuxEntry();
             entry->explicit_match = false;
-            entry->handler = new SrsHttpRedirectHandler(pattern, SRS_CONSTS_HTTP_MovedPermanently);
+            entry->handler = new SrsHttpRedirectHandler(pattern, SRS_CONSTS_HTTP_Found);
             entry->pattern = pattern;
             entry->handler->entry = entry;
             
@@ -31102,18 +40501,20 @@ ISrsHttpMessage::ISrsHttpMessage()
 
 ISrsHttpMessage::~ISrsHttpMessage()
 {
-    srs_freep(_http_ts_send_buffer);
+    srs_freepa(_http_ts_send_buffer);
 }
 
 char* ISrsHttpMessage::http_ts_send_buffer()
 {
     return _http_ts_send_buffer;
 }
+
+#endif
 // following is generated by src/protocol/srs_protocol_kbps.cpp
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -31366,7 +40767,7 @@ void SrsKbps::sample()
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -31389,14 +40790,17 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //#include <srs_librtmp.hpp>
 
 #include <stdlib.h>
+#include <stdio.h>
 
-// for srs-librtmp, @see https://github.com/simple-rtmp-server/srs/issues/213
+// for srs-librtmp, @see https://github.com/ossrs/srs/issues/213
 #ifndef _WIN32
 #include <sys/time.h>
+#include <time.h>
 #endif
 
 #include <string>
 #include <sstream>
+#include <vector>
 using namespace std;
 
 //#include <srs_kernel_error.hpp>
@@ -31411,6 +40815,11 @@ using namespace std;
 //#include <srs_kernel_flv.hpp>
 //#include <srs_kernel_codec.hpp>
 //#include <srs_kernel_file.hpp>
+//#include <srs_kernel_buffer.hpp>
+//#include <srs_kernel_ts.hpp>
+//#include <srs_kernel_hls.hpp>
+//#include <srs_kernel_mp4.hpp>
+//#include <srs_kernel_udp.hpp>
 //#include <srs_lib_bandwidth.hpp>
 //#include <srs_raw_avc.hpp>
 
@@ -31418,6 +40827,54 @@ using namespace std;
 ISrsLog* _srs_log = new ISrsLog();
 ISrsThreadContext* _srs_context = new ISrsThreadContext();
 
+struct Context;
+
+/**
+* the ingester of ts, demux the h.264 and aac from ts,
+* then publish them over RTMP.
+* @see srs_rtmp_write_ts
+*/
+class TsIngester : public ISrsTsHandler
+{
+private:
+    Context* context;
+    SrsTsContext ts;
+    // the partial ts packet at the end of last write,
+    // completed by the next write.
+    char left[SRS_TS_PACKET_SIZE];
+    int nb_left;
+    // the pid of the published video and audio, -1 when not found,
+    // only the first h.264 and aac stream is published.
+    int vpid;
+    int apid;
+    // the last timestamp in 90khz, the raw 33bits one and the unwrapped one,
+    // -1 when not initialized.
+    int64_t last_raw;
+    int64_t last_ts;
+    // the NALUs of video in the PES payload, reused for each PES.
+    vector<char*> nalus;
+    vector<int> nb_nalus;
+public:
+    TsIngester(Context* c);
+    virtual ~TsIngester();
+public:
+    /**
+    * write the ts bytes, the whole ts packets are decoded in place,
+    * the partial ts packet is left for the next write.
+    */
+    virtual int write(char* data, int size);
+// interface ISrsTsHandler
+public:
+    virtual int on_ts_message(SrsTsMessage* msg);
+private:
+    virtual int on_ts_video(SrsTsMessage* msg);
+    virtual int on_ts_audio(SrsTsMessage* msg);
+    /**
+    * unwrap the 33bits timestamp in 90khz, which wraps about 26.5h.
+    */
+    virtual int64_t unwrap(int64_t v);
+};
+
 /**
 * export runtime context.
 */
@@ -31436,11 +40893,29 @@ struct Context
     // extra request object for connect to server, NULL to ignore.
     SrsRequest* req;
     
-    // the message received cache,
-    // for example, when got aggregate message,
-    // the context will parse to videos/audios,
-    // and return one by one.
-    std::vector<SrsCommonMessage*> msgs;
+    // the aggregate message received,
+    // the context will parse to videos/audios from its payload,
+    // and return one by one, NULL when no aggregate to expand.
+    SrsCommonMessage* aggregate;
+    // the read position of aggregate payload.
+    SrsStream aggregate_stream;
+    // the aggregate message always use abs time, the delta to adjust,
+    // -1 when not initialized.
+    int aggregate_delta;
+    // the payload lent to user by srs_rtmp_read_packet2,
+    // which is free when read again, NULL when not lent.
+    char* lent_payload;
+    
+    // the aggregate message to publish, pack the audio/video tags to it,
+    // @see srs_rtmp_set_aggregate
+    // the max size and duration in ms of aggregate, 0 to disable.
+    int out_aggregate_max_size;
+    int out_aggregate_max_duration;
+    // the payload of aggregate, NULL when sent, alloc when pack tag.
+    char* out_aggregate;
+    // the size of packed tags, and the timestamp of first tag.
+    int out_aggregate_size;
+    u_int32_t out_aggregate_timestamp;
     
     SrsRtmpClient* rtmp;
     SimpleSocketStream* skt;
@@ -31448,51 +40923,88 @@ struct Context
     
     // the remux raw codec.
     SrsRawH264Stream avc_raw;
+    SrsRawHEVCStream hevc_raw;
     SrsRawAacStream aac_raw;
 
     // for h264 raw stream, 
-    // @see: https://github.com/simple-rtmp-server/srs/issues/66#issuecomment-62240521
+    // @see: https://github.com/ossrs/srs/issues/66#issuecomment-62240521
     SrsStream h264_raw_stream;
     // about SPS, @see: 7.3.2.1.1, H.264-AVC-ISO_IEC_14496-10-2012.pdf, page 62
     std::string h264_sps;
     std::string h264_pps;
     // whether the sps and pps sent,
-    // @see https://github.com/simple-rtmp-server/srs/issues/203
+    // @see https://github.com/ossrs/srs/issues/203
     bool h264_sps_pps_sent;
     // only send the ssp and pps when both changed.
-    // @see https://github.com/simple-rtmp-server/srs/issues/204
+    // @see https://github.com/ossrs/srs/issues/204
     bool h264_sps_changed;
     bool h264_pps_changed;
+    // for h265 raw stream, the annexb is demuxed by h264_raw_stream.
+    // about VPS/SPS/PPS, @see: 7.3.2, H.265-HEVC-ITU-T-REC-H.265-201304.pdf, page 32
+    std::string h265_vps;
+    std::string h265_sps;
+    std::string h265_pps;
+    // whether the vps, sps and pps sent.
+    bool h265_vps_sps_pps_sent;
+    // send the vps, sps and pps when any changed.
+    bool h265_vps_sps_pps_changed;
     // for aac raw stream,
-    // @see: https://github.com/simple-rtmp-server/srs/issues/212#issuecomment-64146250
+    // @see: https://github.com/ossrs/srs/issues/212#issuecomment-64146250
     SrsStream aac_raw_stream;
     // the aac sequence header.
     std::string aac_specific_config;
+    // the ingester of ts, NULL when not write ts.
+    // @see srs_rtmp_write_ts
+    TsIngester* ts_ingester;
+    
+    // the startup timing of session, the monotonic time in ms
+    // when each stage done, 0 when not done yet.
+    // @see srs_utils_startup_timing
+    int64_t stime_start;
+    int64_t stime_dns;
+    int64_t stime_connect;
+    int64_t stime_handshake;
+    int64_t stime_connect_app;
+    int64_t stime_create_stream;
+    int64_t stime_play_publish;
+    int64_t stime_first_audio;
+    int64_t stime_first_video;
+    int64_t stime_first_keyframe;
     
     Context() {
         rtmp = NULL;
         skt = NULL;
         req = NULL;
+        aggregate = NULL;
+        aggregate_delta = -1;
+        lent_payload = NULL;
+        out_aggregate_max_size = out_aggregate_max_duration = 0;
+        out_aggregate = NULL;
+        out_aggregate_size = 0;
+        out_aggregate_timestamp = 0;
         stream_id = 0;
         h264_sps_pps_sent = false;
         h264_sps_changed = false;
         h264_pps_changed = false;
+        h265_vps_sps_pps_sent = false;
+        h265_vps_sps_pps_changed = false;
+        ts_ingester = NULL;
+        stime_start = stime_dns = stime_connect = stime_handshake = 0;
+        stime_connect_app = stime_create_stream = stime_play_publish = 0;
+        stime_first_audio = stime_first_video = stime_first_keyframe = 0;
     }
     virtual ~Context() {
         srs_freep(req);
         srs_freep(rtmp);
         srs_freep(skt);
-        
-        std::vector<SrsCommonMessage*>::iterator it;
-        for (it = msgs.begin(); it != msgs.end(); ++it) {
-            SrsCommonMessage* msg = *it;
-            srs_freep(msg);
-        }
-        msgs.clear();
+        srs_freep(aggregate);
+        srs_freepa(lent_payload);
+        srs_freepa(out_aggregate);
+        srs_freep(ts_ingester);
     }
 };
 
-// for srs-librtmp, @see https://github.com/simple-rtmp-server/srs/issues/213
+// for srs-librtmp, @see https://github.com/ossrs/srs/issues/213
 #ifdef _WIN32
     int gettimeofday(struct timeval* tv, struct timezone* tz)
     {  
@@ -31824,6 +41336,40 @@ struct Context
     }
 #endif
 
+/**
+* get the monotonic time in ms for the startup timing,
+* which never jump when the system time changed.
+*/
+int64_t srs_librtmp_monotonic_time_ms()
+{
+#ifdef _WIN32
+    return (int64_t)GetTickCount64();
+#else
+    timespec now;
+    if (clock_gettime(CLOCK_MONOTONIC, &now) < 0) {
+        return srs_update_system_time_ms();
+    }
+    return ((int64_t)now.tv_sec) * 1000 + (int64_t)now.tv_nsec / 1000 / 1000;
+#endif
+}
+
+/**
+* mark the startup stage done, only the first time is recorded.
+*/
+void srs_librtmp_context_stage_done(Context* context, int64_t& stime)
+{
+    if (stime > 0) {
+        return;
+    }
+    
+    stime = srs_librtmp_monotonic_time_ms();
+    
+    // the session starts when the first stage starts.
+    if (context->stime_start <= 0) {
+        context->stime_start = stime;
+    }
+}
+
 int srs_librtmp_context_parse_uri(Context* context) 
 {
     int ret = ERROR_SUCCESS;
@@ -31928,6 +41474,13 @@ void srs_rtmp_destroy(srs_rtmp_t rtmp)
     
     Context* context = (Context*)rtmp;
     
+    // best effort to send the packed packets, ignore the error for closing.
+    int ret = ERROR_SUCCESS;
+    int size = context->out_aggregate_size;
+    if (size > 0 && (ret = srs_rtmp_flush_aggregate(rtmp)) != ERROR_SUCCESS) {
+        srs_warn("flush aggregate %dB when destroy failed. ret=%d", size, ret);
+    }
+    
     srs_freep(context);
 }
 
@@ -31957,6 +41510,9 @@ int srs_rtmp_dns_resolve(srs_rtmp_t rtmp)
     srs_assert(rtmp != NULL);
     Context* context = (Context*)rtmp;
     
+    // the session starts from dns resolve.
+    srs_librtmp_context_stage_done(context, context->stime_start);
+    
     // parse uri
     if ((ret = srs_librtmp_context_parse_uri(context)) != ERROR_SUCCESS) {
         return ret;
@@ -31965,6 +41521,7 @@ int srs_rtmp_dns_resolve(srs_rtmp_t rtmp)
     if ((ret = srs_librtmp_context_resolve_host(context)) != ERROR_SUCCESS) {
         return ret;
     }
+    srs_librtmp_context_stage_done(context, context->stime_dns);
     
     return ret;
 }
@@ -31979,6 +41536,7 @@ int srs_rtmp_connect_server(srs_rtmp_t rtmp)
     if ((ret = srs_librtmp_context_connect(context)) != ERROR_SUCCESS) {
         return ret;
     }
+    srs_librtmp_context_stage_done(context, context->stime_connect);
     
     return ret;
 }
@@ -32004,6 +41562,7 @@ int srs_rtmp_do_complex_handshake(srs_rtmp_t rtmp)
     if ((ret = context->rtmp->complex_handshake()) != ERROR_SUCCESS) {
         return ret;
     }
+    srs_librtmp_context_stage_done(context, context->stime_handshake);
     
     return ret;
 }
@@ -32051,6 +41610,7 @@ int srs_rtmp_do_simple_handshake(srs_rtmp_t rtmp)
     if ((ret = context->rtmp->simple_handshake()) != ERROR_SUCCESS) {
         return ret;
     }
+    srs_librtmp_context_stage_done(context, context->stime_handshake);
     
     return ret;
 }
@@ -32072,6 +41632,7 @@ int srs_rtmp_connect_app(srs_rtmp_t rtmp)
     {
         return ret;
     }
+    srs_librtmp_context_stage_done(context, context->stime_connect_app);
     
     return ret;
 }
@@ -32105,6 +41666,7 @@ int srs_rtmp_connect_app2(srs_rtmp_t rtmp,
         sip, sserver, sprimary, sauthors, sversion, *srs_id, *srs_pid)) != ERROR_SUCCESS) {
         return ret;
     }
+    srs_librtmp_context_stage_done(context, context->stime_connect_app);
     
     snprintf(srs_server_ip, 128, "%s", sip.c_str());
     snprintf(srs_server, 128, "%s", sserver.c_str());
@@ -32125,9 +41687,12 @@ int srs_rtmp_play_stream(srs_rtmp_t rtmp)
     if ((ret = context->rtmp->create_stream(context->stream_id)) != ERROR_SUCCESS) {
         return ret;
     }
+    srs_librtmp_context_stage_done(context, context->stime_create_stream);
+    
     if ((ret = context->rtmp->play(context->stream, context->stream_id)) != ERROR_SUCCESS) {
         return ret;
     }
+    srs_librtmp_context_stage_done(context, context->stime_play_publish);
     
     return ret;
 }
@@ -32142,10 +41707,60 @@ int srs_rtmp_publish_stream(srs_rtmp_t rtmp)
     if ((ret = context->rtmp->fmle_publish(context->stream, context->stream_id)) != ERROR_SUCCESS) {
         return ret;
     }
+    srs_librtmp_context_stage_done(context, context->stime_play_publish);
+    
+    return ret;
+}
+
+int srs_rtmp_pipeline_play_stream(srs_rtmp_t rtmp)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(rtmp != NULL);
+    Context* context = (Context*)rtmp;
+    
+    string tcUrl = srs_generate_tc_url(
+        context->ip, context->vhost, context->app, context->port,
+        context->param
+    );
+    
+    if ((ret = context->rtmp->pipeline_play(context->app, tcUrl, context->req, true,
+        context->stream, context->stream_id)) != ERROR_SUCCESS) 
+    {
+        return ret;
+    }
+    srs_librtmp_context_stage_done(context, context->stime_play_publish);
+    
+    return ret;
+}
+
+int srs_rtmp_pipeline_publish_stream(srs_rtmp_t rtmp)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(rtmp != NULL);
+    Context* context = (Context*)rtmp;
+    
+    string tcUrl = srs_generate_tc_url(
+        context->ip, context->vhost, context->app, context->port,
+        context->param
+    );
+    
+    if ((ret = context->rtmp->pipeline_publish(context->app, tcUrl, context->req, true,
+        context->stream, context->stream_id)) != ERROR_SUCCESS) 
+    {
+        return ret;
+    }
+    srs_librtmp_context_stage_done(context, context->stime_play_publish);
     
     return ret;
 }
 
+srs_bool srs_rtmp_is_pipeline_stream_error(int error_code)
+{
+    return error_code == ERROR_RTMP_PIPELINE_STREAM_ID;
+}
+
 int srs_rtmp_bandwidth_check(srs_rtmp_t rtmp, 
     int64_t* start_time, int64_t* end_time, 
     int* play_kbps, int* publish_kbps,
@@ -32187,103 +41802,123 @@ int srs_rtmp_on_aggregate(Context* context, SrsCommonMessage* msg)
 {
     int ret = ERROR_SUCCESS;
     
-    SrsStream aggregate_stream;
-    SrsStream* stream = &aggregate_stream;
-    if ((ret = stream->initialize(msg->payload, msg->size)) != ERROR_SUCCESS) {
+    // detach bytes from packet, the sub messages are views of it.
+    SrsCommonMessage* aggregate = new SrsCommonMessage();
+    aggregate->header = msg->header;
+    aggregate->payload = msg->payload;
+    aggregate->size = msg->size;
+    msg->payload = NULL;
+    
+    srs_freep(context->aggregate);
+    context->aggregate = aggregate;
+    context->aggregate_delta = -1;
+    
+    if ((ret = context->aggregate_stream.initialize(aggregate->payload, aggregate->size)) != ERROR_SUCCESS) {
+        srs_freep(context->aggregate);
         return ret;
     }
     
-    // the aggregate message always use abs time.
-    int delta = -1;
-    
-    while (!stream->empty()) {
-        if (!stream->require(1)) {
-            ret = ERROR_RTMP_AGGREGATE;
-            srs_error("invalid aggregate message type. ret=%d", ret);
-            return ret;
-        }
-        int8_t type = stream->read_1bytes();
-        
-        if (!stream->require(3)) {
-            ret = ERROR_RTMP_AGGREGATE;
-            srs_error("invalid aggregate message size. ret=%d", ret);
-            return ret;
-        }
-        int32_t data_size = stream->read_3bytes();
-        
-        if (data_size < 0) {
-            ret = ERROR_RTMP_AGGREGATE;
-            srs_error("invalid aggregate message size(negative). ret=%d", ret);
-            return ret;
-        }
-        
-        if (!stream->require(3)) {
-            ret = ERROR_RTMP_AGGREGATE;
-            srs_error("invalid aggregate message time. ret=%d", ret);
-            return ret;
-        }
-        int32_t timestamp = stream->read_3bytes();
-        
-        if (!stream->require(1)) {
-            ret = ERROR_RTMP_AGGREGATE;
-            srs_error("invalid aggregate message time(high). ret=%d", ret);
-            return ret;
-        }
-        int32_t time_h = stream->read_1bytes();
-        
-        timestamp |= time_h<<24;
-        timestamp &= 0x7FFFFFFF;
-        
-        // adjust abs timestamp in aggregate msg.
-        if (delta < 0) {
-            delta = (int)msg->header.timestamp - (int)timestamp;
-        }
-        timestamp += delta;
-        
-        if (!stream->require(3)) {
-            ret = ERROR_RTMP_AGGREGATE;
-            srs_error("invalid aggregate message stream_id. ret=%d", ret);
-            return ret;
-        }
-        int32_t stream_id = stream->read_3bytes();
-        
-        if (data_size > 0 && !stream->require(data_size)) {
-            ret = ERROR_RTMP_AGGREGATE;
-            srs_error("invalid aggregate message data. ret=%d", ret);
-            return ret;
-        }
-        
-        // to common message.
-        SrsCommonMessage o;
-        
-        o.header.message_type = type;
-        o.header.payload_length = data_size;
-        o.header.timestamp_delta = timestamp;
-        o.header.timestamp = timestamp;
-        o.header.stream_id = stream_id;
-        o.header.perfer_cid = msg->header.perfer_cid;
-
-        if (data_size > 0) {
-            o.size = data_size;
-            o.payload = new char[o.size];
-            stream->read_bytes(o.payload, o.size);
-        }
-        
-        if (!stream->require(4)) {
-            ret = ERROR_RTMP_AGGREGATE;
-            srs_error("invalid aggregate message previous tag size. ret=%d", ret);
-            return ret;
-        }
-        stream->read_4bytes();
+    return ret;
+}
 
-        // process parsed message
-        SrsCommonMessage* parsed_msg = new SrsCommonMessage();
-        parsed_msg->header = o.header;
-        parsed_msg->payload = o.payload;
-        parsed_msg->size = o.size;
-        o.payload = NULL;
-        context->msgs.push_back(parsed_msg);
+/**
+* parse the next sub message of aggregate message,
+* the payload of sub message is a view of the aggregate payload,
+* which is valid until the aggregate message is free.
+* @param got_msg, false when the aggregate is expanded.
+*/
+int srs_rtmp_aggregate_next(Context* context, 
+    char* type, u_int32_t* timestamp, char** data, int* size,
+    bool* got_msg
+) {
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(context->aggregate);
+    SrsCommonMessage* msg = context->aggregate;
+    SrsStream* stream = &context->aggregate_stream;
+    
+    *got_msg = false;
+    if (stream->empty()) {
+        return ret;
+    }
+    
+    if (!stream->require(1)) {
+        ret = ERROR_RTMP_AGGREGATE;
+        srs_error("invalid aggregate message type. ret=%d", ret);
+        return ret;
+    }
+    int8_t sub_type = stream->read_1bytes();
+    
+    if (!stream->require(3)) {
+        ret = ERROR_RTMP_AGGREGATE;
+        srs_error("invalid aggregate message size. ret=%d", ret);
+        return ret;
+    }
+    int32_t data_size = stream->read_3bytes();
+    
+    if (data_size < 0) {
+        ret = ERROR_RTMP_AGGREGATE;
+        srs_error("invalid aggregate message size(negative). ret=%d", ret);
+        return ret;
+    }
+    
+    if (!stream->require(3)) {
+        ret = ERROR_RTMP_AGGREGATE;
+        srs_error("invalid aggregate message time. ret=%d", ret);
+        return ret;
     }
+    int32_t sub_timestamp = stream->read_3bytes();
+    
+    if (!stream->require(1)) {
+        ret = ERROR_RTMP_AGGREGATE;
+        srs_error("invalid aggregate message time(high). ret=%d", ret);
+        return ret;
+    }
+    int32_t time_h = stream->read_1bytes();
+    
+    sub_timestamp |= time_h<<24;
+    sub_timestamp &= 0x7FFFFFFF;
+    
+    // adjust abs timestamp in aggregate msg.
+    if (context->aggregate_delta < 0) {
+        context->aggregate_delta = (int)msg->header.timestamp - (int)sub_timestamp;
+    }
+    sub_timestamp += context->aggregate_delta;
+    
+    // the stream id of sub message is ignored.
+    if (!stream->require(3)) {
+        ret = ERROR_RTMP_AGGREGATE;
+        srs_error("invalid aggregate message stream_id. ret=%d", ret);
+        return ret;
+    }
+    stream->skip(3);
+    
+    if (data_size > 0 && !stream->require(data_size)) {
+        ret = ERROR_RTMP_AGGREGATE;
+        srs_error("invalid aggregate message data. ret=%d", ret);
+        return ret;
+    }
+    
+    // the view of sub message payload,
+    // map the type and timestamp like srs_rtmp_go_packet.
+    *type = sub_type;
+    if (sub_type == RTMP_MSG_AudioMessage || sub_type == RTMP_MSG_VideoMessage) {
+        *timestamp = (u_int32_t)sub_timestamp;
+    } else if (sub_type == RTMP_MSG_AMF0DataMessage || sub_type == RTMP_MSG_AMF3DataMessage) {
+        *type = SRS_RTMP_TYPE_SCRIPT;
+    }
+    *data = (data_size > 0)? stream->data() + stream->pos() : NULL;
+    *size = data_size;
+    stream->skip(data_size);
+    
+    if (!stream->require(4)) {
+        ret = ERROR_RTMP_AGGREGATE;
+        srs_error("invalid aggregate message previous tag size. ret=%d", ret);
+        return ret;
+    }
+    stream->read_4bytes();
+    
+    *got_msg = true;
     
     return ret;
 }
@@ -32333,7 +41968,114 @@ int srs_rtmp_go_packet(Context* context, SrsCommonMessage* msg,
     return ret;
 }
 
-int srs_rtmp_read_packet(srs_rtmp_t rtmp, char* type, u_int32_t* timestamp, char** data, int* size)
+/**
+* read a packet from the aggregate message or protocol.
+* @param copy, whether copy the payload of aggregate sub message,
+*       when false, the payload is a view of aggregate message.
+* @param lent, output whether the data is a view, user should not free it.
+*/
+int srs_librtmp_context_read(Context* context, bool copy, 
+    char* type, u_int32_t* timestamp, char** data, int* size,
+    bool* lent
+) {
+    int ret = ERROR_SUCCESS;
+    
+    *lent = false;
+    
+    for (;;) {
+        // expand the aggregate message first.
+        if (context->aggregate) {
+            bool got_msg = false;
+            if ((ret = srs_rtmp_aggregate_next(context, type, timestamp, data, size, &got_msg)) != ERROR_SUCCESS) {
+                srs_freep(context->aggregate);
+                return ret;
+            }
+            
+            // the aggregate is expanded, read from protocol sdk.
+            if (!got_msg) {
+                srs_freep(context->aggregate);
+                continue;
+            }
+            
+            // the empty sub message has no payload to copy or lend.
+            if (*size <= 0) {
+                break;
+            }
+            
+            if (copy) {
+                char* payload = new char[*size];
+                memcpy(payload, *data, *size);
+                *data = payload;
+            } else {
+                *lent = true;
+            }
+            break;
+        }
+        
+        // read from protocol sdk.
+        SrsCommonMessage* msg = NULL;
+        if ((ret = context->rtmp->recv_message(&msg)) != ERROR_SUCCESS) {
+            return ret;
+        }
+        
+        // no msg, try again.
+        if (!msg) {
+            continue;
+        }
+        
+        SrsAutoFree(SrsCommonMessage, msg);
+        
+        // process the got packet, if nothing, try again.
+        bool got_msg;
+        if ((ret = srs_rtmp_go_packet(context, msg, type, timestamp, data, size, &got_msg)) != ERROR_SUCCESS) {
+            return ret;
+        }
+        
+        // got expected message.
+        if (got_msg) {
+            break;
+        }
+    }
+    
+    // the first audio, video and keyframe for startup timing.
+    if (*type == SRS_RTMP_TYPE_AUDIO) {
+        srs_librtmp_context_stage_done(context, context->stime_first_audio);
+    } else if (*type == SRS_RTMP_TYPE_VIDEO) {
+        srs_librtmp_context_stage_done(context, context->stime_first_video);
+        
+        // ignore the sequence header, which is not a frame.
+        if (srs_utils_flv_video_frame_type(*data, *size) == 1
+            && srs_utils_flv_video_avc_packet_type(*data, *size) != 0
+        ) {
+            srs_librtmp_context_stage_done(context, context->stime_first_keyframe);
+        }
+    }
+    
+    return ret;
+}
+
+int srs_rtmp_read_packet(srs_rtmp_t rtmp, char* type, u_int32_t* timestamp, char** data, int* size)
+{
+    *type = 0;
+    *timestamp = 0;
+    *data = NULL;
+    *size = 0;
+    
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(rtmp != NULL);
+    Context* context = (Context*)rtmp;
+    
+    bool lent = false;
+    if ((ret = srs_librtmp_context_read(context, true, type, timestamp, data, size, &lent)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    srs_assert(!lent);
+    
+    return ret;
+}
+
+int srs_rtmp_read_packet2(srs_rtmp_t rtmp, char* type, u_int32_t* timestamp, char** data, int* size)
 {
     *type = 0;
     *timestamp = 0;
@@ -32345,38 +42087,121 @@ int srs_rtmp_read_packet(srs_rtmp_t rtmp, char* type, u_int32_t* timestamp, char
     srs_assert(rtmp != NULL);
     Context* context = (Context*)rtmp;
     
-    for (;;) {
-        SrsCommonMessage* msg = NULL;
-        
-        // read from cache first.
-        if (!context->msgs.empty()) {
-            std::vector<SrsCommonMessage*>::iterator it = context->msgs.begin();
-            msg = *it;
-            context->msgs.erase(it);
-        }
-        
-        // read from protocol sdk.
-        if (!msg && (ret = context->rtmp->recv_message(&msg)) != ERROR_SUCCESS) {
-            return ret;
-        }
-        
-        // no msg, try again.
-        if (!msg) {
-            continue;
+    // the data lent to user is invalid now.
+    srs_freepa(context->lent_payload);
+    
+    bool lent = false;
+    if ((ret = srs_librtmp_context_read(context, false, type, timestamp, data, size, &lent)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // the view of aggregate is free with the aggregate,
+    // others are detached from message, free when read again.
+    if (!lent) {
+        context->lent_payload = *data;
+    }
+    
+    return ret;
+}
+
+/**
+* send the packed tags in aggregate message.
+*/
+int srs_librtmp_context_flush_aggregate(Context* context)
+{
+    int ret = ERROR_SUCCESS;
+    
+    if (context->out_aggregate_size <= 0) {
+        return ret;
+    }
+    
+    SrsMessageHeader header;
+    header.message_type = RTMP_MSG_AggregateMessage;
+    header.payload_length = context->out_aggregate_size;
+    header.timestamp = context->out_aggregate_timestamp;
+    header.stream_id = context->stream_id;
+    header.perfer_cid = RTMP_CID_Video;
+    
+    // the message takes the payload, alloc another when pack tag.
+    SrsSharedPtrMessage* msg = new SrsSharedPtrMessage();
+    if ((ret = msg->create(&header, context->out_aggregate, context->out_aggregate_size)) != ERROR_SUCCESS) {
+        srs_freep(msg);
+        return ret;
+    }
+    context->out_aggregate = NULL;
+    context->out_aggregate_size = 0;
+    
+    if ((ret = context->rtmp->send_and_free_message(msg, context->stream_id)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    return ret;
+}
+
+/**
+* pack the audio/video tag to aggregate message,
+* send the aggregate when this tag reaches the size or duration.
+* @remark the data is always free.
+*/
+int srs_librtmp_context_aggregate(Context* context, char type, u_int32_t timestamp, char* data, int size)
+{
+    int ret = ERROR_SUCCESS;
+    
+    int tag_size = SRS_FLV_TAG_HEADER_SIZE + size + SRS_FLV_PREVIOUS_TAG_SIZE;
+    
+    // send the aggregate when full, or the timestamp jump back.
+    if (context->out_aggregate_size > 0) {
+        if (context->out_aggregate_size + tag_size > context->out_aggregate_max_size
+            || timestamp < context->out_aggregate_timestamp
+            || timestamp - context->out_aggregate_timestamp >= (u_int32_t)context->out_aggregate_max_duration
+        ) {
+            if ((ret = srs_librtmp_context_flush_aggregate(context)) != ERROR_SUCCESS) {
+                srs_freepa(data);
+                return ret;
+            }
         }
-        
-        SrsAutoFree(SrsCommonMessage, msg);
-        
-        // process the got packet, if nothing, try again.
-        bool got_msg;
-        if ((ret = srs_rtmp_go_packet(context, msg, type, timestamp, data, size, &got_msg)) != ERROR_SUCCESS) {
+    }
+    
+    // the large tag, send it directly.
+    if (tag_size > context->out_aggregate_max_size) {
+        SrsSharedPtrMessage* msg = NULL;
+        if ((ret = srs_rtmp_create_msg(type, timestamp, data, size, context->stream_id, &msg)) != ERROR_SUCCESS) {
             return ret;
         }
-        
-        // got expected message.
-        if (got_msg) {
-            break;
-        }
+        return context->rtmp->send_and_free_message(msg, context->stream_id);
+    }
+    
+    SrsAutoFreeA(char, data);
+    
+    if (!context->out_aggregate) {
+        context->out_aggregate = new char[context->out_aggregate_max_size];
+    }
+    if (context->out_aggregate_size <= 0) {
+        context->out_aggregate_timestamp = timestamp;
+    }
+    
+    SrsStream stream;
+    if ((ret = stream.initialize(context->out_aggregate + context->out_aggregate_size, tag_size)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // the tag header, the stream id is always 0.
+    stream.write_1bytes(type);
+    stream.write_3bytes(size);
+    stream.write_3bytes((int32_t)(timestamp & 0xFFFFFF));
+    stream.write_1bytes((int8_t)((timestamp >> 24) & 0x7F));
+    stream.write_3bytes(0);
+    stream.write_bytes(data, size);
+    stream.write_4bytes(SRS_FLV_TAG_HEADER_SIZE + size);
+    
+    context->out_aggregate_size += tag_size;
+    
+    // send the aggregate when this tag reaches the duration,
+    // or no space for another tag, never wait for the next packet.
+    if (timestamp - context->out_aggregate_timestamp >= (u_int32_t)context->out_aggregate_max_duration
+        || context->out_aggregate_size + SRS_FLV_TAG_HEADER_SIZE + SRS_FLV_PREVIOUS_TAG_SIZE >= context->out_aggregate_max_size
+    ) {
+        return srs_librtmp_context_flush_aggregate(context);
     }
     
     return ret;
@@ -32389,6 +42214,17 @@ int srs_rtmp_write_packet(srs_rtmp_t rtmp, char type, u_int32_t timestamp, char*
     srs_assert(rtmp != NULL);
     Context* context = (Context*)rtmp;
     
+    // pack the audio/video to aggregate message when enabled.
+    if (context->out_aggregate_max_size > 0 && (type == SRS_RTMP_TYPE_AUDIO || type == SRS_RTMP_TYPE_VIDEO)) {
+        return srs_librtmp_context_aggregate(context, type, timestamp, data, size);
+    }
+    
+    // send the packed tags first, to keep the order.
+    if ((ret = srs_librtmp_context_flush_aggregate(context)) != ERROR_SUCCESS) {
+        srs_freepa(data);
+        return ret;
+    }
+    
     SrsSharedPtrMessage* msg = NULL;
 
     if ((ret = srs_rtmp_create_msg(type, timestamp, data, size, context->stream_id, &msg)) != ERROR_SUCCESS) {
@@ -32405,6 +42241,33 @@ int srs_rtmp_write_packet(srs_rtmp_t rtmp, char type, u_int32_t timestamp, char*
     return ret;
 }
 
+int srs_rtmp_set_aggregate(srs_rtmp_t rtmp, int max_size, int max_duration)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(rtmp != NULL);
+    Context* context = (Context*)rtmp;
+    
+    // send the packed tags, for the buffer maybe smaller.
+    if ((ret = srs_librtmp_context_flush_aggregate(context)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    srs_freepa(context->out_aggregate);
+    
+    context->out_aggregate_max_size = srs_max(0, max_size);
+    context->out_aggregate_max_duration = srs_max(0, max_duration);
+    
+    return ret;
+}
+
+int srs_rtmp_flush_aggregate(srs_rtmp_t rtmp)
+{
+    srs_assert(rtmp != NULL);
+    Context* context = (Context*)rtmp;
+    
+    return srs_librtmp_context_flush_aggregate(context);
+}
+
 srs_bool srs_rtmp_is_onMetaData(char type, char* data, int size)
 {
     int ret = ERROR_SUCCESS;
@@ -32604,7 +42467,7 @@ int srs_write_h264_ipb_frame(Context* context,
     int ret = ERROR_SUCCESS;
     
     // when sps or pps not sent, ignore the packet.
-    // @see https://github.com/simple-rtmp-server/srs/issues/203
+    // @see https://github.com/ossrs/srs/issues/203
     if (!context->h264_sps_pps_sent) {
         return ERROR_H264_DROP_BEFORE_SPS_PPS;
     }
@@ -32742,8 +42605,8 @@ int srs_h264_write_raw_frames(srs_rtmp_t rtmp,
     }
     
     // use the last error
-    // @see https://github.com/simple-rtmp-server/srs/issues/203
-    // @see https://github.com/simple-rtmp-server/srs/issues/204
+    // @see https://github.com/ossrs/srs/issues/203
+    // @see https://github.com/ossrs/srs/issues/204
     int error_code_return = ret;
     
     // send each frame.
@@ -32804,12 +42667,557 @@ srs_bool srs_h264_startswith_annexb(char* h264_raw_data, int h264_raw_size, int*
     return srs_avc_startswith_annexb(&stream, pnb_start_code);
 }
 
+/**
+* write h265 IPB-frame.
+*/
+int srs_write_h265_ipb_frame(Context* context, 
+    char* frame, int frame_size, u_int32_t dts, u_int32_t pts
+) {
+    int ret = ERROR_SUCCESS;
+    
+    // when vps, sps or pps not sent, ignore the packet.
+    if (!context->h265_vps_sps_pps_sent) {
+        return ERROR_HEVC_DROP_BEFORE_VPS_SPS_PPS;
+    }
+    
+    // 6bits, 7.3.1.2 NAL unit header syntax,
+    // H.265-HEVC-ITU-T-REC-H.265-201304.pdf, page 31.
+    SrsHevcNaluType nal_unit_type = (SrsHevcNaluType)((frame[0] >> 1) & 0x3f);
+    
+    // for IRAP frame, the frame is keyframe.
+    SrsCodecVideoAVCFrame frame_type = SrsCodecVideoAVCFrameInterFrame;
+    if (nal_unit_type >= SrsHevcNaluTypeCodedSliceBLA && nal_unit_type <= SrsHevcNaluTypeReservedIRAP23) {
+        frame_type = SrsCodecVideoAVCFrameKeyFrame;
+    }
+    
+    // the NALU with 4bytes size, the same as h264.
+    std::string ibp;
+    if ((ret = context->avc_raw.mux_ipb_frame(frame, frame_size, ibp)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    int8_t packet_type = SrsCodecVideoExPacketTypeCodedFrames;
+    char* flv = NULL;
+    int nb_flv = 0;
+    if ((ret = context->hevc_raw.mux_hevc2flv(ibp, frame_type, packet_type, dts, pts, &flv, &nb_flv)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // the timestamp in rtmp message header is dts.
+    u_int32_t timestamp = dts;
+    return srs_rtmp_write_packet(context, SRS_RTMP_TYPE_VIDEO, timestamp, flv, nb_flv);
+}
+
+/**
+* write the h265 vps/sps/pps in context over RTMP.
+*/
+int srs_write_h265_vps_sps_pps(Context* context, u_int32_t dts, u_int32_t pts)
+{
+    int ret = ERROR_SUCCESS;
+    
+    // send when any changed, and all of them are got.
+    if (!context->h265_vps_sps_pps_changed) {
+        return ret;
+    }
+    if (context->h265_vps.empty() || context->h265_sps.empty() || context->h265_pps.empty()) {
+        return ret;
+    }
+    
+    // h265 raw to HEVCDecoderConfigurationRecord.
+    std::string sh;
+    if ((ret = context->hevc_raw.mux_sequence_header(context->h265_vps, context->h265_sps, context->h265_pps, sh)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // h265 packet to flv packet.
+    int8_t frame_type = SrsCodecVideoAVCFrameKeyFrame;
+    int8_t packet_type = SrsCodecVideoExPacketTypeSequenceStart;
+    char* flv = NULL;
+    int nb_flv = 0;
+    if ((ret = context->hevc_raw.mux_hevc2flv(sh, frame_type, packet_type, dts, pts, &flv, &nb_flv)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // reset vps, sps and pps.
+    context->h265_vps_sps_pps_changed = false;
+    context->h265_vps_sps_pps_sent = true;
+    
+    // the timestamp in rtmp message header is dts.
+    u_int32_t timestamp = dts;
+    return srs_rtmp_write_packet(context, SRS_RTMP_TYPE_VIDEO, timestamp, flv, nb_flv);
+}
+
+/**
+* write h265 raw frame, maybe vps/sps/pps/IPB-frame.
+*/
+int srs_write_h265_raw_frame(Context* context, 
+    char* frame, int frame_size, u_int32_t dts, u_int32_t pts
+) {
+    int ret = ERROR_SUCCESS;
+    
+    // for vps, sps and pps, ignore the duplicated.
+    std::string* pset = NULL;
+    int error_duplicated = ERROR_SUCCESS;
+    if (context->hevc_raw.is_vps(frame, frame_size)) {
+        pset = &context->h265_vps;
+        error_duplicated = ERROR_HEVC_DUPLICATED_VPS;
+    } else if (context->hevc_raw.is_sps(frame, frame_size)) {
+        pset = &context->h265_sps;
+        error_duplicated = ERROR_HEVC_DUPLICATED_SPS;
+    } else if (context->hevc_raw.is_pps(frame, frame_size)) {
+        pset = &context->h265_pps;
+        error_duplicated = ERROR_HEVC_DUPLICATED_PPS;
+    }
+    
+    if (pset) {
+        std::string nalu(frame, frame_size);
+        if (*pset == nalu) {
+            return error_duplicated;
+        }
+        context->h265_vps_sps_pps_changed = true;
+        *pset = nalu;
+        
+        return ret;
+    }
+    
+    // send vps+sps+pps before ipb frames when changed.
+    if ((ret = srs_write_h265_vps_sps_pps(context, dts, pts)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // ibp frame.
+    return srs_write_h265_ipb_frame(context, frame, frame_size, dts, pts);
+}
+
+/**
+* write h265 multiple frames, in annexb format.
+*/
+int srs_h265_write_raw_frames(srs_rtmp_t rtmp, 
+    char* frames, int frames_size, u_int32_t dts, u_int32_t pts
+) {
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(frames != NULL);
+    srs_assert(frames_size > 0);
+    
+    srs_assert(rtmp != NULL);
+    Context* context = (Context*)rtmp;
+    
+    if ((ret = context->h264_raw_stream.initialize(frames, frames_size)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // use the last error, the same as h264.
+    int error_code_return = ret;
+    
+    // send each frame.
+    while (!context->h264_raw_stream.empty()) {
+        char* frame = NULL;
+        int frame_size = 0;
+        if ((ret = context->avc_raw.annexb_demux(&context->h264_raw_stream, &frame, &frame_size)) != ERROR_SUCCESS) {
+            return ret;
+        }
+        
+        // ignore invalid frame,
+        // atleast 1bytes for the nalu type.
+        if (frame_size <= 0) {
+            continue;
+        }
+        
+        // it may be return error, but we must process all packets.
+        if ((ret = srs_write_h265_raw_frame(context, frame, frame_size, dts, pts)) != ERROR_SUCCESS) {
+            error_code_return = ret;
+            
+            // ignore known error, process all packets.
+            if (srs_h265_is_dvbsp_error(ret)
+                || srs_h265_is_duplicated_vps_error(ret)
+                || srs_h265_is_duplicated_sps_error(ret)
+                || srs_h265_is_duplicated_pps_error(ret)
+            ) {
+                continue;
+            }
+            
+            return ret;
+        }
+    }
+    
+    return error_code_return;
+}
+
+srs_bool srs_h265_is_dvbsp_error(int error_code)
+{
+    return error_code == ERROR_HEVC_DROP_BEFORE_VPS_SPS_PPS;
+}
+
+srs_bool srs_h265_is_duplicated_vps_error(int error_code)
+{
+    return error_code == ERROR_HEVC_DUPLICATED_VPS;
+}
+
+srs_bool srs_h265_is_duplicated_sps_error(int error_code)
+{
+    return error_code == ERROR_HEVC_DUPLICATED_SPS;
+}
+
+srs_bool srs_h265_is_duplicated_pps_error(int error_code)
+{
+    return error_code == ERROR_HEVC_DUPLICATED_PPS;
+}
+
+/**
+* the delta of 33bits timestamps in 90khz, a - b, which may wrap.
+*/
+int64_t srs_ts_delta(int64_t a, int64_t b)
+{
+    int64_t delta = (a - b) & 0x1ffffffffLL;
+    if (delta >= 0x100000000LL) {
+        delta -= 0x200000000LL;
+    }
+    return delta;
+}
+
+TsIngester::TsIngester(Context* c)
+{
+    context = c;
+    nb_left = 0;
+    vpid = apid = -1;
+    last_raw = last_ts = -1;
+}
+
+TsIngester::~TsIngester()
+{
+}
+
+/**
+* whether the error of ts ingest is fatal, the system and RTMP protocol
+* error in [1000, 3000), for example, write to socket failed; otherwise,
+* the codec error of corrupt ts, which is recoverable by drop the frame.
+*/
+bool srs_ts_is_fatal_error(int error_code)
+{
+    return error_code != ERROR_SUCCESS && error_code < ERROR_HLS_METADATA;
+}
+
+int TsIngester::write(char* data, int size)
+{
+    int ret = ERROR_SUCCESS;
+    
+    // drop the partial ts packet of last write, when the data starts a packet
+    // which not follows it, for example, the udp datagram is truncated.
+    if (nb_left > 0 && (u_int8_t)data[0] == 0x47
+        && size > SRS_TS_PACKET_SIZE - nb_left && (u_int8_t)data[SRS_TS_PACKET_SIZE - nb_left] != 0x47
+    ) {
+        srs_warn("ts: drop the partial packet %dB", nb_left);
+        nb_left = 0;
+    }
+    
+    // complete the partial ts packet of last write.
+    if (nb_left > 0) {
+        int nb_bytes = srs_min(size, SRS_TS_PACKET_SIZE - nb_left);
+        memcpy(left + nb_left, data, nb_bytes);
+        nb_left += nb_bytes;
+        data += nb_bytes;
+        size -= nb_bytes;
+        
+        if (nb_left < SRS_TS_PACKET_SIZE) {
+            return ret;
+        }
+        nb_left = 0;
+        
+        SrsStream stream;
+        if ((ret = stream.initialize(left, SRS_TS_PACKET_SIZE)) != ERROR_SUCCESS) {
+            return ret;
+        }
+        if ((ret = ts.decode(&stream, this)) != ERROR_SUCCESS) {
+            return ret;
+        }
+    }
+    
+    // resync to the sync byte, to keep the packets aligned with the next write.
+    int nb_skip = 0;
+    while (nb_skip < size && (u_int8_t)data[nb_skip] != 0x47) {
+        nb_skip++;
+    }
+    if (nb_skip > 0) {
+        srs_warn("ts: skip %dB to resync the sync byte", nb_skip);
+        data += nb_skip;
+        size -= nb_skip;
+    }
+    
+    // decode the whole ts packets in place, left the partial one.
+    int nb_packets = size - size % SRS_TS_PACKET_SIZE;
+    if (nb_packets > 0) {
+        SrsStream stream;
+        if ((ret = stream.initialize(data, nb_packets)) != ERROR_SUCCESS) {
+            return ret;
+        }
+        if ((ret = ts.decode(&stream, this)) != ERROR_SUCCESS) {
+            return ret;
+        }
+    }
+    
+    nb_left = size - nb_packets;
+    if (nb_left > 0) {
+        memcpy(left, data + nb_packets, nb_left);
+    }
+    
+    return ret;
+}
+
+int TsIngester::on_ts_message(SrsTsMessage* msg)
+{
+    int ret = ERROR_SUCCESS;
+    
+    SrsTsChannel* channel = msg->channel;
+    srs_assert(channel);
+    
+    // for the MPTS or multiple languages, publish the first stream, ignore others.
+    if (channel->stream == SrsTsStreamVideoH264 || channel->stream == SrsTsStreamVideoHEVC) {
+        if (vpid == -1) {
+            vpid = channel->pid;
+            srs_trace("ts: ingest video pid=%#x", vpid);
+        }
+        if (vpid == channel->pid) {
+            ret = on_ts_video(msg);
+        }
+    } else if (channel->stream == SrsTsStreamAudioAAC) {
+        if (apid == -1) {
+            apid = channel->pid;
+            srs_trace("ts: ingest audio pid=%#x", apid);
+        }
+        if (apid == channel->pid) {
+            ret = on_ts_audio(msg);
+        }
+    } else {
+        srs_info("ts: ignore pid=%#x, stream=%#x, size=%d",
+            channel->pid, channel->stream, msg->payload->length());
+    }
+    
+    // drop the frames of corrupt PES, only the system and RTMP error is fatal.
+    if (ret != ERROR_SUCCESS && !srs_ts_is_fatal_error(ret)) {
+        srs_warn("ts: drop PES pid=%#x, dts=%"PRId64", size=%d. ret=%d",
+            channel->pid, msg->dts, msg->payload->length(), ret);
+        return ERROR_SUCCESS;
+    }
+    
+    return ret;
+}
+
+int TsIngester::on_ts_video(SrsTsMessage* msg)
+{
+    int ret = ERROR_SUCCESS;
+    
+    // the timestamp of RTMP in ms, the tbn of ts is 90khz.
+    int64_t v = unwrap(msg->dts);
+    u_int32_t dts = (u_int32_t)(v / 90);
+    u_int32_t pts = (u_int32_t)((v + srs_ts_delta(msg->pts, msg->dts)) / 90);
+    
+    SrsStream* stream = &context->h264_raw_stream;
+    if ((ret = stream->initialize(msg->payload->bytes(), msg->payload->length())) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // demux the annexb NALUs in place, all slices of PES is a RTMP packet.
+    nalus.clear();
+    nb_nalus.clear();
+    
+    bool is_hevc = msg->channel->stream == SrsTsStreamVideoHEVC;
+    bool keyframe = false;
+    int nb_video = 0;
+    while (!stream->empty()) {
+        char* frame = NULL;
+        int frame_size = 0;
+        if ((ret = context->avc_raw.annexb_demux(stream, &frame, &frame_size)) != ERROR_SUCCESS) {
+            return ret;
+        }
+        
+        if (frame_size <= 0) {
+            continue;
+        }
+        
+        // for hevc, the AUD is ignored, the vps/sps/pps is sent in sequence header.
+        if (is_hevc) {
+            SrsHevcNaluType hevc_nalu_type = (SrsHevcNaluType)((frame[0] >> 1) & 0x3f);
+            if (hevc_nalu_type == SrsHevcNaluTypeAccessUnitDelimiter) {
+                continue;
+            }
+            
+            if (hevc_nalu_type >= SrsHevcNaluTypeVPS && hevc_nalu_type <= SrsHevcNaluTypePPS) {
+                if ((ret = srs_write_h265_raw_frame(context, frame, frame_size, dts, pts)) != ERROR_SUCCESS) {
+                    if (!srs_h265_is_duplicated_vps_error(ret) && !srs_h265_is_duplicated_sps_error(ret)
+                        && !srs_h265_is_duplicated_pps_error(ret)
+                    ) {
+                        return ret;
+                    }
+                }
+                continue;
+            }
+            
+            if (hevc_nalu_type >= SrsHevcNaluTypeCodedSliceBLA && hevc_nalu_type <= SrsHevcNaluTypeReservedIRAP23) {
+                keyframe = true;
+            }
+            
+            nalus.push_back(frame);
+            nb_nalus.push_back(frame_size);
+            nb_video += 4 + frame_size;
+            continue;
+        }
+        
+        SrsAvcNaluType nal_unit_type = (SrsAvcNaluType)(frame[0] & 0x1f);
+        
+        // the AUD is useless for RTMP.
+        if (nal_unit_type == SrsAvcNaluTypeAccessUnitDelimiter) {
+            continue;
+        }
+        
+        // the sps/pps is sent in sequence header when changed.
+        if (nal_unit_type == SrsAvcNaluTypeSPS || nal_unit_type == SrsAvcNaluTypePPS) {
+            if ((ret = srs_write_h264_raw_frame(context, frame, frame_size, dts, pts)) != ERROR_SUCCESS) {
+                if (!srs_h264_is_duplicated_sps_error(ret) && !srs_h264_is_duplicated_pps_error(ret)) {
+                    return ret;
+                }
+            }
+            continue;
+        }
+        
+        if (nal_unit_type == SrsAvcNaluTypeIDR) {
+            keyframe = true;
+        }
+        
+        nalus.push_back(frame);
+        nb_nalus.push_back(frame_size);
+        nb_video += 4 + frame_size;
+    }
+    
+    if (nalus.empty()) {
+        return ERROR_SUCCESS;
+    }
+    
+    // send the sequence header when sps/pps changed.
+    if (is_hevc) {
+        ret = srs_write_h265_vps_sps_pps(context, dts, pts);
+    } else {
+        ret = srs_write_h264_sps_pps(context, dts, pts);
+    }
+    if (ret != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // the ts may start at any frame, drop the video before sps/pps.
+    if (is_hevc? !context->h265_vps_sps_pps_sent : !context->h264_sps_pps_sent) {
+        srs_info("ts: drop video before sps/pps, dts=%u", dts);
+        return ret;
+    }
+    
+    // mux the NALUs to the flv video tag directly, each prefixed by 4bytes size.
+    // @see: E.4.3 Video Tags, video_file_format_spec_v10_1.pdf, page 78
+    // for hevc, the enhanced RTMP header with the FourCC is 3bytes more.
+    int size = (is_hevc? 8 : 5) + nb_video;
+    char* data = new char[size];
+    
+    SrsStream tag;
+    if ((ret = tag.initialize(data, size)) != ERROR_SUCCESS) {
+        srs_freepa(data);
+        return ret;
+    }
+    
+    SrsCodecVideoAVCFrame frame_type = keyframe? SrsCodecVideoAVCFrameKeyFrame : SrsCodecVideoAVCFrameInterFrame;
+    if (is_hevc) {
+        tag.write_1bytes(SRS_FLV_VIDEO_EX_HEADER | (frame_type << 4) | SrsCodecVideoExPacketTypeCodedFrames);
+        tag.write_4bytes(SRS_FLV_VIDEO_FOURCC_HEVC);
+    } else {
+        tag.write_1bytes((frame_type << 4) | SrsCodecVideoAVC);
+        tag.write_1bytes(SrsCodecVideoAVCTypeNALU);
+    }
+    tag.write_3bytes(pts - dts);
+    
+    for (int i = 0; i < (int)nalus.size(); i++) {
+        tag.write_4bytes(nb_nalus[i]);
+        tag.write_bytes(nalus[i], nb_nalus[i]);
+    }
+    
+    return srs_rtmp_write_packet(context, SRS_RTMP_TYPE_VIDEO, dts, data, size);
+}
+
+int TsIngester::on_ts_audio(SrsTsMessage* msg)
+{
+    int ret = ERROR_SUCCESS;
+    
+    int64_t dts = unwrap(msg->dts);
+    
+    SrsStream* stream = &context->aac_raw_stream;
+    if ((ret = stream->initialize(msg->payload->bytes(), msg->payload->length())) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // the PES may contains several ADTS frames, each frame is 1024 samples.
+    for (int i = 0; !stream->empty(); i++) {
+        char* frame = NULL;
+        int frame_size = 0;
+        SrsRawAacStreamCodec codec;
+        if ((ret = context->aac_raw.adts_demux(stream, &frame, &frame_size, codec)) != ERROR_SUCCESS) {
+            return ret;
+        }
+        
+        int64_t v = dts;
+        int sample_rate = aac_sample_rates[codec.sampling_frequency_index & 0x0f];
+        if (sample_rate > 0) {
+            v += (int64_t)i * 1024 * 90000 / sample_rate;
+        }
+        
+        if ((ret = srs_write_aac_adts_frame(context, &codec, frame, frame_size, (u_int32_t)(v / 90))) != ERROR_SUCCESS) {
+            return ret;
+        }
+    }
+    
+    return ret;
+}
+
+int64_t TsIngester::unwrap(int64_t v)
+{
+    if (last_raw < 0) {
+        last_ts = v;
+    } else {
+        last_ts += srs_ts_delta(v, last_raw);
+    }
+    last_raw = v;
+    
+    return srs_max(0, last_ts);
+}
+
+int srs_rtmp_write_ts(srs_rtmp_t rtmp, char* data, int size)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(rtmp != NULL);
+    Context* context = (Context*)rtmp;
+    
+    if (size <= 0) {
+        return ret;
+    }
+    
+    if (!context->ts_ingester) {
+        context->ts_ingester = new TsIngester(context);
+    }
+    
+    return context->ts_ingester->write(data, size);
+}
+
 struct FlvContext
 {
     SrsFileReader reader;
-    SrsFileWriter writer;
+    // the sync or async writer.
+    SrsFileWriter* writer;
     SrsFlvEncoder enc;
     SrsFlvDecoder dec;
+    SrsFlvIndex index;
+    
+    FlvContext() {
+        writer = new SrsFileWriter();
+    }
+    virtual ~FlvContext() {
+        srs_freep(writer);
+    }
 };
 
 srs_flv_t srs_flv_open_read(const char* file)
@@ -32831,18 +43239,99 @@ srs_flv_t srs_flv_open_read(const char* file)
     return flv;
 }
 
+srs_flv_t srs_flv_open_mmap(const char* file)
+{
+    int ret = ERROR_SUCCESS;
+    
+    FlvContext* flv = new FlvContext();
+    
+    if ((ret = flv->reader.open_mmap(file)) != ERROR_SUCCESS) {
+        srs_freep(flv);
+        return NULL;
+    }
+    
+    if ((ret = flv->dec.initialize(&flv->reader)) != ERROR_SUCCESS) {
+        srs_freep(flv);
+        return NULL;
+    }
+    
+    return flv;
+}
+
 srs_flv_t srs_flv_open_write(const char* file)
 {
     int ret = ERROR_SUCCESS;
     
     FlvContext* flv = new FlvContext();
     
-    if ((ret = flv->writer.open(file)) != ERROR_SUCCESS) {
+    if ((ret = flv->writer->open(file)) != ERROR_SUCCESS) {
+        srs_freep(flv);
+        return NULL;
+    }
+    
+    if ((ret = flv->enc.initialize(flv->writer)) != ERROR_SUCCESS) {
+        srs_freep(flv);
+        return NULL;
+    }
+    
+    return flv;
+}
+
+srs_flv_t srs_flv_open_write_async(const char* file, int max_inflight, srs_bool nonblocking)
+{
+    int ret = ERROR_SUCCESS;
+    
+    FlvContext* flv = new FlvContext();
+    
+    // the windows use the sync writer.
+#ifndef _WIN32
+    SrsAsyncFileWriter* writer = new SrsAsyncFileWriter();
+    writer->set_inflight(max_inflight, nonblocking);
+    
+    srs_freep(flv->writer);
+    flv->writer = writer;
+#endif
+    
+    if ((ret = flv->writer->open(file)) != ERROR_SUCCESS) {
+        srs_freep(flv);
+        return NULL;
+    }
+    
+    if ((ret = flv->enc.initialize(flv->writer)) != ERROR_SUCCESS) {
+        srs_freep(flv);
+        return NULL;
+    }
+    
+    return flv;
+}
+
+int srs_flv_write_inflight(srs_flv_t flv)
+{
+    FlvContext* context = (FlvContext*)flv;
+    
+#ifndef _WIN32
+    SrsAsyncFileWriter* writer = dynamic_cast<SrsAsyncFileWriter*>(context->writer);
+    if (writer) {
+        return writer->inflight();
+    }
+#endif
+    
+    return 0;
+}
+
+srs_flv_t srs_flv_open_write_direct(const char* file)
+{
+    int ret = ERROR_SUCCESS;
+    
+    FlvContext* flv = new FlvContext();
+    flv->writer->set_direct(true);
+    
+    if ((ret = flv->writer->open(file)) != ERROR_SUCCESS) {
         srs_freep(flv);
         return NULL;
     }
     
-    if ((ret = flv->enc.initialize(&flv->writer)) != ERROR_SUCCESS) {
+    if ((ret = flv->enc.initialize(flv->writer)) != ERROR_SUCCESS) {
         srs_freep(flv);
         return NULL;
     }
@@ -32850,10 +43339,20 @@ srs_flv_t srs_flv_open_write(const char* file)
     return flv;
 }
 
-void srs_flv_close(srs_flv_t flv)
+int srs_flv_close(srs_flv_t flv)
 {
+    int ret = ERROR_SUCCESS;
+    
     FlvContext* context = (FlvContext*)flv;
+    
+    // write the buffered tags, the error is lost when free the writer.
+    if (context && context->writer->is_open()) {
+        ret = context->writer->close();
+    }
+    
     srs_freep(context);
+    
+    return ret;
 }
 
 int srs_flv_read_header(srs_flv_t flv, char header[9])
@@ -32917,13 +43416,35 @@ int srs_flv_read_tag_data(srs_flv_t flv, char* data, int32_t size)
     return ret;
 }
 
+int srs_flv_read_tag_view(srs_flv_t flv, char** pdata, int32_t size)
+{
+    int ret = ERROR_SUCCESS;
+    
+    FlvContext* context = (FlvContext*)flv;
+    
+    if (!context->reader.is_open()) {
+        return ERROR_SYSTEM_IO_INVALID;
+    }
+    
+    if ((ret = context->dec.read_tag_data_view(pdata, size)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    char ts[4]; // tag size
+    if ((ret = context->dec.read_previous_tag_size(ts)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    return ret;
+}
+
 int srs_flv_write_header(srs_flv_t flv, char header[9])
 {
     int ret = ERROR_SUCCESS;
     
     FlvContext* context = (FlvContext*)flv;
 
-    if (!context->writer.is_open()) {
+    if (!context->writer->is_open()) {
         return ERROR_SYSTEM_IO_INVALID;
     }
     
@@ -32940,7 +43461,7 @@ int srs_flv_write_tag(srs_flv_t flv, char type, int32_t time, char* data, int si
     
     FlvContext* context = (FlvContext*)flv;
 
-    if (!context->writer.is_open()) {
+    if (!context->writer->is_open()) {
         return ERROR_SYSTEM_IO_INVALID;
     }
     
@@ -32960,6 +43481,45 @@ int srs_flv_size_tag(int data_size)
     return SrsFlvEncoder::size_tag(data_size);
 }
 
+int srs_flv_set_write_buffer(srs_flv_t flv, int size, int interval_ms)
+{
+    FlvContext* context = (FlvContext*)flv;
+    
+    if (!context->writer->is_open()) {
+        return ERROR_SYSTEM_IO_INVALID;
+    }
+    
+    return context->writer->set_buffer(size, interval_ms);
+}
+
+int srs_flv_set_write_sync(srs_flv_t flv, int policy)
+{
+    FlvContext* context = (FlvContext*)flv;
+    
+    if (!context->writer->is_open()) {
+        return ERROR_SYSTEM_IO_INVALID;
+    }
+    
+    if (policy < SRS_FLV_SYNC_NONE || policy > SRS_FLV_SYNC_CLOSE) {
+        return ERROR_SYSTEM_IO_INVALID;
+    }
+    
+    context->writer->set_sync((SrsFileSync)policy);
+    
+    return ERROR_SUCCESS;
+}
+
+int srs_flv_flush(srs_flv_t flv)
+{
+    FlvContext* context = (FlvContext*)flv;
+    
+    if (!context->writer->is_open()) {
+        return ERROR_SYSTEM_IO_INVALID;
+    }
+    
+    return context->writer->flush();
+}
+
 int64_t srs_flv_tellg(srs_flv_t flv)
 {
     FlvContext* context = (FlvContext*)flv;
@@ -32972,11 +43532,410 @@ void srs_flv_lseek(srs_flv_t flv, int64_t offset)
     context->reader.lseek(offset);
 }
 
+int srs_flv_build_index(const char* file, const char* index_file)
+{
+    int ret = ERROR_SUCCESS;
+    
+    SrsFileReader reader;
+    if ((ret = reader.open(file)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    SrsFlvIndex index;
+    if ((ret = index.build(&reader)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    if ((ret = index.save(index_file)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    return ret;
+}
+
+int srs_flv_load_index(srs_flv_t flv, const char* index_file)
+{
+    int ret = ERROR_SUCCESS;
+    
+    FlvContext* context = (FlvContext*)flv;
+    
+    if (!context->reader.is_open()) {
+        return ERROR_SYSTEM_IO_INVALID;
+    }
+    
+    // use the sidecar when it matches the flv.
+    if (index_file && context->index.load(index_file, context->reader.filesize(), context->reader.mtime()) == ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    if ((ret = context->index.build(&context->reader)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // ignore the error, for the index is ok in memory.
+    if (index_file && (ret = context->index.save(index_file)) != ERROR_SUCCESS) {
+        srs_warn("save flv index to %s failed, ignore. ret=%d", index_file, ret);
+        ret = ERROR_SUCCESS;
+    }
+    
+    return ret;
+}
+
+int srs_flv_seek_keyframe(srs_flv_t flv, u_int32_t time, u_int32_t* ptime)
+{
+    int ret = ERROR_SUCCESS;
+    
+    FlvContext* context = (FlvContext*)flv;
+    
+    if (!context->reader.is_open()) {
+        return ERROR_SYSTEM_IO_INVALID;
+    }
+    
+    int64_t offset = 0;
+    if ((ret = context->index.seek(time, &offset, ptime)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    if (context->reader.lseek(offset) < 0) {
+        return ERROR_SYSTEM_FILE_SEEK;
+    }
+    
+    return ret;
+}
+
+int srs_flv_scan(const char* file, int nb_threads,
+    int64_t* nb_audios, int64_t* nb_videos, int64_t* nb_keyframes,
+    int64_t* nb_errors, int64_t* nb_jumps, u_int32_t* duration,
+    int* video_codec, int* audio_codec
+) {
+    int ret = ERROR_SUCCESS;
+    
+    SrsFileReader reader;
+    if ((ret = reader.open_mmap(file)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    SrsFlvScanner scanner;
+    if ((ret = scanner.initialize(&reader)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    SrsFlvScanStats stats;
+    if ((ret = scanner.scan(nb_threads, &stats)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    if (nb_audios) {
+        *nb_audios = stats.nb_audios;
+    }
+    if (nb_videos) {
+        *nb_videos = stats.nb_videos;
+    }
+    if (nb_keyframes) {
+        *nb_keyframes = stats.nb_keyframes;
+    }
+    if (nb_errors) {
+        *nb_errors = stats.nb_errors;
+    }
+    if (nb_jumps) {
+        *nb_jumps = stats.nb_jumps;
+    }
+    if (duration) {
+        *duration = stats.end_time - stats.start_time;
+    }
+    if (video_codec) {
+        *video_codec = stats.video_codec;
+    }
+    if (audio_codec) {
+        *audio_codec = stats.audio_codec;
+    }
+    
+    return ret;
+}
+
+/**
+* write the header and metadata, then copy the tags of tmp_file to writer.
+*/
+int srs_flv_repair_copy(SrsFileWriter* writer, std::string tmp_file, SrsFlvRepairStats* stats, SrsAmf0EcmaArray* metadata)
+{
+    int ret = ERROR_SUCCESS;
+    
+    SrsFlvEncoder enc;
+    if ((ret = enc.initialize(writer)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // set the audio and video flags, for the repaired file.
+    char flv_header[] = {
+        'F', 'L', 'V', (char)0x01,
+        (char)((stats->has_audio? 0x04 : 0x00) | (stats->has_video? 0x01 : 0x00)),
+        (char)0x00, (char)0x00, (char)0x00, (char)0x09
+    };
+    if ((ret = enc.write_header(flv_header)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    int size = SrsAmf0Size::str(SRS_CONSTS_RTMP_ON_METADATA) + SrsAmf0Size::ecma_array(metadata);
+    char* data = new char[size];
+    SrsAutoFreeA(char, data);
+    
+    SrsStream stream;
+    if ((ret = stream.initialize(data, size)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    if ((ret = srs_amf0_write_string(&stream, SRS_CONSTS_RTMP_ON_METADATA)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    if ((ret = metadata->write(&stream)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    if ((ret = enc.write_metadata(SrsCodecFlvTagScript, data, size)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    SrsFileReader reader;
+    if ((ret = reader.open(tmp_file)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    char* buf = new char[SRS_PERF_FLV_REPAIR_BUFFER];
+    SrsAutoFreeA(char, buf);
+    
+    while (true) {
+        ssize_t nread = 0;
+        if ((ret = reader.read(buf, SRS_PERF_FLV_REPAIR_BUFFER, &nread)) != ERROR_SUCCESS) {
+            break;
+        }
+        if ((ret = writer->write(buf, nread, NULL)) != ERROR_SUCCESS) {
+            return ret;
+        }
+    }
+    
+    if (ret != ERROR_SYSTEM_FILE_EOF) {
+        return ret;
+    }
+    
+    return ERROR_SUCCESS;
+}
+
+/**
+* write the repaired flv, the header and metadata, then the tags in tmp_file.
+* @remark the repaired_file is partial when error, user should remove it.
+*/
+int srs_flv_repair_write(const char* repaired_file, std::string tmp_file, SrsFlvRepairStats* stats, SrsAmf0EcmaArray* metadata)
+{
+    int ret = ERROR_SUCCESS;
+    
+    SrsFileWriter writer;
+    if ((ret = writer.open(repaired_file)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    if ((ret = srs_flv_repair_copy(&writer, tmp_file, stats, metadata)) != ERROR_SUCCESS) {
+        writer.close();
+        return ret;
+    }
+    
+    // the close flushes the buffer, must check it.
+    return writer.close();
+}
+
+/**
+* build the onMetaData of repaired flv, merge the original metadata,
+* with the duration and keyframes of repaired tags.
+* @param positions the offset of keyframes in tags, without the header.
+* @param body_size the bytes of all tags.
+*/
+SrsAmf0EcmaArray* srs_flv_repair_metadata(SrsAmf0Any* original, SrsFlvRepairStats* stats,
+    std::vector<double>& times, std::vector<double>& positions, int64_t body_size
+) {
+    SrsAmf0EcmaArray* metadata = SrsAmf0Any::ecma_array();
+    
+    // copy the original properties, except the generated.
+    if (original && (original->is_ecma_array() || original->is_object())) {
+        int count = original->is_ecma_array()? original->to_ecma_array()->count() : original->to_object()->count();
+        for (int i = 0; i < count; i++) {
+            std::string key;
+            SrsAmf0Any* value = NULL;
+            if (original->is_ecma_array()) {
+                key = original->to_ecma_array()->key_at(i);
+                value = original->to_ecma_array()->value_at(i);
+            } else {
+                key = original->to_object()->key_at(i);
+                value = original->to_object()->value_at(i);
+            }
+            
+            if (key == "duration" || key == "filesize" || key == "keyframes"
+                || key == "hasVideo" || key == "hasAudio" || key == "hasKeyframes"
+            ) {
+                continue;
+            }
+            metadata->set(key, value->copy());
+        }
+    }
+    
+    metadata->set("duration", SrsAmf0Any::number(stats->duration / 1000.0));
+    metadata->set("filesize", SrsAmf0Any::number(0));
+    metadata->set("hasVideo", SrsAmf0Any::boolean(stats->has_video));
+    metadata->set("hasAudio", SrsAmf0Any::boolean(stats->has_audio));
+    metadata->set("hasKeyframes", SrsAmf0Any::boolean(!times.empty()));
+    
+    SrsAmf0Object* keyframes = SrsAmf0Any::object();
+    SrsAmf0StrictArray* filepositions = SrsAmf0Any::strict_array();
+    SrsAmf0StrictArray* keyframe_times = SrsAmf0Any::strict_array();
+    keyframes->set("filepositions", filepositions);
+    keyframes->set("times", keyframe_times);
+    metadata->set("keyframes", keyframes);
+    
+    for (int i = 0; i < (int)times.size(); i++) {
+        filepositions->append(SrsAmf0Any::number(0));
+        keyframe_times->append(SrsAmf0Any::number(times[i]));
+    }
+    
+    // the number is fixed size, so the size of metadata is known now,
+    // to update the filesize and filepositions.
+    int header_size = 9 + SRS_FLV_PREVIOUS_TAG_SIZE + SRS_FLV_TAG_HEADER_SIZE
+        + SrsAmf0Size::str(SRS_CONSTS_RTMP_ON_METADATA) + SrsAmf0Size::ecma_array(metadata)
+        + SRS_FLV_PREVIOUS_TAG_SIZE;
+    
+    metadata->get_property("filesize")->set_number((double)(header_size + body_size));
+    for (int i = 0; i < (int)positions.size(); i++) {
+        filepositions->at(i)->set_number(header_size + positions[i]);
+    }
+    
+    return metadata;
+}
+
+int srs_flv_repair(const char* file, const char* repaired_file, int max_jump_ms,
+    int64_t* nb_errors, int64_t* nb_drops, int64_t* nb_jumps, u_int32_t* duration
+) {
+    int ret = ERROR_SUCCESS;
+    
+    SrsFileReader reader;
+    if ((ret = reader.open(file)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    SrsFlvRepairer repairer;
+    if ((ret = repairer.initialize(&reader)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    repairer.set_max_jump(max_jump_ms);
+    
+    // write the repaired tags to temp file in one pass,
+    // then prepend the metadata which depends on all tags.
+    std::string tmp_file = std::string(repaired_file) + ".tmp";
+    SrsFileWriter tmp_writer;
+    if ((ret = tmp_writer.open(tmp_file)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    SrsFlvEncoder tmp_enc;
+    if ((ret = tmp_enc.initialize(&tmp_writer)) != ERROR_SUCCESS) {
+        tmp_writer.close();
+        ::remove(tmp_file.c_str());
+        return ret;
+    }
+    
+    SrsAmf0Any* original = NULL;
+    SrsAutoFree(SrsAmf0Any, original);
+    
+    std::vector<double> times;
+    std::vector<double> positions;
+    
+    while (true) {
+        char type = 0;
+        int32_t size = 0;
+        u_int32_t time = 0;
+        char* data = NULL;
+        if ((ret = repairer.read_tag(&type, &size, &time, &data)) != ERROR_SUCCESS) {
+            break;
+        }
+        
+        if (type == SrsCodecFlvTagScript) {
+            // merge the first onMetaData, drop the others.
+            SrsStream stream;
+            std::string name;
+            if (stream.initialize(data, size) == ERROR_SUCCESS
+                && srs_amf0_read_string(&stream, name) == ERROR_SUCCESS
+                && name == SRS_CONSTS_RTMP_ON_METADATA
+            ) {
+                if (!original) {
+                    srs_amf0_read_any(&stream, &original);
+                }
+                continue;
+            }
+            ret = tmp_enc.write_metadata(type, data, size);
+        } else if (type == SrsCodecFlvTagAudio) {
+            ret = tmp_enc.write_audio(time, data, size);
+        } else {
+            if (SrsFlvCodec::video_is_keyframe(data, size) && !SrsFlvCodec::video_is_sequence_header(data, size)) {
+                times.push_back(time / 1000.0);
+                positions.push_back((double)tmp_writer.tellg());
+            }
+            ret = tmp_enc.write_video(time, data, size);
+        }
+        
+        if (ret != ERROR_SUCCESS) {
+            break;
+        }
+    }
+    
+    if (ret != ERROR_SYSTEM_FILE_EOF) {
+        tmp_writer.close();
+        ::remove(tmp_file.c_str());
+        return ret;
+    }
+    ret = ERROR_SUCCESS;
+    
+    int64_t body_size = tmp_writer.tellg();
+    if ((ret = tmp_writer.close()) != ERROR_SUCCESS) {
+        ::remove(tmp_file.c_str());
+        return ret;
+    }
+    
+    SrsFlvRepairStats* stats = repairer.stats();
+    SrsAmf0EcmaArray* metadata = srs_flv_repair_metadata(original, stats, times, positions, body_size);
+    SrsAutoFree(SrsAmf0EcmaArray, metadata);
+    
+    // write the header, metadata, then append the tags.
+    // never leave the partial repaired file.
+    if ((ret = srs_flv_repair_write(repaired_file, tmp_file, stats, metadata)) != ERROR_SUCCESS) {
+        ::remove(repaired_file);
+        ::remove(tmp_file.c_str());
+        return ret;
+    }
+    ::remove(tmp_file.c_str());
+    
+    srs_trace("flv repair %s to %s, tags=%"PRId64", errors=%"PRId64", drops=%"PRId64", jumps=%"PRId64", duration=%u",
+        file, repaired_file, stats->nb_tags, stats->nb_errors, stats->nb_drops, stats->nb_jumps, stats->duration);
+    
+    if (nb_errors) {
+        *nb_errors = stats->nb_errors;
+    }
+    if (nb_drops) {
+        *nb_drops = stats->nb_drops;
+    }
+    if (nb_jumps) {
+        *nb_jumps = stats->nb_jumps;
+    }
+    if (duration) {
+        *duration = stats->duration;
+    }
+    
+    return ret;
+}
+
 srs_bool srs_flv_is_eof(int error_code)
 {
     return error_code == ERROR_SYSTEM_FILE_EOF;
 }
 
+srs_bool srs_flv_is_busy(int error_code)
+{
+    return error_code == ERROR_SYSTEM_FILE_BUSY;
+}
+
 srs_bool srs_flv_is_sequence_header(char* data, int32_t size)
 {
     return SrsFlvCodec::video_is_sequence_header(data, (int)size);
@@ -32987,6 +43946,287 @@ srs_bool srs_flv_is_keyframe(char* data, int32_t size)
     return SrsFlvCodec::video_is_keyframe(data, (int)size);
 }
 
+srs_hls_t srs_hls_open(const char* m3u8_file, int fragment_ms, int window_ms, srs_bool cleanup)
+{
+    int ret = ERROR_SUCCESS;
+    
+    SrsHlsEncoder* hls = new SrsHlsEncoder();
+    
+    if ((ret = hls->initialize(m3u8_file, fragment_ms, window_ms, cleanup)) != ERROR_SUCCESS) {
+        srs_freep(hls);
+        return NULL;
+    }
+    
+    return hls;
+}
+
+int srs_hls_set_part(srs_hls_t hls, int part_ms)
+{
+    SrsHlsEncoder* encoder = (SrsHlsEncoder*)hls;
+    return encoder->set_part(part_ms);
+}
+
+int srs_hls_set_sync(srs_hls_t hls, srs_bool v)
+{
+    SrsHlsEncoder* encoder = (SrsHlsEncoder*)hls;
+    encoder->set_sync(v);
+    return ERROR_SUCCESS;
+}
+
+srs_bool srs_hls_is_ready(srs_hls_t hls, int msn, int part)
+{
+    SrsHlsEncoder* encoder = (SrsHlsEncoder*)hls;
+    return encoder->is_ready(msn, part);
+}
+
+int srs_hls_write_tag(srs_hls_t hls, char type, u_int32_t time, char* data, int size)
+{
+    SrsHlsEncoder* encoder = (SrsHlsEncoder*)hls;
+    
+    if (type == SRS_RTMP_TYPE_AUDIO) {
+        return encoder->write_audio(time, data, size);
+    } else if (type == SRS_RTMP_TYPE_VIDEO) {
+        return encoder->write_video(time, data, size);
+    }
+    
+    return ERROR_SUCCESS;
+}
+
+int srs_hls_close(srs_hls_t hls)
+{
+    SrsHlsEncoder* encoder = (SrsHlsEncoder*)hls;
+    
+    int ret = ERROR_SUCCESS;
+    if ((ret = encoder->close()) != ERROR_SUCCESS) {
+        srs_warn("hls: close failed. ret=%d", ret);
+    }
+    
+    srs_freep(encoder);
+    
+    return ret;
+}
+
+struct Mp4Context
+{
+    SrsFileWriter writer;
+    SrsMp4Encoder enc;
+};
+
+srs_mp4_t srs_mp4_open(const char* file, int fragment_ms)
+{
+    int ret = ERROR_SUCCESS;
+    
+    Mp4Context* mp4 = new Mp4Context();
+    
+    if ((ret = mp4->writer.open(file)) != ERROR_SUCCESS) {
+        srs_freep(mp4);
+        return NULL;
+    }
+    
+    if ((ret = mp4->enc.initialize(&mp4->writer, fragment_ms)) != ERROR_SUCCESS) {
+        srs_freep(mp4);
+        return NULL;
+    }
+    
+    return mp4;
+}
+
+int srs_mp4_write_tag(srs_mp4_t mp4, char type, u_int32_t time, char* data, int size)
+{
+    Mp4Context* context = (Mp4Context*)mp4;
+    
+    if (type == SRS_RTMP_TYPE_AUDIO) {
+        return context->enc.write_audio(time, data, size);
+    } else if (type == SRS_RTMP_TYPE_VIDEO) {
+        return context->enc.write_video(time, data, size);
+    }
+    
+    srs_freepa(data);
+    
+    return ERROR_SUCCESS;
+}
+
+int srs_mp4_close(srs_mp4_t mp4)
+{
+    Mp4Context* context = (Mp4Context*)mp4;
+    
+    int ret = ERROR_SUCCESS;
+    if ((ret = context->enc.flush()) != ERROR_SUCCESS) {
+        srs_warn("mp4: flush the last fragment failed. ret=%d", ret);
+    }
+    
+    int r0 = context->writer.close();
+    if (ret == ERROR_SUCCESS) {
+        ret = r0;
+    }
+    
+    srs_freep(context);
+    
+    return ret;
+}
+
+#ifndef _WIN32
+struct UdpContext
+{
+    SrsTsUdpWriter writer;
+    SrsTsEncoder enc;
+};
+#endif
+
+srs_udp_t srs_udp_open(const char* url, int ttl, int bitrate)
+{
+#ifndef _WIN32
+    int ret = ERROR_SUCCESS;
+    
+    UdpContext* udp = new UdpContext();
+    udp->writer.set_ttl(ttl);
+    udp->writer.set_bitrate(bitrate);
+    
+    if ((ret = udp->writer.open(url)) != ERROR_SUCCESS) {
+        srs_freep(udp);
+        return NULL;
+    }
+    
+    if ((ret = udp->enc.initialize(&udp->writer)) != ERROR_SUCCESS) {
+        srs_freep(udp);
+        return NULL;
+    }
+    udp->enc.set_interval(100, 40);
+    udp->enc.set_bitrate(bitrate);
+    
+    return udp;
+#else
+    return NULL;
+#endif
+}
+
+int srs_udp_write_tag(srs_udp_t udp, char type, u_int32_t time, char* data, int size)
+{
+#ifndef _WIN32
+    UdpContext* context = (UdpContext*)udp;
+    
+    if (type == SRS_RTMP_TYPE_AUDIO) {
+        return context->enc.write_audio(time, data, size);
+    } else if (type == SRS_RTMP_TYPE_VIDEO) {
+        return context->enc.write_video(time, data, size);
+    }
+#endif
+    
+    return ERROR_SUCCESS;
+}
+
+int srs_udp_close(srs_udp_t udp)
+{
+    int ret = ERROR_SUCCESS;
+    
+#ifndef _WIN32
+    UdpContext* context = (UdpContext*)udp;
+    
+    // send the queued datagrams, the error is lost when free the writer.
+    if (context && context->writer.is_open()) {
+        ret = context->writer.close();
+    }
+    
+    srs_freep(context);
+#endif
+    
+    return ret;
+}
+
+struct TsMuxerContext
+{
+    // the file or udp writer.
+    SrsFileWriter* writer;
+    SrsTsMultiEncoder* enc;
+    
+    TsMuxerContext() {
+        writer = NULL;
+        enc = new SrsTsMultiEncoder();
+    }
+    virtual ~TsMuxerContext() {
+        // the encoder close the writer.
+        srs_freep(enc);
+        srs_freep(writer);
+    }
+};
+
+srs_ts_t srs_ts_open(const char* url, int bitrate)
+{
+    int ret = ERROR_SUCCESS;
+    
+    TsMuxerContext* ts = new TsMuxerContext();
+    
+    if (!srs_string_starts_with(url, "udp://")) {
+        ts->writer = new SrsFileWriter();
+    } else {
+#ifndef _WIN32
+        SrsTsUdpWriter* writer = new SrsTsUdpWriter();
+        writer->set_bitrate(bitrate);
+        ts->writer = writer;
+#else
+        srs_freep(ts);
+        return NULL;
+#endif
+    }
+    
+    if ((ret = ts->writer->open(url)) != ERROR_SUCCESS) {
+        srs_freep(ts);
+        return NULL;
+    }
+    
+    if ((ret = ts->enc->initialize(ts->writer)) != ERROR_SUCCESS) {
+        srs_freep(ts);
+        return NULL;
+    }
+    ts->enc->set_interval(100, 40);
+    ts->enc->set_bitrate(bitrate);
+    
+    return ts;
+}
+
+int srs_ts_add_track(srs_ts_t ts, int program, int pid)
+{
+    int ret = ERROR_SUCCESS;
+    
+    TsMuxerContext* context = (TsMuxerContext*)ts;
+    
+    int track = -1;
+    if ((ret = context->enc->add_track(program, pid, &track)) != ERROR_SUCCESS) {
+        return -1;
+    }
+    
+    return track;
+}
+
+int srs_ts_write_tag(srs_ts_t ts, int track, char type, u_int32_t time, char* data, int size)
+{
+    TsMuxerContext* context = (TsMuxerContext*)ts;
+    
+    if (type == SRS_RTMP_TYPE_AUDIO) {
+        return context->enc->write_audio(track, time, data, size);
+    } else if (type == SRS_RTMP_TYPE_VIDEO) {
+        return context->enc->write_video(track, time, data, size);
+    }
+    
+    return ERROR_SUCCESS;
+}
+
+int srs_ts_close(srs_ts_t ts)
+{
+    int ret = ERROR_SUCCESS;
+    
+    TsMuxerContext* context = (TsMuxerContext*)ts;
+    
+    // write the buffered ts, the error is lost when free the writer.
+    if (context && context->writer && context->writer->is_open()) {
+        ret = context->writer->close();
+    }
+    
+    srs_freep(context);
+    
+    return ret;
+}
+
 srs_amf0_t srs_amf0_parse(char* data, int size, int* nparsed)
 {
     int ret = ERROR_SUCCESS;
@@ -33302,6 +44542,35 @@ int64_t srs_utils_recv_bytes(srs_rtmp_t rtmp)
     return context->rtmp->get_recv_bytes();
 }
 
+int srs_utils_startup_timing(srs_rtmp_t rtmp,
+    int64_t* dns, int64_t* connect, int64_t* handshake,
+    int64_t* connect_app, int64_t* create_stream, int64_t* play_publish,
+    int64_t* first_audio, int64_t* first_video, int64_t* first_keyframe
+) {
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(rtmp != NULL);
+    Context* context = (Context*)rtmp;
+    
+    int64_t* stimes[] = {
+        &context->stime_dns, &context->stime_connect, &context->stime_handshake,
+        &context->stime_connect_app, &context->stime_create_stream, &context->stime_play_publish,
+        &context->stime_first_audio, &context->stime_first_video, &context->stime_first_keyframe
+    };
+    int64_t* elapsed[] = {
+        dns, connect, handshake,
+        connect_app, create_stream, play_publish,
+        first_audio, first_video, first_keyframe
+    };
+    
+    for (int i = 0; i < (int)(sizeof(stimes) / sizeof(int64_t*)); i++) {
+        int64_t stime = *stimes[i];
+        *elapsed[i] = (stime > 0)? stime - context->stime_start : -1;
+    }
+    
+    return ret;
+}
+
 int srs_utils_parse_timestamp(
     u_int32_t time, char type, char* data, int size,
     u_int32_t* ppts
@@ -33313,7 +44582,8 @@ int srs_utils_parse_timestamp(
         return ret;
     }
 
-    if (!SrsFlvCodec::video_is_h264(data, size)) {
+    bool is_hevc = SrsFlvCodec::video_is_hevc(data, size);
+    if (!SrsFlvCodec::video_is_h264(data, size) && !is_hevc) {
         return ERROR_FLV_INVALID_VIDEO_TAG;
     }
 
@@ -33322,6 +44592,22 @@ int srs_utils_parse_timestamp(
         return ret;
     }
     
+    // for the enhanced RTMP, 1bytes header, 4bytes FourCC, then the
+    // 3bytes cts only for the coded frames, others are zero.
+    if (is_hevc && (data[0] & SRS_FLV_VIDEO_EX_HEADER)) {
+        if ((data[0] & 0x0f) != SrsCodecVideoExPacketTypeCodedFrames) {
+            *ppts = time;
+            return ret;
+        }
+        if (size < 8) {
+            return ERROR_FLV_INVALID_VIDEO_TAG;
+        }
+        
+        // skip the FourCC, the cts is the same as avc.
+        data += 3;
+        size -= 3;
+    }
+    
     // 1bytes, frame type and codec id.
     // 1bytes, avc packet type.
     // 3bytes, cts, composition time,
@@ -33363,12 +44649,22 @@ srs_bool srs_utils_flv_tag_is_av(char type)
     return type == SRS_RTMP_TYPE_AUDIO || type == SRS_RTMP_TYPE_VIDEO;
 }
 
+u_int32_t srs_utils_crc32(const void* buf, int size)
+{
+    return srs_crc32(buf, size);
+}
+
 char srs_utils_flv_video_codec_id(char* data, int size)
 {
     if (size < 1) {
         return 0;
     }
 
+    // for the enhanced RTMP, the codec is specified by FourCC.
+    if (data[0] & SRS_FLV_VIDEO_EX_HEADER) {
+        return SrsFlvCodec::video_is_hevc(data, size)? SrsCodecVideoHEVC : 0;
+    }
+    
     char codec_id = data[0];
     codec_id = codec_id & 0x0F;
     
@@ -33381,7 +44677,18 @@ char srs_utils_flv_video_avc_packet_type(char* data, int size)
         return -1;
     }
     
-    if (!SrsFlvCodec::video_is_h264(data, size)) {
+    // for the enhanced RTMP, map the packet type to avc packet type.
+    if (SrsFlvCodec::video_is_hevc(data, size) && (data[0] & SRS_FLV_VIDEO_EX_HEADER)) {
+        switch (data[0] & 0x0f) {
+            case SrsCodecVideoExPacketTypeSequenceStart: return SrsCodecVideoAVCTypeSequenceHeader;
+            case SrsCodecVideoExPacketTypeCodedFrames:
+            case SrsCodecVideoExPacketTypeCodedFramesX: return SrsCodecVideoAVCTypeNALU;
+            case SrsCodecVideoExPacketTypeSequenceEnd: return SrsCodecVideoAVCTypeSequenceHeaderEOF;
+            default: return -1;
+        }
+    }
+    
+    if (!SrsFlvCodec::video_is_h264(data, size) && !SrsFlvCodec::video_is_hevc(data, size)) {
         return -1;
     }
     
@@ -33400,12 +44707,17 @@ char srs_utils_flv_video_frame_type(char* data, int size)
         return -1;
     }
     
-    if (!SrsFlvCodec::video_is_h264(data, size)) {
+    if (!SrsFlvCodec::video_is_h264(data, size) && !SrsFlvCodec::video_is_hevc(data, size)) {
         return -1;
     }
     
+    // for the enhanced RTMP, the frame type is 3bits.
     u_int8_t frame_type = data[0];
-    frame_type = (frame_type >> 4) & 0x0f;
+    if (frame_type & SRS_FLV_VIDEO_EX_HEADER) {
+        frame_type = (frame_type >> 4) & 0x07;
+    } else {
+        frame_type = (frame_type >> 4) & 0x0f;
+    }
     if (frame_type < 1 || frame_type > 5) {
         return -1;
     }
@@ -33527,6 +44839,7 @@ const char* srs_human_flv_video_codec_id2string(char codec_id)
     static const char* vp6_alpha = "VP6Alpha";
     static const char* screen2 = "Screen2";
     static const char* h264 = "H.264";
+    static const char* h265 = "H.265";
     static const char* unknown = "Unknown";
     
     switch (codec_id) {
@@ -33536,6 +44849,7 @@ const char* srs_human_flv_video_codec_id2string(char codec_id)
         case 5: return vp6_alpha;
         case 6: return screen2;
         case 7: return h264;
+        case 12: return h265;
         default: return unknown;
     }
     
@@ -33763,7 +45077,7 @@ int srs_human_print_rtmp_packet4(char type, u_int32_t timestamp, char* data, int
             
             char* amf0_str = NULL;
             srs_human_raw("%s", srs_human_amf0_print(amf0, &amf0_str, NULL));
-            srs_freep(amf0_str);
+            srs_freepa(amf0_str);
         }
     } else {
         srs_human_trace("Rtmp packet id=%"PRId64"/%.1f/%.1f, type=%#x, dts=%d, pts=%d, ndiff=%d, diff=%d, size=%d",
@@ -33797,7 +45111,7 @@ const char* srs_human_format_time()
         tm->tm_hour, tm->tm_min, tm->tm_sec, 
         (int)(tv.tv_usec / 1000));
         
-    // for srs-librtmp, @see https://github.com/simple-rtmp-server/srs/issues/213
+    // for srs-librtmp, @see https://github.com/ossrs/srs/issues/213
     buf[sizeof(buf) - 1] = 0;
     
     return buf;
@@ -33828,7 +45142,7 @@ srs_hijack_io_t srs_hijack_io_get(srs_rtmp_t rtmp)
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -33852,7 +45166,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 //#include <srs_kernel_error.hpp>
 
-// for srs-librtmp, @see https://github.com/simple-rtmp-server/srs/issues/213
+// for srs-librtmp, @see https://github.com/ossrs/srs/issues/213
 #ifndef _WIN32
     #define SOCKET_ETIME ETIME
     #define SOCKET_ECONNRESET ECONNRESET
@@ -33880,7 +45194,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
     #define SOCKET_CLEANUP() socket_cleanup()
 #endif
 
-// for srs-librtmp, @see https://github.com/simple-rtmp-server/srs/issues/213
+// for srs-librtmp, @see https://github.com/ossrs/srs/issues/213
 #ifndef _WIN32
     #include <unistd.h>
     #include <sys/socket.h>
@@ -34033,7 +45347,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
         // the writev() function returns the number of bytes written.  On error, -1 is
         // returned, and errno is set appropriately.
         if (nb_write <= 0) {
-            // @see https://github.com/simple-rtmp-server/srs/issues/200
+            // @see https://github.com/ossrs/srs/issues/200
             if (nb_write < 0 && SOCKET_ERRNO() == SOCKET_ETIME) {
                 return ERROR_SOCKET_TIMEOUT;
             }
@@ -34090,7 +45404,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
         }
         
         if (nb_write <= 0) {
-            // @see https://github.com/simple-rtmp-server/srs/issues/200
+            // @see https://github.com/ossrs/srs/issues/200
             if (nb_write < 0 && SOCKET_ERRNO() == SOCKET_ETIME) {
                 return ERROR_SOCKET_TIMEOUT;
             }
@@ -34209,7 +45523,7 @@ int SimpleSocketStream::write(void* buf, size_t size, ssize_t* nwrite)
 /*
 The MIT License (MIT)
 
-Copyright (c) 2013-2015 SRS(simple-rtmp-server)
+Copyright (c) 2013-2015 SRS(ossrs)
 
 Permission is hereby granted, free of charge, to any person obtaining a copy of
 this software and associated documentation files (the "Software"), to deal in
@@ -34231,7 +45545,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 //#include <srs_lib_bandwidth.hpp>
 
-// for srs-librtmp, @see https://github.com/simple-rtmp-server/srs/issues/213
+// for srs-librtmp, @see https://github.com/ossrs/srs/issues/213
 #ifndef _WIN32
 #include <unistd.h>
 #endif